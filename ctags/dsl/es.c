@@ -486,13 +486,29 @@ es_nil_print(const EsObject* object, MIO* fp)
 /*
  * Integer
  */
+/* Integers are immutable, so the small ones, which scripts create most
+ * (counters, indexes, offsets), are allocated once and shared. */
+#define ES_INTEGER_CACHE_MIN -1
+#define ES_INTEGER_CACHE_MAX 255
+
 EsObject*
 es_integer_new (int                value)
 {
+	static EsObject* cache[ES_INTEGER_CACHE_MAX - ES_INTEGER_CACHE_MIN + 1];
 	EsObject* r;
 
+	if (value >= ES_INTEGER_CACHE_MIN && value <= ES_INTEGER_CACHE_MAX
+		&& cache[value - ES_INTEGER_CACHE_MIN])
+		return es_object_ref(cache[value - ES_INTEGER_CACHE_MIN]);
+
 	r = es_object_new(ES_TYPE_INTEGER);
+	if (es_error_p(r))
+		return r;
 	((EsInteger*)r)->value = value;
+
+	/* the cache keeps a reference, so cached integers are never freed */
+	if (value >= ES_INTEGER_CACHE_MIN && value <= ES_INTEGER_CACHE_MAX)
+		cache[value - ES_INTEGER_CACHE_MIN] = es_object_ref(r);
 	return r;
 }
 
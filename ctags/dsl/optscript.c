@@ -859,6 +859,13 @@ opt_vm_read (OptVM *vm, MIO *in)
 	return e;
 }
 
+void
+opt_vm_bind (OptVM *vm, EsObject *proc)
+{
+	if (es_object_get_type (proc) == OPT_TYPE_ARRAY)
+		vm_bind_proc (vm, es_pointer_get (proc));
+}
+
 EsObject *
 opt_vm_eval (OptVM *vm, EsObject *obj)
 {
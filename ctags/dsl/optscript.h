@@ -30,6 +30,7 @@ void      opt_vm_delete       (OptVM *vm);
 
 EsObject *opt_vm_read         (OptVM *vm, MIO *in);
 EsObject *opt_vm_eval         (OptVM *vm, EsObject *obj);
+void      opt_vm_bind         (OptVM *vm, EsObject *proc);
 void      opt_vm_report_error (OptVM *vm, EsObject *eobj, MIO *err);
 
 void     *opt_vm_set_app_data (OptVM *vm, void *app_data);
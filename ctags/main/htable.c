@@ -31,16 +31,34 @@
 #include <string.h>
 
 
+/* The table uses open addressing with linear probing over a power of two
+ * number of slots. Each slot caches the hash of its key so that probing
+ * only calls the equal function for keys with the same hash.
+ *
+ * Items for the same key always lie on the same probe sequence, the most
+ * recently added one first, as the chained implementation this replaces
+ * kept them. Deleted slots become tombstones until the next rehash. */
+
+enum hentryState {
+	HENTRY_FREE,
+	HENTRY_USED,
+	HENTRY_DELETED,
+};
+
 typedef struct sHashEntry hentry;
 struct sHashEntry {
 	void *key;
 	void *value;
-	hentry *next;
+	unsigned int hash;
+	unsigned int state;
 };
 
 struct sHashTable {
-	hentry** table;
+	hentry* table;
 	unsigned int size;
+	unsigned int bits;
+	unsigned int count;		/* used slots */
+	unsigned int filled;	/* used and deleted slots */
 	hashTableHashFunc hashfn;
 	hashTableEqualFunc equalfn;
 	hashTableDeleteFunc keyfreefn;
@@ -49,22 +67,25 @@ struct sHashTable {
 	hashTableDeleteFunc valForNotUnknownKeyfreefn;
 };
 
-struct chainTracker {
-	const void *const target_key;
-	hashTableForeachFunc user_proc;
-	void *user_data;
-	hashTableEqualFunc equalfn;
-};
+#define HTABLE_MIN_BITS 3
 
-static hentry* entry_new (void *key, void *value, hentry* next)
+static unsigned int slot_first (hashTable *htable, unsigned int hash)
 {
-	hentry* entry = xMalloc (1, hentry);
+	/* Fibonacci hashing: spreads the hashes of pointers and small
+	 * integers, whose low bits are often all the same */
+	return (unsigned int) (((uint32_t) hash * UINT32_C(2654435769)) >> (32 - htable->bits));
+}
 
-	entry->key = key;
-	entry->value = value;
-	entry->next = next;
+static unsigned int slot_next (hashTable *htable, unsigned int i)
+{
+	return (i + 1) & (htable->size - 1);
+}
 
-	return entry;
+static bool entry_matches (hashTable *htable, hentry *entry,
+						   const void *key, unsigned int hash)
+{
+	return entry->state == HENTRY_USED && entry->hash == hash
+		&& htable->equalfn (key, entry->key);
 }
 
 static void entry_reset  (hentry* entry,
@@ -81,78 +102,100 @@ static void entry_reset  (hentry* entry,
 	entry->value = newval;
 }
 
-static hentry* entry_destroy (hentry* entry,
-			      hashTableDeleteFunc keyfreefn,
-			      hashTableDeleteFunc valfreefn)
+/* Returns the first slot holding an item for key, or NULL. */
+static hentry *entry_find (hashTable *htable, const void *const key, unsigned int hash)
 {
-	hentry* tmp;
-
-	entry_reset (entry, NULL, NULL, keyfreefn, valfreefn);
-	tmp = entry->next;
-	eFree (entry);
-
-	return tmp;
-}
-
-static void  entry_reclaim (hentry* entry,
-			    hashTableDeleteFunc keyfreefn,
-			    hashTableDeleteFunc valfreefn)
-{
-	while (entry)
-		entry = entry_destroy (entry, keyfreefn, valfreefn);
-}
+	unsigned int i;
 
-static void *entry_find (hentry* entry, const void* const key, hashTableEqualFunc equalfn,
-						 void *valForNotUnknownKey)
-{
-	while (entry)
+	for (i = slot_first (htable, hash);
+		 htable->table[i].state != HENTRY_FREE;
+		 i = slot_next (htable, i))
 	{
-		if (equalfn( key, entry->key))
-			return entry->value;
-		entry = entry->next;
+		if (entry_matches (htable, &htable->table[i], key, hash))
+			return &htable->table[i];
 	}
-	return valForNotUnknownKey;
+	return NULL;
 }
 
-static bool		entry_delete (hentry **entry, const void *key, hashTableEqualFunc equalfn,
-			      hashTableDeleteFunc keyfreefn, hashTableDeleteFunc valfreefn)
+/* Adds the item without checking for the load factor. */
+static void entry_insert (hashTable *htable, void *key, void *value, unsigned int hash)
 {
-	while (*entry)
+	hentry carry = { key, value, hash, HENTRY_USED };
+	unsigned int i;
+
+	for (i = slot_first (htable, hash);
+		 htable->table[i].state == HENTRY_USED;
+		 i = slot_next (htable, i))
 	{
-		if (equalfn (key, (*entry)->key))
+		/* push the older items for the same key further along the probe
+		 * sequence so the new one is found first */
+		if (entry_matches (htable, &htable->table[i], key, hash))
 		{
-			*entry = entry_destroy (*entry, keyfreefn, valfreefn);
-			return true;
+			hentry tmp = htable->table[i];
+			htable->table[i] = carry;
+			carry = tmp;
 		}
-		entry = &((*entry)->next);
 	}
-	return false;
+
+	if (htable->table[i].state == HENTRY_FREE)
+		htable->filled++;
+	htable->table[i] = carry;
+	htable->count++;
 }
 
-static bool		entry_update (hentry *entry, void *key, void *value, hashTableEqualFunc equalfn,
-			      hashTableDeleteFunc keyfreefn, hashTableDeleteFunc valfreefn)
+static void table_alloc (hashTable *htable, unsigned int bits)
 {
-	while (entry)
+	htable->bits = bits;
+	htable->size = 1U << bits;
+	htable->table = xCalloc (htable->size, hentry);
+	htable->count = 0;
+	htable->filled = 0;
+}
+
+static void table_rehash (hashTable *htable, unsigned int bits)
+{
+	hentry *old_table = htable->table;
+	unsigned int old_size = htable->size;
+	unsigned int start, i;
+
+	/* walk the old table from a free slot so that the items of a probe
+	 * sequence are re-added in order, which keeps the lookup order of
+	 * the items for the same key */
+	for (start = 0; old_table[start].state != HENTRY_FREE; start++)
+		;
+
+	table_alloc (htable, bits);
+	for (i = 0; i < old_size; i++)
 	{
-		if (equalfn (key, entry->key))
+		hentry *entry = &old_table[(start + i) & (old_size - 1)];
+
+		if (entry->state == HENTRY_USED)
 		{
-			entry_reset (entry, key, value, keyfreefn, valfreefn);
-			return true;
+			unsigned int j;
+
+			for (j = slot_first (htable, entry->hash);
+				 htable->table[j].state != HENTRY_FREE;
+				 j = slot_next (htable, j))
+				;
+			htable->table[j] = *entry;
+			htable->count++;
+			htable->filled++;
 		}
-		entry = entry->next;
 	}
-	return false;
+	eFree (old_table);
 }
 
-static bool  entry_foreach (hentry *entry, hashTableForeachFunc proc, void *user_data)
+/* Makes room for one more item, keeping the load factor below 3/4. */
+static void table_reserve (hashTable *htable)
 {
-	while (entry)
-	{
-		if (!proc (entry->key, entry->value, user_data))
-			return false;
-		entry = entry->next;
-	}
-	return true;
+	if ((htable->filled + 1) * 4 <= htable->size * 3)
+		return;
+
+	/* mostly tombstones: rehashing at the same size is enough */
+	if ((htable->count + 1) * 2 <= htable->size)
+		table_rehash (htable, htable->bits);
+	else
+		table_rehash (htable, htable->bits + 1);
 }
 
 extern hashTable *hashTableNew    (unsigned int size,
@@ -162,10 +205,14 @@ extern hashTable *hashTableNew    (unsigned int size,
 				   hashTableDeleteFunc valfreefn)
 {
 	hashTable *htable;
+	unsigned int bits = HTABLE_MIN_BITS;
+
+	/* the size was the number of chains, make room for as many items */
+	while ((1U << bits) * 3 < size * 4 && bits < 31)
+		bits++;
 
 	htable = xMalloc (1, hashTable);
-	htable->size = size;
-	htable->table = xCalloc (size, hentry*);
+	table_alloc (htable, bits);
 
 	htable->hashfn = hashfn;
 	htable->equalfn = equalfn;
@@ -209,49 +256,56 @@ extern void       hashTableClear (hashTable *htable)
 
 	for (i = 0; i < htable->size; i++)
 	{
-		hentry *entry;
+		hentry *entry = &htable->table[i];
 
-		entry = htable->table[i];
-		entry_reclaim (entry, htable->keyfreefn, htable->valfreefn);
-		htable->table[i] = NULL;
+		if (entry->state == HENTRY_USED)
+			entry_reset (entry, NULL, NULL, htable->keyfreefn, htable->valfreefn);
+		entry->state = HENTRY_FREE;
 	}
+	htable->count = 0;
+	htable->filled = 0;
 }
 
 extern void       hashTablePutItem    (hashTable *htable, void *key, void *value)
 {
-	unsigned int i;
-
-	i = htable->hashfn (key) % htable->size;
-	htable->table[i] = entry_new(key, value, htable->table[i]);
+	table_reserve (htable);
+	entry_insert (htable, key, value, htable->hashfn (key));
 }
 
 extern void*      hashTableGetItem   (hashTable *htable, const void * key)
 {
-	unsigned int i;
+	hentry *entry = entry_find (htable, key, htable->hashfn (key));
 
-	i = htable->hashfn (key) % htable->size;
-	return entry_find(htable->table[i], key, htable->equalfn, htable->valForNotUnknownKey);
+	return entry? entry->value: htable->valForNotUnknownKey;
 }
 
 extern bool     hashTableDeleteItem (hashTable *htable, const void *key)
 {
-	unsigned int i;
+	hentry *entry = entry_find (htable, key, htable->hashfn (key));
 
-	i = htable->hashfn (key) % htable->size;
-	return entry_delete(&htable->table[i], key,
-			    htable->equalfn, htable->keyfreefn, htable->valfreefn);
+	if (!entry)
+		return false;
+
+	entry_reset (entry, NULL, NULL, htable->keyfreefn, htable->valfreefn);
+	entry->state = HENTRY_DELETED;
+	htable->count--;
+	return true;
 }
 
 extern bool    hashTableUpdateItem (hashTable *htable, void *key, void *value)
 {
-	unsigned int i;
+	unsigned int hash = htable->hashfn (key);
+	hentry *entry = entry_find (htable, key, hash);
 
-	i = htable->hashfn (key) % htable->size;
-	bool r = entry_update(htable->table[i], key, value,
-						  htable->equalfn, htable->keyfreefn, htable->valfreefn);
-	if (!r)
-		htable->table[i] = entry_new(key, value, htable->table[i]);
-	return r;
+	if (entry)
+	{
+		entry_reset (entry, key, value, htable->keyfreefn, htable->valfreefn);
+		return true;
+	}
+
+	table_reserve (htable);
+	entry_insert (htable, key, value, hash);
+	return false;
 }
 
 extern bool    hashTableHasItem    (hashTable *htable, const void *key)
@@ -264,18 +318,11 @@ extern bool       hashTableForeachItem (hashTable *htable, hashTableForeachFunc
 	unsigned int i;
 
 	for (i = 0; i < htable->size; i++)
-		if (!entry_foreach(htable->table[i], proc, user_data))
-			return false;
-	return true;
-}
-
-static bool track_chain (const void *const key, void *value, void *chain_data)
-{
-	struct chainTracker *chain_tracker = chain_data;
-
-	if (chain_tracker->equalfn (chain_tracker->target_key, key))
 	{
-		if (! chain_tracker->user_proc (key, value, chain_tracker->user_data))
+		hentry *entry = &htable->table[i];
+
+		if (entry->state == HENTRY_USED
+			&& !proc (entry->key, entry->value, user_data))
 			return false;
 	}
 	return true;
@@ -283,32 +330,25 @@ static bool track_chain (const void *const key, void *value, void *chain_data)
 
 extern bool       hashTableForeachItemOnChain (hashTable *htable, const void *key, hashTableForeachFunc proc, void *user_data)
 {
+	unsigned int hash = htable->hashfn (key);
 	unsigned int i;
-	struct chainTracker chain_tracker = {
-		.target_key = key,
-		.user_proc = proc,
-		.user_data = user_data,
-		.equalfn   = htable->equalfn,
-	};
-
-	i = htable->hashfn (key) % htable->size;
-	if (!entry_foreach(htable->table[i], track_chain, &chain_tracker))
-		return false;
-	return true;
-}
 
-static bool count (const void *const key CTAGS_ATTR_UNUSED, void *value CTAGS_ATTR_UNUSED, void *data)
-{
-	int *c = data;
-	++*c;
+	for (i = slot_first (htable, hash);
+		 htable->table[i].state != HENTRY_FREE;
+		 i = slot_next (htable, i))
+	{
+		hentry *entry = &htable->table[i];
+
+		if (entry_matches (htable, entry, key, hash)
+			&& !proc (entry->key, entry->value, user_data))
+			return false;
+	}
 	return true;
 }
 
 extern unsigned int hashTableCountItem   (hashTable *htable)
 {
-	int c = 0;
-	hashTableForeachItem (htable, count, &c);
-	return c;
+	return htable->count;
 }
 
 unsigned int hashPtrhash (const void * const x)
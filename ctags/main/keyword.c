@@ -27,6 +27,7 @@
 typedef struct sHashEntry {
 	struct sHashEntry *next;
 	const char *string;
+	unsigned int hash;
 	langType language;
 	int value;
 } hashEntry;
@@ -98,12 +99,13 @@ static unsigned int hashValue (const char *const string, langType language,
 }
 
 static hashEntry *newEntry (
-		const char *const string, langType language, int value)
+		const char *const string, unsigned int hash, langType language, int value)
 {
 	hashEntry *const entry = xMalloc (1, hashEntry);
 
 	entry->next     = NULL;
 	entry->string   = string;
+	entry->hash     = hash;
 	entry->language = language;
 	entry->value    = value;
 
@@ -118,7 +120,8 @@ static hashEntry *newEntry (
 extern void addKeyword (const char *const string, langType language, int value)
 {
 	bool dummy;
-	const unsigned int index = hashValue (string, language, 1000, &dummy) % TableSize;
+	const unsigned int hash = hashValue (string, language, 1000, &dummy);
+	const unsigned int index = hash % TableSize;
 	hashEntry *entry = getHashTableEntry (index);
 	size_t len = strlen (string);
 
@@ -128,7 +131,7 @@ extern void addKeyword (const char *const string, langType language, int value)
 	if (entry == NULL)
 	{
 		hashEntry **const table = getHashTable ();
-		table [index] = newEntry (string, language, value);
+		table [index] = newEntry (string, hash, language, value);
 	}
 	else
 	{
@@ -147,7 +150,7 @@ extern void addKeyword (const char *const string, langType language, int value)
 		if (entry == NULL)
 		{
 			Assert (prev != NULL);
-			prev->next = newEntry (string, language, value);
+			prev->next = newEntry (string, hash, language, value);
 		}
 	}
 }
@@ -155,7 +158,8 @@ extern void addKeyword (const char *const string, langType language, int value)
 static int lookupKeywordFull (const char *const string, bool caseSensitive, langType language)
 {
 	bool maxLenReached;
-	const unsigned int index = hashValue (string, language, MaxEntryLen, &maxLenReached) % TableSize;
+	const unsigned int hash = hashValue (string, language, MaxEntryLen, &maxLenReached);
+	const unsigned int index = hash % TableSize;
 	hashEntry *entry;
 	int result = KEYWORD_NONE;
 
@@ -166,7 +170,8 @@ static int lookupKeywordFull (const char *const string, bool caseSensitive, lang
 
 	while (entry != NULL)
 	{
-		if (language == entry->language &&
+		/* the hash ignores the case, so it can be compared first */
+		if (hash == entry->hash && language == entry->language &&
 			((caseSensitive && strcmp (string, entry->string) == 0) ||
 			 (!caseSensitive && strcasecmp (string, entry->string) == 0)))
 		{
@@ -100,6 +100,11 @@ static regexCompiledCode compile (struct regexBackend *backend,
 			   buffer);
 		return (regexCompiledCode) { .backend = NULL, .code = NULL };
 	}
+
+	/* pcre2_match() uses the JIT compiled code when available and falls
+	 * back to the interpreter when JIT isn't supported on this platform */
+	pcre2_jit_compile (regex_code, PCRE2_JIT_COMPLETE);
+
 	return (regexCompiledCode) { .backend = &pcre2RegexBackend, .code = regex_code };
 }
 
@@ -107,6 +112,7 @@ static int match (struct regexBackend *backend,
 				  void *code, const char *input, size_t size,
 				  regmatch_t pmatch[BACK_REFERENCE_COUNT])
 {
+	/* shared by all patterns so matching doesn't allocate */
 	static pcre2_match_data *match_data;
 	if (match_data == NULL)
 	{
@@ -63,7 +63,13 @@ static bool regexAvailable = false;
    Tmain cases. */
 #define MTABLE_MOTIONLESS_MAX (MTABLE_STACK_MAX_DEPTH + 1)
 
+#ifdef HAVE_PCRE2
+/* pcre2 patterns are JIT compiled, which makes matching much faster.
+ * Posix extended regular expressions are also valid pcre2 patterns. */
+#define DEFAULT_REGEX_BACKEND "p"
+#else
 #define DEFAULT_REGEX_BACKEND "e"
+#endif
 
 /*
 *   DATA DECLARATIONS
@@ -165,6 +171,12 @@ typedef struct {
 
 	char *pattern_string;
 
+	/* A literal every line matching the pattern must contain, used to
+	 * reject lines before running the regex engine at all. */
+	char *required_literal;
+	size_t required_literal_len;
+	bool required_literal_at_start;
+
 	char *anonymous_tag_prefix;
 
 	struct {
@@ -309,6 +321,9 @@ static void deletePattern (regexPattern *p)
 
 	eFree (p->pattern_string);
 
+	if (p->required_literal)
+		eFree (p->required_literal);
+
 	if (p->message.message_string)
 		eFree (p->message.message_string);
 
@@ -1413,7 +1428,8 @@ static struct flagDefsDescriptor choose_backend (const char *flags, enum regexPa
 }
 
 static regexCompiledCode compileRegex (enum regexParserType regptype,
-									   const char* const regexp, const char* const flags)
+									   const char* const regexp, const char* const flags,
+									   bool *plainExtended)
 {
 	struct flagDefsDescriptor desc = choose_backend (flags, regptype, false);
 
@@ -1428,9 +1444,196 @@ static regexCompiledCode compileRegex (enum regexParserType regptype,
 			   ARRAY_SIZE (backendCommonRegexFlagDefs),
 			   &desc);
 
+	/* true if the code is going to be a case sensitive POSIX extended
+	 * regex run by the Posix backend (which isn't the default one with pcre2) */
+	struct flagDefsDescriptor extendedDesc = choose_backend ("e", regptype, false);
+	*plainExtended = (desc.backend == extendedDesc.backend
+					  && (desc.flags & REG_EXTENDED)
+					  && !(desc.flags & REG_ICASE));
+
 	return desc.backend->compile (desc.backend, regexp, desc.flags);
 }
 
+static void commitLiteralRun (vString *run, bool runAtStart,
+							  vString *best, bool *bestAtStart)
+{
+	if (vStringLength (run) > vStringLength (best))
+	{
+		vStringCopy (best, run);
+		*bestAtStart = runAtStart;
+	}
+	vStringClear (run);
+}
+
+/* Extracts the longest run of literal characters that any string matched by
+ * the POSIX extended regex must contain.  Only the top level of the pattern
+ * is considered, so a pattern with a top level alternation gives nothing.
+ * If the literal must be found at the beginning of the line, *atStart is
+ * set.  Returns NULL if no useful literal is found. */
+static char *extractRequiredLiteral (const char *regex, size_t *len, bool *atStart)
+{
+	vString *run = vStringNew ();
+	vString *best = vStringNew ();
+	bool runAtStart = false;
+	bool lastIsLiteral = false;
+	int depth = 0;
+	const char *p = regex;
+
+	*atStart = false;
+
+	if (*p == '^')
+	{
+		runAtStart = true;
+		p++;
+	}
+
+	while (*p != '\0')
+	{
+		char c = *p++;
+
+		if (c == '[')
+		{
+			/* bracket expressions: skip up to the closing ']' */
+			if (*p == '^')
+				p++;
+			if (*p == ']')
+				p++;
+			while (*p != '\0' && *p != ']')
+			{
+				if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+				{
+					char kind = p[1];
+
+					p += 2;
+					while (*p != '\0' && !(*p == kind && p[1] == ']'))
+						p++;
+					if (*p == '\0')
+						goto fail;
+					p += 2;
+				}
+				else
+					p++;
+			}
+			if (*p == '\0')
+				goto fail;
+			p++;
+			c = '\0';
+		}
+		else if (c == '\\')
+		{
+			if (*p == '\0')
+				goto fail;
+			c = *p++;
+			/* other escapes are either classes, anchors or back references */
+			if (!strchr (".[]()*+?{}|^$\\", c))
+				c = '\0';
+		}
+		else if (c == '(')
+		{
+			if (depth++ == 0)
+			{
+				commitLiteralRun (run, runAtStart, best, atStart);
+				runAtStart = false;
+				lastIsLiteral = false;
+			}
+			continue;
+		}
+		else if (c == ')')
+		{
+			if (depth == 0)
+				goto fail;
+			depth--;
+			c = '\0';
+		}
+		else if (c == '|')
+		{
+			if (depth == 0)
+				goto fail;
+			continue;
+		}
+		else if (c == '*' || c == '?' || c == '{' || c == '+')
+		{
+			if (c == '{')
+			{
+				while (*p != '\0' && *p != '}')
+					p++;
+				if (*p == '\0')
+					goto fail;
+				p++;
+			}
+			/* all but '+' make the quantified character optional */
+			if (c != '+' && lastIsLiteral && depth == 0)
+				vStringTruncate (run, vStringLength (run) - 1);
+			c = '\0';
+		}
+		else if (c == '.' || c == '^' || c == '$')
+			c = '\0';
+
+		if (depth > 0)
+			continue;
+
+		if (c == '\0')
+		{
+			commitLiteralRun (run, runAtStart, best, atStart);
+			runAtStart = false;
+			lastIsLiteral = false;
+		}
+		else
+		{
+			vStringPut (run, c);
+			lastIsLiteral = true;
+		}
+	}
+
+	if (depth != 0)
+		goto fail;
+
+	commitLiteralRun (run, runAtStart, best, atStart);
+	vStringDelete (run);
+
+	if (vStringLength (best) == 0)
+	{
+		vStringDelete (best);
+		return NULL;
+	}
+
+	*len = vStringLength (best);
+	return vStringDeleteUnwrap (best);
+
+fail:
+	vStringDelete (run);
+	vStringDelete (best);
+	*atStart = false;
+	return NULL;
+}
+
+static void setRequiredLiteral (regexPattern *ptrn, const char *regex)
+{
+	ptrn->required_literal = extractRequiredLiteral (regex,
+													 &ptrn->required_literal_len,
+													 &ptrn->required_literal_at_start);
+}
+
+static bool lineMayMatchPattern (const regexPattern *patbuf, const vString *const line)
+{
+	const char *literal = patbuf->required_literal;
+	const size_t len = patbuf->required_literal_len;
+	const char *s = vStringValue (line);
+	const char *end = s + vStringLength (line);
+
+	if (patbuf->required_literal_at_start)
+		return vStringLength (line) >= len && memcmp (s, literal, len) == 0;
+
+	while ((size_t) (end - s) >= len
+		   && (s = memchr (s, literal[0], (end - s) - len + 1)) != NULL)
+	{
+		if (memcmp (s, literal, len) == 0)
+			return true;
+		s++;
+	}
+	return false;
+}
+
 
 /* If a letter and/or a name are defined in kindSpec, return true. */
 static bool parseKinds (
@@ -1808,6 +2011,12 @@ static bool matchRegexPattern (struct lregexControlBlock *lcb,
 	if (patbuf->disabled && *(patbuf->disabled))
 		return false;
 
+	if (patbuf->required_literal && !lineMayMatchPattern (patbuf, line))
+	{
+		entry->statistics.unmatch++;
+		return false;
+	}
+
 	match = patbuf->pattern.backend->match (patbuf->pattern.backend,
 											patbuf->pattern.code, vStringValue (line),
 											vStringLength (line),
@@ -2121,7 +2330,8 @@ static regexPattern *addTagRegexInternal (struct lregexControlBlock *lcb,
 	if (!regexAvailable)
 		return NULL;
 
-	regexCompiledCode cp = compileRegex (regptype, regex, flags);
+	bool plainExtended;
+	regexCompiledCode cp = compileRegex (regptype, regex, flags, &plainExtended);
 	if (cp.code == NULL)
 	{
 		error (WARNING, "pattern: %s", regex);
@@ -2205,6 +2415,8 @@ static regexPattern *addTagRegexInternal (struct lregexControlBlock *lcb,
 												explictly_defined,
 												disabled);
 	rptr->pattern_string = escapeRegexPattern(regex);
+	if (regptype == REG_PARSER_SINGLE_LINE && plainExtended)
+		setRequiredLiteral (rptr, regex);
 
 	eFree (kindName);
 	if (description)
@@ -2273,7 +2485,8 @@ extern void addCallbackRegex (struct lregexControlBlock *lcb,
 		return;
 
 
-	regexCompiledCode cp = compileRegex (REG_PARSER_SINGLE_LINE, regex, flags);
+	bool plainExtended;
+	regexCompiledCode cp = compileRegex (REG_PARSER_SINGLE_LINE, regex, flags, &plainExtended);
 	if (cp.code == NULL)
 	{
 		error (WARNING, "pattern: %s", regex);
@@ -2284,6 +2497,8 @@ extern void addCallbackRegex (struct lregexControlBlock *lcb,
 	regexPattern *rptr = addCompiledCallbackPattern (lcb, &cp, callback, flags,
 													 disabled, userData);
 	rptr->pattern_string = escapeRegexPattern(regex);
+	if (plainExtended)
+		setRequiredLiteral (rptr, regex);
 }
 
 static void addTagRegexOption (struct lregexControlBlock *lcb,
@@ -3040,6 +3255,11 @@ static EsObject *scriptRead (OptVM *vm, const char *src)
 	EsObject *obj = optscriptRead (vm, src + 1, len - 1 - 1);
 	if (es_error_p (obj))
 		error (FATAL, "failed in loading an optscript: %s", src);
+
+	/* Like PostScript's bind, replace the names of the built-in operators
+	 * with the operators themselves, so evaluating the code doesn't look
+	 * them up in the dictionary stack each time. */
+	opt_vm_bind (vm, obj);
 	return obj;
 }
 
@@ -43,6 +43,12 @@
 #include <stdlib.h>
 #include <limits.h>
 
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #ifndef _MSC_VER
 #define MAY_HAVE_FTRUNCATE
 #include <unistd.h>
@@ -155,6 +161,7 @@ struct _MIO {
 			size_t allocated_size;
 			MIOReallocFunc realloc_func;
 			MIODestroyNotify free_func;
+			bool mapped;
 			bool error;
 			bool eof;
 		} mem;
@@ -336,6 +343,7 @@ MIO *mio_new_memory (unsigned char *data,
 		mio->impl.mem.allocated_size = size;
 		mio->impl.mem.realloc_func = realloc_func;
 		mio->impl.mem.free_func = free_func;
+		mio->impl.mem.mapped = false;
 		mio->impl.mem.eof = false;
 		mio->impl.mem.error = false;
 		mio->refcount = 1;
@@ -346,6 +354,56 @@ MIO *mio_new_memory (unsigned char *data,
 	return mio;
 }
 
+#ifdef HAVE_MMAP
+/**
+ * mio_new_mmap:
+ * @filename: Filename to open
+ *
+ * Creates a new read-only #MIO object working on memory, mapping the whole
+ * content of @filename instead of reading it. Since the mapping is private,
+ * writes within the current data only affect the stream, but the stream cannot
+ * grow.
+ *
+ * Empty files and files that are not regular ones cannot be mapped.
+ *
+ * Free-function: mio_unref()
+ *
+ * Returns: A new #MIO on success, or %NULL on failure.
+ */
+MIO *mio_new_mmap (const char *filename)
+{
+	MIO *mio = NULL;
+	struct stat st;
+	int fd;
+
+	fd = open (filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+	{
+		size_t size = (size_t) st.st_size;
+		void *data;
+
+		data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+#ifdef MADV_SEQUENTIAL
+			madvise (data, size, MADV_SEQUENTIAL);
+#endif
+			mio = mio_new_memory (data, size, NULL, NULL);
+			if (mio)
+				mio->impl.mem.mapped = true;
+			else
+				munmap (data, size);
+		}
+	}
+	close (fd);
+
+	return mio;
+}
+#endif
+
 /**
  * mio_new_mio:
  * @base: The original mio
@@ -503,8 +561,13 @@ int mio_unref (MIO *mio)
 		}
 		else if (mio->type == MIO_TYPE_MEMORY)
 		{
+#ifdef HAVE_MMAP
+			if (mio->impl.mem.mapped)
+				munmap (mio->impl.mem.buf, mio->impl.mem.allocated_size);
+#endif
 			if (mio->impl.mem.free_func)
 				mio->impl.mem.free_func (mio->impl.mem.buf);
+			mio->impl.mem.mapped = false;
 			mio->impl.mem.buf = NULL;
 			mio->impl.mem.pos = 0;
 			mio->impl.mem.size = 0;
@@ -1045,6 +1108,64 @@ char *mio_gets (MIO *mio, char *s, size_t size)
 	}
 }
 
+/**
+ * mio_memory_gets:
+ * @mio: A #MIO object
+ * @length: Return location for the length of the line
+ *
+ * Reads a line from a memory #MIO stream without copying it, stopping after
+ * the first new-line character or at the end of the stream. The returned line
+ * includes the new-line character if any and is not NUL-terminated.
+ *
+ * If the stream is not a memory one or a character pushed back with
+ * mio_ungetc() differs from the one in the buffer, %NULL is returned without
+ * changing the end-of-stream indicator, and mio_gets() should be used instead.
+ *
+ * <warning><para>The returned pointer becomes invalid under the same conditions
+ * as the one returned by mio_memory_get_data().</para></warning>
+ *
+ * Returns: A pointer to the line inside the stream data on success, %NULL
+ *          otherwise.
+ */
+const char *mio_memory_gets (MIO *mio, size_t *length)
+{
+	const unsigned char *line;
+	const unsigned char *nl;
+	size_t pos;
+	size_t left;
+
+	if (mio->type != MIO_TYPE_MEMORY)
+		return NULL;
+
+	pos = mio->impl.mem.pos;
+	if (mio->impl.mem.ungetch != EOF)
+	{
+		if (mio->impl.mem.buf[pos] != (unsigned char) mio->impl.mem.ungetch)
+			return NULL;
+		mio->impl.mem.ungetch = EOF;
+	}
+
+	if (pos >= mio->impl.mem.size)
+	{
+		mio->impl.mem.eof = true;
+		return NULL;
+	}
+
+	line = mio->impl.mem.buf + pos;
+	left = mio->impl.mem.size - pos;
+	nl = memchr (line, '\n', left);
+	if (nl)
+		*length = (size_t) (nl - line) + 1;
+	else
+	{
+		*length = left;
+		mio->impl.mem.eof = true;
+	}
+	mio->impl.mem.pos = pos + *length;
+
+	return (const char *) line;
+}
+
 /**
  * mio_clearerr:
  * @mio: A #MIO object
@@ -621,6 +621,16 @@ static MIO *getMioFull (const char *const fileName, const char *const openMode,
 	if (mtime)
 		*mtime = st->mtime;
 	eStatFree (st);
+#ifdef HAVE_MMAP
+	/* Map big files rather than reading them through stdio or copying
+	 * them to memory. */
+	if (size > MAX_IN_MEMORY_FILE_SIZE)
+	{
+		MIO *mio = mio_new_mmap (fileName);
+		if (mio)
+			return mio;
+	}
+#endif
 	if ((!memStreamRequired)
 	    && (size > MAX_IN_MEMORY_FILE_SIZE || size == 0))
 		return mio_new_file (fileName, openMode);
@@ -847,12 +857,30 @@ typedef enum eEolType {
 
 static eolType readLine (vString *const vLine, MIO *const mio)
 {
+	const char *line;
 	char *str;
 	size_t size;
 	eolType r = eol_nl;
 
 	vStringClear (vLine);
 
+	/* Fast path for memory streams: take the whole line at once. */
+	line = mio_memory_gets (mio, &size);
+	if (line || mio_eof (mio))
+	{
+		if (line)
+			vStringNCatSUnsafe (vLine, line, size);
+		if (mio_eof (mio))
+			r = eol_eof;
+		else if (size > 1 && line[size - 2] == '\r')
+		{
+			vStringChar (vLine, vStringLength (vLine) - 2) = '\n';
+			vStringChop (vLine);
+			r = eol_cr_nl;
+		}
+		return r;
+	}
+
 	str = vStringValue (vLine);
 	size = vStringSize (vLine);
 
@@ -981,6 +1009,23 @@ extern int getcFromInputFile (void)
 	return c;
 }
 
+/* Returns the part of the current line getcFromInputFile () has not read yet,
+ * terminated by '\0', or NULL if characters were ungotten or no line is
+ * being read.  This lets callers scan runs of characters without one call
+ * per character; skipCharsInInputFile () then consumes what they took. */
+extern const unsigned char *getRestOfLineFromInputFile (void)
+{
+	if (File.ungetchIdx > 0)
+		return NULL;
+	return File.currentLine;
+}
+
+extern void skipCharsInInputFile (size_t count)
+{
+	Assert (File.ungetchIdx == 0 && File.currentLine != NULL);
+	File.currentLine += count;
+}
+
 /* returns the nth previous character (0 meaning current), or def if nth cannot
  * be accessed.  Note that this can't access previous line data. */
 extern int getNthPrevCFromInputFile (unsigned int nth, int def)
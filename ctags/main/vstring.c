@@ -26,6 +26,15 @@
 */
 static const size_t vStringInitialSize = 32;
 
+/* Deleted strings kept for vStringNew() when recycling is enabled. Strings
+ * whose buffer grew above the limit are not kept to bound the memory held
+ * between parses. */
+#define VSTRING_POOL_SIZE 512
+#define VSTRING_POOL_MAX_BUFFER_SIZE 1024
+static vString *vStringPool [VSTRING_POOL_SIZE];
+static unsigned int vStringPoolCount = 0;
+static bool vStringPoolEnabled = false;
+
 /*
 *   FUNCTION DEFINITIONS
 */
@@ -61,6 +70,14 @@ extern void vStringDelete (vString *const string)
 {
 	if (string != NULL)
 	{
+		if (vStringPoolEnabled && string->buffer != NULL
+			&& string->size <= VSTRING_POOL_MAX_BUFFER_SIZE
+			&& vStringPoolCount < VSTRING_POOL_SIZE)
+		{
+			vStringPool [vStringPoolCount++] = string;
+			return;
+		}
+
 		if (string->buffer != NULL)
 			eFree (string->buffer);
 		eFree (string);
@@ -69,7 +86,16 @@ extern void vStringDelete (vString *const string)
 
 extern vString *vStringNew (void)
 {
-	vString *const string = xMalloc (1, vString);
+	vString *string;
+
+	if (vStringPoolCount > 0)
+	{
+		string = vStringPool [--vStringPoolCount];
+		vStringClear (string);
+		return string;
+	}
+
+	string = xMalloc (1, vString);
 
 	string->length = 0;
 	string->size   = vStringInitialSize;
@@ -80,6 +106,24 @@ extern vString *vStringNew (void)
 	return string;
 }
 
+/* When enabled, deleted strings are recycled by vStringNew() instead of
+ * being freed, so an application parsing many inputs in the same process
+ * doesn't allocate the same strings again for each of them. */
+extern void vStringRecycle (bool enable)
+{
+	vStringPoolEnabled = enable;
+	if (enable)
+		return;
+
+	while (vStringPoolCount > 0)
+	{
+		vString *const string = vStringPool [--vStringPoolCount];
+
+		eFree (string->buffer);
+		eFree (string);
+	}
+}
+
 extern vString *vStringNewCopy (const vString *const string)
 {
 	vString *vs = vStringNew ();
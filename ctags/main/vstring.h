@@ -56,6 +56,7 @@ typedef struct sVString {
 extern void vStringResize (vString *const string, const size_t newSize);
 extern vString *vStringNew (void);
 extern void vStringDelete (vString *const string);
+extern void vStringRecycle (bool enable);
 extern bool vStringStripNewline (vString *const string);
 extern void vStringStripLeading (vString *const string);
 extern void vStringChop (vString *const string);
@@ -1675,6 +1675,80 @@ process:
 	return c;
 }
 
+static bool isPlainRunChar (const int c, const bool identifier)
+{
+	if (! identifier)
+		return isspacetab (c);
+
+	/* "R" may start a raw string literal: let cppGetc () check it. */
+	if (c == 'R' && Cpp.hasCxxRawLiteralStrings)
+		return false;
+	return cppIsascii (c) && (isalnum (c) || c == '_' || c == '$');
+}
+
+/* A hex digit followed by a quote is a digit separator cppGetc () skips. */
+static bool isPlainRunCharFollowedBy (const int c, const int next)
+{
+	return ! (isxdigit (c) && (next == SINGLE_QUOTE || next == '\0'));
+}
+
+/*  Reads the run of identifier characters (or spaces and tabs) following the
+ *  current position straight from the input line, rather than through
+ *  cppGetc () one character at a time.  These are returned unchanged by
+ *  cppGetc (), and the run stops before anything it has to look at more
+ *  closely, at the end of the line and at pending macro expansions, so
+ *  the caller just continues with cppGetc () afterwards.
+ */
+static void readPlainRun (const bool identifier, vString *const name)
+{
+	const unsigned char *line = getRestOfLineFromInputFile ();
+	size_t n = 0;
+
+	if (Cpp.ungetPointer)
+	{
+		int c = *(Cpp.ungetPointer);
+
+		if (Cpp.ungetDataSize != 1 || ! isPlainRunChar (c, identifier)
+			|| ! isPlainRunCharFollowedBy (c, line ? line [0] : '\0'))
+			return;
+
+		Cpp.ungetPointer = NULL;
+		Cpp.ungetDataSize = 0;
+		if (name)
+			vStringPut (name, c);
+		if (identifier)
+			Cpp.directive.accept = false;
+	}
+
+	if (! line)
+		return;
+
+	while (isPlainRunChar (line [n], identifier)
+		   && isPlainRunCharFollowedBy (line [n], line [n + 1]))
+		n++;
+
+	if (n == 0)
+		return;
+
+	if (Cpp.macroInUse)
+		cppClearMacroInUse (&Cpp.macroInUse);
+	if (name)
+		vStringNCatSUnsafe (name, (const char *) line, n);
+	if (identifier)
+		Cpp.directive.accept = false;
+	skipCharsInInputFile (n);
+}
+
+extern void cppCollectIdentifierChars (vString *const name)
+{
+	readPlainRun (true, name);
+}
+
+extern void cppSkipBlanks (void)
+{
+	readPlainRun (false, NULL);
+}
+
 static void findCppTags (void)
 {
 	cppInitCommon (Cpp.lang, 0, false, false, false,
@@ -95,6 +95,8 @@ extern void cppUngetc (const int c);
 extern int cppUngetBufferSize();
 extern void cppUngetString(const char * string,int len);
 extern int cppGetc (void);
+extern void cppCollectIdentifierChars (vString *const name);
+extern void cppSkipBlanks (void);
 extern const vString * cppGetLastCharOrStringContents (void);
 
 /* Notify the external parser state for the purpose of conditional
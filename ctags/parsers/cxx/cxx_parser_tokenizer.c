@@ -29,7 +29,10 @@
 static void cxxParserSkipToNonWhiteSpace(void)
 {
 	while(cppIsspace(g_cxx.iChar))
+	{
+		cppSkipBlanks();
 		g_cxx.iChar = cppGetc();
+	}
 }
 
 enum CXXCharType
@@ -1312,6 +1315,8 @@ bool cxxParserParseNextToken(void)
 			if(!(uInfo & CXXCharTypePartOfIdentifier))
 				break;
 			vStringPut(t->pszWord,g_cxx.iChar);
+			// take the rest of the run from the input line in one go
+			cppCollectIdentifierChars(t->pszWord);
 			g_cxx.iChar = cppGetc();
 		}
 
@@ -0,0 +1,19 @@
+dnl GEANY_CHECK_PCRE2
+dnl Check for libpcre2-8 to use it for the regex based ctags parsers
+dnl
+AC_DEFUN([GEANY_CHECK_PCRE2],
+[
+	AC_ARG_ENABLE([pcre2],
+			[AS_HELP_STRING([--enable-pcre2],
+					[use the JIT compiling PCRE2 library for the regex based ctags parsers [default=no]])],
+			[geany_enable_pcre2="$enableval"],
+			[geany_enable_pcre2="no"])
+
+	AM_CONDITIONAL(ENABLE_PCRE2, [test "x$geany_enable_pcre2" = "xyes"])
+	AM_COND_IF(ENABLE_PCRE2,
+	[
+		PKG_CHECK_MODULES(PCRE2, libpcre2-8)
+		AC_DEFINE([HAVE_PCRE2], [1], [Define if PCRE2 is used for the ctags regex parsers])
+	])
+	GEANY_STATUS_ADD([Use PCRE2 for ctags regex parsers], [$geany_enable_pcre2])
+])
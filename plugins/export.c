@@ -25,10 +25,14 @@
 #endif
 
 #include <ctype.h>
+#include <errno.h>
 #include <math.h>
+#include <string.h>
 
 #include "geanyplugin.h"
 
+#include <glib/gstdio.h>
+
 
 GeanyData		*geany_data;
 
@@ -99,6 +103,22 @@ enum
 	DATE_TYPE_HTML
 };
 
+/* number of characters read from Scintilla at once */
+#define EXPORT_CHUNK_SIZE 65536
+/* how much output is collected before it's written to the file */
+#define EXPORT_BUFFER_SIZE 65536
+
+/* reads the characters and their styles in chunks rather than asking Scintilla
+ * for each position */
+typedef struct
+{
+	ScintillaObject *sci;
+	gint doc_len;
+	gint start;		/* document position of the first character in buf */
+	gint len;		/* number of characters in buf */
+	gchar *buf;		/* pairs of character and style as returned by SCI_GETSTYLEDTEXT */
+} StyledText;
+
 typedef void (*ExportFunc) (GeanyDocument *doc, const gchar *filename,
 	gboolean use_zoom, gboolean insert_line_numbers);
 typedef struct
@@ -269,9 +289,8 @@ static void on_menu_create_html_activate(GtkMenuItem *menuitem, gpointer user_da
 }
 
 
-static void write_data(const gchar *filename, const gchar *data)
+static void show_result(const gchar *filename, gint error_nr)
 {
-	gint error_nr = utils_write_file(filename, data);
 	gchar *utf8_filename = utils_get_utf8_from_locale(filename);
 
 	if (error_nr == 0)
@@ -342,6 +361,89 @@ static void on_file_save_dialog_response(GtkDialog *dialog, gint response, gpoin
 }
 
 
+/* Opens filename and writes the part of template before {export_content}, the rest is left
+ * in template for close_file(). */
+static FILE *open_file(const gchar *filename, GString *template)
+{
+	const gchar *content = strstr(template->str, "{export_content}");
+	FILE *fp;
+
+	g_return_val_if_fail(content != NULL, NULL);
+
+	errno = 0;
+	fp = g_fopen(filename, "w");
+	if (fp == NULL)
+	{
+		show_result(filename, errno ? errno : EIO);
+		return NULL;
+	}
+
+	fwrite(template->str, sizeof(gchar), content - template->str, fp);
+	g_string_erase(template, 0, content - template->str + strlen("{export_content}"));
+	return fp;
+}
+
+
+static void write_buffer(FILE *fp, GString *buffer)
+{
+	fwrite(buffer->str, sizeof(gchar), buffer->len, fp);
+	g_string_truncate(buffer, 0);
+}
+
+
+/* writes the rest of the template and reports whether everything could be written */
+static void close_file(FILE *fp, const gchar *filename, GString *template)
+{
+	gint error_nr = 0;
+
+	write_buffer(fp, template);
+	if (ferror(fp))
+		error_nr = errno ? errno : EIO;
+	if (fclose(fp) != 0 && error_nr == 0)
+		error_nr = errno ? errno : EIO;
+
+	show_result(filename, error_nr);
+}
+
+
+static void styled_text_init(StyledText *text, ScintillaObject *sci)
+{
+	text->sci = sci;
+	text->doc_len = sci_get_length(sci);
+	text->start = 0;
+	text->len = 0;
+	text->buf = g_malloc(2 * EXPORT_CHUNK_SIZE + 2);
+}
+
+
+/* Returns: the character at pos and its style in style, or 0 for both if pos is too high,
+ * like sci_get_char_at() and sci_get_style_at() */
+static gchar styled_text_get(StyledText *text, gint pos, gint *style)
+{
+	if (pos < text->start || pos >= text->start + text->len)
+	{
+		struct Sci_TextRange tr;
+
+		if (pos < 0 || pos >= text->doc_len)
+		{
+			*style = 0;
+			return 0;
+		}
+
+		text->start = pos;
+		text->len = MIN(EXPORT_CHUNK_SIZE, text->doc_len - pos);
+		tr.chrg.cpMin = pos;
+		tr.chrg.cpMax = pos + text->len;
+		tr.lpstrText = text->buf;
+		scintilla_send_message(text->sci, SCI_GETSTYLEDTEXT, 0, (sptr_t) &tr);
+	}
+
+	pos = (pos - text->start) * 2;
+	*style = (guchar) text->buf[pos + 1];
+	return text->buf[pos];
+}
+
+
 /* returns the "width" (count of needed characters) for the given number */
 static gint get_line_numbers_arity(gint line_number)
 {
@@ -362,14 +464,16 @@ static gint get_line_number_width(GeanyDocument *doc)
 static void write_latex_file(GeanyDocument *doc, const gchar *filename,
 	gboolean use_zoom, gboolean insert_line_numbers)
 {
-	GeanyEditor *editor = doc->editor;
 	ScintillaObject *sci = doc->editor->sci;
-	gint i, doc_len, style = -1, old_style = 0, column = 0;
+	gint i, style = -1, style_next, old_style = 0, column = 0;
 	gint k, line_number, line_number_width, line_number_max_width = 0, pad;
+	gint tab_width = sci_get_tab_width(sci);
 	gchar c, c_next, *tmp, *date;
 	/* 0 - fore, 1 - back, 2 - bold, 3 - italic, 4 - font size, 5 - used(0/1) */
 	gint styles[STYLE_MAX + 1][MAX_TYPES];
 	gboolean block_open = FALSE;
+	StyledText text;
+	FILE *fp;
 	GString *body;
 	GString *cmds;
 	GString *latex;
@@ -387,14 +491,74 @@ static void write_latex_file(GeanyDocument *doc, const gchar *filename,
 	if (insert_line_numbers)
 		line_number_max_width = get_line_number_width(doc);
 
+	/* find the used styles first as they are written before the LaTeX code */
+	styled_text_init(&text, sci);
+	for (i = 0; i < text.doc_len; i++)
+	{
+		c = styled_text_get(&text, i, &style);
+		styles[style][USED] = 1;
+		/* two spaces are written at once, see below */
+		if (c == ' ' && styled_text_get(&text, i + 1, &style_next) == ' ')
+			i++;
+	}
+
+	/* force writing of style 0 (used at least for line breaks) */
+	styles[0][USED] = 1;
+
+	/* write used styles in the header */
+	cmds = g_string_new("");
+	for (i = 0; i < STYLE_MAX; i++)
+	{
+		if (styles[i][USED])
+		{
+			g_string_append_printf(cmds,
+				"\\newcommand{\\style%s}[1]{\\noindent{", get_tex_style(i));
+			if (styles[i][BOLD])
+				g_string_append(cmds, "\\textbf{");
+			if (styles[i][ITALIC])
+				g_string_append(cmds, "\\textit{");
+
+			tmp = get_tex_rgb(styles[i][FORE]);
+			g_string_append_printf(cmds, "\\textcolor[rgb]{%s}{", tmp);
+			g_free(tmp);
+			tmp = get_tex_rgb(styles[i][BACK]);
+			g_string_append_printf(cmds, "\\fcolorbox[rgb]{0, 0, 0}{%s}{", tmp);
+			g_string_append(cmds, "#1}}");
+			g_free(tmp);
+
+			if (styles[i][BOLD])
+				g_string_append_c(cmds, '}');
+			if (styles[i][ITALIC])
+				g_string_append_c(cmds, '}');
+			g_string_append(cmds, "}}\n");
+		}
+	}
+
+	date = get_date(DATE_TYPE_DEFAULT);
+	latex = g_string_new(TEMPLATE_LATEX);
+	utils_string_replace_all(latex, "{export_styles}", cmds->str);
+	utils_string_replace_all(latex, "{export_date}", date);
+	utils_string_replace_all(latex, "{export_filename}", DOC_FILENAME(doc));
+	g_string_free(cmds, TRUE);
+	g_free(date);
+
+	fp = open_file(filename, latex);
+	if (fp == NULL)
+	{
+		g_string_free(latex, TRUE);
+		g_free(text.buf);
+		return;
+	}
+
 	/* read the document and write the LaTeX code */
-	body = g_string_new("");
-	doc_len = sci_get_length(sci);
-	for (i = 0; i < doc_len; i++)
+	body = g_string_sized_new(EXPORT_BUFFER_SIZE);
+	for (i = 0; i < text.doc_len; i++)
 	{
-		style = sci_get_style_at(sci, i);
-		c = sci_get_char_at(sci, i);
-		c_next = sci_get_char_at(sci, i + 1);
+		if (body->len >= EXPORT_BUFFER_SIZE)
+			write_buffer(fp, body);
+
+		c = styled_text_get(&text, i, &style);
+		c_next = styled_text_get(&text, i + 1, &style_next);
 
 		/* line numbers */
 		if (insert_line_numbers && column == 0)
@@ -413,17 +577,13 @@ static void write_latex_file(GeanyDocument *doc, const gchar *filename,
 		if (style != old_style || ! block_open)
 		{
 			old_style = style;
-			styles[style][USED] = 1;
 			if (block_open)
 			{
 				g_string_append(body, "}\n");
 				block_open = FALSE;
 			}
-			if (i < doc_len)
-			{
-				g_string_append_printf(body, "\\style%s{", get_tex_style(style));
-				block_open = TRUE;
-			}
+			g_string_append_printf(body, "\\style%s{", get_tex_style(style));
+			block_open = TRUE;
 		}
 		/* escape the current character if necessary else just add it */
 		switch (c)
@@ -445,7 +605,6 @@ static void write_latex_file(GeanyDocument *doc, const gchar *filename,
 			}
 			case '\t':
 			{
-				gint tab_width = sci_get_tab_width(editor->sci);
 				gint tab_stop = tab_width - (column % tab_width);
 
 				column += tab_stop - 1; /* -1 because we add 1 at the end of the loop */
@@ -509,63 +668,23 @@ static void write_latex_file(GeanyDocument *doc, const gchar *filename,
 		g_string_append(body, "}\n");
 		block_open = FALSE;
 	}
+	write_buffer(fp, body);
 
-	/* force writing of style 0 (used at least for line breaks) */
-	styles[0][USED] = 1;
-
-	/* write used styles in the header */
-	cmds = g_string_new("");
-	for (i = 0; i < STYLE_MAX; i++)
-	{
-		if (styles[i][USED])
-		{
-			g_string_append_printf(cmds,
-				"\\newcommand{\\style%s}[1]{\\noindent{", get_tex_style(i));
-			if (styles[i][BOLD])
-				g_string_append(cmds, "\\textbf{");
-			if (styles[i][ITALIC])
-				g_string_append(cmds, "\\textit{");
-
-			tmp = get_tex_rgb(styles[i][FORE]);
-			g_string_append_printf(cmds, "\\textcolor[rgb]{%s}{", tmp);
-			g_free(tmp);
-			tmp = get_tex_rgb(styles[i][BACK]);
-			g_string_append_printf(cmds, "\\fcolorbox[rgb]{0, 0, 0}{%s}{", tmp);
-			g_string_append(cmds, "#1}}");
-			g_free(tmp);
-
-			if (styles[i][BOLD])
-				g_string_append_c(cmds, '}');
-			if (styles[i][ITALIC])
-				g_string_append_c(cmds, '}');
-			g_string_append(cmds, "}}\n");
-		}
-	}
-
-	date = get_date(DATE_TYPE_DEFAULT);
-	/* write all */
-	latex = g_string_new(TEMPLATE_LATEX);
-	utils_string_replace_all(latex, "{export_content}", body->str);
-	utils_string_replace_all(latex, "{export_styles}", cmds->str);
-	utils_string_replace_all(latex, "{export_date}", date);
-	utils_string_replace_all(latex, "{export_filename}", DOC_FILENAME(doc));
-
-	write_data(filename, latex->str);
+	close_file(fp, filename, latex);
 
 	g_string_free(body, TRUE);
-	g_string_free(cmds, TRUE);
 	g_string_free(latex, TRUE);
-	g_free(date);
+	g_free(text.buf);
 }
 
 
 static void write_html_file(GeanyDocument *doc, const gchar *filename,
 	gboolean use_zoom, gboolean insert_line_numbers)
 {
-	GeanyEditor *editor = doc->editor;
 	ScintillaObject *sci = doc->editor->sci;
-	gint i, doc_len, style = -1, old_style = 0, column = 0;
+	gint i, style = -1, style_next, old_style = 0, column = 0;
 	gint k, line_number, line_number_width, line_number_max_width = 0, pad;
+	gint tab_width = sci_get_tab_width(sci);
 	gchar c, c_next, *date, *doc_filename;
 	/* 0 - fore, 1 - back, 2 - bold, 3 - italic, 4 - font size, 5 - used(0/1) */
 	gint styles[STYLE_MAX + 1][MAX_TYPES];
@@ -573,6 +692,8 @@ static void write_html_file(GeanyDocument *doc, const gchar *filename,
 	const gchar *font_name;
 	gint font_size;
 	PangoFontDescription *font_desc;
+	StyledText text;
+	FILE *fp;
 	GString *body;
 	GString *css;
 	GString *html;
@@ -599,15 +720,63 @@ static void write_html_file(GeanyDocument *doc, const gchar *filename,
 	if (insert_line_numbers)
 		line_number_max_width = get_line_number_width(doc);
 
+	/* find the used styles first as they are written before the HTML body,
+	 * only non-space characters open a span */
+	styled_text_init(&text, sci);
+	for (i = 0; i < text.doc_len; i++)
+	{
+		c = styled_text_get(&text, i, &style);
+		if (! isspace(c))
+			styles[style][USED] = 1;
+	}
+
+	/* write used styles in the header */
+	css = g_string_new("");
+	g_string_append_printf(css,
+	"\tbody\n\t{\n\t\tfont-family: %s, monospace;\n\t\tfont-size: %dpt;\n\t}\n",
+				font_name, font_size);
+
+	for (i = 0; i < STYLE_MAX; i++)
+	{
+		if (styles[i][USED])
+		{
+			g_string_append_printf(css,
+	"\t.style_%d\n\t{\n\t\tcolor: #%06x;\n\t\tbackground-color: #%06x;\n%s%s\t}\n",
+				i, styles[i][FORE], styles[i][BACK],
+				(styles[i][BOLD]) ? "\t\tfont-weight: bold;\n" : "",
+				(styles[i][ITALIC]) ? "\t\tfont-style: italic;\n" : "");
+		}
+	}
+	pango_font_description_free(font_desc);
+
+	date = get_date(DATE_TYPE_HTML);
+	doc_filename = g_markup_escape_text(DOC_FILENAME(doc), -1);
+	html = g_string_new(TEMPLATE_HTML);
+	utils_string_replace_all(html, "{export_date}", date);
+	utils_string_replace_all(html, "{export_styles}", css->str);
+	utils_string_replace_all(html, "{export_filename}", doc_filename);
+	g_string_free(css, TRUE);
+	g_free(doc_filename);
+	g_free(date);
+
+	fp = open_file(filename, html);
+	if (fp == NULL)
+	{
+		g_string_free(html, TRUE);
+		g_free(text.buf);
+		return;
+	}
+
 	/* read the document and write the HTML body */
-	body = g_string_new("");
-	doc_len = sci_get_length(sci);
-	for (i = 0; i < doc_len; i++)
+	body = g_string_sized_new(EXPORT_BUFFER_SIZE);
+	for (i = 0; i < text.doc_len; i++)
 	{
-		style = sci_get_style_at(sci, i);
-		c = sci_get_char_at(sci, i);
-		/* sci_get_char_at() takes care of index boundaries and return 0 if i is too high */
-		c_next = sci_get_char_at(sci, i + 1);
+		if (body->len >= EXPORT_BUFFER_SIZE)
+			write_buffer(fp, body);
+
+		c = styled_text_get(&text, i, &style);
+		/* styled_text_get() takes care of index boundaries and returns 0 if i is too high */
+		c_next = styled_text_get(&text, i + 1, &style_next);
 
 		/* line numbers */
 		if (insert_line_numbers && column == 0)
@@ -626,16 +795,12 @@ static void write_html_file(GeanyDocument *doc, const gchar *filename,
 		if ((style != old_style || ! span_open) && ! isspace(c))
 		{
 			old_style = style;
-			styles[style][USED] = 1;
 			if (span_open)
 			{
 				g_string_append(body, "</span>");
 			}
-			if (i < doc_len)
-			{
-				g_string_append_printf(body, "<span class=\"style_%d\">", style);
-				span_open = TRUE;
-			}
+			g_string_append_printf(body, "<span class=\"style_%d\">", style);
+			span_open = TRUE;
 		}
 		/* escape the current character if necessary else just add it */
 		switch (c)
@@ -658,7 +823,6 @@ static void write_html_file(GeanyDocument *doc, const gchar *filename,
 			case '\t':
 			{
 				gint j;
-				gint tab_width = sci_get_tab_width(editor->sci);
 				gint tab_stop = tab_width - (column % tab_width);
 
 				column += tab_stop - 1; /* -1 because we add 1 at the end of the loop */
@@ -697,42 +861,13 @@ static void write_html_file(GeanyDocument *doc, const gchar *filename,
 		g_string_append(body, "</span>");
 		span_open = FALSE;
 	}
+	write_buffer(fp, body);
 
-	/* write used styles in the header */
-	css = g_string_new("");
-	g_string_append_printf(css,
-	"\tbody\n\t{\n\t\tfont-family: %s, monospace;\n\t\tfont-size: %dpt;\n\t}\n",
-				font_name, font_size);
+	close_file(fp, filename, html);
 
-	for (i = 0; i < STYLE_MAX; i++)
-	{
-		if (styles[i][USED])
-		{
-			g_string_append_printf(css,
-	"\t.style_%d\n\t{\n\t\tcolor: #%06x;\n\t\tbackground-color: #%06x;\n%s%s\t}\n",
-				i, styles[i][FORE], styles[i][BACK],
-				(styles[i][BOLD]) ? "\t\tfont-weight: bold;\n" : "",
-				(styles[i][ITALIC]) ? "\t\tfont-style: italic;\n" : "");
-		}
-	}
-
-	date = get_date(DATE_TYPE_HTML);
-	doc_filename = g_markup_escape_text(DOC_FILENAME(doc), -1);
-	/* write all */
-	html = g_string_new(TEMPLATE_HTML);
-	utils_string_replace_all(html, "{export_date}", date);
-	utils_string_replace_all(html, "{export_content}", body->str);
-	utils_string_replace_all(html, "{export_styles}", css->str);
-	utils_string_replace_all(html, "{export_filename}", doc_filename);
-
-	write_data(filename, html->str);
-
-	pango_font_description_free(font_desc);
 	g_string_free(body, TRUE);
-	g_string_free(css, TRUE);
 	g_string_free(html, TRUE);
-	g_free(doc_filename);
-	g_free(date);
+	g_free(text.buf);
 }
 
 
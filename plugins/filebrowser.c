@@ -31,8 +31,6 @@
 #include <gdk/gdkkeysyms.h>
 
 #ifdef G_OS_WIN32
-# include <windows.h>
-
 # define OPEN_CMD "explorer \"%d\""
 #elif defined(__APPLE__)
 # define OPEN_CMD "open \"%d\""
@@ -65,9 +63,32 @@ enum
 	FILEVIEW_COLUMN_NAME,
 	FILEVIEW_COLUMN_FILENAME, /* the full filename, including path for display as tooltip */
 	FILEVIEW_COLUMN_IS_DIR,
+	FILEVIEW_COLUMN_ENTRY, /* the FileEntry of the row, NULL for ".." */
 	FILEVIEW_N_COLUMNS
 };
 
+
+/* number of files read from the directory at once */
+#define ENUMERATE_BATCH_SIZE 500
+
+#define ENUMERATE_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN
+
+
+/* a file of current_dir, kept so that filtering doesn't need to read the directory again */
+typedef struct
+{
+	gchar *name;		/* UTF-8 */
+	gchar *filename;	/* the full filename in UTF-8 */
+	gchar *key;			/* for sorting */
+	GIcon *icon;		/* owned by icon_cache */
+	gboolean dir;
+	gboolean hidden;
+} FileEntry;
+
 static gboolean fb_set_project_base_path = FALSE;
 static gboolean fb_follow_path = FALSE;
 static gboolean show_hidden_files = FALSE;
@@ -76,7 +97,9 @@ static gboolean hide_object_files = TRUE;
 static GtkWidget *file_view_vbox;
 static GtkWidget *file_view;
 static GtkListStore *file_store;
-static GtkTreeIter *last_dir_iter = NULL;
+static GPtrArray *file_entries = NULL;
+static GCancellable *enumerate_cancellable = NULL;
+static GHashTable *icon_cache = NULL; /* content type -> GIcon */
 static GtkEntryCompletion *entry_completion = NULL;
 
 static GtkWidget *filter_combo;
@@ -110,27 +133,13 @@ PluginCallback plugin_callbacks[] =
 };
 
 
-#ifdef G_OS_WIN32
-static gboolean win32_check_hidden(const gchar *filename)
-{
-	DWORD attrs;
-	static wchar_t w_filename[MAX_PATH];
-	MultiByteToWideChar(CP_UTF8, 0, filename, -1, w_filename, sizeof(w_filename));
-	attrs = GetFileAttributesW(w_filename);
-	if (attrs != INVALID_FILE_ATTRIBUTES && attrs & FILE_ATTRIBUTE_HIDDEN)
-		return TRUE;
-	return FALSE;
-}
-#endif
-
-
 /* Returns: whether name should be hidden. */
-static gboolean check_hidden(const gchar *filename, const gchar *base_name)
+static gboolean check_hidden(GFileInfo *info, const gchar *base_name)
 {
 	gsize len;
 
 #ifdef G_OS_WIN32
-	if (win32_check_hidden(filename))
+	if (g_file_info_get_is_hidden(info))
 		return TRUE;
 #else
 	if (base_name[0] == '.')
@@ -180,94 +189,134 @@ static gboolean check_filtered(const gchar *base_name)
 }
 
 
-static GIcon *get_icon(const gchar *fname)
+/* Returns: the icon for files of content type ctype, owned by the icon cache.
+ * Looking icons up in the theme is slow, so it's only done once per content type. */
+static GIcon *get_icon(const gchar *ctype)
 {
-	GIcon *icon = NULL;
-	gchar *ctype;
-
-	ctype = g_content_type_guess(fname, NULL, 0, NULL);
+	GIcon *icon;
 
-	if (ctype)
+	if (!icon_cache)
 	{
+		icon_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+		g_hash_table_insert(icon_cache, g_strdup("inode/directory"), g_themed_icon_new("folder"));
+	}
+
+	if (!ctype)
+		ctype = "";
+
+	icon = g_hash_table_lookup(icon_cache, ctype);
+	if (icon)
+		return icon;
+
+	if (*ctype)
 		icon = g_content_type_get_icon(ctype);
-		if (icon)
+	if (icon)
+	{
+		GtkIconInfo *icon_info;
+
+		icon_info = gtk_icon_theme_lookup_by_gicon(gtk_icon_theme_get_default(), icon, 16, 0);
+		if (!icon_info)
 		{
-			GtkIconInfo *icon_info;
-
-			icon_info = gtk_icon_theme_lookup_by_gicon(gtk_icon_theme_get_default(), icon, 16, 0);
-			if (!icon_info)
-			{
-				g_object_unref(icon);
-				icon = NULL;
-			}
-			else
-				gtk_icon_info_free(icon_info);
+			g_object_unref(icon);
+			icon = NULL;
 		}
-		g_free(ctype);
+		else
+			gtk_icon_info_free(icon_info);
 	}
 
 	if (!icon)
 		icon = g_themed_icon_new("text-x-generic");
 
+	g_hash_table_insert(icon_cache, g_strdup(ctype), icon);
 	return icon;
 }
 
 
-/* name is in locale encoding */
-static void add_item(const gchar *name)
+static FileEntry *file_entry_new(GFileInfo *info)
 {
-	GtkTreeIter iter;
-	gchar *fname, *utf8_name, *utf8_fullname;
+	const gchar *name = g_file_info_get_name(info); /* in locale encoding */
 	const gchar *sep;
-	gboolean dir;
-	GIcon *icon;
+	FileEntry *entry;
+	gchar *fname;
 
 	if (G_UNLIKELY(EMPTY(name)))
-		return;
+		return NULL;
+
+	entry = g_new0(FileEntry, 1);
 
 	/* root directory doesn't need separator */
 	sep = (utils_str_equal(current_dir, "/")) ? "" : G_DIR_SEPARATOR_S;
 	fname = g_strconcat(current_dir, sep, name, NULL);
-	dir = g_file_test(fname, G_FILE_TEST_IS_DIR);
-	utf8_fullname = utils_get_utf8_from_locale(fname);
-	utf8_name = utils_get_utf8_from_locale(name);
+	entry->filename = utils_get_utf8_from_locale(fname);
+	entry->name = utils_get_utf8_from_locale(name);
 	g_free(fname);
 
-	if (! show_hidden_files && check_hidden(utf8_fullname, utf8_name))
-		goto done;
-
-	if (dir)
-	{
-		if (last_dir_iter == NULL)
-			gtk_list_store_prepend(file_store, &iter);
-		else
-		{
-			gtk_list_store_insert_after(file_store, &iter, last_dir_iter);
-			gtk_tree_iter_free(last_dir_iter);
-		}
-		last_dir_iter = gtk_tree_iter_copy(&iter);
-	}
+	if (g_utf8_validate(entry->name, -1, NULL))
+		entry->key = g_utf8_strdown(entry->name, -1);
 	else
-	{
-		if (! show_hidden_files && hide_object_files && check_object(utf8_name))
-			goto done;
-		if (check_filtered(utf8_name))
-			goto done;
+		entry->key = g_strdup(entry->name);
 
-		gtk_list_store_append(file_store, &iter);
-	}
+	entry->dir = g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY;
+	entry->hidden = check_hidden(info, entry->name);
+	entry->icon = get_icon(entry->dir ? "inode/directory" :
+		g_file_info_get_attribute_string(info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE));
 
-	icon = dir ? g_themed_icon_new("folder") : get_icon(utf8_name);
-	gtk_list_store_set(file_store, &iter,
-		FILEVIEW_COLUMN_ICON, icon,
-		FILEVIEW_COLUMN_NAME, utf8_name,
-		FILEVIEW_COLUMN_FILENAME, utf8_fullname,
-		FILEVIEW_COLUMN_IS_DIR, dir,
+	return entry;
+}
+
+
+static void file_entry_free(gpointer data)
+{
+	FileEntry *entry = data;
+
+	g_free(entry->name);
+	g_free(entry->filename);
+	g_free(entry->key);
+	g_free(entry);
+}
+
+
+static gboolean check_visible(FileEntry *entry)
+{
+	if (! show_hidden_files && entry->hidden)
+		return FALSE;
+
+	if (entry->dir)
+		return TRUE;
+
+	if (! show_hidden_files && hide_object_files && check_object(entry->name))
+		return FALSE;
+	return ! check_filtered(entry->name);
+}
+
+
+static void add_item(FileEntry *entry)
+{
+	GtkTreeIter iter;
+
+	gtk_list_store_insert_with_values(file_store, &iter, -1,
+		FILEVIEW_COLUMN_ICON, entry->icon,
+		FILEVIEW_COLUMN_NAME, entry->name,
+		FILEVIEW_COLUMN_FILENAME, entry->filename,
+		FILEVIEW_COLUMN_IS_DIR, entry->dir,
+		FILEVIEW_COLUMN_ENTRY, entry,
 		-1);
-	g_object_unref(icon);
-done:
-	g_free(utf8_name);
-	g_free(utf8_fullname);
+}
+
+
+/* ".." first, then the directories and then the other files, each sorted by name */
+static gint compare_items(GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b, gpointer data)
+{
+	FileEntry *entry_a, *entry_b;
+
+	gtk_tree_model_get(model, a, FILEVIEW_COLUMN_ENTRY, &entry_a, -1);
+	gtk_tree_model_get(model, b, FILEVIEW_COLUMN_ENTRY, &entry_b, -1);
+
+	if (!entry_a || !entry_b)
+		return entry_a ? 1 : (entry_b ? -1 : 0);
+	if (entry_a->dir != entry_b->dir)
+		return entry_a->dir ? -1 : 1;
+	return strcmp(entry_a->key, entry_b->key);
 }
 
 
@@ -284,37 +333,118 @@ static void add_top_level_entry(void)
 	utf8_dir = g_path_get_dirname(current_dir);
 	SETPTR(utf8_dir, utils_get_utf8_from_locale(utf8_dir));
 
-	gtk_list_store_prepend(file_store, &iter);
-	last_dir_iter = gtk_tree_iter_copy(&iter);
-
-	icon = g_themed_icon_new("folder");
-	gtk_list_store_set(file_store, &iter,
+	icon = get_icon("inode/directory");
+	gtk_list_store_insert_with_values(file_store, &iter, 0,
 		FILEVIEW_COLUMN_ICON, icon,
 		FILEVIEW_COLUMN_NAME, "..",
 		FILEVIEW_COLUMN_FILENAME, utf8_dir,
 		FILEVIEW_COLUMN_IS_DIR, TRUE,
+		FILEVIEW_COLUMN_ENTRY, NULL,
 		-1);
-	g_object_unref(icon);
 	g_free(utf8_dir);
 }
 
 
+/* stops reading current_dir and forgets its files */
 static void clear(void)
 {
+	if (enumerate_cancellable)
+	{
+		g_cancellable_cancel(enumerate_cancellable);
+		g_object_unref(enumerate_cancellable);
+		enumerate_cancellable = NULL;
+	}
+
+	gtk_list_store_clear(file_store);
+	if (file_entries)
+		g_ptr_array_set_size(file_entries, 0);
+}
+
+
+/* recreate the tree model from the files of current_dir read so far, e.g. after the filter
+ * changed */
+static void refilter(void)
+{
+	guint i;
+
+	/* detach the model to avoid updating the view for every row */
+	g_object_ref(file_store);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(file_view), NULL);
+
 	gtk_list_store_clear(file_store);
+	add_top_level_entry();	/* ".." item */
+	for (i = 0; i < file_entries->len; i++)
+	{
+		FileEntry *entry = file_entries->pdata[i];
+
+		if (check_visible(entry))
+			add_item(entry);
+	}
 
-	/* reset the directory item pointer */
-	if (last_dir_iter != NULL)
-		gtk_tree_iter_free(last_dir_iter);
-	last_dir_iter = NULL;
+	gtk_tree_view_set_model(GTK_TREE_VIEW(file_view), GTK_TREE_MODEL(file_store));
+	g_object_unref(file_store);
 }
 
 
-/* recreate the tree model from current_dir. */
+static void on_next_files(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	GFileEnumerator *enumerator = G_FILE_ENUMERATOR(source);
+	GCancellable *cancellable = user_data;
+	GList *infos, *node;
+
+	infos = g_file_enumerator_next_files_finish(enumerator, result, NULL);
+
+	/* current_dir has been left or refreshed meanwhile */
+	if (g_cancellable_is_cancelled(cancellable) || !infos)
+	{
+		g_list_free_full(infos, g_object_unref);
+		g_object_unref(enumerator);
+		g_object_unref(cancellable);
+		return;
+	}
+
+	foreach_list(node, infos)
+	{
+		FileEntry *entry = file_entry_new(node->data);
+
+		if (!entry)
+			continue;
+
+		g_ptr_array_add(file_entries, entry);
+		if (check_visible(entry))
+			add_item(entry);
+	}
+	g_list_free_full(infos, g_object_unref);
+
+	g_file_enumerator_next_files_async(enumerator, ENUMERATE_BATCH_SIZE, G_PRIORITY_LOW,
+		cancellable, on_next_files, cancellable);
+}
+
+
+static void on_enumerate_children(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	GCancellable *cancellable = user_data;
+	GFileEnumerator *enumerator;
+
+	enumerator = g_file_enumerate_children_finish(G_FILE(source), result, NULL);
+	if (!enumerator || g_cancellable_is_cancelled(cancellable))
+	{
+		if (enumerator)
+			g_object_unref(enumerator);
+		g_object_unref(cancellable);
+		return;
+	}
+
+	g_file_enumerator_next_files_async(enumerator, ENUMERATE_BATCH_SIZE, G_PRIORITY_LOW,
+		cancellable, on_next_files, cancellable);
+}
+
+
+/* recreate the tree model from current_dir, which is read in the background. */
 static void refresh(void)
 {
 	gchar *utf8_dir;
-	GSList *list, *node;
+	GFile *file;
 
 	/* don't clear when the new path doesn't exist */
 	if (! g_file_test(current_dir, G_FILE_TEST_EXISTS))
@@ -330,19 +460,13 @@ static void refresh(void)
 
 	add_top_level_entry();	/* ".." item */
 
-	list = utils_get_file_list(current_dir, NULL, NULL);
-	if (list != NULL)
-	{
-		/* free filenames as we go through the list */
-		foreach_slist(node, list)
-		{
-			gchar *fname = node->data;
+	enumerate_cancellable = g_cancellable_new();
+	file = g_file_new_for_path(current_dir);
+	g_file_enumerate_children_async(file, ENUMERATE_ATTRIBUTES, G_FILE_QUERY_INFO_NONE,
+		G_PRIORITY_LOW, enumerate_cancellable, on_enumerate_children,
+		g_object_ref(enumerate_cancellable));
+	g_object_unref(file);
 
-			add_item(fname);
-			g_free(fname);
-		}
-		g_slist_free(list);
-	}
 	gtk_entry_completion_set_model(entry_completion, GTK_TREE_MODEL(file_store));
 }
 
@@ -632,7 +756,7 @@ static void on_find_in_files(GtkMenuItem *menuitem, gpointer user_data)
 static void on_hidden_files_clicked(GtkCheckMenuItem *item)
 {
 	show_hidden_files = gtk_check_menu_item_get_active(item);
-	refresh();
+	refilter();
 }
 
 
@@ -853,7 +977,7 @@ static void on_filter_activate(GtkEntry *entry, gpointer user_data)
 		clear_filter();
 	}
 	ui_combo_box_add_to_history(GTK_COMBO_BOX_TEXT(filter_combo), NULL, 0);
-	refresh();
+	refilter();
 }
 
 
@@ -861,7 +985,7 @@ static void on_filter_clear(GtkEntry *entry, gint icon_pos,
 							GdkEvent *event, gpointer data)
 {
 	clear_filter();
-	refresh();
+	refilter();
 }
 
 
@@ -871,7 +995,12 @@ static void prepare_file_view(void)
 	GtkTreeViewColumn *column;
 	GtkTreeSelection *selection;
 
-	file_store = gtk_list_store_new(FILEVIEW_N_COLUMNS, G_TYPE_ICON, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_BOOLEAN);
+	file_store = gtk_list_store_new(FILEVIEW_N_COLUMNS, G_TYPE_ICON, G_TYPE_STRING, G_TYPE_STRING,
+		G_TYPE_BOOLEAN, G_TYPE_POINTER);
+	gtk_tree_sortable_set_default_sort_func(GTK_TREE_SORTABLE(file_store), compare_items, NULL, NULL);
+	gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(file_store),
+		GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID, GTK_SORT_ASCENDING);
+	file_entries = g_ptr_array_new_with_free_func(file_entry_free);
 
 	gtk_tree_view_set_model(GTK_TREE_VIEW(file_view), GTK_TREE_MODEL(file_store));
 	g_object_unref(file_store);
@@ -1133,6 +1262,9 @@ void plugin_init(GeanyData *data)
 
 	filter = NULL;
 
+	/* directory reading may still be finishing in the background after unloading */
+	plugin_module_make_resident(geany_plugin);
+
 	file_view_vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
 	toolbar = make_toolbar();
 	gtk_box_pack_start(GTK_BOX(file_view_vbox), toolbar, FALSE, FALSE, 0);
@@ -1240,7 +1372,7 @@ on_configure_response(GtkDialog *dialog, gint response, gpointer user_data)
 			pref_widgets.set_project_base_path_checkbox));
 
 		/* apply the changes */
-		refresh();
+		refilter();
 	}
 }
 
@@ -1336,6 +1468,12 @@ void plugin_cleanup(void)
 	g_free(open_cmd);
 	g_free(hidden_file_extensions);
 	clear_filter();
+	clear();
 	gtk_widget_destroy(file_view_vbox);
 	g_object_unref(G_OBJECT(entry_completion));
+	g_ptr_array_free(file_entries, TRUE);
+	file_entries = NULL;
+	if (icon_cache)
+		g_hash_table_destroy(icon_cache);
+	icon_cache = NULL;
 }
@@ -55,6 +55,7 @@
 #include "search.h"
 #include "spawn.h"
 #include "stash.h"
+#include "stallwatch.h"
 #include "support.h"
 #include "symbols.h"
 #include "templates.h"
@@ -161,6 +161,7 @@ enum {
   FAILED,
   HANDLE_CALL,
   NOTIFICATION,
+  OUTPUT_DRAINED,
   N_SIGNALS
 };
 
@@ -363,6 +364,14 @@ jsonrpc_client_check_ready (JsonrpcClient  *self,
   return TRUE;
 }
 
+static void
+jsonrpc_client_output_drained (JsonrpcClient *self)
+{
+  g_assert (JSONRPC_IS_CLIENT (self));
+
+  g_signal_emit (self, signals [OUTPUT_DRAINED], 0);
+}
+
 static void
 jsonrpc_client_constructed (GObject *object)
 {
@@ -385,6 +394,12 @@ jsonrpc_client_constructed (GObject *object)
 
   priv->input_stream = jsonrpc_input_stream_new (input_stream);
   priv->output_stream = jsonrpc_output_stream_new (output_stream);
+
+  g_signal_connect_object (priv->output_stream,
+                           "drained",
+                           G_CALLBACK (jsonrpc_client_output_drained),
+                           self,
+                           G_CONNECT_SWAPPED);
 }
 
 static void
@@ -494,6 +509,23 @@ jsonrpc_client_class_init (JsonrpcClientClass *klass)
 
   g_object_class_install_properties (object_class, N_PROPS, properties);
 
+  /**
+   * JsonrpcClient::output-drained:
+   *
+   * The "output-drained" signal is emitted when all messages passed to the
+   * client so far have been written to the peer.
+   *
+   * Since: 3.44
+   */
+  signals [OUTPUT_DRAINED] =
+    g_signal_new ("output-drained",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 0);
+
   /**
    * JsonrpcClient::failed:
    *
@@ -1255,6 +1287,78 @@ jsonrpc_client_send_notification_async (JsonrpcClient       *self,
                                              g_steal_pointer (&task));
 }
 
+/**
+ * jsonrpc_client_send_notification_with_text_async:
+ * @self: A #JsonrpcClient
+ * @method: The name of the method to call
+ * @params: (transfer none): A [struct@GLib.Variant] of parameters
+ * @text: the text replacing %JSONRPC_MESSAGE_TEXT_PLACEHOLDER in @params
+ * @text_len: length of @text in bytes or -1 if nul-terminated
+ * @text_tail: (nullable): text following @text or %NULL
+ * @text_tail_len: length of @text_tail in bytes
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ *
+ * Like [method@Client.send_notification_async] but a string value
+ * %JSONRPC_MESSAGE_TEXT_PLACEHOLDER inside @params is replaced by @text
+ * followed by @text_tail which are escaped directly into the output buffer. This avoids several
+ * full copies of large payloads, such as document contents, which would
+ * otherwise be made while building and serializing the message.
+ *
+ * The text is consumed before this function returns.
+ *
+ * Since: 3.44
+ */
+void
+jsonrpc_client_send_notification_with_text_async (JsonrpcClient       *self,
+                                                  const gchar         *method,
+                                                  GVariant            *params,
+                                                  const gchar         *text,
+                                                  gssize               text_len,
+                                                  const gchar         *text_tail,
+                                                  gsize                text_tail_len,
+                                                  GCancellable        *cancellable,
+                                                  GAsyncReadyCallback  callback,
+                                                  gpointer             user_data)
+{
+  JsonrpcClientPrivate *priv = jsonrpc_client_get_instance_private (self);
+  g_autoptr(GVariant) message = NULL;
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantDict dict;
+
+  g_return_if_fail (JSONRPC_IS_CLIENT (self));
+  g_return_if_fail (method != NULL);
+  g_return_if_fail (params != NULL);
+  g_return_if_fail (text != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, jsonrpc_client_send_notification_async);
+
+  if (!jsonrpc_client_check_ready (self, &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_variant_dict_init (&dict, NULL);
+  g_variant_dict_insert (&dict, "jsonrpc", "s", "2.0");
+  g_variant_dict_insert (&dict, "method", "s", method);
+  g_variant_dict_insert_value (&dict, "params", params);
+
+  message = g_variant_take_ref (g_variant_dict_end (&dict));
+
+  jsonrpc_output_stream_write_message_with_text_async (priv->output_stream,
+                                                       message,
+                                                       text,
+                                                       text_len,
+                                                       text_tail,
+                                                       text_tail_len,
+                                                       cancellable,
+                                                       jsonrpc_client_send_notification_write_cb,
+                                                       g_steal_pointer (&task));
+}
+
 /**
  * jsonrpc_client_send_notification_finish:
  * @self: A #JsonrpcClient
@@ -124,6 +124,18 @@ void           jsonrpc_client_send_notification_async  (JsonrpcClient        *se
                                                         GCancellable         *cancellable,
                                                         GAsyncReadyCallback   callback,
                                                         gpointer              user_data);
+JSONRPC_AVAILABLE_IN_3_44
+void           jsonrpc_client_send_notification_with_text_async
+                                                       (JsonrpcClient        *self,
+                                                        const gchar          *method,
+                                                        GVariant             *params,
+                                                        const gchar          *text,
+                                                        gssize                text_len,
+                                                        const gchar          *text_tail,
+                                                        gsize                 text_tail_len,
+                                                        GCancellable         *cancellable,
+                                                        GAsyncReadyCallback   callback,
+                                                        gpointer              user_data);
 JSONRPC_AVAILABLE_IN_3_26
 gboolean       jsonrpc_client_send_notification_finish (JsonrpcClient        *self,
                                                         GAsyncResult         *result,
@@ -21,11 +21,11 @@
 #include "config.h"
 
 #include <errno.h>
-#include <json-glib/json-glib.h>
 #include <string.h>
 
 #include "jsonrpc-input-stream.h"
 #include "jsonrpc-input-stream-private.h"
+#include "jsonrpc-json-decoder-private.h"
 
 typedef struct
 {
@@ -42,6 +42,13 @@ typedef struct
   guint  has_seen_gvariant : 1;
 } JsonrpcInputStreamPrivate;
 
+/*
+ * Bodies at least this large are decoded in a worker thread so that big
+ * responses don't block the main loop. Smaller ones are decoded in place,
+ * since handing them over to a thread costs more than decoding them.
+ */
+#define THREADED_DECODE_MIN_LENGTH (32 * 1024)
+
 G_DEFINE_TYPE_WITH_PRIVATE (JsonrpcInputStream, jsonrpc_input_stream, G_TYPE_DATA_INPUT_STREAM)
 
 static gboolean jsonrpc_input_stream_debug;
@@ -82,6 +89,28 @@ jsonrpc_input_stream_new (GInputStream *base_stream)
                        NULL);
 }
 
+static void
+jsonrpc_input_stream_decode_worker (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  ReadState *state = task_data;
+  g_autoptr(GError) error = NULL;
+  GVariant *message;
+
+  /* the buffer is only accessed by this thread until the task returns */
+  message = _jsonrpc_json_decode (state->buffer, state->content_length, &error);
+  g_clear_pointer (&state->buffer, g_free);
+
+  if (message == NULL)
+    g_task_return_error (task, g_steal_pointer (&error));
+  else
+    g_task_return_pointer (task,
+                           g_variant_take_ref (message),
+                           (GDestroyNotify)g_variant_unref);
+}
+
 static void
 jsonrpc_input_stream_read_body_cb (GObject      *object,
                                    GAsyncResult *result,
@@ -120,6 +149,13 @@ jsonrpc_input_stream_read_body_cb (GObject      *object,
   if G_UNLIKELY (jsonrpc_input_stream_debug && state->use_gvariant == FALSE)
     g_message ("<<< %s", state->buffer);
 
+  if (!state->use_gvariant && state->content_length >= THREADED_DECODE_MIN_LENGTH)
+    {
+      /* the result is delivered to the main context the task was created in */
+      g_task_run_in_thread (task, jsonrpc_input_stream_decode_worker);
+      return;
+    }
+
   if (state->use_gvariant)
     {
       g_autoptr(GBytes) bytes = NULL;
@@ -137,7 +173,8 @@ jsonrpc_input_stream_read_body_cb (GObject      *object,
     }
   else
     {
-      message = json_gvariant_deserialize_data (state->buffer, state->content_length, NULL, &error);
+      /* decodes straight into GVariant, skipping the JsonNode tree */
+      message = _jsonrpc_json_decode (state->buffer, state->content_length, &error);
       g_clear_pointer (&state->buffer, g_free);
     }
 
@@ -0,0 +1,30 @@
+/* jsonrpc-json-decoder-private.h
+ *
+ * This file is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JSONRPC_JSON_DECODER_PRIVATE_H
+#define JSONRPC_JSON_DECODER_PRIVATE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+GVariant *_jsonrpc_json_decode (gchar   *json,
+                                gsize    length,
+                                GError **error) G_GNUC_INTERNAL;
+
+G_END_DECLS
+
+#endif /* JSONRPC_JSON_DECODER_PRIVATE_H */
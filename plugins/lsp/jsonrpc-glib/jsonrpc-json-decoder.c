@@ -0,0 +1,487 @@
+/* jsonrpc-json-decoder.c
+ *
+ * This file is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A JSON decoder producing GVariant directly, without building the
+ * intermediate JsonNode tree json_gvariant_deserialize_data() needs.
+ *
+ * The result has the same shape json_gvariant_deserialize() produces
+ * without a signature: objects become "a{sv}", arrays "av", integers "x",
+ * other numbers "d", booleans "b", strings "s" and null becomes an empty
+ * "mv".
+ *
+ * Strings are unescaped in place so the input buffer is modified, and it
+ * has to be NUL-terminated at @length.  Children of the containers being
+ * decoded are collected on a single shared stack so no per-container
+ * allocations happen besides the GVariants themselves.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <string.h>
+
+#include "jsonrpc-json-decoder-private.h"
+
+#define MAX_DEPTH 1024
+
+typedef struct
+{
+  gchar      *json;
+  gchar      *pos;
+  gchar      *end;
+  GPtrArray  *stack;
+  guint       depth;
+  GError    **error;
+} Decoder;
+
+static GVariant *decode_value (Decoder *d);
+
+static GVariant *
+decode_error (Decoder     *d,
+              const gchar *message)
+{
+  if (d->error != NULL && *d->error == NULL)
+    g_set_error (d->error,
+                 G_IO_ERROR,
+                 G_IO_ERROR_INVALID_DATA,
+                 "Invalid JSON at offset %"G_GSIZE_FORMAT": %s",
+                 (gsize)(d->pos - d->json),
+                 message);
+  return NULL;
+}
+
+static inline void
+skip_whitespace (Decoder *d)
+{
+  while (*d->pos == ' ' || *d->pos == '\n' || *d->pos == '\r' || *d->pos == '\t')
+    d->pos++;
+}
+
+static void
+drop_children (Decoder *d,
+               guint    start)
+{
+  guint i;
+
+  for (i = start; i < d->stack->len; i++)
+    g_variant_unref (g_variant_ref_sink (d->stack->pdata[i]));
+  g_ptr_array_set_size (d->stack, start);
+}
+
+static GVariant *
+take_children (Decoder            *d,
+               guint               start,
+               const GVariantType *child_type)
+{
+  GVariant *ret;
+
+  ret = g_variant_new_array (child_type,
+                             (GVariant **)&d->stack->pdata[start],
+                             d->stack->len - start);
+  g_ptr_array_set_size (d->stack, start);
+
+  return ret;
+}
+
+static gint
+decode_hex4 (const gchar *p)
+{
+  gint ret = 0;
+  guint i;
+
+  for (i = 0; i < 4; i++)
+    {
+      gint v = g_ascii_xdigit_value (p[i]);
+
+      if (v < 0)
+        return -1;
+      ret = (ret << 4) | v;
+    }
+
+  return ret;
+}
+
+/* Unescapes the string in place and returns a pointer to it, NUL-terminated.
+ * Escape sequences are never shorter than what they decode to so the output
+ * never overtakes the input. */
+static const gchar *
+decode_string (Decoder *d)
+{
+  gchar *start = ++d->pos;
+  gchar *p = start;
+  gchar *out;
+
+  while (*p != '"' && *p != '\\' && *p != '\0')
+    p++;
+
+  out = p;
+
+  while (*p != '"')
+    {
+      if (*p == '\0')
+        {
+          d->pos = p;
+          decode_error (d, "unterminated string");
+          return NULL;
+        }
+
+      if (*p != '\\')
+        {
+          *out++ = *p++;
+          continue;
+        }
+
+      p++;
+      switch (*p)
+        {
+        case '"':  *out++ = '"'; p++; break;
+        case '\\': *out++ = '\\'; p++; break;
+        case '/':  *out++ = '/'; p++; break;
+        case 'b':  *out++ = '\b'; p++; break;
+        case 'f':  *out++ = '\f'; p++; break;
+        case 'n':  *out++ = '\n'; p++; break;
+        case 'r':  *out++ = '\r'; p++; break;
+        case 't':  *out++ = '\t'; p++; break;
+
+        case 'u':
+          {
+            gint c = decode_hex4 (p + 1);
+
+            if (c < 0)
+              {
+                d->pos = p;
+                decode_error (d, "invalid \\u escape");
+                return NULL;
+              }
+            p += 5;
+
+            if (c >= 0xD800 && c <= 0xDBFF && p[0] == '\\' && p[1] == 'u')
+              {
+                gint low = decode_hex4 (p + 2);
+
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                  {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                  }
+              }
+
+            /* lone surrogates and NUL cannot be stored in a GVariant string */
+            if (c == 0 || (c >= 0xD800 && c <= 0xDFFF))
+              c = 0xFFFD;
+
+            out += g_unichar_to_utf8 (c, out);
+          }
+          break;
+
+        default:
+          d->pos = p;
+          decode_error (d, "invalid escape sequence");
+          return NULL;
+        }
+    }
+
+  *out = '\0';
+  d->pos = p + 1;
+
+  if (!g_utf8_validate (start, out - start, NULL))
+    {
+      d->pos = start;
+      decode_error (d, "invalid UTF-8 in string");
+      return NULL;
+    }
+
+  return start;
+}
+
+static GVariant *
+decode_number (Decoder *d)
+{
+  gchar *start = d->pos;
+  gchar *p = start;
+  gboolean negative = FALSE;
+  gboolean is_double = FALSE;
+  guint64 value = 0;
+  guint n_digits = 0;
+
+  if (*p == '-')
+    {
+      negative = TRUE;
+      p++;
+    }
+
+  if (!g_ascii_isdigit (*p))
+    return decode_error (d, "invalid number");
+
+  for (; g_ascii_isdigit (*p); p++, n_digits++)
+    value = value * 10 + (*p - '0');
+
+  if (*p == '.')
+    {
+      is_double = TRUE;
+      p++;
+      if (!g_ascii_isdigit (*p))
+        {
+          d->pos = p;
+          return decode_error (d, "invalid number");
+        }
+      while (g_ascii_isdigit (*p))
+        p++;
+    }
+
+  if (*p == 'e' || *p == 'E')
+    {
+      is_double = TRUE;
+      p++;
+      if (*p == '+' || *p == '-')
+        p++;
+      if (!g_ascii_isdigit (*p))
+        {
+          d->pos = p;
+          return decode_error (d, "invalid number");
+        }
+      while (g_ascii_isdigit (*p))
+        p++;
+    }
+
+  d->pos = p;
+
+  /* 18 digits always fit into gint64, longer integers fall back to double */
+  if (!is_double && n_digits <= 18)
+    return g_variant_new_int64 (negative ? -(gint64)value : (gint64)value);
+
+  return g_variant_new_double (g_ascii_strtod (start, NULL));
+}
+
+static GVariant *
+decode_array (Decoder *d)
+{
+  guint start = d->stack->len;
+
+  d->pos++;
+  skip_whitespace (d);
+
+  if (*d->pos != ']')
+    {
+      for (;;)
+        {
+          GVariant *child = decode_value (d);
+
+          if (child == NULL)
+            {
+              drop_children (d, start);
+              return NULL;
+            }
+
+          g_ptr_array_add (d->stack, g_variant_new_variant (child));
+
+          skip_whitespace (d);
+          if (*d->pos == ']')
+            break;
+          if (*d->pos != ',')
+            {
+              drop_children (d, start);
+              return decode_error (d, "expected ',' or ']'");
+            }
+          d->pos++;
+          skip_whitespace (d);
+        }
+    }
+
+  d->pos++;
+
+  return take_children (d, start, G_VARIANT_TYPE_VARIANT);
+}
+
+static GVariant *
+decode_object (Decoder *d)
+{
+  guint start = d->stack->len;
+
+  d->pos++;
+  skip_whitespace (d);
+
+  if (*d->pos != '}')
+    {
+      for (;;)
+        {
+          const gchar *key;
+          GVariant *key_variant;
+          GVariant *child;
+
+          if (*d->pos != '"')
+            {
+              drop_children (d, start);
+              return decode_error (d, "expected member name");
+            }
+
+          if (!(key = decode_string (d)))
+            {
+              drop_children (d, start);
+              return NULL;
+            }
+          key_variant = g_variant_new_string (key);
+
+          skip_whitespace (d);
+          if (*d->pos != ':')
+            {
+              g_variant_unref (g_variant_ref_sink (key_variant));
+              drop_children (d, start);
+              return decode_error (d, "expected ':'");
+            }
+          d->pos++;
+          skip_whitespace (d);
+
+          if (!(child = decode_value (d)))
+            {
+              g_variant_unref (g_variant_ref_sink (key_variant));
+              drop_children (d, start);
+              return NULL;
+            }
+
+          g_ptr_array_add (d->stack,
+                           g_variant_new_dict_entry (key_variant,
+                                                     g_variant_new_variant (child)));
+
+          skip_whitespace (d);
+          if (*d->pos == '}')
+            break;
+          if (*d->pos != ',')
+            {
+              drop_children (d, start);
+              return decode_error (d, "expected ',' or '}'");
+            }
+          d->pos++;
+          skip_whitespace (d);
+        }
+    }
+
+  d->pos++;
+
+  return take_children (d, start, G_VARIANT_TYPE ("{sv}"));
+}
+
+static gboolean
+decode_literal (Decoder     *d,
+                const gchar *literal,
+                gsize        len)
+{
+  if ((gsize)(d->end - d->pos) < len || strncmp (d->pos, literal, len) != 0)
+    return FALSE;
+
+  d->pos += len;
+  return TRUE;
+}
+
+static GVariant *
+decode_value (Decoder *d)
+{
+  GVariant *ret = NULL;
+  const gchar *str;
+
+  switch (*d->pos)
+    {
+    case '{':
+    case '[':
+      if (++d->depth > MAX_DEPTH)
+        return decode_error (d, "nesting too deep");
+      ret = *d->pos == '{' ? decode_object (d) : decode_array (d);
+      d->depth--;
+      return ret;
+
+    case '"':
+      if ((str = decode_string (d)))
+        ret = g_variant_new_string (str);
+      return ret;
+
+    case 't':
+      if (decode_literal (d, "true", 4))
+        return g_variant_new_boolean (TRUE);
+      break;
+
+    case 'f':
+      if (decode_literal (d, "false", 5))
+        return g_variant_new_boolean (FALSE);
+      break;
+
+    case 'n':
+      if (decode_literal (d, "null", 4))
+        return g_variant_new_maybe (G_VARIANT_TYPE_VARIANT, NULL);
+      break;
+
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+      return decode_number (d);
+
+    case '\0':
+      return decode_error (d, "unexpected end of data");
+
+    default:
+      break;
+    }
+
+  return decode_error (d, "unexpected character");
+}
+
+/**
+ * _jsonrpc_json_decode:
+ * @json: NUL-terminated JSON data, modified during decoding
+ * @length: the length of @json
+ * @error: a location for a #GError, or %NULL
+ *
+ * Returns: (transfer floating) (nullable): the decoded #GVariant
+ */
+GVariant *
+_jsonrpc_json_decode (gchar   *json,
+                      gsize    length,
+                      GError **error)
+{
+  Decoder d;
+  GVariant *ret;
+
+  g_return_val_if_fail (json != NULL, NULL);
+  g_return_val_if_fail (json[length] == '\0', NULL);
+
+  d.json = json;
+  d.pos = json;
+  d.end = json + length;
+  d.stack = g_ptr_array_new ();
+  d.depth = 0;
+  d.error = error;
+
+  /* skip UTF-8 BOM */
+  if (length >= 3 && memcmp (json, "\xEF\xBB\xBF", 3) == 0)
+    d.pos += 3;
+
+  skip_whitespace (&d);
+
+  if ((ret = decode_value (&d)))
+    {
+      skip_whitespace (&d);
+      if (d.pos != d.end)
+        {
+          g_variant_unref (g_variant_ref_sink (ret));
+          ret = decode_error (&d, "trailing data");
+        }
+    }
+
+  g_assert (d.stack->len == 0);
+  g_ptr_array_unref (d.stack);
+
+  return ret;
+}
@@ -67,7 +67,13 @@ enum {
   N_PROPS
 };
 
+enum {
+  DRAINED,
+  N_SIGNALS
+};
+
 static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
 static gboolean jsonrpc_output_stream_debug;
 
 static void
@@ -138,6 +144,23 @@ jsonrpc_output_stream_class_init (JsonrpcOutputStreamClass *klass)
 
   g_object_class_install_properties (object_class, N_PROPS, properties);
 
+  /**
+   * JsonrpcOutputStream::drained:
+   *
+   * The "drained" signal is emitted when all queued messages have been
+   * written to the underlying stream.
+   *
+   * Since: 3.44
+   */
+  signals [DRAINED] =
+    g_signal_new ("drained",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 0);
+
   jsonrpc_output_stream_debug = !!g_getenv ("JSONRPC_DEBUG");
 }
 
@@ -209,6 +232,153 @@ jsonrpc_output_stream_create_bytes (JsonrpcOutputStream  *self,
   return g_byte_array_free_to_bytes (g_steal_pointer (&buffer));
 }
 
+static gsize
+jsonrpc_output_stream_get_escaped_len (const gchar *text,
+                                       gsize        text_len)
+{
+  gsize ret = 0;
+
+  for (gsize i = 0; i < text_len; i++)
+    {
+      guchar c = text[i];
+
+      switch (c)
+        {
+        case '"': case '\\': case '\b': case '\f': case '\n': case '\r': case '\t':
+          ret += 2;
+          break;
+
+        default:
+          ret += c < 0x20 ? 6 : 1;
+          break;
+        }
+    }
+
+  return ret;
+}
+
+static void
+jsonrpc_output_stream_escape (guint8      *dest,
+                              const gchar *text,
+                              gsize        text_len)
+{
+  static const gchar hex[] = "0123456789abcdef";
+
+  for (gsize i = 0; i < text_len; i++)
+    {
+      guchar c = text[i];
+
+      switch (c)
+        {
+        case '"':  *dest++ = '\\'; *dest++ = '"'; break;
+        case '\\': *dest++ = '\\'; *dest++ = '\\'; break;
+        case '\b': *dest++ = '\\'; *dest++ = 'b'; break;
+        case '\f': *dest++ = '\\'; *dest++ = 'f'; break;
+        case '\n': *dest++ = '\\'; *dest++ = 'n'; break;
+        case '\r': *dest++ = '\\'; *dest++ = 'r'; break;
+        case '\t': *dest++ = '\\'; *dest++ = 't'; break;
+
+        default:
+          if (c < 0x20)
+            {
+              *dest++ = '\\';
+              *dest++ = 'u';
+              *dest++ = '0';
+              *dest++ = '0';
+              *dest++ = hex[c >> 4];
+              *dest++ = hex[c & 0xf];
+            }
+          else
+            *dest++ = c;
+          break;
+        }
+    }
+}
+
+/*
+ * Like jsonrpc_output_stream_create_bytes() but the string value
+ * JSONRPC_MESSAGE_TEXT_PLACEHOLDER inside @message gets replaced by @text
+ * followed by @text_tail which are escaped directly into the resulting
+ * buffer. This way large payloads such as whole documents don't have to be
+ * copied into the #GVariant, the intermediate #JsonNode tree and the
+ * serialized string before they reach the buffer.
+ */
+static GBytes *
+jsonrpc_output_stream_create_bytes_with_text (JsonrpcOutputStream  *self,
+                                              GVariant             *message,
+                                              const gchar          *text,
+                                              gsize                 text_len,
+                                              const gchar          *text_tail,
+                                              gsize                 text_tail_len,
+                                              GError              **error)
+{
+  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
+  static const gchar placeholder[] = "\"" JSONRPC_MESSAGE_TEXT_PLACEHOLDER "\"";
+  g_autoptr(GByteArray) buffer = NULL;
+  g_autofree gchar *json = NULL;
+  const gchar *placeholder_pos;
+  const gchar *suffix;
+  gsize json_len = 0;
+  gsize prefix_len;
+  gsize suffix_len;
+  gsize escaped_len;
+  gsize tail_escaped_len;
+  gchar header[256];
+  gsize len;
+
+  g_assert (JSONRPC_IS_OUTPUT_STREAM (self));
+  g_assert (message != NULL);
+
+  if (priv->use_gvariant)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_NOT_SUPPORTED,
+                           "Messages with raw text require JSON encoding");
+      return NULL;
+    }
+
+  json = json_gvariant_serialize_data (message, &json_len);
+  placeholder_pos = strstr (json, placeholder);
+
+  if (placeholder_pos == NULL)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_ARGUMENT,
+                           "Message does not contain text placeholder");
+      return NULL;
+    }
+
+  /* keep the quotes around the placeholder, replace only its contents */
+  prefix_len = placeholder_pos - json + 1;
+  suffix = placeholder_pos + sizeof placeholder - 2;
+  suffix_len = json_len - (suffix - json);
+  escaped_len = jsonrpc_output_stream_get_escaped_len (text, text_len);
+  tail_escaped_len = jsonrpc_output_stream_get_escaped_len (text_tail, text_tail_len);
+  escaped_len += tail_escaped_len;
+
+  if G_UNLIKELY (jsonrpc_output_stream_debug)
+    g_message (">>> %s (text: %"G_GSIZE_FORMAT" bytes)", json, text_len + text_tail_len);
+
+  len = g_snprintf (header, sizeof header, "Content-Length: %"G_GSIZE_FORMAT"\r\n\r\n",
+                    prefix_len + escaped_len + suffix_len);
+
+  buffer = g_byte_array_sized_new (len + prefix_len + escaped_len + suffix_len);
+  g_byte_array_append (buffer, (const guint8 *)header, len);
+  g_byte_array_append (buffer, (const guint8 *)json, prefix_len);
+
+  len = buffer->len;
+  g_byte_array_set_size (buffer, len + escaped_len);
+  jsonrpc_output_stream_escape (buffer->data + len, text, text_len);
+  jsonrpc_output_stream_escape (buffer->data + len + escaped_len - tail_escaped_len,
+                                text_tail, text_tail_len);
+
+  g_byte_array_append (buffer, (const guint8 *)suffix, suffix_len);
+
+  return g_byte_array_free_to_bytes (g_steal_pointer (&buffer));
+}
+
 JsonrpcOutputStream *
 jsonrpc_output_stream_new (GOutputStream *base_stream)
 {
@@ -327,6 +497,9 @@ jsonrpc_output_stream_write_message_async_cb (GObject      *object,
 
   g_task_return_boolean (task, TRUE);
 
+  if (priv->queue.length == 0)
+    g_signal_emit (self, signals [DRAINED], 0);
+
   jsonrpc_output_stream_pump (self);
 }
 
@@ -376,6 +549,72 @@ jsonrpc_output_stream_write_message_async (JsonrpcOutputStream *self,
   jsonrpc_output_stream_pump (self);
 }
 
+/**
+ * jsonrpc_output_stream_write_message_with_text_async:
+ * @self: a #JsonrpcOutputStream
+ * @message: (transfer none): a #GVariant
+ * @text: the text replacing %JSONRPC_MESSAGE_TEXT_PLACEHOLDER
+ * @text_len: length of @text in bytes or -1 if nul-terminated
+ * @text_tail: (nullable): text following @text or %NULL
+ * @text_tail_len: length of @text_tail in bytes
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @callback: (nullable): a #GAsyncReadyCallback or %NULL
+ * @user_data: closure data for @callback
+ *
+ * Like jsonrpc_output_stream_write_message_async() but the string value
+ * %JSONRPC_MESSAGE_TEXT_PLACEHOLDER contained in @message is replaced by
+ * @text followed by @text_tail, which allows passing text kept in two
+ * parts, such as the two sides of the gap of a gap buffer, without joining
+ * them first. The text is escaped directly into the output buffer before
+ * this function returns so the caller doesn't have to keep it alive
+ * afterwards.
+ *
+ * Complete the operation with jsonrpc_output_stream_write_message_finish().
+ *
+ * Since: 3.44
+ */
+void
+jsonrpc_output_stream_write_message_with_text_async (JsonrpcOutputStream *self,
+                                                     GVariant            *message,
+                                                     const gchar         *text,
+                                                     gssize               text_len,
+                                                     const gchar         *text_tail,
+                                                     gsize                text_tail_len,
+                                                     GCancellable        *cancellable,
+                                                     GAsyncReadyCallback  callback,
+                                                     gpointer             user_data)
+{
+  JsonrpcOutputStreamPrivate *priv = jsonrpc_output_stream_get_instance_private (self);
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_return_if_fail (JSONRPC_IS_OUTPUT_STREAM (self));
+  g_return_if_fail (message != NULL);
+  g_return_if_fail (text != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  if (text_len < 0)
+    text_len = strlen (text);
+  if (text_tail == NULL)
+    text_tail_len = 0;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, jsonrpc_output_stream_write_message_async);
+  g_task_set_priority (task, G_PRIORITY_LOW);
+
+  if (NULL == (bytes = jsonrpc_output_stream_create_bytes_with_text (self, message, text, text_len,
+                                                                      text_tail, text_tail_len, &error)))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_task_set_task_data (task, g_steal_pointer (&bytes), (GDestroyNotify)g_bytes_unref);
+  g_queue_push_tail (&priv->queue, g_steal_pointer (&task));
+  jsonrpc_output_stream_pump (self);
+}
+
 gboolean
 jsonrpc_output_stream_write_message_finish (JsonrpcOutputStream  *self,
                                             GAsyncResult         *result,
@@ -28,6 +28,10 @@ G_BEGIN_DECLS
 
 #define JSONRPC_TYPE_OUTPUT_STREAM (jsonrpc_output_stream_get_type())
 
+/* string value replaced by the text passed to
+ * jsonrpc_output_stream_write_message_with_text_async() */
+#define JSONRPC_MESSAGE_TEXT_PLACEHOLDER "$jsonrpc-glib-text-placeholder$"
+
 JSONRPC_AVAILABLE_IN_3_26
 G_DECLARE_DERIVABLE_TYPE (JsonrpcOutputStream, jsonrpc_output_stream, JSONRPC, OUTPUT_STREAM, GDataOutputStream)
 
@@ -67,6 +71,17 @@ void                 jsonrpc_output_stream_write_message_async  (JsonrpcOutputSt
                                                                  GCancellable         *cancellable,
                                                                  GAsyncReadyCallback   callback,
                                                                  gpointer              user_data);
+JSONRPC_AVAILABLE_IN_3_44
+void                 jsonrpc_output_stream_write_message_with_text_async
+                                                                (JsonrpcOutputStream  *self,
+                                                                 GVariant             *message,
+                                                                 const gchar          *text,
+                                                                 gssize                text_len,
+                                                                 const gchar          *text_tail,
+                                                                 gsize                 text_tail_len,
+                                                                 GCancellable         *cancellable,
+                                                                 GAsyncReadyCallback   callback,
+                                                                 gpointer              user_data);
 JSONRPC_AVAILABLE_IN_3_26
 gboolean             jsonrpc_output_stream_write_message_finish (JsonrpcOutputStream  *self,
                                                                  GAsyncResult         *result,
@@ -25,19 +25,27 @@
 #include "lsp/lsp-rpc.h"
 #include "lsp/lsp-server.h"
 #include "lsp/lsp-symbol-kinds.h"
+#include "lsp/lsp-ranking.h"
 
 #include <jsonrpc-glib.h>
 #include <ctype.h>
 #include <glib.h>
 
 
+/* Only the members needed for sorting, filtering and display are parsed for
+ * every item; the strings point into the referenced item. Edits are parsed
+ * when the item gets selected. */
 typedef struct
 {
-	gchar *label;
+	GVariant *item;
+	const gchar *label;
 	LspCompletionKind kind;
-	gchar *sort_text;
-	gchar *insert_text;
-	gchar *detail;
+	const gchar *sort_text;
+	const gchar *filter_text;
+	const gchar *insert_text;
+	const gchar *new_text;  // newText of textEdit
+	gdouble score;  // how often and recently the user picked the item
+	gboolean edits_parsed;
 	LspTextEdit *text_edit;
 	GPtrArray * additional_edits;
 } LspAutocompleteSymbol;
@@ -47,10 +55,34 @@ typedef struct
 {
 	GeanyDocument *doc;
 	gint request_id;
+	gint ident_start;
+	gchar *prefix;
+	LspPosition pos;
 } LspAutocompleteAsyncData;
 
 
+typedef struct
+{
+	guint doc_id;
+	gint64 line;  // line where the completion was inserted
+} LspAutocompleteResolveData;
+
+
+/* Complete result of the last request, filtered locally while the typed
+ * identifier grows so that the server doesn't have to be asked again. */
+typedef struct
+{
+	GPtrArray *symbols;  // sorted and without duplicates
+	gboolean is_incomplete;  // server wants to be asked again when typing continues
+	guint doc_id;
+	gint ident_start;  // start of the identifier when the request was made
+	gchar *prefix;  // identifier part typed before the request
+	LspPosition pos;  // caret position when the request was made
+} LspAutocompleteCache;
+
+
 static GPtrArray *displayed_autocomplete_symbols = NULL;
+static LspAutocompleteCache *cached_completion = NULL;
 static gint sent_request_id = 0;
 static gint received_request_id = 0;
 static gint discard_up_to_request_id = 0;
@@ -58,7 +90,13 @@ static gint discard_up_to_request_id = 0;
 
 void lsp_autocomplete_discard_pending_requests()
 {
+	GeanyDocument *doc = document_get_current();
+	LspServer *srv = doc ? lsp_server_get_if_running(doc) : NULL;
+
 	discard_up_to_request_id = sent_request_id;
+
+	if (srv)
+		lsp_rpc_cancel_superseding(srv, "textDocument/completion", doc);
 }
 
 
@@ -73,10 +111,7 @@ void lsp_autocomplete_set_displayed_symbols(GPtrArray *symbols)
 static void free_autocomplete_symbol(gpointer data)
 {
 	LspAutocompleteSymbol *sym = data;
-	g_free(sym->label);
-	g_free(sym->sort_text);
-	g_free(sym->insert_text);
-	g_free(sym->detail);
+	g_variant_unref(sym->item);
 	lsp_utils_free_lsp_text_edit(sym->text_edit);
 	if (sym->additional_edits)
 		g_ptr_array_free(sym->additional_edits, TRUE);
@@ -84,13 +119,35 @@ static void free_autocomplete_symbol(gpointer data)
 }
 
 
+static void parse_symbol_edits(LspAutocompleteSymbol *sym)
+{
+	GVariant *text_edit = NULL;
+	GVariantIter *additional_edits = NULL;
+
+	if (sym->edits_parsed)
+		return;
+
+	JSONRPC_MESSAGE_PARSE(sym->item, "textEdit", JSONRPC_MESSAGE_GET_VARIANT(&text_edit));
+	JSONRPC_MESSAGE_PARSE(sym->item, "additionalTextEdits", JSONRPC_MESSAGE_GET_ITER(&additional_edits));
+
+	sym->text_edit = lsp_utils_parse_text_edit(text_edit);
+	sym->additional_edits = lsp_utils_parse_text_edits(additional_edits);
+	sym->edits_parsed = TRUE;
+
+	if (text_edit)
+		g_variant_unref(text_edit);
+	if (additional_edits)
+		g_variant_iter_free(additional_edits);
+}
+
+
 static const gchar *get_symbol_label(LspServer *server, LspAutocompleteSymbol *sym)
 {
 	if (server->config.autocomplete_use_label && sym->label)
 		return sym->label;
 
-	if (sym->text_edit && sym->text_edit->new_text)
-		return sym->text_edit->new_text;
+	if (sym->new_text)
+		return sym->new_text;
 	if (sym->insert_text)
 		return sym->insert_text;
 	if (sym->label)
@@ -100,7 +157,29 @@ static const gchar *get_symbol_label(LspServer *server, LspAutocompleteSymbol *s
 }
 
 
-static guint get_ident_prefixlen(GeanyDocument *doc, gint pos)
+static void free_autocomplete_cache(void)
+{
+	if (!cached_completion)
+		return;
+
+	// displayed symbols point to cached symbols
+	lsp_autocomplete_set_displayed_symbols(NULL);
+
+	g_ptr_array_free(cached_completion->symbols, TRUE);
+	g_free(cached_completion->prefix);
+	g_free(cached_completion);
+	cached_completion = NULL;
+}
+
+
+static void free_async_data(LspAutocompleteAsyncData *data)
+{
+	g_free(data->prefix);
+	g_free(data);
+}
+
+
+static gint get_ident_start(GeanyDocument *doc, gint pos, guint *char_num)
 {
 	//TODO: use configured wordchars (also change in Geany)
 	const gchar *wordchars = GEANY_WORDCHARS;
@@ -126,10 +205,81 @@ static guint get_ident_prefixlen(GeanyDocument *doc, gint pos)
 		pos = new_pos;
 	}
 
+	if (char_num)
+		*char_num = num;
+	return pos;
+}
+
+
+static guint get_ident_prefixlen(GeanyDocument *doc, gint pos)
+{
+	guint num;
+
+	get_ident_start(doc, pos, &num);
 	return num;
 }
 
 
+static void resolve_cb(GVariant *return_value, GError *error, gpointer user_data)
+{
+	LspAutocompleteResolveData *data = user_data;
+	GeanyDocument *doc = document_find_by_id(data->doc_id);
+
+	if (!error && doc)
+	{
+		GVariantIter *iter = NULL;
+		GPtrArray *edits;
+
+		JSONRPC_MESSAGE_PARSE(return_value, "additionalTextEdits", JSONRPC_MESSAGE_GET_ITER(&iter));
+		edits = lsp_utils_parse_text_edits(iter);
+
+		if (edits)
+		{
+			GPtrArray *before = g_ptr_array_new();
+			guint i;
+
+			// the completion has already been inserted and the user may continue
+			// typing - only apply edits not affected by that, typically imports
+			for (i = 0; i < edits->len; i++)
+			{
+				LspTextEdit *e = edits->pdata[i];
+				if (e->range.end.line < data->line)
+					g_ptr_array_add(before, e);
+			}
+
+			if (before->len > 0)
+			{
+				ScintillaObject *sci = doc->editor->sci;
+
+				sci_start_undo_action(sci);
+				lsp_utils_apply_text_edits(sci, NULL, before);
+				sci_end_undo_action(sci);
+			}
+
+			g_ptr_array_free(before, TRUE);
+			g_ptr_array_free(edits, TRUE);
+		}
+
+		if (iter)
+			g_variant_iter_free(iter);
+	}
+
+	g_free(data);
+}
+
+
+static void resolve_additional_edits(LspServer *server, GeanyDocument *doc,
+	LspAutocompleteSymbol *sym, gint64 line)
+{
+	LspAutocompleteResolveData *data = g_new0(LspAutocompleteResolveData, 1);
+
+	data->doc_id = doc->id;
+	data->line = line;
+
+	lsp_rpc_call(server, "completionItem/resolve", sym->item, resolve_cb, data);
+}
+
+
 #if 0
 static gboolean add_newline_idle(gpointer user_data)
 {
@@ -154,18 +304,42 @@ void lsp_autocomplete_item_selected(LspServer *server, GeanyDocument *doc, guint
 		return;
 
 	sym = displayed_autocomplete_symbols->pdata[index];
+	parse_symbol_edits(sym);
+
+	if (server->config.autocomplete_rank_by_usage)
+		lsp_ranking_item_selected(doc->file_type->id, get_symbol_label(server, sym));
+
+	// servers supporting resolve may leave out additional edits, e.g. imports
+	if (server->config.autocomplete_apply_additional_edits && !sym->additional_edits &&
+		server->supports_completion_resolve)
+	{
+		gint64 line = sym->text_edit ? sym->text_edit->range.start.line :
+			sci_get_current_line(sci);
+		resolve_additional_edits(server, doc, sym, line);
+	}
+
 	if (sym->text_edit)
 	{
+		LspTextEdit edit = *sym->text_edit;
+
+		// the edit ends at the caret position of the request - extend it over
+		// the characters typed since then
+		if (cached_completion && edit.range.end.line == cached_completion->pos.line &&
+			edit.range.end.character == cached_completion->pos.character)
+		{
+			edit.range.end = lsp_utils_scintilla_pos_to_lsp(sci, sci_get_current_position(sci));
+		}
+
 		if (server->config.autocomplete_apply_additional_edits && sym->additional_edits)
-			lsp_utils_apply_text_edits(sci, sym->text_edit, sym->additional_edits);
+			lsp_utils_apply_text_edits(sci, &edit, sym->additional_edits);
 		else
-			lsp_utils_apply_text_edit(sci, sym->text_edit, TRUE);
+			lsp_utils_apply_text_edit(sci, &edit, TRUE);
 	}
 	else
 	{
 		gint pos = sci_get_current_position(sci);
 		guint rootlen = get_ident_prefixlen(doc, pos);
-		gchar *insert_text = sym->insert_text ? sym->insert_text : sym->label;
+		const gchar *insert_text = sym->insert_text ? sym->insert_text : sym->label;
 		if (insert_text && strlen(insert_text) >= rootlen)
 		{
 			SSM(sci, SCI_DELETERANGE, pos - rootlen, rootlen);
@@ -185,6 +359,9 @@ void lsp_autocomplete_item_selected(LspServer *server, GeanyDocument *doc, guint
 		g_idle_add(add_newline_idle, doc);
 	}
 #endif
+
+	// the document changed in a way the cached result doesn't reflect
+	free_autocomplete_cache();
 }
 
 
@@ -239,6 +416,9 @@ static gint sort_autocomplete_symbols(gconstpointer a, gconstpointer b, gpointer
 
 	if (pass > 1)
 	{
+		if (sym1->score != sym2->score)
+			return sym1->score > sym2->score ? -1 : 1;
+
 		if (sym1->kind == LspCompletionKindKeyword && sym2->kind != LspCompletionKindKeyword)
 			return -1;
 
@@ -255,8 +435,8 @@ static gint sort_autocomplete_symbols(gconstpointer a, gconstpointer b, gpointer
 	if (sym1->sort_text && sym2->sort_text)
 		return g_strcmp0(sym1->sort_text, sym2->sort_text);
 
-	if (sym1->text_edit && sym1->text_edit->new_text && sym2->text_edit && sym2->text_edit->new_text)
-		return g_strcmp0(sym1->text_edit->new_text, sym2->text_edit->new_text);
+	if (sym1->new_text && sym2->new_text)
+		return g_strcmp0(sym1->new_text, sym2->new_text);
 
 	if (sym1->label && sym2->label)
 		return g_strcmp0(sym1->label, sym2->label);
@@ -265,56 +445,169 @@ static gint sort_autocomplete_symbols(gconstpointer a, gconstpointer b, gpointer
 }
 
 
-static void process_response(LspServer *server, GVariant *response, GeanyDocument *doc)
+/* Case-insensitive subsequence match; returns -1 when text doesn't match,
+ * 0 for prefix matches and 1 for other matches. */
+static gint fuzzy_match(const gchar *text, const gchar *pattern)
+{
+	const gchar *t = text;
+	const gchar *p = pattern;
+
+	while (*p && *t && g_ascii_tolower(*p) == g_ascii_tolower(*t))
+	{
+		p++;
+		t++;
+	}
+
+	if (!*p)
+		return 0;
+
+	for (; *p && *t; t++)
+	{
+		if (g_ascii_tolower(*p) == g_ascii_tolower(*t))
+			p++;
+	}
+
+	return *p ? -1 : 1;
+}
+
+
+/* Returns the cached symbols matching prefix - those starting with prefix
+ * first, then other fuzzy matches, each group in the server's order. */
+static GPtrArray *filter_cached_symbols(LspServer *server, const gchar *prefix)
+{
+	GPtrArray *symbols = cached_completion->symbols;
+	GPtrArray *prefix_matches, *other_matches;
+	guint i;
+
+	prefix_matches = g_ptr_array_new();
+
+	// the server already filtered the result for this prefix
+	if (g_strcmp0(prefix, cached_completion->prefix) == 0)
+	{
+		for (i = 0; i < symbols->len; i++)
+			g_ptr_array_add(prefix_matches, symbols->pdata[i]);
+		return prefix_matches;
+	}
+
+	other_matches = g_ptr_array_new();
+
+	for (i = 0; i < symbols->len; i++)
+	{
+		LspAutocompleteSymbol *sym = symbols->pdata[i];
+		const gchar *text = sym->filter_text ? sym->filter_text : get_symbol_label(server, sym);
+		gint match = fuzzy_match(text, prefix);
+
+		if (match == 0)
+			g_ptr_array_add(prefix_matches, sym);
+		else if (match > 0)
+			g_ptr_array_add(other_matches, sym);
+	}
+
+	for (i = 0; i < other_matches->len; i++)
+		g_ptr_array_add(prefix_matches, other_matches->pdata[i]);
+	g_ptr_array_free(other_matches, TRUE);
+
+	return prefix_matches;
+}
+
+
+static gchar *get_ident_prefix(GeanyDocument *doc, gint pos, gint *ident_start)
+{
+	*ident_start = get_ident_start(doc, pos, NULL);
+	return sci_get_contents_range(doc->editor->sci, *ident_start, pos);
+}
+
+
+static gboolean show_cached_symbols(LspServer *server, GeanyDocument *doc)
+{
+	gint pos = sci_get_current_position(doc->editor->sci);
+	GPtrArray *symbols;
+	gint ident_start;
+	gchar *prefix;
+
+	prefix = get_ident_prefix(doc, pos, &ident_start);
+	if (!cached_completion || cached_completion->doc_id != doc->id ||
+		cached_completion->ident_start != ident_start ||
+		!g_str_has_prefix(prefix, cached_completion->prefix))
+	{
+		g_free(prefix);
+		return FALSE;
+	}
+
+	symbols = filter_cached_symbols(server, prefix);
+	if (symbols->len > 0)
+		show_tags_list(server, doc, symbols);
+	else
+	{
+		g_ptr_array_free(symbols, TRUE);
+		SSM(doc->editor->sci, SCI_AUTOCCANCEL, 0, 0);
+	}
+
+	g_free(prefix);
+	return TRUE;
+}
+
+
+static void process_response(LspServer *server, GVariant *response, GeanyDocument *doc,
+	LspAutocompleteAsyncData *data)
 {
-	//gboolean is_incomplete = FALSE;
+	gboolean is_incomplete = FALSE;
 	GVariantIter *iter = NULL;
 	GVariant *member = NULL;
 	GPtrArray *symbols, *symbols_filtered;
 	GHashTable *entry_set;
 	gint i;
 
-	JSONRPC_MESSAGE_PARSE(response, 
-		//"isIncomplete", JSONRPC_MESSAGE_GET_BOOLEAN(&is_incomplete),
-		"items", JSONRPC_MESSAGE_GET_ITER(&iter));
+	if (g_variant_is_of_type(response, G_VARIANT_TYPE_VARDICT))
+	{
+		JSONRPC_MESSAGE_PARSE(response,
+			"isIncomplete", JSONRPC_MESSAGE_GET_BOOLEAN(&is_incomplete));
+		JSONRPC_MESSAGE_PARSE(response,
+			"items", JSONRPC_MESSAGE_GET_ITER(&iter));
+	}
+	else if (g_variant_is_of_type(response, G_VARIANT_TYPE("av")))
+	{
+		// plain array of items instead of CompletionList
+		iter = g_variant_iter_new(response);
+	}
+
+	if (!iter)
+	{
+		SSM(doc->editor->sci, SCI_AUTOCCANCEL, 0, 0);
+		return;
+	}
 
 	symbols = g_ptr_array_new_full(0, NULL);  // not freeing symbols here
 
 	while (g_variant_iter_loop(iter, "v", &member))
 	{
-		LspAutocompleteSymbol *sym;
+		LspAutocompleteSymbol *sym = g_new0(LspAutocompleteSymbol, 1);
 		GVariant *text_edit = NULL;
-		GVariantIter *additional_edits = NULL;
-		const gchar *label = NULL;
-		const gchar *insert_text = NULL;
-		const gchar *sort_text = NULL;
-		const gchar *detail = NULL;
 		gint64 kind = 0;
-
-		JSONRPC_MESSAGE_PARSE(member, "label", JSONRPC_MESSAGE_GET_STRING(&label));
-		JSONRPC_MESSAGE_PARSE(member, "insertText", JSONRPC_MESSAGE_GET_STRING(&insert_text));
-		JSONRPC_MESSAGE_PARSE(member, "sortText", JSONRPC_MESSAGE_GET_STRING(&sort_text));
-		JSONRPC_MESSAGE_PARSE(member, "detail", JSONRPC_MESSAGE_GET_STRING(&detail));
-		JSONRPC_MESSAGE_PARSE(member, "kind", JSONRPC_MESSAGE_GET_INT64(&kind));
-		JSONRPC_MESSAGE_PARSE(member, "textEdit", JSONRPC_MESSAGE_GET_VARIANT(&text_edit));
-		JSONRPC_MESSAGE_PARSE(member, "additionalTextEdits", JSONRPC_MESSAGE_GET_ITER(&additional_edits));
-
-		sym = g_new0(LspAutocompleteSymbol, 1);
-		sym->label = g_strdup(label);
-		sym->insert_text = g_strdup(insert_text);
-		sym->sort_text = g_strdup(sort_text);
-		sym->detail = g_strdup(detail);
-		sym->kind = kind;
-		sym->text_edit = lsp_utils_parse_text_edit(text_edit);
-		sym->additional_edits = lsp_utils_parse_text_edits(additional_edits);
-
-		g_ptr_array_add(symbols, sym);
-
+		// parsed for every item of possibly thousands - walk each object only once
+		LspField fields[] = {
+			{"label", LspFieldString, &sym->label},
+			{"insertText", LspFieldString, &sym->insert_text},
+			{"sortText", LspFieldString, &sym->sort_text},
+			{"filterText", LspFieldString, &sym->filter_text},
+			{"kind", LspFieldInt64, &kind},
+			{"textEdit", LspFieldVariant, &text_edit}
+		};
+		LspField text_edit_fields[] = {
+			{"newText", LspFieldString, &sym->new_text}
+		};
+
+		sym->item = g_variant_ref(member);
+
+		lsp_utils_parse_fields(member, fields, G_N_ELEMENTS(fields));
 		if (text_edit)
+		{
+			lsp_utils_parse_fields(text_edit, text_edit_fields, G_N_ELEMENTS(text_edit_fields));
 			g_variant_unref(text_edit);
+		}
+		sym->kind = kind;
 
-		if (additional_edits)
-			g_variant_iter_free(additional_edits);
+		g_ptr_array_add(symbols, sym);
 	}
 
 	/* sort based on sorting provided by LSP server */
@@ -333,6 +626,8 @@ static void process_response(LspServer *server, GVariant *response, GeanyDocumen
 			free_autocomplete_symbol(sym);
 		else
 		{
+			if (server->config.autocomplete_rank_by_usage)
+				sym->score = lsp_ranking_get_score(doc->file_type->id, display_label);
 			g_ptr_array_add(symbols_filtered, sym);
 			g_hash_table_add(entry_set, g_strdup(display_label));
 		}
@@ -341,16 +636,21 @@ static void process_response(LspServer *server, GVariant *response, GeanyDocumen
 	g_ptr_array_free(symbols, TRUE);
 	symbols = symbols_filtered;
 
-	/* sort with keywords and snippets first */
+	/* sort with frequently picked items first, then keywords and snippets */
 	g_ptr_array_sort_with_data(symbols, sort_autocomplete_symbols, GINT_TO_POINTER(2));
 
-	if (symbols->len > 0)
-		show_tags_list(server, doc, symbols);
-	else
-	{
-		g_ptr_array_free(symbols, TRUE);
+	free_autocomplete_cache();
+	cached_completion = g_new0(LspAutocompleteCache, 1);
+	cached_completion->symbols = symbols;
+	cached_completion->is_incomplete = is_incomplete;
+	cached_completion->doc_id = doc->id;
+	cached_completion->ident_start = data->ident_start;
+	cached_completion->prefix = g_strdup(data->prefix);
+	cached_completion->pos = data->pos;
+
+	// the user may have typed more characters while waiting for the response
+	if (!show_cached_symbols(server, doc))
 		SSM(doc->editor->sci, SCI_AUTOCCANCEL, 0, 0);
-	}
 
 	g_variant_iter_free(iter);
 	g_hash_table_destroy(entry_set);
@@ -359,10 +659,11 @@ static void process_response(LspServer *server, GVariant *response, GeanyDocumen
 
 static void autocomplete_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
+	LspAutocompleteAsyncData *data = user_data;
+
 	if (!error)
 	{
 		GeanyDocument *current_doc = document_get_current();
-		LspAutocompleteAsyncData *data = user_data;
 		GeanyDocument *doc = data->doc;
 
 		if (current_doc == doc && data->request_id > received_request_id &&
@@ -370,12 +671,33 @@ static void autocomplete_cb(GVariant *return_value, GError *error, gpointer user
 		{
 			LspServer *srv = lsp_server_get(doc);
 			received_request_id = data->request_id;
-			process_response(srv, return_value, doc);
+			process_response(srv, return_value, doc, data);
 			//printf("%s\n", lsp_utils_json_pretty_print(return_value));
 		}
 	}
 
-	g_free(user_data);
+	free_async_data(data);
+}
+
+
+/* Processes a completion response as if it was requested at the current position. */
+void lsp_autocomplete_process_response(LspServer *server, GeanyDocument *doc, GVariant *response)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint pos = sci_get_current_position(sci);
+	LspAutocompleteAsyncData data = {0};
+
+	data.doc = doc;
+	data.prefix = get_ident_prefix(doc, pos, &data.ident_start);
+	data.pos = lsp_utils_scintilla_pos_to_lsp(sci, pos);
+	process_response(server, response, doc, &data);
+	g_free(data.prefix);
+}
+
+
+void lsp_autocomplete_clear_cache(void)
+{
+	free_autocomplete_cache();
 }
 
 
@@ -456,6 +778,13 @@ void lsp_autocomplete_completion(LspServer *server, GeanyDocument *doc)
 		}
 	}
 
+	// filter the previous result locally unless the server marked it as incomplete
+	if (cached_completion && !cached_completion->is_incomplete &&
+		show_cached_symbols(server, doc))
+	{
+		return;
+	}
+
 	doc_uri = lsp_utils_get_doc_uri(doc);
 
 	node = JSONRPC_MESSAGE_NEW (
@@ -472,8 +801,10 @@ void lsp_autocomplete_completion(LspServer *server, GeanyDocument *doc)
 	data = g_new0(LspAutocompleteAsyncData, 1);
 	data->doc = doc;
 	data->request_id = ++sent_request_id;
+	data->prefix = get_ident_prefix(doc, pos, &data->ident_start);
+	data->pos = lsp_pos;
 
-	lsp_rpc_call(server, "textDocument/completion", node,
+	lsp_rpc_call_superseding(server, "textDocument/completion", node, doc,
 		autocomplete_cb, data);
 
 	g_free(doc_uri);
@@ -27,4 +27,7 @@ void lsp_autocomplete_set_displayed_symbols(GPtrArray *symbols);
 void lsp_autocomplete_item_selected(LspServer *server, GeanyDocument *doc, guint index);
 void lsp_autocomplete_discard_pending_requests();
 
+void lsp_autocomplete_process_response(LspServer *server, GeanyDocument *doc, GVariant *response);
+void lsp_autocomplete_clear_cache(void);
+
 #endif  /* LSP_AUTOCOMPLETE_H */
@@ -24,97 +24,392 @@
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
 #include "lsp/lsp-sync.h"
+#include "lsp/lsp-scheduler.h"
 
 #include <jsonrpc-glib.h>
 
 
-extern GeanyPlugin *geany_plugin;
 extern GeanyData *geany_data;
 
 
-static void code_lens_cb(GVariant *return_value, GError *error, gpointer user_data)
+typedef struct {
+	GVariant *lens;  // the CodeLens as received from the server, replaced when resolved
+	gint line;
+	gboolean resolving;
+} CodeLens;
+
+
+typedef struct {
+	guint version;  // document version the lenses belong to
+	GPtrArray *lenses;  // CodeLens sorted by line
+} CodeLensCache;
+
+
+typedef struct {
+	GeanyDocument *doc;
+	guint version;
+	guint index;  // only used for codeLens/resolve
+} CodeLensRequest;
+
+
+static GQuark cache_quark;
+
+
+static void code_lens_free(CodeLens *lens)
 {
-	if (!error)
+	g_variant_unref(lens->lens);
+	g_free(lens);
+}
+
+
+static void cache_free(CodeLensCache *cache)
+{
+	g_ptr_array_free(cache->lenses, TRUE);
+	g_free(cache);
+}
+
+
+static CodeLensCache *get_cache(GeanyDocument *doc)
+{
+	if (!cache_quark)
+		return NULL;
+	return g_object_get_qdata(G_OBJECT(doc->editor->sci), cache_quark);
+}
+
+
+static const gchar *get_title(CodeLens *lens)
+{
+	const gchar *title = NULL;
+
+	JSONRPC_MESSAGE_PARSE(lens->lens,
+		"command", "{",
+			"title", JSONRPC_MESSAGE_GET_STRING(&title),
+		"}");
+
+	return title;
+}
+
+
+/* Returns the index of the first lens at line or after it. */
+static guint find_first_lens(GPtrArray *lenses, gint line)
+{
+	guint lo = 0, hi = lenses->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+		CodeLens *lens = lenses->pdata[mid];
+
+		if (lens->line < line)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+/* Sets the annotation of line to the titles of its resolved lenses. Lines whose
+ * lenses aren't resolved yet keep their previous annotation so it doesn't
+ * flicker while the lenses of a new document version are resolved. */
+static void update_line(ScintillaObject *sci, CodeLensCache *cache, gint line)
+{
+	GString *text = g_string_new(NULL);
+	gboolean unresolved = FALSE;
+	guint i;
+
+	for (i = find_first_lens(cache->lenses, line); i < cache->lenses->len; i++)
 	{
-		GeanyDocument *doc = user_data;
-		gboolean doc_exists = FALSE;
-		LspServer *srv;
-		gint i;
+		CodeLens *lens = cache->lenses->pdata[i];
+		const gchar *title;
 
-		foreach_document(i)
+		if (lens->line != line)
+			break;
+
+		title = get_title(lens);
+		if (!title)
+			unresolved = TRUE;
+		else if (*title)
 		{
-			if (doc == documents[i])
-			{
-				doc_exists = TRUE;
-				break;
-			}
+			if (text->len > 0)
+				g_string_append(text, " | ");
+			g_string_append(text, title);
 		}
+	}
 
-		srv = doc_exists ? lsp_server_get(doc) : NULL;
+	if (text->len > 0 || !unresolved)
+	{
+		gint old_len = SSM(sci, SCI_EOLANNOTATIONGETTEXT, line, 0);
+		gchar *old_text = g_malloc(old_len + 1);
 
-		if (doc_exists && srv)
+		SSM(sci, SCI_EOLANNOTATIONGETTEXT, line, (sptr_t) old_text);
+		old_text[old_len] = '\0';
+		// setting the annotation redraws the view - skip lines which didn't change
+		if (g_strcmp0(old_text, text->str) != 0)
 		{
-			//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
+			SSM(sci, SCI_EOLANNOTATIONSETTEXT, line, (sptr_t) (text->len > 0 ? text->str : NULL));
+			// looks like the line numbers so it isn't confused with the code
+			SSM(sci, SCI_EOLANNOTATIONSETSTYLE, line, STYLE_LINENUMBER);
 		}
+		g_free(old_text);
 	}
+
+	g_string_free(text, TRUE);
 }
 
 
-static gboolean retry_cb(gpointer user_data)
+static void resolve_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
-	GeanyDocument *doc = user_data;
+	CodeLensRequest *data = user_data;
+	// cancelled when the document was closed or edited before the response arrived
+	gboolean outdated = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	CodeLensCache *cache = !outdated ? get_cache(data->doc) : NULL;
 
-	//printf("retrying code lens\n");
-	if (doc == document_get_current())
+	// the lenses might have been replaced by those of a newer document version
+	if (cache && cache->version == data->version && data->index < cache->lenses->len)
 	{
-		LspServer *srv = lsp_server_get_if_running(doc);
-		if (!lsp_server_is_usable(doc))
-			;  // server died or misconfigured
-		else if (!srv)
-			return TRUE;  // retry
-		else
+		CodeLens *lens = cache->lenses->pdata[data->index];
+
+		lens->resolving = FALSE;
+		if (!error && g_variant_is_of_type(return_value, G_VARIANT_TYPE("a{sv}")))
 		{
-			// should be successful now
-			lsp_code_lens_send_request(doc);
-			return FALSE;
+			g_variant_unref(lens->lens);
+			lens->lens = g_variant_ref(return_value);
+			update_line(data->doc->editor->sci, cache, lens->line);
 		}
 	}
 
-	// server shut down or document not current any more
-	return FALSE;
+	g_free(data);
 }
 
 
-void lsp_code_lens_send_request(GeanyDocument *doc)
+/* Resolves the lenses of the visible lines and of one screen above and below
+ * them so they are ready when scrolling. */
+static void resolve_visible(LspServer *srv, GeanyDocument *doc, CodeLensCache *cache)
 {
-	LspServer *server = lsp_server_get_if_running(doc);
-	gchar *doc_uri;
-	GVariant *node;
+	ScintillaObject *sci = doc->editor->sci;
+	gint first_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0), 0);
+	gint lines = SSM(sci, SCI_LINESONSCREEN, 0, 0);
+	guint i;
 
-	if (!server)
+	for (i = find_first_lens(cache->lenses, first_line - lines); i < cache->lenses->len; i++)
 	{
-		// happens when Geany and LSP server started - we cannot send the request yet
-		plugin_timeout_add(geany_plugin, 300, retry_cb, doc);
-		return;
+		CodeLens *lens = cache->lenses->pdata[i];
+		CodeLensRequest *data;
+
+		if (lens->line > first_line + 2 * lines)
+			break;
+		if (lens->resolving || get_title(lens) || !srv->supports_code_lens_resolve)
+			continue;
+
+		data = g_new0(CodeLensRequest, 1);
+		data->doc = doc;
+		data->version = cache->version;
+		data->index = i;
+		lens->resolving = TRUE;
+		lsp_rpc_call_for_doc(srv, "codeLens/resolve", lens->lens, doc, TRUE, resolve_cb, data);
 	}
+}
 
-	doc_uri = lsp_utils_get_doc_uri(doc);
+
+static gint sort_lenses(gconstpointer a, gconstpointer b)
+{
+	const CodeLens *l1 = *((const CodeLens **) a);
+	const CodeLens *l2 = *((const CodeLens **) b);
+
+	return l1->line - l2->line;
+}
+
+
+static void code_lens_cb(GVariant *return_value, GError *error, gpointer user_data)
+{
+	CodeLensRequest *data = user_data;
+	GeanyDocument *doc = data->doc;
+	// superseding requests are cancelled when the document gets closed
+	LspServer *srv = !error ? lsp_server_get(doc) : NULL;
+
+	//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
+
+	if (!error && srv && g_variant_is_of_type(return_value, G_VARIANT_TYPE("av")))
+	{
+		ScintillaObject *sci = doc->editor->sci;
+		CodeLensCache *cache = get_cache(doc);
+		GPtrArray *old_lenses = NULL;
+		GVariant *member = NULL;
+		GVariantIter iter;
+		guint i, j;
+
+		if (!cache)
+		{
+			cache = g_new0(CodeLensCache, 1);
+			g_object_set_qdata_full(G_OBJECT(sci), cache_quark, cache, (GDestroyNotify) cache_free);
+		}
+		else
+			old_lenses = cache->lenses;
+
+		cache->version = data->version;
+		cache->lenses = g_ptr_array_new_with_free_func((GDestroyNotify) code_lens_free);
+
+		g_variant_iter_init(&iter, return_value);
+		while (g_variant_iter_loop(&iter, "v", &member))
+		{
+			GVariant *range = NULL;
+
+			JSONRPC_MESSAGE_PARSE(member,
+				"range", JSONRPC_MESSAGE_GET_VARIANT(&range));
+
+			if (range)
+			{
+				CodeLens *lens = g_new0(CodeLens, 1);
+
+				lens->lens = g_variant_ref(member);
+				lens->line = lsp_utils_parse_range(range).start.line;
+				g_ptr_array_add(cache->lenses, lens);
+				g_variant_unref(range);
+			}
+		}
+		g_ptr_array_sort(cache->lenses, sort_lenses);
+
+		// update the lines of both the old and the new lenses
+		for (i = 0, j = 0; i < cache->lenses->len || (old_lenses && j < old_lenses->len);)
+		{
+			CodeLens *lens = i < cache->lenses->len ? cache->lenses->pdata[i] : NULL;
+			CodeLens *old = old_lenses && j < old_lenses->len ? old_lenses->pdata[j] : NULL;
+			gint line = !old || (lens && lens->line < old->line) ? lens->line : old->line;
+
+			update_line(sci, cache, line);
+			while (i < cache->lenses->len && ((CodeLens *) cache->lenses->pdata[i])->line == line)
+				i++;
+			while (old_lenses && j < old_lenses->len && ((CodeLens *) old_lenses->pdata[j])->line == line)
+				j++;
+		}
+
+		if (old_lenses)
+			g_ptr_array_free(old_lenses, TRUE);
+
+		resolve_visible(srv, doc, cache);
+	}
+
+	g_free(data);
+}
+
+
+static void server_ready_cb(GeanyDocument *doc, G_GNUC_UNUSED gpointer user_data)
+{
+	// document may not be current any more
+	if (doc == document_get_current())
+		lsp_code_lens_send_request(doc);
+}
+
+
+static void send_request(LspServer *server, GeanyDocument *doc, G_GNUC_UNUSED gint pos)
+{
+	CodeLensCache *cache = get_cache(doc);
+	CodeLensRequest *data;
+	gchar *doc_uri;
+	GVariant *node;
 
 	/* Geany requests symbols before firing "document-activate" signal so we may
 	 * need to request document opening here */
 	if (!lsp_sync_is_document_open(doc))
 		lsp_sync_text_document_did_open(server, doc);
 
+	// the lenses are still valid, only those scrolled into view need resolving
+	if (cache && cache->version == lsp_sync_get_doc_version(doc))
+	{
+		resolve_visible(server, doc, cache);
+		return;
+	}
+
+	if (!cache_quark)
+		cache_quark = g_quark_from_static_string("lsp-code-lens");
+
+	doc_uri = lsp_utils_get_doc_uri(doc);
+
 	node = JSONRPC_MESSAGE_NEW(
 		"textDocument", "{",
 			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
 		"}"
 	);
-	lsp_rpc_call(server, "textDocument/codeLens", node,
-		code_lens_cb, doc);
+
+	data = g_new0(CodeLensRequest, 1);
+	data->doc = doc;
+	data->version = lsp_sync_get_doc_version(doc);
+	lsp_rpc_call_superseding(server, "textDocument/codeLens", node, doc,
+		code_lens_cb, data);
 
 	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
 	g_free(doc_uri);
 	g_variant_unref(node);
 }
+
+
+void lsp_code_lens_style_init(GeanyDocument *doc)
+{
+	SSM(doc->editor->sci, SCI_EOLANNOTATIONSETVISIBLE, EOLANNOTATION_STANDARD, 0);
+}
+
+
+/* Removes the displayed lenses together with the cached ones, e.g. when the
+ * server which sent them stops. */
+void lsp_code_lens_clear(GeanyDocument *doc)
+{
+	ScintillaObject *sci = doc->editor->sci;
+
+	SSM(sci, SCI_EOLANNOTATIONCLEARALL, 0, 0);
+	if (cache_quark)
+		g_object_set_qdata(G_OBJECT(sci), cache_quark, NULL);
+}
+
+
+void lsp_code_lens_doc_reloaded(GeanyDocument *doc)
+{
+	// the reopened document starts with a new version and the annotations of
+	// the old text don't belong to its lines anymore
+	lsp_code_lens_clear(doc);
+}
+
+
+/* Moves the lenses with the lines Scintilla moves their annotations with, so
+ * the right lines are updated when the lenses of the new version arrive. */
+void lsp_code_lens_text_modified(GeanyDocument *doc, SCNotification *nt)
+{
+	CodeLensCache *cache;
+	gint line;
+	guint i;
+
+	if (!nt->linesAdded || !(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+		return;
+
+	cache = get_cache(doc);
+	if (!cache)
+		return;
+
+	line = sci_get_line_from_position(doc->editor->sci, nt->position);
+	for (i = find_first_lens(cache->lenses, line + 1); i < cache->lenses->len; i++)
+	{
+		CodeLens *lens = cache->lenses->pdata[i];
+
+		// lines removed by a deletion are joined with the line of its start
+		lens->line = MAX(lens->line + nt->linesAdded, line);
+	}
+}
+
+
+void lsp_code_lens_send_request(GeanyDocument *doc)
+{
+	LspServer *server = lsp_server_get_if_running(doc);
+
+	if (!server)
+	{
+		// happens when Geany and LSP server started - send the request once the server is ready
+		lsp_server_when_ready(doc, server_ready_cb, NULL, NULL);
+		return;
+	}
+
+	if (!server->config.code_lens_enable)
+		return;
+
+	lsp_scheduler_schedule(server, LspSchedCodeLens, doc, 0, send_request);
+}
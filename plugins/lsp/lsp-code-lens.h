@@ -25,4 +25,9 @@
 
 void lsp_code_lens_send_request(GeanyDocument *doc);
 
+void lsp_code_lens_style_init(GeanyDocument *doc);
+void lsp_code_lens_text_modified(GeanyDocument *doc, SCNotification *nt);
+void lsp_code_lens_doc_reloaded(GeanyDocument *doc);
+void lsp_code_lens_clear(GeanyDocument *doc);
+
 #endif  /* LSP_CODE_LENS_H */
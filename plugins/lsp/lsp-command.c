@@ -24,12 +24,38 @@
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
 #include "lsp/lsp-diagnostics.h"
+#include "lsp/lsp-sync.h"
+#include "lsp/lsp-scheduler.h"
 
 #include <jsonrpc-glib.h>
 
 
+typedef struct
+{
+	guint doc_id;
+	guint version;
+	gint line;
+	GVariant *diag_raw;
+	GVariant *actions;  // NULL while the request is pending
+} PrefetchedActions;
+
+
 static GPtrArray *code_actions;
 
+// code actions of the caret line requested in the background for the context menu
+static PrefetchedActions *prefetched;
+
+
+static void prefetched_free(PrefetchedActions *data)
+{
+	if (!data)
+		return;
+	g_variant_unref(data->diag_raw);
+	if (data->actions)
+		g_variant_unref(data->actions);
+	g_free(data);
+}
+
 
 static void command_free(LspCommand *cmd)
 {
@@ -40,7 +66,7 @@ static void command_free(LspCommand *cmd)
 }
 
 
-void lsp_command_send_code_action_destroy(void)
+static void clear_code_actions(void)
 {
 	if (code_actions)
 		g_ptr_array_free(code_actions, TRUE);
@@ -48,9 +74,20 @@ void lsp_command_send_code_action_destroy(void)
 }
 
 
+void lsp_command_send_code_action_destroy(void)
+{
+	clear_code_actions();
+
+	// a pending response of the prefetch frees its data itself
+	if (prefetched && prefetched->actions)
+		prefetched_free(prefetched);
+	prefetched = NULL;
+}
+
+
 void lsp_command_send_code_action_init(void)
 {
-	lsp_command_send_code_action_destroy();
+	clear_code_actions();
 	code_actions = g_ptr_array_new_full(0, (GDestroyNotify)command_free);
 }
 
@@ -99,69 +136,65 @@ void lsp_command_send_request(LspServer *server, const gchar *cmd, GVariant *arg
 }
 
 
+static void add_code_actions(GVariant *actions)
+{
+	GVariant *code_action = NULL;
+	GVariantIter iter;
+
+	g_variant_iter_init(&iter, actions);
+
+	while (g_variant_iter_loop(&iter, "v", &code_action))
+	{
+		const gchar *title = NULL;
+		const gchar *command = NULL;
+		GVariant *arguments = NULL;
+		LspCommand *cmd;
+
+		if (!JSONRPC_MESSAGE_PARSE(code_action,
+				"title", JSONRPC_MESSAGE_GET_STRING(&title),
+				"command", JSONRPC_MESSAGE_GET_STRING(&command)))
+		{
+			continue;
+		}
+
+		JSONRPC_MESSAGE_PARSE (code_action,
+			"arguments", JSONRPC_MESSAGE_GET_VARIANT(&arguments)
+		);
+
+		cmd = g_new0(LspCommand, 1);
+		cmd->title = g_strdup(title);
+		cmd->command = g_strdup(command);
+		cmd->arguments = arguments;
+
+		g_ptr_array_add(code_actions, cmd);
+	}
+}
+
+
 static void code_action_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
 	if (!error)
 	{
 		GCallback callback = user_data;
-		GVariant *code_action = NULL;
-		GVariantIter iter;
 
 		//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
 
-		g_variant_iter_init(&iter, return_value);
-
-		while (g_variant_iter_loop(&iter, "v", &code_action))
-		{
-			const gchar *title = NULL;
-			const gchar *command = NULL;
-			GVariant *arguments = NULL;
-			LspCommand *cmd;
-
-			if (!JSONRPC_MESSAGE_PARSE(code_action,
-					"title", JSONRPC_MESSAGE_GET_STRING(&title),
-					"command", JSONRPC_MESSAGE_GET_STRING(&command)))
-			{
-				continue;
-			}
-
-			JSONRPC_MESSAGE_PARSE (code_action,
-				"arguments", JSONRPC_MESSAGE_GET_VARIANT(&arguments)
-			);
-
-			cmd = g_new0(LspCommand, 1);
-			cmd->title = g_strdup(title);
-			cmd->command = g_strdup(command);
-			cmd->arguments = arguments;
-
-			g_ptr_array_add(code_actions, cmd);
-		}
+		add_code_actions(return_value);
 
 		callback();
 	}
 }
 
 
-void lsp_command_send_code_action_request(gint pos, GCallback actions_resolved_cb)
+static GVariant *create_code_action_request(GeanyDocument *doc, gint pos, GVariant *diag_raw)
 {
-	GeanyDocument *doc = document_get_current();
 	ScintillaObject *sci = doc->editor->sci;
-	LspServer *srv = lsp_server_get_if_running(doc);
 	LspPosition lsp_pos = lsp_utils_scintilla_pos_to_lsp(sci, pos);
-	GVariant *diag_raw = lsp_diagnostics_get_diag_raw(pos);
 	GVariant *node, *diagnostics, *diags_dict;
 	GVariantDict dict;
 	GPtrArray *arr;
 	gchar *doc_uri;
 
-	lsp_command_send_code_action_init();
-
-	if (!srv || !diag_raw)
-	{
-		actions_resolved_cb();
-		return;
-	}
-
 	doc_uri = lsp_utils_get_doc_uri(doc);
 	arr = g_ptr_array_new_full(1, (GDestroyNotify) g_variant_unref);
 
@@ -193,12 +226,122 @@ void lsp_command_send_code_action_request(gint pos, GCallback actions_resolved_c
 		"}"
 	);
 
+	g_variant_unref(diags_dict);
+	g_ptr_array_free(arr, TRUE);
+	g_free(doc_uri);
+
+	return node;
+}
+
+
+/* Whether the prefetched actions were requested for the same diagnostic at the
+ * same line of the current version of doc. */
+static gboolean prefetched_valid(GeanyDocument *doc, gint pos, GVariant *diag_raw)
+{
+	return prefetched && prefetched->doc_id == doc->id &&
+		prefetched->version == lsp_sync_get_doc_version(doc) &&
+		prefetched->line == sci_get_line_from_position(doc->editor->sci, pos) &&
+		prefetched->diag_raw == diag_raw;
+}
+
+
+void lsp_command_send_code_action_request(gint pos, GCallback actions_resolved_cb)
+{
+	GeanyDocument *doc = document_get_current();
+	LspServer *srv = lsp_server_get_if_running(doc);
+	GVariant *diag_raw = lsp_diagnostics_get_diag_raw(pos);
+	GVariant *node;
+
+	lsp_command_send_code_action_init();
+
+	if (!srv || !diag_raw)
+	{
+		actions_resolved_cb();
+		return;
+	}
+
+	lsp_sync_flush_doc_changes(doc);
+	if (prefetched_valid(doc, pos, diag_raw) && prefetched->actions)
+	{
+		add_code_actions(prefetched->actions);
+		actions_resolved_cb();
+		return;
+	}
+
+	node = create_code_action_request(doc, pos, diag_raw);
+
 	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
 	lsp_rpc_call(srv, "textDocument/codeAction", node, code_action_cb,
 		actions_resolved_cb);
 
 	g_variant_unref(node);
-	g_variant_unref(diags_dict);
-	g_free(doc_uri);
+}
+
+
+static void prefetch_cb(GVariant *return_value, GError *error, gpointer user_data)
+{
+	PrefetchedActions *data = user_data;
+
+	// superseded by a newer prefetch or the plugin was reloaded
+	if (data != prefetched)
+	{
+		prefetched_free(data);
+		return;
+	}
+
+	if (error)
+	{
+		prefetched_free(prefetched);
+		prefetched = NULL;
+		return;
+	}
+
+	data->actions = g_variant_ref(return_value);
+}
+
+
+static void send_prefetch_request(LspServer *srv, GeanyDocument *doc, G_GNUC_UNUSED gint pos)
+{
+	gint caret_pos = sci_get_current_position(doc->editor->sci);
+	GVariant *diag_raw;
+	GVariant *node;
+
+	if (doc != document_get_current())
+		return;
+
+	// actions are only requested for diagnostics, like for the context menu
+	diag_raw = lsp_diagnostics_get_diag_raw(caret_pos);
+	if (!diag_raw)
+		return;
+
+	lsp_sync_flush_doc_changes(doc);
+	if (prefetched_valid(doc, caret_pos, diag_raw))
+		return;
+
+	// a pending response of the previous prefetch frees its data itself
+	if (prefetched && prefetched->actions)
+		prefetched_free(prefetched);
+	prefetched = g_new0(PrefetchedActions, 1);
+	prefetched->doc_id = doc->id;
+	prefetched->version = lsp_sync_get_doc_version(doc);
+	prefetched->line = sci_get_line_from_position(doc->editor->sci, caret_pos);
+	prefetched->diag_raw = g_variant_ref(diag_raw);
+
+	node = create_code_action_request(doc, caret_pos, diag_raw);
+	lsp_rpc_call(srv, "textDocument/codeAction", node, prefetch_cb, prefetched);
+	g_variant_unref(node);
+}
+
+
+/* Requests the code actions of the caret line once typing or caret movement
+ * pauses so the context menu can show them immediately. */
+void lsp_command_prefetch_code_actions(GeanyDocument *doc)
+{
+	LspServer *srv = lsp_server_get_if_running(doc);
+
+	if (!srv || !srv->config.code_action_prefetch_enable || !doc->real_path)
+		return;
+
+	lsp_scheduler_schedule(srv, LspSchedCodeActions, doc, 0, send_prefetch_request);
 }
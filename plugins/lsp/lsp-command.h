@@ -37,5 +37,6 @@ void lsp_command_send_code_action_init(void);
 void lsp_command_send_code_action_destroy(void);
 void lsp_command_send_code_action_request(gint pos, GCallback actions_resolved_cb);
 GPtrArray *lsp_command_get_resolved_code_actions(void);
+void lsp_command_prefetch_code_actions(GeanyDocument *doc);
 
 #endif  /* LSP_COMMAND_H */
@@ -22,20 +22,29 @@
 
 #include "lsp/lsp-diagnostics.h"
 #include "lsp/lsp-utils.h"
+#include "lsp/lsp-rpc.h"
+#include "lsp/lsp-sync.h"
+#include "lsp/lsp-scheduler.h"
+#include "lsp/lsp-command.h"
 
 #include <jsonrpc-glib.h>
 
+#include <string.h>
+
 
 static GHashTable *diag_table = NULL;
+// paths in diag_table, most recently updated first
+static GQueue *diag_paths = NULL;
 static ScintillaObject *calltip_sci;
 
 
 typedef struct {
 	LspRange range;
-	gchar *code;
-	gchar *source;
+	const gchar *code;  // interned
+	const gchar *source;  // interned
 	gchar *message;
 	gint severity;
+	// only kept for open documents, created on demand for code actions otherwise
 	GVariant *diag_raw;
 } LspDiag;
 
@@ -50,15 +59,60 @@ typedef enum {
 } LspDiagSeverity;
 
 
+typedef struct {
+	gint start;
+	gint end;
+	gint max_end;  // maximum end of this and all preceding entries
+	gint pos;  // diagnostic start used for navigation
+	gboolean painted;  // indicator set or not needed
+	LspDiag *diag;
+} DiagIndexEntry;
+
+
+/* Diagnostics of a document in Scintilla positions sorted by start, kept up to
+ * date by lsp_diagnostics_text_modified() until new diagnostics arrive */
+typedef struct {
+	ScintillaObject *sci;
+	GPtrArray *diags;  // the array the index was built from
+	GArray *entries;  // DiagIndexEntry
+	guint paint_source_id;
+	guint paint_next;  // entries before are all painted
+} DiagIndex;
+
+
+/* State of pulled (textDocument/diagnostic) diagnostics of an open document */
+typedef struct {
+	gchar *result_id;  // of the last report, sent so the server can answer "unchanged"
+	guint version;  // document version of the last report, 0 if none
+} PullState;
+
+
+typedef struct {
+	guint doc_id;
+	guint version;
+	gboolean background;
+} PullRequest;
+
+
 static gint style_indices[LSP_DIAG_SEVERITY_MAX];
 
+static GQuark diag_index_quark;
+static GQuark pull_state_quark;
+
+// ids of the open documents whose diagnostics are pulled in the background
+static GQueue *pull_queue = NULL;
+static guint pull_source_id = 0;
+static gboolean pull_in_flight = FALSE;
+
+// indicators painted per idle callback after the visible part
+#define PAINT_CHUNK_SIZE 500
+
 
 static void diag_free(LspDiag *diag)
 {
-	g_free(diag->code);
-	g_free(diag->source);
 	g_free(diag->message);
-	g_variant_unref(diag->diag_raw);
+	if (diag->diag_raw)
+		g_variant_unref(diag->diag_raw);
 	g_free(diag);
 }
 
@@ -69,11 +123,29 @@ static void array_free(GPtrArray *arr)
 }
 
 
+static void diag_index_free(DiagIndex *index)
+{
+	if (index->paint_source_id)
+		g_source_remove(index->paint_source_id);
+	g_ptr_array_unref(index->diags);
+	g_array_free(index->entries, TRUE);
+	g_free(index);
+}
+
+
 void lsp_diagnostics_init(void)
 {
 	if (!diag_table)
 		diag_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)array_free);
 	g_hash_table_remove_all(diag_table);
+
+	if (!diag_paths)
+		diag_paths = g_queue_new();
+	g_queue_clear_full(diag_paths, g_free);
+
+	if (!pull_queue)
+		pull_queue = g_queue_new();
+	g_queue_clear(pull_queue);
 }
 
 
@@ -82,114 +154,360 @@ void lsp_diagnostics_destroy(void)
 	if (diag_table)
 		g_hash_table_destroy(diag_table);
 	diag_table = NULL;
+	if (diag_paths)
+		g_queue_free_full(diag_paths, g_free);
+	diag_paths = NULL;
 	calltip_sci = NULL;
+
+	if (pull_source_id)
+		g_source_remove(pull_source_id);
+	pull_source_id = 0;
+	if (pull_queue)
+		g_queue_free(pull_queue);
+	pull_queue = NULL;
+	pull_in_flight = FALSE;
 }
 
 
-static LspDiag *get_diag(gint pos, gint where)
+static gsize get_diags_size(GPtrArray *diags)
 {
-	GeanyDocument *doc = document_get_current();
-	LspDiag *previous_diag = NULL;
+	gsize size = sizeof(GPtrArray) + diags->len * sizeof(gpointer);
+	guint i;
+
+	for (i = 0; i < diags->len; i++)
+	{
+		LspDiag *diag = diags->pdata[i];
+
+		size += sizeof(LspDiag);
+		if (diag->message)
+			size += strlen(diag->message) + 1;
+		if (diag->diag_raw)
+			size += g_variant_get_size(diag->diag_raw);
+	}
+
+	return size;
+}
+
+
+// returns the size of the diagnostics of doc, or of all files if doc is NULL
+gsize lsp_diagnostics_get_memory_size(GeanyDocument *doc)
+{
+	GHashTableIter iter;
+	gpointer diags;
+	gsize size = 0;
+
+	if (!diag_table)
+		return 0;
+
+	if (doc)
+	{
+		diags = doc->real_path ? g_hash_table_lookup(diag_table, doc->real_path) : NULL;
+		return diags ? get_diags_size(diags) : 0;
+	}
+
+	g_hash_table_iter_init(&iter, diag_table);
+	while (g_hash_table_iter_next(&iter, NULL, &diags))
+		size += get_diags_size(diags);
+
+	return size;
+}
+
+
+static gint sort_index_entries(gconstpointer a, gconstpointer b)
+{
+	const DiagIndexEntry *e1 = a;
+	const DiagIndexEntry *e2 = b;
+
+	if (e1->start != e2->start)
+		return e1->start - e2->start;
+	return e1->diag->severity - e2->diag->severity;
+}
+
+
+static DiagIndex *diag_index_new(ScintillaObject *sci, GPtrArray *diags)
+{
+	DiagIndex *index = g_new0(DiagIndex, 1);
+	gint max_end = 0;
+	guint i;
+
+	index->sci = sci;
+	index->diags = g_ptr_array_ref(diags);
+	index->entries = g_array_sized_new(FALSE, FALSE, sizeof(DiagIndexEntry), diags->len);
+
+	for (i = 0; i < diags->len; i++)
+	{
+		DiagIndexEntry entry;
+
+		entry.diag = diags->pdata[i];
+		entry.start = lsp_utils_lsp_pos_to_scintilla(sci, entry.diag->range.start);
+		entry.end = lsp_utils_lsp_pos_to_scintilla(sci, entry.diag->range.end);
+		entry.pos = entry.start;
+		entry.painted = FALSE;
+
+		if (entry.start == entry.end)
+		{
+			entry.start = SSM(sci, SCI_POSITIONBEFORE, entry.start, 0);
+			entry.end = SSM(sci, SCI_POSITIONAFTER, entry.end, 0);
+		}
+
+		g_array_append_val(index->entries, entry);
+	}
+
+	// expanding empty ranges may move the start before the previous diagnostic
+	g_array_sort(index->entries, sort_index_entries);
+
+	for (i = 0; i < index->entries->len; i++)
+	{
+		DiagIndexEntry *entry = &g_array_index(index->entries, DiagIndexEntry, i);
+
+		max_end = MAX(max_end, entry->end);
+		entry->max_end = max_end;
+	}
+
+	return index;
+}
+
+
+static DiagIndex *get_diag_index_full(GeanyDocument *doc)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	DiagIndex *index;
 	GPtrArray *diags;
-	gint i;
 
-	if (!doc || !doc->real_path)
+	if (!doc->real_path)
 		return NULL;
 
+	if (!diag_index_quark)
+		diag_index_quark = g_quark_from_static_string("lsp-diag-index");
+
 	diags = g_hash_table_lookup(diag_table, doc->real_path);
 	if (!diags)
+	{
+		g_object_set_qdata(G_OBJECT(sci), diag_index_quark, NULL);
 		return NULL;
+	}
 
-	for (i = 0; i < diags->len; i++)
+	index = g_object_get_qdata(G_OBJECT(sci), diag_index_quark);
+	if (!index || index->diags != diags)
 	{
-		ScintillaObject *sci = doc->editor->sci;
-		LspDiag *diag = diags->pdata[i];
-		gint start_pos = lsp_utils_lsp_pos_to_scintilla(sci, diag->range.start);
-		gint end_pos = lsp_utils_lsp_pos_to_scintilla(sci, diag->range.end);
+		index = diag_index_new(sci, diags);
+		g_object_set_qdata_full(G_OBJECT(sci), diag_index_quark, index,
+			(GDestroyNotify)diag_index_free);
+	}
 
-		if (start_pos == end_pos)
-		{
-			start_pos = SSM(sci, SCI_POSITIONBEFORE, start_pos, 0);
-			end_pos = SSM(sci, SCI_POSITIONAFTER, end_pos, 0);
-		}
+	return index;
+}
 
-		if (where == 0)  // at the position
-		{
-			if (pos >= start_pos && pos <= end_pos)
-				return diag;
-		}
-		else if (where == 1)  // after position
-		{
-			if (start_pos > pos)
-				return diag;
-		}
-		else if (where == -1)  // before position
-		{
-			if (end_pos < pos)
-				previous_diag = diag;
-			else
-				break;
-		}
+
+static GArray *get_diag_index(GeanyDocument *doc)
+{
+	DiagIndex *index = get_diag_index_full(doc);
+
+	return index ? index->entries : NULL;
+}
+
+
+/* index of the first entry whose max_end >= pos - as max_end is non-decreasing,
+ * this is also the first entry whose end >= pos */
+static guint find_first_ending_at_or_after(GArray *entries, gint pos)
+{
+	guint low = 0, high = entries->len;
+
+	while (low < high)
+	{
+		guint mid = low + (high - low) / 2;
+
+		if (g_array_index(entries, DiagIndexEntry, mid).max_end < pos)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+
+/* index of the first entry whose start > pos */
+static guint find_first_starting_after(GArray *entries, gint pos)
+{
+	guint low = 0, high = entries->len;
+
+	while (low < high)
+	{
+		guint mid = low + (high - low) / 2;
+
+		if (g_array_index(entries, DiagIndexEntry, mid).start <= pos)
+			low = mid + 1;
+		else
+			high = mid;
 	}
+	return low;
+}
+
+
+static DiagIndexEntry *get_diag(gint pos, gint where)
+{
+	GeanyDocument *doc = document_get_current();
+	GArray *entries;
+	guint i;
+
+	if (!doc)
+		return NULL;
+
+	entries = get_diag_index(doc);
+	if (!entries)
+		return NULL;
 
-	if (previous_diag)
-		return previous_diag;
+	if (where == 0)  // at the position
+	{
+		i = find_first_ending_at_or_after(entries, pos);
+		if (i < find_first_starting_after(entries, pos))
+			return &g_array_index(entries, DiagIndexEntry, i);
+	}
+	else if (where == 1)  // after position
+	{
+		i = find_first_starting_after(entries, pos);
+		if (i < entries->len)
+			return &g_array_index(entries, DiagIndexEntry, i);
+	}
+	else if (where == -1)  // before position
+	{
+		i = find_first_ending_at_or_after(entries, pos);
+		if (i > 0)
+			return &g_array_index(entries, DiagIndexEntry, i - 1);
+	}
 
 	return NULL;
 }
 
 
+static gint shift_pos(gint pos, SCNotification *nt)
+{
+	if (nt->modificationType & SC_MOD_INSERTTEXT)
+	{
+		if (pos >= nt->position)
+			return pos + nt->length;
+	}
+	else if (pos > nt->position + nt->length)
+		return pos - nt->length;
+	else if (pos > nt->position)
+		return nt->position;
+
+	return pos;
+}
+
+
+void lsp_diagnostics_text_modified(ScintillaObject *sci, SCNotification *nt)
+{
+	DiagIndex *index;
+	guint i;
+
+	if (!(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) || !diag_index_quark)
+		return;
+
+	index = g_object_get_qdata(G_OBJECT(sci), diag_index_quark);
+	if (!index)
+		return;
+
+	// shifting is monotonic so the order and max_end of entries remain valid
+	for (i = find_first_ending_at_or_after(index->entries, nt->position);
+		i < index->entries->len; i++)
+	{
+		DiagIndexEntry *entry = &g_array_index(index->entries, DiagIndexEntry, i);
+
+		entry->start = shift_pos(entry->start, nt);
+		entry->end = shift_pos(entry->end, nt);
+		entry->max_end = shift_pos(entry->max_end, nt);
+		entry->pos = shift_pos(entry->pos, nt);
+	}
+}
+
+
 gboolean lsp_diagnostics_has_diag(gint pos)
 {
 	return get_diag(pos, 0) != NULL;
 }
 
 
+static GVariant *diag_to_variant(LspDiag *diag)
+{
+	GVariant *range;
+	GVariantDict dict;
+
+	range = JSONRPC_MESSAGE_NEW(
+		"start", "{",
+			"line", JSONRPC_MESSAGE_PUT_INT64(diag->range.start.line),
+			"character", JSONRPC_MESSAGE_PUT_INT64(diag->range.start.character),
+		"}",
+		"end", "{",
+			"line", JSONRPC_MESSAGE_PUT_INT64(diag->range.end.line),
+			"character", JSONRPC_MESSAGE_PUT_INT64(diag->range.end.character),
+		"}"
+	);
+
+	g_variant_dict_init(&dict, NULL);
+	g_variant_dict_insert_value(&dict, "range", range);
+	g_variant_dict_insert_value(&dict, "message", g_variant_new_string(diag->message ? diag->message : ""));
+	if (diag->severity > 0)
+		g_variant_dict_insert_value(&dict, "severity", g_variant_new_int64(diag->severity));
+	if (diag->code)
+		g_variant_dict_insert_value(&dict, "code", g_variant_new_string(diag->code));
+	if (diag->source)
+		g_variant_dict_insert_value(&dict, "source", g_variant_new_string(diag->source));
+
+	g_variant_unref(range);
+
+	return g_variant_take_ref(g_variant_dict_end(&dict));
+}
+
+
 GVariant *lsp_diagnostics_get_diag_raw(gint pos)
 {
-	LspDiag *diag = get_diag(pos, 0);
+	DiagIndexEntry *entry = get_diag(pos, 0);
 
-	if (diag)
-		return diag->diag_raw;
-	return NULL;
+	if (!entry)
+		return NULL;
+
+	// diagnostics received while the document wasn't open - the reconstructed
+	// diagnostic lacks extra fields like "data" but is still a valid one
+	if (!entry->diag->diag_raw)
+		entry->diag->diag_raw = diag_to_variant(entry->diag);
+
+	return entry->diag->diag_raw;
 }
 
 
 void lsp_diagnostics_goto_next_diag(gint pos)
 {
 	GeanyDocument *doc = document_get_current();
-	LspDiag *diag = get_diag(pos, 1);
+	DiagIndexEntry *entry = get_diag(pos, 1);
 
-	if (doc && diag)
-	{
-		gint start_pos = lsp_utils_lsp_pos_to_scintilla(doc->editor->sci, diag->range.start);
-		sci_set_current_position(doc->editor->sci, start_pos, TRUE);
-	}
+	if (doc && entry)
+		sci_set_current_position(doc->editor->sci, entry->pos, TRUE);
 }
 
 
 void lsp_diagnostics_goto_prev_diag(gint pos)
 {
 	GeanyDocument *doc = document_get_current();
-	LspDiag *diag = get_diag(pos, -1);
+	DiagIndexEntry *entry = get_diag(pos, -1);
 
-	if (doc && diag)
-	{
-		gint start_pos = lsp_utils_lsp_pos_to_scintilla(doc->editor->sci, diag->range.start);
-		sci_set_current_position(doc->editor->sci, start_pos, TRUE);
-	}
+	if (doc && entry)
+		sci_set_current_position(doc->editor->sci, entry->pos, TRUE);
 }
 
 
 void lsp_diagnostics_show_calltip(gint pos)
 {
-	LspDiag *diag = get_diag(pos, 0);
+	DiagIndexEntry *entry = get_diag(pos, 0);
+	LspDiag *diag;
 	gchar *first = NULL;
 	gchar *second;
 
-	if (!diag)
+	if (!entry)
 		return;
 
+	diag = entry->diag;
+
 	second = diag->message;
 
 	if (diag->code && diag->source)
@@ -235,45 +553,116 @@ static void clear_indicators(ScintillaObject *sci)
 }
 
 
+static void paint_entry(DiagIndex *index, DiagIndexEntry *entry)
+{
+	if (entry->painted)
+		return;
+
+	if (entry->end > entry->start)
+	{
+		SSM(index->sci, SCI_SETINDICATORCURRENT, style_indices[entry->diag->severity], 0);
+		SSM(index->sci, SCI_INDICATORFILLRANGE, entry->start, entry->end - entry->start);
+	}
+	entry->painted = TRUE;
+}
+
+
+static void paint_range(DiagIndex *index, gint start_pos, gint end_pos)
+{
+	guint i;
+
+	for (i = find_first_ending_at_or_after(index->entries, start_pos); i < index->entries->len; i++)
+	{
+		DiagIndexEntry *entry = &g_array_index(index->entries, DiagIndexEntry, i);
+
+		if (entry->start > end_pos)
+			break;
+		paint_entry(index, entry);
+	}
+}
+
+
+static void paint_visible(DiagIndex *index)
+{
+	ScintillaObject *sci = index->sci;
+	gint first_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0), 0);
+	gint last_line = MIN(sci_get_line_count(sci) - 1, first_line + SSM(sci, SCI_LINESONSCREEN, 0, 0));
+
+	paint_range(index, sci_get_position_from_line(sci, first_line),
+		sci_get_line_end_position(sci, last_line));
+}
+
+
+static gboolean paint_chunk_cb(gpointer user_data)
+{
+	DiagIndex *index = user_data;
+	guint painted = 0;
+
+	for (; index->paint_next < index->entries->len && painted < PAINT_CHUNK_SIZE; index->paint_next++)
+	{
+		DiagIndexEntry *entry = &g_array_index(index->entries, DiagIndexEntry, index->paint_next);
+
+		if (!entry->painted)
+		{
+			paint_entry(index, entry);
+			painted++;
+		}
+	}
+
+	if (index->paint_next < index->entries->len)
+		return G_SOURCE_CONTINUE;
+
+	index->paint_source_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+
+/* Only the visible part is painted immediately, the rest is painted from idle
+ * in chunks so bursts of diagnostics don't block typing. */
 void lsp_diagnostics_redraw(GeanyDocument *doc)
 {
 	LspServerConfig *cfg = lsp_server_get_config(doc);
-	ScintillaObject *sci;
-	GPtrArray *diags;
+	DiagIndex *index;
 	gint last_start_pos = 0, last_end_pos = 0;
-	gint i;
+	guint i;
 
 	if (!doc || !doc->real_path || !cfg)
 		return;
 
-	sci = doc->editor->sci;
+	clear_indicators(doc->editor->sci);
 
-	clear_indicators(sci);
-
-	diags = g_hash_table_lookup(diag_table, doc->real_path);
-	if (!diags || !cfg->diagnostics_enable)
+	index = get_diag_index_full(doc);
+	if (!index || !cfg->diagnostics_enable)
 		return;
 
-	for (i = 0; i < diags->len; i++)
+	for (i = 0; i < index->entries->len; i++)
 	{
-		LspDiag *diag = diags->pdata[i];
-		gint start_pos = lsp_utils_lsp_pos_to_scintilla(sci, diag->range.start);
-		gint end_pos = lsp_utils_lsp_pos_to_scintilla(sci, diag->range.end);
-
-		if (start_pos == end_pos)
-		{
-			start_pos = SSM(sci, SCI_POSITIONBEFORE, start_pos, 0);
-			end_pos = SSM(sci, SCI_POSITIONAFTER, end_pos, 0);
-		}
+		DiagIndexEntry *entry = &g_array_index(index->entries, DiagIndexEntry, i);
 
-		if (start_pos != last_start_pos || end_pos != last_end_pos)
-		{
-			editor_indicator_set_on_range(doc->editor, style_indices[diag->severity],
-				start_pos, end_pos);
-			last_start_pos = start_pos;
-			last_end_pos = end_pos;
-		}
+		// for identical ranges only the first, most severe, diagnostic is shown
+		entry->painted = entry->start == last_start_pos && entry->end == last_end_pos;
+		last_start_pos = entry->start;
+		last_end_pos = entry->end;
 	}
+	index->paint_next = 0;
+
+	paint_visible(index);
+
+	if (!index->paint_source_id)
+		index->paint_source_id = g_idle_add_full(G_PRIORITY_LOW, paint_chunk_cb, index, NULL);
+}
+
+
+void lsp_diagnostics_paint_visible(GeanyDocument *doc)
+{
+	DiagIndex *index;
+
+	if (!doc || !diag_index_quark)
+		return;
+
+	index = g_object_get_qdata(G_OBJECT(doc->editor->sci), diag_index_quark);
+	if (index && index->paint_source_id)
+		paint_visible(index);
 }
 
 
@@ -315,31 +704,74 @@ static gint sort_diags(gconstpointer a, gconstpointer b)
 }
 
 
-void lsp_diagnostics_received(GVariant* diags)
+static void touch_path(const gchar *real_path)
 {
-	GeanyDocument *doc = document_get_current();;
-	GVariantIter *iter = NULL;
-	const gchar *uri = NULL;
-	gchar *real_path;
-	GVariant *diag = NULL;
-	GPtrArray *arr;
+	GList *link = g_queue_find_custom(diag_paths, real_path, (GCompareFunc)g_strcmp0);
 
-	JSONRPC_MESSAGE_PARSE(diags,
-		"uri", JSONRPC_MESSAGE_GET_STRING(&uri),
-		"diagnostics", JSONRPC_MESSAGE_GET_ITER(&iter)
-		);
+	if (link)
+		g_queue_unlink(diag_paths, link);
+	else
+		link = g_list_alloc();
 
-	if (!iter)
-		return;
+	if (!link->data)
+		link->data = g_strdup(real_path);
+	g_queue_push_head_link(diag_paths, link);
+}
 
-	real_path = lsp_utils_get_real_path_from_uri_locale(uri);
 
-	if (!real_path)
+static void remove_path(const gchar *real_path)
+{
+	GList *link = g_queue_find_custom(diag_paths, real_path, (GCompareFunc)g_strcmp0);
+
+	if (link)
 	{
-		g_variant_iter_free(iter);
+		g_free(link->data);
+		g_queue_delete_link(diag_paths, link);
+	}
+	g_hash_table_remove(diag_table, real_path);
+}
+
+
+/* drops diagnostics of the least recently updated files which aren't open */
+static void evict_background_files(gint max_num)
+{
+	GList *link, *prev;
+	gint num = 0;
+
+	if (max_num <= 0)
 		return;
+
+	for (link = diag_paths->head; link; link = link->next)
+	{
+		if (!document_find_by_real_path(link->data))
+			num++;
+	}
+
+	for (link = diag_paths->tail; link && num > max_num; link = prev)
+	{
+		prev = link->prev;
+
+		if (!document_find_by_real_path(link->data))
+		{
+			g_hash_table_remove(diag_table, link->data);
+			g_free(link->data);
+			g_queue_delete_link(diag_paths, link);
+			num--;
+		}
 	}
+}
 
+
+/* Replaces the diagnostics of real_path by those of iter, both for pushed and
+ * pulled diagnostics. */
+static void set_diagnostics(LspServer *srv, const gchar *real_path, GVariantIter *iter)
+{
+	GeanyDocument *doc = document_get_current();
+	GVariant *diag = NULL;
+	gboolean is_open;
+	GPtrArray *arr;
+
+	is_open = document_find_by_real_path(real_path) != NULL;
 	arr = g_ptr_array_new_full(10, (GDestroyNotify)diag_free);
 
 	while (g_variant_iter_next(iter, "v", &diag))
@@ -350,36 +782,318 @@ void lsp_diagnostics_received(GVariant* diags)
 		const gchar *message = NULL;
 		gint64 severity = 0;
 		LspDiag *lsp_diag;
+		LspField fields[] = {
+			{"code", LspFieldString, &code},
+			{"source", LspFieldString, &source},
+			{"message", LspFieldString, &message},
+			{"severity", LspFieldInt64, &severity},
+			{"range", LspFieldVariant, &range}
+		};
 
-		JSONRPC_MESSAGE_PARSE(diag, "code", JSONRPC_MESSAGE_GET_STRING(&code));
-		JSONRPC_MESSAGE_PARSE(diag, "source", JSONRPC_MESSAGE_GET_STRING(&source));
-		JSONRPC_MESSAGE_PARSE(diag, "message", JSONRPC_MESSAGE_GET_STRING(&message));
-		JSONRPC_MESSAGE_PARSE(diag, "severity", JSONRPC_MESSAGE_GET_INT64(&severity));
-		JSONRPC_MESSAGE_PARSE(diag, "range", JSONRPC_MESSAGE_GET_VARIANT(&range));
+		lsp_utils_parse_fields(diag, fields, G_N_ELEMENTS(fields));
 
 		lsp_diag = g_new0(LspDiag, 1);
-		lsp_diag->code = g_strdup(code);
-		lsp_diag->source = g_strdup(source);
+		lsp_diag->code = g_intern_string(code);
+		lsp_diag->source = g_intern_string(source);
 		lsp_diag->message = g_strdup(message);
 		lsp_diag->severity = severity;
 		lsp_diag->range = lsp_utils_parse_range(range);
-		lsp_diag->diag_raw = diag;
+
+		if (is_open)
+			lsp_diag->diag_raw = diag;
+		else
+			g_variant_unref(diag);
+
+		if (range)
+			g_variant_unref(range);
 
 		g_ptr_array_add(arr, lsp_diag);
 	}
 
-	g_ptr_array_sort(arr, sort_diags);
-
-	g_hash_table_insert(diag_table, g_strdup(real_path), arr);
+	if (arr->len > 0)
+	{
+		g_ptr_array_sort(arr, sort_diags);
+		g_hash_table_insert(diag_table, g_strdup(real_path), arr);
+		touch_path(real_path);
+		evict_background_files(srv->config.diagnostics_background_files_max);
+	}
+	else
+	{
+		g_ptr_array_free(arr, TRUE);
+		remove_path(real_path);
+	}
 
 	if (doc && doc->real_path && g_strcmp0(doc->real_path, real_path) == 0)
+	{
 		lsp_diagnostics_redraw(doc);
+		// the quick fixes of the new diagnostics
+		lsp_command_prefetch_code_actions(doc);
+	}
+}
+
+
+void lsp_diagnostics_received(LspServer *srv, GVariant* diags)
+{
+	GVariantIter *iter = NULL;
+	const gchar *uri = NULL;
+	gchar *real_path;
+
+	JSONRPC_MESSAGE_PARSE(diags,
+		"uri", JSONRPC_MESSAGE_GET_STRING(&uri),
+		"diagnostics", JSONRPC_MESSAGE_GET_ITER(&iter)
+		);
+
+	if (!iter)
+		return;
+
+	real_path = lsp_utils_get_real_path_from_uri_locale(uri);
+	if (real_path)
+		set_diagnostics(srv, real_path, iter);
 
 	g_variant_iter_free(iter);
 	g_free(real_path);
 }
 
 
+static void pull_state_free(PullState *state)
+{
+	g_free(state->result_id);
+	g_free(state);
+}
+
+
+static PullState *get_pull_state(GeanyDocument *doc)
+{
+	PullState *state;
+
+	if (!pull_state_quark)
+		pull_state_quark = g_quark_from_static_string("lsp-diag-pull-state");
+
+	state = g_object_get_qdata(G_OBJECT(doc->editor->sci), pull_state_quark);
+	if (!state)
+	{
+		state = g_new0(PullState, 1);
+		g_object_set_qdata_full(G_OBJECT(doc->editor->sci), pull_state_quark, state,
+			(GDestroyNotify)pull_state_free);
+	}
+
+	return state;
+}
+
+
+static LspServer *get_pull_server(GeanyDocument *doc)
+{
+	LspServer *srv = lsp_server_get_if_running(doc);
+
+	if (!srv || !srv->supports_pull_diagnostics || !srv->config.diagnostics_enable ||
+		!doc->real_path)
+		return NULL;
+	return srv;
+}
+
+
+/* Whether the diagnostics of doc may differ from the last pulled ones. With
+ * inter-file dependencies, edits of other documents may change them too - the
+ * server answers "unchanged" for the previous result id then. */
+static gboolean needs_pull(LspServer *srv, GeanyDocument *doc)
+{
+	PullState *state = get_pull_state(doc);
+
+	// the version is only increased when the pending changes are sent
+	lsp_sync_flush_doc_changes(doc);
+	return srv->diagnostics_inter_file || state->version != lsp_sync_get_doc_version(doc);
+}
+
+
+static void send_pull_request(LspServer *srv, GeanyDocument *doc, gboolean background);
+
+
+static gboolean pull_next_cb(G_GNUC_UNUSED gpointer user_data)
+{
+	pull_source_id = 0;
+
+	while (!g_queue_is_empty(pull_queue))
+	{
+		GeanyDocument *doc = document_find_by_id(GPOINTER_TO_UINT(g_queue_pop_head(pull_queue)));
+		LspServer *srv = doc ? get_pull_server(doc) : NULL;
+
+		if (srv && needs_pull(srv, doc))
+		{
+			send_pull_request(srv, doc, TRUE);
+			break;
+		}
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+
+static void schedule_next_pull(void)
+{
+	if (!pull_in_flight && !pull_source_id && !g_queue_is_empty(pull_queue))
+		pull_source_id = g_idle_add_full(G_PRIORITY_LOW, pull_next_cb, NULL, NULL);
+}
+
+
+/* Pulls the diagnostics of the other open documents of srv one by one so they
+ * don't delay the requests for the current document. */
+static void pull_background(LspServer *srv, GeanyDocument *current)
+{
+	guint i;
+
+	g_queue_clear(pull_queue);
+
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+
+		if (doc != current && get_pull_server(doc) == srv && lsp_sync_is_document_open(doc) &&
+			needs_pull(srv, doc))
+		{
+			g_queue_push_tail(pull_queue, GUINT_TO_POINTER(doc->id));
+		}
+	}
+
+	schedule_next_pull();
+}
+
+
+static void pull_cb(GVariant *return_value, GError *error, gpointer user_data)
+{
+	PullRequest *data = user_data;
+	GeanyDocument *doc = document_find_by_id(data->doc_id);
+	LspServer *srv = doc ? get_pull_server(doc) : NULL;
+
+	//printf("%s
+
+
+", lsp_utils_json_pretty_print(return_value));
+
+	if (data->background)
+		pull_in_flight = FALSE;
+
+	if (!error && srv && pull_queue)
+	{
+		PullState *state = get_pull_state(doc);
+		GVariantIter *iter = NULL;
+		const gchar *kind = NULL;
+		const gchar *result_id = NULL;
+
+		JSONRPC_MESSAGE_PARSE(return_value, "kind", JSONRPC_MESSAGE_GET_STRING(&kind));
+		JSONRPC_MESSAGE_PARSE(return_value, "resultId", JSONRPC_MESSAGE_GET_STRING(&result_id));
+
+		if (g_strcmp0(kind, "full") == 0)
+		{
+			JSONRPC_MESSAGE_PARSE(return_value, "items", JSONRPC_MESSAGE_GET_ITER(&iter));
+			if (iter)
+			{
+				set_diagnostics(srv, doc->real_path, iter);
+				g_variant_iter_free(iter);
+			}
+		}
+
+		// for "unchanged" the diagnostics we have are still valid
+		if (g_strcmp0(kind, "full") == 0 || g_strcmp0(kind, "unchanged") == 0)
+		{
+			g_free(state->result_id);
+			state->result_id = g_strdup(result_id);
+			state->version = data->version;
+
+			if (!data->background)
+				pull_background(srv, doc);
+		}
+	}
+
+	// also continue after cancelled or failed requests
+	if (data->background && pull_queue)
+		schedule_next_pull();
+
+	g_free(data);
+}
+
+
+static void send_pull_request(LspServer *srv, GeanyDocument *doc, gboolean background)
+{
+	PullState *state = get_pull_state(doc);
+	PullRequest *data;
+	gchar *doc_uri;
+	GVariant *node;
+
+	/* Geany requests symbols before firing "document-activate" signal so we may
+	 * need to request document opening here */
+	if (!lsp_sync_is_document_open(doc))
+		lsp_sync_text_document_did_open(srv, doc);
+
+	doc_uri = lsp_utils_get_doc_uri(doc);
+
+	if (state->result_id)
+	{
+		node = JSONRPC_MESSAGE_NEW(
+			"previousResultId", JSONRPC_MESSAGE_PUT_STRING(state->result_id),
+			"textDocument", "{",
+				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+			"}"
+		);
+	}
+	else
+	{
+		node = JSONRPC_MESSAGE_NEW(
+			"textDocument", "{",
+				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+			"}"
+		);
+	}
+
+	data = g_new0(PullRequest, 1);
+	data->doc_id = doc->id;
+	data->version = lsp_sync_get_doc_version(doc);
+	data->background = background;
+	if (background)
+		pull_in_flight = TRUE;
+
+	lsp_rpc_call_superseding(srv, "textDocument/diagnostic", node, doc, pull_cb, data);
+
+	g_free(doc_uri);
+	g_variant_unref(node);
+}
+
+
+static void send_request(LspServer *srv, GeanyDocument *doc, G_GNUC_UNUSED gint pos)
+{
+	if (get_pull_server(doc) == srv && needs_pull(srv, doc))
+		send_pull_request(srv, doc, FALSE);
+}
+
+
+static void server_ready_cb(GeanyDocument *doc, G_GNUC_UNUSED gpointer user_data)
+{
+	// document may not be current any more
+	if (doc == document_get_current())
+		lsp_diagnostics_send_request(doc);
+}
+
+
+/* Pulls the diagnostics of doc, the current document, once the request delay
+ * passes without another call, e.g. when typing pauses. Does nothing for servers
+ * which only push diagnostics. */
+void lsp_diagnostics_send_request(GeanyDocument *doc)
+{
+	LspServer *srv = lsp_server_get_if_running(doc);
+
+	if (!srv)
+	{
+		// happens when Geany and LSP server started - send the request once the server is ready
+		lsp_server_when_ready(doc, server_ready_cb, NULL, NULL);
+		return;
+	}
+
+	if (get_pull_server(doc) != srv)
+		return;
+
+	lsp_scheduler_schedule(srv, LspSchedDiagnostics, doc, 0, send_request);
+}
+
+
 void lsp_diagnostics_hide_calltip(GeanyDocument *doc)
 {
 	if (doc->editor->sci == calltip_sci)
@@ -29,11 +29,16 @@ void lsp_diagnostics_destroy(void);
 void lsp_diagnostics_show_calltip(gint pos);
 void lsp_diagnostics_hide_calltip(GeanyDocument *doc);
 
-void lsp_diagnostics_received(GVariant* diags);
+void lsp_diagnostics_received(LspServer *srv, GVariant* diags);
+void lsp_diagnostics_send_request(GeanyDocument *doc);
 void lsp_diagnostics_redraw(GeanyDocument *doc);
+void lsp_diagnostics_paint_visible(GeanyDocument *doc);
+void lsp_diagnostics_text_modified(ScintillaObject *sci, SCNotification *nt);
 
 void lsp_diagnostics_style_init(GeanyDocument *doc);
 
+gsize lsp_diagnostics_get_memory_size(GeanyDocument *doc);
+
 gboolean lsp_diagnostics_has_diag(gint pos);
 GVariant *lsp_diagnostics_get_diag_raw(gint pos);
 
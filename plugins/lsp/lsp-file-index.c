@@ -0,0 +1,659 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-file-index.h"
+
+#include <geanyplugin.h>
+#include <gio/gio.h>
+
+#include <string.h>
+
+
+/* List of the files under the project base path, used by goto-anywhere to
+ * open files which aren't open yet. The directories are walked by a
+ * background thread passing the files to the main thread in batches and are
+ * then watched for created and deleted files. Hidden files and directories
+ * are skipped and symbolic links to directories aren't followed.
+ *
+ * The same monitors report the changes of the project files to the LSP
+ * servers, see lsp_file_index_set_changed_callback().
+ *
+ * Every trigram of the normalized basenames points to the files containing
+ * it so a query only verifies the files of its rarest trigram. */
+
+// number of files passed to the main thread at once
+#define BATCH_SIZE 2048
+// don't use up all the inotify watches on huge trees
+#define MAX_MONITORS 4096
+// number of matching files sorted to pick the best ones
+#define MAX_MATCHES 1000
+
+
+typedef struct
+{
+	gchar *path;  // UTF-8, relative to the root
+	gchar *key;  // normalized and casefolded basename
+	gboolean removed;
+} LspIndexedFile;
+
+
+typedef struct
+{
+	GCancellable *cancellable;
+	GPtrArray *files;
+	GPtrArray *dirs;  // locale, absolute
+	gboolean notify;  // report the files as created
+} FileBatch;
+
+
+typedef struct
+{
+	GCancellable *cancellable;
+	gchar *root;
+	gchar *dir;
+	gboolean notify;
+} WalkData;
+
+
+static gchar *index_root = NULL;  // locale, NULL without index
+static gchar *index_root_utf8 = NULL;
+static GPtrArray *files = NULL;  // removed files are only flagged to keep the indices valid
+static GHashTable *file_table = NULL;  // path -> LspIndexedFile, without the removed files
+static GHashTable *trigrams = NULL;  // trigram -> GArray of indices to files
+static GHashTable *monitors = NULL;  // locale dir -> GFileMonitor
+static GCancellable *cancellable = NULL;
+
+static LspFileChangedCallback changed_callback = NULL;
+
+
+static void start_walk(const gchar *dir, gboolean notify);
+
+
+static gchar *normalize_name(const gchar *name)
+{
+	gchar *normalized = g_utf8_normalize(name, -1, G_NORMALIZE_ALL);
+	gchar *ret = g_utf8_casefold(normalized ? normalized : name, -1);
+
+	g_free(normalized);
+	return ret;
+}
+
+
+static guint get_trigram(const gchar *s)
+{
+	return ((guint)(guchar)s[0] << 16) | ((guint)(guchar)s[1] << 8) | (guchar)s[2];
+}
+
+
+// returns UTF-8 path relative to root or NULL when not under root
+static gchar *get_relative_path(const gchar *root, const gchar *locale_path)
+{
+	gsize root_len = strlen(root);
+	gchar *path;
+
+	if (strncmp(locale_path, root, root_len) != 0)
+		return NULL;
+
+	locale_path += root_len;
+	if (root_len > 0 && !G_IS_DIR_SEPARATOR(root[root_len - 1]) &&
+		!G_IS_DIR_SEPARATOR(*locale_path))
+		return NULL;
+	while (G_IS_DIR_SEPARATOR(*locale_path))
+		locale_path++;
+	if (!*locale_path)
+		return NULL;
+
+	path = utils_get_utf8_from_locale(locale_path);
+	if (!g_utf8_validate(path, -1, NULL))
+	{
+		g_free(path);
+		return NULL;
+	}
+	return path;
+}
+
+
+// can be called from the walker threads
+static LspIndexedFile *indexed_file_new(const gchar *root, const gchar *locale_path)
+{
+	gchar *path = get_relative_path(root, locale_path);
+	LspIndexedFile *file;
+	const gchar *base;
+
+	if (!path)
+		return NULL;
+
+	base = path + strlen(path);
+	while (base > path && !G_IS_DIR_SEPARATOR(base[-1]))
+		base--;
+
+	file = g_new0(LspIndexedFile, 1);
+	file->path = path;
+	file->key = normalize_name(base);
+	return file;
+}
+
+
+static void indexed_file_free(gpointer data)
+{
+	LspIndexedFile *file = data;
+
+	g_free(file->path);
+	g_free(file->key);
+	g_free(file);
+}
+
+
+static void posting_free(gpointer data)
+{
+	g_array_free(data, TRUE);
+}
+
+
+static void add_file(LspIndexedFile *file)
+{
+	guint idx = files->len;
+	const gchar *s;
+
+	if (g_hash_table_lookup(file_table, file->path))
+	{
+		indexed_file_free(file);
+		return;
+	}
+
+	g_ptr_array_add(files, file);
+	g_hash_table_insert(file_table, file->path, file);
+
+	for (s = file->key; s[0] && s[1] && s[2]; s++)
+	{
+		gpointer trigram = GUINT_TO_POINTER(get_trigram(s));
+		GArray *posting = g_hash_table_lookup(trigrams, trigram);
+
+		if (!posting)
+		{
+			posting = g_array_new(FALSE, FALSE, sizeof(guint));
+			g_hash_table_insert(trigrams, trigram, posting);
+		}
+		// the same trigram may appear several times in a name
+		if (posting->len == 0 || g_array_index(posting, guint, posting->len - 1) != idx)
+			g_array_append_val(posting, idx);
+	}
+}
+
+
+static gboolean remove_file_in_dir(gpointer key, gpointer value, gpointer user_data)
+{
+	LspIndexedFile *file = value;
+
+	if (!g_str_has_prefix(file->path, user_data))
+		return FALSE;
+
+	file->removed = TRUE;
+	return TRUE;
+}
+
+
+static gboolean remove_monitor_in_dir(gpointer key, gpointer value, gpointer user_data)
+{
+	const gchar *dir = user_data;
+	gsize len = strlen(dir);
+
+	return strncmp(key, dir, len) == 0 && (((gchar *)key)[len] == '\0' ||
+		G_IS_DIR_SEPARATOR(((gchar *)key)[len]));
+}
+
+
+static void remove_path(const gchar *locale_path)
+{
+	gchar *path = get_relative_path(index_root, locale_path);
+	LspIndexedFile *file;
+
+	if (!path)
+		return;
+
+	file = g_hash_table_lookup(file_table, path);
+	if (file)
+	{
+		file->removed = TRUE;
+		g_hash_table_remove(file_table, path);
+	}
+	else
+	{
+		// we don't know what it was, so it may also have been a directory
+		gchar *prefix = g_strconcat(path, G_DIR_SEPARATOR_S, NULL);
+
+		g_hash_table_foreach_remove(file_table, remove_file_in_dir, prefix);
+		g_hash_table_foreach_remove(monitors, remove_monitor_in_dir, (gpointer)locale_path);
+		g_free(prefix);
+	}
+
+	g_free(path);
+}
+
+
+static void on_dir_changed(G_GNUC_UNUSED GFileMonitor *monitor, GFile *file,
+	G_GNUC_UNUSED GFile *other_file, GFileMonitorEvent event,
+	G_GNUC_UNUSED gpointer user_data)
+{
+	gchar *path = g_file_get_path(file);
+	gchar *name = g_file_get_basename(file);
+	gboolean hidden = !name || name[0] == '.';
+
+	if (path)
+	{
+		switch (event)
+		{
+			case G_FILE_MONITOR_EVENT_CREATED:
+				if (g_file_test(path, G_FILE_TEST_IS_SYMLINK) && g_file_test(path, G_FILE_TEST_IS_DIR))
+					break;
+				if (g_file_test(path, G_FILE_TEST_IS_DIR))
+				{
+					if (!hidden)
+						start_walk(path, TRUE);
+				}
+				else if (g_file_test(path, G_FILE_TEST_IS_REGULAR))
+				{
+					LspIndexedFile *indexed_file = hidden ? NULL : indexed_file_new(index_root, path);
+
+					if (indexed_file)
+						add_file(indexed_file);
+					if (changed_callback)
+						changed_callback(path, LspFileCreated);
+				}
+				break;
+
+			case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+				if (changed_callback)
+					changed_callback(path, LspFileChanged);
+				break;
+
+			case G_FILE_MONITOR_EVENT_DELETED:
+				if (!hidden)
+					remove_path(path);
+				if (changed_callback)
+					changed_callback(path, LspFileDeleted);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	g_free(path);
+	g_free(name);
+}
+
+
+static void add_monitor(const gchar *dir)
+{
+	GFileMonitor *monitor;
+	GFile *file;
+
+	if (g_hash_table_size(monitors) >= MAX_MONITORS || g_hash_table_contains(monitors, dir))
+		return;
+
+	file = g_file_new_for_path(dir);
+	monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	g_object_unref(file);
+
+	if (monitor)
+	{
+		g_signal_connect(monitor, "changed", G_CALLBACK(on_dir_changed), NULL);
+		g_hash_table_insert(monitors, g_strdup(dir), monitor);
+	}
+}
+
+
+static FileBatch *file_batch_new(GCancellable *batch_cancellable, gboolean notify)
+{
+	FileBatch *batch = g_new0(FileBatch, 1);
+
+	batch->notify = notify;
+	batch->cancellable = g_object_ref(batch_cancellable);
+	batch->files = g_ptr_array_new();
+	batch->dirs = g_ptr_array_new_with_free_func(g_free);
+	return batch;
+}
+
+
+static gboolean add_batch_idle(gpointer user_data)
+{
+	FileBatch *batch = user_data;
+	guint i;
+
+	// the index may have been destroyed or replaced in the meantime
+	if (g_cancellable_is_cancelled(batch->cancellable))
+		g_ptr_array_foreach(batch->files, (GFunc)indexed_file_free, NULL);
+	else
+	{
+		for (i = 0; i < batch->files->len; i++)
+		{
+			LspIndexedFile *file = batch->files->pdata[i];
+
+			// files of a directory created after the initial walk
+			if (batch->notify && changed_callback)
+			{
+				gchar *utf8_path = g_build_filename(index_root_utf8, file->path, NULL);
+				gchar *locale_path = utils_get_locale_from_utf8(utf8_path);
+
+				changed_callback(locale_path, LspFileCreated);
+				g_free(locale_path);
+				g_free(utf8_path);
+			}
+			add_file(file);
+		}
+		for (i = 0; i < batch->dirs->len; i++)
+			add_monitor(batch->dirs->pdata[i]);
+	}
+
+	g_ptr_array_free(batch->files, TRUE);
+	g_ptr_array_free(batch->dirs, TRUE);
+	g_object_unref(batch->cancellable);
+	g_free(batch);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+static gboolean is_regular_file(GFile *file)
+{
+	gchar *path = g_file_get_path(file);
+	gboolean ret = path && g_file_test(path, G_FILE_TEST_IS_REGULAR);
+
+	g_free(path);
+	return ret;
+}
+
+
+static gpointer walk_thread(gpointer user_data)
+{
+	WalkData *data = user_data;
+	FileBatch *batch = file_batch_new(data->cancellable, data->notify);
+	GQueue *dirs = g_queue_new();
+
+	g_queue_push_tail(dirs, g_file_new_for_path(data->dir));
+
+	while (!g_queue_is_empty(dirs) && !g_cancellable_is_cancelled(data->cancellable))
+	{
+		GFile *dir = g_queue_pop_head(dirs);
+		GFileEnumerator *enumerator;
+		GFileInfo *info;
+
+		enumerator = g_file_enumerate_children(dir,
+			G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+			G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, data->cancellable, NULL);
+		if (!enumerator)
+		{
+			g_object_unref(dir);
+			continue;
+		}
+
+		g_ptr_array_add(batch->dirs, g_file_get_path(dir));
+
+		while ((info = g_file_enumerator_next_file(enumerator, data->cancellable, NULL)))
+		{
+			const gchar *name = g_file_info_get_name(info);
+			GFileType type = g_file_info_get_file_type(info);
+			GFile *child;
+
+			if (name[0] == '.')
+			{
+				g_object_unref(info);
+				continue;
+			}
+
+			child = g_file_get_child(dir, name);
+			if (type == G_FILE_TYPE_DIRECTORY)
+				g_queue_push_tail(dirs, g_object_ref(child));
+			else if (type == G_FILE_TYPE_REGULAR ||
+				(type == G_FILE_TYPE_SYMBOLIC_LINK && is_regular_file(child)))
+			{
+				gchar *path = g_file_get_path(child);
+				LspIndexedFile *file = path ? indexed_file_new(data->root, path) : NULL;
+
+				if (file)
+					g_ptr_array_add(batch->files, file);
+				g_free(path);
+			}
+			g_object_unref(child);
+			g_object_unref(info);
+
+			if (batch->files->len >= BATCH_SIZE)
+			{
+				g_idle_add(add_batch_idle, batch);
+				batch = file_batch_new(data->cancellable, data->notify);
+			}
+		}
+
+		g_object_unref(enumerator);
+		g_object_unref(dir);
+	}
+
+	g_idle_add(add_batch_idle, batch);
+
+	g_queue_free_full(dirs, g_object_unref);
+	g_object_unref(data->cancellable);
+	g_free(data->root);
+	g_free(data->dir);
+	g_free(data);
+
+	return NULL;
+}
+
+
+static void start_walk(const gchar *dir, gboolean notify)
+{
+	WalkData *data = g_new0(WalkData, 1);
+
+	data->notify = notify;
+	data->cancellable = g_object_ref(cancellable);
+	data->root = g_strdup(index_root);
+	data->dir = g_strdup(dir);
+
+	g_thread_unref(g_thread_new("lsp-file-index", walk_thread, data));
+}
+
+
+/* root in locale encoding */
+void lsp_file_index_start(const gchar *root)
+{
+	lsp_file_index_destroy();
+
+	if (EMPTY(root) || !g_file_test(root, G_FILE_TEST_IS_DIR))
+		return;
+
+	index_root = g_strdup(root);
+	index_root_utf8 = utils_get_utf8_from_locale(root);
+	files = g_ptr_array_new_with_free_func(indexed_file_free);
+	file_table = g_hash_table_new(g_str_hash, g_str_equal);
+	trigrams = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, posting_free);
+	monitors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+	cancellable = g_cancellable_new();
+
+	start_walk(index_root, FALSE);
+}
+
+
+void lsp_file_index_destroy(void)
+{
+	if (!cancellable)
+		return;
+
+	// running walkers stop and their pending batches get dropped
+	g_cancellable_cancel(cancellable);
+	g_object_unref(cancellable);
+	cancellable = NULL;
+
+	g_hash_table_destroy(monitors);
+	g_hash_table_destroy(trigrams);
+	g_hash_table_destroy(file_table);
+	g_ptr_array_free(files, TRUE);
+	monitors = NULL;
+	trigrams = NULL;
+	file_table = NULL;
+	files = NULL;
+
+	g_free(index_root);
+	g_free(index_root_utf8);
+	index_root = NULL;
+	index_root_utf8 = NULL;
+}
+
+
+/* callback is called for the files created, changed or deleted in the watched
+ * directories, including hidden files */
+void lsp_file_index_set_changed_callback(LspFileChangedCallback callback)
+{
+	changed_callback = callback;
+}
+
+
+static gboolean file_matches(LspIndexedFile *file, GPtrArray *name_terms, GPtrArray *path_terms)
+{
+	gboolean ret = TRUE;
+	guint i;
+
+	for (i = 0; i < name_terms->len && ret; i++)
+		ret = strstr(file->key, name_terms->pdata[i]) != NULL;
+
+	if (ret && path_terms->len > 0)
+	{
+		gchar *key = normalize_name(file->path);
+
+		for (i = 0; i < path_terms->len && ret; i++)
+			ret = strstr(key, path_terms->pdata[i]) != NULL;
+		g_free(key);
+	}
+
+	return ret;
+}
+
+
+// files starting with the first term first, then the shortest names and paths
+static gint compare_matches(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const LspIndexedFile *file1 = *((const LspIndexedFile **)a);
+	const LspIndexedFile *file2 = *((const LspIndexedFile **)b);
+	const gchar *prefix = user_data;
+	gsize len1, len2;
+
+	if (prefix)
+	{
+		gboolean prefix1 = g_str_has_prefix(file1->key, prefix);
+		gboolean prefix2 = g_str_has_prefix(file2->key, prefix);
+
+		if (prefix1 != prefix2)
+			return prefix1 ? -1 : 1;
+	}
+
+	len1 = strlen(file1->key);
+	len2 = strlen(file2->key);
+	if (len1 != len2)
+		return len1 < len2 ? -1 : 1;
+
+	len1 = strlen(file1->path);
+	len2 = strlen(file2->path);
+	if (len1 != len2)
+		return len1 < len2 ? -1 : 1;
+
+	return strcmp(file1->path, file2->path);
+}
+
+
+/* Returns the UTF-8 absolute paths of the files whose basename contains all
+ * the space separated terms of query. Terms containing a directory separator
+ * are matched against the path relative to the project base path instead. */
+GPtrArray *lsp_file_index_find(const gchar *query, guint max_results)
+{
+	GPtrArray *ret = g_ptr_array_new_full(0, g_free);
+	GPtrArray *name_terms, *path_terms, *matches;
+	GArray *candidates = NULL;
+	gchar **terms, **term;
+	guint i, len;
+
+	if (!files || max_results == 0)
+		return ret;
+
+	name_terms = g_ptr_array_new_with_free_func(g_free);
+	path_terms = g_ptr_array_new_with_free_func(g_free);
+
+	terms = g_strsplit_set(query, " ", -1);
+	foreach_strv(term, terms)
+	{
+		gchar *normalized;
+
+		if (!**term)
+			continue;
+
+		normalized = normalize_name(*term);
+		if (strchr(normalized, '/') || strchr(normalized, G_DIR_SEPARATOR))
+			g_ptr_array_add(path_terms, normalized);
+		else
+			g_ptr_array_add(name_terms, normalized);
+	}
+	g_strfreev(terms);
+
+	if (name_terms->len == 0 && path_terms->len == 0)
+		goto done;
+
+	// only the files of the rarest trigram can match
+	for (i = 0; i < name_terms->len; i++)
+	{
+		const gchar *s;
+
+		for (s = name_terms->pdata[i]; s[0] && s[1] && s[2]; s++)
+		{
+			GArray *posting = g_hash_table_lookup(trigrams, GUINT_TO_POINTER(get_trigram(s)));
+
+			if (!posting)
+				goto done;
+			if (!candidates || posting->len < candidates->len)
+				candidates = posting;
+		}
+	}
+
+	matches = g_ptr_array_new();
+	len = candidates ? candidates->len : files->len;
+	for (i = 0; i < len && matches->len < MAX_MATCHES; i++)
+	{
+		LspIndexedFile *file = files->pdata[candidates ? g_array_index(candidates, guint, i) : i];
+
+		if (!file->removed && file_matches(file, name_terms, path_terms))
+			g_ptr_array_add(matches, file);
+	}
+
+	g_ptr_array_sort_with_data(matches, compare_matches,
+		name_terms->len > 0 ? name_terms->pdata[0] : NULL);
+
+	for (i = 0; i < matches->len && i < max_results; i++)
+	{
+		LspIndexedFile *file = matches->pdata[i];
+
+		g_ptr_array_add(ret, g_build_filename(index_root_utf8, file->path, NULL));
+	}
+	g_ptr_array_free(matches, TRUE);
+
+done:
+	g_ptr_array_free(name_terms, TRUE);
+	g_ptr_array_free(path_terms, TRUE);
+	return ret;
+}
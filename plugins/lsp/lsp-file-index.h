@@ -0,0 +1,43 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LSP_FILE_INDEX_H
+#define LSP_FILE_INDEX_H 1
+
+#include <glib.h>
+
+
+// same values as LSP's FileChangeType
+typedef enum
+{
+	LspFileCreated = 1,
+	LspFileChanged = 2,
+	LspFileDeleted = 3
+} LspFileChangeType;
+
+typedef void (*LspFileChangedCallback) (const gchar *locale_path, LspFileChangeType type);
+
+
+void lsp_file_index_start(const gchar *root);
+void lsp_file_index_destroy(void);
+
+void lsp_file_index_set_changed_callback(LspFileChangedCallback callback);
+
+GPtrArray *lsp_file_index_find(const gchar *query, guint max_results);
+
+#endif  /* LSP_FILE_INDEX_H */
@@ -0,0 +1,520 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-file-watch.h"
+#include "lsp/lsp-rpc.h"
+#include "lsp/lsp-utils.h"
+
+#include <jsonrpc-glib.h>
+
+#include <string.h>
+
+
+/* The file watchers servers register dynamically for
+ * workspace/didChangeWatchedFiles. The changes come from the directory
+ * monitors of the project file index, are collected for a short while so
+ * e.g. a git checkout results in a single notification per server, and are
+ * only sent to the servers whose glob patterns match. */
+
+// how long the changes are collected before being sent
+#define DEBOUNCE_DELAY 300
+
+// LSP's WatchKind
+#define WATCH_KIND_CREATE 1
+#define WATCH_KIND_CHANGE 2
+#define WATCH_KIND_DELETE 4
+
+
+typedef struct
+{
+	GRegex *regex;
+	gchar *base;  // UTF-8 with '/' separators, the pattern is relative to, NULL for absolute patterns
+	gint kind;
+} FileWatcher;
+
+
+typedef struct
+{
+	gchar *id;
+	GPtrArray *watchers;
+} FileWatchRegistration;
+
+
+static GHashTable *registrations = NULL;  // LspServer -> GPtrArray of FileWatchRegistration
+static GHashTable *pending_changes = NULL;  // locale path -> LspFileChangeType
+static guint send_source_id = 0;
+
+
+static void file_watcher_free(FileWatcher *watcher)
+{
+	g_regex_unref(watcher->regex);
+	g_free(watcher->base);
+	g_free(watcher);
+}
+
+
+static void registration_free(FileWatchRegistration *reg)
+{
+	g_free(reg->id);
+	g_ptr_array_free(reg->watchers, TRUE);
+	g_free(reg);
+}
+
+
+static void append_escaped(GString *str, gchar c)
+{
+	if (strchr("\\^$.|+()[]{}*?", c))
+		g_string_append_c(str, '\\');
+	g_string_append_c(str, c);
+}
+
+
+/* Converts LSP's glob pattern syntax, i.e. '*', '**', '?', '{a,b}' and
+ * '[a-z]' or '[!a-z]', to an anchored regex */
+static gchar *glob_to_regex(const gchar *glob)
+{
+	GString *re = g_string_new("^");
+	gint braces = 0;
+	const gchar *p;
+
+	for (p = glob; *p; p++)
+	{
+		switch (*p)
+		{
+			case '*':
+				if (p[1] != '*')
+					g_string_append(re, "[^/]*");
+				else if (p[2] == '/')
+				{
+					g_string_append(re, "(?:.*/)?");
+					p += 2;
+				}
+				else
+				{
+					g_string_append(re, ".*");
+					p++;
+				}
+				break;
+
+			case '?':
+				g_string_append(re, "[^/]");
+				break;
+
+			case '{':
+				g_string_append(re, "(?:");
+				braces++;
+				break;
+
+			case '}':
+			case ',':
+				if (braces == 0)
+					append_escaped(re, *p);
+				else if (*p == ',')
+					g_string_append_c(re, '|');
+				else
+				{
+					g_string_append_c(re, ')');
+					braces--;
+				}
+				break;
+
+			case '[':
+			{
+				const gchar *end = p[1] ? strchr(p + 2, ']') : NULL;
+
+				if (!end)
+				{
+					append_escaped(re, *p);
+					break;
+				}
+				g_string_append_c(re, '[');
+				p++;
+				if (*p == '!')
+				{
+					g_string_append_c(re, '^');
+					p++;
+				}
+				for (; p < end; p++)
+				{
+					if (*p == '\\' || *p == '[')
+						g_string_append_c(re, '\\');
+					g_string_append_c(re, *p);
+				}
+				g_string_append_c(re, ']');
+				break;
+			}
+
+			default:
+				append_escaped(re, *p);
+				break;
+		}
+	}
+
+	for (; braces > 0; braces--)
+		g_string_append_c(re, ')');
+	g_string_append_c(re, '$');
+
+	return g_string_free(re, FALSE);
+}
+
+
+static gchar *get_slash_path(const gchar *path)
+{
+	gchar *ret = g_strdup(path);
+
+#ifdef G_OS_WIN32
+	g_strdelimit(ret, "\\", '/');
+#endif
+	return ret;
+}
+
+
+static FileWatcher *file_watcher_new(GVariant *watcher_variant)
+{
+	const gchar *glob = NULL;
+	const gchar *base_uri = NULL;
+	gchar *base = NULL;
+	gint64 kind = WATCH_KIND_CREATE | WATCH_KIND_CHANGE | WATCH_KIND_DELETE;
+	FileWatcher *watcher;
+	gchar *regex_str;
+	GRegex *regex;
+
+	if (!JSONRPC_MESSAGE_PARSE(watcher_variant, "globPattern", JSONRPC_MESSAGE_GET_STRING(&glob)))
+	{
+		// RelativePattern, the base being a URI or a WorkspaceFolder
+		if (!JSONRPC_MESSAGE_PARSE(watcher_variant,
+				"globPattern", "{",
+					"baseUri", JSONRPC_MESSAGE_GET_STRING(&base_uri),
+					"pattern", JSONRPC_MESSAGE_GET_STRING(&glob),
+				"}"))
+		{
+			JSONRPC_MESSAGE_PARSE(watcher_variant,
+				"globPattern", "{",
+					"baseUri", "{",
+						"uri", JSONRPC_MESSAGE_GET_STRING(&base_uri),
+					"}",
+					"pattern", JSONRPC_MESSAGE_GET_STRING(&glob),
+				"}");
+		}
+		if (!base_uri)
+			return NULL;
+		base = lsp_utils_get_real_path_from_uri_utf8(base_uri);
+		if (!base)
+			return NULL;
+	}
+	if (!glob)
+	{
+		g_free(base);
+		return NULL;
+	}
+	JSONRPC_MESSAGE_PARSE(watcher_variant, "kind", JSONRPC_MESSAGE_GET_INT64(&kind));
+
+	// relative patterns without base are relative to the workspace folder
+	if (!base && !g_path_is_absolute(glob))
+	{
+		gchar *project_base = lsp_utils_get_project_base_path();
+
+		if (!project_base)
+			return NULL;
+		base = utils_get_utf8_from_locale(project_base);
+		g_free(project_base);
+	}
+
+	regex_str = glob_to_regex(glob);
+	regex = g_regex_new(regex_str, G_REGEX_OPTIMIZE, 0, NULL);
+	g_free(regex_str);
+	if (!regex)
+	{
+		g_free(base);
+		return NULL;
+	}
+
+	watcher = g_new0(FileWatcher, 1);
+	watcher->regex = regex;
+	watcher->kind = kind;
+	if (base)
+	{
+		watcher->base = get_slash_path(base);
+		// base followed by "/" so it can be stripped from the matched paths
+		if (!g_str_has_suffix(watcher->base, "/"))
+			SETPTR(watcher->base, g_strconcat(watcher->base, "/", NULL));
+		g_free(base);
+	}
+	return watcher;
+}
+
+
+void lsp_file_watch_register(LspServer *srv, GVariant *params)
+{
+	GVariantIter *iter = NULL;
+	GVariant *reg_variant = NULL;
+
+	JSONRPC_MESSAGE_PARSE(params, "registrations", JSONRPC_MESSAGE_GET_ITER(&iter));
+	if (!iter)
+		return;
+
+	while (g_variant_iter_loop(iter, "v", &reg_variant))
+	{
+		const gchar *id = NULL;
+		const gchar *method = NULL;
+		GVariantIter *watchers_iter = NULL;
+		GVariant *watcher_variant = NULL;
+		FileWatchRegistration *reg;
+		GPtrArray *server_regs;
+
+		JSONRPC_MESSAGE_PARSE(reg_variant,
+			"id", JSONRPC_MESSAGE_GET_STRING(&id),
+			"method", JSONRPC_MESSAGE_GET_STRING(&method));
+		if (!id || g_strcmp0(method, "workspace/didChangeWatchedFiles") != 0)
+			continue;
+
+		JSONRPC_MESSAGE_PARSE(reg_variant,
+			"registerOptions", "{",
+				"watchers", JSONRPC_MESSAGE_GET_ITER(&watchers_iter),
+			"}");
+		if (!watchers_iter)
+			continue;
+
+		reg = g_new0(FileWatchRegistration, 1);
+		reg->id = g_strdup(id);
+		reg->watchers = g_ptr_array_new_full(0, (GDestroyNotify)file_watcher_free);
+
+		while (g_variant_iter_loop(watchers_iter, "v", &watcher_variant))
+		{
+			FileWatcher *watcher = file_watcher_new(watcher_variant);
+
+			if (watcher)
+				g_ptr_array_add(reg->watchers, watcher);
+		}
+		g_variant_iter_free(watchers_iter);
+
+		if (!registrations)
+			registrations = g_hash_table_new_full(NULL, NULL, NULL,
+				(GDestroyNotify)g_ptr_array_unref);
+		server_regs = g_hash_table_lookup(registrations, srv);
+		if (!server_regs)
+		{
+			server_regs = g_ptr_array_new_full(0, (GDestroyNotify)registration_free);
+			g_hash_table_insert(registrations, srv, server_regs);
+		}
+		g_ptr_array_add(server_regs, reg);
+	}
+
+	g_variant_iter_free(iter);
+}
+
+
+void lsp_file_watch_unregister(LspServer *srv, GVariant *params)
+{
+	GPtrArray *server_regs = registrations ? g_hash_table_lookup(registrations, srv) : NULL;
+	GVariantIter *iter = NULL;
+	GVariant *unreg_variant = NULL;
+
+	if (!server_regs)
+		return;
+
+	// sic, the field name is misspelled in the specification
+	JSONRPC_MESSAGE_PARSE(params, "unregisterations", JSONRPC_MESSAGE_GET_ITER(&iter));
+	if (!iter)
+		return;
+
+	while (g_variant_iter_loop(iter, "v", &unreg_variant))
+	{
+		const gchar *id = NULL;
+		guint i;
+
+		if (!JSONRPC_MESSAGE_PARSE(unreg_variant, "id", JSONRPC_MESSAGE_GET_STRING(&id)))
+			continue;
+
+		for (i = 0; i < server_regs->len; i++)
+		{
+			FileWatchRegistration *reg = server_regs->pdata[i];
+
+			if (g_strcmp0(reg->id, id) == 0)
+			{
+				g_ptr_array_remove_index(server_regs, i);
+				break;
+			}
+		}
+	}
+
+	g_variant_iter_free(iter);
+}
+
+
+void lsp_file_watch_free_all(LspServer *srv)
+{
+	if (registrations)
+		g_hash_table_remove(registrations, srv);
+}
+
+
+static gboolean watcher_matches(FileWatcher *watcher, const gchar *path, LspFileChangeType type)
+{
+	gint kind = type == LspFileCreated ? WATCH_KIND_CREATE :
+		type == LspFileChanged ? WATCH_KIND_CHANGE : WATCH_KIND_DELETE;
+
+	if (!(watcher->kind & kind))
+		return FALSE;
+
+	if (watcher->base)
+	{
+		if (!g_str_has_prefix(path, watcher->base))
+			return FALSE;
+		path += strlen(watcher->base);
+	}
+
+	return g_regex_match(watcher->regex, path, 0, NULL);
+}
+
+
+static gboolean server_watches(GPtrArray *server_regs, const gchar *path, LspFileChangeType type)
+{
+	guint i, j;
+
+	for (i = 0; i < server_regs->len; i++)
+	{
+		FileWatchRegistration *reg = server_regs->pdata[i];
+
+		for (j = 0; j < reg->watchers->len; j++)
+		{
+			if (watcher_matches(reg->watchers->pdata[j], path, type))
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+static void send_changes(LspServer *srv, GPtrArray *server_regs)
+{
+	GPtrArray *changes = g_ptr_array_new_full(0, (GDestroyNotify)g_variant_unref);
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init(&iter, pending_changes);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		LspFileChangeType type = GPOINTER_TO_INT(value);
+		gchar *utf8_path = utils_get_utf8_from_locale(key);
+		gchar *path = get_slash_path(utf8_path);
+
+		if (server_watches(server_regs, path, type))
+		{
+			gchar *uri = g_filename_to_uri(key, NULL, NULL);
+
+			if (uri)
+			{
+				g_ptr_array_add(changes, JSONRPC_MESSAGE_NEW(
+					"uri", JSONRPC_MESSAGE_PUT_STRING(uri),
+					"type", JSONRPC_MESSAGE_PUT_INT32(type)
+				));
+			}
+			g_free(uri);
+		}
+		g_free(path);
+		g_free(utf8_path);
+	}
+
+	if (changes->len > 0)
+	{
+		GVariant *node;
+		GVariantDict dict;
+
+		g_variant_dict_init(&dict, NULL);
+		g_variant_dict_insert_value(&dict, "changes", g_variant_new_array(G_VARIANT_TYPE_VARDICT,
+			(GVariant **)(gpointer)changes->pdata, changes->len));
+		node = g_variant_take_ref(g_variant_dict_end(&dict));
+
+		lsp_rpc_notify(srv, "workspace/didChangeWatchedFiles", node, NULL, NULL);
+
+		g_variant_unref(node);
+	}
+
+	g_ptr_array_free(changes, TRUE);
+}
+
+
+static gboolean send_changes_cb(gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	send_source_id = 0;
+
+	if (registrations)
+	{
+		g_hash_table_iter_init(&iter, registrations);
+		while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+			LspServer *srv = key;
+			GPtrArray *server_regs = value;
+
+			if (srv->state == LspServerStateReady && server_regs->len > 0)
+				send_changes(srv, server_regs);
+		}
+	}
+
+	g_hash_table_remove_all(pending_changes);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+/* Called for every change in the watched directories */
+void lsp_file_watch_file_changed(const gchar *locale_path, LspFileChangeType type)
+{
+	gpointer old_value;
+
+	if (!registrations || g_hash_table_size(registrations) == 0)
+		return;
+
+	if (!pending_changes)
+		pending_changes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	// merge with the change not sent yet
+	if (g_hash_table_lookup_extended(pending_changes, locale_path, NULL, &old_value))
+	{
+		LspFileChangeType old_type = GPOINTER_TO_INT(old_value);
+
+		if (old_type == LspFileCreated && type == LspFileChanged)
+			type = LspFileCreated;
+		else if (old_type == LspFileDeleted && type == LspFileCreated)
+			type = LspFileChanged;
+	}
+	g_hash_table_insert(pending_changes, g_strdup(locale_path), GINT_TO_POINTER(type));
+
+	if (send_source_id == 0)
+		send_source_id = g_timeout_add(DEBOUNCE_DELAY, send_changes_cb, NULL);
+}
+
+
+void lsp_file_watch_destroy(void)
+{
+	if (send_source_id != 0)
+		g_source_remove(send_source_id);
+	send_source_id = 0;
+
+	if (pending_changes)
+		g_hash_table_destroy(pending_changes);
+	pending_changes = NULL;
+}
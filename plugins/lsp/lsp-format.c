@@ -24,36 +24,230 @@
 #include "lsp/lsp-server.h"
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
+#include "lsp/lsp-sync.h"
 
 #include <jsonrpc-glib.h>
+#include <string.h>
+
+
+// above this number of edited hunks the whole document is formatted instead
+#define MAX_EDITED_RANGES 50
+
+
+typedef struct
+{
+	GeanyDocument *doc;
+	guint version;  // document version the requests were made for
+	guint pending;  // number of responses still to arrive
+	gboolean failed;
+	GPtrArray *edits;
+} LspFormatData;
+
+
+// per-line flags of lines modified since the last save
+static GQuark edited_lines_quark = 0;
+// document version after the last formatting
+static GQuark formatted_version_quark = 0;
+
+
+static GByteArray *get_edited_lines(ScintillaObject *sci)
+{
+	if (!edited_lines_quark)
+		edited_lines_quark = g_quark_from_static_string("lsp-format-edited-lines");
+
+	return g_object_get_qdata(G_OBJECT(sci), edited_lines_quark);
+}
+
+
+void lsp_format_text_modified(ScintillaObject *sci, SCNotification *nt)
+{
+	GByteArray *lines;
+	gint line;
+
+	if (!(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+		return;
+
+	lines = get_edited_lines(sci);
+	if (!lines)
+	{
+		// attached on the first modification with the line count before it
+		lines = g_byte_array_new();
+		g_byte_array_set_size(lines, sci_get_line_count(sci) - nt->linesAdded);
+		memset(lines->data, 0, lines->len);
+		g_object_set_qdata_full(G_OBJECT(sci), edited_lines_quark, lines,
+			(GDestroyNotify)g_byte_array_unref);
+	}
+
+	line = sci_get_line_from_position(sci, nt->position);
+	if (line < 0 || (guint)line >= lines->len)
+		return;
+
+	if (nt->linesAdded > 0)
+	{
+		g_byte_array_set_size(lines, lines->len + nt->linesAdded);
+		memmove(lines->data + line + 1 + nt->linesAdded, lines->data + line + 1,
+			lines->len - line - 1 - nt->linesAdded);
+		memset(lines->data + line + 1, 1, nt->linesAdded);
+	}
+	else if (nt->linesAdded < 0)
+	{
+		guint removed = MIN((guint)(-nt->linesAdded), lines->len - line - 1);
+		g_byte_array_remove_range(lines, line + 1, removed);
+	}
+
+	lines->data[line] = 1;
+}
+
+
+void lsp_format_doc_saved(GeanyDocument *doc)
+{
+	GByteArray *lines = get_edited_lines(doc->editor->sci);
+
+	if (lines)
+		memset(lines->data, 0, lines->len);
+}
+
+
+static guint get_formatted_version(ScintillaObject *sci)
+{
+	if (!formatted_version_quark)
+		formatted_version_quark = g_quark_from_static_string("lsp-format-version");
+
+	return GPOINTER_TO_UINT(g_object_get_qdata(G_OBJECT(sci), formatted_version_quark));
+}
+
+
+static void set_formatted_version(GeanyDocument *doc)
+{
+	// make sure the applied edits are sent so the version is up to date
+	lsp_sync_flush_doc_changes(doc);
+	g_object_set_qdata(G_OBJECT(doc->editor->sci), formatted_version_quark,
+		GUINT_TO_POINTER(lsp_sync_get_doc_version(doc)));
+}
+
+
+static void format_data_free(LspFormatData *data)
+{
+	g_ptr_array_free(data->edits, TRUE);
+	g_free(data);
+}
 
 
 static void format_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
+	LspFormatData *data = user_data;
+
 	if (!error)
 	{
-		GeanyDocument *doc = document_get_current();
+		if (g_variant_is_of_type(return_value, G_VARIANT_TYPE("av")))
+		{
+			GPtrArray *edits;
+			GVariantIter iter;
+			guint i;
+
+			g_variant_iter_init(&iter, return_value);
+			edits = lsp_utils_parse_text_edits(&iter);
 
-		if (doc == user_data)
+			// take ownership of the parsed edits
+			g_ptr_array_set_free_func(edits, NULL);
+			for (i = 0; i < edits->len; i++)
+				g_ptr_array_add(data->edits, edits->pdata[i]);
+			g_ptr_array_free(edits, TRUE);
+		}
+
+		//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
+	}
+	else
+		data->failed = TRUE;
+
+	data->pending--;
+	if (data->pending > 0)
+		return;
+
+	// all the edits are computed against the same document version and are
+	// applied together once the last response arrives
+	if (!data->failed && data->doc == document_get_current() &&
+		lsp_sync_get_doc_version(data->doc) == data->version)
+	{
+		ScintillaObject *sci = data->doc->editor->sci;
+
+		if (data->edits->len > 0)
 		{
-			if (g_variant_is_of_type(return_value, G_VARIANT_TYPE("av")))
-			{
-				GPtrArray *edits;
-				GVariantIter iter;
+			sci_start_undo_action(sci);
+			lsp_utils_apply_text_edits(sci, NULL, data->edits);
+			sci_end_undo_action(sci);
+		}
+
+		set_formatted_version(data->doc);
+	}
 
-				g_variant_iter_init(&iter, return_value);
-				edits = lsp_utils_parse_text_edits(&iter);
+	format_data_free(data);
+}
 
-				sci_start_undo_action(doc->editor->sci);
-				lsp_utils_apply_text_edits(doc->editor->sci, NULL, edits);
-				sci_end_undo_action(doc->editor->sci);
 
-				g_ptr_array_free(edits, TRUE);
-			}
+static GVariant *create_range_request(const gchar *doc_uri, LspRange range, GVariant *options)
+{
+	return JSONRPC_MESSAGE_NEW (
+		"textDocument", "{",
+			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+		"}",
+		"range", "{",
+			"start", "{",
+				"line", JSONRPC_MESSAGE_PUT_INT32(range.start.line),
+				"character", JSONRPC_MESSAGE_PUT_INT32(range.start.character),
+			"}",
+			"end", "{",
+				"line", JSONRPC_MESSAGE_PUT_INT32(range.end.line),
+				"character", JSONRPC_MESSAGE_PUT_INT32(range.end.character),
+			"}",
+		"}",
+		"options", "{",
+			JSONRPC_MESSAGE_PUT_VARIANT(options),
+		"}"
+	);
+}
+
+
+/* Returns whole-line ranges of consecutive lines edited since the last save or
+ * NULL when they aren't known and the whole document should be formatted. */
+static GArray *get_edited_ranges(GeanyDocument *doc)
+{
+	GByteArray *lines = get_edited_lines(doc->editor->sci);
+	GArray *ranges;
+	guint i = 0;
+
+	// modified before the plugin could track the edits
+	if (!lines)
+		return doc->changed ? NULL : g_array_new(FALSE, FALSE, sizeof(LspRange));
+
+	ranges = g_array_new(FALSE, FALSE, sizeof(LspRange));
+	while (i < lines->len)
+	{
+		LspRange range;
+
+		if (!lines->data[i])
+		{
+			i++;
+			continue;
 		}
 
-		//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
+		range.start.line = i;
+		range.start.character = 0;
+		while (i < lines->len && lines->data[i])
+			i++;
+		range.end.line = i;
+		range.end.character = 0;
+
+		g_array_append_val(ranges, range);
 	}
+
+	if (ranges->len > MAX_EDITED_RANGES)
+	{
+		g_array_free(ranges, TRUE);
+		return NULL;
+	}
+
+	return ranges;
 }
 
 
@@ -62,50 +256,81 @@ void lsp_format_perform(void)
 	GeanyDocument *doc = document_get_current();
 	LspServer *srv = lsp_server_get(doc);
 	ScintillaObject *sci;
-	const gchar *method;
-	GVariant *node;
+	GArray *ranges = NULL;
+	LspFormatData *data;
+	GVariant *options;
 	gchar *doc_uri;
+	guint i;
 
 	if (!srv)
 		return;
 
 	sci = doc->editor->sci;
+
+	if (!sci_has_selection(sci))
+	{
+		guint version;
+
+		// nothing changed since the last formatting so there's nothing to do
+		lsp_sync_flush_doc_changes(doc);
+		version = lsp_sync_get_doc_version(doc);
+		if (version != 0 && version == get_formatted_version(sci))
+			return;
+
+		if (srv->config.formatting_edited_ranges_only && srv->supports_range_formatting)
+		{
+			ranges = get_edited_ranges(doc);
+			if (ranges && ranges->len == 0)
+			{
+				g_array_free(ranges, TRUE);
+				return;
+			}
+		}
+	}
+
 	doc_uri = lsp_utils_get_doc_uri(doc);
+	// might be used by several requests
+	options = g_variant_ref_sink(lsp_utils_parse_json_file(srv->config.formatting_options_file));
 
-	GVariant *options = lsp_utils_parse_json_file(srv->config.formatting_options_file);
+	data = g_new0(LspFormatData, 1);
+	data->doc = doc;
+	data->edits = g_ptr_array_new_full(1, (GDestroyNotify)lsp_utils_free_lsp_text_edit);
 
-	if (sci_has_selection(sci))
+	if (ranges)
+	{
+		// servers compute the edits for each hunk separately
+		data->pending = ranges->len;
+		for (i = 0; i < ranges->len; i++)
+		{
+			GVariant *node = create_range_request(doc_uri,
+				g_array_index(ranges, LspRange, i), options);
+
+			lsp_rpc_call(srv, "textDocument/rangeFormatting", node, format_cb, data);
+			g_variant_unref(node);
+		}
+		g_array_free(ranges, TRUE);
+	}
+	else if (sci_has_selection(sci))
 	{
+		GVariant *node;
 		LspRange range;
 		gint sel_start = sci_get_selection_start(sci);
-		gint sel_end = sci_get_selection_start(sci);
+		gint sel_end = sci_get_selection_end(sci);
 
 		range.start = lsp_utils_scintilla_pos_to_lsp(sci, sel_start);
 		range.end = lsp_utils_scintilla_pos_to_lsp(sci, sel_end);
 
-		node = JSONRPC_MESSAGE_NEW (
-			"textDocument", "{",
-				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
-			"}",
-			"range", "{",
-				"start", "{",
-					"line", JSONRPC_MESSAGE_PUT_INT32(range.start.line),
-					"character", JSONRPC_MESSAGE_PUT_INT32(range.start.character),
-				"}",
-				"end", "{",
-					"line", JSONRPC_MESSAGE_PUT_INT32(range.end.line),
-					"character", JSONRPC_MESSAGE_PUT_INT32(range.end.character),
-				"}",
-			"}",
-			"options", "{",
-				JSONRPC_MESSAGE_PUT_VARIANT(options),
-			"}"
-		);
-		method = "textDocument/rangeFormatting";
+		node = create_range_request(doc_uri, range, options);
+		data->pending = 1;
+
+		//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
+
+		lsp_rpc_call(srv, "textDocument/rangeFormatting", node, format_cb, data);
+		g_variant_unref(node);
 	}
 	else
 	{
-		node = JSONRPC_MESSAGE_NEW (
+		GVariant *node = JSONRPC_MESSAGE_NEW (
 			"textDocument", "{",
 				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
 			"}",
@@ -113,13 +338,17 @@ void lsp_format_perform(void)
 				JSONRPC_MESSAGE_PUT_VARIANT(options),
 			"}"
 		);
-		method = "textDocument/formatting";
-	}
+		data->pending = 1;
+
+		//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
-	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
+		lsp_rpc_call(srv, "textDocument/formatting", node, format_cb, data);
+		g_variant_unref(node);
+	}
 
-	lsp_rpc_call(srv, method, node, format_cb, doc);
+	// pending edits are sent before the requests so read the version afterwards
+	data->version = lsp_sync_get_doc_version(doc);
 
+	g_variant_unref(options);
 	g_free(doc_uri);
-	g_variant_unref(node);
 }
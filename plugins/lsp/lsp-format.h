@@ -19,9 +19,14 @@
 #ifndef LSP_FORMAT_H
 #define LSP_FORMAT_H 1
 
+#include <geanyplugin.h>
+
 #include <glib.h>
 
 
 void lsp_format_perform(void);
 
+void lsp_format_text_modified(ScintillaObject *sci, SCNotification *nt);
+void lsp_format_doc_saved(GeanyDocument *doc);
+
 #endif  /* LSP_FORMAT_H */
@@ -21,6 +21,7 @@
 #endif
 
 #include "lsp/lsp-goto-anywhere.h"
+#include "lsp/lsp-file-index.h"
 #include "lsp/lsp-goto-panel.h"
 #include "lsp/lsp-symbols.h"
 #include "lsp/lsp-tm-tag.h"
@@ -183,6 +184,35 @@ static void goto_file(const gchar *file_str)
 	}
 
 	filtered = lsp_goto_panel_filter(arr, file_str);
+
+	/* followed by the not yet open project files */
+	if (file_str[0] && filtered->len < 100)
+	{
+		GPtrArray *paths = lsp_file_index_find(file_str, 100 - filtered->len);
+		GHashTable *open_files = g_hash_table_new(g_str_hash, g_str_equal);
+		LspGotoPanelSymbol *symbol;
+		gchar *path;
+
+		foreach_ptr_array(symbol, i, arr)
+			g_hash_table_add(open_files, symbol->file);
+
+		foreach_ptr_array(path, i, paths)
+		{
+			if (g_hash_table_contains(open_files, path))
+				continue;
+
+			symbol = g_new0(LspGotoPanelSymbol, 1);
+			symbol->label = g_path_get_basename(path);
+			symbol->file = g_strdup(path);
+			symbol->icon = TM_ICON_OTHER;
+			g_ptr_array_add(arr, symbol);
+			g_ptr_array_add(filtered, symbol);
+		}
+
+		g_hash_table_destroy(open_files);
+		g_ptr_array_free(paths, TRUE);
+	}
+
 	lsp_goto_panel_fill(filtered);
 
 	g_ptr_array_free(filtered, TRUE);
@@ -217,6 +247,20 @@ static void goto_tm_symbol(const gchar *query, GPtrArray *tags, TMParserType lan
 }
 
 
+static void goto_workspace_tm_symbol(const gchar *query, TMParserType lang)
+{
+	GPtrArray *tags, *symbols;
+
+	tags = tm_workspace_find_matching(query, ~tm_tag_local_var_t, lang, 100);
+	symbols = tag_array_to_symbol_array(tags);
+
+	lsp_goto_panel_fill(symbols);
+
+	g_ptr_array_free(symbols, TRUE);
+	g_ptr_array_free(tags, TRUE);
+}
+
+
 static void perform_lookup(const gchar *query)
 {
 	GeanyDocument *doc = document_get_current();
@@ -228,8 +272,7 @@ static void perform_lookup(const gchar *query)
 		if (srv && srv->supports_workspace_symbols)
 			lsp_symbols_workspace_request(doc->file_type, query_str+1, workspace_symbol_cb, NULL);
 		else
-			// TODO: possibly improve performance by binary searching the start and the end point
-			goto_tm_symbol(query_str+1, geany_data->app->tm_workspace->tags_array, doc->file_type->lang);
+			goto_workspace_tm_symbol(query_str+1, doc->file_type->lang);
 	}
 	else if (g_str_has_prefix(query_str, "@"))
 	{
@@ -34,6 +34,10 @@
 #include <geanyplugin.h>
 
 
+// rows added at once, the rest is added in chunks of this size on idle
+#define FILL_CHUNK_SIZE 200
+
+
 enum {
 	COL_ICON,
 	COL_LABEL,
@@ -56,6 +60,11 @@ struct {
 
 static LspGotoPanelLookupFunction lookup_function;
 
+// symbols of the last lsp_goto_panel_fill() not added to the store yet
+static GPtrArray *pending_symbols = NULL;
+static guint pending_next = 0;
+static guint fill_source_id = 0;
+
 
 extern GeanyData *geany_data;
 
@@ -142,36 +151,101 @@ static void tree_view_activate_focused_row(GtkTreeView *view)
 }
 
 
+static void append_symbol(LspGotoPanelSymbol *symbol)
+{
+	gchar *label;
+
+	if (symbol->file && symbol->line > 0)
+		label = g_markup_printf_escaped("%s\n<small><i>%s:%d</i></small>",
+			symbol->label, symbol->file, symbol->line);
+	else if (symbol->file)
+		label = g_markup_printf_escaped("%s\n<small><i>%s</i></small>",
+			symbol->label, symbol->file);
+	else
+		label = g_markup_printf_escaped("%s", symbol->label);
+
+	gtk_list_store_insert_with_values(panel_data.store, NULL, -1,
+		COL_ICON, lsp_symbol_kinds_get_icon_pixbuf(symbol->icon),
+		COL_LABEL, label,
+		COL_PATH, symbol->file,
+		COL_LINENO, symbol->line,
+		-1);
+
+	g_free(label);
+}
+
+
+static void cancel_pending_fill(void)
+{
+	if (fill_source_id)
+		g_source_remove(fill_source_id);
+	fill_source_id = 0;
+
+	if (pending_symbols)
+		g_ptr_array_free(pending_symbols, TRUE);
+	pending_symbols = NULL;
+	pending_next = 0;
+}
+
+
+static gboolean fill_chunk_cb(gpointer user_data)
+{
+	guint end = MIN(pending_next + FILL_CHUNK_SIZE, pending_symbols->len);
+
+	for (; pending_next < end; pending_next++)
+		append_symbol(pending_symbols->pdata[pending_next]);
+
+	if (pending_next < pending_symbols->len)
+		return G_SOURCE_CONTINUE;
+
+	fill_source_id = 0;
+	cancel_pending_fill();
+	return G_SOURCE_REMOVE;
+}
+
+
+static LspGotoPanelSymbol *copy_symbol(LspGotoPanelSymbol *symbol)
+{
+	LspGotoPanelSymbol *copy = g_new0(LspGotoPanelSymbol, 1);
+
+	copy->icon = symbol->icon;
+	copy->label = g_strdup(symbol->label);
+	copy->file = g_strdup(symbol->file);
+	copy->line = symbol->line;
+
+	return copy;
+}
+
+
+/* Only the first rows are added immediately so the panel stays responsive for
+ * huge results; the rest follows in chunks on idle. */
 void lsp_goto_panel_fill(GPtrArray *symbols)
 {
 	GtkTreeView *view = GTK_TREE_VIEW(panel_data.tree_view);
 	GtkTreeIter iter;
-	LspGotoPanelSymbol *symbol;
 	guint i;
 
+	cancel_pending_fill();
+
+	// avoid view updates for every inserted row
+	g_object_ref(panel_data.store);
+	gtk_tree_view_set_model(view, NULL);
+
 	gtk_list_store_clear(panel_data.store);
 
-	foreach_ptr_array(symbol, i, symbols)
-	{
-		gchar *label;
-
-		if (symbol->file && symbol->line > 0)
-			label = g_markup_printf_escaped("%s\n<small><i>%s:%d</i></small>",
-				symbol->label, symbol->file, symbol->line);
-		else if (symbol->file)
-			label = g_markup_printf_escaped("%s\n<small><i>%s</i></small>",
-				symbol->label, symbol->file);
-		else
-			label = g_markup_printf_escaped("%s", symbol->label);
-
-		gtk_list_store_insert_with_values(panel_data.store, NULL, -1,
-			COL_ICON, lsp_symbol_kinds_get_icon_pixbuf(symbol->icon),
-			COL_LABEL, label,
-			COL_PATH, symbol->file,
-			COL_LINENO, symbol->line,
-			-1);
+	for (i = 0; i < symbols->len && i < FILL_CHUNK_SIZE; i++)
+		append_symbol(symbols->pdata[i]);
+
+	gtk_tree_view_set_model(view, GTK_TREE_MODEL(panel_data.store));
+	g_object_unref(panel_data.store);
 
-		g_free(label);
+	if (i < symbols->len)
+	{
+		pending_symbols = g_ptr_array_new_full(symbols->len - i,
+			(GDestroyNotify)lsp_goto_panel_symbol_free);
+		for (; i < symbols->len; i++)
+			g_ptr_array_add(pending_symbols, copy_symbol(symbols->pdata[i]));
+		fill_source_id = g_idle_add_full(G_PRIORITY_LOW, fill_chunk_cb, NULL, NULL);
 	}
 
 	if (gtk_tree_model_get_iter_first(gtk_tree_view_get_model(view), &iter))
@@ -246,6 +320,7 @@ static void on_entry_activate(GtkEntry *entry, gpointer dummy)
 
 static void on_panel_hide(GtkWidget *widget, gpointer dummy)
 {
+	cancel_pending_fill();
 	gtk_list_store_clear(panel_data.store);
 }
 
@@ -380,6 +455,7 @@ void lsp_goto_panel_show(const gchar *query, LspGotoPanelLookupFunction func)
 		create_panel();
 
 	gtk_entry_set_text(GTK_ENTRY(panel_data.entry), query);
+	cancel_pending_fill();
 	gtk_list_store_clear(panel_data.store);
 	gtk_widget_show(panel_data.panel);
 
@@ -24,6 +24,7 @@
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
 #include "lsp/lsp-goto-panel.h"
+#include "lsp/lsp-progress.h"
 
 #include <jsonrpc-glib.h>
 
@@ -31,6 +32,9 @@
 typedef struct {
 	GeanyDocument *doc;
 	gboolean show_in_msgwin;
+	gchar *partial_token;
+	gboolean partial_received;
+	GHashTable *sci_table;
 } GotoData;
 
 
@@ -119,26 +123,83 @@ static void show_in_msgwin(LspLocation *loc, GHashTable *sci_table)
 }
 
 
+static gboolean doc_exists(GeanyDocument *doc)
+{
+	gint i;
+
+	foreach_document(i)
+	{
+		if (doc == documents[i])
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+static void show_locations_in_msgwin(GotoData *data, GPtrArray *locations)
+{
+	LspLocation *loc;
+	guint i;
+
+	if (!data->sci_table)
+		data->sci_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_object_unref);
+
+	foreach_ptr_array(loc, i, locations)
+	{
+		show_in_msgwin(loc, data->sci_table);
+	}
+}
+
+
+/* Locations streamed by the server before the final response - appended to
+ * the messages window as they arrive. */
+static void goto_partial_cb(GVariant *value, gpointer user_data)
+{
+	GotoData *data = user_data;
+	GPtrArray *locations;
+	GVariantIter iter;
+
+	if (!doc_exists(data->doc) || !g_variant_is_of_type(value, G_VARIANT_TYPE("av")))
+		return;
+
+	if (!data->partial_received)
+	{
+		msgwin_clear_tab(MSG_MESSAGE);
+		msgwin_switch_tab(MSG_MESSAGE, TRUE);
+		data->partial_received = TRUE;
+	}
+
+	g_variant_iter_init(&iter, value);
+	locations = lsp_utils_parse_locations(&iter);
+	if (locations)
+	{
+		show_locations_in_msgwin(data, locations);
+		g_ptr_array_free(locations, TRUE);
+	}
+}
+
+
+static void goto_data_free(GotoData *data)
+{
+	lsp_progress_unregister_partial_result(data->partial_token);
+	g_free(data->partial_token);
+	if (data->sci_table)
+		g_hash_table_destroy(data->sci_table);
+	g_free(data);
+}
+
+
 static void goto_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
 	if (!error)
 	{
 		GotoData *data = user_data;
-		gboolean doc_exists = FALSE;
-		gint i;
 
-		foreach_document(i)
+		if (doc_exists(data->doc))
 		{
-			if (data->doc == documents[i])
-			{
-				doc_exists = TRUE;
-				break;
-			}
-		}
-
-		if (doc_exists)
-		{
-			if (data->show_in_msgwin)
+			if (data->show_in_msgwin && !data->partial_received)
 			{
 				msgwin_clear_tab(MSG_MESSAGE);
 				msgwin_switch_tab(MSG_MESSAGE, TRUE);
@@ -157,19 +218,7 @@ static void goto_cb(GVariant *return_value, GError *error, gpointer user_data)
 				if (locations && locations->len > 0)
 				{
 					if (data->show_in_msgwin)
-					{
-						GHashTable *sci_table = g_hash_table_new_full(g_str_hash,
-							g_str_equal, g_free, (GDestroyNotify)g_object_unref);
-						LspLocation *loc;
-						guint i;
-
-						foreach_ptr_array(loc, i, locations)
-						{
-							show_in_msgwin(loc, sci_table);
-						}
-
-						g_hash_table_destroy(sci_table);
-					}
+						show_locations_in_msgwin(data, locations);
 					else if (locations->len == 1)
 						goto_location(data->doc, locations->pdata[0]);
 					else
@@ -218,7 +267,7 @@ static void goto_cb(GVariant *return_value, GError *error, gpointer user_data)
 		//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
 	}
 
-	g_free(user_data);
+	goto_data_free(user_data);
 }
 
 
@@ -243,6 +292,20 @@ static void perform_goto(LspServer *server, GeanyDocument *doc, gint pos, const
 
 	data->doc = doc;
 	data->show_in_msgwin = show_in_msgwin;
+
+	// results shown in the messages window can be displayed as they arrive
+	if (show_in_msgwin)
+	{
+		GVariantDict dict;
+
+		data->partial_token = lsp_progress_register_partial_result(goto_partial_cb, data);
+
+		g_variant_dict_init(&dict, node);
+		g_variant_dict_insert(&dict, "partialResultToken", "s", data->partial_token);
+		g_variant_unref(node);
+		node = g_variant_take_ref(g_variant_dict_end(&dict));
+	}
+
 	lsp_rpc_call(server, request, node, goto_cb, data);
 
 	g_free(doc_uri);
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-health.h"
+
+#ifdef G_OS_UNIX
+# include <unistd.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+
+/* consecutive checks above health_cpu_max before restarting - servers use the
+ * whole CPU while indexing for a while, which is fine */
+#define CPU_CHECKS 6
+
+
+extern GeanyPlugin *geany_plugin;
+
+
+struct LspHealth
+{
+	guint source_id;
+	gint64 last_check;  // monotonic time of the last check, microseconds
+	gint64 last_cpu_time;  // CPU time of the process at the last check, microseconds
+	gint cpu_exceeded;  // consecutive checks above health_cpu_max
+	gsize rss;  // resident memory at the last check
+	gdouble cpu;  // CPU usage in percent between the last two checks
+	guint pending;  // requests sent and not answered yet
+	gint64 waiting_since;  // when the server last answered or got a request while idle
+};
+
+
+/* Reads the resident memory and the used CPU time of the process from /proc,
+ * returns FALSE where it isn't available. */
+static gboolean get_process_usage(LspServer *srv, gsize *rss, gint64 *cpu_time)
+{
+#ifdef G_OS_UNIX
+	const gchar *pid = g_subprocess_get_identifier(srv->process);
+	gchar *path, *contents = NULL;
+	gchar **fields;
+	gchar *p;
+	gboolean success = FALSE;
+
+	if (!pid)
+		return FALSE;
+
+	path = g_build_filename("/proc", pid, "statm", NULL);
+	if (g_file_get_contents(path, &contents, NULL, NULL))
+	{
+		// size resident shared ... in pages
+		fields = g_strsplit(contents, " ", 3);
+		if (fields[0] && fields[1])
+		{
+			*rss = (gsize) g_ascii_strtoull(fields[1], NULL, 10) * sysconf(_SC_PAGESIZE);
+			success = TRUE;
+		}
+		g_strfreev(fields);
+	}
+	g_free(contents);
+	g_free(path);
+	contents = NULL;
+
+	path = g_build_filename("/proc", pid, "stat", NULL);
+	// the command name in parentheses may contain spaces - skip it
+	if (success && g_file_get_contents(path, &contents, NULL, NULL) &&
+		(p = strrchr(contents, ')')) != NULL)
+	{
+		// utime and stime are the 12th and 13th fields after the command name
+		fields = g_strsplit(p + 2, " ", 15);
+		if (g_strv_length(fields) >= 14)
+		{
+			guint64 ticks = g_ascii_strtoull(fields[11], NULL, 10) + g_ascii_strtoull(fields[12], NULL, 10);
+
+			*cpu_time = ticks * G_USEC_PER_SEC / sysconf(_SC_CLK_TCK);
+		}
+		else
+			success = FALSE;
+		g_strfreev(fields);
+	}
+	else
+		success = FALSE;
+	g_free(contents);
+	g_free(path);
+
+	return success;
+#else
+	return FALSE;
+#endif
+}
+
+
+/* Returns the reason why srv should be restarted, or NULL when it is healthy. */
+static const gchar *check_health(LspServer *srv, gboolean *force)
+{
+	LspServerConfig *cfg = &srv->config;
+	LspHealth *health = srv->health;
+	gint64 now = g_get_monotonic_time();
+	gint64 cpu_time = 0;
+	gsize rss = 0;
+
+	*force = FALSE;
+
+	if (get_process_usage(srv, &rss, &cpu_time))
+	{
+		if (health->last_check > 0 && now > health->last_check)
+			health->cpu = 100.0 * (cpu_time - health->last_cpu_time) / (now - health->last_check);
+		health->rss = rss;
+		health->last_cpu_time = cpu_time;
+
+		if (cfg->health_cpu_max > 0 && health->cpu > cfg->health_cpu_max)
+			health->cpu_exceeded++;
+		else
+			health->cpu_exceeded = 0;
+	}
+	health->last_check = now;
+
+	if (cfg->health_memory_max > 0 && health->rss > (gsize) cfg->health_memory_max * 1024 * 1024)
+		return "memory limit exceeded";
+	if (health->cpu_exceeded >= CPU_CHECKS)
+		return "CPU limit exceeded";
+	if (cfg->health_response_time_max > 0 && health->pending > 0 &&
+		now - health->waiting_since > (gint64) cfg->health_response_time_max * G_USEC_PER_SEC)
+	{
+		// a shutdown request wouldn't be answered either
+		*force = TRUE;
+		return "not responding";
+	}
+
+	return NULL;
+}
+
+
+static gboolean check_cb(gpointer user_data)
+{
+	LspServer *srv = user_data;
+	const gchar *reason;
+	gboolean force;
+	guint source_id;
+
+	reason = check_health(srv, &force);
+	if (!reason)
+		return G_SOURCE_CONTINUE;
+
+	// the server and its health are freed by the restart
+	source_id = srv->health->source_id;
+	srv->health->source_id = 0;
+	if (lsp_server_restart_unhealthy(srv, reason, force))
+		return G_SOURCE_REMOVE;
+
+	// not restarted (e.g. shutting down or replaced meanwhile) - keep checking
+	srv->health->source_id = source_id;
+	return G_SOURCE_CONTINUE;
+}
+
+
+/* Starts checking the health of the process of srv every health_check_interval
+ * seconds once it's initialized. Servers we only connect to aren't checked. */
+void lsp_health_start(LspServer *srv)
+{
+	LspServerConfig *cfg = &srv->config;
+
+	if (!srv->process || cfg->health_check_interval <= 0 ||
+		(cfg->health_memory_max <= 0 && cfg->health_cpu_max <= 0 && cfg->health_response_time_max <= 0))
+		return;
+
+	if (!srv->health)
+		srv->health = g_new0(LspHealth, 1);
+
+	if (!srv->health->source_id)
+	{
+		srv->health->source_id = plugin_timeout_add_seconds(geany_plugin, cfg->health_check_interval,
+			check_cb, srv);
+	}
+}
+
+
+void lsp_health_request_sent(LspServer *srv)
+{
+	LspHealth *health = srv->health;
+
+	if (!health)
+		return;
+
+	if (health->pending == 0)
+		health->waiting_since = g_get_monotonic_time();
+	health->pending++;
+}
+
+
+void lsp_health_response_received(LspServer *srv)
+{
+	LspHealth *health = srv->health;
+
+	if (!health)
+		return;
+
+	// requests sent before the monitoring started aren't counted
+	if (health->pending > 0)
+		health->pending--;
+	health->waiting_since = g_get_monotonic_time();
+}
+
+
+void lsp_health_append(LspServer *srv, GString *str)
+{
+	LspHealth *health = srv->health;
+
+	if (!health || health->last_check == 0)
+		return;
+
+	g_string_append_printf(str, "memory: %.1f MB, CPU: %.0f %%, requests waiting: %u\n",
+		health->rss / (1024.0 * 1024.0), health->cpu, health->pending);
+}
+
+
+void lsp_health_free(LspServer *srv)
+{
+	if (!srv->health)
+		return;
+
+	if (srv->health->source_id)
+		g_source_remove(srv->health->source_id);
+	g_free(srv->health);
+	srv->health = NULL;
+}
@@ -26,6 +26,8 @@
 
 #include <jsonrpc-glib.h>
 
+#include <string.h>
+
 
 typedef struct {
 	GeanyDocument *doc;
@@ -35,12 +37,44 @@ typedef struct {
 } LspHighlightData;
 
 
+// ranges highlighted per idle callback after the visible ones
+#define PAINT_CHUNK_SIZE 1000
+
+
 static gint indicator;
 static gboolean dirty;
 
+// identifier of the last highlight request, not requested again while the caret stays in it
+static guint last_doc_id;
+static gint last_start_pos = -1;
+static gint last_end_pos = -1;
+
+// ranges of the last response outside the view not highlighted yet
+static guint paint_doc_id;
+static GArray *paint_positions = NULL;
+static GArray *paint_lengths = NULL;
+static guint paint_next;
+static guint paint_source_id;
+
+
+static void cancel_paint(void)
+{
+	if (paint_source_id)
+		g_source_remove(paint_source_id);
+	paint_source_id = 0;
+	if (paint_positions)
+	{
+		g_array_set_size(paint_positions, 0);
+		g_array_set_size(paint_lengths, 0);
+	}
+	paint_next = 0;
+}
+
 
 void lsp_highlight_clear(GeanyDocument *doc)
 {
+	cancel_paint();
+
 	if (dirty)
 	{
 		ScintillaObject *sci = doc->editor->sci;
@@ -72,14 +106,106 @@ void lsp_highlight_style_init(GeanyDocument *doc)
 }
 
 
-static void highlight_range(GeanyDocument *doc, LspRange range)
+static void highlight_range(GArray *positions, GArray *lengths, gint start_pos, gint end_pos)
+{
+	gint len = end_pos - start_pos;
+
+	g_array_append_val(positions, start_pos);
+	g_array_append_val(lengths, len);
+}
+
+
+static gboolean paint_chunk_cb(G_GNUC_UNUSED gpointer user_data)
+{
+	GeanyDocument *doc = document_get_current();
+	guint num;
+
+	// another document was activated in the meantime
+	if (!doc || doc->id != paint_doc_id)
+	{
+		paint_source_id = 0;
+		cancel_paint();
+		return G_SOURCE_REMOVE;
+	}
+
+	num = MIN(PAINT_CHUNK_SIZE, paint_positions->len - paint_next);
+	editor_indicator_set_ranges(doc->editor, indicator,
+		&g_array_index(paint_positions, gint, paint_next),
+		&g_array_index(paint_lengths, gint, paint_next), num);
+	paint_next += num;
+
+	if (paint_next < paint_positions->len)
+		return G_SOURCE_CONTINUE;
+
+	paint_source_id = 0;
+	cancel_paint();
+	return G_SOURCE_REMOVE;
+}
+
+
+/* Highlights the ranges in the visible part of the document immediately and
+ * the rest from idle in chunks, as common identifiers may have thousands of
+ * occurrences. */
+static void paint_ranges(GeanyDocument *doc, GArray *positions, GArray *lengths)
 {
 	ScintillaObject *sci = doc->editor->sci;
-	gint start_pos = lsp_utils_lsp_pos_to_scintilla(sci, range.start);
-	gint end_pos = lsp_utils_lsp_pos_to_scintilla(sci, range.end);
+	gint first_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0), 0);
+	gint last_line = MIN(sci_get_line_count(sci) - 1, first_line + SSM(sci, SCI_LINESONSCREEN, 0, 0));
+	gint visible_start = sci_get_position_from_line(sci, first_line);
+	gint visible_end = sci_get_line_end_position(sci, last_line);
+	GArray *visible_positions = g_array_new(FALSE, FALSE, sizeof(gint));
+	GArray *visible_lengths = g_array_new(FALSE, FALSE, sizeof(gint));
+	guint i;
+
+	if (!paint_positions)
+	{
+		paint_positions = g_array_new(FALSE, FALSE, sizeof(gint));
+		paint_lengths = g_array_new(FALSE, FALSE, sizeof(gint));
+	}
 
-	editor_indicator_set_on_range(doc->editor, indicator, start_pos, end_pos);
+	for (i = 0; i < positions->len; i++)
+	{
+		gint pos = g_array_index(positions, gint, i);
+		gint len = g_array_index(lengths, gint, i);
+
+		if (pos + len >= visible_start && pos <= visible_end)
+		{
+			g_array_append_val(visible_positions, pos);
+			g_array_append_val(visible_lengths, len);
+		}
+		else
+		{
+			g_array_append_val(paint_positions, pos);
+			g_array_append_val(paint_lengths, len);
+		}
+	}
+
+	editor_indicator_set_ranges(doc->editor, indicator, (gint *) visible_positions->data,
+		(gint *) visible_lengths->data, visible_positions->len);
 	dirty = TRUE;
+
+	if (paint_positions->len > 0)
+	{
+		paint_doc_id = doc->id;
+		paint_source_id = g_idle_add_full(G_PRIORITY_LOW, paint_chunk_cb, NULL, NULL);
+	}
+
+	g_array_free(visible_positions, TRUE);
+	g_array_free(visible_lengths, TRUE);
+}
+
+
+/* Whether the text between start_pos and end_pos is identifier, without copying it */
+static gboolean range_is_iden(ScintillaObject *sci, gint start_pos, gint end_pos, const gchar *identifier)
+{
+	gsize len = strlen(identifier);
+	const gchar *text;
+
+	if (end_pos - start_pos != (gint) len)
+		return FALSE;
+
+	text = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start_pos, len);
+	return text && memcmp(text, identifier, len) == 0;
 }
 
 
@@ -95,6 +221,8 @@ static void highlight_cb(GVariant *return_value, GError *error, gpointer user_da
 		{
 			GVariant *member = NULL;
 			GVariantIter iter;
+			GArray *positions = g_array_new(FALSE, FALSE, sizeof(gint));
+			GArray *lengths = g_array_new(FALSE, FALSE, sizeof(gint));
 			gint sel_id = 0;
 			gint main_sel_id = 0;
 			gboolean first_sel = TRUE;
@@ -118,15 +246,14 @@ static void highlight_cb(GVariant *return_value, GError *error, gpointer user_da
 					LspRange r = lsp_utils_parse_range(range);
 					gint start_pos = lsp_utils_lsp_pos_to_scintilla(doc->editor->sci, r.start);
 					gint end_pos = lsp_utils_lsp_pos_to_scintilla(doc->editor->sci, r.end);
-					gchar *ident = sci_get_contents_range(doc->editor->sci, start_pos, end_pos);
 
 					//clangd returns highlight for 'editor' in 'doc-|>editor' where
 					//'|' is the caret position and also other cases, which is strange
 					//restrict to identifiers only
-					if (g_strcmp0(ident, data->identifier) == 0)
+					if (range_is_iden(doc->editor->sci, start_pos, end_pos, data->identifier))
 					{
 						if (data->highlight)
-							highlight_range(doc, r);
+							highlight_range(positions, lengths, start_pos, end_pos);
 						else
 						{
 							SSM(doc->editor->sci, first_sel ? SCI_SETSELECTION : SCI_ADDSELECTION,
@@ -139,11 +266,15 @@ static void highlight_cb(GVariant *return_value, GError *error, gpointer user_da
 						}
 					}
 
-					g_free(ident);
 					g_variant_unref(range);
 				}
 			}
 
+			if (positions->len > 0)
+				paint_ranges(doc, positions, lengths);
+			g_array_free(positions, TRUE);
+			g_array_free(lengths, TRUE);
+
 			if (!data->highlight)
 				SSM(doc->editor->sci, SCI_SETMAINSELECTION, main_sel_id, 0);
 		}
@@ -187,8 +318,13 @@ static void send_request(LspServer *server, GeanyDocument *doc, gint pos, gboole
 		data->pos = pos;
 		data->identifier = g_strdup(iden);
 		data->highlight = highlight;
-		lsp_rpc_call(server, "textDocument/documentHighlight", node,
-			highlight_cb, data);
+		// rename requests must not be cancelled by caret moves
+		if (highlight)
+			lsp_rpc_call_superseding(server, "textDocument/documentHighlight", node, doc,
+				highlight_cb, data);
+		else
+			lsp_rpc_call(server, "textDocument/documentHighlight", node,
+				highlight_cb, data);
 	}
 	else
 		lsp_highlight_clear(doc);
@@ -202,9 +338,32 @@ static void send_request(LspServer *server, GeanyDocument *doc, gint pos, gboole
 
 void lsp_highlight_send_request(LspServer *server, GeanyDocument *doc)
 {
-	gint pos = sci_get_current_position(doc->editor->sci);
+	ScintillaObject *sci = doc->editor->sci;
+	gint pos = sci_get_current_position(sci);
+	gint start_pos, end_pos;
+
+	// the caret moved inside the identifier highlighted last time
+	if (!sci_has_selection(sci) && lsp_utils_get_current_iden_bounds(doc, pos, &start_pos, &end_pos))
+	{
+		if (doc->id == last_doc_id && start_pos == last_start_pos && end_pos == last_end_pos)
+			return;
+	}
+	else
+		start_pos = end_pos = -1;
 
 	send_request(server, doc, pos, TRUE);
+
+	last_doc_id = start_pos >= 0 ? doc->id : 0;
+	last_start_pos = start_pos;
+	last_end_pos = end_pos;
+}
+
+
+/* Edits may add or remove occurrences of the highlighted identifier. */
+void lsp_highlight_text_modified(GeanyDocument *doc, SCNotification *nt)
+{
+	if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+		last_doc_id = 0;
 }
 
 
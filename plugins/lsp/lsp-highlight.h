@@ -31,4 +31,6 @@ void lsp_highlight_rename(gint pos);
 
 void lsp_highlight_clear(GeanyDocument *doc);
 
+void lsp_highlight_text_modified(GeanyDocument *doc, SCNotification *nt);
+
 #endif  /* LSP_HIGHLIGHT_H */
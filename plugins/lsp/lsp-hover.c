@@ -23,17 +23,69 @@
 #include "lsp/lsp-hover.h"
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
+#include "lsp/lsp-sync.h"
+#include "lsp/lsp-lru.h"
 
 #include <jsonrpc-glib.h>
 
 
+#define HOVER_CACHE_SIZE 32
+
+
 typedef struct {
 	GeanyDocument *doc;
 	gint pos;
+	guint version;  // document version the request was made for
+	gint ident_start;
+	gint ident_end;
+	gchar *ident;
 } LspHoverData;
 
 
 static ScintillaObject *calltip_sci;
+// hover texts (possibly empty) of identifiers
+static LspLru *hover_cache = NULL;
+
+
+void lsp_hover_text_modified(GeanyDocument *doc, gint pos)
+{
+	lsp_lru_text_modified(hover_cache, doc, pos);
+}
+
+
+void lsp_hover_destroy(void)
+{
+	lsp_lru_free(hover_cache);
+	hover_cache = NULL;
+}
+
+
+static void free_hover_data(LspHoverData *data)
+{
+	g_free(data->ident);
+	g_free(data);
+}
+
+
+/* Caches the response unless the document changed since the request. */
+static void cache_hover(GeanyDocument *doc, LspHoverData *data, const gchar *str)
+{
+	gchar *ident;
+
+	if (!data->ident || lsp_sync_get_doc_version(doc) != data->version)
+		return;
+
+	// unsent edits don't change the version yet
+	ident = sci_get_contents_range(doc->editor->sci, data->ident_start, data->ident_end);
+	if (g_strcmp0(ident, data->ident) == 0)
+	{
+		if (!hover_cache)
+			hover_cache = lsp_lru_new(HOVER_CACHE_SIZE, g_free);
+		lsp_lru_insert(hover_cache, doc, data->version, data->ident_start, data->ident_end,
+			g_strdup(str ? str : ""));
+	}
+	g_free(ident);
+}
 
 
 static void show_calltip(GeanyDocument *doc, gint pos, const gchar *calltip)
@@ -104,12 +156,14 @@ static void hover_cb(GVariant *return_value, GError *error, gpointer user_data)
 
 			//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
 
+			cache_hover(doc, data, str);
+
 			if (str && strlen(str) > 0)
 				show_calltip(doc, data->pos, str);
 		}
 	}
 
-	g_free(user_data);
+	free_hover_data(user_data);
 }
 
 
@@ -117,9 +171,27 @@ void lsp_hover_send_request(LspServer *server, GeanyDocument *doc, gint pos)
 {
 	GVariant *node;
 	ScintillaObject *sci = doc->editor->sci;
-	LspPosition lsp_pos = lsp_utils_scintilla_pos_to_lsp(sci, pos);
-	gchar *doc_uri = lsp_utils_get_doc_uri(doc);
-	LspHoverData *data = g_new0(LspHoverData, 1);
+	LspPosition lsp_pos;
+	gchar *doc_uri;
+	LspHoverData *data;
+	gint ident_start = SSM(sci, SCI_WORDSTARTPOSITION, pos, TRUE);
+	gint ident_end = SSM(sci, SCI_WORDENDPOSITION, pos, TRUE);
+
+	if (hover_cache && ident_start < ident_end)
+	{
+		const gchar *cached = lsp_lru_lookup(hover_cache, doc, pos);
+
+		if (cached)
+		{
+			if (*cached && gtk_widget_has_focus(GTK_WIDGET(sci)))
+				show_calltip(doc, pos, cached);
+			return;
+		}
+	}
+
+	lsp_pos = lsp_utils_scintilla_pos_to_lsp(sci, pos);
+	doc_uri = lsp_utils_get_doc_uri(doc);
+	data = g_new0(LspHoverData, 1);
 
 	node = JSONRPC_MESSAGE_NEW (
 		"textDocument", "{",
@@ -135,10 +207,19 @@ void lsp_hover_send_request(LspServer *server, GeanyDocument *doc, gint pos)
 
 	data->doc = doc;
 	data->pos = pos;
+	if (ident_start < ident_end)
+	{
+		data->ident_start = ident_start;
+		data->ident_end = ident_end;
+		data->ident = sci_get_contents_range(sci, ident_start, ident_end);
+	}
 
-	lsp_rpc_call(server, "textDocument/hover", node,
+	lsp_rpc_call_superseding(server, "textDocument/hover", node, doc,
 		hover_cb, data);
 
+	// pending edits are sent before the request so read the version afterwards
+	data->version = lsp_sync_get_doc_version(doc);
+
 	g_free(doc_uri);
 	g_variant_unref(node);
 }
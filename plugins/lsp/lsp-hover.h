@@ -27,4 +27,7 @@ void lsp_hover_send_request(LspServer *server, GeanyDocument *doc, gint pos);
 
 void lsp_hover_hide_calltip(GeanyDocument *doc);
 
+void lsp_hover_text_modified(GeanyDocument *doc, gint pos);
+void lsp_hover_destroy(void);
+
 #endif  /* LSP_HOVER_H */
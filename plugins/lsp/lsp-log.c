@@ -24,6 +24,72 @@
 #include "lsp/lsp-utils.h"
 
 #include <glib.h>
+#include <jsonrpc-glib.h>
+#include <string.h>
+
+
+typedef struct
+{
+	gint64 time;  // wall-clock time in microseconds
+	gint64 latency;  // microseconds, -1 unless a response to our request
+	gint64 id;
+	const gchar *method;  // interned
+	gsize size;
+	gssize text_len;  // length of the text substituted for the placeholder or -1
+	LspLogType type;
+	gboolean failed;
+} LspLogTraceEntry;
+
+
+struct LspLogTrace
+{
+	LspLogTraceEntry *entries;
+	guint size;
+	guint64 total;  // number of recorded entries including overwritten ones
+};
+
+
+const gchar *lsp_log_get_title(LspLogType type)
+{
+	switch (type)
+	{
+		case LspLogClientMessageSent:
+			return "C --> S  req:  ";
+		case LspLogClientMessageReceived:
+			return "C <-- S  resp: ";
+		case LspLogClientNotificationSent:
+			return "C --> S  notif:";
+		case LspLogServerMessageSent:
+			return "C <-- S  req:  ";
+		case LspLogServerMessageReceived:
+			return "C --> S  resp: ";
+		case LspLogServerNotificationSent:
+			return "C <-- S  notif:";
+	}
+	return "";
+}
+
+
+static void trace_record(LspLogTrace *trace, LspLogType type, const gchar *method,
+	gint64 id, GVariant *params, GError *error, gint64 req_time, gssize text_len)
+{
+	LspLogTraceEntry *entry = &trace->entries[trace->total % trace->size];
+
+	entry->time = g_get_real_time();
+	entry->latency = req_time ? g_get_monotonic_time() - req_time : -1;
+	entry->id = id;
+	entry->method = g_intern_string(method);
+	// serialized GVariant size - cached by the variant once computed
+	entry->size = params ? g_variant_get_size(params) : 0;
+	// the text is written in place of the placeholder
+	if (text_len >= 0)
+		entry->size = entry->size - MIN(entry->size, strlen(JSONRPC_MESSAGE_TEXT_PLACEHOLDER)) + text_len;
+	entry->text_len = text_len;
+	entry->type = type;
+	entry->failed = error != NULL;
+
+	trace->total++;
+}
 
 
 static void log_print(LspLogInfo log, const gchar *fmt, ...)
@@ -45,9 +111,16 @@ static void log_print(LspLogInfo log, const gchar *fmt, ...)
 
 LspLogInfo lsp_log_start(LspServerConfig *config)
 {
-	LspLogInfo info = {0, TRUE, NULL};
+	LspLogInfo info = {0, TRUE, NULL, NULL};
 	GFile *fp;
 
+	if (config->rpc_trace_entries > 0)
+	{
+		info.trace = g_new0(LspLogTrace, 1);
+		info.trace->size = config->rpc_trace_entries;
+		info.trace->entries = g_new0(LspLogTraceEntry, info.trace->size);
+	}
+
 	if (!config->rpc_log)
 		return info;
 
@@ -78,6 +151,12 @@ LspLogInfo lsp_log_start(LspServerConfig *config)
 
 void lsp_log_stop(LspLogInfo log)
 {
+	if (log.trace)
+	{
+		g_free(log.trace->entries);
+		g_free(log.trace);
+	}
+
 	if (log.type == 0 && !log.stream)
 		return;
 
@@ -90,59 +169,47 @@ void lsp_log_stop(LspLogInfo log)
 }
 
 
-void lsp_log(LspLogInfo log, LspLogType type, const gchar *method, GVariant *params,
-	GError *error, GDateTime *req_time)
+static gchar *format_time(gint64 usec)
+{
+	GDateTime *time = g_date_time_new_from_unix_local(usec / G_USEC_PER_SEC);
+	gchar *ret = g_date_time_format(time, "%H:%M:%S");
+
+	SETPTR(ret, g_strdup_printf("%s.%03d", ret, (gint)(usec % G_USEC_PER_SEC) / 1000));
+	g_date_time_unref(time);
+
+	return ret;
+}
+
+
+static void log_full(LspLogInfo log, LspLogType type, const gchar *method, gint64 id,
+	GVariant *params, GError *error, gint64 req_time, gssize text_len)
 {
 	gchar *json_msg, *time_str;
-	const gchar *title = "";
-	GDateTime *time;
-	gint time_str_len;
+	const gchar *title;
 	gchar *delta_str = NULL;
 	gchar *err_msg;
 
+	if (!method)
+		method = "";
+
+	if (log.trace)
+		trace_record(log.trace, type, method, id, params, error, req_time, text_len);
+
 	if (log.type == 0 && !log.stream)
 		return;
 
 	err_msg = error ? g_strdup_printf("\n%s", error->message) : g_strdup("");
 
-	time = g_date_time_new_now_local();
 	if (req_time)
-	{
-		GTimeSpan delta = g_date_time_difference(time, req_time);
-		delta_str = g_strdup_printf(" (%ld ms)", delta / 1000);
-	}
+		delta_str = g_strdup_printf(" (%ld ms)", (glong)((g_get_monotonic_time() - req_time) / 1000));
+	else if (text_len >= 0)
+		delta_str = g_strdup_printf(" (text of %" G_GSSIZE_FORMAT " bytes sent in place of "
+			JSONRPC_MESSAGE_TEXT_PLACEHOLDER ")", text_len);
 	else
 		delta_str = g_strdup("");
-	time_str = g_date_time_format(time, "\%H:\%M:\%S.\%f");
-	time_str_len = strlen(time_str);
-	if (time_str_len > 3)
-		time_str[time_str_len-3] = '\0';
-	g_date_time_unref(time);
+	time_str = format_time(g_get_real_time());
 
-	if (!method)
-		method = "";
-
-	switch (type)
-	{
-		case LspLogClientMessageSent:
-			title = "C --> S  req:  ";
-			break;
-		case LspLogClientMessageReceived:
-			title = "C <-- S  resp: ";
-			break;
-		case LspLogClientNotificationSent:
-			title = "C --> S  notif:";
-			break;
-		case LspLogServerMessageSent:
-			title = "C <-- S  req:  ";
-			break;
-		case LspLogServerMessageReceived:
-			title = "C --> S  resp: ";
-			break;
-		case LspLogServerNotificationSent:
-			title = "C <-- S  notif:";
-			break;
-	}
+	title = lsp_log_get_title(type);
 
 	if (log.full)
 	{
@@ -161,3 +228,54 @@ void lsp_log(LspLogInfo log, LspLogType type, const gchar *method, GVariant *par
 	g_free(err_msg);
 	g_free(delta_str);
 }
+
+
+/* req_time is the g_get_monotonic_time() when the request was sent, or 0 */
+void lsp_log(LspLogInfo log, LspLogType type, const gchar *method, gint64 id,
+	GVariant *params, GError *error, gint64 req_time)
+{
+	log_full(log, type, method, id, params, error, req_time, -1);
+}
+
+
+/* Logs a notification sent by lsp_rpc_notify_with_text() - params only
+ * contain JSONRPC_MESSAGE_TEXT_PLACEHOLDER instead of the text of text_len
+ * bytes which is written to the server. */
+void lsp_log_with_text(LspLogInfo log, const gchar *method, GVariant *params, gsize text_len)
+{
+	log_full(log, LspLogClientNotificationSent, method, -1, params, NULL, 0, text_len);
+}
+
+
+void lsp_log_append_trace(LspLogInfo log, GString *str)
+{
+	LspLogTrace *trace = log.trace;
+	guint64 i, first;
+
+	if (!trace)
+		return;
+
+	first = trace->total > trace->size ? trace->total - trace->size : 0;
+	if (first > 0)
+		g_string_append_printf(str, "(%" G_GUINT64_FORMAT " older entries overwritten)\n", first);
+
+	for (i = first; i < trace->total; i++)
+	{
+		LspLogTraceEntry *entry = &trace->entries[i % trace->size];
+		gchar *time_str = format_time(entry->time);
+
+		g_string_append_printf(str, "[%s] %s %s", time_str, lsp_log_get_title(entry->type), entry->method);
+		if (entry->id >= 0)
+			g_string_append_printf(str, "  id: %" G_GINT64_FORMAT, entry->id);
+		g_string_append_printf(str, "  size: %" G_GSIZE_FORMAT, entry->size);
+		if (entry->text_len >= 0)
+			g_string_append_printf(str, " (text of %" G_GSSIZE_FORMAT " bytes substituted)", entry->text_len);
+		if (entry->latency >= 0)
+			g_string_append_printf(str, "  latency: %.1f ms", entry->latency / 1000.0);
+		if (entry->failed)
+			g_string_append(str, "  (error)");
+		g_string_append_c(str, '\n');
+
+		g_free(time_str);
+	}
+}
@@ -37,8 +37,13 @@ typedef enum
 LspLogInfo lsp_log_start(LspServerConfig *config);
 void lsp_log_stop(LspLogInfo log);
 
-void lsp_log(LspLogInfo log, LspLogType type, const gchar *method, GVariant *params,
-	GError *error, GDateTime *req_time);
+void lsp_log(LspLogInfo log, LspLogType type, const gchar *method, gint64 id,
+	GVariant *params, GError *error, gint64 req_time);
+void lsp_log_with_text(LspLogInfo log, const gchar *method, GVariant *params, gsize text_len);
+
+void lsp_log_append_trace(LspLogInfo log, GString *str);
+
+const gchar *lsp_log_get_title(LspLogType type);
 
 
 #endif  /* LSP_LOG_H */
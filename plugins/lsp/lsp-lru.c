@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-lru.h"
+#include "lsp/lsp-sync.h"
+
+
+/* Small cache of server responses valid for a range of a document at a given
+ * document version, most recently used entries first. */
+struct LspLru
+{
+	GQueue *entries;
+	guint max_size;
+	GDestroyNotify value_free;
+};
+
+
+typedef struct
+{
+	guint doc_id;
+	guint version;
+	gint start;
+	gint end;
+	gpointer value;
+} LspLruEntry;
+
+
+LspLru *lsp_lru_new(guint max_size, GDestroyNotify value_free)
+{
+	LspLru *lru = g_new0(LspLru, 1);
+
+	lru->entries = g_queue_new();
+	lru->max_size = max_size;
+	lru->value_free = value_free;
+
+	return lru;
+}
+
+
+static void free_entry(LspLru *lru, LspLruEntry *entry)
+{
+	if (lru->value_free)
+		lru->value_free(entry->value);
+	g_free(entry);
+}
+
+
+void lsp_lru_clear(LspLru *lru)
+{
+	LspLruEntry *entry;
+
+	while ((entry = g_queue_pop_head(lru->entries)))
+		free_entry(lru, entry);
+}
+
+
+void lsp_lru_free(LspLru *lru)
+{
+	if (!lru)
+		return;
+
+	lsp_lru_clear(lru);
+	g_queue_free(lru->entries);
+	g_free(lru);
+}
+
+
+/* Returns the value of the entry containing pos valid for the current document
+ * version. */
+gpointer lsp_lru_lookup(LspLru *lru, GeanyDocument *doc, gint pos)
+{
+	guint version = lsp_sync_get_doc_version(doc);
+	GList *node;
+
+	for (node = lru->entries->head; node; node = node->next)
+	{
+		LspLruEntry *entry = node->data;
+
+		if (entry->doc_id == doc->id && entry->version == version &&
+			entry->start <= pos && pos <= entry->end)
+		{
+			g_queue_unlink(lru->entries, node);
+			g_queue_push_head_link(lru->entries, node);
+			return entry->value;
+		}
+	}
+
+	return NULL;
+}
+
+
+void lsp_lru_insert(LspLru *lru, GeanyDocument *doc, guint version, gint start, gint end,
+	gpointer value)
+{
+	LspLruEntry *entry = g_new0(LspLruEntry, 1);
+
+	entry->doc_id = doc->id;
+	entry->version = version;
+	entry->start = start;
+	entry->end = end;
+	entry->value = value;
+
+	g_queue_push_head(lru->entries, entry);
+
+	while (g_queue_get_length(lru->entries) > lru->max_size)
+		free_entry(lru, g_queue_pop_tail(lru->entries));
+}
+
+
+/* Edits shift the positions after them so entries at or behind pos aren't
+ * valid any more, even before the new document version is sent. */
+void lsp_lru_text_modified(LspLru *lru, GeanyDocument *doc, gint pos)
+{
+	GList *node, *next;
+
+	if (!lru)
+		return;
+
+	for (node = lru->entries->head; node; node = next)
+	{
+		LspLruEntry *entry = node->data;
+
+		next = node->next;
+		if (entry->doc_id == doc->id && entry->end >= pos)
+		{
+			g_queue_delete_link(lru->entries, node);
+			free_entry(lru, entry);
+		}
+	}
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef LSP_LRU_H
+#define LSP_LRU_H 1
+
+#include <geanyplugin.h>
+
+#include <glib.h>
+
+
+typedef struct LspLru LspLru;
+
+
+LspLru *lsp_lru_new(guint max_size, GDestroyNotify value_free);
+void lsp_lru_free(LspLru *lru);
+
+gpointer lsp_lru_lookup(LspLru *lru, GeanyDocument *doc, gint pos);
+void lsp_lru_insert(LspLru *lru, GeanyDocument *doc, guint version, gint start, gint end,
+	gpointer value);
+
+void lsp_lru_text_modified(LspLru *lru, GeanyDocument *doc, gint pos);
+void lsp_lru_clear(LspLru *lru);
+
+#endif  /* LSP_LRU_H */
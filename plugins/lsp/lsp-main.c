@@ -22,6 +22,7 @@
 
 #include "lsp-server.h"
 #include "lsp-sync.h"
+#include "lsp-rpc.h"
 #include "lsp-utils.h"
 #include "lsp-autocomplete.h"
 #include "lsp-diagnostics.h"
@@ -34,7 +35,14 @@
 #include "lsp-format.h"
 #include "lsp-highlight.h"
 #include "lsp-rename.h"
+#include "lsp-scheduler.h"
 #include "lsp-command.h"
+#include "lsp-ranking.h"
+#include "lsp-file-index.h"
+#include "lsp-file-watch.h"
+#include "lsp-replay.h"
+#include "lsp-code-lens.h"
+#include "lsp-warm-cache.h"
 
 #include <sys/time.h>
 #include <string.h>
@@ -59,7 +67,7 @@ static gboolean ignore_selection_change;
 static gboolean session_opening;
 
 
-PLUGIN_VERSION_CHECK(246)  //TODO
+PLUGIN_VERSION_CHECK(252)  //TODO
 PLUGIN_SET_TRANSLATABLE_INFO(
 	GEANY_LOCALEDIR,
 	GETTEXT_PACKAGE,
@@ -139,6 +147,7 @@ static void on_document_visible(GeanyDocument *doc)
 	lsp_diagnostics_redraw(doc);
 	lsp_highlight_style_init(doc);
 	lsp_semtokens_style_init(doc);
+	lsp_code_lens_style_init(doc);
 
 	if (!srv)
 		return;
@@ -148,6 +157,12 @@ static void on_document_visible(GeanyDocument *doc)
 	// documents after successful server handshake
 	if (!lsp_sync_is_document_open(doc))
 		lsp_sync_text_document_did_open(srv, doc);
+	else
+		lsp_sync_document_activated(doc);
+
+	if (srv->config.code_lens_enable)
+		lsp_code_lens_send_request(doc);
+	lsp_diagnostics_send_request(doc);
 }
 
 
@@ -164,6 +179,11 @@ static void on_document_close(G_GNUC_UNUSED GObject * obj, GeanyDocument *doc,
 {
 	LspServer *srv = lsp_server_get(doc);
 
+	lsp_semtokens_store_warm_cache(doc);
+	lsp_symbols_store_warm_cache(doc);
+	lsp_symbols_doc_closed(doc);
+	lsp_server_doc_closed(doc);
+
 	if (!srv)
 		return;
 
@@ -178,11 +198,20 @@ static void destroy_all(void)
 	lsp_semtokens_destroy();
 	lsp_symbols_destroy();
 	lsp_command_send_code_action_destroy();
+	lsp_ranking_destroy();
+	lsp_hover_destroy();
+	lsp_signature_destroy();
 }
 
 
 static void stop_and_init_all_servers(void)
 {
+	guint i;
+
+	// the lenses of the stopped servers stay displayed otherwise
+	foreach_document(i)
+		lsp_code_lens_clear(documents[i]);
+
 	lsp_server_stop_all(FALSE);
 	lsp_server_init_all();
 
@@ -210,17 +239,16 @@ static void on_document_save(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
 {
 	LspServer *srv;
 
-	if (g_strcmp0(doc->real_path, lsp_utils_get_config_filename()) == 0)
+	if (g_strcmp0(doc->real_path, lsp_utils_get_config_filename()) == 0 ||
+		lsp_server_uses_init_file(doc->real_path))
 	{
+		// the file monitors may not have reported the change yet
+		lsp_server_clear_config_cache();
 		stop_and_init_all_servers();
 		return;
 	}
 
-	if (lsp_server_uses_init_file(doc->real_path))
-	{
-		stop_and_init_all_servers();
-		return;
-	}
+	lsp_format_doc_saved(doc);
 
 	srv = lsp_server_get(doc);
 	if (!srv)
@@ -285,6 +313,8 @@ static void on_document_reload(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
 	if (!srv)
 		return;
 
+	lsp_semtokens_doc_reloaded(doc);
+	lsp_code_lens_doc_reloaded(doc);
 	lsp_sync_text_document_did_close(srv, doc);
 	lsp_sync_text_document_did_open(srv, doc);
 }
@@ -297,6 +327,12 @@ static void on_document_activate(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
 }
 
 
+static void send_highlight_request(LspServer *srv, GeanyDocument *doc, G_GNUC_UNUSED gint pos)
+{
+	lsp_highlight_send_request(srv, doc);
+}
+
+
 static gboolean on_editor_notify(G_GNUC_UNUSED GObject *obj, GeanyEditor *editor, SCNotification *nt,
 	G_GNUC_UNUSED gpointer user_data)
 {
@@ -350,7 +386,7 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *obj, GeanyEditor *editor
 		else if (srv->config.diagnostics_enable && lsp_diagnostics_has_diag(nt->position))
 			lsp_diagnostics_show_calltip(nt->position);
 		else if (srv->config.hover_enable)
-			lsp_hover_send_request(srv, doc, nt->position);
+			lsp_scheduler_schedule(srv, LspSchedHover, doc, nt->position, lsp_hover_send_request);
 
 		return FALSE;
 	}
@@ -371,15 +407,42 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *obj, GeanyEditor *editor
 	{
 		LspServer *srv;
 
+		lsp_diagnostics_text_modified(sci, nt);
+		lsp_format_text_modified(sci, nt);
+		lsp_code_lens_text_modified(doc, nt);
+		lsp_highlight_text_modified(doc, nt);
+		lsp_semtokens_text_modified(doc, nt);
+
 		// lots of SCN_MODIFIED notifications, filter-out those we are not interested in
 		if (!(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_BEFOREDELETE | SC_MOD_BEFOREINSERT)))
 			return FALSE;
 
+		lsp_hover_text_modified(doc, nt->position);
+		lsp_signature_text_modified(doc, nt->position);
+
 		srv = lsp_server_get(doc);
 
 		if (!srv || !doc->real_path)
 			return FALSE;
 
+		// queued messages take the text of the document when they are sent, they
+		// have to go before it changes
+		if (nt->modificationType & (SC_MOD_BEFOREINSERT | SC_MOD_BEFOREDELETE))
+			lsp_rpc_doc_will_change(srv, doc);
+
+		// the lenses of the new version are requested once typing pauses
+		if (srv->config.code_lens_enable && nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_BEFOREDELETE))
+			lsp_code_lens_send_request(doc);
+		// pulled diagnostics too, when the server supports them
+		if (srv->config.diagnostics_enable && nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_BEFOREDELETE))
+			lsp_diagnostics_send_request(doc);
+		if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_BEFOREDELETE))
+			lsp_command_prefetch_code_actions(doc);
+
+		// batch edits report their changes to the server themselves
+		if (lsp_sync_changes_suspended(doc))
+			return FALSE;
+
 		// BEFORE insert, BEFORE delete - send the original document
 		if (!lsp_sync_is_document_open(doc) &&
 			nt->modificationType & (SC_MOD_BEFOREINSERT | SC_MOD_BEFOREDELETE))
@@ -389,7 +452,16 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *obj, GeanyEditor *editor
 			lsp_sync_text_document_did_open(srv, doc);
 		}
 
-		if (nt->modificationType & SC_MOD_INSERTTEXT)  // after insert
+		if (!srv->use_incremental_sync)
+		{
+			LspPosition pos = {0, 0};
+
+			// the whole document is sent once typing pauses, positions and text
+			// are not needed
+			if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_BEFOREDELETE))
+				lsp_sync_text_document_did_change(srv, doc, pos, pos, NULL);
+		}
+		else if (nt->modificationType & SC_MOD_INSERTTEXT)  // after insert
 		{
 			LspPosition pos_start = lsp_utils_scintilla_pos_to_lsp(sci, nt->position);
 			LspPosition pos_end = pos_start;
@@ -443,11 +515,22 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *obj, GeanyEditor *editor
 			SSM(sci, SCI_AUTOCCANCEL, 0, 0);
 		}
 
+		if (nt->updated & SC_UPDATE_V_SCROLL)
+		{
+			lsp_diagnostics_paint_visible(doc);
+			// resolves the lenses scrolled into view
+			if (srv->config.code_lens_enable)
+				lsp_code_lens_send_request(doc);
+		}
+
 		if (srv->config.highlighting_enable && !ignore_selection_change &&
 			(nt->updated & SC_UPDATE_SELECTION))
 		{
-			lsp_highlight_send_request(srv, doc);
+			lsp_scheduler_schedule(srv, LspSchedHighlight, doc,
+				sci_get_current_position(sci), send_highlight_request);
 		}
+		if (nt->updated & SC_UPDATE_SELECTION)
+			lsp_command_prefetch_code_actions(doc);
 		ignore_selection_change = FALSE;
 	}
 	else if (nt->nmhdr.code == SCN_CHARADDED)
@@ -460,6 +543,15 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *obj, GeanyEditor *editor
 }
 
 
+static void start_file_index(void)
+{
+	gchar *base_path = lsp_utils_get_project_base_path();
+
+	lsp_file_index_start(base_path);
+	g_free(base_path);
+}
+
+
 static void on_project_open(G_GNUC_UNUSED GObject *obj, GKeyFile *kf,
 	G_GNUC_UNUSED gpointer user_data)
 {
@@ -473,6 +565,9 @@ static void on_project_open(G_GNUC_UNUSED GObject *obj, GKeyFile *kf,
 	gtk_widget_set_sensitive(menu_items.user_config, !have_project_config);
 
 	stop_and_init_all_servers();
+	lsp_ranking_load();
+	lsp_server_start_for_project(kf);
+	start_file_index();
 }
 
 
@@ -484,6 +579,7 @@ static void on_project_close(G_GNUC_UNUSED GObject *obj, G_GNUC_UNUSED gpointer
 	gtk_widget_set_sensitive(menu_items.project_config, FALSE);
 
 	stop_and_init_all_servers();
+	lsp_file_index_destroy();
 }
 
 
@@ -593,6 +689,8 @@ static void on_project_save(G_GNUC_UNUSED GObject *obj, GKeyFile *kf,
 	g_key_file_set_integer(kf, "lsp", "settings_type", project_configuration_type);
 	g_key_file_set_string(kf, "lsp", "config_file",
 		project_configuration_file ? project_configuration_file : "");
+
+	lsp_ranking_save();
 }
 
 
@@ -714,6 +812,12 @@ static gboolean calltips_available(GeanyDocument *doc)
 }
 
 
+static void send_signature_request(LspServer *srv, GeanyDocument *doc, G_GNUC_UNUSED gint pos)
+{
+	lsp_signature_send_request(srv, doc);
+}
+
+
 static void calltips_show(GeanyDocument *doc)
 {
 	LspServer *srv = lsp_server_get(doc);
@@ -721,7 +825,8 @@ static void calltips_show(GeanyDocument *doc)
 	if (!srv)
 		return;
 
-	lsp_signature_send_request(srv, doc);
+	lsp_scheduler_schedule(srv, LspSchedSignature, doc, sci_get_current_position(doc->editor->sci),
+		send_signature_request);
 }
 
 
@@ -789,7 +894,8 @@ static void symbol_highlight_request(GeanyDocument *doc, LspSymbolRequestCallbac
 
 static const gchar *symbol_highlight_get_cached(GeanyDocument *doc)
 {
-	return lsp_semtokens_get_cached(doc);
+	// the tokens are highlighted by their positions, not as type keywords
+	return "";
 }
 
 
@@ -846,6 +952,97 @@ static void on_show_initialize_responses(void)
 }
 
 
+static void on_show_rpc_traces(void)
+{
+	gchar *traces = lsp_server_get_rpc_traces();
+	document_new_file(NULL, NULL, traces);
+	g_free(traces);
+}
+
+
+static void on_show_statistics(void)
+{
+	gchar *stats = lsp_server_get_statistics();
+	document_new_file(NULL, NULL, stats);
+	g_free(stats);
+}
+
+
+static void append_memory_usage(GString *str, gsize semtokens, gsize diags, gsize symbols,
+	const gchar *name)
+{
+	g_string_append_printf(str, "%10.1f %10.1f %10.1f %10.1f  %s\n", semtokens / 1024.0,
+		diags / 1024.0, symbols / 1024.0, (semtokens + diags + symbols) / 1024.0, name);
+}
+
+
+static void on_show_memory_usage(void)
+{
+	GString *str = g_string_new("");
+	guint i;
+
+	g_string_append_printf(str, "%10s %10s %10s %10s  %s\n",
+		"semtokens", "diags", "symbols", "total", "document");
+
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+
+		append_memory_usage(str, lsp_semtokens_get_memory_size(doc),
+			lsp_diagnostics_get_memory_size(doc), lsp_symbols_get_memory_size(doc),
+			DOC_FILENAME(doc));
+	}
+
+	// also contains the diagnostics of files which aren't open
+	append_memory_usage(str, lsp_semtokens_get_memory_size(NULL),
+		lsp_diagnostics_get_memory_size(NULL), lsp_symbols_get_memory_size(NULL),
+		"all files");
+	g_string_append(str, "\nsizes in kB\n");
+
+	document_new_file(NULL, NULL, str->str);
+	g_string_free(str, TRUE);
+}
+
+
+static void on_replay_rpc_log(void)
+{
+	GeanyDocument *doc = document_get_current();
+	LspServer *srv = doc ? lsp_server_get_if_running(doc) : NULL;
+	GtkWidget *dialog;
+	gchar *fname = NULL;
+
+	if (!srv)
+	{
+		dialogs_show_msgbox(GTK_MESSAGE_ERROR, "%s",
+			_("No LSP server is running for the current document."));
+		return;
+	}
+
+	dialog = gtk_file_chooser_dialog_new(_("Replay RPC Log"),
+		GTK_WINDOW(geany->main_widgets->window), GTK_FILE_CHOOSER_ACTION_OPEN,
+		_("_Cancel"), GTK_RESPONSE_CANCEL, _("_Open"), GTK_RESPONSE_ACCEPT, NULL);
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT)
+		fname = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+	gtk_widget_destroy(dialog);
+
+	if (fname)
+	{
+		GError *error = NULL;
+		gchar *report = lsp_replay_log(srv, doc, fname, &error);
+
+		if (report)
+			document_new_file(NULL, NULL, report);
+		else
+		{
+			dialogs_show_msgbox(GTK_MESSAGE_ERROR, "%s", error->message);
+			g_error_free(error);
+		}
+		g_free(report);
+		g_free(fname);
+	}
+}
+
+
 static void show_hover_popup(void)
 {
 	GeanyDocument *doc = document_get_current();
@@ -1108,6 +1305,22 @@ static void create_menu_items()
 	gtk_container_add(GTK_CONTAINER(menu), item);
 	g_signal_connect(item, "activate", G_CALLBACK(on_show_initialize_responses), NULL);
 
+	item = gtk_menu_item_new_with_mnemonic(_("Server RPC _Traces"));
+	gtk_container_add(GTK_CONTAINER(menu), item);
+	g_signal_connect(item, "activate", G_CALLBACK(on_show_rpc_traces), NULL);
+
+	item = gtk_menu_item_new_with_mnemonic(_("Server Statisti_cs"));
+	gtk_container_add(GTK_CONTAINER(menu), item);
+	g_signal_connect(item, "activate", G_CALLBACK(on_show_statistics), NULL);
+
+	item = gtk_menu_item_new_with_mnemonic(_("_Memory Usage"));
+	gtk_container_add(GTK_CONTAINER(menu), item);
+	g_signal_connect(item, "activate", G_CALLBACK(on_show_memory_usage), NULL);
+
+	item = gtk_menu_item_new_with_mnemonic(_("Re_play RPC Log..."));
+	gtk_container_add(GTK_CONTAINER(menu), item);
+	g_signal_connect(item, "activate", G_CALLBACK(on_replay_rpc_log), NULL);
+
 	gtk_container_add(GTK_CONTAINER(menu), gtk_separator_menu_item_new());
 
 	item = gtk_menu_item_new_with_mnemonic(_("_Restart All Servers"));
@@ -1176,7 +1389,11 @@ void plugin_init(G_GNUC_UNUSED GeanyData * data)
 {
 	plugin_module_make_resident(geany_plugin);
 
+	lsp_warm_cache_init();
 	stop_and_init_all_servers();
+	lsp_ranking_load();
+	lsp_file_index_set_changed_callback(lsp_file_watch_file_changed);
+	start_file_index();
 
 	lsp_register(&lsp);
 	create_menu_items();
@@ -1185,6 +1402,8 @@ void plugin_init(G_GNUC_UNUSED GeanyData * data)
 
 void plugin_cleanup(void)
 {
+	guint i;
+
 	gtk_widget_destroy(menu_items.parent_item);
 	gtk_widget_destroy(menu_items.goto_type_def);
 	gtk_widget_destroy(menu_items.goto_def);
@@ -1196,9 +1415,23 @@ void plugin_cleanup(void)
 	gtk_widget_destroy(menu_items.separator1);
 	gtk_widget_destroy(menu_items.separator2);
 
+	// documents still open when Geany quits aren't closed before unloading the plugin
+	foreach_document(i)
+	{
+		lsp_semtokens_store_warm_cache(documents[i]);
+		lsp_symbols_store_warm_cache(documents[i]);
+		lsp_code_lens_clear(documents[i]);
+	}
+
 	lsp_unregister(&lsp);
 	lsp_server_stop_all(TRUE);
+	lsp_server_clear_config_cache();
 	destroy_all();
+	lsp_sync_destroy();
+	lsp_file_index_destroy();
+	lsp_file_index_set_changed_callback(NULL);
+	lsp_file_watch_destroy();
+	lsp_warm_cache_destroy();
 }
 
 
@@ -25,6 +25,11 @@
 #include <jsonrpc-glib.h>
 
 
+// servers may send hundreds of reports per second while indexing, the status
+// bar shows the latest one at most once per this interval (in milliseconds)
+#define STATUS_UPDATE_INTERVAL 100
+
+
 typedef struct
 {
 	LspProgressToken token;
@@ -32,7 +37,19 @@ typedef struct
 } LspProgress;
 
 
+typedef struct
+{
+	LspPartialResultCallback callback;
+	gpointer user_data;
+} LspPartialResult;
+
+
 static gint progress_num = 0;
+static guint partial_result_num = 0;
+static GHashTable *partial_results = NULL;  // token -> LspPartialResult
+
+static gchar *pending_status = NULL;
+static guint status_source_id = 0;
 
 
 static void progress_free(LspProgress *p)
@@ -43,6 +60,41 @@ static void progress_free(LspProgress *p)
 }
 
 
+static gboolean update_status_cb(G_GNUC_UNUSED gpointer user_data)
+{
+	ui_set_statusbar(FALSE, "%s", pending_status);
+	g_free(pending_status);
+	pending_status = NULL;
+	status_source_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+
+static void flush_status(void)
+{
+	if (status_source_id)
+	{
+		g_source_remove(status_source_id);
+		update_status_cb(NULL);
+	}
+}
+
+
+/* Replaces the status bar text shown by the next update, title NULL clears it. */
+static void set_status(const gchar *title, const gchar *message)
+{
+	g_free(pending_status);
+	if (title)
+		pending_status = g_strdup_printf("%s: %s", title, message ? message : "");
+	else
+		pending_status = g_strdup("");
+
+	if (!status_source_id)
+		status_source_id = g_timeout_add(STATUS_UPDATE_INTERVAL, update_status_cb, NULL);
+}
+
+
 void lsp_progress_create(LspServer *server, LspProgressToken token)
 {
 	LspProgress *p = g_new0(LspProgress, 1);
@@ -72,7 +124,7 @@ void lsp_progress_begin(LspServer *server, LspProgressToken token, const gchar *
 		if (token_equal(p->token, token))
 		{
 			p->title = g_strdup(title);
-			ui_set_statusbar(FALSE, "%s: %s", p->title, message ? message : "");
+			set_status(p->title, message);
 			if (progress_num == 0)
 				ui_progress_bar_start("");
 			progress_num++;
@@ -91,7 +143,7 @@ void lsp_progress_report(LspServer *server, LspProgressToken token, const gchar
 		LspProgress *p = node->data;
 		if (token_equal(p->token, token))
 		{
-			ui_set_statusbar(FALSE, "%s: %s", p->title, message ? message : "");
+			set_status(p->title, message);
 			break;
 		}
 	}
@@ -112,10 +164,7 @@ void lsp_progress_end(LspServer *server, LspProgressToken token, const gchar *me
 			if (progress_num == 0)
 				ui_progress_bar_stop();
 
-			if (message)
-				ui_set_statusbar(FALSE, "%s: %s", p->title, message ? message : "");
-			else
-				ui_set_statusbar(FALSE, "%s", "");
+			set_status(message ? p->title : NULL, message);
 
 			server->progress_ops = g_slist_remove_link(server->progress_ops, node);
 			g_slist_free_full(node, (GDestroyNotify)progress_free);
@@ -134,6 +183,57 @@ void lsp_progress_free_all(LspServer *server)
 	progress_num = MAX(0, progress_num - len);
 	if (progress_num == 0)
 		ui_progress_bar_stop();
+
+	// don't leave the timeout behind when the plugin is unloaded
+	flush_status();
+}
+
+
+/* Returns a new token to be sent as partialResultToken of a request;
+ * callback is called for every partial result the server sends for it. */
+gchar *lsp_progress_register_partial_result(LspPartialResultCallback callback, gpointer user_data)
+{
+	LspPartialResult *res = g_new0(LspPartialResult, 1);
+	gchar *token = g_strdup_printf("geany-partial-%u", ++partial_result_num);
+
+	if (!partial_results)
+		partial_results = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	res->callback = callback;
+	res->user_data = user_data;
+	g_hash_table_insert(partial_results, g_strdup(token), res);
+
+	return token;
+}
+
+
+void lsp_progress_unregister_partial_result(const gchar *token)
+{
+	if (partial_results && token)
+		g_hash_table_remove(partial_results, token);
+}
+
+
+static gboolean process_partial_result(GVariant *params, const gchar *token_str)
+{
+	LspPartialResult *res;
+	GVariant *value = NULL;
+
+	if (!partial_results || !token_str)
+		return FALSE;
+
+	res = g_hash_table_lookup(partial_results, token_str);
+	if (!res)
+		return FALSE;
+
+	JSONRPC_MESSAGE_PARSE(params, "value", JSONRPC_MESSAGE_GET_VARIANT(&value));
+	if (value)
+	{
+		res->callback(value, res->user_data);
+		g_variant_unref(value);
+	}
+
+	return TRUE;
 }
 
 
@@ -156,6 +256,8 @@ void lsp_progress_process_notification(LspServer *srv, GVariant *params)
 			"token", JSONRPC_MESSAGE_GET_INT64(&token_int)
 		);
 	}
+	else if (process_partial_result(params, token_str))
+		return;
 	JSONRPC_MESSAGE_PARSE(params,
 		"value", "{",
 			"kind", JSONRPC_MESSAGE_GET_STRING(&kind),
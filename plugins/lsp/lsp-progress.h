@@ -37,6 +37,11 @@ void lsp_progress_begin(LspServer *server, LspProgressToken token, const gchar *
 void lsp_progress_report(LspServer *server, LspProgressToken token,	const gchar *message);
 void lsp_progress_end(LspServer *server, LspProgressToken token, const gchar *message);
 
+typedef void (*LspPartialResultCallback) (GVariant *value, gpointer user_data);
+
+gchar *lsp_progress_register_partial_result(LspPartialResultCallback callback, gpointer user_data);
+void lsp_progress_unregister_partial_result(const gchar *token);
+
 void lsp_progress_process_notification(LspServer *srv, GVariant *params);
 
 void lsp_progress_free_all(LspServer *server);
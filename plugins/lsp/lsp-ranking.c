@@ -0,0 +1,409 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-ranking.h"
+
+#include <geanyplugin.h>
+
+#include <string.h>
+
+
+/* Completion items picked by the user, per filetype, stored in a binary file
+ * next to the project file. All numbers are little-endian:
+ *
+ * "LSPR", version (u32), number of filetypes (u32), then for each filetype:
+ *   name length (u8), name, number of items (u32), then for each item:
+ *     count (u32), last use in seconds since epoch (i64), label length (u16), label
+ */
+
+#define RANKING_MAGIC "LSPR"
+#define RANKING_VERSION 1
+#define RANKING_FILE_EXT ".lsp-ranking"
+
+// number of items kept per filetype when saving, the most recently used win
+#define MAX_ITEMS 2000
+// an item gets half of its score when not used for this long
+#define HALF_LIFE (7 * 24 * 60 * 60)
+
+
+typedef struct
+{
+	guint32 count;
+	gint64 last_used;
+} LspRankingItem;
+
+
+extern GeanyData *geany_data;
+
+static GHashTable *rankings = NULL;  // filetype ID -> (label -> LspRankingItem)
+static gchar *ranking_file = NULL;  // locale encoding, NULL without project
+static gboolean dirty = FALSE;
+
+
+static GHashTable *get_filetype_table(gint filetype, gboolean create)
+{
+	GHashTable *table;
+
+	if (!rankings)
+	{
+		if (!create)
+			return NULL;
+		rankings = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+			(GDestroyNotify)g_hash_table_destroy);
+	}
+
+	table = g_hash_table_lookup(rankings, GINT_TO_POINTER(filetype));
+	if (!table && create)
+	{
+		table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+		g_hash_table_insert(rankings, GINT_TO_POINTER(filetype), table);
+	}
+
+	return table;
+}
+
+
+static gint64 get_now(void)
+{
+	return g_get_real_time() / G_USEC_PER_SEC;
+}
+
+
+void lsp_ranking_item_selected(gint filetype, const gchar *label)
+{
+	GHashTable *table;
+	LspRankingItem *item;
+
+	if (!label || !*label)
+		return;
+
+	table = get_filetype_table(filetype, TRUE);
+	item = g_hash_table_lookup(table, label);
+	if (!item)
+	{
+		item = g_new0(LspRankingItem, 1);
+		g_hash_table_insert(table, g_strdup(label), item);
+	}
+
+	if (item->count < G_MAXUINT32)
+		item->count++;
+	item->last_used = get_now();
+	dirty = TRUE;
+}
+
+
+gdouble lsp_ranking_get_score(gint filetype, const gchar *label)
+{
+	GHashTable *table = get_filetype_table(filetype, FALSE);
+	LspRankingItem *item;
+	gint64 age;
+
+	if (!table || !label)
+		return 0;
+
+	item = g_hash_table_lookup(table, label);
+	if (!item)
+		return 0;
+
+	age = MAX(get_now() - item->last_used, 0);
+	return item->count * HALF_LIFE / (gdouble)(HALF_LIFE + age);
+}
+
+
+typedef struct
+{
+	const gchar *data;
+	gsize len;
+	gsize pos;
+} Reader;
+
+
+static const gchar *read_bytes(Reader *r, gsize len)
+{
+	const gchar *ret;
+
+	if (r->len - r->pos < len)
+		return NULL;
+
+	ret = r->data + r->pos;
+	r->pos += len;
+	return ret;
+}
+
+
+static gboolean read_u32(Reader *r, guint32 *val)
+{
+	const gchar *p = read_bytes(r, sizeof(*val));
+
+	if (!p)
+		return FALSE;
+	memcpy(val, p, sizeof(*val));
+	*val = GUINT32_FROM_LE(*val);
+	return TRUE;
+}
+
+
+static gboolean read_i64(Reader *r, gint64 *val)
+{
+	const gchar *p = read_bytes(r, sizeof(*val));
+
+	if (!p)
+		return FALSE;
+	memcpy(val, p, sizeof(*val));
+	*val = GINT64_FROM_LE(*val);
+	return TRUE;
+}
+
+
+static gboolean read_string(Reader *r, gsize len_size, gchar **str)
+{
+	const gchar *p;
+	gsize len = 0;
+
+	if (!(p = read_bytes(r, len_size)))
+		return FALSE;
+
+	if (len_size == 1)
+		len = (guchar)*p;
+	else
+	{
+		guint16 len16;
+		memcpy(&len16, p, sizeof(len16));
+		len = GUINT16_FROM_LE(len16);
+	}
+
+	if (!(p = read_bytes(r, len)) || !g_utf8_validate(p, len, NULL))
+		return FALSE;
+
+	*str = g_strndup(p, len);
+	return TRUE;
+}
+
+
+static gboolean read_rankings(Reader *r)
+{
+	const gchar *magic;
+	guint32 version, ft_num, i;
+
+	magic = read_bytes(r, strlen(RANKING_MAGIC));
+	if (!magic || strncmp(magic, RANKING_MAGIC, strlen(RANKING_MAGIC)) != 0)
+		return FALSE;
+	if (!read_u32(r, &version) || version != RANKING_VERSION)
+		return FALSE;
+	if (!read_u32(r, &ft_num))
+		return FALSE;
+
+	for (i = 0; i < ft_num; i++)
+	{
+		GeanyFiletype *ft;
+		GHashTable *table = NULL;
+		gchar *ft_name;
+		guint32 item_num, j;
+
+		if (!read_string(r, 1, &ft_name))
+			return FALSE;
+		// filetypes may be removed in the meantime - skip their items
+		ft = filetypes_lookup_by_name(ft_name);
+		if (ft)
+			table = get_filetype_table(ft->id, TRUE);
+		g_free(ft_name);
+
+		if (!read_u32(r, &item_num))
+			return FALSE;
+
+		for (j = 0; j < item_num; j++)
+		{
+			LspRankingItem *item = g_new0(LspRankingItem, 1);
+			gchar *label;
+
+			if (!read_u32(r, &item->count) || !read_i64(r, &item->last_used) ||
+				!read_string(r, 2, &label))
+			{
+				g_free(item);
+				return FALSE;
+			}
+
+			if (table)
+				g_hash_table_insert(table, label, item);
+			else
+			{
+				g_free(label);
+				g_free(item);
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+
+static void clear_rankings(void)
+{
+	if (rankings)
+		g_hash_table_destroy(rankings);
+	rankings = NULL;
+	dirty = FALSE;
+}
+
+
+void lsp_ranking_load(void)
+{
+	GeanyProject *project = geany_data->app->project;
+	GMappedFile *file;
+	gchar *fname;
+
+	lsp_ranking_destroy();
+
+	if (!project)
+		return;
+
+	fname = g_strconcat(project->file_name, RANKING_FILE_EXT, NULL);
+	ranking_file = utils_get_locale_from_utf8(fname);
+
+	file = g_mapped_file_new(ranking_file, FALSE, NULL);
+	if (file)
+	{
+		Reader r = {g_mapped_file_get_contents(file), g_mapped_file_get_length(file), 0};
+
+		if (!read_rankings(&r))
+		{
+			msgwin_status_add("Invalid LSP completion ranking file %s", fname);
+			clear_rankings();
+		}
+		g_mapped_file_unref(file);
+	}
+
+	g_free(fname);
+}
+
+
+static void write_u32(GByteArray *arr, guint32 val)
+{
+	val = GUINT32_TO_LE(val);
+	g_byte_array_append(arr, (guint8 *)&val, sizeof(val));
+}
+
+
+static void write_i64(GByteArray *arr, gint64 val)
+{
+	val = GINT64_TO_LE(val);
+	g_byte_array_append(arr, (guint8 *)&val, sizeof(val));
+}
+
+
+static gint sort_items_by_last_use(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GHashTable *table = user_data;
+	LspRankingItem *item1 = g_hash_table_lookup(table, a);
+	LspRankingItem *item2 = g_hash_table_lookup(table, b);
+
+	if (item1->last_used != item2->last_used)
+		return item1->last_used > item2->last_used ? -1 : 1;
+	return 0;
+}
+
+
+static void write_filetype(GByteArray *arr, const gchar *ft_name, GHashTable *table)
+{
+	GList *labels = g_hash_table_get_keys(table);
+	GList *node;
+	guint32 num = 0;
+	guint len_pos;
+	guint8 ft_len = strlen(ft_name);
+
+	g_byte_array_append(arr, &ft_len, 1);
+	g_byte_array_append(arr, (const guint8 *)ft_name, ft_len);
+
+	len_pos = arr->len;
+	write_u32(arr, 0);
+
+	labels = g_list_sort_with_data(labels, sort_items_by_last_use, table);
+
+	for (node = labels; node && num < MAX_ITEMS; node = node->next)
+	{
+		const gchar *label = node->data;
+		LspRankingItem *item = g_hash_table_lookup(table, label);
+		gsize label_len = strlen(label);
+		guint16 len16;
+
+		if (label_len > G_MAXUINT16)
+			continue;
+
+		write_u32(arr, item->count);
+		write_i64(arr, item->last_used);
+		len16 = GUINT16_TO_LE(label_len);
+		g_byte_array_append(arr, (guint8 *)&len16, sizeof(len16));
+		g_byte_array_append(arr, (const guint8 *)label, label_len);
+		num++;
+	}
+
+	num = GUINT32_TO_LE(num);
+	memcpy(arr->data + len_pos, &num, sizeof(num));
+
+	g_list_free(labels);
+}
+
+
+void lsp_ranking_save(void)
+{
+	GByteArray *arr;
+	GHashTableIter iter;
+	gpointer key, value;
+	guint32 ft_num = 0;
+
+	if (!dirty || !ranking_file || !rankings)
+		return;
+
+	arr = g_byte_array_new();
+	g_byte_array_append(arr, (const guint8 *)RANKING_MAGIC, strlen(RANKING_MAGIC));
+	write_u32(arr, RANKING_VERSION);
+	write_u32(arr, 0);
+
+	g_hash_table_iter_init(&iter, rankings);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		GeanyFiletype *ft = filetypes_index(GPOINTER_TO_INT(key));
+
+		if (ft && strlen(ft->name) <= G_MAXUINT8)
+		{
+			write_filetype(arr, ft->name, value);
+			ft_num++;
+		}
+	}
+
+	ft_num = GUINT32_TO_LE(ft_num);
+	memcpy(arr->data + strlen(RANKING_MAGIC) + sizeof(guint32), &ft_num, sizeof(ft_num));
+
+	if (g_file_set_contents(ranking_file, (const gchar *)arr->data, arr->len, NULL))
+		dirty = FALSE;
+
+	g_byte_array_free(arr, TRUE);
+}
+
+
+void lsp_ranking_destroy(void)
+{
+	lsp_ranking_save();
+	clear_rankings();
+
+	g_free(ranking_file);
+	ranking_file = NULL;
+}
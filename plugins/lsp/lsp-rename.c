@@ -23,6 +23,7 @@
 #include "lsp/lsp-rename.h"
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
+#include "lsp/lsp-workspace-edit.h"
 
 #include <jsonrpc-glib.h>
 
@@ -34,6 +35,29 @@ static struct
 	GtkWidget *combo;
 } rename_dialog = {NULL, NULL, NULL};
 
+static struct
+{
+	GtkWidget *widget;
+	GtkWidget *summary_label;
+	GtkListStore *store;
+} preview_dialog = {NULL, NULL, NULL};
+
+enum
+{
+	PREVIEW_COLUMN_FILE,
+	PREVIEW_COLUMN_CHANGES,
+	PREVIEW_COLUMN_WEIGHT,
+	PREVIEW_COLUMN_NUM
+};
+
+
+typedef struct
+{
+	GCallback on_rename_done;
+	gchar *old_name;
+	gchar *new_name;
+} RenameData;
+
 
 extern GeanyData *geany_data;
 
@@ -65,7 +89,7 @@ static gchar *show_dialog_rename(const gchar *old_name)
 		gtk_label_set_use_markup(GTK_LABEL(label), TRUE);
 		gtk_box_pack_start(GTK_BOX(vbox), label, TRUE, FALSE, 0);
 
-		label = gtk_label_new(_("By pressing the <i>Rename</i> button below, you are going to replace <i>Old name</i> with <i>New name</i> <b>in the whole project</b>. There is no further confirmation or change review after this step."));
+		label = gtk_label_new(_("By pressing the <i>Rename</i> button below, you are going to replace <i>Old name</i> with <i>New name</i> <b>in the whole project</b>. The affected files are listed for confirmation before they are changed."));
 		gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
 		gtk_label_set_use_markup(GTK_LABEL(label), TRUE);
 		gtk_label_set_line_wrap(GTK_LABEL(label), TRUE);
@@ -132,19 +156,118 @@ static gchar *show_dialog_rename(const gchar *old_name)
 }
 
 
+static void create_dialog_preview(void)
+{
+	GtkWidget *vbox, *label, *swin, *tree;
+	GtkCellRenderer *renderer;
+	GtkTreeViewColumn *column;
+
+	preview_dialog.widget = gtk_dialog_new_with_buttons(
+		_("Rename Preview"), GTK_WINDOW(geany->main_widgets->window),
+		GTK_DIALOG_DESTROY_WITH_PARENT,
+		GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL, NULL);
+	gtk_window_set_default_size(GTK_WINDOW(preview_dialog.widget), 600, 400);
+	gtk_dialog_add_button(GTK_DIALOG(preview_dialog.widget), _("Apply"), GTK_RESPONSE_ACCEPT);
+	gtk_dialog_set_default_response(GTK_DIALOG(preview_dialog.widget), GTK_RESPONSE_CANCEL);
+
+	vbox = ui_dialog_vbox_new(GTK_DIALOG(preview_dialog.widget));
+	gtk_box_set_spacing(GTK_BOX(vbox), 6);
+
+	preview_dialog.summary_label = gtk_label_new("");
+	gtk_label_set_use_markup(GTK_LABEL(preview_dialog.summary_label), TRUE);
+	gtk_misc_set_alignment(GTK_MISC(preview_dialog.summary_label), 0, 0);
+	gtk_label_set_line_wrap(GTK_LABEL(preview_dialog.summary_label), TRUE);
+	gtk_box_pack_start(GTK_BOX(vbox), preview_dialog.summary_label, FALSE, FALSE, 0);
+
+	preview_dialog.store = gtk_list_store_new(PREVIEW_COLUMN_NUM, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_INT);
+	tree = gtk_tree_view_new_with_model(GTK_TREE_MODEL(preview_dialog.store));
+
+	renderer = gtk_cell_renderer_text_new();
+	column = gtk_tree_view_column_new_with_attributes(_("Changes"), renderer,
+		"text", PREVIEW_COLUMN_CHANGES, "weight", PREVIEW_COLUMN_WEIGHT, NULL);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+
+	renderer = gtk_cell_renderer_text_new();
+	column = gtk_tree_view_column_new_with_attributes(_("File"), renderer,
+		"text", PREVIEW_COLUMN_FILE, "weight", PREVIEW_COLUMN_WEIGHT, NULL);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+
+	swin = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(swin),
+		GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(swin), GTK_SHADOW_IN);
+	gtk_container_add(GTK_CONTAINER(swin), tree);
+	gtk_box_pack_start(GTK_BOX(vbox), swin, TRUE, TRUE, 0);
+
+	label = gtk_label_new(_("Files in bold are open and are changed in the editor, the others are rewritten on disk in the background."));
+	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	gtk_label_set_line_wrap(GTK_LABEL(label), TRUE);
+	gtk_box_pack_start(GTK_BOX(vbox), label, FALSE, FALSE, 0);
+
+	gtk_widget_show_all(vbox);
+}
+
+
+/* Lists the files of the edit set with the number of their changes, neither
+ * of which needs the files to be opened. */
+static gboolean show_dialog_preview(GPtrArray *files, const gchar *old_name, const gchar *new_name)
+{
+	guint changes = 0;
+	gchar *summary;
+	gint res;
+	guint i;
+
+	if (!preview_dialog.widget)
+		create_dialog_preview();
+
+	gtk_list_store_clear(preview_dialog.store);
+	for (i = 0; i < files->len; i++)
+	{
+		LspFileEdits *file = files->pdata[i];
+
+		gtk_list_store_insert_with_values(preview_dialog.store, NULL, -1,
+			PREVIEW_COLUMN_FILE, file->fname,
+			PREVIEW_COLUMN_CHANGES, file->edits->len,
+			PREVIEW_COLUMN_WEIGHT, file->is_open ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL,
+			-1);
+		changes += file->edits->len;
+	}
+
+	summary = g_markup_printf_escaped(_("Renaming <b>%s</b> to <b>%s</b> changes %u occurrences in %u files."),
+		old_name, new_name, changes, files->len);
+	gtk_label_set_markup(GTK_LABEL(preview_dialog.summary_label), summary);
+	g_free(summary);
+
+	res = gtk_dialog_run(GTK_DIALOG(preview_dialog.widget));
+	gtk_widget_hide(preview_dialog.widget);
+	gtk_list_store_clear(preview_dialog.store);
+
+	return res == GTK_RESPONSE_ACCEPT;
+}
+
+
 static void rename_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
-	GCallback on_rename_done = user_data;
+	RenameData *data = user_data;
 
 	if (!error)
 	{
+		GPtrArray *files;
+
 		//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
 
-		if (lsp_utils_apply_workspace_edit(return_value))
-			on_rename_done();
+		files = lsp_workspace_edit_parse(return_value);
+		if (files && files->len > 0 && show_dialog_preview(files, data->old_name, data->new_name))
+			lsp_workspace_edit_apply_files(files, data->on_rename_done);
+		else if (files)
+			g_ptr_array_free(files, TRUE);
 	}
 	else
 		dialogs_show_msgbox(GTK_MESSAGE_ERROR, "%s", error->message);
+
+	g_free(data->old_name);
+	g_free(data->new_name);
+	g_free(data);
 }
 
 
@@ -170,6 +293,7 @@ void lsp_rename_send_request(gint pos, GCallback on_rename_done)
 		if (new_name && new_name[0])
 		{
 			gchar *doc_uri = lsp_utils_get_doc_uri(doc);
+			RenameData *data = g_new0(RenameData, 1);
 
 			node = JSONRPC_MESSAGE_NEW (
 				"textDocument", "{",
@@ -184,8 +308,12 @@ void lsp_rename_send_request(gint pos, GCallback on_rename_done)
 
 			//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
+			data->on_rename_done = on_rename_done;
+			data->old_name = g_strdup(iden);
+			data->new_name = g_strdup(new_name);
+
 			lsp_rpc_call(srv, "textDocument/rename", node,
-				rename_cb, on_rename_done);
+				rename_cb, data);
 
 			g_free(doc_uri);
 			g_variant_unref(node);
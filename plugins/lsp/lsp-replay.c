@@ -0,0 +1,285 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Replays the messages a server sent in a log written with rpc_log_full=true
+ * into the handlers of the plugin and measures how long their processing takes,
+ * without a running server. Notifications such as diagnostics are processed as
+ * if sent by the server of the current document; semantic token and completion
+ * responses are applied to the current document. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-replay.h"
+#include "lsp/lsp-autocomplete.h"
+#include "lsp/lsp-log.h"
+#include "lsp/lsp-rpc.h"
+#include "lsp/lsp-semtokens.h"
+#include "lsp/lsp-utils.h"
+
+#include <jsonrpc-glib.h>
+#include <string.h>
+
+
+typedef struct
+{
+	gchar *name;
+	guint count;
+	gsize bytes;
+	gint64 decode_time;  // JSON to GVariant, done by the JSON-RPC decoder normally
+	gint64 handle_time;
+	gint64 max_time;  // slowest message, decoding and handling
+} ReplayStats;
+
+
+static void replay_stats_free(ReplayStats *stats)
+{
+	g_free(stats->name);
+	g_free(stats);
+}
+
+
+static gboolean is_replayable(LspLogType type, const gchar *method)
+{
+	if (type == LspLogServerNotificationSent)
+		return TRUE;
+
+	return g_strcmp0(method, "textDocument/semanticTokens/full") == 0 ||
+		g_strcmp0(method, "textDocument/semanticTokens/full/delta") == 0 ||
+		g_strcmp0(method, "textDocument/completion") == 0;
+}
+
+
+static void replay_message(LspServer *srv, GeanyDocument *doc, LspLogType type,
+	const gchar *method, GVariant *params)
+{
+	if (type == LspLogServerNotificationSent)
+		lsp_rpc_process_notification(srv, method, params);
+	else if (g_strcmp0(method, "textDocument/semanticTokens/full") == 0)
+		lsp_semtokens_process_result(srv, doc, params, FALSE);
+	else if (g_strcmp0(method, "textDocument/semanticTokens/full/delta") == 0)
+		lsp_semtokens_process_result(srv, doc, params, TRUE);
+	else if (g_strcmp0(method, "textDocument/completion") == 0)
+		lsp_autocomplete_process_response(srv, doc, params);
+}
+
+
+/* key has the form "[12:34:56.789] C <-- S  resp:  method (12 ms)" */
+static gchar *parse_key(const gchar *key, LspLogType *type)
+{
+	const LspLogType types[] = {LspLogServerNotificationSent, LspLogClientMessageReceived};
+	const gchar *p = strstr(key, "] ");
+	guint i;
+
+	if (!p)
+		return NULL;
+	p += 2;
+
+	for (i = 0; i < G_N_ELEMENTS(types); i++)
+	{
+		const gchar *title = lsp_log_get_title(types[i]);
+
+		if (g_str_has_prefix(p, title))
+		{
+			const gchar *end;
+
+			p += strlen(title);
+			if (*p == ' ')
+				p++;
+			end = strstr(p, " (");
+			*type = types[i];
+			return end ? g_strndup(p, end - p) : g_strdup(p);
+		}
+	}
+
+	return NULL;
+}
+
+
+static void add_time(GHashTable *table, LspLogType type, const gchar *method, gsize bytes,
+	gint64 decode_time, gint64 handle_time)
+{
+	gchar *name = g_strconcat(type == LspLogServerNotificationSent ? "notif: " : "resp:  ",
+		method, NULL);
+	ReplayStats *stats = g_hash_table_lookup(table, name);
+
+	if (!stats)
+	{
+		stats = g_new0(ReplayStats, 1);
+		stats->name = name;
+		g_hash_table_insert(table, stats->name, stats);
+	}
+	else
+		g_free(name);
+
+	stats->count++;
+	stats->bytes += bytes;
+	stats->decode_time += decode_time;
+	stats->handle_time += handle_time;
+	stats->max_time = MAX(stats->max_time, decode_time + handle_time);
+}
+
+
+/* slowest first */
+static gint compare_stats(gconstpointer a, gconstpointer b)
+{
+	const ReplayStats *s1 = *((ReplayStats **) a);
+	const ReplayStats *s2 = *((ReplayStats **) b);
+	gint64 t1 = s1->decode_time + s1->handle_time;
+	gint64 t2 = s2->decode_time + s2->handle_time;
+
+	return t1 < t2 ? 1 : t1 > t2 ? -1 : 0;
+}
+
+
+static void append_report(GString *str, GHashTable *table, const gchar *fname,
+	guint skipped, guint invalid)
+{
+	GPtrArray *sorted = g_ptr_array_new();
+	ReplayStats sum = {0};
+	GHashTableIter iter;
+	gpointer val;
+	guint i;
+
+	g_hash_table_iter_init(&iter, table);
+	while (g_hash_table_iter_next(&iter, NULL, &val))
+		g_ptr_array_add(sorted, val);
+	g_ptr_array_sort(sorted, compare_stats);
+
+	g_string_append_printf(str, "Replay of %s\n\n", fname);
+	g_string_append_printf(str, "%8s %10s %12s %12s %10s %10s  %s\n", "count", "kB",
+		"decode ms", "handle ms", "avg ms", "max ms", "message");
+
+	for (i = 0; i < sorted->len; i++)
+	{
+		ReplayStats *stats = sorted->pdata[i];
+		gint64 total = stats->decode_time + stats->handle_time;
+
+		g_string_append_printf(str, "%8u %10.1f %12.3f %12.3f %10.3f %10.3f  %s\n",
+			stats->count, stats->bytes / 1024.0, stats->decode_time / 1000.0,
+			stats->handle_time / 1000.0, total / 1000.0 / stats->count,
+			stats->max_time / 1000.0, stats->name);
+
+		sum.count += stats->count;
+		sum.bytes += stats->bytes;
+		sum.decode_time += stats->decode_time;
+		sum.handle_time += stats->handle_time;
+		sum.max_time = MAX(sum.max_time, stats->max_time);
+	}
+
+	if (sum.count > 0)
+	{
+		g_string_append_printf(str, "%8u %10.1f %12.3f %12.3f %10.3f %10.3f  %s\n",
+			sum.count, sum.bytes / 1024.0, sum.decode_time / 1000.0, sum.handle_time / 1000.0,
+			(sum.decode_time + sum.handle_time) / 1000.0 / sum.count, sum.max_time / 1000.0,
+			"all messages");
+	}
+	else
+		g_string_append(str, "no replayable messages found\n");
+
+	g_string_append_printf(str, "\n%u messages not replayed, %u invalid messages\n",
+		skipped, invalid);
+
+	g_ptr_array_free(sorted, TRUE);
+}
+
+
+/* Returns the report of the replay of the log file fname, or NULL and sets
+ * error if it can't be read. */
+gchar *lsp_replay_log(LspServer *srv, GeanyDocument *doc, const gchar *fname, GError **error)
+{
+	GHashTable *table;
+	GString *str;
+	gchar *contents;
+	gchar **entries, **entry;
+	guint skipped = 0, invalid = 0;
+
+	if (!g_file_get_contents(fname, &contents, NULL, error))
+		return NULL;
+
+	table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)replay_stats_free);
+
+	// JSON strings are escaped so entries, written as "\n\n\"key\":\nvalue,\n",
+	// can be split without parsing the whole file - which also works for the
+	// truncated log of a crashed session
+	entries = g_strsplit(contents, "\n\n\n", -1);
+	g_free(contents);
+
+	foreach_strv(entry, entries)
+	{
+		gchar *key_end = strstr(*entry, "\":\n");
+		gchar *method, *value;
+		LspLogType type;
+		JsonNode *node;
+		GVariant *params;
+		gint64 start, decoded;
+		gsize len;
+
+		if (**entry != '"' || !key_end)
+			continue;
+
+		*key_end = '\0';
+		method = parse_key(*entry + 1, &type);
+		if (!method || !is_replayable(type, method))
+		{
+			skipped++;
+			g_free(method);
+			continue;
+		}
+
+		value = g_strchomp(key_end + 3);
+		len = strlen(value);
+		if (len > 0 && value[len - 1] == ',')
+			value[--len] = '\0';
+
+		start = g_get_monotonic_time();
+		node = json_from_string(value, NULL);
+		params = node && !JSON_NODE_HOLDS_NULL(node) ?
+			json_gvariant_deserialize(node, NULL, NULL) : NULL;
+		decoded = g_get_monotonic_time();
+
+		if (params)
+		{
+			g_variant_take_ref(params);
+			replay_message(srv, doc, type, method, params);
+			add_time(table, type, method, len, decoded - start, g_get_monotonic_time() - decoded);
+			g_variant_unref(params);
+		}
+		else if (node)
+			skipped++;  // null result
+		else
+			invalid++;  // e.g. the last entry of a truncated log
+
+		if (node)
+			json_node_free(node);
+		g_free(method);
+	}
+
+	// the replayed completion doesn't belong to the current position
+	SSM(doc->editor->sci, SCI_AUTOCCANCEL, 0, 0);
+	lsp_autocomplete_clear_cache();
+
+	str = g_string_new("");
+	append_report(str, table, fname, skipped, invalid);
+
+	g_strfreev(entries);
+	g_hash_table_destroy(table);
+	return g_string_free(str, FALSE);
+}
@@ -23,12 +23,18 @@
 #include "lsp/lsp-rpc.h"
 #include "lsp/lsp-server.h"
 #include "lsp/lsp-diagnostics.h"
+#include "lsp/lsp-file-watch.h"
 #include "lsp/lsp-progress.h"
 #include "lsp/lsp-log.h"
+#include "lsp/lsp-stats.h"
+#include "lsp/lsp-health.h"
+#include "lsp/lsp-sync.h"
 #include "lsp/lsp-utils.h"
+#include "lsp/lsp-workspace-edit.h"
 
 #include <jsonrpc-glib.h>
 #include <stdio.h>
+#include <string.h>
 
 
 typedef struct
@@ -36,14 +42,45 @@ typedef struct
 	gchar *method_name;
 	gpointer user_data;
 	LspRpcCallback callback;
-	GDateTime *req_time;
+	gint64 req_time;  // g_get_monotonic_time() when sent
 	gboolean cb_on_startup_shutdown;
+	gint64 id;
+	gchar *supersede_key;
+	gboolean cancelled;
+	struct QueuedMessage *queued;  // when waiting in the background queue
+	guint doc_id;  // the document the response is for, 0 if none
+	guint doc_version;  // its version when the request was made
+	gboolean drop_if_edited;
+	gboolean stale;  // the response is dropped without being processed
 } CallbackData;
 
 
+typedef enum
+{
+	LspRpcPrioritySync,  // notifications, mostly document synchronization
+	LspRpcPriorityInteractive,  // requests the user typically waits for
+	LspRpcPriorityBackground  // whole-document and workspace requests, opening of inactive documents
+} LspRpcPriority;
+
+
+typedef struct QueuedMessage
+{
+	gchar *method;
+	GVariant *params;
+	guint text_doc_id;  // the document replacing the text placeholder, 0 if none
+	gchar *doc_uri;
+	gboolean is_request;
+	CallbackData *data;
+} QueuedMessage;
+
+
 struct LspRpc
 {
 	JsonrpcClient *client;
+	GHashTable *superseding;  // supersede key -> CallbackData of the last request
+	GHashTable *in_flight;  // request id -> CallbackData of the sent requests
+	GQueue *background;  // QueuedMessage
+	gboolean writing;  // messages passed to client haven't been written yet
 };
 
 
@@ -99,10 +136,18 @@ static void handle_notification(JsonrpcClient *client, gchar *method, GVariant *
 	if (!srv)
 		return;
 
-	lsp_log(srv->log, LspLogServerNotificationSent, method, params, NULL, NULL);
+	lsp_log(srv->log, LspLogServerNotificationSent, method, -1, params, NULL, 0);
+
+	stallwatch_enter(g_intern_string(method));
+	lsp_rpc_process_notification(srv, method, params);
+	stallwatch_leave();
+}
+
 
+void lsp_rpc_process_notification(LspServer *srv, const gchar *method, GVariant *params)
+{
 	if (g_strcmp0(method, "textDocument/publishDiagnostics") == 0)
-		lsp_diagnostics_received(params);
+		lsp_diagnostics_received(srv, params);
 	else if (g_strcmp0(method, "window/logMessage") == 0 ||
 		g_strcmp0(method, "window/showMessage") == 0)
 	{
@@ -120,6 +165,14 @@ static void handle_notification(JsonrpcClient *client, gchar *method, GVariant *
 }
 
 
+static gint64 get_request_id(GVariant *id)
+{
+	if (id && g_variant_is_of_type(id, G_VARIANT_TYPE_INT64))
+		return g_variant_get_int64(id);
+	return -1;
+}
+
+
 static gboolean handle_call(JsonrpcClient *client, gchar* method, GVariant *id, GVariant *params,
 	gpointer user_data)
 {
@@ -134,7 +187,7 @@ static gboolean handle_call(JsonrpcClient *client, gchar* method, GVariant *id,
 	node = json_from_string("{}", NULL);
 	variant = json_gvariant_deserialize(node, NULL, NULL);
 
-	lsp_log(srv->log, LspLogServerMessageSent, method, params, NULL, NULL);
+	lsp_log(srv->log, LspLogServerMessageSent, method, get_request_id(id), params, NULL, 0);
 
 	//printf("\n\nREQUEST FROM SERVER: %s\n", method);
 	//printf("params:\n%s\n\n\n", lsp_utils_json_pretty_print(params));
@@ -173,7 +226,7 @@ static gboolean handle_call(JsonrpcClient *client, gchar* method, GVariant *id,
 			"edit", JSONRPC_MESSAGE_GET_VARIANT(&edit)
 		);
 
-		success = lsp_utils_apply_workspace_edit(edit);
+		success = lsp_workspace_edit_apply(edit);
 
 		node = JSONRPC_MESSAGE_NEW(
 			"applied", JSONRPC_MESSAGE_PUT_BOOLEAN(success)
@@ -185,8 +238,20 @@ static gboolean handle_call(JsonrpcClient *client, gchar* method, GVariant *id,
 		g_variant_unref(edit);
 		ret = TRUE;
 	}
+	else if (g_strcmp0(method, "client/registerCapability") == 0)
+	{
+		lsp_file_watch_register(srv, params);
+		jsonrpc_client_reply_async(client, id, NULL, NULL, NULL, NULL);
+		ret = TRUE;
+	}
+	else if (g_strcmp0(method, "client/unregisterCapability") == 0)
+	{
+		lsp_file_watch_unregister(srv, params);
+		jsonrpc_client_reply_async(client, id, NULL, NULL, NULL, NULL);
+		ret = TRUE;
+	}
 
-	lsp_log(srv->log, LspLogServerMessageReceived, method, variant, NULL, NULL);
+	lsp_log(srv->log, LspLogServerMessageReceived, method, get_request_id(id), variant, NULL, 0);
 	g_variant_unref(variant);
 	json_node_free(node);
 
@@ -194,6 +259,30 @@ static gboolean handle_call(JsonrpcClient *client, gchar* method, GVariant *id,
 }
 
 
+static LspStatsResult get_stats_result(GError *error)
+{
+	if (!error)
+		return LspStatsSuccess;
+
+	// RequestCancelled and ContentModified LSP error codes
+	if (error->domain == JSONRPC_CLIENT_ERROR && (error->code == -32800 || error->code == -32801))
+		return LspStatsServerCancelled;
+
+	return LspStatsError;
+}
+
+
+static void send_failed(LspServer *srv, GError *error);
+
+
+static void callback_data_free(CallbackData *data)
+{
+	g_free(data->method_name);
+	g_free(data->supersede_key);
+	g_free(data);
+}
+
+
 static void call_cb(GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
 	JsonrpcClient *client = (JsonrpcClient *)source_object;
@@ -207,13 +296,43 @@ static void call_cb(GObject *source_object, GAsyncResult *res, gpointer user_dat
 
 	if (srv)
 	{
-		lsp_log(srv->log, LspLogClientMessageReceived, data->method_name,
+		g_hash_table_remove(srv->rpc->in_flight, &data->id);
+		lsp_log(srv->log, LspLogClientMessageReceived, data->method_name, data->id,
 			return_value, error, data->req_time);
-		is_startup_shutdown = srv->startup_shutdown;
+		is_startup_shutdown = srv->state != LspServerStateReady;
+		lsp_health_response_received(srv);
+		send_failed(srv, error);
+
+		// cancelled requests have already been counted in cancel_request()
+		if (!data->cancelled)
+			lsp_stats_request_finished(srv, data->method_name, return_value,
+				get_stats_result(error), g_get_monotonic_time() - data->req_time);
 	}
 
+	if (srv && data->supersede_key &&
+		g_hash_table_lookup(srv->rpc->superseding, data->supersede_key) == data)
+	{
+		g_hash_table_remove(srv->rpc->superseding, data->supersede_key);
+	}
+
+	// the document was closed or edited in the meantime - let the callback
+	// free its user data without processing the result
+	if (data->stale && data->callback)
+	{
+		if (return_value)
+			g_variant_unref(return_value);
+		return_value = NULL;
+		if (!error)
+			error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_CANCELLED, "Response outdated");
+	}
+
+	// callback is NULL for cancelled requests - it has already been called
 	if (data->callback && (!is_startup_shutdown || data->cb_on_startup_shutdown))
+	{
+		stallwatch_enter(g_intern_string(data->method_name));
 		data->callback(return_value, error, data->user_data);
+		stallwatch_leave();
+	}
 
 	if (return_value)
 		g_variant_unref(return_value);
@@ -221,13 +340,273 @@ static void call_cb(GObject *source_object, GAsyncResult *res, gpointer user_dat
 	if (error)
 		g_error_free(error);
 
-	g_date_time_unref(data->req_time);
-	g_free(data->method_name);
-	g_free(data);
+	callback_data_free(data);
 }
 
 
-static void call_full(LspServer *srv, const gchar *method, GVariant *params,
+/* lets the callback of a request which won't be sent free its user data */
+static void callback_data_cancel(CallbackData *data, const gchar *reason)
+{
+	if (data->callback)
+	{
+		GError *error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_CANCELLED, reason);
+
+		data->callback(NULL, error, data->user_data);
+		g_error_free(error);
+	}
+	callback_data_free(data);
+}
+
+
+static void queued_message_free(QueuedMessage *msg)
+{
+	g_free(msg->method);
+	if (msg->params)
+		g_variant_unref(msg->params);
+	g_free(msg->doc_uri);
+	g_free(msg);
+}
+
+
+static gboolean is_background_request(const gchar *method)
+{
+	const gchar *methods[] = {
+		"workspace/symbol",
+		"textDocument/documentSymbol",
+		"textDocument/semanticTokens/full",
+		"textDocument/semanticTokens/full/delta",
+		"textDocument/codeLens"
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(methods); i++)
+	{
+		if (g_strcmp0(method, methods[i]) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static gchar *get_params_doc_uri(GVariant *params)
+{
+	const gchar *uri = NULL;
+
+	if (params)
+	{
+		JSONRPC_MESSAGE_PARSE(params,
+			"textDocument", "{",
+				"uri", JSONRPC_MESSAGE_GET_STRING(&uri),
+			"}");
+	}
+
+	return g_strdup(uri);
+}
+
+
+static void notify_cb(GObject *source_object, GAsyncResult *res, gpointer user_data);
+
+
+static void send_message(LspServer *srv, const gchar *method, GVariant *params,
+	GeanyDocument *text_doc, gboolean is_request, CallbackData *data)
+{
+	gboolean params_added = FALSE;
+
+	srv->rpc->writing = TRUE;
+
+	if (is_request)
+	{
+		GVariant *id = NULL;
+
+		data->req_time = g_get_monotonic_time();
+		lsp_stats_request_sent(srv, method, params);
+		lsp_health_request_sent(srv);
+
+		jsonrpc_client_call_with_id_async(srv->rpc->client, method, params, &id, NULL, call_cb, data);
+
+		if (id)
+		{
+			data->id = g_variant_get_int64(id);
+			g_variant_unref(id);
+			g_hash_table_insert(srv->rpc->in_flight, &data->id, data);
+		}
+
+		lsp_log(srv->log, LspLogClientMessageSent, method, data->id, params, NULL, 0);
+		return;
+	}
+
+	if (text_doc)
+	{
+		LspRpcText text;
+
+		lsp_sync_get_doc_text(text_doc, &text);
+		lsp_log_with_text(srv->log, method, params, text.len + text.tail_len);
+		jsonrpc_client_send_notification_with_text_async(srv->rpc->client, method, params,
+			text.text, text.len, text.tail, text.tail_len, NULL, notify_cb, data);
+		return;
+	}
+
+	lsp_log(srv->log, LspLogClientNotificationSent,
+		method, -1, params, NULL, 0);
+
+	if (!params)
+	{
+		params = JSONRPC_MESSAGE_NEW("gopls_bug_workarond",
+			JSONRPC_MESSAGE_PUT_STRING("https://github.com/golang/go/issues/57459"));
+		params_added = TRUE;
+	}
+
+	jsonrpc_client_send_notification_async(srv->rpc->client, method, params, NULL, notify_cb, data);
+
+	if (params_added)
+		g_variant_unref(params);
+}
+
+
+static void send_queued_message(LspServer *srv, QueuedMessage *msg)
+{
+	GeanyDocument *text_doc = NULL;
+
+	msg->data->queued = NULL;
+
+	if (msg->text_doc_id != 0)
+	{
+		text_doc = document_find_by_id(msg->text_doc_id);
+		// the document was closed without being sent - nothing to send
+		if (!text_doc)
+		{
+			callback_data_cancel(msg->data, "Document closed");
+			queued_message_free(msg);
+			return;
+		}
+	}
+
+	send_message(srv, msg->method, msg->params, text_doc, msg->is_request, msg->data);
+	queued_message_free(msg);
+}
+
+
+/* background messages are passed to the client one by one once everything
+ * written before has been sent so interactive messages don't have to wait
+ * behind them */
+static void send_next_background(LspServer *srv)
+{
+	QueuedMessage *msg;
+
+	srv->rpc->writing = FALSE;
+
+	msg = g_queue_pop_head(srv->rpc->background);
+	if (msg)
+		send_queued_message(srv, msg);
+}
+
+
+static void on_output_drained(JsonrpcClient *client, gpointer user_data)
+{
+	LspServer *srv = g_hash_table_lookup(client_table, client);
+
+	if (srv)
+		send_next_background(srv);
+}
+
+
+/* a message the client refused to send is never written so the output
+ * doesn't get drained - continue with the queue, its messages get the error
+ * too and their callbacks are called */
+static void send_failed(LspServer *srv, GError *error)
+{
+	if (srv && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED))
+		send_next_background(srv);
+}
+
+
+/* sends the queued messages for doc_uri or with the text of the document
+ * text_doc_id in their order */
+static void send_background_for_uri(LspServer *srv, const gchar *doc_uri, guint text_doc_id)
+{
+	GList *link, *next;
+
+	for (link = srv->rpc->background->head; link; link = next)
+	{
+		QueuedMessage *msg = link->data;
+
+		next = link->next;
+		if (g_strcmp0(msg->doc_uri, doc_uri) == 0 ||
+			(text_doc_id != 0 && msg->text_doc_id == text_doc_id))
+		{
+			g_queue_delete_link(srv->rpc->background, link);
+			send_queued_message(srv, msg);
+		}
+	}
+}
+
+
+/* messages for a document have to reach the server in the order they were
+ * made - send queued background messages for the document first */
+static void send_background_for_doc(LspServer *srv, GVariant *params)
+{
+	gchar *doc_uri;
+
+	if (g_queue_is_empty(srv->rpc->background))
+		return;
+
+	doc_uri = get_params_doc_uri(params);
+	if (doc_uri)
+		send_background_for_uri(srv, doc_uri, 0);
+	g_free(doc_uri);
+}
+
+
+/* Queued messages take the text of their document when they are sent so it
+ * isn't copied while they wait - called before doc gets modified so they are
+ * sent with the text they were made for. */
+void lsp_rpc_doc_will_change(LspServer *srv, GeanyDocument *doc)
+{
+	gchar *doc_uri;
+
+	if (!srv->rpc || g_queue_is_empty(srv->rpc->background))
+		return;
+
+	doc_uri = lsp_utils_get_doc_uri(doc);
+	send_background_for_uri(srv, doc_uri, doc->id);
+	g_free(doc_uri);
+}
+
+
+static void queue_message(LspServer *srv, LspRpcPriority priority, const gchar *method,
+	GVariant *params, GeanyDocument *text_doc, gboolean is_request, CallbackData *data)
+{
+	QueuedMessage *msg;
+
+	if (priority != LspRpcPriorityBackground)
+	{
+		send_background_for_doc(srv, params);
+		send_message(srv, method, params, text_doc, is_request, data);
+		return;
+	}
+
+	if (!srv->rpc->writing && g_queue_is_empty(srv->rpc->background))
+	{
+		send_message(srv, method, params, text_doc, is_request, data);
+		return;
+	}
+
+	msg = g_new0(QueuedMessage, 1);
+	msg->method = g_strdup(method);
+	msg->params = params ? g_variant_ref_sink(params) : NULL;
+	// the text is taken from the document when the message is sent, see
+	// lsp_rpc_doc_will_change()
+	msg->text_doc_id = text_doc ? text_doc->id : 0;
+	msg->doc_uri = get_params_doc_uri(params);
+	msg->is_request = is_request;
+	msg->data = data;
+	data->queued = msg;
+
+	g_queue_push_tail(srv->rpc->background, msg);
+}
+
+
+static CallbackData *call_full(LspServer *srv, const gchar *method, GVariant *params,
 	LspRpcCallback callback, gboolean cb_on_startup_shutdown, gpointer user_data)
 {
 	CallbackData *data = g_new0(CallbackData, 1);
@@ -235,12 +614,15 @@ static void call_full(LspServer *srv, const gchar *method, GVariant *params,
 	data->method_name = g_strdup(method);
 	data->user_data = user_data;
 	data->callback = callback;
-	data->req_time = g_date_time_new_now_local();
 	data->cb_on_startup_shutdown = cb_on_startup_shutdown;
 
-	lsp_log(srv->log, LspLogClientMessageSent, method, params, NULL, NULL);
+	// make sure the server sees all edits made so far before it processes the request
+	lsp_sync_flush_changes(srv);
 
-	jsonrpc_client_call_async(srv->rpc->client, method, params, NULL, call_cb, data);
+	queue_message(srv, is_background_request(method) ? LspRpcPriorityBackground : LspRpcPriorityInteractive,
+		method, params, NULL, TRUE, data);
+
+	return data;
 }
 
 
@@ -258,6 +640,156 @@ void lsp_rpc_call_startup_shutdown(LspServer *srv, const gchar *method, GVariant
 }
 
 
+static gchar *get_supersede_key(const gchar *method, GeanyDocument *doc)
+{
+	return g_strdup_printf("%s:%u", method, doc->id);
+}
+
+
+static void cancel_request(LspServer *srv, CallbackData *data)
+{
+	LspRpcCallback callback = data->callback;
+	gpointer user_data = data->user_data;
+
+	data->callback = NULL;
+	data->cancelled = TRUE;
+
+	lsp_stats_request_finished(srv, data->method_name, NULL, LspStatsCancelled, 0);
+
+	if (data->queued)
+	{
+		// not sent yet - just drop it
+		g_queue_remove(srv->rpc->background, data->queued);
+		queued_message_free(data->queued);
+		callback_data_free(data);
+	}
+	else
+	{
+		GVariant *node;
+
+		// the reply arrives later and is only logged
+		node = JSONRPC_MESSAGE_NEW(
+			"id", JSONRPC_MESSAGE_PUT_INT64(data->id)
+		);
+		lsp_rpc_notify(srv, "$/cancelRequest", node, NULL, NULL);
+		g_variant_unref(node);
+	}
+
+	// the callback is called now so it can free its user data
+	if (callback)
+	{
+		GError *error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_CANCELLED,
+			"Request cancelled");
+
+		callback(NULL, error, user_data);
+		g_error_free(error);
+	}
+}
+
+
+void lsp_rpc_cancel_superseding(LspServer *srv, const gchar *method, GeanyDocument *doc)
+{
+	gchar *key = get_supersede_key(method, doc);
+	CallbackData *data = g_hash_table_lookup(srv->rpc->superseding, key);
+
+	if (data)
+	{
+		g_hash_table_remove(srv->rpc->superseding, key);
+		cancel_request(srv, data);
+	}
+
+	g_free(key);
+}
+
+
+/* number of superseding requests in flight */
+guint lsp_rpc_get_superseding_num(LspServer *srv)
+{
+	return g_hash_table_size(srv->rpc->superseding);
+}
+
+
+static void set_doc(CallbackData *data, GeanyDocument *doc, gboolean drop_if_edited)
+{
+	data->doc_id = doc->id;
+	data->doc_version = lsp_sync_get_doc_version(doc);
+	data->drop_if_edited = drop_if_edited;
+}
+
+
+/* like lsp_rpc_call() but the previous unfinished request with the same method
+ * for the document gets cancelled - its callback is called with
+ * G_IO_ERROR_CANCELLED error, as it is when the document gets closed before
+ * the response arrives */
+void lsp_rpc_call_superseding(LspServer *srv, const gchar *method, GVariant *params,
+	GeanyDocument *doc, LspRpcCallback callback, gpointer user_data)
+{
+	CallbackData *data;
+
+	lsp_rpc_cancel_superseding(srv, method, doc);
+
+	data = call_full(srv, method, params, callback, FALSE, user_data);
+	data->supersede_key = get_supersede_key(method, doc);
+	set_doc(data, doc, FALSE);
+	g_hash_table_insert(srv->rpc->superseding, g_strdup(data->supersede_key), data);
+}
+
+
+/* like lsp_rpc_call() but the callback gets G_IO_ERROR_CANCELLED error instead
+ * of the result when doc is closed, or edited if drop_if_edited is set, before
+ * the response arrives - a successful response means doc is still valid */
+void lsp_rpc_call_for_doc(LspServer *srv, const gchar *method, GVariant *params,
+	GeanyDocument *doc, gboolean drop_if_edited, LspRpcCallback callback, gpointer user_data)
+{
+	CallbackData *data = call_full(srv, method, params, callback, FALSE, user_data);
+
+	set_doc(data, doc, drop_if_edited);
+}
+
+
+static void mark_stale(CallbackData *data, GeanyDocument *doc, gboolean closed)
+{
+	if (data && data->doc_id == doc->id &&
+		(closed || (data->drop_if_edited && data->doc_version != lsp_sync_get_doc_version(doc))))
+	{
+		data->stale = TRUE;
+	}
+}
+
+
+static void mark_doc_requests_stale(LspServer *srv, GeanyDocument *doc, gboolean closed)
+{
+	GHashTableIter iter;
+	gpointer val;
+	GList *link;
+
+	if (!srv->rpc)
+		return;
+
+	g_hash_table_iter_init(&iter, srv->rpc->in_flight);
+	while (g_hash_table_iter_next(&iter, NULL, &val))
+		mark_stale(val, doc, closed);
+
+	for (link = srv->rpc->background->head; link; link = link->next)
+		mark_stale(((QueuedMessage *)link->data)->data, doc, closed);
+}
+
+
+/* Called when doc stops being open on the server, responses for it are
+ * dropped from now on. */
+void lsp_rpc_doc_closed(LspServer *srv, GeanyDocument *doc)
+{
+	mark_doc_requests_stale(srv, doc, TRUE);
+}
+
+
+/* Called when a new version of doc was sent to the server. */
+void lsp_rpc_doc_edited(LspServer *srv, GeanyDocument *doc)
+{
+	mark_doc_requests_stale(srv, doc, FALSE);
+}
+
+
 static void notify_cb(GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
 	JsonrpcClient *client = (JsonrpcClient *)source_object;
@@ -266,6 +798,7 @@ static void notify_cb(GObject *source_object, GAsyncResult *res, gpointer user_d
 	GError *error = NULL;
 
 	jsonrpc_client_send_notification_finish(client, res, &error);
+	send_failed(g_hash_table_lookup(client_table, client), error);
 
 	if (data->callback)
 		data->callback(return_value, error, data->user_data);
@@ -276,33 +809,48 @@ static void notify_cb(GObject *source_object, GAsyncResult *res, gpointer user_d
 	if (error)
 		g_error_free(error);
 
-	g_free(data);
+	callback_data_free(data);
 }
 
 
 void lsp_rpc_notify(LspServer *srv, const gchar *method, GVariant *params,
 	LspRpcCallback callback, gpointer user_data)
 {
-	gboolean params_added = FALSE;
 	CallbackData *data = g_new0(CallbackData, 1);
 
 	data->user_data = user_data;
 	data->callback = callback;
 
-	lsp_log(srv->log, LspLogClientNotificationSent,
-		method, params, NULL, NULL);
+	queue_message(srv, LspRpcPrioritySync, method, params, NULL, FALSE, data);
+}
 
-	if (!params)
-	{
-		params = JSONRPC_MESSAGE_NEW("gopls_bug_workarond",
-			JSONRPC_MESSAGE_PUT_STRING("https://github.com/golang/go/issues/57459"));
-		params_added = TRUE;
-	}
 
-	jsonrpc_client_send_notification_async(srv->rpc->client, method, params, NULL, notify_cb, data);
+/* params have to contain JSONRPC_MESSAGE_TEXT_PLACEHOLDER string value which
+ * gets replaced by the contents of doc when the message is sent - it is escaped
+ * directly from Scintilla's buffer into the output buffer without a copy */
+void lsp_rpc_notify_with_text(LspServer *srv, const gchar *method, GVariant *params,
+	GeanyDocument *doc, LspRpcCallback callback, gpointer user_data)
+{
+	LspRpcPriority priority = LspRpcPrioritySync;
+	CallbackData *data = g_new0(CallbackData, 1);
 
-	if (params_added)
-		g_variant_unref(params);
+	data->user_data = user_data;
+	data->callback = callback;
+
+	// session restore opens many documents - open the one the user looks at first
+	if (g_strcmp0(method, "textDocument/didOpen") == 0 && doc != document_get_current())
+		priority = LspRpcPriorityBackground;
+
+	queue_message(srv, priority, method, params, doc, FALSE, data);
+}
+
+
+static void on_failed(JsonrpcClient *client, gpointer user_data)
+{
+	LspServer *srv = g_hash_table_lookup(client_table, client);
+
+	if (srv)
+		lsp_server_connection_lost(srv);
 }
 
 
@@ -314,9 +862,14 @@ LspRpc *lsp_rpc_new(LspServer *srv, GIOStream *stream)
 		client_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
 
 	c->client = jsonrpc_client_new(stream);
+	c->superseding = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	c->in_flight = g_hash_table_new(g_int64_hash, g_int64_equal);
+	c->background = g_queue_new();
 	g_hash_table_insert(client_table, c->client, srv);
 	g_signal_connect(c->client, "handle-call", G_CALLBACK(handle_call), NULL);
 	g_signal_connect(c->client, "notification", G_CALLBACK(handle_notification), NULL);
+	g_signal_connect(c->client, "output-drained", G_CALLBACK(on_output_drained), NULL);
+	g_signal_connect(c->client, "failed", G_CALLBACK(on_failed), NULL);
 	jsonrpc_client_start_listening(c->client);
 
 	return c;
@@ -325,8 +878,21 @@ LspRpc *lsp_rpc_new(LspServer *srv, GIOStream *stream)
 
 void lsp_rpc_destroy(LspRpc *rpc)
 {
+	// the messages which haven't been sent never get a response
+	while (!g_queue_is_empty(rpc->background))
+	{
+		QueuedMessage *msg = g_queue_pop_head(rpc->background);
+
+		msg->data->queued = NULL;
+		callback_data_cancel(msg->data, "Server stopped");
+		queued_message_free(msg);
+	}
+
 	g_hash_table_remove(client_table, rpc->client);
 	jsonrpc_client_close(rpc->client, NULL, NULL);
 	g_object_unref(rpc->client);
+	g_hash_table_destroy(rpc->superseding);
+	g_hash_table_destroy(rpc->in_flight);
+	g_queue_free(rpc->background);
 	g_free(rpc);
 }
@@ -36,11 +36,39 @@ void lsp_rpc_destroy(LspRpc *rpc);
 void lsp_rpc_call(LspServer *srv, const gchar *method, GVariant *params,
 	LspRpcCallback callback, gpointer user_data);
 
+void lsp_rpc_call_superseding(LspServer *srv, const gchar *method, GVariant *params,
+	GeanyDocument *doc, LspRpcCallback callback, gpointer user_data);
+
+void lsp_rpc_call_for_doc(LspServer *srv, const gchar *method, GVariant *params,
+	GeanyDocument *doc, gboolean drop_if_edited, LspRpcCallback callback, gpointer user_data);
+
+void lsp_rpc_doc_closed(LspServer *srv, GeanyDocument *doc);
+void lsp_rpc_doc_edited(LspServer *srv, GeanyDocument *doc);
+void lsp_rpc_doc_will_change(LspServer *srv, GeanyDocument *doc);
+
+void lsp_rpc_cancel_superseding(LspServer *srv, const gchar *method, GeanyDocument *doc);
+guint lsp_rpc_get_superseding_num(LspServer *srv);
+
 void lsp_rpc_call_startup_shutdown(LspServer *srv, const gchar *method, GVariant *params,
 	LspRpcCallback callback, gpointer user_data);
 
 void lsp_rpc_notify(LspServer *srv, const gchar *method, GVariant *params,
 	LspRpcCallback callback, gpointer user_data);
 
+/* text which may be split in two parts, such as the two sides of the gap
+ * of Scintilla's buffer - none of them has to be NUL-terminated */
+typedef struct LspRpcText
+{
+	const gchar *text;
+	gsize len;
+	const gchar *tail;  // may be NULL
+	gsize tail_len;
+} LspRpcText;
+
+void lsp_rpc_notify_with_text(LspServer *srv, const gchar *method, GVariant *params,
+	GeanyDocument *doc, LspRpcCallback callback, gpointer user_data);
+
+void lsp_rpc_process_notification(LspServer *srv, const gchar *method, GVariant *params);
+
 
 #endif  /* LSP_RPC_H */
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-scheduler.h"
+#include "lsp/lsp-rpc.h"
+
+
+// delay before checking again whether the number of requests in flight dropped
+#define IN_FLIGHT_RETRY_DELAY 20
+
+
+extern GeanyPlugin *geany_plugin;
+
+
+typedef struct
+{
+	LspServer *srv;
+	LspSchedFeature feature;
+	LspSchedCallback callback;
+	guint doc_id;
+	gint pos;
+	guint source_id;
+} ScheduledRequest;
+
+
+struct LspScheduler
+{
+	ScheduledRequest requests[LSP_SCHED_NUM];
+};
+
+
+static gint get_delay(LspServer *srv, LspSchedFeature feature)
+{
+	switch (feature)
+	{
+		case LspSchedHighlight:
+			return srv->config.highlighting_request_delay;
+		case LspSchedHover:
+			return srv->config.hover_request_delay;
+		case LspSchedSignature:
+			return srv->config.signature_request_delay;
+		case LspSchedCodeLens:
+			return srv->config.code_lens_request_delay;
+		case LspSchedDiagnostics:
+			return srv->config.diagnostics_request_delay;
+		case LspSchedCodeActions:
+			return srv->config.code_action_request_delay;
+		default:
+			return 0;
+	}
+}
+
+
+static gboolean can_send(LspServer *srv)
+{
+	gint max = srv->config.requests_max_in_flight;
+
+	return max <= 0 || lsp_rpc_get_superseding_num(srv) < (guint)max;
+}
+
+
+static gboolean send_cb(gpointer user_data);
+
+
+static void send_or_retry(ScheduledRequest *req)
+{
+	GeanyDocument *doc = document_find_by_id(req->doc_id);
+
+	// document closed or its server changed in the meantime
+	if (!doc || lsp_server_get_if_running(doc) != req->srv)
+		return;
+
+	if (can_send(req->srv))
+		req->callback(req->srv, doc, req->pos);
+	else
+		req->source_id = plugin_timeout_add(geany_plugin, IN_FLIGHT_RETRY_DELAY, send_cb, req);
+}
+
+
+static gboolean send_cb(gpointer user_data)
+{
+	ScheduledRequest *req = user_data;
+
+	req->source_id = 0;
+	send_or_retry(req);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+/* Replaces the previously scheduled request of the same feature. The request
+ * is sent after the feature's delay passes without another schedule call and
+ * when there are less than requests_max_in_flight requests in flight. */
+void lsp_scheduler_schedule(LspServer *srv, LspSchedFeature feature, GeanyDocument *doc,
+	gint pos, LspSchedCallback callback)
+{
+	ScheduledRequest *req;
+	gint delay;
+
+	if (!srv->scheduler)
+		srv->scheduler = g_new0(LspScheduler, 1);
+
+	lsp_scheduler_cancel(srv, feature);
+
+	req = &srv->scheduler->requests[feature];
+	req->srv = srv;
+	req->feature = feature;
+	req->callback = callback;
+	req->doc_id = doc->id;
+	req->pos = pos;
+
+	delay = get_delay(srv, feature);
+	if (delay > 0)
+		req->source_id = plugin_timeout_add(geany_plugin, delay, send_cb, req);
+	else
+		send_or_retry(req);
+}
+
+
+void lsp_scheduler_cancel(LspServer *srv, LspSchedFeature feature)
+{
+	ScheduledRequest *req;
+
+	if (!srv->scheduler)
+		return;
+
+	req = &srv->scheduler->requests[feature];
+	if (req->source_id)
+		g_source_remove(req->source_id);
+	req->source_id = 0;
+}
+
+
+void lsp_scheduler_free(LspServer *srv)
+{
+	gint i;
+
+	if (!srv->scheduler)
+		return;
+
+	for (i = 0; i < LSP_SCHED_NUM; i++)
+		lsp_scheduler_cancel(srv, i);
+
+	g_free(srv->scheduler);
+	srv->scheduler = NULL;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef LSP_SCHEDULER_H
+#define LSP_SCHEDULER_H 1
+
+#include "lsp/lsp-server.h"
+
+#include <glib.h>
+
+
+typedef enum
+{
+	LspSchedHighlight,
+	LspSchedHover,
+	LspSchedSignature,
+	LspSchedCodeLens,
+	LspSchedDiagnostics,
+	LspSchedCodeActions,
+	LSP_SCHED_NUM
+} LspSchedFeature;
+
+
+typedef void (*LspSchedCallback) (LspServer *srv, GeanyDocument *doc, gint pos);
+
+
+void lsp_scheduler_schedule(LspServer *srv, LspSchedFeature feature, GeanyDocument *doc,
+	gint pos, LspSchedCallback callback);
+void lsp_scheduler_cancel(LspServer *srv, LspSchedFeature feature);
+
+void lsp_scheduler_free(LspServer *srv);
+
+#endif  /* LSP_SCHEDULER_H */
@@ -24,14 +24,20 @@
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
 #include "lsp/lsp-sync.h"
+#include "lsp/lsp-warm-cache.h"
 
 #include <jsonrpc-glib.h>
+#include <SciLexer.h>
+
+#include <string.h>
 
 
 typedef struct {
 	GeanyDocument *doc;
 	LspSymbolRequestCallback callback;
 	gboolean delta;
+	guint version;
+	guint text_stamp;  // get_text_stamp() when the request was sent
 	gpointer user_data;
 } LspSemtokensUserData;
 
@@ -43,15 +49,39 @@ typedef struct {
 } SemanticTokensEdit;
 
 
-extern GeanyPlugin *geany_plugin;
-
 extern GeanyData *geany_data;
 
+// key of the id of the CachedData whose tokens are highlighted in the ScintillaObject
+#define APPLIED_DATA_KEY "lsp_semtokens_applied"
+// key of the text stamp the highlighted tokens belong to, 0 if they don't match the text
+#define APPLIED_STAMP_KEY "lsp_semtokens_applied_stamp"
+// key of the number of edits of the text, see get_text_stamp()
+#define EDIT_COUNT_KEY "lsp_semtokens_edit_count"
+// used when semantic_tokens_type_style isn't configured
+#define DEFAULT_INDICATOR 18
+// kind of the warm cache files - the token mask and the array of SemanticToken
+#define WARM_CACHE_KIND "tokens"
+#define WARM_CACHE_TYPE "(ta(uuqq))"
+
+/* Tokens are packed into 12 bytes because big files have lots of them. The
+ * modifiers aren't stored - we don't request any and don't use them. Lengths
+ * and types are clamped to 16 bits: a longer token is only highlighted for its
+ * first 65535 characters, and types beyond 64 are never highlighted anyway
+ * (see is_highlighted()). */
 typedef struct {
+	guint32 line;
+	guint32 character;
+	guint16 length;
+	guint16 type;
+} SemanticToken;
+
+
+typedef struct {
+	guint id;  // unlike the pointer, never reused
 	gint ft_id;
-	GArray *tokens;
-	gchar *tokens_str;
+	GArray *tokens;  // SemanticToken with absolute positions
 	gchar *result_id;
+	guint version;  // document version of complete tokens, 0 if partial or unknown
 } CachedData;
 
 
@@ -61,11 +91,24 @@ static gint style_index;
 static GHashTable *cached_tokens;
 
 
+static CachedData *cached_data_new(void)
+{
+	static guint last_id = 0;
+	CachedData *data = g_new0(CachedData, 1);
+
+	data->id = ++last_id;
+
+	data->tokens = g_array_sized_new(FALSE, FALSE, sizeof(SemanticToken), 200);
+
+	return data;
+}
+
+
 static void cached_data_free(CachedData *data)
 {
 	g_array_free(data->tokens, TRUE);
-	g_free(data->tokens_str);
 	g_free(data->result_id);
+	g_free(data);
 }
 
 
@@ -86,6 +129,23 @@ void lsp_semtokens_init(gint ft_id)
 }
 
 
+/* The lexer style of the type keywords Geany highlights without LSP, see
+ * get_type_keyword_idx() in Geany's document.c, or -1 if there aren't any. */
+static gint get_type_style(ScintillaObject *sci)
+{
+	switch (sci_get_lexer(sci))
+	{
+		case SCLEX_CPP:
+			return SCE_C_GLOBALCLASS;
+		case SCLEX_D:
+			return SCE_D_TYPEDEF;
+		case SCLEX_RUST:
+			return SCE_RUST_WORD4;
+	}
+	return -1;
+}
+
+
 void lsp_semtokens_style_init(GeanyDocument *doc)
 {
 	LspServerConfig *cfg = lsp_server_get_config(doc);
@@ -99,6 +159,13 @@ void lsp_semtokens_style_init(GeanyDocument *doc)
 	style_index = 0;
 	if (cfg->semantic_tokens_type_style)
 		style_index = lsp_utils_set_indicator_style(sci, cfg->semantic_tokens_type_style);
+	else if (get_type_style(sci) >= 0)
+	{
+		// colour the tokens like the type keywords
+		style_index = DEFAULT_INDICATOR;
+		SSM(sci, SCI_INDICSETSTYLE, style_index, INDIC_TEXTFORE);
+		SSM(sci, SCI_INDICSETFORE, style_index, SSM(sci, SCI_STYLEGETFORE, get_type_style(sci), 0));
+	}
 }
 
 
@@ -110,6 +177,42 @@ void lsp_semtokens_destroy(void)
 }
 
 
+static gsize get_cached_data_size(CachedData *data)
+{
+	gsize size = sizeof(CachedData);
+
+	size += data->tokens->len * sizeof(SemanticToken);
+	if (data->result_id)
+		size += strlen(data->result_id) + 1;
+
+	return size;
+}
+
+
+// returns the size of the cached tokens of doc, or of all documents if doc is NULL
+gsize lsp_semtokens_get_memory_size(GeanyDocument *doc)
+{
+	GHashTableIter iter;
+	gpointer data;
+	gsize size = 0;
+
+	if (!cached_tokens)
+		return 0;
+
+	if (doc)
+	{
+		data = doc->real_path ? g_hash_table_lookup(cached_tokens, doc->real_path) : NULL;
+		return data ? get_cached_data_size(data) : 0;
+	}
+
+	g_hash_table_iter_init(&iter, cached_tokens);
+	while (g_hash_table_iter_next(&iter, NULL, &data))
+		size += get_cached_data_size(data);
+
+	return size;
+}
+
+
 static SemanticTokensEdit *sem_tokens_edit_new(void)
 {
 	SemanticTokensEdit *edit = g_new0(SemanticTokensEdit, 1);
@@ -124,111 +227,240 @@ static void sem_tokens_edit_free(SemanticTokensEdit *edit)
 }
 
 
-static void sem_tokens_edit_apply(CachedData *data, SemanticTokensEdit *edit)
+static void sem_tokens_edit_apply(GArray *vals, SemanticTokensEdit *edit)
 {
-	g_return_if_fail(edit->start + edit->delete_count <= data->tokens->len);
+	g_return_if_fail(edit->start + edit->delete_count <= vals->len);
 
-	g_array_remove_range(data->tokens, edit->start, edit->delete_count);
-	g_array_insert_vals(data->tokens, edit->start, edit->data->data, edit->data->len);
+	g_array_remove_range(vals, edit->start, edit->delete_count);
+	g_array_insert_vals(vals, edit->start, edit->data->data, edit->data->len);
 }
 
 
-const gchar *lsp_semtokens_get_cached(GeanyDocument *doc)
+static GArray *read_token_values(GVariantIter *iter)
 {
-	CachedData *data;
+	GArray *vals = g_array_sized_new(FALSE, FALSE, sizeof(guint), g_variant_iter_n_children(iter));
+	GVariant *val = NULL;
 
-	if (!cached_tokens || style_index > 0)
-		return "";
+	while (g_variant_iter_next(iter, "v", &val))
+	{
+		guint v = g_variant_get_int64(val);
+		g_array_append_val(vals, v);
+		g_variant_unref(val);
+	}
 
-	data = g_hash_table_lookup(cached_tokens, doc->real_path);
-	if (!data || !data->tokens_str)
-		return "";
+	return vals;
+}
+
+
+/* Converts the relative LSP encoding (5 integers per token) into the stored
+ * absolute positions. */
+static void decode_tokens(CachedData *data, GArray *vals)
+{
+	guint32 line = 0;
+	guint32 character = 0;
+	guint i;
+
+	g_array_set_size(data->tokens, vals->len / 5);
+
+	for (i = 0; i < data->tokens->len; i++)
+	{
+		guint *v = &g_array_index(vals, guint, i * 5);
+		SemanticToken *token = &g_array_index(data->tokens, SemanticToken, i);
 
-	return data->tokens_str;
+		line += v[0];
+		if (v[0] == 0)
+			character += v[1];
+		else
+			character = v[1];
+
+		token->line = line;
+		token->character = character;
+		token->length = MIN(v[2], G_MAXUINT16);
+		token->type = MIN(v[3], G_MAXUINT16);
+	}
 }
 
 
-static gchar *process_tokens(GArray *tokens, GeanyDocument *doc, guint64 token_mask)
+/* Inverse of decode_tokens() - needed for applying delta edits. Modifiers
+ * aren't stored so they are encoded as 0 and clamped lengths and types as
+ * they were stored. This differs from the server's data only in these values
+ * which decode_tokens() drops or clamps again, and edits replace whole values,
+ * so applying edits to it gives the same tokens as applying them to the
+ * server's data. */
+static GArray *encode_tokens(CachedData *data)
 {
-	GHashTable *type_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-	ScintillaObject *sci = doc->editor->sci;
-	guint delta_line = 0;
-	guint delta_char = 0;
-	guint len = 0;
-	guint token_type = 0;
-	LspPosition last_pos = {0, 0};
-	gboolean first = TRUE;
-	GList *keys, *item;
-	GString *type_str;
-	gint i;
-
-	for (i = 0; i < tokens->len; i++)
+	GArray *vals = g_array_sized_new(FALSE, FALSE, sizeof(guint), data->tokens->len * 5);
+	guint32 line = 0;
+	guint32 character = 0;
+	guint i;
+
+	for (i = 0; i < data->tokens->len; i++)
+	{
+		SemanticToken *token = &g_array_index(data->tokens, SemanticToken, i);
+		guint v[5];
+
+		v[0] = token->line - line;
+		v[1] = v[0] == 0 ? token->character - character : token->character;
+		v[2] = token->length;
+		v[3] = token->type;
+		v[4] = 0;
+		g_array_append_vals(vals, v, 5);
+
+		line = token->line;
+		character = token->character;
+	}
+
+	return vals;
+}
+
+
+static gboolean is_highlighted(const SemanticToken *token, guint64 token_mask)
+{
+	return token->type < 64 && (token_mask & (G_GUINT64_CONSTANT(1) << token->type));
+}
+
+
+static gint compare_tokens(const SemanticToken *a, const SemanticToken *b)
+{
+	if (a->line != b->line)
+		return a->line < b->line ? -1 : 1;
+	if (a->character != b->character)
+		return a->character < b->character ? -1 : 1;
+	return (gint) a->length - (gint) b->length;
+}
+
+
+static void add_range(ScintillaObject *sci, const SemanticToken *token, GArray *positions,
+	GArray *lengths)
+{
+	LspPosition start_pos = {token->line, token->character};
+	LspPosition end_pos = {token->line, token->character + token->length};
+	gint start = lsp_utils_lsp_pos_to_scintilla(sci, start_pos);
+	gint len = lsp_utils_lsp_pos_to_scintilla(sci, end_pos) - start;
+
+	if (len > 0)
 	{
-		guint v = g_array_index(tokens, guint, i);
+		g_array_append_val(positions, start);
+		g_array_append_val(lengths, len);
+	}
+}
 
-		switch (i % 5)
-		{
-			case 0:
-				delta_line = v;
-				break;
-			case 1:
-				delta_char = v;
-				break;
-			case 2:
-				len = v;
-				break;
-			case 3:
-				token_type = 1 << v;
-				break;
-		}
 
-		if (i % 5 == 4)
-		{
-			last_pos.line += delta_line;
-			if (delta_line == 0)
-				last_pos.character += delta_char;
-			else
-				last_pos.character = delta_char;
+/* Identifies the text of sci - changes with every edit and is never 0. */
+static guint get_text_stamp(ScintillaObject *sci)
+{
+	return GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(sci), EDIT_COUNT_KEY)) + 1;
+}
 
-			if (token_type & token_mask)
-			{
-				LspPosition end_pos = last_pos;
-				gint sci_pos_start, sci_pos_end;
-				gchar *str;
 
-				end_pos.character += len;
-				sci_pos_start = lsp_utils_lsp_pos_to_scintilla(sci, last_pos);
-				sci_pos_end = lsp_utils_lsp_pos_to_scintilla(sci, end_pos);
+void lsp_semtokens_text_modified(GeanyDocument *doc, SCNotification *nt)
+{
+	ScintillaObject *sci = doc->editor->sci;
 
-				if (style_index > 0)
-					editor_indicator_set_on_range(doc->editor, style_index, sci_pos_start, sci_pos_end);
+	if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+		g_object_set_data(G_OBJECT(sci), EDIT_COUNT_KEY, GUINT_TO_POINTER(get_text_stamp(sci)));
+}
 
-				str = sci_get_contents_range(sci, sci_pos_start, sci_pos_end);
-				if (str)
-					g_hash_table_add(type_table, str);
-			}
-		}
+
+/* Highlights the tokens of data by their positions, replacing old_tokens which
+ * were highlighted before. Both are sorted, so the tokens which didn't change
+ * are found by merging them and only the changed ranges are updated - which,
+ * unlike keywords, doesn't need restyling the document.
+ *
+ * The positions of old_tokens are only valid for the text they were computed
+ * for, Scintilla moves the indicators with edits. So they are only merged when
+ * they belonged to the text and it wasn't edited since; otherwise all
+ * indicators are replaced. text_stamp is get_text_stamp() of the text the
+ * tokens of data belong to, 0 if unknown. */
+static void apply_tokens(CachedData *data, GeanyDocument *doc, GArray *old_tokens,
+	guint64 token_mask, guint text_stamp)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	GArray *set_positions, *set_lengths, *clear_positions, *clear_lengths;
+	guint current_stamp = get_text_stamp(sci);
+	guint old_len, i = 0, j = 0;
+
+	if (style_index <= 0)
+		return;
+
+	// the indicators are lost when the document is reopened or reloaded
+	if (GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(sci), APPLIED_DATA_KEY)) != data->id ||
+		GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(sci), APPLIED_STAMP_KEY)) != current_stamp)
+	{
+		editor_indicator_clear(doc->editor, style_index);
+		g_object_set_data(G_OBJECT(sci), APPLIED_DATA_KEY, GUINT_TO_POINTER(data->id));
+		old_tokens = NULL;
 	}
+	g_object_set_data(G_OBJECT(sci), APPLIED_STAMP_KEY,
+		GUINT_TO_POINTER(text_stamp == current_stamp ? current_stamp : 0));
+	old_len = old_tokens ? old_tokens->len : 0;
 
-	keys = g_hash_table_get_keys(type_table);
-	type_str = g_string_new("");
+	set_positions = g_array_new(FALSE, FALSE, sizeof(gint));
+	set_lengths = g_array_new(FALSE, FALSE, sizeof(gint));
+	clear_positions = g_array_new(FALSE, FALSE, sizeof(gint));
+	clear_lengths = g_array_new(FALSE, FALSE, sizeof(gint));
 
-	foreach_list(item, keys)
+	while (i < old_len || j < data->tokens->len)
 	{
-		if (!first)
-			g_string_append_c(type_str, ' ');
-		g_string_append(type_str, item->data);
-		first = FALSE;
+		SemanticToken *old = i < old_len ? &g_array_index(old_tokens, SemanticToken, i) : NULL;
+		SemanticToken *new = j < data->tokens->len ?
+			&g_array_index(data->tokens, SemanticToken, j) : NULL;
+		gint cmp = !old ? 1 : !new ? -1 : compare_tokens(old, new);
+		gboolean old_highlighted = cmp <= 0 && is_highlighted(old, token_mask);
+		gboolean new_highlighted = cmp >= 0 && is_highlighted(new, token_mask);
+
+		if (old_highlighted && !new_highlighted)
+			add_range(sci, old, clear_positions, clear_lengths);
+		else if (new_highlighted && !old_highlighted)
+			add_range(sci, new, set_positions, set_lengths);
+
+		if (cmp <= 0)
+			i++;
+		if (cmp >= 0)
+			j++;
 	}
 
-	g_list_free(keys);
-	g_hash_table_destroy(type_table);
+	if (clear_positions->len > 0)
+	{
+		sci_indicator_set(sci, style_index);
+		for (i = 0; i < clear_positions->len; i++)
+			sci_indicator_clear(sci, g_array_index(clear_positions, gint, i),
+				g_array_index(clear_lengths, gint, i));
+	}
+	// set all indicators at once so the view is only updated once
+	editor_indicator_set_ranges(doc->editor, style_index, (gint *) set_positions->data,
+		(gint *) set_lengths->data, set_positions->len);
+
+	g_array_free(set_positions, TRUE);
+	g_array_free(set_lengths, TRUE);
+	g_array_free(clear_positions, TRUE);
+	g_array_free(clear_lengths, TRUE);
+}
+
 
-	return g_string_free(type_str, FALSE);
+void lsp_semtokens_doc_reloaded(GeanyDocument *doc)
+{
+	g_object_set_data(G_OBJECT(doc->editor->sci), APPLIED_DATA_KEY, NULL);
 }
 
 
-static void process_full_result(GeanyDocument *doc, GVariant *result, guint64 token_mask)
+static void set_tokens(CachedData *data, GeanyDocument *doc, GVariantIter *iter, guint64 token_mask,
+	guint text_stamp)
+{
+	GArray *vals = read_token_values(iter);
+	GArray *old_tokens = data->tokens;
+
+	data->tokens = g_array_sized_new(FALSE, FALSE, sizeof(SemanticToken), vals->len / 5);
+	decode_tokens(data, vals);
+	apply_tokens(data, doc, old_tokens, token_mask, text_stamp);
+
+	g_array_free(old_tokens, TRUE);
+	g_array_free(vals, TRUE);
+}
+
+
+static void process_full_result(GeanyDocument *doc, GVariant *result, guint64 token_mask,
+	guint text_stamp)
 {
 	GVariantIter *iter = NULL;
 	const gchar *result_id = NULL;
@@ -240,32 +472,23 @@ static void process_full_result(GeanyDocument *doc, GVariant *result, guint64 to
 
 	if (iter && result_id)
 	{
-		GVariant *val = NULL;
 		CachedData *data = g_hash_table_lookup(cached_tokens, doc->real_path);
 
 		if (data == NULL)
 		{
-			data = g_new0(CachedData, 1);
-			data->tokens = g_array_sized_new(FALSE, FALSE, sizeof(guint), 1000);
+			data = cached_data_new();
 			g_hash_table_insert(cached_tokens, g_strdup(doc->real_path), data);
 		}
 
 		data->ft_id = doc->file_type->id;
 		g_free(data->result_id);
 		data->result_id = g_strdup(result_id);
-		data->tokens->len = 0;
 
-		while (g_variant_iter_loop(iter, "v", &val))
-		{
-			guint v = g_variant_get_int64(val);
-			g_array_append_val(data->tokens, v);
-		}
-
-		g_free(data->tokens_str);
-		data->tokens_str = process_tokens(data->tokens, doc, token_mask);
+		set_tokens(data, doc, iter, token_mask, text_stamp);
+	}
 
+	if (iter)
 		g_variant_iter_free(iter);
-	}
 }
 
 
@@ -278,7 +501,8 @@ static gint sort_edits(gconstpointer a, gconstpointer b)
 }
 
 
-static void process_delta_result(GeanyDocument *doc, GVariant *result, guint64 token_mask)
+static void process_delta_result(GeanyDocument *doc, GVariant *result, guint64 token_mask,
+	guint text_stamp)
 {
 	GVariantIter *iter = NULL;
 	const gchar *result_id = NULL;
@@ -295,10 +519,12 @@ static void process_delta_result(GeanyDocument *doc, GVariant *result, guint64 t
 	if (data && iter && result_id)
 	{
 		GPtrArray *edits = g_ptr_array_new_full(4, (GDestroyNotify)sem_tokens_edit_free);
+		GArray *vals = encode_tokens(data);
+		GArray *old_tokens = data->tokens;
 		SemanticTokensEdit *edit;
 		GVariant *val = NULL;
 		guint i;
- 
+
 		g_free(data->result_id);
 		data->result_id = g_strdup(result_id);
 
@@ -334,14 +560,49 @@ static void process_delta_result(GeanyDocument *doc, GVariant *result, guint64 t
 		g_ptr_array_sort(edits, sort_edits);
 
 		foreach_ptr_array(edit, i, edits)
-			sem_tokens_edit_apply(data, edit);
+			sem_tokens_edit_apply(vals, edit);
 
-		g_free(data->tokens_str);
-		data->tokens_str = process_tokens(data->tokens, doc, token_mask);
+		// the unchanged tokens are found again by comparing the old and new ones
+		data->tokens = g_array_sized_new(FALSE, FALSE, sizeof(SemanticToken), vals->len / 5);
+		decode_tokens(data, vals);
+		apply_tokens(data, doc, old_tokens, token_mask, text_stamp);
 
+		g_array_free(old_tokens, TRUE);
+		g_array_free(vals, TRUE);
 		g_ptr_array_free(edits, TRUE);
+	}
+
+	if (iter)
 		g_variant_iter_free(iter);
+}
+
+
+static void process_range_result(GeanyDocument *doc, GVariant *result, guint64 token_mask,
+	guint text_stamp)
+{
+	GVariantIter *iter = NULL;
+
+	if (!cached_tokens)
+		return;
+
+	JSONRPC_MESSAGE_PARSE(result,
+		"data", JSONRPC_MESSAGE_GET_ITER(&iter)
+	);
+
+	// full result might have arrived in the meantime - don't replace it
+	if (iter && !g_hash_table_lookup(cached_tokens, doc->real_path))
+	{
+		CachedData *data = cached_data_new();
+
+		// without result_id, the next request is a full one
+		data->ft_id = doc->file_type->id;
+		g_hash_table_insert(cached_tokens, g_strdup(doc->real_path), data);
+
+		set_tokens(data, doc, iter, token_mask, text_stamp);
 	}
+
+	if (iter)
+		g_variant_iter_free(iter);
 }
 
 
@@ -352,29 +613,23 @@ static void semtokens_cb(GVariant *return_value, GError *error, gpointer user_da
 	if (!error)
 	{
 		GeanyDocument *doc = data->doc;
-		gboolean doc_exists = FALSE;
-		LspServer *srv;
-		gint i;
+		// a response for a closed document is cancelled
+		LspServer *srv = lsp_server_get(doc);
 
-		foreach_document(i)
+		if (srv)
 		{
-			if (doc == documents[i])
-			{
-				doc_exists = TRUE;
-				break;
-			}
-		}
+			CachedData *cached_data;
 
-		srv = doc_exists ? lsp_server_get(doc) : NULL;
-
-		if (doc_exists && srv)
-		{
 			//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
 
 			if (data->delta)
-				process_delta_result(doc, return_value, srv->semantic_token_mask);
+				process_delta_result(doc, return_value, srv->semantic_token_mask, data->text_stamp);
 			else
-				process_full_result(doc, return_value, srv->semantic_token_mask);
+				process_full_result(doc, return_value, srv->semantic_token_mask, data->text_stamp);
+
+			cached_data = g_hash_table_lookup(cached_tokens, doc->real_path);
+			if (cached_data)
+				cached_data->version = data->version;
 		}
 	}
 
@@ -384,30 +639,175 @@ static void semtokens_cb(GVariant *return_value, GError *error, gpointer user_da
 }
 
 
-static gboolean retry_cb(gpointer user_data)
+static void send_full_request(LspServer *server, GeanyDocument *doc, const gchar *doc_uri,
+	LspSemtokensUserData *data)
+{
+	GVariant *node;
+
+	node = JSONRPC_MESSAGE_NEW(
+		"textDocument", "{",
+			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+		"}"
+	);
+	lsp_rpc_call_for_doc(server, "textDocument/semanticTokens/full", node, doc, FALSE,
+		semtokens_cb, data);
+	g_variant_unref(node);
+}
+
+
+/* Applies a full or delta result to doc as if it was the response to our request.
+ * Which text it belongs to is unknown, so all indicators are replaced. */
+void lsp_semtokens_process_result(LspServer *srv, GeanyDocument *doc, GVariant *result,
+	gboolean delta)
+{
+	if (!cached_tokens || !doc->real_path)
+		return;
+
+	if (delta)
+		process_delta_result(doc, result, srv->semantic_token_mask, 0);
+	else
+		process_full_result(doc, result, srv->semantic_token_mask, 0);
+}
+
+
+static void full_after_range_cb(gpointer user_data)
+{
+	GeanyDocument *doc = document_find_by_id(GPOINTER_TO_UINT(user_data));
+
+	if (doc)
+		lsp_symbol_highlight_update(doc);
+}
+
+
+static void semtokens_range_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
 	LspSemtokensUserData *data = user_data;
+	GeanyDocument *doc = data->doc;
+	// cancelled when the document was closed before the response arrived
+	gboolean outdated = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	LspServer *srv = !outdated ? lsp_server_get(doc) : NULL;
+
+	if (!error && srv)
+		process_range_result(doc, return_value, srv->semantic_token_mask, data->text_stamp);
 
-	//printf("retrying sem tokens\n");
-	if (data->doc == document_get_current())
+	// colours for the visible part are available now
+	data->callback(data->user_data);
+
+	if (srv)
 	{
-		LspServer *srv = lsp_server_get_if_running(data->doc);
-		if (!lsp_server_is_usable(data->doc))
-			;  // server died or misconfigured
-		else if (!srv)
-			return TRUE;  // retry
-		else
-		{
-			// should be successful now
-			lsp_semtokens_send_request(data->doc, data->callback, data->user_data);
-			g_free(data);
-			return FALSE;
-		}
+		// and fill-in the rest in the background
+		gchar *doc_uri = lsp_utils_get_doc_uri(doc);
+
+		data->callback = full_after_range_cb;
+		data->user_data = GUINT_TO_POINTER(doc->id);
+		data->delta = FALSE;
+		data->version = lsp_sync_get_doc_version(doc);
+		data->text_stamp = get_text_stamp(doc->editor->sci);
+		send_full_request(srv, doc, doc_uri, data);
+		g_free(doc_uri);
 	}
+	else
+		g_free(data);
+}
 
-	// server shut down or document not current any more
-	g_free(data);
-	return FALSE;
+
+static void send_range_request(LspServer *server, GeanyDocument *doc, const gchar *doc_uri,
+	LspSemtokensUserData *data)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint first_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0), 0);
+	gint lines_on_screen = SSM(sci, SCI_LINESONSCREEN, 0, 0);
+	// one screen above and below as margin to make scrolling smooth
+	gint start_line = MAX(0, first_line - lines_on_screen);
+	gint end_line = MIN(sci_get_line_count(sci), first_line + 2 * lines_on_screen);
+	GVariant *node;
+
+	node = JSONRPC_MESSAGE_NEW(
+		"textDocument", "{",
+			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+		"}",
+		"range", "{",
+			"start", "{",
+				"line", JSONRPC_MESSAGE_PUT_INT32(start_line),
+				"character", JSONRPC_MESSAGE_PUT_INT32(0),
+			"}",
+			"end", "{",
+				"line", JSONRPC_MESSAGE_PUT_INT32(end_line),
+				"character", JSONRPC_MESSAGE_PUT_INT32(0),
+			"}",
+		"}"
+	);
+	lsp_rpc_call_for_doc(server, "textDocument/semanticTokens/range", node, doc, FALSE,
+		semtokens_range_cb, data);
+	g_variant_unref(node);
+}
+
+
+static void server_ready_cb(GeanyDocument *doc, gpointer user_data)
+{
+	LspSemtokensUserData *data = user_data;
+
+	// document may not be current any more
+	if (doc == document_get_current())
+		lsp_semtokens_send_request(doc, data->callback, data->user_data);
+}
+
+
+/* Shows the tokens of the previous session when doc wasn't modified since,
+ * until the server sends the current ones. */
+static void load_warm_tokens(GeanyDocument *doc)
+{
+	GVariant *tokens_variant, *array;
+	const SemanticToken *tokens;
+	CachedData *data;
+	guint64 token_mask;
+	gsize n;
+
+	if (!doc->real_path || (cached_tokens && g_hash_table_lookup(cached_tokens, doc->real_path)))
+		return;
+
+	tokens_variant = lsp_warm_cache_load(doc, WARM_CACHE_KIND, G_VARIANT_TYPE(WARM_CACHE_TYPE));
+	if (!tokens_variant)
+		return;
+
+	g_variant_get(tokens_variant, "(t@a(uuqq))", &token_mask, &array);
+	tokens = g_variant_get_fixed_array(array, &n, sizeof(SemanticToken));
+
+	if (!cached_tokens)
+		lsp_semtokens_init(doc->file_type->id);
+
+	// without result_id, the next request is a full one
+	data = cached_data_new();
+	data->ft_id = doc->file_type->id;
+	g_array_append_vals(data->tokens, tokens, n);
+	g_hash_table_insert(cached_tokens, g_strdup(doc->real_path), data);
+
+	// the file wasn't modified, so the tokens belong to its text
+	apply_tokens(data, doc, NULL, token_mask, get_text_stamp(doc->editor->sci));
+
+	g_variant_unref(array);
+	g_variant_unref(tokens_variant);
+}
+
+
+/* Stores the tokens of doc for the next session if they are up to date. */
+void lsp_semtokens_store_warm_cache(GeanyDocument *doc)
+{
+	LspServer *srv = lsp_server_get_if_running(doc);
+	CachedData *data;
+	GVariant *array;
+
+	if (!srv || !cached_tokens || !doc->real_path || doc->changed)
+		return;
+
+	data = g_hash_table_lookup(cached_tokens, doc->real_path);
+	if (!data || data->version == 0 || data->version != lsp_sync_get_doc_version(doc))
+		return;
+
+	array = g_variant_new_fixed_array(G_VARIANT_TYPE("(uuqq)"), data->tokens->data,
+		data->tokens->len, sizeof(SemanticToken));
+	lsp_warm_cache_store(doc, WARM_CACHE_KIND,
+		g_variant_new("(t@a(uuqq))", srv->semantic_token_mask, array));
 }
 
 
@@ -424,10 +824,12 @@ void lsp_semtokens_send_request(GeanyDocument *doc, LspSymbolRequestCallback cal
 	data->doc = doc;
 	data->callback = callback;
 
+	load_warm_tokens(doc);
+
 	if (!server)
 	{
-		// happens when Geany and LSP server started - we cannot send the request yet
-		plugin_timeout_add(geany_plugin, 300, retry_cb, data);
+		// happens when Geany and LSP server started - send the request once the server is ready
+		lsp_server_when_ready(doc, server_ready_cb, data, g_free);
 		return;
 	}
 
@@ -437,35 +839,35 @@ void lsp_semtokens_send_request(GeanyDocument *doc, LspSymbolRequestCallback cal
 	 * need to request document opening here */
 	if (!lsp_sync_is_document_open(doc))
 		lsp_sync_text_document_did_open(server, doc);
+	data->version = lsp_sync_get_doc_version(doc);
+	data->text_stamp = get_text_stamp(doc->editor->sci);
 
 	if (!cached_tokens)
 		lsp_semtokens_init(doc->file_type->id);
 
 	cached_data = g_hash_table_lookup(cached_tokens, doc->real_path);
-	data->delta = cached_data != NULL;
+	// cached data from a range request don't have result_id
+	data->delta = cached_data && cached_data->result_id;
 
-	if (data->delta)
+	if (!cached_data && server->supports_semantic_tokens_range &&
+		server->config.semantic_tokens_range_first)
 	{
-		node = JSONRPC_MESSAGE_NEW(
-			"previousResultId", JSONRPC_MESSAGE_PUT_STRING(cached_data->result_id),
-			"textDocument", "{",
-				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
-			"}"
-		);
-		lsp_rpc_call(server, "textDocument/semanticTokens/full/delta", node,
-			semtokens_cb, data);
+		send_range_request(server, doc, doc_uri, data);
 	}
-	else
+	else if (data->delta)
 	{
 		node = JSONRPC_MESSAGE_NEW(
+			"previousResultId", JSONRPC_MESSAGE_PUT_STRING(cached_data->result_id),
 			"textDocument", "{",
 				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
 			"}"
 		);
-		lsp_rpc_call(server, "textDocument/semanticTokens/full", node,
+		lsp_rpc_call_for_doc(server, "textDocument/semanticTokens/full/delta", node, doc, FALSE,
 			semtokens_cb, data);
+		g_variant_unref(node);
 	}
+	else
+		send_full_request(server, doc, doc_uri, data);
 
 	g_free(doc_uri);
-	g_variant_unref(node);
 }
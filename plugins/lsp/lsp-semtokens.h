@@ -26,9 +26,15 @@
 void lsp_semtokens_send_request(GeanyDocument *doc, LspSymbolRequestCallback callback,
 	gpointer user_data);
 
-const gchar *lsp_semtokens_get_cached(GeanyDocument *doc);
+gsize lsp_semtokens_get_memory_size(GeanyDocument *doc);
+
+void lsp_semtokens_process_result(LspServer *srv, GeanyDocument *doc, GVariant *result,
+	gboolean delta);
 
 void lsp_semtokens_style_init(GeanyDocument *doc);
+void lsp_semtokens_doc_reloaded(GeanyDocument *doc);
+void lsp_semtokens_text_modified(GeanyDocument *doc, SCNotification *nt);
+void lsp_semtokens_store_warm_cache(GeanyDocument *doc);
 
 void lsp_semtokens_init(gint ft_id);
 void lsp_semtokens_destroy(void);
@@ -25,29 +25,121 @@
 #include "lsp/lsp-rpc.h"
 #include "lsp/lsp-sync.h"
 #include "lsp/lsp-diagnostics.h"
+#include "lsp/lsp-scheduler.h"
+#include "lsp/lsp-stats.h"
+#include "lsp/lsp-health.h"
 #include "lsp/lsp-log.h"
 #include "lsp/lsp-semtokens.h"
 #include "lsp/lsp-progress.h"
+#include "lsp/lsp-file-watch.h"
 #include "lsp/lsp-symbols.h"
 #include "lsp/lsp-symbol-kinds.h"
 #include "lsp/lsp-highlight.h"
+#include "lsp/lsp-code-lens.h"
 
 #include <jsonrpc-glib.h>
 
 
 static void start_lsp_server(LspServer *server);
 static LspServer *lsp_server_init(gint ft);
+static LspServer *server_get_configured_for_ft(gint ft_id);
 
 
+extern GeanyPlugin *geany_plugin;
 extern GeanyData *geany_data;
 extern LspProjectConfigurationType project_configuration_type;
 
 static GPtrArray *lsp_servers = NULL;
 static GPtrArray *servers_in_shutdown = NULL;
 
+// doc id -> DocValidity, so the document's path isn't checked on every event
+static GHashTable *doc_validity = NULL;
+// incremented whenever a server (and its config) gets replaced
+static guint config_generation = 0;
+/* locale file name -> CachedFile - the configuration and initialization options
+ * files parsed once and shared by all servers until they change */
+static GHashTable *cached_files = NULL;
+
+
+typedef struct
+{
+	gpointer data;  // GKeyFile or GVariant, not modified by users
+	GDestroyNotify free_func;
+	GFileMonitor *monitor;
+} CachedFile;
+
+
+typedef struct
+{
+	LspServerConfig *cfg;
+	gchar *real_path;
+	guint generation;
+	gboolean valid;
+} DocValidity;
+
+
+typedef struct
+{
+	LspServerReadyCallback callback;
+	gpointer user_data;
+	GDestroyNotify free_func;
+	guint doc_id;
+} PendingRequest;
+
+
+static void pending_request_free(PendingRequest *req)
+{
+	if (req->free_func)
+		req->free_func(req->user_data);
+	g_free(req);
+}
+
+
+static void drop_pending_requests(LspServer *s)
+{
+	if (s->pending_requests)
+		g_queue_free_full(s->pending_requests, (GDestroyNotify)pending_request_free);
+	s->pending_requests = NULL;
+}
+
+
+static void flush_pending_requests(LspServer *s)
+{
+	GQueue *pending = s->pending_requests;
+	PendingRequest *req;
+
+	if (!pending)
+		return;
+
+	// callbacks may queue new requests
+	s->pending_requests = NULL;
+
+	while ((req = g_queue_pop_head(pending)))
+	{
+		GeanyDocument *doc = document_find_by_id(req->doc_id);
+
+		if (doc && s->state == LspServerStateReady)
+			req->callback(doc, req->user_data);
+		pending_request_free(req);
+	}
+
+	g_queue_free(pending);
+}
+
+
+static void transfer_pending_requests(LspServer *from, LspServer *to)
+{
+	to->pending_requests = from->pending_requests;
+	from->pending_requests = NULL;
+}
+
 
 static void force_terminate(LspServer *info)
 {
+	// servers we only connected to keep running for their other clients
+	if (!info->process)
+		return;
+
 	g_subprocess_send_signal(info->process, SIGTERM);
 	//TODO: check if sleep can be added here and if g_subprocess_send_signal() is executed immediately
 	g_subprocess_force_exit(info->process);
@@ -83,9 +175,26 @@ static void shutdown_cb(GVariant *return_value, GError *error, gpointer user_dat
 }
 
 
+/* Removes the code lenses of the documents served by s which is replaced by
+ * a new server, the new one sends its own. */
+static void clear_code_lenses(LspServer *s)
+{
+	guint i;
+
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+
+		if (doc->file_type && server_get_configured_for_ft(doc->file_type->id) == s)
+			lsp_code_lens_clear(doc);
+	}
+}
+
+
 static void stop_process(LspServer *s)
 {
-	s->startup_shutdown = TRUE;
+	s->state = LspServerStateShutdown;
+	drop_pending_requests(s);
 	g_ptr_array_add(servers_in_shutdown, s);
 
 	msgwin_status_add("Sending shutdown request to LSP server %s", s->config.cmd);
@@ -97,6 +206,7 @@ static void stop_process(LspServer *s)
 static void free_config(LspServerConfig *cfg)
 {
 	g_free(cfg->cmd);
+	g_free(cfg->connect);
 	g_strfreev(cfg->env);
 	g_free(cfg->ref_lang);
 	g_strfreev(cfg->autocomplete_trigger_sequences);
@@ -112,9 +222,17 @@ static void free_config(LspServerConfig *cfg)
 
 static void free_server(LspServer *s)
 {
-	if (s->process)
+	if (s->connect_cancellable)
+	{
+		// connected_cb() doesn't touch the server after cancellation
+		g_cancellable_cancel(s->connect_cancellable);
+		g_object_unref(s->connect_cancellable);
+	}
+
+	if (s->rpc)
 	{
-		g_object_unref(s->process);
+		if (s->process)
+			g_object_unref(s->process);
 		lsp_rpc_destroy(s->rpc);
 		//TODO: check if stream should be closed
 		g_object_unref(s->stream);
@@ -125,6 +243,11 @@ static void free_server(LspServer *s)
 	g_free(s->signature_trigger_chars);
 	g_free(s->initialize_response);
 	lsp_progress_free_all(s);
+	lsp_file_watch_free_all(s);
+	lsp_scheduler_free(s);
+	lsp_stats_free(s);
+	lsp_health_free(s);
+	drop_pending_requests(s);
 
 	free_config(&s->config);
 
@@ -134,7 +257,7 @@ static void free_server(LspServer *s)
 
 static void stop_and_free_server(LspServer *s)
 {
-	if (s->process)
+	if (s->rpc)
 		stop_process(s);
 	else
 		free_server(s);
@@ -165,6 +288,94 @@ static gchar *get_autocomplete_trigger_chars(GVariant *node)
 }
 
 
+static gboolean supports_completion_resolve(GVariant *node)
+{
+	gboolean val = FALSE;
+
+	JSONRPC_MESSAGE_PARSE(node,
+		"capabilities", "{",
+			"completionProvider", "{",
+				"resolveProvider", JSONRPC_MESSAGE_GET_BOOLEAN(&val),
+			"}",
+		"}");
+
+	return val;
+}
+
+
+static gboolean supports_code_lens_resolve(GVariant *node)
+{
+	gboolean val = FALSE;
+
+	JSONRPC_MESSAGE_PARSE(node,
+		"capabilities", "{",
+			"codeLensProvider", "{",
+				"resolveProvider", JSONRPC_MESSAGE_GET_BOOLEAN(&val),
+			"}",
+		"}");
+
+	return val;
+}
+
+
+static gboolean supports_code_lens(GVariant *node)
+{
+	GVariant *val = NULL;
+
+	JSONRPC_MESSAGE_PARSE(node,
+		"capabilities", "{",
+			"codeLensProvider", JSONRPC_MESSAGE_GET_VARIANT(&val),
+		"}");
+
+	if (val)
+		g_variant_unref(val);
+
+	return val != NULL;
+}
+
+
+static gboolean supports_pull_diagnostics(GVariant *node, gboolean *inter_file)
+{
+	GVariant *val = NULL;
+
+	*inter_file = FALSE;
+
+	JSONRPC_MESSAGE_PARSE(node,
+		"capabilities", "{",
+			"diagnosticProvider", JSONRPC_MESSAGE_GET_VARIANT(&val),
+		"}");
+
+	if (!val)
+		return FALSE;
+
+	JSONRPC_MESSAGE_PARSE(val, "interFileDependencies", JSONRPC_MESSAGE_GET_BOOLEAN(inter_file));
+	g_variant_unref(val);
+
+	return TRUE;
+}
+
+
+static gboolean supports_range_formatting(GVariant *node)
+{
+	GVariant *val = NULL;
+	gboolean ret = FALSE;
+
+	JSONRPC_MESSAGE_PARSE(node,
+		"capabilities", "{",
+			"documentRangeFormattingProvider", JSONRPC_MESSAGE_GET_VARIANT(&val),
+		"}");
+
+	if (val)
+	{
+		// either boolean or DocumentRangeFormattingOptions
+		ret = !g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN) || g_variant_get_boolean(val);
+		g_variant_unref(val);
+	}
+
+	return ret;
+}
+
+
 static gboolean supports_semantic_tokens(GVariant *node)
 {
 	gboolean val = FALSE;
@@ -182,6 +393,29 @@ static gboolean supports_semantic_tokens(GVariant *node)
 }
 
 
+static gboolean supports_semantic_tokens_range(GVariant *node)
+{
+	GVariant *val = NULL;
+	gboolean ret = FALSE;
+
+	JSONRPC_MESSAGE_PARSE(node,
+		"capabilities", "{",
+			"semanticTokensProvider", "{",
+				"range", JSONRPC_MESSAGE_GET_VARIANT(&val),
+			"}",
+		"}");
+
+	if (val)
+	{
+		// either boolean or an empty object
+		ret = !g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN) || g_variant_get_boolean(val);
+		g_variant_unref(val);
+	}
+
+	return ret;
+}
+
+
 static guint64 get_semantic_token_mask(GVariant *node)
 {
 	guint64 mask = 0;
@@ -297,6 +531,7 @@ static void initialize_cb(GVariant *return_value, GError *error, gpointer user_d
 		s->autocomplete_trigger_chars = get_autocomplete_trigger_chars(return_value);
 		if (!*s->autocomplete_trigger_chars)
 			s->config.autocomplete_enable = FALSE;
+		s->supports_completion_resolve = supports_completion_resolve(return_value);
 
 		g_free(s->signature_trigger_chars);
 		s->signature_trigger_chars = get_signature_trigger_chars(return_value);
@@ -312,20 +547,32 @@ static void initialize_cb(GVariant *return_value, GError *error, gpointer user_d
 		update_config(return_value, &s->supports_workspace_symbols, "workspaceSymbolProvider");
 
 		s->use_incremental_sync = use_incremental_sync(return_value);
+		s->supports_range_formatting = supports_range_formatting(return_value);
+
+		if (!supports_code_lens(return_value))
+			s->config.code_lens_enable = FALSE;
+		s->supports_code_lens_resolve = supports_code_lens_resolve(return_value);
+
+		s->supports_pull_diagnostics = supports_pull_diagnostics(return_value,
+			&s->diagnostics_inter_file);
 
 		s->initialize_response = lsp_utils_json_pretty_print(return_value);
 
 		if (!supports_semantic_tokens(return_value))
 			s->config.semantic_tokens_enable = FALSE;
 		s->semantic_token_mask = get_semantic_token_mask(return_value);
+		s->supports_semantic_tokens_range = supports_semantic_tokens_range(return_value);
 
 		msgwin_status_add("LSP server %s initialized", s->config.cmd);
 
 		lsp_rpc_notify(s, "initialized", NULL, NULL, NULL);
-		s->startup_shutdown = FALSE;
+		s->state = LspServerStateReady;
 
 		lsp_semtokens_init(s->filetype);
 
+		// after a restart, the documents open on the previous server
+		lsp_sync_reopen_documents(s);
+
 		foreach_document(i)
 		{
 			GeanyDocument *doc = documents[i];
@@ -340,25 +587,160 @@ static void initialize_cb(GVariant *return_value, GError *error, gpointer user_d
 					lsp_sync_text_document_did_open(s, doc);
 			}
 		}
+
+		flush_pending_requests(s);
+
+		lsp_health_start(s);
 	}
 	else
 	{
+		LspServer *old = s;
 		gint restarts = s->restarts;
 		gint ft = s->filetype;
 
 		msgwin_status_add("LSP initialize request failed for LSP server %s", s->config.cmd);
 
-		stop_process(s);
 		s = lsp_server_init(ft);
 		s->restarts = restarts;
+		transfer_pending_requests(old, s);
+		stop_process(old);
 		lsp_servers->pdata[ft] = s;
 		start_lsp_server(s);
 	}
 }
 
 
+static GKeyFile *read_keyfile(const gchar *config_file)
+{
+	GError *error = NULL;
+	GKeyFile *kf = g_key_file_new();
+
+	if (!g_key_file_load_from_file(kf, config_file, G_KEY_FILE_NONE, &error))
+	{
+		msgwin_status_add("Failed to load LSP configuration file with message %s", error->message);
+		g_error_free(error);
+	}
+
+	return kf;
+}
+
+
+static void cached_file_free(CachedFile *cached)
+{
+	if (cached->monitor)
+	{
+		g_signal_handlers_disconnect_by_data(cached->monitor, cached);
+		g_file_monitor_cancel(cached->monitor);
+		g_object_unref(cached->monitor);
+	}
+	cached->free_func(cached->data);
+	g_free(cached);
+}
+
+
+static void on_cached_file_changed(GFileMonitor *monitor, G_GNUC_UNUSED GFile *file,
+	G_GNUC_UNUSED GFile *other_file, GFileMonitorEvent event, gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer cached;
+
+	if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+		return;
+
+	// parsed again when a server is created next time
+	g_hash_table_iter_init(&iter, cached_files);
+	while (g_hash_table_iter_next(&iter, NULL, &cached))
+	{
+		if (cached == user_data)
+		{
+			g_hash_table_iter_remove(&iter);
+			break;
+		}
+	}
+}
+
+
+static gpointer get_cached_file(const gchar *locale_fname, gpointer (*parse)(const gchar *fname),
+	GDestroyNotify free_func)
+{
+	CachedFile *cached;
+	GFile *file;
+
+	if (!cached_files)
+		cached_files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)cached_file_free);
+
+	cached = g_hash_table_lookup(cached_files, locale_fname);
+	if (cached)
+		return cached->data;
+
+	cached = g_new0(CachedFile, 1);
+	cached->data = parse(locale_fname);
+	cached->free_func = free_func;
+
+	file = g_file_new_for_path(locale_fname);
+	cached->monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	if (cached->monitor)
+		g_signal_connect(cached->monitor, "changed", G_CALLBACK(on_cached_file_changed), cached);
+	g_object_unref(file);
+
+	g_hash_table_insert(cached_files, g_strdup(locale_fname), cached);
+	return cached->data;
+}
+
+
+static gpointer parse_keyfile(const gchar *fname)
+{
+	return read_keyfile(fname);
+}
+
+
+static gpointer parse_init_options(const gchar *fname)
+{
+	gchar *utf8_fname = utils_get_utf8_from_locale(fname);
+	GVariant *variant = g_variant_take_ref(lsp_utils_parse_json_file(utf8_fname));
+
+	g_free(utf8_fname);
+	return variant;
+}
+
+
+/* The key files are shared by all servers and must not be modified. */
+static GKeyFile *get_keyfile(const gchar *config_file)
+{
+	return get_cached_file(config_file, parse_keyfile, (GDestroyNotify)g_key_file_free);
+}
+
+
+/* Returns the parsed initialization options of utf8_fname, or an empty
+ * dictionary when not set. */
+static GVariant *get_init_options(const gchar *utf8_fname)
+{
+	gchar *fname = utf8_fname ? utils_get_locale_from_utf8(utf8_fname) : NULL;
+	GVariant *variant;
+
+	if (!fname)
+		return g_variant_take_ref(lsp_utils_parse_json_file(NULL));
+
+	variant = get_cached_file(fname, parse_init_options, (GDestroyNotify)g_variant_unref);
+	g_free(fname);
+
+	return g_variant_ref(variant);
+}
+
+
+/* Drops the parsed configuration files so they are read again, e.g. when they
+ * were saved from Geany and the file monitors didn't notice yet. */
+void lsp_server_clear_config_cache(void)
+{
+	if (cached_files)
+		g_hash_table_destroy(cached_files);
+	cached_files = NULL;
+}
+
+
 static void perform_initialize(LspServer *server)
 {
+	GVariant *init_options = get_init_options(server->config.initialization_options_file);
 	GVariant *node;
 
 	gchar *locale = lsp_utils_get_locale();
@@ -397,6 +779,13 @@ static void perform_initialize(LspServer *server)
 						"documentationFormat", "[",
 							"plaintext",
 						"]",
+						"resolveSupport", "{",
+							"properties", "[",
+								"detail",
+								"documentation",
+								"additionalTextEdits",
+							"]",
+						"}",
 					"}",
 					"completionItemKind", "{",
 						"valueSet", "[",
@@ -418,9 +807,12 @@ static void perform_initialize(LspServer *server)
 					"}",
 					"hierarchicalDocumentSymbolSupport", JSONRPC_MESSAGE_PUT_BOOLEAN(TRUE),
 				"}",
+				"diagnostic", "{",
+					"relatedDocumentSupport", JSONRPC_MESSAGE_PUT_BOOLEAN(FALSE),
+				"}",
 				"semanticTokens", "{",
 					"requests", "{",
-						"range", JSONRPC_MESSAGE_PUT_BOOLEAN(FALSE),
+						"range", JSONRPC_MESSAGE_PUT_BOOLEAN(TRUE),
 						"full", "{",
 							"delta", JSONRPC_MESSAGE_PUT_BOOLEAN(TRUE),
 						"}",
@@ -447,6 +839,9 @@ static void perform_initialize(LspServer *server)
 			"}",
 			"workspace", "{",
 				"applyEdit", JSONRPC_MESSAGE_PUT_BOOLEAN(TRUE),
+				"didChangeWatchedFiles", "{",
+					"dynamicRegistration", JSONRPC_MESSAGE_PUT_BOOLEAN(TRUE),
+				"}",
 				"symbol", "{",
 					"symbolKind", "{",
 						"valueSet", "[",
@@ -458,8 +853,7 @@ static void perform_initialize(LspServer *server)
 		"}",
 		"trace", JSONRPC_MESSAGE_PUT_STRING("off"),
 		"initializationOptions", "{",
-			JSONRPC_MESSAGE_PUT_VARIANT(
-				lsp_utils_parse_json_file(server->config.initialization_options_file)),
+			JSONRPC_MESSAGE_PUT_VARIANT(init_options),
 		"}"
 	);
 
@@ -467,57 +861,169 @@ static void perform_initialize(LspServer *server)
 
 	msgwin_status_add("Sending initialize request to LSP server %s", server->config.cmd);
 
-	server->startup_shutdown = TRUE;
 	lsp_rpc_call_startup_shutdown(server, "initialize", node, initialize_cb, server);
 
 	g_free(locale);
 	g_free(project_base);
 	g_free(project_base_uri);
+	g_variant_unref(init_options);
 	g_variant_unref(node);
 }
 
 
-static GKeyFile *read_keyfile(const gchar *config_file)
-{
-	GError *error = NULL;
-	GKeyFile *kf = g_key_file_new();
-
-	if (!g_key_file_load_from_file(kf, config_file, G_KEY_FILE_NONE, &error))
-	{
-		msgwin_status_add("Failed to load LSP configuration file with message %s", error->message);
-		g_error_free(error);
-	}
-
-	return kf;
-}
-
-
 static void process_stopped(GObject *source_object, GAsyncResult *res, gpointer data)
 {
 	LspServer *s = data;
 
-	if (s  && !s->startup_shutdown)
+	if (s  && s->state == LspServerStateReady)
 	{
+		LspServer *old = s;
 		gint restarts = s->restarts;
 		gint ft = s->filetype;
 
 		msgwin_status_add("LSP server %s stopped, restarting", s->config.cmd);
 
-		free_server(s);
+		clear_code_lenses(old);
 		s = lsp_server_init(ft);
 		s->restarts = restarts;
+		transfer_pending_requests(old, s);
+		free_server(old);
 		lsp_servers->pdata[ft] = s;
 		start_lsp_server(s);
 	}
 }
 
 
+static gboolean free_server_idle(gpointer data)
+{
+	free_server(data);
+	return G_SOURCE_REMOVE;
+}
+
+
+void lsp_server_connection_lost(LspServer *srv)
+{
+	gint restarts = srv->restarts;
+	gint ft = srv->filetype;
+	LspServer *s;
+
+	// subprocesses are restarted by process_stopped(), failed initialization
+	// is handled by initialize_cb()
+	if (srv->process || srv->state != LspServerStateReady)
+		return;
+
+	msgwin_status_add("Connection to LSP server %s lost, reconnecting", srv->config.connect);
+
+	clear_code_lenses(srv);
+	s = lsp_server_init(ft);
+	s->restarts = restarts;
+	transfer_pending_requests(srv, s);
+	srv->state = LspServerStateShutdown;
+	// called from a signal handler of the server's RPC client - free it later
+	plugin_idle_add(geany_plugin, free_server_idle, srv);
+	lsp_servers->pdata[ft] = s;
+	start_lsp_server(s);
+}
+
+
+/* Restarts srv whose process still runs but misbehaves, e.g. uses too much
+ * memory or doesn't respond anymore. When force is set, the process is killed
+ * instead of waiting for the shutdown request to be answered. Returns whether
+ * srv was restarted, it is not when it isn't the running server anymore. */
+gboolean lsp_server_restart_unhealthy(LspServer *srv, const gchar *reason, gboolean force)
+{
+	gint ft = srv->filetype;
+	LspServer *s;
+
+	if (srv->state != LspServerStateReady || !lsp_servers || lsp_servers->pdata[ft] != srv)
+		return FALSE;
+
+	msgwin_status_add("LSP server %s %s, restarting", srv->config.cmd, reason);
+
+	clear_code_lenses(srv);
+	s = lsp_server_init(ft);
+	s->restarts = srv->restarts;
+	transfer_pending_requests(srv, s);
+	stop_process(srv);
+	if (force)
+		force_terminate(srv);
+	lsp_servers->pdata[ft] = s;
+	start_lsp_server(s);
+
+	return TRUE;
+}
+
+
 static gboolean is_dead(LspServer *server)
 {
 	return server->restarts > 5;
 }
 
 
+static void connected_cb(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	GSocketConnection *connection;
+	GError *error = NULL;
+	LspServer *server;
+
+	connection = g_socket_client_connect_finish(G_SOCKET_CLIENT(source_object), res, &error);
+	if (!connection)
+	{
+		// server already freed when cancelled
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			server = user_data;
+			msgwin_status_add("Failed to connect to LSP server %s with error message: %s",
+				server->config.connect, error->message);
+			g_clear_object(&server->connect_cancellable);
+			server->state = LspServerStateStopped;
+			drop_pending_requests(server);
+		}
+		g_error_free(error);
+		return;
+	}
+
+	server = user_data;
+	g_clear_object(&server->connect_cancellable);
+
+	server->stream = G_IO_STREAM(connection);
+	server->log = lsp_log_start(&server->config);
+	server->rpc = lsp_rpc_new(server, server->stream);
+
+	perform_initialize(server);
+}
+
+
+/* Connects to an already running server, possibly shared with other Geany
+ * instances, instead of spawning a new one. */
+static void connect_lsp_server(LspServer *server)
+{
+	GSocketConnectable *address;
+	GSocketClient *client;
+	GError *error = NULL;
+
+	address = g_network_address_parse(server->config.connect, 0, &error);
+	if (!address)
+	{
+		msgwin_status_add("Invalid LSP server address %s: %s", server->config.connect, error->message);
+		g_error_free(error);
+		drop_pending_requests(server);
+		return;
+	}
+
+	msgwin_status_add("Connecting to LSP server %s", server->config.connect);
+
+	client = g_socket_client_new();
+	server->connect_cancellable = g_cancellable_new();
+	server->state = LspServerStateStarting;
+	g_socket_client_connect_async(client, address, server->connect_cancellable,
+		connected_cb, server);
+
+	g_object_unref(client);
+	g_object_unref(address);
+}
+
+
 static void start_lsp_server(LspServer *server)
 {
 	GInputStream *input_stream;
@@ -532,6 +1038,13 @@ static void start_lsp_server(LspServer *server)
 	if (is_dead(server))
 	{
 		dialogs_show_msgbox(GTK_MESSAGE_ERROR, "LSP server %s terminated more than 5 times, giving up", server->config.cmd);
+		drop_pending_requests(server);
+		return;
+	}
+
+	if (server->config.connect)
+	{
+		connect_lsp_server(server);
 		return;
 	}
 
@@ -566,6 +1079,7 @@ static void start_lsp_server(LspServer *server)
 	{
 		msgwin_status_add("LSP server process %s failed to start with error message: %s", server->config.cmd, error->message);
 		g_error_free(error);
+		drop_pending_requests(server);
 		return;
 	}
 
@@ -578,6 +1092,7 @@ static void start_lsp_server(LspServer *server)
 	server->log = lsp_log_start(&server->config);
 	server->rpc = lsp_rpc_new(server, server->stream);
 
+	server->state = LspServerStateStarting;
 	perform_initialize(server);
 }
 
@@ -634,7 +1149,17 @@ static void load_config(GKeyFile *kf, gchar *section, LspServer *s)
 {
 	get_bool(&s->config.use_outside_project_dir, kf, section, "lsp_use_outside_project_dir");
 	get_bool(&s->config.use_without_project, kf, section, "lsp_use_without_project");
+	get_bool(&s->config.start_with_project, kf, section, "lsp_start_with_project");
 	get_bool(&s->config.rpc_log_full, kf, section, "rpc_log_full");
+	get_int(&s->config.rpc_trace_entries, kf, section, "rpc_trace_entries");
+	get_int(&s->config.document_changes_batch_delay, kf, section, "document_changes_batch_delay");
+	get_int(&s->config.document_full_sync_delay, kf, section, "document_full_sync_delay");
+	get_int(&s->config.document_max_open, kf, section, "document_max_open");
+	get_int(&s->config.requests_max_in_flight, kf, section, "requests_max_in_flight");
+	get_int(&s->config.health_check_interval, kf, section, "health_check_interval");
+	get_int(&s->config.health_memory_max, kf, section, "health_memory_max");
+	get_int(&s->config.health_cpu_max, kf, section, "health_cpu_max");
+	get_int(&s->config.health_response_time_max, kf, section, "health_response_time_max");
 
 	get_bool(&s->config.autocomplete_enable, kf, section, "autocomplete_enable");
 
@@ -646,34 +1171,49 @@ static void load_config(GKeyFile *kf, gchar *section, LspServer *s)
 
 	get_bool(&s->config.autocomplete_use_label, kf, section, "autocomplete_use_label");
 	get_bool(&s->config.autocomplete_apply_additional_edits, kf, section, "autocomplete_apply_additional_edits");
+	get_bool(&s->config.autocomplete_rank_by_usage, kf, section, "autocomplete_rank_by_usage");
 	get_bool(&s->config.diagnostics_enable, kf, section, "diagnostics_enable");
 
 	get_str(&s->config.diagnostics_error_style, kf, section, "diagnostics_error_style");
 	get_str(&s->config.diagnostics_warning_style, kf, section, "diagnostics_warning_style");
 	get_str(&s->config.diagnostics_info_style, kf, section, "diagnostics_info_style");
 	get_str(&s->config.diagnostics_hint_style, kf, section, "diagnostics_hint_style");
+	get_int(&s->config.diagnostics_background_files_max, kf, section, "diagnostics_background_files_max");
+	get_int(&s->config.diagnostics_request_delay, kf, section, "diagnostics_request_delay");
 
 	get_bool(&s->config.hover_enable, kf, section, "hover_enable");
 	get_int(&s->config.hover_popup_max_lines, kf, section, "hover_popup_max_lines");
 	get_int(&s->config.hover_popup_max_paragraphs, kf, section, "hover_popup_max_paragraphs");
+	get_int(&s->config.hover_request_delay, kf, section, "hover_request_delay");
 	get_bool(&s->config.signature_enable, kf, section, "signature_enable");
+	get_int(&s->config.signature_request_delay, kf, section, "signature_request_delay");
+	get_bool(&s->config.code_lens_enable, kf, section, "code_lens_enable");
+	get_int(&s->config.code_lens_request_delay, kf, section, "code_lens_request_delay");
+	get_bool(&s->config.code_action_prefetch_enable, kf, section, "code_action_prefetch_enable");
+	get_int(&s->config.code_action_request_delay, kf, section, "code_action_request_delay");
 	get_bool(&s->config.goto_enable, kf, section, "goto_enable");
 	get_bool(&s->config.document_symbols_enable, kf, section, "document_symbols_enable");
 	get_bool(&s->config.show_server_stderr, kf, section, "show_server_stderr");
 
 	get_bool(&s->config.semantic_tokens_enable, kf, section, "semantic_tokens_enable");
+	get_bool(&s->config.semantic_tokens_range_first, kf, section, "semantic_tokens_range_first");
 	get_str(&s->config.semantic_tokens_type_style, kf, section, "semantic_tokens_type_style");
 
+	get_bool(&s->config.warm_cache_enable, kf, section, "warm_cache_enable");
+
 	get_str(&s->config.formatting_options_file, kf, section, "formatting_options_file");
+	get_bool(&s->config.formatting_edited_ranges_only, kf, section, "formatting_edited_ranges_only");
 
 	get_bool(&s->config.highlighting_enable, kf, section, "highlighting_enable");
 	get_str(&s->config.highlighting_style, kf, section, "highlighting_style");
+	get_int(&s->config.highlighting_request_delay, kf, section, "highlighting_request_delay");
 }
 
 
 static void load_filetype_only_config(GKeyFile *kf, gchar *section, LspServer *s)
 {
 	get_str(&s->config.cmd, kf, section, "cmd");
+	get_str(&s->config.connect, kf, section, "connect");
 	get_strv(&s->config.env, kf, section, "env");
 	get_str(&s->config.ref_lang, kf, section, "use");
 	get_str(&s->config.rpc_log, kf, section, "rpc_log");
@@ -692,10 +1232,10 @@ static LspServer *server_get_or_start_for_ft(GeanyFiletype *ft, gboolean launch_
 	if (s->referenced)
 		s = s->referenced;
 
-	if (s->startup_shutdown)
+	if (s->state == LspServerStateStarting || s->state == LspServerStateShutdown)
 		return NULL;
 
-	if (s->process)
+	if (s->state == LspServerStateReady)
 		return s;
 
 	if (s->not_used)
@@ -715,14 +1255,18 @@ static LspServer *server_get_or_start_for_ft(GeanyFiletype *ft, gboolean launch_
 		{
 			s2 = g_ptr_array_index(lsp_servers, ft->id);
 			s->referenced = s2;
-			if (s2->process)
-				return s2;
+			if (s2->state != LspServerStateStopped)
+				return s2->state == LspServerStateReady ? s2 : NULL;
 		}
 	}
 
 	if (s2)
 		s = s2;
 
+	// the address serves as the server's name in messages
+	if (EMPTY(s->config.cmd) && !EMPTY(s->config.connect))
+		SETPTR(s->config.cmd, g_strdup(s->config.connect));
+
 	if (s->config.cmd)
 		g_strstrip(s->config.cmd);
 	if (EMPTY(s->config.cmd))
@@ -748,34 +1292,79 @@ LspServer *lsp_server_get_for_ft(GeanyFiletype *ft)
 }
 
 
-static gboolean is_lsp_valid_for_doc(LspServerConfig *cfg, GeanyDocument *doc)
+static gboolean is_lsp_valid_for_path(LspServerConfig *cfg, const gchar *locale_path)
 {
-	gchar *base_path, *real_path, *rel_path;
+	gchar *base_path, *utf8_path, *rel_path;
 	gboolean inside_project;
 
 	if (!cfg->use_without_project && !geany_data->app->project)
 		return FALSE;
 
-	if (!doc || !doc->real_path)
+	if (!locale_path)
 		return FALSE;
 
 	if (cfg->use_outside_project_dir || !geany_data->app->project)
 		return TRUE;
 
 	base_path = lsp_utils_get_project_base_path();
-	real_path = utils_get_utf8_from_locale(doc->real_path);
-	rel_path = lsp_utils_get_relative_path(base_path, real_path);
+	utf8_path = utils_get_utf8_from_locale(locale_path);
+	rel_path = lsp_utils_get_relative_path(base_path, utf8_path);
 
 	inside_project = rel_path && !g_str_has_prefix(rel_path, "..");
 
 	g_free(rel_path);
-	g_free(real_path);
+	g_free(utf8_path);
 	g_free(base_path);
 
 	return inside_project;
 }
 
 
+static void free_doc_validity(DocValidity *v)
+{
+	g_free(v->real_path);
+	g_free(v);
+}
+
+
+static gboolean is_lsp_valid_for_doc(LspServerConfig *cfg, GeanyDocument *doc)
+{
+	DocValidity *v;
+
+	if (!doc)
+		return FALSE;
+
+	if (!doc_validity)
+		doc_validity = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+			(GDestroyNotify)free_doc_validity);
+
+	v = g_hash_table_lookup(doc_validity, GUINT_TO_POINTER(doc->id));
+	// save as changes real_path, filetype change the config
+	if (v && v->cfg == cfg && v->generation == config_generation &&
+		g_strcmp0(v->real_path, doc->real_path) == 0)
+		return v->valid;
+
+	if (!v)
+	{
+		v = g_new0(DocValidity, 1);
+		g_hash_table_insert(doc_validity, GUINT_TO_POINTER(doc->id), v);
+	}
+	v->cfg = cfg;
+	v->generation = config_generation;
+	SETPTR(v->real_path, g_strdup(doc->real_path));
+	v->valid = is_lsp_valid_for_path(cfg, doc->real_path);
+
+	return v->valid;
+}
+
+
+void lsp_server_doc_closed(GeanyDocument *doc)
+{
+	if (doc_validity)
+		g_hash_table_remove(doc_validity, GUINT_TO_POINTER(doc->id));
+}
+
+
 static LspServer *server_get_for_doc(GeanyDocument *doc, gboolean launch_server)
 {
 	LspServer *srv;
@@ -867,12 +1456,69 @@ gboolean lsp_server_is_usable(GeanyDocument *doc)
 }
 
 
+/* Calls callback once the server for doc finishes initialization. When the
+ * server is already running, callback is called immediately; when it cannot
+ * start, user_data is freed without calling callback. Only the last request
+ * for the given callback and document is kept. */
+void lsp_server_when_ready(GeanyDocument *doc, LspServerReadyCallback callback,
+	gpointer user_data, GDestroyNotify free_func)
+{
+	LspServer *s = server_get_configured_for_doc(doc);
+	PendingRequest *req;
+	GList *node;
+
+	if (s && lsp_server_get(doc))
+	{
+		callback(doc, user_data);
+		if (free_func)
+			free_func(user_data);
+		return;
+	}
+
+	// lsp_server_get() may have just started the server - s->state is up to date
+	if (!s || s->state != LspServerStateStarting)
+	{
+		if (free_func)
+			free_func(user_data);
+		return;
+	}
+
+	if (!s->pending_requests)
+		s->pending_requests = g_queue_new();
+
+	foreach_list(node, s->pending_requests->head)
+	{
+		req = node->data;
+		if (req->callback == callback && req->doc_id == doc->id)
+		{
+			if (req->free_func)
+				req->free_func(req->user_data);
+			req->user_data = user_data;
+			req->free_func = free_func;
+			return;
+		}
+	}
+
+	req = g_new0(PendingRequest, 1);
+	req->callback = callback;
+	req->user_data = user_data;
+	req->free_func = free_func;
+	req->doc_id = doc->id;
+	g_queue_push_tail(s->pending_requests, req);
+}
+
+
 void lsp_server_stop_all(gboolean wait)
 {
 	if (lsp_servers)
 		g_ptr_array_free(lsp_servers, TRUE);
 	lsp_servers = NULL;
 
+	// servers are stopped on project open/close and when the config changes
+	if (doc_validity)
+		g_hash_table_destroy(doc_validity);
+	doc_validity = NULL;
+
 	if (wait)
 	{
 		GMainContext *main_context = g_main_context_ref_thread_default();
@@ -891,6 +1537,7 @@ static LspServer *lsp_server_new(GKeyFile *kf_global, GKeyFile *kf, GeanyFiletyp
 	LspServer *s = g_new0(LspServer, 1);
 
 	s->filetype = ft->id;
+	config_generation++;
 
 	load_config(kf_global, "all", s);
 	load_config(kf_global, ft->name, s);
@@ -906,22 +1553,18 @@ static LspServer *lsp_server_new(GKeyFile *kf_global, GKeyFile *kf, GeanyFiletyp
 
 static LspServer *lsp_server_init(gint ft)
 {
-	GKeyFile *kf_global = read_keyfile(lsp_utils_get_global_config_filename());
-	GKeyFile *kf = read_keyfile(lsp_utils_get_config_filename());
+	GKeyFile *kf_global = get_keyfile(lsp_utils_get_global_config_filename());
+	GKeyFile *kf = get_keyfile(lsp_utils_get_config_filename());
 	GeanyFiletype *filetype = filetypes_index(ft);
-	LspServer *s = lsp_server_new(kf_global, kf, filetype);
-
-	g_key_file_free(kf);
-	g_key_file_free(kf_global);
 
-	return s;
+	return lsp_server_new(kf_global, kf, filetype);
 }
 
 
 void lsp_server_init_all(void)
 {
-	GKeyFile *kf_global = read_keyfile(lsp_utils_get_global_config_filename());
-	GKeyFile *kf = read_keyfile(lsp_utils_get_config_filename());
+	GKeyFile *kf_global = get_keyfile(lsp_utils_get_global_config_filename());
+	GKeyFile *kf = get_keyfile(lsp_utils_get_config_filename());
 	GeanyFiletype *ft;
 	guint i;
 
@@ -938,9 +1581,55 @@ void lsp_server_init_all(void)
 		LspServer *s = lsp_server_new(kf_global, kf, ft);
 		g_ptr_array_add(lsp_servers, s);
 	}
+}
+
+
+/* Starts servers for the filetypes of the files stored in the project's session
+ * so they initialize in parallel before the files get opened and used. */
+void lsp_server_start_for_project(GKeyFile *kf)
+{
+	gboolean *started;
+	gchar **keys, **key;
+
+	if (!lsp_servers || !kf)
+		return;
+
+	keys = g_key_file_get_keys(kf, "files", NULL, NULL);
+	if (!keys)
+		return;
+
+	started = g_new0(gboolean, lsp_servers->len);
+
+	foreach_strv(key, keys)
+	{
+		gchar **vals;
+		GeanyFiletype *ft;
+
+		if (!g_str_has_prefix(*key, "FILE_NAME_"))
+			continue;
+
+		// the same format as in Geany's get_session_file_string()
+		vals = g_key_file_get_string_list(kf, "files", *key, NULL, NULL);
+		if (vals && g_strv_length(vals) >= 8 &&
+			(ft = filetypes_lookup_by_name(vals[1])) && !started[ft->id])
+		{
+			LspServer *s = server_get_configured_for_ft(ft->id);
+			gchar *locale_path = g_uri_unescape_string(vals[7], NULL);
+
+			if (s && s->config.start_with_project &&
+				is_lsp_valid_for_path(&s->config, locale_path))
+			{
+				started[ft->id] = TRUE;
+				server_get_or_start_for_ft(ft, TRUE);
+			}
+
+			g_free(locale_path);
+		}
+		g_strfreev(vals);
+	}
 
-	g_key_file_free(kf);
-	g_key_file_free(kf_global);
+	g_free(started);
+	g_strfreev(keys);
 }
 
 
@@ -1006,3 +1695,60 @@ gchar *lsp_server_get_initialize_responses(void)
 
 	return g_string_free(str, FALSE);
 }
+
+
+gchar *lsp_server_get_rpc_traces(void)
+{
+	GString *str = g_string_new("");
+	guint i;
+
+	if (!lsp_servers)
+		return g_string_free(str, FALSE);
+
+	for (i = 0; i < lsp_servers->len; i++)
+	{
+		LspServer *s = lsp_servers->pdata[i];
+
+		if (s->config.cmd && s->log.trace)
+		{
+			if (str->len > 0)
+				g_string_append_c(str, '\n');
+			g_string_append_printf(str, "##### %s\n", s->config.cmd);
+			lsp_log_append_trace(s->log, str);
+		}
+	}
+
+	if (str->len == 0)
+		g_string_append(str, "No RPC traces recorded - set rpc_trace_entries in the configuration file to enable tracing\n");
+
+	return g_string_free(str, FALSE);
+}
+
+
+gchar *lsp_server_get_statistics(void)
+{
+	GString *str = g_string_new("");
+	guint i;
+
+	if (!lsp_servers)
+		return g_string_free(str, FALSE);
+
+	for (i = 0; i < lsp_servers->len; i++)
+	{
+		LspServer *s = lsp_servers->pdata[i];
+
+		if (s->config.cmd && s->stats)
+		{
+			if (str->len > 0)
+				g_string_append_c(str, '\n');
+			g_string_append_printf(str, "##### %s\n", s->config.cmd);
+			lsp_health_append(s, str);
+			lsp_stats_append(s, str);
+		}
+	}
+
+	if (str->len == 0)
+		g_string_append(str, "No requests sent to running servers yet\n");
+
+	return g_string_free(str, FALSE);
+}
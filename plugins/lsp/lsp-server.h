@@ -27,24 +27,48 @@
 struct LspRpc;
 typedef struct LspRpc LspRpc;
 
+struct LspScheduler;
+typedef struct LspScheduler LspScheduler;
+
+struct LspLogTrace;
+typedef struct LspLogTrace LspLogTrace;
+
+struct LspStats;
+typedef struct LspStats LspStats;
+
+struct LspHealth;
+typedef struct LspHealth LspHealth;
+
 
 typedef struct
 {
 	gchar *cmd;
+	gchar *connect;
 	gchar **env;
 	gchar *ref_lang;
 
 	gboolean show_server_stderr;
 	gchar *rpc_log;
 	gboolean rpc_log_full;
+	gint rpc_trace_entries;
 	gchar *initialization_options_file;
 	gboolean use_outside_project_dir;
 	gboolean use_without_project;
+	gboolean start_with_project;
+	gint document_changes_batch_delay;
+	gint document_full_sync_delay;
+	gint document_max_open;
+	gint requests_max_in_flight;
+	gint health_check_interval;
+	gint health_memory_max;
+	gint health_cpu_max;
+	gint health_response_time_max;
 
 	gboolean autocomplete_enable;
 	gchar **autocomplete_trigger_sequences;
 	gboolean autocomplete_use_label;
 	gboolean autocomplete_apply_additional_edits;
+	gboolean autocomplete_rank_by_usage;
 	gint autocomplete_window_max_entries;
 	gint autocomplete_window_max_displayed;
 	gint autocomplete_window_max_width;
@@ -54,24 +78,39 @@ typedef struct
 	gchar *diagnostics_warning_style;
 	gchar *diagnostics_info_style;
 	gchar *diagnostics_hint_style;
+	gint diagnostics_background_files_max;
+	gint diagnostics_request_delay;
 
 	gchar *formatting_options_file;
+	gboolean formatting_edited_ranges_only;
 
 	gboolean hover_enable;
 	gint hover_popup_max_lines;
 	gint hover_popup_max_paragraphs;
+	gint hover_request_delay;
 
 	gboolean signature_enable;
+	gint signature_request_delay;
+
+	gboolean code_lens_enable;
+	gint code_lens_request_delay;
+
+	gboolean code_action_prefetch_enable;
+	gint code_action_request_delay;
 
 	gboolean goto_enable;
 
 	gboolean document_symbols_enable;
 
 	gboolean semantic_tokens_enable;
+	gboolean semantic_tokens_range_first;
 	gchar *semantic_tokens_type_style;
 
+	gboolean warm_cache_enable;
+
 	gboolean highlighting_enable;
 	gchar *highlighting_style;
+	gint highlighting_request_delay;
 
 } LspServerConfig;
 
@@ -81,19 +120,37 @@ typedef struct
 	gint type;  // 0: use stream, 1: stdout, 2: stderr
 	gboolean full;
 	GFileOutputStream *stream;
+	LspLogTrace *trace;
 } LspLogInfo;
 
 
+typedef enum
+{
+	LspServerStateStopped,  // not started yet or failed to start
+	LspServerStateStarting,  // waiting for the "initialize" response
+	LspServerStateReady,
+	LspServerStateShutdown,
+} LspServerState;
+
+
+typedef void (*LspServerReadyCallback) (GeanyDocument *doc, gpointer user_data);
+
+
 typedef struct LspServer
 {
 	LspRpc *rpc;
+	LspScheduler *scheduler;
+	LspStats *stats;
+	LspHealth *health;
 	GSubprocess *process;
+	GCancellable *connect_cancellable;
 	GIOStream *stream;
 	LspLogInfo log;
 
 	struct LspServer *referenced;
 	gboolean not_used;
-	gboolean startup_shutdown;
+	LspServerState state;
+	GQueue *pending_requests;
 	guint restarts;
 	gint filetype;
 
@@ -106,6 +163,13 @@ typedef struct LspServer
 	gchar *initialize_response;
 	gboolean use_incremental_sync;
 	gboolean supports_workspace_symbols;
+	gboolean supports_semantic_tokens_range;
+	gboolean supports_completion_resolve;
+	gboolean supports_code_lens_resolve;
+	gboolean supports_range_formatting;
+	gboolean supports_pull_diagnostics;
+	// diagnostics of a document may change after edits of other documents
+	gboolean diagnostics_inter_file;
 
 	guint64 semantic_token_mask;
 } LspServer;
@@ -116,12 +180,21 @@ LspServer *lsp_server_get_for_ft(GeanyFiletype *ft);
 LspServer *lsp_server_get_if_running(GeanyDocument *doc);
 LspServerConfig *lsp_server_get_config(GeanyDocument *doc);
 gboolean lsp_server_is_usable(GeanyDocument *doc);
+void lsp_server_when_ready(GeanyDocument *doc, LspServerReadyCallback callback,
+	gpointer user_data, GDestroyNotify free_func);
+void lsp_server_doc_closed(GeanyDocument *doc);
+gboolean lsp_server_restart_unhealthy(LspServer *srv, const gchar *reason, gboolean force);
 
 void lsp_server_stop_all(gboolean wait);
+void lsp_server_clear_config_cache(void);
 void lsp_server_init_all(void);
+void lsp_server_connection_lost(LspServer *srv);
+void lsp_server_start_for_project(GKeyFile *kf);
 
 gboolean lsp_server_uses_init_file(gchar *path);
 
 gchar *lsp_server_get_initialize_responses(void);
+gchar *lsp_server_get_rpc_traces(void);
+gchar *lsp_server_get_statistics(void);
 
 #endif  /* LSP_SERVER_H */
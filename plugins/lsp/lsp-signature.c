@@ -23,19 +23,86 @@
 #include "lsp/lsp-signature.h"
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-rpc.h"
+#include "lsp/lsp-sync.h"
+#include "lsp/lsp-lru.h"
 
 #include <jsonrpc-glib.h>
 
 
+#define SIGNATURE_CACHE_SIZE 8
+
+
 typedef struct {
 	GeanyDocument *doc;
 	gint pos;
+	guint version;  // document version the request was made for
 } LspSignatureData;
 
 
+typedef struct {
+	GPtrArray *signatures;
+	gint active;
+} LspSignatureCacheEntry;
+
+
 static GPtrArray *signatures = NULL;
 static gint displayed_signature = 0;
 static ScintillaObject *calltip_sci;
+// signature help responses at caret positions
+static LspLru *signature_cache = NULL;
+
+
+static void free_cache_entry(LspSignatureCacheEntry *entry)
+{
+	g_ptr_array_free(entry->signatures, TRUE);
+	g_free(entry);
+}
+
+
+void lsp_signature_text_modified(GeanyDocument *doc, gint pos)
+{
+	lsp_lru_text_modified(signature_cache, doc, pos);
+}
+
+
+void lsp_signature_destroy(void)
+{
+	lsp_lru_free(signature_cache);
+	signature_cache = NULL;
+}
+
+
+static GPtrArray *copy_signatures(GPtrArray *arr)
+{
+	GPtrArray *copy = g_ptr_array_new_full(arr->len, g_free);
+	guint i;
+
+	for (i = 0; i < arr->len; i++)
+		g_ptr_array_add(copy, g_strdup(arr->pdata[i]));
+
+	return copy;
+}
+
+
+static void cache_signatures(GeanyDocument *doc, LspSignatureData *data, gint active)
+{
+	LspSignatureCacheEntry *entry;
+
+	// the caret has to be still at the request position with no edits since then
+	if (lsp_sync_get_doc_version(doc) != data->version ||
+		sci_get_current_position(doc->editor->sci) != data->pos)
+	{
+		return;
+	}
+
+	if (!signature_cache)
+		signature_cache = lsp_lru_new(SIGNATURE_CACHE_SIZE, (GDestroyNotify)free_cache_entry);
+
+	entry = g_new0(LspSignatureCacheEntry, 1);
+	entry->signatures = copy_signatures(signatures);
+	entry->active = active;
+	lsp_lru_insert(signature_cache, doc, data->version, data->pos, data->pos, entry);
+}
 
 
 static void show_signature(ScintillaObject *sci)
@@ -103,6 +170,7 @@ static void signature_cb(GVariant *return_value, GError *error, gpointer user_da
 			}
 
 			displayed_signature = CLAMP(active, 0, signatures->len);
+			cache_signatures(current_doc, data, displayed_signature);
 
 			if (signatures->len == 0)
 				SSM(current_doc->editor->sci, SCI_CALLTIPCANCEL, 0, 0);
@@ -166,6 +234,26 @@ void lsp_signature_send_request(LspServer *server, GeanyDocument *doc)
 		return;
 	}
 
+	if (signature_cache)
+	{
+		LspSignatureCacheEntry *entry = lsp_lru_lookup(signature_cache, doc, pos);
+
+		if (entry)
+		{
+			if (signatures)
+				g_ptr_array_free(signatures, TRUE);
+			signatures = copy_signatures(entry->signatures);
+			displayed_signature = entry->active;
+
+			if (signatures->len == 0)
+				SSM(sci, SCI_CALLTIPCANCEL, 0, 0);
+			else
+				show_signature(sci);
+			g_free(doc_uri);
+			return;
+		}
+	}
+
 	node = JSONRPC_MESSAGE_NEW (
 		"textDocument", "{",
 			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
@@ -182,9 +270,12 @@ void lsp_signature_send_request(LspServer *server, GeanyDocument *doc)
 	data->doc = doc;
 	data->pos = pos;
 
-	lsp_rpc_call(server, "textDocument/signatureHelp", node,
+	lsp_rpc_call_superseding(server, "textDocument/signatureHelp", node, doc,
 		signature_cb, data);
 
+	// pending edits are sent before the request so read the version afterwards
+	data->version = lsp_sync_get_doc_version(doc);
+
 	g_free(doc_uri);
 	g_variant_unref(node);
 }
@@ -31,4 +31,7 @@ void lsp_signature_show_next(void);
 void lsp_signature_hide_calltip(GeanyDocument *doc);
 gboolean lsp_signature_showing_calltip(GeanyDocument *doc);
 
+void lsp_signature_text_modified(GeanyDocument *doc, gint pos);
+void lsp_signature_destroy(void);
+
 #endif  /* LSP_SIGNATURE_H */
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// number of most recent latencies per method used for percentiles
+#define LATENCY_SAMPLES 1000
+
+
+typedef struct
+{
+	guint64 sent;
+	guint64 succeeded;
+	guint64 failed;
+	guint64 cancelled;
+	guint64 server_cancelled;
+	guint64 bytes_sent;
+	guint64 bytes_received;
+	gsize max_received;
+	gint64 latency_sum;  // microseconds
+	gint64 latency_max;
+	gint64 latencies[LATENCY_SAMPLES];
+	guint64 latency_num;
+} MethodStats;
+
+
+struct LspStats
+{
+	GHashTable *methods;  // interned method name -> MethodStats
+	gint64 start_time;
+};
+
+
+static MethodStats *get_method_stats(LspServer *srv, const gchar *method)
+{
+	MethodStats *stats;
+
+	if (!srv->stats)
+	{
+		srv->stats = g_new0(LspStats, 1);
+		srv->stats->methods = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+		srv->stats->start_time = g_get_monotonic_time();
+	}
+
+	method = g_intern_string(method ? method : "");
+	stats = g_hash_table_lookup(srv->stats->methods, method);
+	if (!stats)
+	{
+		stats = g_new0(MethodStats, 1);
+		g_hash_table_insert(srv->stats->methods, (gpointer)method, stats);
+	}
+
+	return stats;
+}
+
+
+void lsp_stats_request_sent(LspServer *srv, const gchar *method, GVariant *params)
+{
+	MethodStats *stats = get_method_stats(srv, method);
+
+	stats->sent++;
+	// serialized GVariant size which only approximates the JSON size
+	if (params)
+		stats->bytes_sent += g_variant_get_size(params);
+}
+
+
+void lsp_stats_request_finished(LspServer *srv, const gchar *method, GVariant *result,
+	LspStatsResult res, gint64 latency)
+{
+	MethodStats *stats = get_method_stats(srv, method);
+
+	switch (res)
+	{
+		case LspStatsSuccess:
+			stats->succeeded++;
+			break;
+		case LspStatsError:
+			stats->failed++;
+			break;
+		case LspStatsCancelled:
+			stats->cancelled++;
+			// latency of abandoned requests says nothing about the server
+			return;
+		case LspStatsServerCancelled:
+			stats->server_cancelled++;
+			break;
+	}
+
+	if (result)
+	{
+		gsize size = g_variant_get_size(result);
+
+		stats->bytes_received += size;
+		stats->max_received = MAX(stats->max_received, size);
+	}
+
+	stats->latency_sum += latency;
+	stats->latency_max = MAX(stats->latency_max, latency);
+	stats->latencies[stats->latency_num % LATENCY_SAMPLES] = latency;
+	stats->latency_num++;
+}
+
+
+static gint compare_latencies(gconstpointer a, gconstpointer b)
+{
+	gint64 l1 = *(const gint64 *)a;
+	gint64 l2 = *(const gint64 *)b;
+
+	return l1 < l2 ? -1 : l1 > l2;
+}
+
+
+static gdouble get_percentile(gint64 *sorted, guint num, guint percent)
+{
+	guint index;
+
+	if (num == 0)
+		return 0;
+
+	index = (num * percent + 99) / 100;
+	if (index > 0)
+		index--;
+
+	return sorted[index] / 1000.0;
+}
+
+
+static gint compare_methods(gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0(a, b);
+}
+
+
+void lsp_stats_append(LspServer *srv, GString *str)
+{
+	gint64 sorted[LATENCY_SAMPLES];
+	GList *methods, *node;
+
+	if (!srv->stats)
+		return;
+
+	g_string_append_printf(str, "running for %" G_GINT64_FORMAT " s\n",
+		(g_get_monotonic_time() - srv->stats->start_time) / G_USEC_PER_SEC);
+	g_string_append_printf(str, "%-40s %8s %6s %6s %6s %9s %9s %9s %9s %9s %10s %10s %10s\n",
+		"method", "sent", "errors", "cancel", "srvcnc",
+		"avg ms", "p50 ms", "p95 ms", "p99 ms", "max ms",
+		"sent kB", "recv kB", "max kB");
+
+	methods = g_list_sort(g_hash_table_get_keys(srv->stats->methods), compare_methods);
+
+	foreach_list(node, methods)
+	{
+		const gchar *method = node->data;
+		MethodStats *stats = g_hash_table_lookup(srv->stats->methods, method);
+		guint num = MIN(stats->latency_num, LATENCY_SAMPLES);
+
+		memcpy(sorted, stats->latencies, num * sizeof(gint64));
+		qsort(sorted, num, sizeof(gint64), compare_latencies);
+
+		g_string_append_printf(str,
+			"%-40s %8" G_GUINT64_FORMAT " %6" G_GUINT64_FORMAT " %6" G_GUINT64_FORMAT " %6" G_GUINT64_FORMAT
+			" %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f %10.1f %10.1f\n",
+			method, stats->sent, stats->failed, stats->cancelled, stats->server_cancelled,
+			stats->latency_num > 0 ? stats->latency_sum / 1000.0 / stats->latency_num : 0.0,
+			get_percentile(sorted, num, 50),
+			get_percentile(sorted, num, 95),
+			get_percentile(sorted, num, 99),
+			stats->latency_max / 1000.0,
+			stats->bytes_sent / 1024.0,
+			stats->bytes_received / 1024.0,
+			stats->max_received / 1024.0);
+	}
+
+	g_list_free(methods);
+}
+
+
+void lsp_stats_free(LspServer *srv)
+{
+	if (!srv->stats)
+		return;
+
+	g_hash_table_destroy(srv->stats->methods);
+	g_free(srv->stats);
+	srv->stats = NULL;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef LSP_STATS_H
+#define LSP_STATS_H 1
+
+#include "lsp/lsp-server.h"
+
+#include <glib.h>
+
+
+typedef enum
+{
+	LspStatsSuccess,
+	LspStatsError,
+	LspStatsCancelled,  // cancelled by us, e.g. superseded by a newer request
+	LspStatsServerCancelled  // the server replied with RequestCancelled or ContentModified
+} LspStatsResult;
+
+
+void lsp_stats_request_sent(LspServer *srv, const gchar *method, GVariant *params);
+void lsp_stats_request_finished(LspServer *srv, const gchar *method, GVariant *result,
+	LspStatsResult res, gint64 latency);
+
+void lsp_stats_append(LspServer *srv, GString *str);
+void lsp_stats_free(LspServer *srv);
+
+#endif  /* LSP_STATS_H */
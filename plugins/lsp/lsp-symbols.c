@@ -25,37 +25,146 @@
 #include "lsp/lsp-utils.h"
 #include "lsp/lsp-sync.h"
 #include "lsp/lsp-tm-tag.h"
+#include "lsp/lsp-progress.h"
+#include "lsp/lsp-warm-cache.h"
 
 #include <jsonrpc-glib.h>
 
+#include <string.h>
+
 
 typedef struct {
 	GeanyDocument *doc;
 	LspSymbolRequestCallback callback;
 	gpointer user_data;
+	guint version;  // document version the caller needs symbols for
 } LspSymbolUserData;
 
 typedef struct {
 	gint ft_id;
 	LspWorkspaceSymbolRequestCallback callback;
 	gpointer user_data;
+	guint request_num;
+	gchar *partial_token;
+	GPtrArray *symbols;  // received so far as partial results
 } LspWorkspaceSymbolUserData;
 
 
-extern GeanyPlugin *geany_plugin;
+/* Symbols of a document shared by all consumers. At most one request per
+ * document is in flight; callers arriving meanwhile wait for its response. */
+typedef struct {
+	GPtrArray *symbols;  // NULL until the first response
+	guint version;  // document version of symbols, 0 for those of the warm cache
+	gboolean in_flight;
+	guint requested_version;  // document version of the request in flight
+	GSList *waiting;  // LspSymbolUserData
+} LspSymbolCache;
+
+
+static GHashTable *symbol_cache = NULL;  // document ID -> LspSymbolCache
+static guint workspace_request_num = 0;
+
+// kind of the warm cache files - name, type, line, arglist and scope of the tags
+#define WARM_CACHE_KIND "symbols"
+#define WARM_CACHE_TYPE "a(suuss)"
+
+
+static void free_symbol_cache(LspSymbolCache *cache)
+{
+	if (cache->symbols)
+		g_ptr_array_free(cache->symbols, TRUE);
+	g_slist_free_full(cache->waiting, g_free);
+	g_free(cache);
+}
+
+
+static LspSymbolCache *get_symbol_cache(GeanyDocument *doc, gboolean create)
+{
+	LspSymbolCache *cache;
+
+	if (!symbol_cache)
+	{
+		if (!create)
+			return NULL;
+		symbol_cache = g_hash_table_new_full(NULL, NULL, NULL,
+			(GDestroyNotify)free_symbol_cache);
+	}
+
+	cache = g_hash_table_lookup(symbol_cache, GUINT_TO_POINTER(doc->id));
+	if (!cache && create)
+	{
+		cache = g_new0(LspSymbolCache, 1);
+		g_hash_table_insert(symbol_cache, GUINT_TO_POINTER(doc->id), cache);
+	}
+
+	return cache;
+}
+
+
+static gsize get_string_size(const gchar *str)
+{
+	return str ? strlen(str) + 1 : 0;
+}
+
+
+static gsize get_symbol_cache_size(LspSymbolCache *cache)
+{
+	gsize size = sizeof(LspSymbolCache);
+	guint i;
+
+	if (!cache->symbols)
+		return size;
+
+	size += sizeof(GPtrArray) + cache->symbols->len * sizeof(gpointer);
+	for (i = 0; i < cache->symbols->len; i++)
+	{
+		TMTag *tag = cache->symbols->pdata[i];
+
+		size += sizeof(TMTag) + get_string_size(tag->name) + get_string_size(tag->arglist) +
+			get_string_size(tag->scope) + get_string_size(tag->inheritance) +
+			get_string_size(tag->var_type);
+	}
+
+	return size;
+}
 
-//TODO: possibly cache symbols of multiple files
-static GPtrArray *cached_symbols;
-static gchar *cached_symbols_fname;
+
+// returns the size of the cached symbols of doc, or of all documents if doc is NULL
+gsize lsp_symbols_get_memory_size(GeanyDocument *doc)
+{
+	GHashTableIter iter;
+	gpointer cache;
+	gsize size = 0;
+
+	if (!symbol_cache)
+		return 0;
+
+	if (doc)
+	{
+		cache = get_symbol_cache(doc, FALSE);
+		return cache ? get_symbol_cache_size(cache) : 0;
+	}
+
+	g_hash_table_iter_init(&iter, symbol_cache);
+	while (g_hash_table_iter_next(&iter, NULL, &cache))
+		size += get_symbol_cache_size(cache);
+
+	return size;
+}
+
+
+void lsp_symbols_doc_closed(GeanyDocument *doc)
+{
+	if (symbol_cache)
+		g_hash_table_remove(symbol_cache, GUINT_TO_POINTER(doc->id));
+}
 
 
 void lsp_symbols_destroy(void)
 {
-	if (cached_symbols)
-		g_ptr_array_free(cached_symbols, TRUE);
-	cached_symbols = NULL;
-	g_free(cached_symbols_fname);
-	cached_symbols_fname = NULL;
+	if (symbol_cache)
+		g_hash_table_destroy(symbol_cache);
+	symbol_cache = NULL;
 }
 
 
@@ -74,30 +183,38 @@ static void parse_symbols(GPtrArray *symbols, GVariant *symbol_variant, const gc
 		const gchar *detail = NULL;
 		const gchar *uri = NULL;
 		const gchar *container_name = NULL;
-		GVariant *loc_variant = NULL;
+		GVariant *selection_range = NULL;
+		GVariant *range = NULL;
+		GVariant *location = NULL;
 		GVariant *children = NULL;
 		gchar *uri_str = NULL;
 		gint64 kind = 0;
 		gint line_num = 0;
-
-		if (!JSONRPC_MESSAGE_PARSE(member, "name", JSONRPC_MESSAGE_GET_STRING(&name)))
-			continue;
-		if (!JSONRPC_MESSAGE_PARSE(member, "kind", JSONRPC_MESSAGE_GET_INT64(&kind)))
-			continue;
-
-		if (JSONRPC_MESSAGE_PARSE(member, "selectionRange", JSONRPC_MESSAGE_GET_VARIANT(&loc_variant)))
+		LspField fields[] = {
+			{"name", LspFieldString, &name},
+			{"kind", LspFieldInt64, &kind},
+			{"selectionRange", LspFieldVariant, &selection_range},
+			{"range", LspFieldVariant, &range},
+			{"location", LspFieldVariant, &location},
+			{"containerName", LspFieldString, &container_name},
+			{"detail", LspFieldString, &detail},
+			{"children", LspFieldVariant, &children}
+		};
+		guint found;
+
+		found = lsp_utils_parse_fields(member, fields, G_N_ELEMENTS(fields));
+
+		if (!workspace)
+			container_name = NULL;
+
+		if (selection_range || range)
 		{
-			LspRange range = lsp_utils_parse_range(loc_variant);
-			line_num = range.start.line;
+			LspRange r = lsp_utils_parse_range(selection_range ? selection_range : range);
+			line_num = r.start.line;
 		}
-		else if (JSONRPC_MESSAGE_PARSE(member, "range", JSONRPC_MESSAGE_GET_VARIANT(&loc_variant)))
+		else if (location)
 		{
-			LspRange range = lsp_utils_parse_range(loc_variant);
-			line_num = range.start.line;
-		}
-		else if (JSONRPC_MESSAGE_PARSE(member, "location", JSONRPC_MESSAGE_GET_VARIANT(&loc_variant)))
-		{
-			LspLocation *loc = lsp_utils_parse_location(loc_variant);
+			LspLocation *loc = lsp_utils_parse_location(location);
 			if (loc)
 			{
 				line_num = loc->range.start.line;
@@ -106,132 +223,278 @@ static void parse_symbols(GPtrArray *symbols, GVariant *symbol_variant, const gc
 				lsp_utils_free_lsp_location(loc);
 			}
 		}
-		else if (!workspace)
+
+		if (workspace && !uri_str && location)
 		{
-			if (loc_variant)
-				g_variant_unref(loc_variant);
-			continue;
+			LspField location_fields[] = {
+				{"uri", LspFieldString, &uri}
+			};
+
+			lsp_utils_parse_fields(location, location_fields, G_N_ELEMENTS(location_fields));
+			if (uri)
+				uri_str = g_strdup(uri);
 		}
 
-		if (workspace)
+		// name and kind (the first two fields) are mandatory, and the location
+		if ((found & 3) == 3 && (workspace ? uri_str != NULL : selection_range || range || location))
 		{
-			JSONRPC_MESSAGE_PARSE(member, "containerName", JSONRPC_MESSAGE_GET_STRING(&container_name));
+			tag = lsp_tm_tag_new();
+			tag->name = g_strdup(name);
+			tag->line = line_num + 1;
+			tag->type = kind;
+			tag->arglist = detail ? g_strdup(detail) : NULL;
+
+			if (scope)
+				tag->scope = g_strdup(scope);
+			else if (container_name)
+				tag->scope = g_strdup(container_name);
 
-			if (!uri_str)
+			if (uri_str)
 			{
-				if (JSONRPC_MESSAGE_PARSE(member, "location", "{",
-						"uri", JSONRPC_MESSAGE_GET_STRING(&uri),
-					"}"))
-				{
-					if (uri)
-						uri_str = g_strdup(uri);
-				}
-
-				if (!uri_str)
-					continue;
+				// TODO: total hack, just storing path "somewhere"
+				tag->inheritance = lsp_utils_get_real_path_from_uri_utf8(uri_str);
+			}
+
+			g_ptr_array_add(symbols, tag);
+
+			if (children)
+			{
+				gchar *new_scope;
+
+				if (scope)
+					new_scope = g_strconcat(scope, scope_sep, tag->name, NULL);
+				else
+					new_scope = g_strdup(tag->name);
+				parse_symbols(symbols, children, new_scope, scope_sep, FALSE);
+				g_free(new_scope);
 			}
 		}
 
-		JSONRPC_MESSAGE_PARSE(member, "detail", JSONRPC_MESSAGE_GET_STRING(&detail));
+		if (selection_range)
+			g_variant_unref(selection_range);
+		if (range)
+			g_variant_unref(range);
+		if (location)
+			g_variant_unref(location);
+		if (children)
+			g_variant_unref(children);
+		g_free(uri_str);
+	}
+}
 
-		tag = lsp_tm_tag_new();
-		tag->name = g_strdup(name);
-		tag->line = line_num + 1;
-		tag->type = kind;
-		tag->arglist = detail ? g_strdup(detail) : NULL;
 
-		if (scope)
-			tag->scope = g_strdup(scope);
-		else if (container_name)
-			tag->scope = g_strdup(container_name);
+static guint tag_hash(gconstpointer v)
+{
+	const TMTag *tag = v;
 
-		if (uri_str)
-		{
-			// TODO: total hack, just storing path "somewhere"
-			tag->inheritance = lsp_utils_get_real_path_from_uri_utf8(uri_str);
-		}
+	return g_str_hash(tag->name) ^ tag->line;
+}
 
-		g_ptr_array_add(symbols, tag);
 
-		if (JSONRPC_MESSAGE_PARSE(member, "children", JSONRPC_MESSAGE_GET_VARIANT(&children)))
-		{
-			gchar *new_scope;
+/* Replaces new tags equal to those of the previous response with the previous
+ * instances so unchanged symbols keep their identity in the symbol tree. */
+static void reuse_unchanged_tags(GPtrArray *symbols, GPtrArray *old_symbols)
+{
+	GHashTable *old_tags;
+	guint i;
 
-			if (scope)
-				new_scope = g_strconcat(scope, scope_sep, tag->name, NULL);
-			else
-				new_scope = g_strdup(tag->name);
-			parse_symbols(symbols, children, new_scope, scope_sep, FALSE);
-			g_free(new_scope);
-		}
+	if (!old_symbols || old_symbols->len == 0)
+		return;
 
-		if (loc_variant)
-			g_variant_unref(loc_variant);
-		if (children)
-			g_variant_unref(children);
-		g_free(uri_str);
+	old_tags = g_hash_table_new(tag_hash, (GEqualFunc)lsp_tm_tags_equal);
+	for (i = 0; i < old_symbols->len; i++)
+		g_hash_table_insert(old_tags, old_symbols->pdata[i], old_symbols->pdata[i]);
+
+	for (i = 0; i < symbols->len; i++)
+	{
+		TMTag *old_tag = g_hash_table_lookup(old_tags, symbols->pdata[i]);
+
+		if (old_tag)
+		{
+			lsp_tm_tag_unref(symbols->pdata[i]);
+			symbols->pdata[i] = lsp_tm_tag_ref(old_tag);
+		}
 	}
+
+	g_hash_table_destroy(old_tags);
 }
 
 
+static void send_symbols_request(LspServer *server, GeanyDocument *doc, LspSymbolCache *cache,
+	guint version);
+
+
 static void symbols_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
-	LspSymbolUserData *data = user_data;
+	GeanyDocument *doc = document_find_by_id(GPOINTER_TO_UINT(user_data));
+	LspSymbolCache *cache = doc ? get_symbol_cache(doc, FALSE) : NULL;
+	GSList *waiting, *node;
+
+	// document closed or servers restarted in the meantime
+	if (!cache)
+		return;
+
+	cache->in_flight = FALSE;
 
 	if (!error)
 	{
+		GPtrArray *symbols = g_ptr_array_new_full(0, (GDestroyNotify)lsp_tm_tag_unref);
+
 		//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
 
-		if (data->doc == document_get_current())
-		{
-			lsp_symbols_destroy();
-			cached_symbols = g_ptr_array_new_full(0, (GDestroyNotify)lsp_tm_tag_unref);
-			cached_symbols_fname = g_strdup(data->doc->real_path);
+		parse_symbols(symbols, return_value, NULL,
+			symbols_get_context_separator(doc->file_type->id), FALSE);
 
-			parse_symbols(cached_symbols, return_value, NULL,
-				symbols_get_context_separator(data->doc->file_type->id), FALSE);
+		reuse_unchanged_tags(symbols, cache->symbols);
+		if (cache->symbols)
+			g_ptr_array_free(cache->symbols, TRUE);
+		cache->symbols = symbols;
+		cache->version = cache->requested_version;
+	}
+
+	waiting = cache->waiting;
+	cache->waiting = NULL;
+
+	foreach_slist(node, waiting)
+	{
+		LspSymbolUserData *data = node->data;
+
+		// the document changed after the request was sent
+		if (!error && data->version > cache->version)
+			cache->waiting = g_slist_prepend(cache->waiting, data);
+		else
+		{
+			data->callback(data->user_data);
+			g_free(data);
 		}
 	}
+	g_slist_free(waiting);
 
-	data->callback(data->user_data);
+	if (cache->waiting)
+	{
+		LspServer *server = lsp_server_get_if_running(doc);
 
-	g_free(user_data);
+		cache->waiting = g_slist_reverse(cache->waiting);
+		if (server)
+			send_symbols_request(server, doc, cache, lsp_sync_get_doc_version(doc));
+		else
+		{
+			waiting = cache->waiting;
+			cache->waiting = NULL;
+			foreach_slist(node, waiting)
+			{
+				LspSymbolUserData *data = node->data;
+				data->callback(data->user_data);
+			}
+			g_slist_free_full(waiting, g_free);
+		}
+	}
 }
 
 
 GPtrArray *lsp_symbols_doc_get_cached(GeanyDocument *doc)
 {
-	if (g_strcmp0(doc->real_path, cached_symbols_fname) == 0)
-		return cached_symbols;
+	LspSymbolCache *cache = get_symbol_cache(doc, FALSE);
 
-	return NULL;
+	return cache ? cache->symbols : NULL;
 }
 
 
-static gboolean retry_cb(gpointer user_data)
+static void server_ready_cb(GeanyDocument *doc, gpointer user_data)
 {
 	LspSymbolUserData *data = user_data;
 
-	//printf("retrying symbols\n");
-	if (data->doc == document_get_current())
+	// document may not be current any more
+	if (doc == document_get_current())
+		lsp_symbols_doc_request(doc, data->callback, data->user_data);
+}
+
+
+static void send_symbols_request(LspServer *server, GeanyDocument *doc, LspSymbolCache *cache,
+	guint version)
+{
+	GVariant *node;
+	gchar *doc_uri;
+
+	doc_uri = lsp_utils_get_doc_uri(doc);
+
+	node = JSONRPC_MESSAGE_NEW (
+		"textDocument", "{",
+			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+		"}"
+	);
+
+	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
+
+	cache->in_flight = TRUE;
+	cache->requested_version = version;
+
+	lsp_rpc_call(server, "textDocument/documentSymbol", node,
+		symbols_cb, GUINT_TO_POINTER(doc->id));
+
+	g_free(doc_uri);
+	g_variant_unref(node);
+}
+
+
+/* Makes the symbols of the previous session available when doc wasn't modified
+ * since - Geany shows the cached symbols right after requesting them so they
+ * are displayed until the server sends the current ones. */
+static void load_warm_symbols(GeanyDocument *doc)
+{
+	LspSymbolCache *cache = get_symbol_cache(doc, FALSE);
+	GVariant *symbols_variant;
+	GVariantIter iter;
+	const gchar *name, *arglist, *scope;
+	guint type, line;
+
+	if (cache && cache->symbols)
+		return;
+
+	symbols_variant = lsp_warm_cache_load(doc, WARM_CACHE_KIND, G_VARIANT_TYPE(WARM_CACHE_TYPE));
+	if (!symbols_variant)
+		return;
+
+	cache = get_symbol_cache(doc, TRUE);
+	cache->symbols = g_ptr_array_new_full(0, (GDestroyNotify)lsp_tm_tag_unref);
+	cache->version = 0;
+
+	g_variant_iter_init(&iter, symbols_variant);
+	while (g_variant_iter_next(&iter, "(&suu&s&s)", &name, &type, &line, &arglist, &scope))
 	{
-		LspServer *srv = lsp_server_get_if_running(data->doc);
-		if (!lsp_server_is_usable(data->doc))
-			;  // server died or misconfigured
-		else if (!srv)
-			return TRUE;  // retry
-		else
-		{
-			// should be successful now
-			lsp_symbols_doc_request(data->doc, data->callback, data->user_data);
-			g_free(data);
-			return FALSE;
-		}
+		TMTag *tag = lsp_tm_tag_new();
+
+		tag->name = g_strdup(name);
+		tag->type = type;
+		tag->line = line;
+		tag->arglist = *arglist ? g_strdup(arglist) : NULL;
+		tag->scope = *scope ? g_strdup(scope) : NULL;
+		g_ptr_array_add(cache->symbols, tag);
 	}
 
-	// server shut down or document not current any more
-	g_free(data);
-	return FALSE;
+	g_variant_unref(symbols_variant);
+}
+
+
+/* Stores the symbols of doc for the next session if they are up to date. */
+void lsp_symbols_store_warm_cache(GeanyDocument *doc)
+{
+	LspSymbolCache *cache = get_symbol_cache(doc, FALSE);
+	GVariantBuilder builder;
+	TMTag *tag;
+	guint i;
+
+	if (!cache || !cache->symbols || cache->version == 0 || doc->changed ||
+		cache->version != lsp_sync_get_doc_version(doc))
+		return;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE(WARM_CACHE_TYPE));
+	foreach_ptr_array(tag, i, cache->symbols)
+	{
+		g_variant_builder_add(&builder, "(suuss)", tag->name, tag->type, tag->line,
+			tag->arglist ? tag->arglist : "", tag->scope ? tag->scope : "");
+	}
+	lsp_warm_cache_store(doc, WARM_CACHE_KIND, g_variant_builder_end(&builder));
 }
 
 
@@ -240,59 +503,79 @@ void lsp_symbols_doc_request(GeanyDocument *doc, LspSymbolRequestCallback callba
 {
 	LspServer *server = lsp_server_get_if_running(doc);
 	LspSymbolUserData *data = g_new0(LspSymbolUserData, 1);
-	GVariant *node;
-	gchar *doc_uri;
+	LspSymbolCache *cache;
 
 	data->user_data = user_data;
 	data->doc = doc;
 	data->callback = callback;
 
+	load_warm_symbols(doc);
+
 	if (!server)
 	{
-		// happens when Geany and LSP server started - we cannot send the request yet
-		plugin_timeout_add(geany_plugin, 300, retry_cb, data);
+		// happens when Geany and LSP server started - send the request once the server is ready
+		lsp_server_when_ready(doc, server_ready_cb, data, g_free);
 		return;
 	}
 
-	doc_uri = lsp_utils_get_doc_uri(doc);
-
 	/* Geany requests symbols before firing "document-activate" signal so we may
 	 * need to request document opening here */
 	if (!lsp_sync_is_document_open(doc))
 		lsp_sync_text_document_did_open(server, doc);
 
-	node = JSONRPC_MESSAGE_NEW (
-		"textDocument", "{",
-			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
-		"}"
-	);
+	// the document version has to reflect all edits made so far
+	lsp_sync_flush_doc_changes(doc);
+	data->version = lsp_sync_get_doc_version(doc);
 
-	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
+	cache = get_symbol_cache(doc, TRUE);
+	if (cache->symbols && cache->version == data->version)
+	{
+		callback(user_data);
+		g_free(data);
+		return;
+	}
 
-	lsp_rpc_call(server, "textDocument/documentSymbol", node,
-		symbols_cb, data);
+	cache->waiting = g_slist_append(cache->waiting, data);
 
-	g_free(doc_uri);
-	g_variant_unref(node);
+	// the waiting callers get served (or a new request sent) once it's answered
+	if (!cache->in_flight)
+		send_symbols_request(server, doc, cache, data->version);
+}
+
+
+static void workspace_symbols_partial_cb(GVariant *value, gpointer user_data)
+{
+	LspWorkspaceSymbolUserData *data = user_data;
+
+	// superseded by a newer query
+	if (data->request_num != workspace_request_num)
+		return;
+
+	//scope separator doesn't matter here
+	parse_symbols(data->symbols, value, NULL, "", TRUE);
+
+	data->callback(data->symbols, data->user_data);
 }
 
 
 static void workspace_symbols_cb(GVariant *return_value, GError *error, gpointer user_data)
 {
 	LspWorkspaceSymbolUserData *data = user_data;
-	GPtrArray *ret = g_ptr_array_new_full(0, (GDestroyNotify)lsp_tm_tag_unref);
 
+	lsp_progress_unregister_partial_result(data->partial_token);
+
+	// with partial results, the final response contains the rest (typically nothing)
 	if (!error)
 	{
 		//printf("%s\n\n\n", lsp_utils_json_pretty_print(return_value));
 
-		//scope separator doesn't matter here
-		parse_symbols(ret, return_value, NULL, "", TRUE);
+		parse_symbols(data->symbols, return_value, NULL, "", TRUE);
 	}
 
-	data->callback(ret, data->user_data);
+	data->callback(data->symbols, data->user_data);
 
-	g_ptr_array_free(ret, TRUE);
+	g_ptr_array_free(data->symbols, TRUE);
+	g_free(data->partial_token);
 	g_free(user_data);
 }
 
@@ -311,9 +594,13 @@ void lsp_symbols_workspace_request(GeanyFiletype *ft, const gchar *query,
 	data->user_data = user_data;
 	data->callback = callback;
 	data->ft_id = ft->id;
+	data->request_num = ++workspace_request_num;
+	data->symbols = g_ptr_array_new_full(0, (GDestroyNotify)lsp_tm_tag_unref);
+	data->partial_token = lsp_progress_register_partial_result(workspace_symbols_partial_cb, data);
 
 	node = JSONRPC_MESSAGE_NEW (
-		"query", JSONRPC_MESSAGE_PUT_STRING(query)
+		"query", JSONRPC_MESSAGE_PUT_STRING(query),
+		"partialResultToken", JSONRPC_MESSAGE_PUT_STRING(data->partial_token)
 	);
 
 	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
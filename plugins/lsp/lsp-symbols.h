@@ -27,6 +27,9 @@ void lsp_symbols_doc_request(GeanyDocument *doc, LspSymbolRequestCallback callba
 	gpointer user_data);
 
 GPtrArray *lsp_symbols_doc_get_cached(GeanyDocument *doc);
+void lsp_symbols_doc_closed(GeanyDocument *doc);
+void lsp_symbols_store_warm_cache(GeanyDocument *doc);
+gsize lsp_symbols_get_memory_size(GeanyDocument *doc);
 
 
 typedef void (*LspWorkspaceSymbolRequestCallback) (GPtrArray *arr, gpointer user_data);
@@ -30,180 +30,543 @@
 #include <jsonrpc-glib.h>
 
 
-static GHashTable *open_docs = NULL;
-static GHashTable *doc_version_nums = NULL;
+typedef struct
+{
+	LspServer *server;
+	GeanyDocument *doc;
+	GPtrArray *changes;  // contentChanges elements, NULL when full sync is used
+	gboolean full_sync;
+	guint source_id;
+} PendingChanges;
+
+
+typedef struct
+{
+	guint doc_id;
+	gchar *real_path;  // the path uri was created for
+	gchar *uri;
+	guint version;
+	gboolean open;
+	PendingChanges *pending;
+} DocSync;
+
+
+// GeanyDocument -> DocSync, kept after didClose so versions keep increasing
+static GHashTable *sync_docs = NULL;
+// open documents, most recently active first
+static GQueue *recent_docs = NULL;
+// document whose modifications are reported by the caller instead of SCN_MODIFIED
+static GeanyDocument *suspended_doc = NULL;
+
+
+static void pending_changes_free(PendingChanges *pending)
+{
+	if (pending->source_id)
+		g_source_remove(pending->source_id);
+	if (pending->changes)
+		g_ptr_array_free(pending->changes, TRUE);
+	g_free(pending);
+}
+
+
+static void doc_sync_free(DocSync *sync)
+{
+	if (sync->pending)
+		pending_changes_free(sync->pending);
+	g_free(sync->real_path);
+	g_free(sync->uri);
+	g_free(sync);
+}
 
 
 void lsp_sync_init()
 {
-	if (!open_docs)
-		open_docs = g_hash_table_new(NULL, NULL);
-	g_hash_table_remove_all(open_docs);
+	GHashTableIter iter;
+	DocSync *sync;
+
+	if (!sync_docs)
+		sync_docs = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify)doc_sync_free);
+
+	// the servers were restarted - nothing is open and nothing waits to be sent
+	g_hash_table_iter_init(&iter, sync_docs);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&sync))
+	{
+		sync->open = FALSE;
+		if (sync->pending)
+			pending_changes_free(sync->pending);
+		sync->pending = NULL;
+	}
+
+	if (!recent_docs)
+		recent_docs = g_queue_new();
+	g_queue_clear(recent_docs);
+}
+
+
+void lsp_sync_destroy(void)
+{
+	if (sync_docs)
+		g_hash_table_destroy(sync_docs);
+	sync_docs = NULL;
+
+	if (recent_docs)
+		g_queue_free(recent_docs);
+	recent_docs = NULL;
 }
 
 
-static guint get_next_doc_version_num(GeanyDocument *doc)
+static DocSync *get_doc_sync(GeanyDocument *doc, gboolean create)
 {
-	guint num;
+	DocSync *sync = sync_docs ? g_hash_table_lookup(sync_docs, doc) : NULL;
+
+	// Geany reuses GeanyDocument structs of closed documents
+	if (sync && sync->doc_id != doc->id)
+	{
+		g_hash_table_remove(sync_docs, doc);
+		sync = NULL;
+	}
+
+	if (!sync && create)
+	{
+		if (!sync_docs)
+			lsp_sync_init();
+		sync = g_new0(DocSync, 1);
+		sync->doc_id = doc->id;
+		g_hash_table_insert(sync_docs, doc, sync);
+	}
+
+	return sync;
+}
 
+
+// the URI is only created again when the path changes after save as
+static const gchar *get_doc_uri(DocSync *sync, GeanyDocument *doc)
+{
+	if (!sync->uri || g_strcmp0(sync->real_path, doc->real_path) != 0)
+	{
+		SETPTR(sync->real_path, g_strdup(doc->real_path));
+		SETPTR(sync->uri, lsp_utils_get_doc_uri(doc));
+	}
+	return sync->uri;
+}
+
+
+static guint get_next_doc_version_num(DocSync *sync, GeanyDocument *doc)
+{
 	if (!doc->real_path)
 		return 0;
 
-	if (!doc_version_nums)  // TODO: g_hash_table_destroy(doc_version_nums);
-		doc_version_nums = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	return ++sync->version;
+}
+
 
-	num = GPOINTER_TO_UINT(g_hash_table_lookup(doc_version_nums, doc->real_path));
-	num++;
-	g_hash_table_insert(doc_version_nums, g_strdup(doc->real_path), GUINT_TO_POINTER(num));
-	return num;
+guint lsp_sync_get_doc_version(GeanyDocument *doc)
+{
+	DocSync *sync;
+
+	if (!doc->real_path)
+		return 0;
+
+	sync = get_doc_sync(doc, FALSE);
+	return sync ? sync->version : 0;
+}
+
+
+/* Fills text with the two parts of the document on each side of the gap of
+ * Scintilla's buffer. Unlike SCI_GETCHARACTERPOINTER this doesn't move the gap
+ * to the end of the document, which would be moved back again on the next edit
+ * at the caret. The pointers are only valid until the next modification of the
+ * document. lsp_rpc_notify_with_text() gets them when the message is sent and
+ * escapes the text directly into the output buffer so the document contents
+ * doesn't have to be duplicated. */
+const LspRpcText *lsp_sync_get_doc_text(GeanyDocument *doc, LspRpcText *text)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint len = sci_get_length(sci);
+	gint gap = SSM(sci, SCI_GETGAPPOSITION, 0, 0);
+
+	gap = CLAMP(gap, 0, len);
+	// a range lying on one side of the gap doesn't make SCI_GETRANGEPOINTER move it
+	text->text = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, 0, gap);
+	text->len = gap;
+	text->tail = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, gap, len - gap);
+	text->tail_len = len - gap;
+	if (!text->text)  // empty document
+		text->text = "";
+
+	return text;
 }
 
 
 gboolean lsp_sync_is_document_open(GeanyDocument *doc)
 {
-	return g_hash_table_lookup(open_docs, doc) != NULL;
+	DocSync *sync = get_doc_sync(doc, FALSE);
+
+	return sync && sync->open;
+}
+
+
+/* Closes the least recently active documents of the server above its
+ * document_max_open limit. They are reopened lazily by the usual
+ * lsp_sync_is_document_open() checks once they are needed again. The current
+ * document and documents with unsaved changes are kept open. */
+static void close_inactive_docs(LspServer *server)
+{
+	GeanyDocument *current_doc = document_get_current();
+	gint max_open = server->config.document_max_open;
+	GList *link, *prev;
+	gint num = 0;
+
+	if (max_open <= 0)
+		return;
+
+	for (link = recent_docs->head; link; link = link->next)
+	{
+		if (lsp_server_get_if_running(link->data) == server)
+			num++;
+	}
+
+	for (link = recent_docs->tail; link && num > max_open; link = prev)
+	{
+		GeanyDocument *doc = link->data;
+
+		prev = link->prev;
+
+		if (doc != current_doc && !doc->changed && lsp_server_get_if_running(doc) == server)
+		{
+			// removes link from recent_docs
+			lsp_sync_text_document_did_close(server, doc);
+			num--;
+		}
+	}
+}
+
+
+void lsp_sync_document_activated(GeanyDocument *doc)
+{
+	GList *link = g_queue_find(recent_docs, doc);
+
+	if (!link)
+		return;
+
+	g_queue_unlink(recent_docs, link);
+	g_queue_push_head_link(recent_docs, link);
 }
 
 
 void lsp_sync_text_document_did_open(LspServer *server, GeanyDocument *doc)
 {
 	GVariant *node;
-	gchar *doc_uri;
+	DocSync *sync;
+	const gchar *doc_uri;
 	gchar *lang_id;
-	gchar *doc_text;
 	guint doc_version;
 
 	if (lsp_sync_is_document_open(doc))
 		return;
 
-	g_hash_table_add(open_docs, doc);
+	sync = get_doc_sync(doc, TRUE);
+	sync->open = TRUE;
+	g_queue_push_head(recent_docs, doc);
+	// the server uses UTF-16 positions
+	lsp_utils_pos_cache_attach(doc->editor->sci);
 
-	doc_uri = lsp_utils_get_doc_uri(doc);
+	doc_uri = get_doc_uri(sync, doc);
 	lang_id = lsp_utils_get_lsp_lang_name(doc);
-	doc_text = sci_get_contents(doc->editor->sci, -1);
-	doc_version = get_next_doc_version_num(doc);
+	doc_version = get_next_doc_version_num(sync, doc);
 
 	node = JSONRPC_MESSAGE_NEW (
 		"textDocument", "{",
 			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
 			"languageId", JSONRPC_MESSAGE_PUT_STRING(lang_id),
 			"version", JSONRPC_MESSAGE_PUT_INT32(doc_version),
-			"text", JSONRPC_MESSAGE_PUT_STRING(doc_text),
+			"text", JSONRPC_MESSAGE_PUT_STRING(JSONRPC_MESSAGE_TEXT_PLACEHOLDER),
 		"}"
 	);
 
 	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
-	lsp_rpc_notify(server, "textDocument/didOpen", node, NULL, NULL);
+	lsp_rpc_notify_with_text(server, "textDocument/didOpen", node, doc, NULL, NULL);
 
-	g_free(doc_uri);
 	g_free(lang_id);
-	g_free(doc_text);
 
 	g_variant_unref(node);
+
+	close_inactive_docs(server);
 }
 
 
 void lsp_sync_text_document_did_close(LspServer *server, GeanyDocument *doc)
 {
 	GVariant *node;
-	gchar *doc_uri;
+	DocSync *sync;
+
+	// responses to the requests for the document are of no use now
+	lsp_rpc_doc_closed(server, doc);
 
 	if (!lsp_sync_is_document_open(doc))
 		return;
 
-	doc_uri = lsp_utils_get_doc_uri(doc);
+	lsp_sync_flush_doc_changes(doc);
+
+	sync = get_doc_sync(doc, FALSE);
 
 	node = JSONRPC_MESSAGE_NEW (
 		"textDocument", "{",
-			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+			"uri", JSONRPC_MESSAGE_PUT_STRING(get_doc_uri(sync, doc)),
 		"}"
 	);
 
 	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
-	g_hash_table_remove(open_docs, doc);
+	sync->open = FALSE;
+	g_queue_remove(recent_docs, doc);
 
 	lsp_rpc_notify(server, "textDocument/didClose", node, NULL, NULL);
 
-	g_free(doc_uri);
 	g_variant_unref(node);
 }
 
 
+/* Opens the documents which were open on the previous, restarted server of the
+ * filetype of server on server again. */
+void lsp_sync_reopen_documents(LspServer *server)
+{
+	GPtrArray *docs;
+	GList *link;
+	guint i;
+
+	if (!recent_docs)
+		return;
+
+	docs = g_ptr_array_new();
+	// least recently active first so the order of recent_docs stays the same
+	for (link = recent_docs->tail; link; link = link->prev)
+	{
+		GeanyDocument *doc = link->data;
+
+		if (doc->is_valid && lsp_server_get_if_running(doc) == server)
+			g_ptr_array_add(docs, doc);
+	}
+
+	for (i = 0; i < docs->len; i++)
+	{
+		GeanyDocument *doc = docs->pdata[i];
+		DocSync *sync = get_doc_sync(doc, FALSE);
+
+		if (!sync || !sync->open)
+			continue;
+
+		// the changes not sent yet are part of the text sent by didOpen
+		if (sync->pending)
+			pending_changes_free(sync->pending);
+		sync->pending = NULL;
+		sync->open = FALSE;
+		g_queue_remove(recent_docs, doc);
+
+		lsp_sync_text_document_did_open(server, doc);
+	}
+
+	g_ptr_array_free(docs, TRUE);
+}
+
+
 void lsp_sync_text_document_did_save(LspServer *server, GeanyDocument *doc)
 {
 	GVariant *node;
-	gchar *doc_uri = lsp_utils_get_doc_uri(doc);
-	gchar *doc_text = sci_get_contents(doc->editor->sci, -1);
+
+	lsp_sync_flush_doc_changes(doc);
 
 	node = JSONRPC_MESSAGE_NEW (
 		"textDocument", "{",
-			"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
+			"uri", JSONRPC_MESSAGE_PUT_STRING(get_doc_uri(get_doc_sync(doc, TRUE), doc)),
 		"}",
-		"text", JSONRPC_MESSAGE_PUT_STRING(doc_text)
+		"text", JSONRPC_MESSAGE_PUT_STRING(JSONRPC_MESSAGE_TEXT_PLACEHOLDER)
 	);
 
 	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
-	lsp_rpc_notify(server, "textDocument/didSave", node, NULL, NULL);
-
-	g_free(doc_uri);
-	g_free(doc_text);
+	lsp_rpc_notify_with_text(server, "textDocument/didSave", node, doc, NULL, NULL);
 
 	g_variant_unref(node);
 }
 
 
-void lsp_sync_text_document_did_change(LspServer *server, GeanyDocument *doc,
-	LspPosition pos_start, LspPosition pos_end, gchar *text)
+static void send_pending_changes(PendingChanges *pending)
 {
-	GVariant *node;
-	gchar *doc_uri = lsp_utils_get_doc_uri(doc);
-	guint doc_version = get_next_doc_version_num(doc);
+	GeanyDocument *doc = pending->doc;
+	GVariant *node, *changes;
+	GVariantDict dict;
+	DocSync *sync;
+	guint doc_version;
+
+	// the server might have been restarted or the document closed in the meantime
+	if (!doc->is_valid || !lsp_sync_is_document_open(doc) ||
+		lsp_server_get_if_running(doc) != pending->server)
+		return;
+
+	sync = get_doc_sync(doc, FALSE);
+	doc_version = get_next_doc_version_num(sync, doc);
 
-	if (server->use_incremental_sync)
+	if (pending->full_sync)
 	{
-		node = JSONRPC_MESSAGE_NEW (
-			"textDocument", "{",
-				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
-				"version", JSONRPC_MESSAGE_PUT_INT32(doc_version),
-			"}",
-			"contentChanges", "[", "{",
-				"range", "{",
-					"start", "{",
-						"line", JSONRPC_MESSAGE_PUT_INT32(pos_start.line),
-						"character", JSONRPC_MESSAGE_PUT_INT32(pos_start.character),
-					"}",
-					"end", "{",
-						"line", JSONRPC_MESSAGE_PUT_INT32(pos_end.line),
-						"character", JSONRPC_MESSAGE_PUT_INT32(pos_end.character),
-					"}",
-				"}",
-				"text", JSONRPC_MESSAGE_PUT_STRING(text),
-			"}", "]"
-		);
+		changes = JSONRPC_MESSAGE_NEW_ARRAY ("{",
+			"text", JSONRPC_MESSAGE_PUT_STRING(JSONRPC_MESSAGE_TEXT_PLACEHOLDER),
+		"}");
 	}
 	else
 	{
-		gchar *contents = sci_get_contents(doc->editor->sci, -1);
-		node = JSONRPC_MESSAGE_NEW (
-			"textDocument", "{",
-				"uri", JSONRPC_MESSAGE_PUT_STRING(doc_uri),
-				"version", JSONRPC_MESSAGE_PUT_INT32(doc_version),
-			"}",
-			"contentChanges", "[", "{",
-				"text", JSONRPC_MESSAGE_PUT_STRING(contents),
-			"}", "]"
-		);
-		g_free(contents);
+		changes = g_variant_take_ref(g_variant_new_array(G_VARIANT_TYPE_VARDICT,
+			(GVariant **)(gpointer)pending->changes->pdata, pending->changes->len));
 	}
 
+	node = JSONRPC_MESSAGE_NEW (
+		"textDocument", "{",
+			"uri", JSONRPC_MESSAGE_PUT_STRING(get_doc_uri(sync, doc)),
+			"version", JSONRPC_MESSAGE_PUT_INT32(doc_version),
+		"}"
+	);
+
+	g_variant_dict_init(&dict, node);
+	g_variant_dict_insert_value(&dict, "contentChanges", changes);
+	g_variant_unref(node);
+	node = g_variant_take_ref(g_variant_dict_end(&dict));
+
 	//printf("%s\n\n\n", lsp_utils_json_pretty_print(node));
 
-	lsp_rpc_notify(server, "textDocument/didChange", node, NULL, NULL);
+	if (pending->full_sync)
+		lsp_rpc_notify_with_text(pending->server, "textDocument/didChange", node,
+			doc, NULL, NULL);
+	else
+		lsp_rpc_notify(pending->server, "textDocument/didChange", node, NULL, NULL);
 
-	g_free(doc_uri);
+	lsp_rpc_doc_edited(pending->server, doc);
 
+	g_variant_unref(changes);
 	g_variant_unref(node);
 }
+
+
+void lsp_sync_flush_doc_changes(GeanyDocument *doc)
+{
+	DocSync *sync = get_doc_sync(doc, FALSE);
+	PendingChanges *pending;
+
+	if (!sync || !sync->pending)
+		return;
+
+	// remove first so the entry doesn't get flushed again from inside lsp_rpc_notify()
+	pending = sync->pending;
+	sync->pending = NULL;
+	send_pending_changes(pending);
+	pending_changes_free(pending);
+}
+
+
+void lsp_sync_flush_changes(LspServer *server)
+{
+	GHashTableIter iter;
+	GPtrArray *docs;
+	GeanyDocument *doc;
+	DocSync *sync;
+	guint i;
+
+	if (!sync_docs)
+		return;
+
+	// collect first, flushing may flush other documents too
+	docs = g_ptr_array_new();
+	g_hash_table_iter_init(&iter, sync_docs);
+	while (g_hash_table_iter_next(&iter, (gpointer *)&doc, (gpointer *)&sync))
+	{
+		if (sync->pending && (!server || sync->pending->server == server))
+			g_ptr_array_add(docs, doc);
+	}
+
+	foreach_ptr_array(doc, i, docs)
+		lsp_sync_flush_doc_changes(doc);
+	g_ptr_array_free(docs, TRUE);
+}
+
+
+static gboolean flush_changes_cb(gpointer user_data)
+{
+	PendingChanges *pending = user_data;
+
+	pending->source_id = 0;
+	lsp_sync_flush_doc_changes(pending->doc);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+void lsp_sync_suspend_changes(GeanyDocument *doc, gboolean suspend)
+{
+	suspended_doc = suspend ? doc : NULL;
+}
+
+
+gboolean lsp_sync_changes_suspended(GeanyDocument *doc)
+{
+	return doc && doc == suspended_doc;
+}
+
+
+void lsp_sync_text_document_did_change(LspServer *server, GeanyDocument *doc,
+	LspPosition pos_start, LspPosition pos_end, gchar *text)
+{
+	DocSync *sync = get_doc_sync(doc, TRUE);
+	PendingChanges *pending = sync->pending;
+
+	if (pending && pending->server != server)
+	{
+		lsp_sync_flush_doc_changes(doc);
+		pending = NULL;
+	}
+
+	if (!pending)
+	{
+		pending = g_new0(PendingChanges, 1);
+		pending->server = server;
+		pending->doc = doc;
+		pending->full_sync = !server->use_incremental_sync;
+		if (!pending->full_sync)
+		{
+			pending->changes = g_ptr_array_new_full(1, (GDestroyNotify)g_variant_unref);
+
+			if (server->config.document_changes_batch_delay > 0)
+				pending->source_id = g_timeout_add(server->config.document_changes_batch_delay,
+					flush_changes_cb, pending);
+			else
+				pending->source_id = g_idle_add(flush_changes_cb, pending);
+		}
+
+		sync->pending = pending;
+	}
+
+	// with full sync the whole document is sent during flush so there's
+	// nothing to record here - just postpone the flush until typing pauses
+	// (requests flush pending changes themselves so they always see fresh state)
+	if (pending->full_sync)
+	{
+		if (pending->source_id)
+			g_source_remove(pending->source_id);
+		pending->source_id = g_timeout_add(MAX(server->config.document_full_sync_delay, 0),
+			flush_changes_cb, pending);
+		return;
+	}
+
+	g_ptr_array_add(pending->changes, JSONRPC_MESSAGE_NEW (
+		"range", "{",
+			"start", "{",
+				"line", JSONRPC_MESSAGE_PUT_INT32(pos_start.line),
+				"character", JSONRPC_MESSAGE_PUT_INT32(pos_start.character),
+			"}",
+			"end", "{",
+				"line", JSONRPC_MESSAGE_PUT_INT32(pos_end.line),
+				"character", JSONRPC_MESSAGE_PUT_INT32(pos_end.character),
+			"}",
+		"}",
+		"text", JSONRPC_MESSAGE_PUT_STRING(text)
+	));
+}
@@ -21,16 +21,28 @@
 
 
 #include "lsp/lsp-server.h"
+#include "lsp/lsp-rpc.h"
 #include "lsp/lsp-utils.h"
 
 void lsp_sync_init();
+void lsp_sync_destroy(void);
 
 void lsp_sync_text_document_did_open(LspServer *server, GeanyDocument *doc);
 void lsp_sync_text_document_did_close(LspServer *server, GeanyDocument *doc);
+void lsp_sync_reopen_documents(LspServer *server);
 void lsp_sync_text_document_did_save(LspServer *server, GeanyDocument *doc);
 void lsp_sync_text_document_did_change(LspServer *server, GeanyDocument *doc,
 	LspPosition pos_start, LspPosition pos_end, gchar *text);
 
+void lsp_sync_suspend_changes(GeanyDocument *doc, gboolean suspend);
+gboolean lsp_sync_changes_suspended(GeanyDocument *doc);
+
+void lsp_sync_flush_doc_changes(GeanyDocument *doc);
+void lsp_sync_flush_changes(LspServer *server);
+
 gboolean lsp_sync_is_document_open(GeanyDocument *doc);
+guint lsp_sync_get_doc_version(GeanyDocument *doc);
+const LspRpcText *lsp_sync_get_doc_text(GeanyDocument *doc, LspRpcText *text);
+void lsp_sync_document_activated(GeanyDocument *doc);
 
 #endif  /* LSP_SYNC_H */
@@ -23,6 +23,7 @@
 #include "lsp/lsp-tm-tag.h"
 
 #include <glib.h>
+#include <string.h>
 
 /* all here is copied from Geany - not part of its public API */
 
@@ -65,3 +66,38 @@ void lsp_tm_tag_unref(TMTag *tag)
 		TAG_FREE(tag);
 	}
 }
+
+
+/*
+ Adds a reference to a TMTag.
+ @param tag Pointer to a TMTag structure
+ @return the passed-in TMTag
+*/
+TMTag *lsp_tm_tag_ref(TMTag *tag)
+{
+	g_atomic_int_inc(&tag->refcount);
+	return tag;
+}
+
+
+#define FALLBACK(X, Y) ((X) ? (X) : (Y))
+
+gboolean lsp_tm_tags_equal(const TMTag *a, const TMTag *b)
+{
+	if (a == b)
+		return TRUE;
+
+	return (a->line == b->line &&
+			a->file == b->file /* ptr comparison */ &&
+			strcmp(FALLBACK(a->name, ""), FALLBACK(b->name, "")) == 0 &&
+			a->type == b->type &&
+			a->local == b->local &&
+			a->flags == b->flags &&
+			a->access == b->access &&
+			a->impl == b->impl &&
+			a->lang == b->lang &&
+			strcmp(FALLBACK(a->scope, ""), FALLBACK(b->scope, "")) == 0 &&
+			strcmp(FALLBACK(a->arglist, ""), FALLBACK(b->arglist, "")) == 0 &&
+			strcmp(FALLBACK(a->inheritance, ""), FALLBACK(b->inheritance, "")) == 0 &&
+			strcmp(FALLBACK(a->var_type, ""), FALLBACK(b->var_type, "")) == 0);
+}
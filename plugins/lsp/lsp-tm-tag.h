@@ -24,6 +24,8 @@
 
 TMTag *lsp_tm_tag_new(void);
 void lsp_tm_tag_unref(TMTag *tag);
+TMTag *lsp_tm_tag_ref(TMTag *tag);
+gboolean lsp_tm_tags_equal(const TMTag *a, const TMTag *b);
 
 
 #endif  /* LSP_TM_TAG_H */
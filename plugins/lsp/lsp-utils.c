@@ -25,6 +25,8 @@
 #include <geanyplugin.h>
 #include <jsonrpc-glib.h>
 
+#include <string.h>
+
 
 //TODO: remove once part of geany-plugins
 #define PLUGIN "lsp"
@@ -36,22 +38,32 @@ extern LspProjectConfigurationType project_configuration_type;
 extern gchar *project_configuration_file;
 
 
+/* Makes Scintilla maintain the UTF-16 line character index of the editor so
+ * position conversions don't scan lines without characters outside ASCII. The
+ * conversions also work for editors without the index, they only scan the line
+ * up to the converted position. */
+void lsp_utils_pos_cache_attach(ScintillaObject *sci)
+{
+	if (SSM(sci, SCI_GETLINECHARACTERINDEX, 0, 0) & SC_LINECHARACTERINDEX_UTF16)
+		return;
+
+	SSM(sci, SCI_ALLOCATELINECHARACTERINDEX, SC_LINECHARACTERINDEX_UTF16, 0);
+}
+
+
 LspPosition lsp_utils_scintilla_pos_to_lsp(ScintillaObject *sci, gint sci_pos)
 {
 	LspPosition lsp_pos;
-	gint line_start_pos;
 
 	lsp_pos.line = sci_get_line_from_position(sci, sci_pos);
-	line_start_pos = sci_get_position_from_line(sci, lsp_pos.line);
-	lsp_pos.character = SSM(sci, SCI_COUNTCODEUNITS, line_start_pos, sci_pos);
+	lsp_pos.character = SSM(sci, SCI_LINECODEUNITSFROMPOSITION, sci_pos, 0);
 	return lsp_pos;
 }
 
 
 gint lsp_utils_lsp_pos_to_scintilla(ScintillaObject *sci, LspPosition lsp_pos)
 {
-	gint line_start_pos = sci_get_position_from_line(sci, lsp_pos.line);
-	return SSM(sci, SCI_POSITIONRELATIVECODEUNITS, line_start_pos, lsp_pos.character);
+	return SSM(sci, SCI_POSITIONFROMLINECODEUNITS, lsp_pos.line, lsp_pos.character);
 }
 
 
@@ -207,10 +219,10 @@ const gchar *lsp_utils_get_global_config_filename(void)
 {
 	static gchar *filename = NULL;
 
-	if (filename)
-		return filename;
+	if (!filename)
+		filename = g_build_filename(geany_data->app->datadir, "lsp", "lsp.conf", NULL);
 
-	return g_build_filename(geany_data->app->datadir, "lsp", "lsp.conf", NULL);
+	return filename;
 }
 
 
@@ -273,13 +285,112 @@ gboolean lsp_utils_is_lsp_disabled_for_project(void)
 }
 
 
+/* Same conversions as the corresponding JSONRPC_MESSAGE_GET_* of
+ * JSONRPC_MESSAGE_PARSE. */
+static gboolean parse_field(LspField *field, GVariant *value)
+{
+	switch (field->type)
+	{
+		case LspFieldString:
+			if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+				*(const gchar **)field->value = g_variant_get_string(value, NULL);
+			else if (g_variant_is_of_type(value, G_VARIANT_TYPE("mv")) ||
+				g_variant_is_of_type(value, G_VARIANT_TYPE("ms")))
+				*(const gchar **)field->value = NULL;
+			else
+				return FALSE;
+			return TRUE;
+
+		case LspFieldInt64:
+			if (!g_variant_is_of_type(value, G_VARIANT_TYPE_INT64))
+				return FALSE;
+			*(gint64 *)field->value = g_variant_get_int64(value);
+			return TRUE;
+
+		case LspFieldVariant:
+			if (g_variant_is_of_type(value, G_VARIANT_TYPE_VARIANT))
+			{
+				GVariant *child = g_variant_get_variant(value);
+
+				if (g_variant_is_of_type(child, G_VARIANT_TYPE_VARDICT))
+				{
+					*(GVariant **)field->value = child;
+					return TRUE;
+				}
+				g_variant_unref(child);
+			}
+			*(GVariant **)field->value = g_variant_ref(value);
+			return TRUE;
+
+		case LspFieldIter:
+			if (!g_variant_is_of_type(value, G_VARIANT_TYPE("av")) &&
+				!g_variant_is_of_type(value, G_VARIANT_TYPE_VARDICT))
+				return FALSE;
+			*(GVariantIter **)field->value = g_variant_iter_new(value);
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+/* Extracts the given members of a JSON object in a single pass over it - unlike
+ * JSONRPC_MESSAGE_PARSE, which builds a dictionary of all the members for each
+ * call. Returns a bit mask of the fields found (at most 32). */
+guint lsp_utils_parse_fields(GVariant *variant, LspField *fields, guint field_num)
+{
+	GVariant *unboxed = NULL;
+	GVariant *value = NULL;
+	const gchar *key;
+	GVariantIter iter;
+	guint found = 0;
+
+	g_return_val_if_fail(field_num <= 32, 0);
+
+	if (!variant)
+		return 0;
+
+	if (g_variant_is_of_type(variant, G_VARIANT_TYPE_VARIANT))
+		variant = unboxed = g_variant_get_variant(variant);
+
+	if (g_variant_is_of_type(variant, G_VARIANT_TYPE_VARDICT))
+	{
+		g_variant_iter_init(&iter, variant);
+		while (g_variant_iter_loop(&iter, "{&sv}", &key, &value))
+		{
+			guint i;
+
+			for (i = 0; i < field_num; i++)
+			{
+				guint bit = 1u << i;
+
+				if (!(found & bit) && strcmp(fields[i].name, key) == 0)
+				{
+					if (parse_field(&fields[i], value))
+						found |= bit;
+					break;
+				}
+			}
+		}
+	}
+
+	// strings point into the data shared with variant
+	if (unboxed)
+		g_variant_unref(unboxed);
+
+	return found;
+}
+
+
 LspPosition lsp_utils_parse_pos(GVariant *variant)
 {
-	LspPosition lsp_pos;
+	LspPosition lsp_pos = {0, 0};
+	LspField fields[] = {
+		{"character", LspFieldInt64, &lsp_pos.character},
+		{"line", LspFieldInt64, &lsp_pos.line}
+	};
 
-	JSONRPC_MESSAGE_PARSE(variant,
-		"character", JSONRPC_MESSAGE_GET_INT64(&lsp_pos.character),
-		"line", JSONRPC_MESSAGE_GET_INT64(&lsp_pos.line));
+	lsp_utils_parse_fields(variant, fields, G_N_ELEMENTS(fields));
 
 	return lsp_pos;
 }
@@ -288,16 +399,22 @@ LspPosition lsp_utils_parse_pos(GVariant *variant)
 LspRange lsp_utils_parse_range(GVariant *variant)
 {
 	LspRange range;
+	GVariant *start = NULL;
+	GVariant *end = NULL;
+	LspField fields[] = {
+		{"start", LspFieldVariant, &start},
+		{"end", LspFieldVariant, &end}
+	};
+
+	lsp_utils_parse_fields(variant, fields, G_N_ELEMENTS(fields));
 
-	JSONRPC_MESSAGE_PARSE(variant,
-		"start", "{",
-			"character", JSONRPC_MESSAGE_GET_INT64(&range.start.character),
-			"line", JSONRPC_MESSAGE_GET_INT64(&range.start.line),
-		"}",
-		"end", "{",
-			"character", JSONRPC_MESSAGE_GET_INT64(&range.end.character),
-			"line", JSONRPC_MESSAGE_GET_INT64(&range.end.line),
-		"}");
+	range.start = lsp_utils_parse_pos(start);
+	range.end = lsp_utils_parse_pos(end);
+
+	if (start)
+		g_variant_unref(start);
+	if (end)
+		g_variant_unref(end);
 
 	return range;
 }
@@ -417,96 +534,6 @@ void lsp_utils_apply_text_edits(ScintillaObject *sci, LspTextEdit *edit, GPtrArr
 }
 
 
-static void apply_edits_in_file(const gchar *uri, GPtrArray *edits)
-{
-	gchar *fname = lsp_utils_get_real_path_from_uri_utf8(uri);
-	gchar *fname_locale = lsp_utils_get_real_path_from_uri_locale(uri);
-
-	if (fname && fname_locale)
-	{
-		GeanyDocument *doc = document_find_by_filename(fname);
-		ScintillaObject *sci = NULL;
-
-		if (doc)
-			sci = doc->editor->sci;
-		else
-			sci = lsp_utils_new_sci_from_file(fname);
-
-		sci_start_undo_action(sci);
-		lsp_utils_apply_text_edits(sci, NULL, edits);
-		sci_end_undo_action(sci);
-
-		if (doc)
-			// clangd rename doesn't refresh the file when not saved after the operation
-			document_save_file(doc, FALSE);
-		else
-		{
-			gchar *contents = sci_get_contents(sci, -1);
-
-			g_file_set_contents(fname, contents, -1, NULL);
-
-#if 0
-			GVariant *node;
-			node = JSONRPC_MESSAGE_NEW (
-				"changes", "[", "{",
-					"uri", JSONRPC_MESSAGE_PUT_STRING(uri),
-					"type", JSONRPC_MESSAGE_PUT_INT32(2),  //changed
-				"}", "]"
-			);
-
-			lsp_client_notify(srv, "workspace/didChangeWatchedFiles", node, NULL, NULL);
-			g_variant_unref(node);
-#endif
-
-			g_free(contents);
-			g_object_ref_sink(sci);
-			g_object_unref(sci);
-		}
-	}
-	g_free(fname);
-	g_free(fname_locale);
-}
-
-
-gboolean lsp_utils_apply_workspace_edit(GVariant *workspace_edit)
-{
-	GVariant *changes = NULL;
-	gboolean ret = FALSE;
-
-	JSONRPC_MESSAGE_PARSE(workspace_edit,
-		"changes", JSONRPC_MESSAGE_GET_VARIANT(&changes)
-		);
-
-	if (changes && g_variant_is_of_type(changes, G_VARIANT_TYPE("a{sv}")))
-	{
-		GVariantIter iter;
-		GVariant *text_edits;
-		gchar *uri;
-
-		g_variant_iter_init(&iter, changes);
-		while (g_variant_iter_loop(&iter, "{sv}", &uri, &text_edits))
-		{
-			GVariantIter iter2;
-			GPtrArray *edits;
-
-			g_variant_iter_init(&iter2, text_edits);
-
-			edits = lsp_utils_parse_text_edits(&iter2);
-			apply_edits_in_file(uri,  edits);
-
-			g_ptr_array_free(edits, TRUE);
-		}
-
-		ret = TRUE;
-	}
-
-	if (changes)
-		g_variant_unref(changes);
-
-	return ret;
-}
-
-
 void lsp_utils_free_lsp_location(LspLocation *e)
 {
 	if (!e)
@@ -654,13 +681,16 @@ ScintillaObject *lsp_utils_new_sci_from_file(const gchar *utf8_fname)
 }
 
 
-gchar *lsp_utils_get_current_iden(GeanyDocument *doc, gint current_pos)
+/* Sets start_pos and end_pos to the bounds of the identifier at current_pos,
+ * returns FALSE when there is none. */
+gboolean lsp_utils_get_current_iden_bounds(GeanyDocument *doc, gint current_pos,
+	gint *start_pos, gint *end_pos)
 {
 	//TODO: use configured wordchars (also change in Geany)
 	const gchar *wordchars = GEANY_WORDCHARS;
 	GeanyFiletypeID ft = doc->file_type->id;
 	ScintillaObject *sci = doc->editor->sci;
-	gint start_pos, end_pos, pos;
+	gint pos;
 
 	if (ft == GEANY_FILETYPES_LATEX)
 		wordchars = GEANY_WORDCHARS"\\"; /* add \ to word chars if we are in a LaTeX file */
@@ -681,7 +711,7 @@ gchar *lsp_utils_get_current_iden(GeanyDocument *doc, gint current_pos)
 		}
 		pos = new_pos;
 	}
-	start_pos = pos;
+	*start_pos = pos;
 
 	pos = current_pos;
 	while (TRUE)
@@ -697,12 +727,20 @@ gchar *lsp_utils_get_current_iden(GeanyDocument *doc, gint current_pos)
 		}
 		pos = new_pos;
 	}
-	end_pos = pos;
+	*end_pos = pos;
+
+	return *start_pos != *end_pos;
+}
+
+
+gchar *lsp_utils_get_current_iden(GeanyDocument *doc, gint current_pos)
+{
+	gint start_pos, end_pos;
 
-	if (start_pos == end_pos)
+	if (!lsp_utils_get_current_iden_bounds(doc, current_pos, &start_pos, &end_pos))
 		return NULL;
 
-	return sci_get_contents_range(sci, start_pos, end_pos);
+	return sci_get_contents_range(doc->editor->sci, start_pos, end_pos);
 }
 
 
@@ -60,9 +60,28 @@ typedef struct
 } LspLocation;
 
 
+typedef enum
+{
+	LspFieldString,  // const gchar *, points into the parsed message
+	LspFieldInt64,  // gint64
+	LspFieldVariant,  // GVariant *, to be unreffed
+	LspFieldIter  // GVariantIter *, to be freed
+} LspFieldType;
+
+
+typedef struct
+{
+	const gchar *name;
+	LspFieldType type;
+	gpointer value;  // where the value is stored, left unchanged when missing
+} LspField;
+
+
 void lsp_utils_free_lsp_text_edit(LspTextEdit *e);
 void lsp_utils_free_lsp_location(LspLocation *e);
 
+void lsp_utils_pos_cache_attach(ScintillaObject *sci);
+
 LspPosition lsp_utils_scintilla_pos_to_lsp(ScintillaObject *sci, gint sci_pos);
 gint lsp_utils_lsp_pos_to_scintilla(ScintillaObject *sci, LspPosition lsp_pos);
 
@@ -83,6 +102,8 @@ const gchar *lsp_utils_get_config_filename(void);
 
 gboolean lsp_utils_is_lsp_disabled_for_project(void);
 
+guint lsp_utils_parse_fields(GVariant *variant, LspField *fields, guint field_num);
+
 LspPosition lsp_utils_parse_pos(GVariant *variant);
 LspRange lsp_utils_parse_range(GVariant *variant);
 
@@ -94,7 +115,6 @@ GPtrArray *lsp_utils_parse_locations(GVariantIter *iter);
 
 void lsp_utils_apply_text_edit(ScintillaObject *sci, LspTextEdit *e, gboolean update_pos);
 void lsp_utils_apply_text_edits(ScintillaObject *sci, LspTextEdit *edit, GPtrArray *edits);
-gboolean lsp_utils_apply_workspace_edit(GVariant *workspace_edit);
 
 gboolean lsp_utils_wrap_string(gchar *string, gint wrapstart);
 
@@ -102,6 +122,8 @@ GVariant *lsp_utils_parse_json_file(const gchar *utf8_fname);
 
 ScintillaObject *lsp_utils_new_sci_from_file(const gchar *utf8_fname);
 
+gboolean lsp_utils_get_current_iden_bounds(GeanyDocument *doc, gint current_pos,
+	gint *start_pos, gint *end_pos);
 gchar *lsp_utils_get_current_iden(GeanyDocument *doc, gint current_pos);
 
 gint lsp_utils_set_indicator_style(ScintillaObject *sci, const gchar *style_str);
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+/* Keeps the last semantic tokens and document symbols of documents on disk so
+ * they can be shown as soon as the document is opened in the next session,
+ * long before the server finishes indexing. The data is only used when the
+ * document has the same contents as when it was stored. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-warm-cache.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+
+// files not used for this long are removed
+#define MAX_AGE_DAYS 30
+
+
+static gchar *cache_dir = NULL;
+
+
+static gchar *get_content_hash(GeanyDocument *doc)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	const guchar *text = (const guchar *) SSM(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+
+	return g_compute_checksum_for_data(G_CHECKSUM_SHA256, text, sci_get_length(sci));
+}
+
+
+/* Token types and symbol kinds depend on the server so each server gets its
+ * own file for the document. */
+static gchar *get_cache_file(GeanyDocument *doc, const gchar *kind)
+{
+	LspServerConfig *cfg = lsp_server_get_config(doc);
+	gchar *key, *hash, *fname, *path;
+
+	key = g_strconcat(cfg->cmd ? cfg->cmd : "", "\n", doc->real_path, NULL);
+	hash = g_compute_checksum_for_string(G_CHECKSUM_SHA256, key, -1);
+	fname = g_strconcat(hash, ".", kind, NULL);
+	path = g_build_filename(cache_dir, fname, NULL);
+
+	g_free(fname);
+	g_free(hash);
+	g_free(key);
+
+	return path;
+}
+
+
+static gboolean is_enabled(GeanyDocument *doc)
+{
+	LspServerConfig *cfg = lsp_server_get_config(doc);
+
+	return cache_dir && cfg && cfg->warm_cache_enable && doc->real_path;
+}
+
+
+/* Returns the data stored for doc by lsp_warm_cache_store() if they are of
+ * the given type and doc still has the same contents, NULL otherwise. */
+GVariant *lsp_warm_cache_load(GeanyDocument *doc, const gchar *kind, const GVariantType *type)
+{
+	GVariant *file_variant, *data = NULL;
+	const gchar *hash = NULL;
+	gchar *contents, *path;
+	gsize len;
+
+	if (!is_enabled(doc))
+		return NULL;
+
+	path = get_cache_file(doc, kind);
+	if (!g_file_get_contents(path, &contents, &len, NULL))
+	{
+		g_free(path);
+		return NULL;
+	}
+
+	// the file may be corrupted - GVariant checks serialized data of untrusted sources
+	file_variant = g_variant_new_from_data(G_VARIANT_TYPE("(sv)"), contents, len, FALSE,
+		g_free, contents);
+	g_variant_ref_sink(file_variant);
+	g_variant_get(file_variant, "(&sv)", &hash, &data);
+
+	if (!g_variant_is_of_type(data, type))
+	{
+		g_variant_unref(data);
+		data = NULL;
+	}
+	else
+	{
+		gchar *content_hash = get_content_hash(doc);
+
+		if (g_strcmp0(hash, content_hash) != 0)
+		{
+			g_variant_unref(data);
+			data = NULL;
+		}
+		g_free(content_hash);
+	}
+
+	// mark the file as used
+	if (data)
+		g_utime(path, NULL);
+
+	g_variant_unref(file_variant);
+	g_free(path);
+
+	return data;
+}
+
+
+/* Stores data for the current contents of doc, data may be floating. */
+void lsp_warm_cache_store(GeanyDocument *doc, const gchar *kind, GVariant *data)
+{
+	GVariant *file_variant;
+	gchar *content_hash, *path;
+
+	g_variant_ref_sink(data);
+
+	if (!is_enabled(doc) || g_mkdir_with_parents(cache_dir, 0700) != 0)
+	{
+		g_variant_unref(data);
+		return;
+	}
+
+	content_hash = get_content_hash(doc);
+	file_variant = g_variant_ref_sink(g_variant_new("(sv)", content_hash, data));
+	path = get_cache_file(doc, kind);
+
+	g_file_set_contents(path, g_variant_get_data(file_variant),
+		g_variant_get_size(file_variant), NULL);
+
+	g_free(path);
+	g_variant_unref(file_variant);
+	g_free(content_hash);
+	g_variant_unref(data);
+}
+
+
+static void remove_old_files(void)
+{
+	gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+	const gchar *name;
+	GDir *dir;
+
+	dir = g_dir_open(cache_dir, 0, NULL);
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name(dir)))
+	{
+		gchar *path = g_build_filename(cache_dir, name, NULL);
+		GStatBuf st;
+
+		if (g_stat(path, &st) == 0 && now - st.st_mtime > MAX_AGE_DAYS * 24 * 60 * 60)
+			g_unlink(path);
+		g_free(path);
+	}
+
+	g_dir_close(dir);
+}
+
+
+void lsp_warm_cache_init(void)
+{
+	if (cache_dir)
+		return;
+
+	cache_dir = g_build_filename(g_get_user_cache_dir(), "geany", "lsp", NULL);
+	remove_old_files();
+}
+
+
+void lsp_warm_cache_destroy(void)
+{
+	g_free(cache_dir);
+	cache_dir = NULL;
+}
@@ -0,0 +1,436 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "lsp/lsp-workspace-edit.h"
+#include "lsp/lsp-utils.h"
+#include "lsp/lsp-server.h"
+#include "lsp/lsp-sync.h"
+
+#include <jsonrpc-glib.h>
+#include <string.h>
+
+
+static gint sort_edits(gconstpointer a, gconstpointer b)
+{
+	LspTextEdit *e1 = *((LspTextEdit **)a);
+	LspTextEdit *e2 = *((LspTextEdit **)b);
+
+	if (e1->range.start.line != e2->range.start.line)
+		return e1->range.start.line > e2->range.start.line ? 1 : -1;
+	if (e1->range.start.character != e2->range.start.character)
+		return e1->range.start.character > e2->range.start.character ? 1 : -1;
+	return 0;
+}
+
+
+// the sort is stable so inserts at the same position keep the order
+// in which the server sent them
+static GPtrArray *get_sorted_edits(GPtrArray *edits)
+{
+	GPtrArray *arr = g_ptr_array_sized_new(edits->len);
+	guint i;
+
+	for (i = 0; i < edits->len; i++)
+		g_ptr_array_add(arr, edits->pdata[i]);
+	g_ptr_array_sort(arr, sort_edits);
+
+	return arr;
+}
+
+
+/* Applies the edits to an open document. Every edit becomes a single target
+ * replacement and the changes are recorded for the server directly instead of
+ * going through the SCN_MODIFIED handler which would produce a separate
+ * deletion and insertion for each of them. */
+static void apply_edits_in_doc(GeanyDocument *doc, GPtrArray *edits)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	LspServer *srv = lsp_server_get_if_running(doc);
+	GPtrArray *arr = get_sorted_edits(edits);
+	guint i;
+
+	// send the original document first if the server doesn't have it yet
+	if (srv && doc->real_path && !lsp_sync_is_document_open(doc))
+		lsp_sync_text_document_did_open(srv, doc);
+	if (srv && !lsp_sync_is_document_open(doc))
+		srv = NULL;
+
+	lsp_sync_suspend_changes(doc, TRUE);
+	sci_start_undo_action(sci);
+
+	// edits are applied from the end so ranges of the remaining ones stay valid
+	for (i = arr->len; i > 0; i--)
+	{
+		LspTextEdit *e = arr->pdata[i - 1];
+		gint start_pos = lsp_utils_lsp_pos_to_scintilla(sci, e->range.start);
+		gint end_pos = lsp_utils_lsp_pos_to_scintilla(sci, e->range.end);
+
+		if (srv && srv->use_incremental_sync)
+		{
+			// positions clamped to the document, before the replacement
+			LspPosition pos_start = lsp_utils_scintilla_pos_to_lsp(sci, start_pos);
+			LspPosition pos_end = lsp_utils_scintilla_pos_to_lsp(sci, end_pos);
+
+			lsp_sync_text_document_did_change(srv, doc, pos_start, pos_end, e->new_text);
+		}
+
+		SSM(sci, SCI_SETTARGETRANGE, start_pos, end_pos);
+		SSM(sci, SCI_REPLACETARGET, -1, (sptr_t) e->new_text);
+	}
+
+	sci_end_undo_action(sci);
+	lsp_sync_suspend_changes(doc, FALSE);
+
+	if (srv)
+	{
+		if (!srv->use_incremental_sync)
+		{
+			LspPosition pos = {0, 0};
+			lsp_sync_text_document_did_change(srv, doc, pos, pos, NULL);
+		}
+		// all the edits go to the server in a single didChange
+		lsp_sync_flush_doc_changes(doc);
+	}
+
+	g_ptr_array_free(arr, TRUE);
+}
+
+
+static gsize line_end_offset(const gchar *contents, gsize len, gsize offset)
+{
+	while (offset < len && contents[offset] != '\n' && contents[offset] != '\r')
+		offset++;
+	return offset;
+}
+
+
+static gsize lsp_pos_to_offset(const gchar *contents, gsize len, GArray *line_starts,
+	LspPosition lsp_pos)
+{
+	gsize offset, line_end;
+	gint64 units = 0;
+
+	if (lsp_pos.line < 0)
+		return 0;
+	if ((guint64)lsp_pos.line >= line_starts->len)
+		return len;
+
+	offset = g_array_index(line_starts, gsize, lsp_pos.line);
+	line_end = line_end_offset(contents, len, offset);
+
+	// character is in UTF-16 code units - characters outside the BMP take two
+	while (offset < line_end && units < lsp_pos.character)
+	{
+		gunichar c = g_utf8_get_char(contents + offset);
+
+		units += c >= 0x10000 ? 2 : 1;
+		offset = g_utf8_next_char(contents + offset) - contents;
+	}
+
+	return MIN(offset, line_end);
+}
+
+
+static GArray *get_line_starts(const gchar *contents, gsize len)
+{
+	GArray *line_starts = g_array_new(FALSE, FALSE, sizeof(gsize));
+	gsize offset = 0;
+
+	g_array_append_val(line_starts, offset);
+	while ((offset = line_end_offset(contents, len, offset)) < len)
+	{
+		if (contents[offset] == '\r' && offset + 1 < len && contents[offset + 1] == '\n')
+			offset++;
+		offset++;
+		g_array_append_val(line_starts, offset);
+	}
+
+	return line_starts;
+}
+
+
+/* Applies the edits to a file which isn't open in Geany directly in its
+ * contents so no document or Scintilla widget has to be created for it.
+ * Doesn't touch any GTK or Geany state so it can run in a worker thread;
+ * on failure, error_msg is set to a message for the status window. */
+static gboolean apply_edits_on_disk(const gchar *fname_locale, const gchar *fname,
+	GPtrArray *edits, gchar **error_msg)
+{
+	GError *error = NULL;
+	gboolean success;
+	GArray *line_starts;
+	GPtrArray *arr;
+	GString *out;
+	gchar *contents;
+	gsize len, prev = 0;
+	GFile *file;
+	guint i;
+
+	if (!g_file_get_contents(fname_locale, &contents, &len, &error))
+	{
+		*error_msg = g_strdup_printf("Failed to read %s: %s", fname, error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	if (!g_utf8_validate(contents, len, NULL))
+	{
+		*error_msg = g_strdup_printf("Not applying LSP edits to %s: file is not UTF-8 encoded", fname);
+		g_free(contents);
+		return FALSE;
+	}
+
+	arr = get_sorted_edits(edits);
+	line_starts = get_line_starts(contents, len);
+	out = g_string_sized_new(len);
+
+	for (i = 0; i < arr->len; i++)
+	{
+		LspTextEdit *e = arr->pdata[i];
+		gsize start = lsp_pos_to_offset(contents, len, line_starts, e->range.start);
+		gsize end = lsp_pos_to_offset(contents, len, line_starts, e->range.end);
+
+		// edits are non-overlapping by the LSP specs but don't trust servers too much
+		start = MAX(start, prev);
+		end = MAX(end, start);
+
+		g_string_append_len(out, contents + prev, start - prev);
+		g_string_append(out, e->new_text);
+		prev = end;
+	}
+	g_string_append_len(out, contents + prev, len - prev);
+
+	// written into a temporary file first and renamed over the original
+	file = g_file_new_for_path(fname_locale);
+	success = g_file_replace_contents(file, out->str, out->len, NULL, FALSE,
+		G_FILE_CREATE_NONE, NULL, NULL, &error);
+	if (!success)
+	{
+		*error_msg = g_strdup_printf("Failed to write %s: %s", fname, error->message);
+		g_error_free(error);
+	}
+
+	g_object_unref(file);
+	g_string_free(out, TRUE);
+	g_array_free(line_starts, TRUE);
+	g_ptr_array_free(arr, TRUE);
+	g_free(contents);
+
+	return success;
+}
+
+
+typedef struct
+{
+	GPtrArray *files;  // LspFileEdits
+	GPtrArray *unopened;  // files not open in Geany, owned by files
+	GPtrArray *errors;
+	GCallback on_done;
+} ApplyJob;
+
+
+static void file_edits_free(LspFileEdits *file)
+{
+	g_free(file->fname);
+	g_free(file->fname_locale);
+	g_ptr_array_free(file->edits, TRUE);
+	g_free(file);
+}
+
+
+/* Returns the edits of workspace_edit grouped by file without opening any of
+ * the files, or NULL when it contains no changes. */
+GPtrArray *lsp_workspace_edit_parse(GVariant *workspace_edit)
+{
+	GVariant *changes = NULL;
+	GPtrArray *files = NULL;
+
+	JSONRPC_MESSAGE_PARSE(workspace_edit,
+		"changes", JSONRPC_MESSAGE_GET_VARIANT(&changes)
+		);
+
+	if (changes && g_variant_is_of_type(changes, G_VARIANT_TYPE("a{sv}")))
+	{
+		GVariantIter iter;
+		GVariant *text_edits;
+		gchar *uri;
+
+		files = g_ptr_array_new_with_free_func((GDestroyNotify)file_edits_free);
+
+		g_variant_iter_init(&iter, changes);
+		while (g_variant_iter_loop(&iter, "{sv}", &uri, &text_edits))
+		{
+			gchar *fname = lsp_utils_get_real_path_from_uri_utf8(uri);
+			gchar *fname_locale = lsp_utils_get_real_path_from_uri_locale(uri);
+			GVariantIter iter2;
+			GPtrArray *edits;
+
+			g_variant_iter_init(&iter2, text_edits);
+			edits = lsp_utils_parse_text_edits(&iter2);
+
+			if (fname && fname_locale && edits->len > 0)
+			{
+				LspFileEdits *file = g_new0(LspFileEdits, 1);
+
+				file->fname = fname;
+				file->fname_locale = fname_locale;
+				file->edits = edits;
+				file->is_open = document_find_by_filename(fname) != NULL;
+				g_ptr_array_add(files, file);
+			}
+			else
+			{
+				g_ptr_array_free(edits, TRUE);
+				g_free(fname);
+				g_free(fname_locale);
+			}
+		}
+	}
+
+	if (changes)
+		g_variant_unref(changes);
+
+	return files;
+}
+
+
+/* Applies the edits of the open documents and returns the files not open
+ * in Geany, still owned by files. */
+static GPtrArray *apply_edits_in_docs(GPtrArray *files)
+{
+	GPtrArray *unopened = g_ptr_array_new();
+	guint i;
+
+	for (i = 0; i < files->len; i++)
+	{
+		LspFileEdits *file = files->pdata[i];
+		GeanyDocument *doc = document_find_by_filename(file->fname);
+
+		if (doc)
+		{
+			apply_edits_in_doc(doc, file->edits);
+			// clangd rename doesn't refresh the file when not saved after the operation
+			document_save_file(doc, FALSE);
+		}
+		else
+			g_ptr_array_add(unopened, file);
+	}
+
+	return unopened;
+}
+
+
+gboolean lsp_workspace_edit_apply(GVariant *workspace_edit)
+{
+	GPtrArray *files = lsp_workspace_edit_parse(workspace_edit);
+	GPtrArray *unopened;
+	guint i;
+
+	if (!files)
+		return FALSE;
+
+	unopened = apply_edits_in_docs(files);
+	for (i = 0; i < unopened->len; i++)
+	{
+		LspFileEdits *file = unopened->pdata[i];
+		gchar *error_msg = NULL;
+
+		if (!apply_edits_on_disk(file->fname_locale, file->fname, file->edits, &error_msg))
+		{
+			msgwin_status_add("%s", error_msg);
+			g_free(error_msg);
+		}
+	}
+
+	g_ptr_array_free(unopened, TRUE);
+	g_ptr_array_free(files, TRUE);
+
+	return TRUE;
+}
+
+
+static gboolean apply_done_idle(gpointer user_data)
+{
+	ApplyJob *job = user_data;
+	guint i;
+
+	for (i = 0; i < job->errors->len; i++)
+		msgwin_status_add("%s", (gchar *)job->errors->pdata[i]);
+	if (job->unopened->len > 0)
+		msgwin_status_add("LSP edits applied to %u files not open in the editor",
+			job->unopened->len - job->errors->len);
+
+	if (job->on_done)
+		job->on_done();
+
+	g_ptr_array_free(job->errors, TRUE);
+	g_ptr_array_free(job->unopened, TRUE);
+	g_ptr_array_free(job->files, TRUE);
+	g_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+static gpointer apply_thread(gpointer user_data)
+{
+	ApplyJob *job = user_data;
+	guint i;
+
+	// one file in memory at a time
+	for (i = 0; i < job->unopened->len; i++)
+	{
+		LspFileEdits *file = job->unopened->pdata[i];
+		gchar *error_msg = NULL;
+
+		if (!apply_edits_on_disk(file->fname_locale, file->fname, file->edits, &error_msg))
+			g_ptr_array_add(job->errors, error_msg);
+	}
+
+	g_idle_add(apply_done_idle, job);
+
+	return NULL;
+}
+
+
+/* Applies the edits of the files returned by lsp_workspace_edit_parse() and
+ * takes their ownership. Open documents are edited immediately, the remaining
+ * files are rewritten by a worker thread and on_done is called once all of
+ * them are written. */
+void lsp_workspace_edit_apply_files(GPtrArray *files, GCallback on_done)
+{
+	ApplyJob *job = g_new0(ApplyJob, 1);
+
+	job->files = files;
+	job->unopened = apply_edits_in_docs(files);
+	job->errors = g_ptr_array_new_with_free_func(g_free);
+	job->on_done = on_done;
+
+	if (job->unopened->len == 0)
+	{
+		apply_done_idle(job);
+		return;
+	}
+
+	msgwin_status_add("Applying LSP edits to %u files not open in the editor",
+		job->unopened->len);
+	g_thread_unref(g_thread_new("lsp-workspace-edit", apply_thread, job));
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2023 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LSP_WORKSPACE_EDIT_H
+#define LSP_WORKSPACE_EDIT_H 1
+
+#include "lsp/lsp-server.h"
+
+#include <glib.h>
+
+typedef struct
+{
+	gchar *fname;
+	gchar *fname_locale;
+	GPtrArray *edits;  // LspTextEdit
+	gboolean is_open;
+} LspFileEdits;
+
+
+gboolean lsp_workspace_edit_apply(GVariant *workspace_edit);
+
+GPtrArray *lsp_workspace_edit_parse(GVariant *workspace_edit);
+void lsp_workspace_edit_apply_files(GPtrArray *files, GCallback on_done);
+
+#endif  /* LSP_WORKSPACE_EDIT_H */
@@ -111,6 +111,16 @@ const FontHandle *PFont(const Font *f) noexcept {
 	return dynamic_cast<const FontHandle *>(f);
 }
 
+// Measuring context and layout reused by the measurements of a thread as creating
+// them for each measured segment took more time than the measuring itself.
+// Measuring may run on several threads at once so each has its own.
+struct MeasuringCache {
+	UniquePangoContext context;
+	UniquePangoLayout layout;
+};
+
+thread_local MeasuringCache measuringCache;
+
 }
 
 std::shared_ptr<Font> Font::Allocate(const FontParameters &fp) {
@@ -152,6 +162,7 @@ public:
 
 	void GetContextState() noexcept;
 	UniquePangoContext MeasuringContext();
+	PangoLayout *MeasuringLayout();
 
 	void Init(WindowID wid) override;
 	void Init(SurfaceID sid, WindowID wid) override;
@@ -374,6 +385,29 @@ UniquePangoContext SurfaceImpl::MeasuringContext() {
 	return contextMeasure;
 }
 
+PangoLayout *SurfaceImpl::MeasuringLayout() {
+	MeasuringCache &cache = measuringCache;
+	if (cache.context) {
+		PangoContext *contextMeasure = cache.context.get();
+		const cairo_font_options_t *options = pango_cairo_context_get_font_options(contextMeasure);
+		const bool sameOptions = (options && fontOptions) ?
+			cairo_font_options_equal(options, fontOptions) : options == fontOptions;
+		if (!sameOptions ||
+			(pango_context_get_font_map(contextMeasure) != pango_cairo_font_map_get_default()) ||
+			(pango_cairo_context_get_resolution(contextMeasure) != resolution) ||
+			(pango_context_get_base_dir(contextMeasure) != direction) ||
+			(pango_context_get_language(contextMeasure) != language)) {
+			cache.layout.reset();
+			cache.context.reset();
+		}
+	}
+	if (!cache.context) {
+		cache.context = MeasuringContext();
+		cache.layout.reset(pango_layout_new(cache.context.get()));
+	}
+	return cache.layout.get();
+}
+
 void SurfaceImpl::Init(WindowID wid) {
 	widSave = wid;
 	Release();
@@ -869,18 +903,17 @@ void EquallySpaced(PangoLayout *layout, XYPOSITION *positions, size_t lenPositio
 
 void SurfaceImpl::MeasureWidths(const Font *font_, std::string_view text, XYPOSITION *positions) {
 	if (PFont(font_)->fd) {
-		UniquePangoContext contextMeasure = MeasuringContext();
-		UniquePangoLayout layoutMeasure(pango_layout_new(contextMeasure.get()));
+		PangoLayout *layoutMeasure = MeasuringLayout();
 		PLATFORM_ASSERT(layoutMeasure);
 
-		pango_layout_set_font_description(layoutMeasure.get(), PFont(font_)->fd.get());
+		pango_layout_set_font_description(layoutMeasure, PFont(font_)->fd.get());
 		if (et == EncodingType::utf8) {
 			// Simple and direct as UTF-8 is native Pango encoding
-			ClusterIterator iti(layoutMeasure.get(), text);
+			ClusterIterator iti(layoutMeasure, text);
 			int i = iti.curIndex;
 			if (i != 0) {
 				// Unexpected start to iteration, could be bidirectional text
-				EquallySpaced(layoutMeasure.get(), positions, text.length());
+				EquallySpaced(layoutMeasure, positions, text.length());
 				return;
 			}
 			while (!iti.finished) {
@@ -927,11 +960,11 @@ void SurfaceImpl::MeasureWidths(const Font *font_, std::string_view text, XYPOSI
 					// character byte lengths.
 					Converter convMeasure("UCS-2", charSetID, false);
 					int i = 0;
-					ClusterIterator iti(layoutMeasure.get(), utfForm);
+					ClusterIterator iti(layoutMeasure, utfForm);
 					int clusterStart = iti.curIndex;
 					if (clusterStart != 0) {
 						// Unexpected start to iteration, could be bidirectional text
-						EquallySpaced(layoutMeasure.get(), positions, text.length());
+						EquallySpaced(layoutMeasure, positions, text.length());
 						return;
 					}
 					while (!iti.finished) {
@@ -966,11 +999,11 @@ void SurfaceImpl::MeasureWidths(const Font *font_, std::string_view text, XYPOSI
 				size_t i = 0;
 				// Each 8-bit input character may take 1 or 2 bytes in UTF-8
 				// and groups of up to 3 may be represented as ligatures.
-				ClusterIterator iti(layoutMeasure.get(), utfForm);
+				ClusterIterator iti(layoutMeasure, utfForm);
 				int clusterStart = iti.curIndex;
 				if (clusterStart != 0) {
 					// Unexpected start to iteration, could be bidirectional text
-					EquallySpaced(layoutMeasure.get(), positions, lenPositions);
+					EquallySpaced(layoutMeasure, positions, lenPositions);
 					return;
 				}
 				while (!iti.finished) {
@@ -983,7 +1016,7 @@ void SurfaceImpl::MeasureWidths(const Font *font_, std::string_view text, XYPOSI
 #ifdef DEBUG
 						fprintf(stderr, "MeasureWidths: result too long.\n");
 #endif
-						EquallySpaced(layoutMeasure.get(), positions, lenPositions);
+						EquallySpaced(layoutMeasure, positions, lenPositions);
 						return;
 					}
 					PLATFORM_ASSERT(ligatureLength > 0 && ligatureLength <= 3);
@@ -1070,17 +1103,16 @@ void SurfaceImpl::DrawTextTransparentUTF8(PRectangle rc, const Font *font_, XYPO
 
 void SurfaceImpl::MeasureWidthsUTF8(const Font *font_, std::string_view text, XYPOSITION *positions) {
 	if (PFont(font_)->fd) {
-		UniquePangoContext contextMeasure = MeasuringContext();
-		UniquePangoLayout layoutMeasure(pango_layout_new(contextMeasure.get()));
+		PangoLayout *layoutMeasure = MeasuringLayout();
 		PLATFORM_ASSERT(layoutMeasure);
 
-		pango_layout_set_font_description(layoutMeasure.get(), PFont(font_)->fd.get());
+		pango_layout_set_font_description(layoutMeasure, PFont(font_)->fd.get());
 		// Simple and direct as UTF-8 is native Pango encoding
-		ClusterIterator iti(layoutMeasure.get(), text);
+		ClusterIterator iti(layoutMeasure, text);
 		int i = iti.curIndex;
 		if (i != 0) {
 			// Unexpected start to iteration, could be bidirectional text
-			EquallySpaced(layoutMeasure.get(), positions, text.length());
+			EquallySpaced(layoutMeasure, positions, text.length());
 			return;
 		}
 		while (!iti.finished) {
@@ -1177,8 +1209,7 @@ void Window::Destroy() noexcept {
 		ListBox *listbox = dynamic_cast<ListBox *>(this);
 		if (listbox) {
 			gtk_widget_hide(GTK_WIDGET(wid));
-			// clear up window content
-			listbox->Clear();
+			// the rows are kept to be replaced in place by the next SetList
 			// resize the window to the smallest possible size for it to adapt
 			// to future content
 			gtk_window_resize(GTK_WINDOW(wid), 1, 1);
@@ -1400,6 +1431,7 @@ class ListBoxX : public ListBox {
 #if GTK_CHECK_VERSION(3,0,0)
 	std::unique_ptr<GtkCssProvider, GObjectReleaser> cssProvider;
 #endif
+	void SetRow(GtkListStore *store, GtkTreeIter *iter, const char *s, int type);
 public:
 	IListBoxDelegate *delegate;
 
@@ -1869,44 +1901,44 @@ static void init_pixmap(ListImage *list_image) noexcept {
 
 #define SPACING 5
 
-void ListBoxX::Append(char *s, int type) {
+void ListBoxX::SetRow(GtkListStore *store, GtkTreeIter *iter, const char *s, int type) {
 	ListImage *list_image = nullptr;
 	if ((type >= 0) && pixhash) {
 		list_image = static_cast<ListImage *>(g_hash_table_lookup(pixhash,
 						      GINT_TO_POINTER(type)));
 	}
-	GtkTreeIter iter {};
-	GtkListStore *store =
-		GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(list)));
-	gtk_list_store_append(GTK_LIST_STORE(store), &iter);
+	GdkPixbuf *pixbuf = nullptr;
 	if (list_image) {
 		if (nullptr == list_image->pixbuf)
 			init_pixmap(list_image);
-		if (list_image->pixbuf) {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
-					   PIXBUF_COLUMN, list_image->pixbuf,
-					   TEXT_COLUMN, s, -1);
-
-			const gint pixbuf_width = gdk_pixbuf_get_width(list_image->pixbuf);
-			gint renderer_height, renderer_width;
-			gtk_cell_renderer_get_fixed_size(pixbuf_renderer,
-							 &renderer_width, &renderer_height);
-			if (pixbuf_width > renderer_width)
-				gtk_cell_renderer_set_fixed_size(pixbuf_renderer,
-								 pixbuf_width, -1);
-		} else {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
-					   TEXT_COLUMN, s, -1);
-		}
-	} else {
-		gtk_list_store_set(GTK_LIST_STORE(store), &iter,
-				   TEXT_COLUMN, s, -1);
+		pixbuf = list_image->pixbuf;
+	}
+	// Always set the pixbuf as the row may be reused from a previous list
+	gtk_list_store_set(store, iter,
+			   PIXBUF_COLUMN, pixbuf,
+			   TEXT_COLUMN, s, -1);
+	if (pixbuf) {
+		const gint pixbuf_width = gdk_pixbuf_get_width(pixbuf);
+		gint renderer_height, renderer_width;
+		gtk_cell_renderer_get_fixed_size(pixbuf_renderer,
+						 &renderer_width, &renderer_height);
+		if (pixbuf_width > renderer_width)
+			gtk_cell_renderer_set_fixed_size(pixbuf_renderer,
+							 pixbuf_width, -1);
 	}
 	const unsigned int len = static_cast<unsigned int>(strlen(s));
 	if (maxItemCharacters < len)
 		maxItemCharacters = len;
 }
 
+void ListBoxX::Append(char *s, int type) {
+	GtkTreeIter iter {};
+	GtkListStore *store =
+		GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(list)));
+	gtk_list_store_append(store, &iter);
+	SetRow(store, &iter, s, type);
+}
+
 int ListBoxX::Length() {
 	if (wid)
 		return gtk_tree_model_iter_n_children(gtk_tree_view_get_model
@@ -2068,7 +2100,25 @@ void ListBoxX::SetDelegate(IListBoxDelegate *lbDelegate) {
 }
 
 void ListBoxX::SetList(const char *listText, char separator, char typesep) {
-	Clear();
+	// Replace the rows of the previous list in place and only add or remove the
+	// difference, with the model detached so the tree view doesn't process each
+	// row change. Lists are set again for each character typed.
+	GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(list));
+	GtkListStore *store = GTK_LIST_STORE(model);
+	g_object_ref(model);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(list), nullptr);
+	maxItemCharacters = 0;
+
+	GtkTreeIter iter {};
+	bool reuse = gtk_tree_model_get_iter_first(model, &iter);
+	auto setWord = [&](const char *word, int type) {
+		if (!reuse)
+			gtk_list_store_append(store, &iter);
+		SetRow(store, &iter, word, type);
+		if (reuse)
+			reuse = gtk_tree_model_iter_next(model, &iter);
+	};
+
 	const size_t count = strlen(listText) + 1;
 	std::vector<char> words(listText, listText+count);
 	char *startword = &words[0];
@@ -2079,7 +2129,7 @@ void ListBoxX::SetList(const char *listText, char separator, char typesep) {
 			words[i] = '\0';
 			if (numword)
 				*numword = '\0';
-			Append(startword, numword?atoi(numword + 1):-1);
+			setWord(startword, numword?atoi(numword + 1):-1);
 			startword = &words[0] + i + 1;
 			numword = nullptr;
 		} else if (words[i] == typesep) {
@@ -2089,8 +2139,14 @@ void ListBoxX::SetList(const char *listText, char separator, char typesep) {
 	if (startword) {
 		if (numword)
 			*numword = '\0';
-		Append(startword, numword?atoi(numword + 1):-1);
+		setWord(startword, numword?atoi(numword + 1):-1);
 	}
+	// Remove the rows left from a longer previous list
+	while (reuse)
+		reuse = gtk_list_store_remove(store, &iter);
+
+	gtk_tree_view_set_model(GTK_TREE_VIEW(list), model);
+	g_object_unref(model);
 }
 
 void ListBoxX::SetOptions(ListOptions) {
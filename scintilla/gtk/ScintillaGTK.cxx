@@ -3381,6 +3381,20 @@ void scintilla_release_resources(void) {
 	}
 }
 
+/* C access to the ILoader returned by SCI_CREATELOADER, so C code can fill
+ * a document from a background thread. */
+int scintilla_loader_add_data(void *loader, const char *data, sptr_t length) {
+	return static_cast<ILoader *>(loader)->AddData(data, length);
+}
+
+void *scintilla_loader_convert_to_document(void *loader) {
+	return static_cast<ILoader *>(loader)->ConvertToDocument();
+}
+
+int scintilla_loader_release(void *loader) {
+	return static_cast<ILoader *>(loader)->Release();
+}
+
 /* Define a dummy boxed type because g-ir-scanner is unable to
  * recognize gpointer-derived types. Note that SCNotificaiton
  * is always allocated on stack so copying is not appropriate. */
@@ -166,7 +166,8 @@ ScintillaGTKAccessible *ScintillaGTKAccessible::FromAccessible(GtkAccessible *ac
 ScintillaGTKAccessible::ScintillaGTKAccessible(GtkAccessible *accessible_, GtkWidget *widget_) :
 		accessible(accessible_),
 		sci(ScintillaGTK::FromWidget(widget_)),
-		old_pos(-1) {
+		old_pos(-1),
+		lineIndexAllocated(false) {
 	SetAccessibility(true);
 	g_signal_connect(widget_, "sci-notify", G_CALLBACK(SciNotify), this);
 }
@@ -174,6 +175,7 @@ ScintillaGTKAccessible::ScintillaGTKAccessible(GtkAccessible *accessible_, GtkWi
 ScintillaGTKAccessible::~ScintillaGTKAccessible() {
 	if (gtk_accessible_get_widget(accessible)) {
 		g_signal_handlers_disconnect_matched(sci->sci, G_SIGNAL_MATCH_DATA, 0, 0, nullptr, nullptr, this);
+		SetAccessibility(false);
 	}
 }
 
@@ -436,7 +438,7 @@ gunichar ScintillaGTKAccessible::GetCharacterAtOffset(int charOffset) {
 }
 
 gint ScintillaGTKAccessible::GetCharacterCount() {
-	return sci->pdoc->CountCharacters(0, sci->pdoc->Length());
+	return CharacterCount(sci->pdoc);
 }
 
 gint ScintillaGTKAccessible::GetCaretOffset() {
@@ -833,23 +835,34 @@ void ScintillaGTKAccessible::UpdateCursor() {
 }
 
 void ScintillaGTKAccessible::ChangeDocument(Document *oldDoc, Document *newDoc) {
-	if (!Enabled()) {
+	if (oldDoc == newDoc) {
 		return;
 	}
 
-	if (oldDoc == newDoc) {
+	// the index belongs to the document, so keep it for the new one
+	if (lineIndexAllocated && newDoc) {
+		newDoc->AllocateLineCharacterIndex(LineCharacterIndexType::Utf32);
+	}
+
+	if (!Enabled()) {
+		if (lineIndexAllocated && oldDoc) {
+			oldDoc->ReleaseLineCharacterIndex(LineCharacterIndexType::Utf32);
+		}
 		return;
 	}
 
 	if (oldDoc) {
-		int charLength = oldDoc->CountCharacters(0, oldDoc->Length());
+		int charLength = CharacterCount(oldDoc);
 		g_signal_emit_by_name(accessible, "text-changed::delete", 0, charLength);
+		if (lineIndexAllocated) {
+			oldDoc->ReleaseLineCharacterIndex(LineCharacterIndexType::Utf32);
+		}
 	}
 
 	if (newDoc) {
 		PLATFORM_ASSERT(newDoc == sci->pdoc);
 
-		int charLength = newDoc->CountCharacters(0, newDoc->Length());
+		int charLength = CharacterCount(newDoc);
 		g_signal_emit_by_name(accessible, "text-changed::insert", 0, charLength);
 
 		if ((oldDoc ? oldDoc->IsReadOnly() : false) != newDoc->IsReadOnly()) {
@@ -873,10 +886,14 @@ void ScintillaGTKAccessible::NotifyReadOnly() {
 
 void ScintillaGTKAccessible::SetAccessibility(bool enabled) {
 	// Called by ScintillaGTK when application has enabled or disabled accessibility
+	// The index is reference counted, so only take a single reference
+	if (enabled == lineIndexAllocated)
+		return;
 	if (enabled)
 		sci->pdoc->AllocateLineCharacterIndex(LineCharacterIndexType::Utf32);
 	else
 		sci->pdoc->ReleaseLineCharacterIndex(LineCharacterIndexType::Utf32);
+	lineIndexAllocated = enabled;
 }
 
 void ScintillaGTKAccessible::Notify(GtkWidget *, gint, NotificationData *nt) {
@@ -885,15 +902,15 @@ void ScintillaGTKAccessible::Notify(GtkWidget *, gint, NotificationData *nt) {
 	switch (nt->nmhdr.code) {
 		case Notification::Modified: {
 			if (FlagSet(nt->modificationType, ModificationFlags::InsertText)) {
-				int startChar = CharacterOffsetFromByteOffset(nt->position);
-				int lengthChar = sci->pdoc->CountCharacters(nt->position, nt->position + nt->length);
-				g_signal_emit_by_name(accessible, "text-changed::insert", startChar, lengthChar);
+				int startChar, endChar;
+				CharacterRangeFromByteRange(nt->position, nt->position + nt->length, &startChar, &endChar);
+				g_signal_emit_by_name(accessible, "text-changed::insert", startChar, endChar - startChar);
 				UpdateCursor();
 			}
 			if (FlagSet(nt->modificationType, ModificationFlags::BeforeDelete)) {
-				int startChar = CharacterOffsetFromByteOffset(nt->position);
-				int lengthChar = sci->pdoc->CountCharacters(nt->position, nt->position + nt->length);
-				g_signal_emit_by_name(accessible, "text-changed::delete", startChar, lengthChar);
+				int startChar, endChar;
+				CharacterRangeFromByteRange(nt->position, nt->position + nt->length, &startChar, &endChar);
+				g_signal_emit_by_name(accessible, "text-changed::delete", startChar, endChar - startChar);
 			}
 			if (FlagSet(nt->modificationType, ModificationFlags::DeleteText)) {
 				UpdateCursor();
@@ -21,6 +21,8 @@ private:
 	// local state for comparing
 	Sci::Position old_pos;
 	std::vector<SelectionRange> old_sels;
+	// whether this holds a reference to the UTF-32 line index of sci->pdoc
+	bool lineIndexAllocated;
 
 	bool Enabled() const;
 	void UpdateCursor();
@@ -72,7 +74,20 @@ private:
 
 	void CharacterRangeFromByteRange(Sci::Position startByte, Sci::Position endByte, int *startChar, int *endChar) {
 		*startChar = CharacterOffsetFromByteOffset(startByte);
-		*endChar = *startChar + sci->pdoc->CountCharacters(startByte, endByte);
+		if (FlagSet(sci->pdoc->LineCharacterIndex(), Scintilla::LineCharacterIndexType::Utf32) &&
+			sci->pdoc->LineFromPosition(startByte) != sci->pdoc->LineFromPosition(endByte)) {
+			// only count the characters of the last line instead of the whole range
+			*endChar = CharacterOffsetFromByteOffset(endByte);
+		} else {
+			*endChar = *startChar + sci->pdoc->CountCharacters(startByte, endByte);
+		}
+	}
+
+	static Sci::Position CharacterCount(Document *doc) {
+		if (FlagSet(doc->LineCharacterIndex(), Scintilla::LineCharacterIndexType::Utf32)) {
+			return doc->IndexLineStart(doc->LinesTotal(), Scintilla::LineCharacterIndexType::Utf32);
+		}
+		return doc->CountCharacters(0, doc->Length());
 	}
 
 	void ByteRangeFromCharacterRange(int startChar, int endChar, Sci::Position& startByte, Sci::Position& endByte) {
@@ -250,6 +250,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_STYLESETFONT 2056
 #define SCI_STYLESETEOLFILLED 2057
 #define SCI_STYLERESETDEFAULT 2058
+#define SCI_STYLESETTABLE 2790
 #define SCI_STYLESETUNDERLINE 2059
 #define SC_CASE_MIXED 0
 #define SC_CASE_UPPER 1
@@ -453,6 +454,8 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_GETCOLUMN 2129
 #define SCI_COUNTCHARACTERS 2633
 #define SCI_COUNTCODEUNITS 2715
+#define SCI_POSITIONFROMLINECODEUNITS 2787
+#define SCI_LINECODEUNITSFROMPOSITION 2788
 #define SCI_SETHSCROLLBAR 2130
 #define SCI_GETHSCROLLBAR 2131
 #define SC_IV_NONE 0
@@ -498,8 +501,11 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_CHANGE_HISTORY_ENABLED 1
 #define SC_CHANGE_HISTORY_MARKERS 2
 #define SC_CHANGE_HISTORY_INDICATORS 4
+#define SC_CHANGE_HISTORY_COALESCE 8
 #define SCI_SETCHANGEHISTORY 2780
 #define SCI_GETCHANGEHISTORY 2781
+#define SCI_SETCHANGEHISTORYDEPTH 2782
+#define SCI_GETCHANGEHISTORYDEPTH 2783
 #define SCI_GETFIRSTVISIBLELINE 2152
 #define SCI_GETLINE 2153
 #define SCI_GETLINECOUNT 2154
@@ -607,6 +613,8 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_FOLDCHILDREN 2238
 #define SCI_EXPANDCHILDREN 2239
 #define SCI_FOLDALL 2662
+#define SCI_CONTRACTFOLDRANGE 2785
+#define SCI_EXPANDFOLDRANGE 2786
 #define SCI_ENSUREVISIBLE 2232
 #define SC_AUTOMATICFOLD_NONE 0x0000
 #define SC_AUTOMATICFOLD_SHOW 0x0001
@@ -948,6 +956,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_GETINDICATORVALUE 2503
 #define SCI_INDICATORFILLRANGE 2504
 #define SCI_INDICATORCLEARRANGE 2505
+#define SCI_INDICATORFILLRANGES 2784
 #define SCI_INDICATORALLONFOR 2506
 #define SCI_INDICATORVALUEAT 2507
 #define SCI_INDICATORSTART 2508
@@ -960,6 +969,12 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_GETCHARACTERPOINTER 2520
 #define SCI_GETRANGEPOINTER 2643
 #define SCI_GETGAPPOSITION 2644
+#define SC_MEMORY_TEXT 0
+#define SC_MEMORY_STYLES 1
+#define SC_MEMORY_UNDO 2
+#define SC_MEMORY_LINES 3
+#define SC_MEMORY_LAYOUT 4
+#define SCI_GETMEMORYUSAGE 2789
 #define SCI_INDICSETALPHA 2523
 #define SCI_INDICGETALPHA 2524
 #define SCI_INDICSETOUTLINEALPHA 2558
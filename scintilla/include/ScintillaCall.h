@@ -183,6 +183,7 @@ public:
 	void StyleSetFont(int style, const char *fontName);
 	void StyleSetEOLFilled(int style, bool eolFilled);
 	void StyleResetDefault();
+	void StyleSetTable(Position count, void *styles);
 	void StyleSetUnderline(int style, bool underline);
 	Colour StyleGetFore(int style);
 	Colour StyleGetBack(int style);
@@ -312,6 +313,8 @@ public:
 	Position Column(Position pos);
 	Position CountCharacters(Position start, Position end);
 	Position CountCodeUnits(Position start, Position end);
+	Position PositionFromLineCodeUnits(Line line, Position codeUnits);
+	Position LineCodeUnitsFromPosition(Position pos);
 	void SetHScrollBar(bool visible);
 	bool HScrollBar();
 	void SetIndentationGuides(Scintilla::IndentView indentView);
@@ -338,6 +341,8 @@ public:
 	Position FormatRangeFull(bool draw, RangeToFormatFull *fr);
 	void SetChangeHistory(Scintilla::ChangeHistoryOption changeHistory);
 	Scintilla::ChangeHistoryOption ChangeHistory();
+	void SetChangeHistoryDepth(int depth);
+	int ChangeHistoryDepth();
 	Line FirstVisibleLine();
 	Position GetLine(Line line, char *text);
 	std::string GetLine(Line line);
@@ -438,6 +443,8 @@ public:
 	void FoldChildren(Line line, Scintilla::FoldAction action);
 	void ExpandChildren(Line line, Scintilla::FoldLevel level);
 	void FoldAll(Scintilla::FoldAction action);
+	void ContractFoldRange(Line lineStart, Line lineEnd);
+	void ExpandFoldRange(Line lineStart, Line lineEnd);
 	void EnsureVisible(Line line);
 	void SetAutomaticFold(Scintilla::AutomaticFold automaticFold);
 	Scintilla::AutomaticFold AutomaticFold();
@@ -695,6 +702,7 @@ public:
 	int IndicatorValue();
 	void IndicatorFillRange(Position start, Position lengthFill);
 	void IndicatorClearRange(Position start, Position lengthClear);
+	void IndicatorFillRanges(Position count, void *ranges);
 	int IndicatorAllOnFor(Position pos);
 	int IndicatorValueAt(int indicator, Position pos);
 	Position IndicatorStart(int indicator, Position pos);
@@ -707,6 +715,7 @@ public:
 	void *CharacterPointer();
 	void *RangePointer(Position start, Position lengthRange);
 	Position GapPosition();
+	Position MemoryUsage(Scintilla::MemoryPart part);
 	void IndicSetAlpha(int indicator, Scintilla::Alpha alpha);
 	Scintilla::Alpha IndicGetAlpha(int indicator);
 	void IndicSetOutlineAlpha(int indicator, Scintilla::Alpha alpha);
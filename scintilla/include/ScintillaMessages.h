@@ -114,6 +114,7 @@ enum class Message {
 	StyleSetFont = 2056,
 	StyleSetEOLFilled = 2057,
 	StyleResetDefault = 2058,
+	StyleSetTable = 2790,
 	StyleSetUnderline = 2059,
 	StyleGetFore = 2481,
 	StyleGetBack = 2482,
@@ -240,6 +241,8 @@ enum class Message {
 	GetColumn = 2129,
 	CountCharacters = 2633,
 	CountCodeUnits = 2715,
+	PositionFromLineCodeUnits = 2787,
+	LineCodeUnitsFromPosition = 2788,
 	SetHScrollBar = 2130,
 	GetHScrollBar = 2131,
 	SetIndentationGuides = 2132,
@@ -266,6 +269,8 @@ enum class Message {
 	FormatRangeFull = 2777,
 	SetChangeHistory = 2780,
 	GetChangeHistory = 2781,
+	SetChangeHistoryDepth = 2782,
+	GetChangeHistoryDepth = 2783,
 	GetFirstVisibleLine = 2152,
 	GetLine = 2153,
 	GetLineCount = 2154,
@@ -361,6 +366,8 @@ enum class Message {
 	FoldChildren = 2238,
 	ExpandChildren = 2239,
 	FoldAll = 2662,
+	ContractFoldRange = 2785,
+	ExpandFoldRange = 2786,
 	EnsureVisible = 2232,
 	SetAutomaticFold = 2663,
 	GetAutomaticFold = 2664,
@@ -612,6 +619,7 @@ enum class Message {
 	GetIndicatorValue = 2503,
 	IndicatorFillRange = 2504,
 	IndicatorClearRange = 2505,
+	IndicatorFillRanges = 2784,
 	IndicatorAllOnFor = 2506,
 	IndicatorValueAt = 2507,
 	IndicatorStart = 2508,
@@ -624,6 +632,7 @@ enum class Message {
 	GetCharacterPointer = 2520,
 	GetRangePointer = 2643,
 	GetGapPosition = 2644,
+	GetMemoryUsage = 2789,
 	IndicSetAlpha = 2523,
 	IndicGetAlpha = 2524,
 	IndicSetOutlineAlpha = 2558,
@@ -282,6 +282,7 @@ enum class ChangeHistoryOption {
 	Enabled = 1,
 	Markers = 2,
 	Indicators = 4,
+	Coalesce = 8,
 };
 
 enum class FoldLevel {
@@ -466,6 +467,14 @@ enum class CaretStyle {
 	BlockAfter = 0x100,
 };
 
+enum class MemoryPart {
+	Text = 0,
+	Styles = 1,
+	Undo = 2,
+	Lines = 3,
+	Layout = 4,
+};
+
 enum class MarginOption {
 	None = 0,
 	SubLineSelect = 1,
@@ -240,6 +240,13 @@ struct PPDefinition {
 
 constexpr int inactiveFlag = 0x40;
 
+// PrivateCall operations, or'ed with the index of the keyword set: add or remove
+// the space separated words in the pointer without setting the whole set again.
+// The styling isn't invalidated, the caller restyles the text that may be affected.
+constexpr int privateCallAddKeywords = 0x1000;
+constexpr int privateCallRemoveKeywords = 0x2000;
+constexpr int privateCallKeywordSetMask = 0xFF;
+
 class LinePPState {
 	// Track the state of preprocessor conditionals to allow showing active and inactive
 	// code in different styles.
@@ -503,6 +510,12 @@ class LexerCPP : public ILexer5 {
 	};
 	typedef std::map<std::string, SymbolValue> SymbolTable;
 	SymbolTable preprocessorDefinitionsStart;
+	// preprocessorDefinitionsStart updated by the first definitionsApplied entries of
+	// ppDefineHistory, kept between calls to Lex so lexing after the last definition
+	// doesn't build the table again
+	SymbolTable preprocessorDefinitionsCurrent;
+	size_t definitionsApplied = 0;
+	bool definitionsCurrentValid = false;
 	OptionsCPP options;
 	OptionSetCPP osCPP;
 	EscapeSequence escapeSeq;
@@ -551,9 +564,7 @@ public:
 	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) override;
 	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) override;
 
-	void * SCI_METHOD PrivateCall(int, void *) noexcept override {
-		return nullptr;
-	}
+	void * SCI_METHOD PrivateCall(int operation, void *pointer) override;
 
 	int SCI_METHOD LineEndTypesSupported() noexcept override {
 		return SC_LINE_END_TYPE_UNICODE;
@@ -660,6 +671,7 @@ public:
 	constexpr static int MaskActive(int style) noexcept {
 		return style & ~inactiveFlag;
 	}
+	void AddDefinition(const PPDefinition &ppDef);
 	void EvaluateTokens(Tokens &tokens, const SymbolTable &preprocessorDefinitions);
 	Tokens Tokenize(const std::string &expr) const;
 	bool EvaluateExpression(const std::string &expr, const SymbolTable &preprocessorDefinitions);
@@ -682,6 +694,45 @@ const char * SCI_METHOD LexerCPP::PropertyGet(const char *key) {
 	return osCPP.PropertyGet(key);
 }
 
+void * SCI_METHOD LexerCPP::PrivateCall(int operation, void *pointer) {
+	WordList *wordListN = nullptr;
+	// Preprocessor definitions (set 4) need more than updating the word list
+	switch (operation & privateCallKeywordSetMask) {
+	case 0:
+		wordListN = &keywords;
+		break;
+	case 1:
+		wordListN = &keywords2;
+		break;
+	case 2:
+		wordListN = &keywords3;
+		break;
+	case 3:
+		wordListN = &keywords4;
+		break;
+	case 5:
+		wordListN = &markerList;
+		break;
+	default:
+		break;
+	}
+	if (!wordListN || !pointer)
+		return nullptr;
+	const char *words = static_cast<const char *>(pointer);
+	switch (operation & ~privateCallKeywordSetMask) {
+	case privateCallAddKeywords:
+		wordListN->Add(words);
+		break;
+	case privateCallRemoveKeywords:
+		wordListN->Remove(words);
+		break;
+	default:
+		return nullptr;
+	}
+	// Any non-null value tells the operation is supported
+	return this;
+}
+
 Sci_Position SCI_METHOD LexerCPP::WordListSet(int n, const char *wl) {
 	WordList *wordListN = nullptr;
 	switch (n) {
@@ -713,6 +764,7 @@ Sci_Position SCI_METHOD LexerCPP::WordListSet(int n, const char *wl) {
 			if (n == 4) {
 				// Rebuild preprocessorDefinitions
 				preprocessorDefinitionsStart.clear();
+				definitionsCurrentValid = false;
 				for (int nDefinition = 0; nDefinition < ppDefinitions.Length(); nDefinition++) {
 					const char *cpDefinition = ppDefinitions.WordAt(nDefinition);
 					const char *cpEquals = strchr(cpDefinition, '=');
@@ -804,21 +856,29 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 	if (!options.updatePreprocessor)
 		ppDefineHistory.clear();
 
-	const std::vector<PPDefinition>::iterator itInvalid = std::find_if(
+	// Definitions are added in line order
+	const std::vector<PPDefinition>::iterator itInvalid = std::partition_point(
 		ppDefineHistory.begin(), ppDefineHistory.end(),
-		[lineCurrent](const PPDefinition &p) noexcept { return p.line >= lineCurrent; });
+		[lineCurrent](const PPDefinition &p) noexcept { return p.line < lineCurrent; });
 	if (itInvalid != ppDefineHistory.end()) {
 		ppDefineHistory.erase(itInvalid, ppDefineHistory.end());
 		definitionsChanged = true;
 	}
 
-	SymbolTable preprocessorDefinitions = preprocessorDefinitionsStart;
-	for (const PPDefinition &ppDef : ppDefineHistory) {
+	// Only build the table again when definitions already applied were removed
+	if (!definitionsCurrentValid || definitionsApplied > ppDefineHistory.size()) {
+		preprocessorDefinitionsCurrent = preprocessorDefinitionsStart;
+		definitionsApplied = 0;
+		definitionsCurrentValid = true;
+	}
+	for (; definitionsApplied < ppDefineHistory.size(); definitionsApplied++) {
+		const PPDefinition &ppDef = ppDefineHistory[definitionsApplied];
 		if (ppDef.isUndef)
-			preprocessorDefinitions.erase(ppDef.key);
+			preprocessorDefinitionsCurrent.erase(ppDef.key);
 		else
-			preprocessorDefinitions[ppDef.key] = SymbolValue(ppDef.value, ppDef.arguments);
+			preprocessorDefinitionsCurrent[ppDef.key] = SymbolValue(ppDef.value, ppDef.arguments);
 	}
+	const SymbolTable &preprocessorDefinitions = preprocessorDefinitionsCurrent;
 
 	std::string rawStringTerminator = rawStringTerminators.ValueAt(lineCurrent-1);
 	SparseState<std::string> rawSTNew(lineCurrent);
@@ -995,6 +1055,10 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 				} else {
 					styleBeforeTaskMarker = SCE_C_COMMENT;
 					highlightTaskMarker(sc, styler, activitySet, markerList, caseSensitive);
+					if (!markerList.Length()) {
+						// Only the end of the comment or a line continuation matter
+						sc.ForwardBeforeAnyOf("*\\");
+					}
 				}
 				break;
 			case SCE_C_COMMENTDOC:
@@ -1019,6 +1083,9 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 				} else {
 					styleBeforeTaskMarker = SCE_C_COMMENTLINE;
 					highlightTaskMarker(sc, styler, activitySet, markerList, caseSensitive);
+					if (!markerList.Length()) {
+						sc.ForwardBeforeAnyOf("\\");
+					}
 				}
 				break;
 			case SCE_C_COMMENTLINEDOC:
@@ -1378,8 +1445,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 									std::string value;
 									if (startValue < restOfLine.length())
 										value = restOfLine.substr(startValue);
-									preprocessorDefinitions[key] = SymbolValue(value, args);
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, value, false, args));
+									AddDefinition(PPDefinition(lineCurrent, key, value, false, args));
 									definitionsChanged = true;
 								} else {
 									// Value
@@ -1389,8 +1455,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 									std::string value = restOfLine.substr(startValue);
 									if (OnlySpaceOrTab(value))
 										value = "1";	// No value defaults to 1
-									preprocessorDefinitions[key] = value;
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, value));
+									AddDefinition(PPDefinition(lineCurrent, key, value));
 									definitionsChanged = true;
 								}
 							}
@@ -1400,8 +1465,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 								Tokens tokens = Tokenize(restOfLine);
 								if (!tokens.empty()) {
 									const std::string key = tokens[0];
-									preprocessorDefinitions.erase(key);
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, "", true));
+									AddDefinition(PPDefinition(lineCurrent, key, "", true));
 									definitionsChanged = true;
 								}
 							}
@@ -1553,6 +1617,16 @@ void SCI_METHOD LexerCPP::Fold(Sci_PositionU startPos, Sci_Position length, int
 	}
 }
 
+// Records a #define or #undef and applies it to preprocessorDefinitionsCurrent
+void LexerCPP::AddDefinition(const PPDefinition &ppDef) {
+	ppDefineHistory.push_back(ppDef);
+	if (ppDef.isUndef)
+		preprocessorDefinitionsCurrent.erase(ppDef.key);
+	else
+		preprocessorDefinitionsCurrent[ppDef.key] = SymbolValue(ppDef.value, ppDef.arguments);
+	definitionsApplied = ppDefineHistory.size();
+}
+
 void LexerCPP::EvaluateTokens(Tokens &tokens, const SymbolTable &preprocessorDefinitions) {
 
 	// Remove whitespace tokens
@@ -14,9 +14,11 @@
 
 #include <string>
 #include <string_view>
+#include <vector>
 #include <map>
 #include <set>
 #include <functional>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -29,6 +31,7 @@
 #include "LexerModule.h"
 #include "OptionSet.h"
 #include "DefaultLexer.h"
+#include "CheckpointState.h"
 
 using namespace Scintilla;
 using namespace Lexilla;
@@ -655,6 +658,23 @@ public:
 	}
 };
 
+// State of a PHP string continuing onto a line, which can't be found from the
+// style alone as a heredoc ends with its delimiter
+struct PhpStringCheckpoint {
+	int state = SCE_HPHP_DEFAULT;
+	std::string delimiter;
+};
+
+// State of a tag continuing onto a line, as the tag may be a script tag and the
+// language it starts isn't part of the line state. The line state is the one after
+// the line end, which may have started the script tag.
+struct TagCheckpoint {
+	int state = SCE_H_DEFAULT;
+	int lineState = 0;
+	script_type scriptLanguage = eScriptNone;
+	bool tagDontFold = false;
+};
+
 bool isPHPStringState(int state) noexcept {
 	return
 	    (state == SCE_HPHP_HSTRING) ||
@@ -993,6 +1013,8 @@ class LexerHTML : public DefaultLexer {
 	OptionsHTML options;
 	OptionSetHTML osHTML;
 	std::set<std::string> nonFoldingTags;
+	CheckpointState<PhpStringCheckpoint> phpStringCheckpoints;
+	CheckpointState<TagCheckpoint> tagCheckpoints;
 public:
 	explicit LexerHTML(bool isXml_, bool isPHPScript_) :
 		DefaultLexer(
@@ -1094,17 +1116,46 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 	int makoComment = 0;
 	std::string djangoBlockType;
 	// If inside a tag, it may be a script tag, so reread from the start of line starting tag to ensure any language tags are seen
+	// or resume from a checkpoint taken at the start of a line inside the tag
+	const bool useTagCheckpoints = !options.isMako && !options.isDjango;
+	bool resumeInTag = false;
+	TagCheckpoint tagCheckpoint;
 	if (InTagState(state)) {
 		while ((startPos > 0) && (InTagState(styler.StyleAt(startPos - 1)))) {
+			const Sci_Position line = styler.GetLine(startPos);
+			if (useTagCheckpoints && tagCheckpoints.Due(line) && styler.LineStart(line) == static_cast<Sci_Position>(startPos)) {
+				const TagCheckpoint *checkpoint = tagCheckpoints.ValueAt(line);
+				if (checkpoint) {
+					tagCheckpoint = *checkpoint;
+					resumeInTag = true;
+					break;
+				}
+			}
 			const Sci_Position backLineStart = styler.LineStart(styler.GetLine(startPos-1));
 			length += startPos - backLineStart;
 			startPos = backLineStart;
 		}
-		state = SCE_H_DEFAULT;
+		if (resumeInTag) {
+			state = tagCheckpoint.state;
+			StateToPrint = state;
+		} else {
+			state = SCE_H_DEFAULT;
+		}
 	}
 	// String can be heredoc, must find a delimiter first. Reread from beginning of line containing the string, to get the correct lineState
+	// or resume from a checkpoint taken at the start of a line inside the string
 	if (isPHPStringState(state)) {
 		while (startPos > 0 && (isPHPStringState(state) || !isLineEnd(styler[startPos - 1]))) {
+			const Sci_Position line = isLineEnd(styler[startPos - 1]) ? styler.GetLine(startPos) : -1;
+			if (line >= 0 && phpStringCheckpoints.Due(line) && styler.LineStart(line) == static_cast<Sci_Position>(startPos)) {
+				const PhpStringCheckpoint *checkpoint = phpStringCheckpoints.ValueAt(line);
+				if (checkpoint && checkpoint->state == styler.StyleAt(startPos - 1)) {
+					state = checkpoint->state;
+					StateToPrint = state;
+					phpStringDelimiter = checkpoint->delimiter;
+					break;
+				}
+			}
 			startPos--;
 			length++;
 			state = styler.StyleAt(startPos);
@@ -1126,8 +1177,13 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 	}
 
 	Sci_Position lineCurrent = styler.GetLine(startPos);
+	// Text before startPos is unchanged, later checkpoints are taken again
+	phpStringCheckpoints.Delete(lineCurrent + 1);
+	tagCheckpoints.Delete(lineCurrent + 1);
 	int lineState;
-	if (lineCurrent > 0) {
+	if (resumeInTag) {
+		lineState = tagCheckpoint.lineState;
+	} else if (lineCurrent > 0) {
 		lineState = styler.GetLineState(lineCurrent-1);
 	} else {
 		// Default client and ASP scripting language is JavaScript
@@ -1143,12 +1199,25 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 	script_type clientScript = static_cast<script_type>((lineState >> 8) & 0x0F); // 4 bits of script name
 	int beforePreProc = (lineState >> 12) & 0xFF; // 8 bits of state
 	bool isLanguageType = (lineState >> 20) & 1; // type or language attribute for script tag
+	const auto currentLineState = [&]() noexcept {
+		return ((inScriptType & 0x03) << 0) |
+		       ((tagOpened ? 1 : 0) << 2) |
+		       ((tagClosing ? 1 : 0) << 3) |
+		       ((aspScript & 0x0F) << 4) |
+		       ((clientScript & 0x0F) << 8) |
+		       ((beforePreProc & 0xFF) << 12) |
+		       ((isLanguageType ? 1 : 0) << 20);
+	};
 
 	script_type scriptLanguage = ScriptOfState(state);
 	// If eNonHtmlScript coincides with SCE_H_COMMENT, assume eScriptComment
 	if (inScriptType == eNonHtmlScript && state == SCE_H_COMMENT) {
 		scriptLanguage = eScriptComment;
 	}
+	if (resumeInTag) {
+		scriptLanguage = tagCheckpoint.scriptLanguage;
+		tagDontFold = tagCheckpoint.tagDontFold;
+	}
 	script_type beforeLanguage = ScriptOfState(beforePreProc);
 	const bool foldHTML = options.foldHTML;
 	const bool fold = foldHTML && options.fold;
@@ -1194,6 +1263,8 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 
 	styler.StartSegment(startPos);
 	const Sci_Position lengthDoc = startPos + length;
+	// Whether i is at the start of lineCurrent, after the line end was handled
+	bool atLineStart = false;
 	for (Sci_Position i = startPos; i < lengthDoc; i++) {
 		const int chPrev2 = chPrev;
 		chPrev = ch;
@@ -1204,6 +1275,15 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 		int chNext = SafeGetUnsignedCharAt(styler, i + 1);
 		const int chNext2 = SafeGetUnsignedCharAt(styler, i + 2);
 
+		if (atLineStart) {
+			atLineStart = false;
+			// Unknown tags and attributes are classified from their start, which may be on an earlier line
+			if (useTagCheckpoints && InTagState(state) && state != SCE_H_TAGUNKNOWN &&
+				state != SCE_H_ATTRIBUTEUNKNOWN && tagCheckpoints.Due(lineCurrent)) {
+				tagCheckpoints.Set(lineCurrent, TagCheckpoint{state, currentLineState(), scriptLanguage, tagDontFold});
+			}
+		}
+
 		// Handle DBCS codepages
 		if (styler.IsLeadByte(static_cast<char>(ch))) {
 			chPrev = ' ';
@@ -1294,16 +1374,14 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 				visibleChars = 0;
 				levelPrev = levelCurrent;
 			}
-			styler.SetLineState(lineCurrent,
-			                    ((inScriptType & 0x03) << 0) |
-			                    ((tagOpened ? 1 : 0) << 2) |
-			                    ((tagClosing ? 1 : 0) << 3) |
-			                    ((aspScript & 0x0F) << 4) |
-			                    ((clientScript & 0x0F) << 8) |
-			                    ((beforePreProc & 0xFF) << 12) |
-			                    ((isLanguageType ? 1 : 0) << 20));
+			styler.SetLineState(lineCurrent, currentLineState());
 			lineCurrent++;
 			lineStartVisibleChars = 0;
+			if ((state == SCE_HPHP_HSTRING || state == SCE_HPHP_SIMPLESTRING) &&
+				phpStringCheckpoints.Due(lineCurrent)) {
+				phpStringCheckpoints.Set(lineCurrent, PhpStringCheckpoint{state, phpStringDelimiter});
+			}
+			atLineStart = true;
 		}
 
 		// handle start of Mako comment line
@@ -200,6 +200,8 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
                 sc.Forward(closingSpan);
                 sc.SetState(SCE_MARKDOWN_DEFAULT);
             }
+            else
+                sc.ForwardBeforeAnyOf("`");
         }
         else if (sc.state == SCE_MARKDOWN_CODE) {
             if (sc.ch == '`' && sc.chPrev != ' ')
@@ -260,6 +262,9 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
                 sc.Forward(i);
                 sc.SetState(SCE_MARKDOWN_DEFAULT);
             }
+            // Only the start of a line can end the block
+            else
+                sc.ForwardBeforeLineEnd();
         }
         else if (sc.state == SCE_MARKDOWN_STRIKEOUT) {
             if ((sc.Match("~~") && sc.chPrev != ' ') || IsNewline(sc.GetRelative(2))) {
@@ -743,6 +743,8 @@ void SCI_METHOD LexerPython::Lex(Sci_PositionU startPos, Sci_Position length, in
 		} else if ((sc.state == SCE_P_COMMENTLINE) || (sc.state == SCE_P_COMMENTBLOCK)) {
 			if (sc.ch == '\r' || sc.ch == '\n') {
 				sc.SetState(SCE_P_DEFAULT);
+			} else if (indentGood && fstringStateStack.empty()) {
+				sc.ForwardBeforeLineEnd();
 			}
 		} else if (sc.state == SCE_P_DECORATOR) {
 			if (!IsAWordStart(sc.ch, options.unicodeIdentifiers)) {
@@ -762,6 +764,10 @@ void SCI_METHOD LexerPython::Lex(Sci_PositionU startPos, Sci_Position length, in
 			} else if (sc.ch == GetPyStringQuoteChar(sc.state)) {
 				sc.ForwardSetState(SCE_P_DEFAULT);
 				needEOLCheck = true;
+			} else if (indentGood && fstringStateStack.empty()) {
+				const char stopChars[] = { '\\', GetPyStringQuoteChar(sc.state),
+					IsPyFStringState(sc.state) ? '{' : '\0', '\0' };
+				sc.ForwardBeforeAnyOf(stopChars);
 			}
 		} else if ((sc.state == SCE_P_TRIPLE) || (sc.state == SCE_P_FTRIPLE)) {
 			if (sc.ch == '\\') {
@@ -771,6 +777,8 @@ void SCI_METHOD LexerPython::Lex(Sci_PositionU startPos, Sci_Position length, in
 				sc.Forward();
 				sc.ForwardSetState(SCE_P_DEFAULT);
 				needEOLCheck = true;
+			} else if (indentGood && fstringStateStack.empty()) {
+				sc.ForwardBeforeAnyOf(IsPyFStringState(sc.state) ? "\\'{" : "\\'");
 			}
 		} else if ((sc.state == SCE_P_TRIPLEDOUBLE) || (sc.state == SCE_P_FTRIPLEDOUBLE)) {
 			if (sc.ch == '\\') {
@@ -780,6 +788,8 @@ void SCI_METHOD LexerPython::Lex(Sci_PositionU startPos, Sci_Position length, in
 				sc.Forward();
 				sc.ForwardSetState(SCE_P_DEFAULT);
 				needEOLCheck = true;
+			} else if (indentGood && fstringStateStack.empty()) {
+				sc.ForwardBeforeAnyOf(IsPyFStringState(sc.state) ? "\\\"{" : "\\\"");
 			}
 		}
 
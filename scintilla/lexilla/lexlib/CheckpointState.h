@@ -0,0 +1,67 @@
+// Scintilla source code edit control
+/** @file CheckpointState.h
+ ** Hold lexer state recorded at regular line intervals.
+ ** Lexers whose state is not fully described by the line state and the style
+ ** can resume from the nearest checkpoint instead of rereading from the start
+ ** of a long construct such as a multi-line string.
+ ** A checkpoint is taken at the start of a line and stays valid as long as the
+ ** text before it is unchanged, so the lexer deletes the checkpoints after the
+ ** line it starts on.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef CHECKPOINTSTATE_H
+#define CHECKPOINTSTATE_H
+
+namespace Lexilla {
+
+template <typename T>
+class CheckpointState {
+	struct Checkpoint {
+		Sci_Position line;
+		T value;
+		Checkpoint(Sci_Position line_, const T &value_) : line(line_), value(value_) {
+		}
+	};
+	Sci_Position interval;
+	typedef std::vector<Checkpoint> checkpointVector;
+	checkpointVector checkpoints;
+
+	// First checkpoint at or after line
+	typename checkpointVector::iterator Find(Sci_Position line) {
+		return std::lower_bound(checkpoints.begin(), checkpoints.end(), line,
+			[](const Checkpoint &checkpoint, Sci_Position value) noexcept {
+				return checkpoint.line < value;
+			});
+	}
+
+public:
+	explicit CheckpointState(Sci_Position interval_=64) : interval(interval_ > 0 ? interval_ : 1) {
+	}
+	// Whether a checkpoint should be taken at the start of line
+	bool Due(Sci_Position line) const noexcept {
+		return (line % interval) == 0;
+	}
+	// Checkpoints are expected in increasing line order, as lexing goes forward
+	void Set(Sci_Position line, const T &value) {
+		Delete(line);
+		checkpoints.push_back(Checkpoint(line, value));
+	}
+	// Value recorded at the start of line or nullptr
+	const T *ValueAt(Sci_Position line) {
+		typename checkpointVector::iterator it = Find(line);
+		if (it != checkpoints.end() && it->line == line)
+			return &it->value;
+		return nullptr;
+	}
+	void Delete(Sci_Position line) {
+		checkpoints.erase(Find(line), checkpoints.end());
+	}
+	size_t size() const noexcept {
+		return checkpoints.size();
+	}
+};
+
+}
+
+#endif
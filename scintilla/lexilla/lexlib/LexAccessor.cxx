@@ -29,6 +29,31 @@ bool LexAccessor::MatchIgnoreCase(Sci_Position pos, const char *s) {
 	return true;
 }
 
+Sci_Position LexAccessor::FindAnyOf(Sci_Position pos, Sci_Position limit, const char *chars) {
+	assert(chars);
+	const size_t lenChars = strlen(chars);
+	while (pos < limit) {
+		if (pos < startPos || pos >= endPos) {
+			Fill(pos);
+		}
+		// Search the buffered text with memchr for each byte, narrowing the range each time
+		const char * const start = buf + (pos - startPos);
+		const char *found = buf + (std::min(limit, endPos) - startPos);
+		const Sci_Position lenSearched = found - start;
+		for (size_t i = 0; i < lenChars; i++) {
+			const void *p = memchr(start, static_cast<unsigned char>(chars[i]), found - start);
+			if (p) {
+				found = static_cast<const char *>(p);
+			}
+		}
+		if (found - start < lenSearched) {
+			return pos + (found - start);
+		}
+		pos += lenSearched;
+	}
+	return limit;
+}
+
 void LexAccessor::GetRange(Sci_PositionU startPos_, Sci_PositionU endPos_, char *s, Sci_PositionU len) {
 	assert(s);
 	assert(startPos_ <= endPos_ && len != 0);
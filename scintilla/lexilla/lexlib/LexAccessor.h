@@ -114,6 +114,8 @@ public:
 		return true;
 	}
 	bool MatchIgnoreCase(Sci_Position pos, const char *s);
+	// Position of the first byte in [pos, limit) that is one of chars, else limit.
+	Sci_Position FindAnyOf(Sci_Position pos, Sci_Position limit, const char *chars);
 
 	// Get first len - 1 characters in range [startPos_, endPos_).
 	void GetRange(Sci_PositionU startPos_, Sci_PositionU endPos_, char *s, Sci_PositionU len);
@@ -41,6 +41,23 @@ class StyleContext {
 		else // Last line
 			atLineEnd = currentPosSigned >= lineStartNext;
 	}
+	// Move to the character before pos on the current line, leaving characters
+	// after the current one unexamined.
+	void ForwardBefore(Sci_Position pos) {
+		const Sci_Position posBefore = multiByteAccess ?
+			multiByteAccess->GetRelativePosition(pos, -1) : pos - 1;
+		if (posBefore <= static_cast<Sci_Position>(currentPos))
+			return;
+		currentPos = posBefore;
+		atLineStart = false;
+		chPrev = GetRelativeCharacter(-1);
+		// As in the constructor, width 0 makes GetNextChar read the char at currentPos
+		width = 0;
+		GetNextChar();
+		ch = chNext;
+		width = widthNext;
+		GetNextChar();
+	}
 
 public:
 	Sci_PositionU currentPos;
@@ -94,6 +111,31 @@ public:
 			Forward();
 		}
 	}
+	// Skip characters so the next Forward() moves onto the first of the bytes in
+	// chars or onto the line end, whichever comes first. The skipped characters
+	// get the current style. Useful for long comments and strings where the
+	// other characters need not be examined one by one.
+	// Nothing is skipped when the current character is one of chars, as it may
+	// still need handling.
+	void ForwardBeforeAnyOf(const char *chars) {
+		// A DBCS trail byte may look like one of chars
+		if (*chars && styler.Encoding() == EncodingType::dbcs)
+			return;
+		for (const char *s = chars; *s; s++) {
+			if (ch == static_cast<unsigned char>(*s))
+				return;
+		}
+		const Sci_Position endPosSigned = endPos;
+		const Sci_Position limit = (lineEnd < endPosSigned) ? lineEnd : endPosSigned;
+		const Sci_Position posNext = currentPos + width;
+		if (posNext < limit) {
+			ForwardBefore(styler.FindAnyOf(posNext, limit, chars));
+		}
+	}
+	// Skip characters so the next Forward() moves onto the line end.
+	void ForwardBeforeLineEnd() {
+		ForwardBeforeAnyOf("");
+	}
 	void ForwardBytes(Sci_Position nb) {
 		const Sci_PositionU forwardPos = currentPos + nb;
 		while (forwardPos > currentPos) {
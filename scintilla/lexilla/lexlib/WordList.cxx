@@ -69,10 +69,21 @@ bool cmpWords(const char *a, const char *b) noexcept {
 	return strcmp(a, b) < 0;
 }
 
+// FNV-1a
+size_t HashWord(const char *s) noexcept {
+	size_t hash = 2166136261U;
+	for (; *s; s++) {
+		hash ^= static_cast<unsigned char>(*s);
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
 }
 
 WordList::WordList(bool onlyLineEnds_) noexcept :
-	words(nullptr), list(nullptr), len(0), onlyLineEnds(onlyLineEnds_) {
+	words(nullptr), list(nullptr), lenList(0), len(0), onlyLineEnds(onlyLineEnds_),
+	hashTable(nullptr), hashSize(0) {
 	// Prevent warnings by static analyzers about uninitialized starts.
 	starts[0] = -1;
 }
@@ -104,9 +115,51 @@ void WordList::Clear() noexcept {
 	list = nullptr;
 	delete []words;
 	words = nullptr;
+	delete []hashTable;
+	hashTable = nullptr;
+	hashSize = 0;
+	lenList = 0;
 	len = 0;
 }
 
+/** Build the look up structures for the sorted words: the index of the first word
+ * for each starting character and, for large lists, a hash table of all words.
+ */
+void WordList::Index() {
+	std::fill(starts, std::end(starts), -1);
+	for (int l = static_cast<int>(len - 1); l >= 0; l--) {
+		unsigned char const indexChar = words[l][0];
+		starts[indexChar] = l;
+	}
+	delete []hashTable;
+	hashTable = nullptr;
+	hashSize = 0;
+	if (len >= hashThreshold) {
+		// At most half full so probe sequences stay short
+		hashSize = 1;
+		while (hashSize < len * 2)
+			hashSize *= 2;
+		hashTable = new int[hashSize];
+		std::fill(hashTable, hashTable + hashSize, -1);
+		for (size_t i = 0; i < len; i++) {
+			size_t slot = HashWord(words[i]) & (hashSize - 1);
+			while (hashTable[slot] >= 0)
+				slot = (slot + 1) & (hashSize - 1);
+			hashTable[slot] = static_cast<int>(i);
+		}
+	}
+}
+
+bool WordList::InHashTable(const char *s) const noexcept {
+	size_t slot = HashWord(s) & (hashSize - 1);
+	while (hashTable[slot] >= 0) {
+		if (strcmp(words[hashTable[slot]], s) == 0)
+			return true;
+		slot = (slot + 1) & (hashSize - 1);
+	}
+	return false;
+}
+
 bool WordList::Set(const char *s) {
 	const size_t lenS = strlen(s) + 1;
 	std::unique_ptr<char[]> listTemp = std::make_unique<char[]>(lenS);
@@ -131,12 +184,91 @@ bool WordList::Set(const char *s) {
 	Clear();
 	words = wordsTemp.release();
 	list = listTemp.release();
+	lenList = lenS;
 	len = lenTemp;
-	std::fill(starts, std::end(starts), -1);
-	for (int l = static_cast<int>(len - 1); l >= 0; l--) {
-		unsigned char const indexChar = words[l][0];
-		starts[indexChar] = l;
+	Index();
+	return true;
+}
+
+/** Add the words of s, in the same format as for Set, that are not yet in the list.
+ * This is faster than setting the whole list again when few words change in a
+ * large list. Returns true when a word was added.
+ */
+bool WordList::Add(const char *s) {
+	const size_t lenS = strlen(s) + 1;
+	std::unique_ptr<char[]> listAdded = std::make_unique<char[]>(lenS);
+	memcpy(listAdded.get(), s, lenS);
+	size_t lenAdded = 0;
+	std::unique_ptr<char *[]> wordsAdded = ArrayFromWordList(listAdded.get(), lenS - 1, &lenAdded, onlyLineEnds);
+	if (lenAdded == 0)
+		return false;
+	std::sort(wordsAdded.get(), wordsAdded.get() + lenAdded, cmpWords);
+
+	// The new words are kept after the current ones so existing words only need rebasing
+	std::unique_ptr<char[]> listTemp = std::make_unique<char[]>(lenList + lenS);
+	if (list)
+		memcpy(listTemp.get(), list, lenList);
+	memcpy(listTemp.get() + lenList, listAdded.get(), lenS);
+	std::unique_ptr<char *[]> wordsTemp = std::make_unique<char *[]>(len + lenAdded + 1);
+	size_t lenTemp = 0;
+	size_t i = 0;
+	size_t j = 0;
+	while (i < len || j < lenAdded) {
+		const int cmp = (i == len) ? 1 : ((j == lenAdded) ? -1 : strcmp(words[i], wordsAdded[j]));
+		if (cmp <= 0) {
+			wordsTemp[lenTemp++] = listTemp.get() + (words[i] - list);
+			i++;
+			if (cmp == 0)
+				j++;
+		} else if (lenTemp == 0 || strcmp(wordsTemp[lenTemp - 1], wordsAdded[j]) != 0) {
+			wordsTemp[lenTemp++] = listTemp.get() + lenList + (wordsAdded[j] - listAdded.get());
+			j++;
+		} else {
+			// Repeated in s
+			j++;
+		}
+	}
+	if (lenTemp == len)
+		return false;
+	wordsTemp[lenTemp] = listTemp.get() + lenList + lenS - 1;
+
+	delete []list;
+	list = listTemp.release();
+	lenList += lenS;
+	delete []words;
+	words = wordsTemp.release();
+	len = lenTemp;
+	Index();
+	return true;
+}
+
+/** Remove the words of s, in the same format as for Set, from the list.
+ * Returns true when a word was removed.
+ */
+bool WordList::Remove(const char *s) {
+	if (!words)
+		return false;
+	const size_t lenS = strlen(s) + 1;
+	std::unique_ptr<char[]> listRemoved = std::make_unique<char[]>(lenS);
+	memcpy(listRemoved.get(), s, lenS);
+	size_t lenRemoved = 0;
+	std::unique_ptr<char *[]> wordsRemoved = ArrayFromWordList(listRemoved.get(), lenS - 1, &lenRemoved, onlyLineEnds);
+	std::sort(wordsRemoved.get(), wordsRemoved.get() + lenRemoved, cmpWords);
+
+	// The characters of removed words stay in list until it is next set
+	size_t lenTemp = 0;
+	size_t j = 0;
+	for (size_t i = 0; i < len; i++) {
+		while (j < lenRemoved && strcmp(wordsRemoved[j], words[i]) < 0)
+			j++;
+		if (j == lenRemoved || strcmp(wordsRemoved[j], words[i]) != 0)
+			words[lenTemp++] = words[i];
 	}
+	if (lenTemp == len)
+		return false;
+	words[lenTemp] = words[len];
+	len = lenTemp;
+	Index();
 	return true;
 }
 
@@ -151,7 +283,10 @@ bool WordList::InList(const char *s) const noexcept {
 	const char first = s[0];
 	const unsigned char firstChar = first;
 	int j = starts[firstChar];
-	if (j >= 0) {
+	if (hashTable) {
+		if (InHashTable(s))
+			return true;
+	} else if (j >= 0) {
 		while (words[j][0] == first) {
 			if (s[1] == words[j][1]) {
 				const char *a = words[j] + 1;
@@ -16,10 +16,19 @@ class WordList {
 	// Each word contains at least one character - a empty word acts as sentinel at the end.
 	char **words;
 	char *list;
+	size_t lenList;	///< Size of list including the terminating NUL
 	size_t len;
 	bool onlyLineEnds;	///< Delimited by any white space or only line ends
 	int starts[256];
+	// Open addressing table of word indices, only built for large lists, see hashThreshold
+	int *hashTable;
+	size_t hashSize;
+	void Index();
+	bool InHashTable(const char *s) const noexcept;
 public:
+	/// Lists with at least this many words are looked up through a hash table
+	static constexpr size_t hashThreshold = 256;
+
 	explicit WordList(bool onlyLineEnds_ = false) noexcept;
 	// Deleted so WordList objects can not be copied.
 	WordList(const WordList &) = delete;
@@ -32,6 +41,8 @@ public:
 	int Length() const noexcept;
 	void Clear() noexcept;
 	bool Set(const char *s);
+	bool Add(const char *s);
+	bool Remove(const char *s);
 	bool InList(const char *s) const noexcept;
 	bool InList(const std::string &s) const noexcept;
 	bool InListAbbreviated(const char *s, const char marker) const noexcept;
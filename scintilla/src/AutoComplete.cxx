@@ -70,7 +70,7 @@ void AutoComplete::Start(Window &parent, int ctrlID,
 	}
 	lb->SetOptions(listOptions);
 	lb->Create(parent, ctrlID, location, lineHeight, unicodeMode, technology);
-	lb->Clear();
+	// Not cleared as SetList replaces the items, reusing them where the platform can
 	active = true;
 	startLen = startLen_;
 	posStart = position;
@@ -169,8 +169,11 @@ void AutoComplete::SetList(const char *list) {
 	sortMatrix.clear();
 	for (int i = 0; i < static_cast<int>(IndexSort.indices.size()) / 2; ++i)
 		sortMatrix.push_back(i);
-	std::sort(sortMatrix.begin(), sortMatrix.end(), IndexSort);
-	if (autoSort == Ordering::Custom || sortMatrix.size() < 2) {
+	// Applications often pass lists that are already in order so check first
+	const bool inOrder = std::is_sorted(sortMatrix.begin(), sortMatrix.end(), IndexSort);
+	if (!inOrder)
+		std::sort(sortMatrix.begin(), sortMatrix.end(), IndexSort);
+	if (autoSort == Ordering::Custom || inOrder || sortMatrix.size() < 2) {
 		lb->SetList(list, separator, typesep);
 		PLATFORM_ASSERT(lb->Length() == static_cast<int>(sortMatrix.size()));
 		return;
@@ -218,7 +221,6 @@ void AutoComplete::Show(bool show) {
 
 void AutoComplete::Cancel() noexcept {
 	if (lb->Created()) {
-		lb->Clear();
 		lb->Destroy();
 		active = false;
 	}
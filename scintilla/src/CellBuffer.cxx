@@ -84,6 +84,7 @@ public:
 	virtual bool ReleaseLineCharacterIndex(Scintilla::LineCharacterIndexType lineCharacterIndex) = 0;
 	virtual Sci::Position IndexLineStart(Sci::Line line, Scintilla::LineCharacterIndexType lineCharacterIndex) const noexcept = 0;
 	virtual Sci::Line LineFromPositionIndex(Sci::Position pos, Scintilla::LineCharacterIndexType lineCharacterIndex) const noexcept = 0;
+	virtual size_t AllocatedSize() const noexcept = 0;
 	virtual ~ILineVector() {}
 };
 
@@ -326,25 +327,28 @@ public:
 			return line_from_pos_cast(startsUTF16.starts.PartitionFromPosition(pos_cast(pos)));
 		}
 	}
+	size_t AllocatedSize() const noexcept override {
+		return starts.AllocatedSize() + startsUTF16.starts.AllocatedSize() +
+			startsUTF32.starts.AllocatedSize();
+	}
 };
 
 Action::Action() noexcept {
 	at = ActionType::start;
 	position = 0;
+	data = nullptr;
 	lenData = 0;
 	mayCoalesce = false;
+	textEnd = 0;
 }
 
-void Action::Create(ActionType at_, Sci::Position position_, const char *data_, Sci::Position lenData_, bool mayCoalesce_) {
-	data = nullptr;
+void Action::Create(ActionType at_, size_t textEnd_, Sci::Position position_, const char *data_, Sci::Position lenData_, bool mayCoalesce_) noexcept {
 	position = position_;
 	at = at_;
-	if (lenData_) {
-		data = std::make_unique<char[]>(lenData_);
-		memcpy(&data[0], data_, lenData_);
-	}
+	data = lenData_ ? data_ : nullptr;
 	lenData = lenData_;
 	mayCoalesce = mayCoalesce_;
+	textEnd = textEnd_;
 }
 
 void Action::Clear() noexcept {
@@ -352,6 +356,47 @@ void Action::Clear() noexcept {
 	lenData = 0;
 }
 
+namespace {
+
+constexpr size_t undoTextBlockSize = 0x10000;
+
+}
+
+const char *UndoTextArena::Append(const char *data, size_t lenData) {
+	if (blocks.empty() || (length + lenData > blocks.back().start + blocks.back().size)) {
+		// Text that does not fit into the last block starts a new one, big texts get their own
+		const size_t sizeBlock = std::max(lenData, undoTextBlockSize);
+		blocks.push_back({std::make_unique<char[]>(sizeBlock), length, sizeBlock});
+	}
+	char *text = &blocks.back().text[length - blocks.back().start];
+	memcpy(text, data, lenData);
+	length += lenData;
+	return text;
+}
+
+void UndoTextArena::Truncate(size_t length_) noexcept {
+	if (length_ >= length)
+		return;
+	// Keep the first block around as it is likely to be needed again soon
+	while (blocks.size() > 1 && blocks.back().start >= length_) {
+		blocks.pop_back();
+	}
+	length = length_;
+}
+
+void UndoTextArena::Clear() noexcept {
+	blocks.clear();
+	length = 0;
+}
+
+size_t UndoTextArena::AllocatedSize() const noexcept {
+	size_t size = blocks.capacity() * sizeof(Block);
+	for (const Block &block : blocks) {
+		size += block.size;
+	}
+	return size;
+}
+
 // The undo history stores a sequence of user operations that represent the user's view of the
 // commands executed on the text.
 // Each user operation contains a sequence of text insertion and text deletion actions.
@@ -369,6 +414,9 @@ void Action::Clear() noexcept {
 // operation. If there is no outstanding BeginUndoAction call then a new operation is started
 // unless it looks as if the new action is caused by the user typing or deleting a stream of text.
 // Sequences that look like typing or deletion are coalesced into a single user operation.
+// The text of the actions is stored in order in an arena. Creating an action discards all the
+// actions after it, so the arena is truncated to the end of the text of the previous action
+// before the text of the new action is appended.
 
 UndoHistory::UndoHistory() {
 
@@ -379,7 +427,11 @@ UndoHistory::UndoHistory() {
 	savePoint = 0;
 	tentativePoint = -1;
 
-	actions[currentAction].Create(ActionType::start);
+	CreateAction(currentAction, ActionType::start);
+}
+
+size_t UndoHistory::AllocatedSize() const noexcept {
+	return actions.capacity() * sizeof(Action) + texts.AllocatedSize();
 }
 
 void UndoHistory::EnsureUndoRoom() {
@@ -391,6 +443,13 @@ void UndoHistory::EnsureUndoRoom() {
 	}
 }
 
+void UndoHistory::CreateAction(int index, ActionType at, Sci::Position position, const char *data, Sci::Position lengthData,
+	bool mayCoalesce) {
+	texts.Truncate((index > 0) ? actions[index - 1].textEnd : 0);
+	const char *text = lengthData ? texts.Append(data, lengthData) : nullptr;
+	actions[index].Create(at, texts.Length(), position, text, lengthData, mayCoalesce);
+}
+
 const char *UndoHistory::AppendAction(ActionType at, Sci::Position position, const char *data, Sci::Position lengthData,
 	bool &startSequence, bool mayCoalesce) {
 	EnsureUndoRoom();
@@ -461,11 +520,11 @@ const char *UndoHistory::AppendAction(ActionType at, Sci::Position position, con
 	}
 	startSequence = oldCurrentAction != currentAction;
 	const int actionWithData = currentAction;
-	actions[currentAction].Create(at, position, data, lengthData, mayCoalesce);
+	CreateAction(currentAction, at, position, data, lengthData, mayCoalesce);
 	currentAction++;
-	actions[currentAction].Create(ActionType::start);
+	CreateAction(currentAction, ActionType::start);
 	maxAction = currentAction;
-	return actions[actionWithData].data.get();
+	return actions[actionWithData].data;
 }
 
 void UndoHistory::BeginUndoAction() {
@@ -473,7 +532,7 @@ void UndoHistory::BeginUndoAction() {
 	if (undoSequenceDepth == 0) {
 		if (actions[currentAction].at != ActionType::start) {
 			currentAction++;
-			actions[currentAction].Create(ActionType::start);
+			CreateAction(currentAction, ActionType::start);
 			maxAction = currentAction;
 		}
 		actions[currentAction].mayCoalesce = false;
@@ -488,7 +547,7 @@ void UndoHistory::EndUndoAction() {
 	if (0 == undoSequenceDepth) {
 		if (actions[currentAction].at != ActionType::start) {
 			currentAction++;
-			actions[currentAction].Create(ActionType::start);
+			CreateAction(currentAction, ActionType::start);
 			maxAction = currentAction;
 		}
 		actions[currentAction].mayCoalesce = false;
@@ -504,7 +563,8 @@ void UndoHistory::DeleteUndoHistory() {
 		actions[i].Clear();
 	maxAction = 0;
 	currentAction = 0;
-	actions[currentAction].Create(ActionType::start);
+	texts.Clear();
+	CreateAction(currentAction, ActionType::start);
 	savePoint = 0;
 	tentativePoint = -1;
 }
@@ -680,6 +740,21 @@ Sci::Position CellBuffer::GapPosition() const noexcept {
 	return substance.GapPosition();
 }
 
+size_t CellBuffer::AllocatedSize(MemoryPart part) const noexcept {
+	switch (part) {
+	case MemoryPart::Text:
+		return substance.AllocatedSize();
+	case MemoryPart::Styles:
+		return style.AllocatedSize();
+	case MemoryPart::Undo:
+		return uh.AllocatedSize();
+	case MemoryPart::Lines:
+		return plv->AllocatedSize();
+	default:
+		return 0;
+	}
+}
+
 SplitView CellBuffer::AllView() const noexcept {
 	const size_t length = substance.Length();
 	size_t length1 = substance.GapPosition();
@@ -709,6 +784,7 @@ const char *CellBuffer::InsertString(Sci::Position position, const char *s, Sci:
 		BasicInsertString(position, s, insertLength);
 		if (changeHistory) {
 			changeHistory->Insert(position, insertLength, collectingUndo, uh.BeforeReachableSavePoint());
+			CoalesceChangeHistory(position, insertLength);
 		}
 	}
 	return data;
@@ -997,6 +1073,13 @@ CountWidths CountCharacterWidthsUTF8(std::string_view sv) noexcept {
 	CountWidths cw;
 	size_t remaining = sv.length();
 	while (remaining > 0) {
+		const size_t asciiRun = UTF8AsciiRunLength(sv);
+		if (asciiRun > 0) {
+			cw.countBasePlane += asciiRun;
+			sv.remove_prefix(asciiRun);
+			remaining -= asciiRun;
+			continue;
+		}
 		const int utf8Status = UTF8Classify(sv);
 		const int lenChar = utf8Status & UTF8MaskWidth;
 		cw.CountChar(lenChar);
@@ -1090,7 +1173,36 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 		simpleInsertion = false;
 	}
 
-	if (ptr < end) {
+	if (ptr < end && utf8LineEnds != LineEndType::Unicode) {
+		// Only CR and LF can end lines so let memchr find them which is much
+		// faster than looking at each byte, particularly when loading big files
+		const char *nextCR = static_cast<const char *>(memchr(ptr, '\r', end - ptr));
+		while (ptr < end) {
+			const char *eol = static_cast<const char *>(
+				memchr(ptr, '\n', (nextCR ? nextCR : end) - ptr));
+			if (!eol) {
+				if (!nextCR) {
+					ptr = end;
+					break;
+				}
+				eol = nextCR;
+			}
+			ptr = eol + 1;
+			if (*eol == '\r') {
+				if (*ptr == '\n') {
+					++ptr;
+				}
+				nextCR = (ptr < end) ?
+					static_cast<const char *>(memchr(ptr, '\r', end - ptr)) : nullptr;
+			}
+			positions[nPositions++] = position + ptr - s;
+			if (nPositions == PositionBlockSize) {
+				plv->InsertLines(lineInsert, positions, nPositions, atLineStart);
+				lineInsert += nPositions;
+				nPositions = 0;
+			}
+		}
+	} else if (ptr < end) {
 		uint8_t eolTable[256]{};
 		eolTable[static_cast<uint8_t>('\n')] = 1;
 		eolTable[static_cast<uint8_t>('\r')] = 2;
@@ -1354,7 +1466,7 @@ void CellBuffer::PerformUndoStep() {
 		}
 		BasicDeleteChars(actionStep.position, actionStep.lenData);
 	} else if (actionStep.at == ActionType::remove) {
-		BasicInsertString(actionStep.position, actionStep.data.get(), actionStep.lenData);
+		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
 		if (changeHistory) {
 			changeHistory->UndoDeleteStep(actionStep.position, actionStep.lenData, uh.AfterDetachPoint());
 		}
@@ -1377,10 +1489,11 @@ const Action &CellBuffer::GetRedoStep() const {
 void CellBuffer::PerformRedoStep() {
 	const Action &actionStep = uh.GetRedoStep();
 	if (actionStep.at == ActionType::insert) {
-		BasicInsertString(actionStep.position, actionStep.data.get(), actionStep.lenData);
+		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
 		if (changeHistory) {
 			changeHistory->Insert(actionStep.position, actionStep.lenData, collectingUndo,
 				uh.BeforeSavePoint() && !uh.AfterDetachPoint());
+			CoalesceChangeHistory(actionStep.position, actionStep.lenData);
 		}
 	} else if (actionStep.at == ActionType::remove) {
 		if (changeHistory) {
@@ -1399,12 +1512,41 @@ void CellBuffer::ChangeHistorySet(bool set) {
 	if (set) {
 		if (!changeHistory && !uh.CanUndo()) {
 			changeHistory = std::make_unique<ChangeHistory>(Length());
+			changeHistory->SetDepth(changeHistoryDepth);
 		}
 	} else {
 		changeHistory.reset();
 	}
 }
 
+void CellBuffer::ChangeHistoryCoalesceSet(bool coalesce) noexcept {
+	changeHistoryCoalesce = coalesce;
+}
+
+void CellBuffer::ChangeHistoryDepthSet(int depth) {
+	changeHistoryDepth = std::max(depth, 0);
+	if (changeHistory) {
+		changeHistory->SetDepth(changeHistoryDepth);
+	}
+}
+
+int CellBuffer::ChangeHistoryDepth() const noexcept {
+	return changeHistoryDepth;
+}
+
+// When coalescing, text inserted with undo collection marks all the lines it touches,
+// so change markers need one run per changed block of lines rather than one per edit
+void CellBuffer::CoalesceChangeHistory(Sci::Position position, Sci::Position insertLength) {
+	if (!changeHistoryCoalesce || !collectingUndo || (insertLength <= 0)) {
+		return;
+	}
+	const Sci::Position start = LineStart(LineFromPosition(position));
+	const Sci::Position end = std::min(LineStart(LineFromPosition(position + insertLength - 1) + 1), Length());
+	if (end > start) {
+		changeHistory->CoalesceInsertion(position, start, end - start);
+	}
+}
+
 int CellBuffer::EditionAt(Sci::Position pos) const noexcept {
 	if (changeHistory) {
 		return changeHistory->EditionAt(pos);
@@ -35,20 +35,47 @@ class Action {
 public:
 	ActionType at;
 	Sci::Position position;
-	std::unique_ptr<char[]> data;
+	const char *data;
 	Sci::Position lenData;
 	bool mayCoalesce;
+	/// Length of the undo text arena including this action's text
+	size_t textEnd;
 
 	Action() noexcept;
-	void Create(ActionType at_, Sci::Position position_=0, const char *data_=nullptr, Sci::Position lenData_=0, bool mayCoalesce_=true);
+	void Create(ActionType at_, size_t textEnd_, Sci::Position position_=0, const char *data_=nullptr, Sci::Position lenData_=0, bool mayCoalesce_=true) noexcept;
 	void Clear() noexcept;
 };
 
+/**
+ * Storage for the text of undo actions which is only ever appended to or truncated at its end.
+ * Text is copied into large blocks so that small actions, like typing, do not need an allocation
+ * each. Blocks never move so pointers to the text stay valid until it is truncated.
+ */
+class UndoTextArena {
+	struct Block {
+		std::unique_ptr<char[]> text;
+		size_t start;
+		size_t size;
+	};
+	std::vector<Block> blocks;
+	size_t length = 0;
+
+public:
+	const char *Append(const char *data, size_t lenData);
+	size_t Length() const noexcept {
+		return length;
+	}
+	void Truncate(size_t length_) noexcept;
+	void Clear() noexcept;
+	size_t AllocatedSize() const noexcept;
+};
+
 /**
  *
  */
 class UndoHistory {
 	std::vector<Action> actions;
+	UndoTextArena texts;
 	int maxAction;
 	int currentAction;
 	int undoSequenceDepth;
@@ -57,10 +84,12 @@ class UndoHistory {
 	std::optional<int> detach;
 
 	void EnsureUndoRoom();
+	void CreateAction(int index, ActionType at, Sci::Position position=0, const char *data=nullptr, Sci::Position lengthData=0, bool mayCoalesce=true);
 
 public:
 	UndoHistory();
 
+	size_t AllocatedSize() const noexcept;
 	const char *AppendAction(ActionType at, Sci::Position position, const char *data, Sci::Position lengthData, bool &startSequence, bool mayCoalesce=true);
 
 	void BeginUndoAction();
@@ -140,6 +169,8 @@ private:
 	UndoHistory uh;
 
 	std::unique_ptr<ChangeHistory> changeHistory;
+	bool changeHistoryCoalesce = false;
+	int changeHistoryDepth = 0;
 
 	std::unique_ptr<ILineVector> plv;
 
@@ -151,6 +182,7 @@ private:
 	/// Actions without undo
 	void BasicInsertString(Sci::Position position, const char *s, Sci::Position insertLength);
 	void BasicDeleteChars(Sci::Position position, Sci::Position deleteLength);
+	void CoalesceChangeHistory(Sci::Position position, Sci::Position insertLength);
 
 public:
 
@@ -171,6 +203,7 @@ public:
 	const char *BufferPointer();
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept;
 	Sci::Position GapPosition() const noexcept;
+	size_t AllocatedSize(Scintilla::MemoryPart part) const noexcept;
 	SplitView AllView() const noexcept;
 
 	Sci::Position Length() const noexcept;
@@ -234,6 +267,9 @@ public:
 	void PerformRedoStep();
 
 	void ChangeHistorySet(bool set);
+	void ChangeHistoryCoalesceSet(bool coalesce) noexcept;
+	void ChangeHistoryDepthSet(int depth);
+	[[nodiscard]] int ChangeHistoryDepth() const noexcept;
 	[[nodiscard]] int EditionAt(Sci::Position pos) const noexcept;
 	[[nodiscard]] Sci::Position EditionEndRun(Sci::Position pos) const noexcept;
 	[[nodiscard]] unsigned int EditionDeletesAt(Sci::Position pos) const noexcept;
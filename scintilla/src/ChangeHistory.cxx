@@ -33,7 +33,27 @@ void ChangeStack::Clear() noexcept {
 	insertions.clear();
 }
 
+void ChangeStack::DropOldestSteps(size_t count) {
+	size_t spans = 0;
+	for (size_t i = 0; i < count; i++) {
+		spans += steps[i];
+	}
+	steps.erase(steps.begin(), steps.begin() + count);
+	insertions.erase(insertions.begin(), insertions.begin() + spans);
+}
+
+void ChangeStack::SetDepth(size_t depth_) {
+	depth = depth_;
+	if (depth && (steps.size() > depth)) {
+		DropOldestSteps(steps.size() - depth);
+	}
+}
+
 void ChangeStack::AddStep() {
+	// Allow the stack to grow to twice the depth so that dropping is amortized
+	if (depth && (steps.size() >= depth * 2)) {
+		DropOldestSteps(steps.size() - depth);
+	}
 	steps.push_back(0);
 }
 
@@ -48,6 +68,10 @@ void ChangeStack::PushInsertion(Sci::Position positionInsertion, Sci::Position l
 }
 
 size_t ChangeStack::PopStep() noexcept {
+	// Steps beyond the depth were dropped so there is nothing to restore
+	if (steps.empty()) {
+		return 0;
+	}
 	const size_t spans = steps.back();
 	steps.pop_back();
 	return spans;
@@ -160,6 +184,14 @@ void ChangeLog::SaveRange(Sci::Position position, Sci::Position length) {
 void ChangeLog::PopDeletion(Sci::Position position, Sci::Position deleteLength) {
 	// Just performed InsertSpace(position, deleteLength) so *this* element in
 	// deleteEdition moved forward by deleteLength
+	if (!deleteEdition.ValueAt(position + deleteLength)) {
+		// The deletion was collapsed into a later one whose step was dropped beyond the depth
+		const size_t inserts = changeStack.PopStep();
+		for (size_t i = 0; i < inserts; i++) {
+			(void)changeStack.PopSpan();
+		}
+		return;
+	}
 	EditionSetOwned eso = deleteEdition.Extract(position + deleteLength);
 	deleteEdition.SetValueAt(position, std::move(eso));
 	const EditionSetOwned &editions = deleteEdition.ValueAt(position);
@@ -265,7 +297,8 @@ void ChangeHistory::Insert(Sci::Position position, Sci::Position insertLength, b
 
 void ChangeHistory::DeleteRange(Sci::Position position, Sci::Position deleteLength, bool reverting) {
 	Check();
-	assert(DeletionCount(position, deleteLength-1) == 0);
+	// Without the dropped steps, deletions undone earlier may be left inside the range
+	assert(depth || DeletionCount(position, deleteLength-1) == 0);
 	changeLog.DeleteRange(position, deleteLength);
 	if (changeLogReversions) {
 		changeLogReversions->DeleteRangeSavingHistory(position, deleteLength);
@@ -288,10 +321,27 @@ void ChangeHistory::DeleteRangeSavingHistory(Sci::Position position, Sci::Positi
 	Check();
 }
 
+void ChangeHistory::CoalesceInsertion(Sci::Position position, Sci::Position start, Sci::Position length) {
+	// Extend the edition of the text inserted at position over the range, normally its lines,
+	// so that heavy editing leaves a run per changed range instead of many small runs
+	const int edition = changeLog.insertEdition.ValueAt(position);
+	changeLog.Insert(start, length, edition);
+	Check();
+}
+
+void ChangeHistory::SetDepth(size_t depth_) {
+	depth = depth_;
+	changeLog.changeStack.SetDepth(depth);
+	if (changeLogReversions) {
+		changeLogReversions->changeStack.SetDepth(depth);
+	}
+}
+
 void ChangeHistory::StartReversion() {
 	if (!changeLogReversions) {
 		changeLogReversions = std::make_unique<ChangeLog>();
 		changeLogReversions->Clear(changeLog.Length());
+		changeLogReversions->changeStack.SetDepth(depth);
 	}
 	Check();
 }
@@ -35,8 +35,11 @@ using EditionSetOwned = std::unique_ptr<EditionSet>;
 class ChangeStack {
 	std::vector<size_t> steps;
 	std::vector<InsertionSpan> insertions;
+	size_t depth = 0;
+	void DropOldestSteps(size_t count);
 public:
 	void Clear() noexcept;
+	void SetDepth(size_t depth_);
 	void AddStep();
 	void PushDeletion(Sci::Position positionDeletion, int edition);
 	void PushInsertion(Sci::Position positionInsertion, Sci::Position length, int edition);
@@ -74,6 +77,7 @@ class ChangeHistory {
 	ChangeLog changeLog;
 	std::unique_ptr<ChangeLog> changeLogReversions;
 	int historicEpoch = -1;
+	size_t depth = 0;
 
 public:
 	ChangeHistory(Sci::Position length=0);
@@ -81,6 +85,10 @@ public:
 	void Insert(Sci::Position position, Sci::Position insertLength, bool collectingUndo, bool beforeSave);
 	void DeleteRange(Sci::Position position, Sci::Position deleteLength, bool reverting);
 	void DeleteRangeSavingHistory(Sci::Position position, Sci::Position deleteLength, bool beforeSave, bool isDetached);
+	void CoalesceInsertion(Sci::Position position, Sci::Position start, Sci::Position length);
+
+	// Limit the number of deletions whose editions are restored by undo, 0 for no limit
+	void SetDepth(size_t depth_);
 
 	void StartReversion();
 	void EndReversion() noexcept;
@@ -80,6 +80,7 @@ public:
 
 	bool GetExpanded(Sci::Line lineDoc) const noexcept override;
 	bool SetExpanded(Sci::Line lineDoc, bool isExpanded) override;
+	bool SetExpandedRange(Sci::Line lineDocStart, Sci::Line lineDocEnd, bool isExpanded) override;
 	bool ExpandAll() override;
 	Sci::Line ContractedNext(Sci::Line lineDocStart) const noexcept override;
 
@@ -249,12 +250,16 @@ bool ContractionState<LINE>::SetVisible(Sci::Line lineDocStart, Sci::Line lineDo
 		Check();
 		if ((lineDocStart <= lineDocEnd) && (lineDocStart >= 0) && (lineDocEnd < LinesInDoc())) {
 			bool changed = false;
-			for (Sci::Line line = lineDocStart; line <= lineDocEnd; line++) {
+			for (Sci::Line line = lineDocStart; line <= lineDocEnd;) {
 				if (GetVisible(line) != isVisible) {
 					changed = true;
 					const int heightLine = heights->ValueAt(line_cast(line));
 					const int difference = isVisible ? heightLine : -heightLine;
 					displayLines->InsertText(line_cast(line), difference);
+					line++;
+				} else {
+					// Skip the lines already in the wanted state
+					line = visible->EndRun(line_cast(line));
 				}
 			}
 			if (changed) {
@@ -326,6 +331,23 @@ bool ContractionState<LINE>::SetExpanded(Sci::Line lineDoc, bool isExpanded) {
 	}
 }
 
+template <typename LINE>
+bool ContractionState<LINE>::SetExpandedRange(Sci::Line lineDocStart, Sci::Line lineDocEnd, bool isExpanded) {
+	if (OneToOne() && isExpanded) {
+		return false;
+	} else {
+		EnsureData();
+		if ((lineDocStart <= lineDocEnd) && (lineDocStart >= 0) && (lineDocEnd < LinesInDoc())) {
+			const bool changed = expanded->FillRange(line_cast(lineDocStart), isExpanded ? 1 : 0,
+				line_cast(lineDocEnd - lineDocStart) + 1).changed;
+			Check();
+			return changed;
+		} else {
+			return false;
+		}
+	}
+}
+
 template <typename LINE>
 bool ContractionState<LINE>::ExpandAll() {
 	if (OneToOne()) {
@@ -36,6 +36,7 @@ public:
 
 	virtual bool GetExpanded(Sci::Line lineDoc) const noexcept=0;
 	virtual bool SetExpanded(Sci::Line lineDoc, bool isExpanded)=0;
+	virtual bool SetExpandedRange(Sci::Line lineDocStart, Sci::Line lineDocEnd, bool isExpanded)=0;
 	virtual bool ExpandAll()=0;
 	virtual Sci::Line ContractedNext(Sci::Line lineDocStart) const noexcept =0;
 
@@ -115,6 +115,7 @@ public:
 
 	// Returns changed=true if some values may have changed
 	FillResult<Sci::Position> FillRange(Sci::Position position, int value, Sci::Position fillLength) override;
+	FillResult<Sci::Position> FillRanges(const Sci::Position *ranges, size_t count, int value) override;
 
 	void InsertSpace(Sci::Position position, Sci::Position insertLength) override;
 	void DeleteRange(Sci::Position position, Sci::Position deleteLength) override;
@@ -207,6 +208,40 @@ FillResult<Sci::Position> DecorationList<POS>::FillRange(Sci::Position position,
 	return fr;
 }
 
+template <typename POS>
+FillResult<Sci::Position> DecorationList<POS>::FillRanges(const Sci::Position *ranges, size_t count, int value) {
+	FillResult<Sci::Position> fr { false, 0, 0 };
+	if (count == 0) {
+		return fr;
+	}
+	if (!current) {
+		current = DecorationFromIndicator(currentIndicator);
+		if (!current) {
+			current = Create(currentIndicator, lengthDocument);
+		}
+	}
+	Sci::Position end = 0;
+	for (size_t i = 0; i < count; i++) {
+		const FillResult<POS> frInPOS = current->rs.FillRange(pos_cast(ranges[i * 2]), value, pos_cast(ranges[i * 2 + 1]));
+		if (frInPOS.changed) {
+			const Sci::Position endRange = frInPOS.position + frInPOS.fillLength;
+			if (!fr.changed) {
+				fr.changed = true;
+				fr.position = frInPOS.position;
+				end = endRange;
+			} else {
+				fr.position = std::min<Sci::Position>(fr.position, frInPOS.position);
+				end = std::max(end, endRange);
+			}
+		}
+	}
+	fr.fillLength = end - fr.position;
+	if (current->Empty()) {
+		Delete(currentIndicator);
+	}
+	return fr;
+}
+
 template <typename POS>
 void DecorationList<POS>::InsertSpace(Sci::Position position, Sci::Position insertLength) {
 	const bool atEnd = position == lengthDocument;
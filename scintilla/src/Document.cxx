@@ -6,6 +6,7 @@
 // The License.txt file describes the conditions under which this software may be distributed.
 
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
@@ -337,7 +338,7 @@ void Document::TentativeUndo() {
 						modFlags |= ModificationFlags::MultilineUndoRedo;
 				}
 				NotifyModified(DocModification(modFlags, action.position, action.lenData,
-											   linesAdded, action.data.get()));
+											   linesAdded, action.data));
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -1436,7 +1437,7 @@ Sci::Position Document::Undo() {
 						modFlags |= ModificationFlags::MultilineUndoRedo;
 				}
 				NotifyModified(DocModification(modFlags, action.position, action.lenData,
-											   linesAdded, action.data.get()));
+											   linesAdded, action.data));
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -1496,7 +1497,7 @@ Sci::Position Document::Redo() {
 				}
 				NotifyModified(
 					DocModification(modFlags, action.position, action.lenData,
-									linesAdded, action.data.get()));
+									linesAdded, action.data));
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -1643,6 +1644,48 @@ Sci::Position Document::CountUTF16(Sci::Position startPos, Sci::Position endPos)
 	return count;
 }
 
+// Whether each byte of the line is a UTF-16 code unit, known without scanning the line
+// only when the UTF-16 line index is allocated.
+bool Document::LineCodeUnitsAreBytes(Sci::Line line) const noexcept {
+	if (!dbcsCodePage) {
+		return true;
+	}
+	if (!FlagSet(LineCharacterIndex(), LineCharacterIndexType::Utf16)) {
+		return false;
+	}
+	const Sci::Position widthUTF16 = IndexLineStart(line + 1, LineCharacterIndexType::Utf16) -
+		IndexLineStart(line, LineCharacterIndexType::Utf16);
+	return widthUTF16 == LineStart(line + 1) - LineStart(line);
+}
+
+Sci::Position Document::PositionFromLineCodeUnits(Sci::Line line, Sci::Position codeUnits) const noexcept {
+	if (line < 0) {
+		return 0;
+	}
+	if (line >= LinesTotal()) {
+		return LengthNoExcept();
+	}
+	const Sci::Position lineStart = LineStart(line);
+	if (LineCodeUnitsAreBytes(line)) {
+		return std::clamp<Sci::Position>(lineStart + codeUnits, 0, LengthNoExcept());
+	}
+	const Sci::Position pos = GetRelativePositionUTF16(lineStart, codeUnits);
+	if (pos == Sci::invalidPosition) {
+		return (codeUnits > 0) ? LengthNoExcept() : 0;
+	}
+	return pos;
+}
+
+Sci::Position Document::LineCodeUnitsFromPosition(Sci::Position pos) const noexcept {
+	pos = std::clamp<Sci::Position>(pos, 0, LengthNoExcept());
+	const Sci::Line line = SciLineFromPosition(pos);
+	const Sci::Position lineStart = LineStart(line);
+	if (LineCodeUnitsAreBytes(line)) {
+		return pos - lineStart;
+	}
+	return CountUTF16(lineStart, pos);
+}
+
 Sci::Position Document::FindColumn(Sci::Line line, Sci::Position column) {
 	Sci::Position position = LineStart(line);
 	if ((line >= 0) && (line < LinesTotal())) {
@@ -2050,6 +2093,22 @@ bool Document::HasCaseFolder() const noexcept {
 
 void Document::SetCaseFolder(std::unique_ptr<CaseFolder> pcf_) noexcept {
 	pcf = std::move(pcf_);
+	searchFolder = nullptr;
+}
+
+// Folds the search text into searchFolded, which has at least sizeFolded bytes,
+// unless it is the same text as in the previous search.
+size_t Document::FoldSearchText(const char *search, Sci::Position lengthFind, size_t sizeFolded) {
+	const std::string_view text(search, lengthFind);
+	if (searchFolder != pcf.get() || text != searchText || searchFolded.size() < sizeFolded) {
+		searchFolded.assign(sizeFolded, 0);
+		lenSearchFolded = pcf->Fold(searchFolded.data(), searchFolded.size(), search, lengthFind);
+		searchText = text;
+		searchFolder = pcf.get();
+		searchFoldedAscii = std::all_of(searchFolded.begin(), searchFolded.begin() + lenSearchFolded,
+			[](char ch) noexcept { return UTF8IsAscii(ch); });
+	}
+	return lenSearchFolded;
 }
 
 CharacterExtracted Document::ExtractCharacter(Sci::Position position) const noexcept {
@@ -2085,6 +2144,104 @@ ptrdiff_t SplitFindChar(const SplitView &view, size_t start, size_t length, int
 	return -1;
 }
 
+// Find the first byte that is either ch1, ch2, or not ASCII.
+// Examines 8 bytes at a time as search texts mostly start with an ASCII character
+// and most bytes can then be skipped without folding them.
+size_t FindCharsOrNonAscii(const char *s, size_t length, unsigned char ch1, unsigned char ch2) noexcept {
+	constexpr uint64_t ones = 0x0101010101010101ULL;
+	constexpr uint64_t highs = 0x8080808080808080ULL;
+	const uint64_t pattern1 = ones * ch1;
+	const uint64_t pattern2 = ones * ch2;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+		uint64_t block;
+		memcpy(&block, s + i, sizeof(block));
+		const uint64_t x1 = block ^ pattern1;
+		const uint64_t x2 = block ^ pattern2;
+		// High bit set for any byte that is 0 in x1 or x2 or is not ASCII in block
+		if ((((x1 - ones) & ~x1) | ((x2 - ones) & ~x2) | block) & highs) {
+			break;
+		}
+	}
+	for (; i < length; i++) {
+		const unsigned char ch = s[i];
+		if (ch == ch1 || ch == ch2 || !UTF8IsAscii(ch)) {
+			return i;
+		}
+	}
+	return length;
+}
+
+// Equivalent of FindCharsOrNonAscii over the split view
+ptrdiff_t SplitFindCharsOrNonAscii(const SplitView &view, size_t start, size_t length, unsigned char ch1, unsigned char ch2) noexcept {
+	size_t range1Length = 0;
+	if (start < view.length1) {
+		range1Length = std::min(length, view.length1 - start);
+		const size_t match = FindCharsOrNonAscii(view.segment1 + start, range1Length, ch1, ch2);
+		if (match < range1Length) {
+			return start + match;
+		}
+		start += range1Length;
+	}
+	const size_t range2Length = length - range1Length;
+	const size_t match2 = FindCharsOrNonAscii(view.segment2 + start, range2Length, ch1, ch2);
+	if (match2 < range2Length) {
+		return start + match2;
+	}
+	return -1;
+}
+
+// Lower cases 8 ASCII bytes at once. Adding to a byte below 0x80 can't carry into
+// the next byte, so the high bits tell which bytes are at least 'A' and above 'Z'.
+constexpr uint64_t MakeLowerCaseAscii(uint64_t block) noexcept {
+	constexpr uint64_t ones = 0x0101010101010101ULL;
+	constexpr uint64_t highs = 0x8080808080808080ULL;
+	const uint64_t fromA = block + ones * (0x80 - 'A');
+	const uint64_t aboveZ = block + ones * (0x80 - 'Z' - 1);
+	return block | (((fromA ^ aboveZ) & highs) >> 2);
+}
+
+enum class AsciiMatch { no, yes, unknown };
+
+// Compares the text at start with a folded ASCII search text, 8 bytes at a time.
+// The result is unknown when the text isn't contiguous or contains non-ASCII
+// characters before a difference, as those may fold to ASCII characters.
+AsciiMatch MatchFoldedAscii(const SplitView &view, size_t start, std::string_view folded) noexcept {
+	constexpr uint64_t highs = 0x8080808080808080ULL;
+	const size_t length = folded.length();
+	const char *s = nullptr;
+	if (start + length <= view.length1) {
+		s = view.segment1 + start;
+	} else if (start >= view.length1 && start + length <= view.length) {
+		s = view.segment2 + start;
+	} else {
+		return AsciiMatch::unknown;
+	}
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+		uint64_t block;
+		uint64_t blockFolded;
+		memcpy(&block, s + i, sizeof(block));
+		memcpy(&blockFolded, folded.data() + i, sizeof(blockFolded));
+		if (block & highs) {
+			return AsciiMatch::unknown;
+		}
+		if (MakeLowerCaseAscii(block) != blockFolded) {
+			return AsciiMatch::no;
+		}
+	}
+	for (; i < length; i++) {
+		const unsigned char ch = s[i];
+		if (!UTF8IsAscii(ch)) {
+			return AsciiMatch::unknown;
+		}
+		if (MakeLowerCase(ch) != folded[i]) {
+			return AsciiMatch::no;
+		}
+	}
+	return AsciiMatch::yes;
+}
+
 // Equivalent of memcmp over the split view
 // This does not call memcmp as search texts are commonly too short to overcome the
 // call overhead.
@@ -2182,14 +2339,35 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			}
 		} else if (CpUtf8 == dbcsCodePage) {
 			constexpr size_t maxFoldingExpansion = 4;
-			std::vector<char> searchThing((lengthFind+1) * UTF8MaxBytes * maxFoldingExpansion + 1);
-			const size_t lenSearch =
-				pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
+			const size_t lenSearch = FoldSearchText(search, lengthFind,
+				(lengthFind+1) * UTF8MaxBytes * maxFoldingExpansion + 1);
+			const std::vector<char> &searchThing = searchFolded;
+			const std::string_view searchAscii(searchThing.data(), searchFoldedAscii ? lenSearch : 0);
+			// When the folded search starts with an ASCII character, a match can only start
+			// at that character in either case or at a non-ASCII character that folds to it
+			// so forward searches skip directly to the next such byte.
+			const unsigned char firstSearch = searchThing[0];
+			const bool skipToCandidates = forward && lenSearch && UTF8IsAscii(firstSearch);
+			const unsigned char firstSearchUpper = MakeUpperCase(firstSearch);
 			while (forward ? (pos < endPos) : (pos >= endPos)) {
+				if (skipToCandidates) {
+					pos = SplitFindCharsOrNonAscii(cbView, pos, limitPos - pos, firstSearch, firstSearchUpper);
+					if (pos < 0) {
+						break;
+					}
+				}
 				int widthFirstCharacter = 1;
 				Sci::Position posIndexDocument = pos;
 				size_t indexSearch = 0;
 				bool characterMatches = true;
+				// ASCII text matches an ASCII search text byte by byte, without folding
+				const AsciiMatch asciiMatch = (searchFoldedAscii && (pos + static_cast<Sci::Position>(lenSearch)) <= limitPos) ?
+					MatchFoldedAscii(cbView, pos, searchAscii) : AsciiMatch::unknown;
+				if (asciiMatch != AsciiMatch::unknown) {
+					characterMatches = asciiMatch == AsciiMatch::yes;
+					posIndexDocument += static_cast<Sci::Position>(lenSearch);
+					indexSearch = lenSearch;
+				}
 				while (indexSearch < lenSearch) {
 					const unsigned char leadByte = cbView.CharAt(posIndexDocument);
 					int widthChar = 1;
@@ -2242,8 +2420,9 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 		} else if (dbcsCodePage) {
 			constexpr size_t maxBytesCharacter = 2;
 			constexpr size_t maxFoldingExpansion = 4;
-			std::vector<char> searchThing((lengthFind+1) * maxBytesCharacter * maxFoldingExpansion + 1);
-			const size_t lenSearch = pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
+			const size_t lenSearch = FoldSearchText(search, lengthFind,
+				(lengthFind+1) * maxBytesCharacter * maxFoldingExpansion + 1);
+			const std::vector<char> &searchThing = searchFolded;
 			while (forward ? (pos < endPos) : (pos >= endPos)) {
 				int widthFirstCharacter = 0;
 				Sci::Position indexDocument = 0;
@@ -2296,8 +2475,8 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			}
 		} else {
 			const Sci::Position endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
-			std::vector<char> searchThing(lengthFind + 1);
-			pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
+			FoldSearchText(search, lengthFind, lengthFind + 1);
+			const std::vector<char> &searchThing = searchFolded;
 			while (forward ? (pos < endSearch) : (pos >= endSearch)) {
 				bool found = (pos + lengthFind) <= limitPos;
 				for (int indexSearch = 0; (indexSearch < lengthFind) && found; indexSearch++) {
@@ -2608,6 +2787,16 @@ void SCI_METHOD Document::DecorationFillRange(Sci_Position position, int value,
 	}
 }
 
+// Fills many ranges with a single notification so views only invalidate once
+void Document::DecorationFillRanges(const Sci::Position *ranges, size_t count, int value) {
+	const FillResult<Sci::Position> fr = decorations->FillRanges(ranges, count, value);
+	if (fr.changed) {
+		const DocModification mh(ModificationFlags::ChangeIndicator | ModificationFlags::User,
+							fr.position, fr.fillLength);
+		NotifyModified(mh);
+	}
+}
+
 bool Document::AddWatcher(DocWatcher *watcher, void *userData) {
 	const WatcherWithUserData wwud(watcher, userData);
 	std::vector<WatcherWithUserData>::iterator it =
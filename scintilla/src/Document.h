@@ -305,6 +305,15 @@ private:
 	std::unique_ptr<RegexSearchBase> regex;
 	std::unique_ptr<LexInterface> pli;
 
+	// The search text of the last case insensitive search and its folded form, so
+	// repeated searches for the same text like Find Next and Mark All fold it once.
+	std::string searchText;
+	std::vector<char> searchFolded;
+	size_t lenSearchFolded = 0;
+	bool searchFoldedAscii = false;
+	const CaseFolder *searchFolder = nullptr;
+	size_t FoldSearchText(const char *search, Sci::Position lengthFind, size_t sizeFolded);
+
 public:
 
 	Scintilla::EndOfLine eolMode;
@@ -405,6 +414,9 @@ public:
 	bool TentativeActive() const noexcept { return cb.TentativeActive(); }
 
 	void ChangeHistorySet(bool set) { cb.ChangeHistorySet(set); }
+	void ChangeHistoryCoalesceSet(bool coalesce) noexcept { cb.ChangeHistoryCoalesceSet(coalesce); }
+	void ChangeHistoryDepthSet(int depth) { cb.ChangeHistoryDepthSet(depth); }
+	[[nodiscard]] int ChangeHistoryDepth() const noexcept { return cb.ChangeHistoryDepth(); }
 	[[nodiscard]] int EditionAt(Sci::Position pos) const noexcept { return cb.EditionAt(pos); }
 	[[nodiscard]] Sci::Position EditionEndRun(Sci::Position pos) const noexcept { return cb.EditionEndRun(pos); }
 	[[nodiscard]] unsigned int EditionDeletesAt(Sci::Position pos) const noexcept { return cb.EditionDeletesAt(pos); }
@@ -413,6 +425,7 @@ public:
 	const char * SCI_METHOD BufferPointer() override { return cb.BufferPointer(); }
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept { return cb.RangePointer(position, rangeLength); }
 	Sci::Position GapPosition() const noexcept { return cb.GapPosition(); }
+	size_t AllocatedSize(Scintilla::MemoryPart part) const noexcept { return cb.AllocatedSize(part); }
 
 	int SCI_METHOD GetLineIndentation(Sci_Position line) override;
 	Sci::Position SetLineIndentation(Sci::Line line, Sci::Position indent);
@@ -420,6 +433,9 @@ public:
 	Sci::Position GetColumn(Sci::Position pos) const;
 	Sci::Position CountCharacters(Sci::Position startPos, Sci::Position endPos) const noexcept;
 	Sci::Position CountUTF16(Sci::Position startPos, Sci::Position endPos) const noexcept;
+	bool LineCodeUnitsAreBytes(Sci::Line line) const noexcept;
+	Sci::Position PositionFromLineCodeUnits(Sci::Line line, Sci::Position codeUnits) const noexcept;
+	Sci::Position LineCodeUnitsFromPosition(Sci::Position pos) const noexcept;
 	Sci::Position FindColumn(Sci::Line line, Sci::Position column);
 	void Indent(bool forwards, Sci::Line lineBottom, Sci::Line lineTop);
 	static std::string TransformLineEnds(const char *s, size_t len, Scintilla::EndOfLine eolModeWanted);
@@ -512,6 +528,7 @@ public:
 	void IncrementStyleClock() noexcept;
 	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) override;
 	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
+	void DecorationFillRanges(const Sci::Position *ranges, size_t count, int value);
 	LexInterface *GetLexInterface() const noexcept;
 	void SetLexInterface(std::unique_ptr<LexInterface> pLexInterface) noexcept;
 
@@ -623,7 +640,7 @@ public:
 		position(act.position),
 		length(act.lenData),
 		linesAdded(linesAdded_),
-		text(act.data.get()),
+		text(act.data),
 		line(0),
 		foldLevelNow(Scintilla::FoldLevel::None),
 		foldLevelPrev(Scintilla::FoldLevel::None),
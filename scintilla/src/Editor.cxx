@@ -1633,6 +1633,9 @@ bool Editor::WrapLines(WrapScope ws) {
 		Sci::Line lineToWrap = wrapPending.start;
 		Sci::Line lineToWrapEnd = std::min(wrapPending.end, pdoc->LinesTotal());
 		const Sci::Line lineDocTop = pcs->DocFromDisplay(topLine);
+		// durationWrapOneByte is measured as if single threaded, but WrapBlock lays out the
+		// lines with up to maxLayoutThreads threads, so more text can be wrapped in the same time.
+		const size_t layoutThreads = view.maxLayoutThreads;
 		const Sci::Line subLineTop = topLine - pcs->DisplayFromDoc(lineDocTop);
 		if (ws == WrapScope::wsVisible) {
 			lineToWrap = std::clamp(lineDocTop-5, wrapPending.start, pdoc->LinesTotal());
@@ -1643,8 +1646,8 @@ bool Editor::WrapLines(WrapScope ws) {
 			Sci::Line lines = LinesOnScreen() + 1;
 			constexpr double secondsAllowed = 0.1;
 			const size_t actionsInAllowedTime = std::clamp<Sci::Line>(
-				durationWrapOneByte.ActionsInAllowedTime(secondsAllowed),
-				0x2000, 0x200000);
+				durationWrapOneByte.ActionsInAllowedTime(secondsAllowed) * layoutThreads,
+				0x2000, 0x200000 * layoutThreads);
 			const Sci::Line lineLast = pdoc->LineFromPositionAfter(lineToWrap, actionsInAllowedTime);
 			const Sci::Line maxLine = std::min(lineLast, pcs->LinesInDoc());
 			while ((lineToWrapEnd < maxLine) && (lines>0)) {
@@ -1661,8 +1664,8 @@ bool Editor::WrapLines(WrapScope ws) {
 			// Try to keep time taken by wrapping reasonable so interaction remains smooth.
 			constexpr double secondsAllowed = 0.01;
 			const size_t actionsInAllowedTime = std::clamp<Sci::Line>(
-				durationWrapOneByte.ActionsInAllowedTime(secondsAllowed),
-				0x200, 0x20000);
+				durationWrapOneByte.ActionsInAllowedTime(secondsAllowed) * layoutThreads,
+				0x200, 0x20000 * layoutThreads);
 			lineToWrapEnd = pdoc->LineFromPositionAfter(lineToWrap, actionsInAllowedTime);
 		}
 		const Sci::Line lineEndNeedWrap = std::min(wrapPending.end, pdoc->LinesTotal());
@@ -2071,13 +2074,22 @@ void Editor::InsertCharacter(std::string_view sv, CharacterSource charSource) {
 					currentSel->anchor.SetPosition(positionInsert + lengthInserted);
 				}
 				currentSel->ClearVirtualSpace();
-				// If in wrap mode rewrap current line so EnsureCaretVisible has accurate information
-				if (Wrapping()) {
-					AutoSurface surface(this);
-					if (surface) {
-						if (WrapOneLine(surface, pdoc->SciLineFromPosition(positionInsert))) {
+			}
+		}
+		// If in wrap mode rewrap current lines so EnsureCaretVisible has accurate information.
+		// Done once after all the insertions with a single surface as creating a surface and
+		// rewrapping a line for each of many carets dominates multiple selection typing.
+		if (Wrapping()) {
+			AutoSurface surface(this);
+			if (surface) {
+				Sci::Line lineWrapped = -1;
+				for (const SelectionRange *currentSel : selPtrs) {
+					const Sci::Line line = pdoc->SciLineFromPosition(currentSel->caret.Position());
+					if (line != lineWrapped) {
+						if (WrapOneLine(surface, line)) {
 							wrapOccurred = true;
 						}
+						lineWrapped = line;
 					}
 				}
 			}
@@ -5674,6 +5686,54 @@ void Editor::FoldAll(FoldAction action) {
 	Redraw();
 }
 
+/**
+ * Contract all the fold headers from lineStart to lineEnd in a single pass, hiding their children.
+ * Only the outermost folds need their last child, the others are already hidden.
+ */
+void Editor::ContractFoldRange(Sci::Line lineStart, Sci::Line lineEnd) {
+	lineStart = std::max<Sci::Line>(lineStart, 0);
+	lineEnd = std::min(lineEnd, pdoc->LinesTotal() - 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineEnd + 2));
+	Sci::Line lineHiddenEnd = lineStart - 1;
+	for (Sci::Line line = lineStart; line <= lineEnd; line++) {
+		if (LevelIsHeader(pdoc->GetFoldLevel(line))) {
+			pcs->SetExpanded(line, false);
+			if (line > lineHiddenEnd) {
+				const Sci::Line lineMaxSubord = pdoc->GetLastChild(line);
+				if (lineMaxSubord > line) {
+					pcs->SetVisible(line + 1, lineMaxSubord, false);
+					lineHiddenEnd = lineMaxSubord;
+				}
+			}
+		}
+	}
+	SetScrollBars();
+	Redraw();
+}
+
+/**
+ * Expand all the fold headers from lineStart to lineEnd and their children in a single pass,
+ * showing all their lines. Only the outermost folds need their last child.
+ */
+void Editor::ExpandFoldRange(Sci::Line lineStart, Sci::Line lineEnd) {
+	lineStart = std::max<Sci::Line>(lineStart, 0);
+	lineEnd = std::min(lineEnd, pdoc->LinesTotal() - 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineEnd + 2));
+	Sci::Line lineLast = lineStart - 1;
+	for (Sci::Line line = lineStart; line <= lineEnd; line++) {
+		if (line > lineLast && LevelIsHeader(pdoc->GetFoldLevel(line))) {
+			lineLast = pdoc->GetLastChild(line);
+		}
+	}
+	lineLast = std::max(lineLast, lineEnd);
+	if (lineStart <= lineLast) {
+		pcs->SetExpandedRange(lineStart, lineLast, true);
+		pcs->SetVisible(lineStart, lineLast, true);
+	}
+	SetScrollBars();
+	Redraw();
+}
+
 void Editor::FoldChanged(Sci::Line line, FoldLevel levelNow, FoldLevel levelPrev) {
 	if (LevelIsHeader(levelNow)) {
 		if (!LevelIsHeader(levelPrev)) {
@@ -7420,6 +7480,23 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		StyleSetMessage(iMessage, wParam, lParam);
 		break;
 
+	case Message::StyleSetTable: {
+			// style, fore, back, bold, italic, eolFilled for each style
+			const int *styles = static_cast<const int *>(PtrFromSPtr(lParam));
+			for (uptr_t i = 0; i < wParam; i++) {
+				const int *entry = styles + i * 6;
+				vs.EnsureStyle(entry[0]);
+				Style &style = vs.styles[entry[0]];
+				style.fore = ColourRGBA::FromIpRGB(entry[1]);
+				style.back = ColourRGBA::FromIpRGB(entry[2]);
+				style.weight = entry[3] != 0 ? FontWeight::Bold : FontWeight::Normal;
+				style.italic = entry[4] != 0;
+				style.eolFilled = entry[5] != 0;
+			}
+			InvalidateStyleRedraw();
+		}
+		break;
+
 	case Message::StyleGetFore:
 	case Message::StyleGetBack:
 	case Message::StyleGetBold:
@@ -7669,6 +7746,14 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		FoldExpand(LineFromUPtr(wParam), FoldAction::Expand, static_cast<FoldLevel>(lParam));
 		break;
 
+	case Message::ContractFoldRange:
+		ContractFoldRange(LineFromUPtr(wParam), lParam);
+		break;
+
+	case Message::ExpandFoldRange:
+		ExpandFoldRange(LineFromUPtr(wParam), lParam);
+		break;
+
 	case Message::ContractedFoldNext:
 		return ContractedFoldNext(LineFromUPtr(wParam));
 
@@ -7940,6 +8025,11 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			lParam);
 		break;
 
+	case Message::IndicatorFillRanges:
+		pdoc->DecorationFillRanges(static_cast<const Sci::Position *>(PtrFromSPtr(lParam)), wParam,
+			pdoc->decorations->GetCurrentValue());
+		break;
+
 	case Message::IndicatorAllOnFor:
 		return pdoc->decorations->AllOnFor(PositionFromUPtr(wParam));
 
@@ -8441,14 +8531,29 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetGapPosition:
 		return pdoc->GapPosition();
 
+	case Message::GetMemoryUsage: {
+			const MemoryPart part = static_cast<MemoryPart>(wParam);
+			if (part == MemoryPart::Layout)
+				return view.llc.AllocatedSize();
+			return pdoc->AllocatedSize(part);
+		}
+
 	case Message::SetChangeHistory:
 		changeHistoryOption = static_cast<ChangeHistoryOption>(wParam);
 		pdoc->ChangeHistorySet(wParam & 1);
+		pdoc->ChangeHistoryCoalesceSet(FlagSet(changeHistoryOption, ChangeHistoryOption::Coalesce));
 		break;
 
 	case Message::GetChangeHistory:
 		return static_cast<sptr_t>(changeHistoryOption);
 
+	case Message::SetChangeHistoryDepth:
+		pdoc->ChangeHistoryDepthSet(static_cast<int>(wParam));
+		break;
+
+	case Message::GetChangeHistoryDepth:
+		return pdoc->ChangeHistoryDepth();
+
 	case Message::SetExtraAscent:
 		vs.extraAscent = static_cast<int>(wParam);
 		InvalidateStyleRedraw();
@@ -8854,6 +8959,12 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::CountCodeUnits:
 		return pdoc->CountUTF16(PositionFromUPtr(wParam), lParam);
 
+	case Message::PositionFromLineCodeUnits:
+		return pdoc->PositionFromLineCodeUnits(LineFromUPtr(wParam), lParam);
+
+	case Message::LineCodeUnitsFromPosition:
+		return pdoc->LineCodeUnitsFromPosition(PositionFromUPtr(wParam));
+
 	default:
 		return DefWndProc(iMessage, wParam, lParam);
 	}
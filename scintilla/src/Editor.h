@@ -581,6 +581,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void FoldChanged(Sci::Line line, Scintilla::FoldLevel levelNow, Scintilla::FoldLevel levelPrev);
 	void NeedShown(Sci::Position pos, Sci::Position len);
 	void FoldAll(Scintilla::FoldAction action);
+	void ContractFoldRange(Sci::Line lineStart, Sci::Line lineEnd);
+	void ExpandFoldRange(Sci::Line lineStart, Sci::Line lineEnd);
 
 	Sci::Position GetTag(char *tagValue, int tagNumber);
 	enum class ReplaceType {basic, patterns, minimal};
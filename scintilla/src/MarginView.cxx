@@ -115,12 +115,15 @@ void DrawWrapMarker(Surface *surface, PRectangle rcPlace,
 MarginView::MarginView() noexcept {
 	wrapMarkerPaddingRight = 3;
 	customDrawWrapMarker = nullptr;
+	numberWidthsFont = nullptr;
 }
 
 void MarginView::DropGraphics() noexcept {
 	pixmapSelMargin.reset();
 	pixmapSelPattern.reset();
 	pixmapSelPatternOffset1.reset();
+	numberWidths.clear();
+	numberWidthsFont = nullptr;
 }
 
 void MarginView::RefreshPixMaps(Surface *surfaceWindow, const ViewStyle &vsDraw) {
@@ -390,7 +393,7 @@ void MarginView::PaintOneMargin(Surface *surface, PRectangle rc, PRectangle rcOn
 				}
 				PRectangle rcNumber = rcMarker;
 				// Right justify
-				const XYPOSITION width = surface->WidthText(vs.styles[StyleLineNumber].font.get(), sNumber);
+				const XYPOSITION width = NumberWidth(surface, vs.styles[StyleLineNumber].font.get(), sNumber);
 				const XYPOSITION xpos = rcNumber.right - width - vs.marginNumberPadding;
 				rcNumber.left = xpos;
 				DrawTextNoClipPhase(surface, rcNumber, vs.styles[StyleLineNumber],
@@ -461,6 +464,22 @@ void MarginView::PaintOneMargin(Surface *surface, PRectangle rc, PRectangle rcOn
 	}
 }
 
+XYPOSITION MarginView::NumberWidth(Surface *surface, const Font *font, const std::string &sNumber) const {
+	// Scrolling through a big document shows many numbers so limit the cache
+	constexpr size_t maxNumberWidths = 5000;
+	if (font != numberWidthsFont || numberWidths.size() >= maxNumberWidths) {
+		numberWidths.clear();
+		numberWidthsFont = font;
+	}
+	const std::map<std::string, XYPOSITION>::const_iterator it = numberWidths.find(sNumber);
+	if (it != numberWidths.end()) {
+		return it->second;
+	}
+	const XYPOSITION width = surface->WidthText(font, sNumber);
+	numberWidths[sNumber] = width;
+	return width;
+}
+
 void MarginView::PaintMargin(Surface *surface, Sci::Line topLine, PRectangle rc, PRectangle rcMargin,
 	const EditModel &model, const ViewStyle &vs) {
 
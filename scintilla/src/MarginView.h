@@ -32,12 +32,17 @@ public:
 	 * existing platforms must implement as empty. */
 	DrawWrapMarkerFn customDrawWrapMarker;
 
+	// Widths of line number strings, which are measured again for each line on each paint otherwise
+	mutable std::map<std::string, XYPOSITION> numberWidths;
+	mutable const Font *numberWidthsFont;
+
 	MarginView() noexcept;
 
 	void DropGraphics() noexcept;
 	void RefreshPixMaps(Surface *surfaceWindow, const ViewStyle &vsDraw);
 	void PaintOneMargin(Surface *surface, PRectangle rc, PRectangle rcOneMargin, const MarginStyle &marginStyle,
 		const EditModel &model, const ViewStyle &vs) const;
+	XYPOSITION NumberWidth(Surface *surface, const Font *font, const std::string &sNumber) const;
 	void PaintMargin(Surface *surface, Sci::Line topLine, PRectangle rc, PRectangle rcMargin,
 		const EditModel &model, const ViewStyle &vs);
 };
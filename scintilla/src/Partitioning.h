@@ -91,6 +91,10 @@ public:
 		return PositionFromPartition(Partitions());
 	}
 
+	size_t AllocatedSize() const noexcept {
+		return body.AllocatedSize();
+	}
+
 	void InsertPartition(T partition, T pos) {
 		if (stepPartition < partition) {
 			ApplyStep(partition);
@@ -159,6 +163,18 @@ public:
 		body.Delete(partition);
 	}
 
+	// Removes count partitions at once, as many calls to RemovePartition would
+	void RemovePartitions(T partition, T count) {
+		if (count <= 0) {
+			return;
+		}
+		if (partition + count > stepPartition) {
+			ApplyStep(partition + count);
+		}
+		stepPartition -= count;
+		body.DeleteRange(partition, count);
+	}
+
 	T PositionFromPartition(T partition) const noexcept {
 		PLATFORM_ASSERT(partition >= 0);
 		PLATFORM_ASSERT(partition < body.Length());
@@ -125,6 +125,20 @@ void LineLayout::Free() noexcept {
 	bidiData.reset();
 }
 
+size_t LineLayout::AllocatedSize() const noexcept {
+	size_t size = sizeof(LineLayout) + lenLineStarts * sizeof(int);
+	if (chars) {
+		const size_t lineAllocation = maxLineLength + 1;
+		size += lineAllocation * (sizeof(char) + sizeof(unsigned char)) +
+			(lineAllocation + 1) * sizeof(XYPOSITION);
+	}
+	if (bidiData) {
+		size += bidiData->stylesFonts.capacity() * sizeof(std::shared_ptr<Font>) +
+			bidiData->widthReprs.capacity() * sizeof(XYPOSITION);
+	}
+	return size;
+}
+
 void LineLayout::ClearPositions() {
 	std::fill(&positions[0], &positions[maxLineLength + 2], 0.0f);
 }
@@ -484,6 +498,10 @@ constexpr size_t AlignUp(size_t value, size_t alignment) noexcept {
 
 constexpr size_t alignmentLLC = 20;
 
+// Cache::page holds this many screens of lines so scrolling back and forth
+// by a page, or a second view scrolled nearby, finds the layouts again.
+constexpr Sci::Line screensLLC = 4;
+
 constexpr bool GraphicASCII(char ch) noexcept {
 	return ch >= ' ' && ch <= '~';
 }
@@ -514,7 +532,7 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 	if (level == LineCache::Caret) {
 		lengthForLevel = 1;
 	} else if (level == LineCache::Page) {
-		lengthForLevel = AlignUp(linesOnScreen + 1, alignmentLLC);
+		lengthForLevel = AlignUp(linesOnScreen * screensLLC + 1, alignmentLLC);
 	} else if (level == LineCache::Document) {
 		lengthForLevel = AlignUp(linesInDoc, alignmentLLC);
 	}
@@ -566,6 +584,16 @@ void LineLayoutCache::Deallocate() noexcept {
 	cache.clear();
 }
 
+size_t LineLayoutCache::AllocatedSize() const noexcept {
+	size_t size = cache.capacity() * sizeof(std::shared_ptr<LineLayout>);
+	for (const std::shared_ptr<LineLayout> &ll : cache) {
+		if (ll) {
+			size += ll->AllocatedSize();
+		}
+	}
+	return size;
+}
+
 void LineLayoutCache::Invalidate(LineLayout::ValidLevel validity_) noexcept {
 	if (!cache.empty() && !allInvalidated) {
 		for (const std::shared_ptr<LineLayout> &ll : cache) {
@@ -59,6 +59,14 @@ void RunStyles<DISTANCE, STYLE>::RemoveRun(DISTANCE run) {
 	styles.DeleteRange(run, 1);
 }
 
+template <typename DISTANCE, typename STYLE>
+void RunStyles<DISTANCE, STYLE>::RemoveRuns(DISTANCE run, DISTANCE count) {
+	if (count > 0) {
+		starts.RemovePartitions(run, count);
+		styles.DeleteRange(run, count);
+	}
+}
+
 template <typename DISTANCE, typename STYLE>
 void RunStyles<DISTANCE, STYLE>::RemoveRunIfEmpty(DISTANCE run) {
 	if ((run < starts.Partitions()) && (starts.Partitions() > 1)) {
@@ -132,9 +140,20 @@ FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, ST
 		return resultNoChange;
 	}
 	DISTANCE end = position + fillLength;
-	if (end > Length()) {
+	const DISTANCE length = Length();
+	if (end > length) {
 		return resultNoChange;
 	}
+	if ((position == 0) && (end == length) && (Runs() > 1)) {
+		// Filling everything, such as clearing an indicator, so start again with one run
+		// instead of removing each run and release the memory of the old runs
+		starts.DeleteAll();
+		starts.InsertText(0, length);
+		styles = SplitVector<STYLE>();
+		styles.InsertValue(0, 1, value);
+		styles.InsertValue(1, 1, 0);
+		return FillResult<DISTANCE>{ true, position, fillLength };
+	}
 	DISTANCE runEnd = RunFromPosition(end);
 	if (styles.ValueAt(runEnd) == value) {
 		// End already has value so trim range.
@@ -162,10 +181,8 @@ FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, ST
 	if (runStart < runEnd) {
 		const FillResult<DISTANCE> result{ true, position, fillLength };
 		styles.SetValueAt(runStart, value);
-		// Remove each old run over the range
-		for (DISTANCE run=runStart+1; run<runEnd; run++) {
-			RemoveRun(runStart+1);
-		}
+		// Remove the old runs over the range
+		RemoveRuns(runStart+1, runEnd-runStart-1);
 		runEnd = RunFromPosition(end);
 		RemoveRunIfSameAsPrevious(runEnd);
 		RemoveRunIfSameAsPrevious(runStart);
@@ -231,10 +248,8 @@ void RunStyles<DISTANCE, STYLE>::DeleteRange(DISTANCE position, DISTANCE deleteL
 		runStart = SplitRun(position);
 		runEnd = SplitRun(end);
 		starts.InsertText(runStart, -deleteLength);
-		// Remove each old run over the range
-		for (DISTANCE run=runStart; run<runEnd; run++) {
-			RemoveRun(runStart);
-		}
+		// Remove the old runs over the range
+		RemoveRuns(runStart, runEnd-runStart);
 		RemoveRunIfEmpty(runStart);
 		RemoveRunIfSameAsPrevious(runStart);
 	}
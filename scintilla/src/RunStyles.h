@@ -30,6 +30,7 @@ private:
 	DISTANCE RunFromPosition(DISTANCE position) const noexcept;
 	DISTANCE SplitRun(DISTANCE position);
 	void RemoveRun(DISTANCE run);
+	void RemoveRuns(DISTANCE run, DISTANCE count);
 	void RemoveRunIfEmpty(DISTANCE run);
 	void RemoveRunIfSameAsPrevious(DISTANCE run);
 public:
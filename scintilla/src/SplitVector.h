@@ -332,6 +332,11 @@ public:
 	ptrdiff_t GapPosition() const noexcept {
 		return part1Length;
 	}
+
+	/// Return the number of bytes allocated, including the gap.
+	size_t AllocatedSize() const noexcept {
+		return body.capacity() * sizeof(T);
+	}
 };
 
 }
@@ -6,10 +6,13 @@
 // The License.txt file describes the conditions under which this software may be distributed.
 
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
 
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <algorithm>
 
 #include "UniConversion.h"
 
@@ -35,6 +38,25 @@ size_t UTF8Length(std::wstring_view wsv) noexcept {
 	return len;
 }
 
+// Returns the number of ASCII bytes at the start of svu8.
+// Most text is ASCII so the conversions skip over runs of it, checking 8 bytes at once.
+size_t UTF8AsciiRunLength(std::string_view svu8) noexcept {
+	constexpr uint64_t highBits = 0x8080808080808080ULL;
+	const char *s = svu8.data();
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= svu8.length(); i += sizeof(uint64_t)) {
+		uint64_t block;
+		memcpy(&block, s + i, sizeof(block));
+		if (block & highBits) {
+			break;
+		}
+	}
+	while (i < svu8.length() && UTF8IsAscii(s[i])) {
+		i++;
+	}
+	return i;
+}
+
 size_t UTF8PositionFromUTF16Position(std::string_view u8Text, size_t positionUTF16) noexcept {
 	size_t positionUTF8 = 0;
 	for (size_t lengthUTF16 = 0; (positionUTF8 < u8Text.length()) && (lengthUTF16 < positionUTF16);) {
@@ -99,6 +121,12 @@ void UTF8FromUTF32Character(int uch, char *putf) noexcept {
 size_t UTF16Length(std::string_view svu8) noexcept {
 	size_t ulen = 0;
 	for (size_t i = 0; i< svu8.length();) {
+		const size_t asciiRun = UTF8AsciiRunLength(svu8.substr(i));
+		if (asciiRun > 0) {
+			i += asciiRun;
+			ulen += asciiRun;
+			continue;
+		}
 		const unsigned char ch = svu8[i];
 		const unsigned int byteCount = UTF8BytesOfLead[ch];
 		const unsigned int utf16Len = UTF16LengthFromUTF8ByteCount(byteCount);
@@ -117,6 +145,15 @@ constexpr unsigned char TrailByteValue(unsigned char c) {
 size_t UTF16FromUTF8(std::string_view svu8, wchar_t *tbuf, size_t tlen) {
 	size_t ui = 0;
 	for (size_t i = 0; i < svu8.length();) {
+		// copy ASCII runs directly, leaving overflow to be reported below
+		const size_t asciiRun = std::min(UTF8AsciiRunLength(svu8.substr(i)), tlen - std::min(ui, tlen));
+		if (asciiRun > 0) {
+			for (size_t end = i + asciiRun; i < end; i++) {
+				tbuf[ui++] = static_cast<unsigned char>(svu8[i]);
+			}
+			continue;
+		}
+
 		unsigned char ch = svu8[i];
 		const unsigned int byteCount = UTF8BytesOfLead[ch];
 		unsigned int value;
@@ -176,6 +213,12 @@ size_t UTF16FromUTF8(std::string_view svu8, wchar_t *tbuf, size_t tlen) {
 size_t UTF32Length(std::string_view svu8) noexcept {
 	size_t ulen = 0;
 	for (size_t i = 0; i < svu8.length();) {
+		const size_t asciiRun = UTF8AsciiRunLength(svu8.substr(i));
+		if (asciiRun > 0) {
+			i += asciiRun;
+			ulen += asciiRun;
+			continue;
+		}
 		const unsigned char ch = svu8[i];
 		const unsigned int byteCount = UTF8BytesOfLead[ch];
 		i += byteCount;
@@ -187,6 +230,15 @@ size_t UTF32Length(std::string_view svu8) noexcept {
 size_t UTF32FromUTF8(std::string_view svu8, unsigned int *tbuf, size_t tlen) {
 	size_t ui = 0;
 	for (size_t i = 0; i < svu8.length();) {
+		// copy ASCII runs directly, leaving overflow to be reported below
+		const size_t asciiRun = std::min(UTF8AsciiRunLength(svu8.substr(i)), tlen - std::min(ui, tlen));
+		if (asciiRun > 0) {
+			for (size_t end = i + asciiRun; i < end; i++) {
+				tbuf[ui++] = static_cast<unsigned char>(svu8[i]);
+			}
+			continue;
+		}
+
 		unsigned char ch = svu8[i];
 		const unsigned int byteCount = UTF8BytesOfLead[ch];
 		unsigned int value;
@@ -367,6 +419,12 @@ bool UTF8IsValid(std::string_view svu8) noexcept {
 	const unsigned char *us = reinterpret_cast<const unsigned char *>(svu8.data());
 	size_t remaining = svu8.length();
 	while (remaining > 0) {
+		const size_t asciiRun = UTF8AsciiRunLength(std::string_view(reinterpret_cast<const char *>(us), remaining));
+		us += asciiRun;
+		remaining -= asciiRun;
+		if (remaining == 0) {
+			break;
+		}
 		const int utf8Status = UTF8Classify(us, remaining);
 		if (utf8Status & UTF8MaskInvalid) {
 			return false;
@@ -15,6 +15,7 @@ constexpr int UTF8MaxBytes = 4;
 constexpr int unicodeReplacementChar = 0xFFFD;
 
 size_t UTF8Length(std::wstring_view wsv) noexcept;
+size_t UTF8AsciiRunLength(std::string_view svu8) noexcept;
 size_t UTF8PositionFromUTF16Position(std::string_view u8Text, size_t positionUTF16) noexcept;
 void UTF8FromUTF16(std::wstring_view wsv, char *putf, size_t len) noexcept;
 void UTF8FromUTF32Character(int uch, char *putf) noexcept;
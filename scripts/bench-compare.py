@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# Compares the results of the benchmarks in tests/ written with --json (see
+# tests/bench.h), e.g. of the previous and the current release:
+#
+#   bench-compare.py [--threshold PERCENT] OLD NEW
+#
+# OLD and NEW are result files or directories containing bench-*.json files.
+# Prints the average time of every result in both and the change, and exits
+# with status 1 if any result got slower by more than the threshold.
+
+import argparse
+import json
+import os
+import sys
+
+
+def load_results(path):
+	if os.path.isdir(path):
+		files = sorted(os.path.join(path, f) for f in os.listdir(path)
+			if f.startswith('bench-') and f.endswith('.json'))
+	else:
+		files = [path]
+
+	results = {}
+	for file_name in files:
+		with open(file_name, encoding='utf-8') as f:
+			data = json.load(f)
+		# the same benchmark is run with different options to the files
+		group = os.path.splitext(os.path.basename(file_name))[0]
+		if group.startswith('bench-'):
+			group = group[len('bench-'):]
+		elif len(files) == 1:
+			group = data['benchmark']
+		for result in data['results']:
+			results[(group, result['name'])] = result
+	return results
+
+
+def format_change(old_ms, new_ms):
+	if old_ms <= 0:
+		return 'n/a'
+	return '{:+.1f}%'.format((new_ms - old_ms) * 100.0 / old_ms)
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Compare benchmark results.')
+	parser.add_argument('--threshold', type=float, default=10.0,
+		help='report results slower by more than PERCENT as regressions (default: 10)',
+		metavar='PERCENT')
+	parser.add_argument('old', help='result file or directory of the baseline')
+	parser.add_argument('new', help='result file or directory to compare')
+	args = parser.parse_args()
+
+	old = load_results(args.old)
+	new = load_results(args.new)
+	if not old or not new:
+		sys.exit('No benchmark results found')
+
+	regressions = 0
+	print('{:<12} {:<20} {:>12} {:>12} {:>9}'.format('benchmark', 'name', 'old ms', 'new ms', 'change'))
+	for key in sorted(set(old) | set(new)):
+		group, name = key
+		if key not in old or key not in new:
+			print('{:<12} {:<20} {:>12} {:>12} {:>9}'.format(group, name,
+				'{:.3f}'.format(old[key]['avg_ms']) if key in old else '-',
+				'{:.3f}'.format(new[key]['avg_ms']) if key in new else '-', ''))
+			continue
+
+		old_ms = old[key]['avg_ms']
+		new_ms = new[key]['avg_ms']
+		# results of different sizes aren't comparable
+		if old[key]['size'] != new[key]['size']:
+			change = 'size'
+		else:
+			change = format_change(old_ms, new_ms)
+			if old_ms > 0 and (new_ms - old_ms) * 100.0 / old_ms > args.threshold:
+				change += ' !'
+				regressions += 1
+		print('{:<12} {:<20} {:>12.3f} {:>12.3f} {:>9}'.format(group, name, old_ms, new_ms, change))
+
+	if regressions:
+		print('{} result(s) slower by more than {}%'.format(regressions, args.threshold))
+		sys.exit(1)
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,337 @@
+/*
+ *      braceindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2023 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Index of the matching braces of big documents, so matching a brace doesn't
+ * need to scan the text between the braces each time the caret moves.
+ *
+ * The index is built in the background the first time a brace is matched. Like
+ * SCI_BRACEMATCH, a brace only matches braces of the same kind and style, so
+ * braces in strings and comments don't match braces in code. An edit drops the
+ * part of the index after it, which is then built again. Braces not covered by
+ * the index are matched with SCI_BRACEMATCH.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "braceindex.h"
+
+#include "documentprivate.h"
+#include "sciwrappers.h"
+
+#include <glib.h>
+
+
+/* smaller documents are matched with SCI_BRACEMATCH directly */
+#define BRACE_INDEX_MIN_LENGTH (1024 * 1024)
+/* the amount of text styled and indexed at once */
+#define BRACE_INDEX_CHUNK (64 * 1024)
+/* the maximum time spent in a single idle callback, in microseconds */
+#define BRACE_INDEX_TIME_SLICE 20000
+/* ( [ { < and their style */
+#define BRACE_INDEX_KEYS (4 * 256)
+
+
+typedef struct
+{
+	gint pos;
+	gint match;		/* -1 if not matched (yet) */
+	guint16 key;	/* brace kind and style */
+	gboolean open;
+}
+BraceEntry;
+
+struct BraceIndex
+{
+	GArray *entries;	/* BraceEntry sorted by position */
+	gint scanned;		/* end of the indexed text */
+	/* indexes in entries of the open braces not matched yet, for each key */
+	GArray *stacks[BRACE_INDEX_KEYS];
+	gboolean stacks_valid;
+	guint source_id;
+};
+
+
+static gint get_brace_kind(gchar c, gboolean *open)
+{
+	*open = TRUE;
+	switch (c)
+	{
+		case ')': *open = FALSE; /* fall through */
+		case '(': return 0;
+		case ']': *open = FALSE; /* fall through */
+		case '[': return 1;
+		case '}': *open = FALSE; /* fall through */
+		case '{': return 2;
+		case '>': *open = FALSE; /* fall through */
+		case '<': return 3;
+	}
+	return -1;
+}
+
+
+static GArray *get_stack(BraceIndex *index, guint16 key)
+{
+	if (! index->stacks[key])
+		index->stacks[key] = g_array_new(FALSE, FALSE, sizeof(guint));
+	return index->stacks[key];
+}
+
+
+static void clear_stacks(BraceIndex *index)
+{
+	guint i;
+
+	for (i = 0; i < BRACE_INDEX_KEYS; i++)
+	{
+		if (index->stacks[i])
+			g_array_set_size(index->stacks[i], 0);
+	}
+}
+
+
+/* Restores the open braces not matched before the end of the indexed text.
+ * Matches from after it are stale since the invalidation. */
+static void rebuild_stacks(BraceIndex *index)
+{
+	guint i;
+
+	clear_stacks(index);
+	for (i = 0; i < index->entries->len; i++)
+	{
+		BraceEntry *entry = &g_array_index(index->entries, BraceEntry, i);
+
+		if (entry->open && (entry->match < 0 || entry->match >= index->scanned))
+		{
+			entry->match = -1;
+			g_array_append_val(get_stack(index, entry->key), i);
+		}
+	}
+	index->stacks_valid = TRUE;
+}
+
+
+static void add_brace(BraceIndex *index, gint pos, gint kind, gboolean open, gint style)
+{
+	BraceEntry entry = {pos, -1, (guint16) (kind * 256 + (style & 0xff)), open};
+	GArray *stack = get_stack(index, entry.key);
+
+	if (open)
+		g_array_append_val(stack, index->entries->len);
+	else if (stack->len > 0)
+	{
+		guint i = g_array_index(stack, guint, stack->len - 1);
+
+		g_array_index(index->entries, BraceEntry, i).match = pos;
+		entry.match = g_array_index(index->entries, BraceEntry, i).pos;
+		g_array_set_size(stack, stack->len - 1);
+	}
+	g_array_append_val(index->entries, entry);
+}
+
+
+static void index_range(BraceIndex *index, ScintillaObject *sci, gint end)
+{
+	const gchar *text;
+	gint start = index->scanned;
+	gint i;
+
+	if (sci_get_end_styled(sci) < end)
+		sci_colourise(sci, sci_get_end_styled(sci), end);
+
+	text = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start, end - start);
+	for (i = 0; i < end - start; i++)
+	{
+		gboolean open;
+		gint kind = get_brace_kind(text[i], &open);
+
+		if (kind >= 0)
+			add_brace(index, start + i, kind, open, sci_get_style_at(sci, start + i));
+	}
+	index->scanned = end;
+}
+
+
+static gboolean index_idle(gpointer user_data)
+{
+	GeanyDocument *doc = document_find_by_id(GPOINTER_TO_UINT(user_data));
+	BraceIndex *index;
+	ScintillaObject *sci;
+	gint64 start;
+	gint len;
+
+	if (! doc || ! doc->priv->brace_index)
+		return G_SOURCE_REMOVE;
+
+	index = doc->priv->brace_index;
+	sci = doc->editor->sci;
+	if (! index->stacks_valid)
+		rebuild_stacks(index);
+
+	start = g_get_monotonic_time();
+	len = sci_get_length(sci);
+	while (index->scanned < len)
+	{
+		index_range(index, sci, MIN(index->scanned + BRACE_INDEX_CHUNK, len));
+		if (g_get_monotonic_time() - start > BRACE_INDEX_TIME_SLICE)
+			return G_SOURCE_CONTINUE;
+	}
+
+	/* keep the stacks, text appended later can still match the open braces */
+	index->source_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+
+static void schedule_indexing(GeanyDocument *doc)
+{
+	BraceIndex *index = doc->priv->brace_index;
+
+	if (! index->source_id)
+		index->source_id = g_idle_add_full(G_PRIORITY_LOW, index_idle,
+			GUINT_TO_POINTER(doc->id), NULL);
+}
+
+
+static BraceEntry *find_entry(BraceIndex *index, gint pos)
+{
+	guint lo = 0, hi = index->entries->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+		BraceEntry *entry = &g_array_index(index->entries, BraceEntry, mid);
+
+		if (entry->pos == pos)
+			return entry;
+		if (entry->pos < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
+}
+
+
+/* Drops the part of the index from pos onwards, since text was inserted or
+ * deleted at pos. The stacks are rebuilt lazily to keep this cheap while typing. */
+void brace_index_invalidate(GeanyDocument *doc, gint pos)
+{
+	BraceIndex *index = doc->priv->brace_index;
+
+	if (! index)
+		return;
+
+	if (pos < index->scanned)
+	{
+		guint lo = 0, hi = index->entries->len;
+
+		while (lo < hi)
+		{
+			guint mid = lo + (hi - lo) / 2;
+
+			if (g_array_index(index->entries, BraceEntry, mid).pos < pos)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		g_array_set_size(index->entries, lo);
+		index->scanned = MAX(pos, 0);
+		index->stacks_valid = FALSE;
+	}
+	/* also index text added after the indexed part */
+	schedule_indexing(doc);
+}
+
+
+/* Returns the position of the brace matching the one at pos, or -1. */
+gint brace_index_find_match(GeanyDocument *doc, gint pos)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	BraceIndex *index = doc->priv->brace_index;
+
+	if (! index)
+	{
+		if (sci_get_length(sci) < BRACE_INDEX_MIN_LENGTH)
+			return sci_find_matching_brace(sci, pos);
+
+		index = g_new0(BraceIndex, 1);
+		index->entries = g_array_new(FALSE, FALSE, sizeof(BraceEntry));
+		doc->priv->brace_index = index;
+		schedule_indexing(doc);
+	}
+
+	if (pos >= 0 && pos < index->scanned)
+	{
+		BraceEntry *entry = find_entry(index, pos);
+
+		/* matches after the indexed text may be stale */
+		if (entry && entry->match >= 0 && entry->match < index->scanned)
+			return entry->match;
+		/* closing braces only match braces before them, which are all indexed */
+		if (entry && entry->match < 0 &&
+			(! entry->open || index->scanned == sci_get_length(sci)))
+			return -1;
+	}
+	return sci_find_matching_brace(sci, pos);
+}
+
+
+/* Returns the number of bytes allocated for the index of doc. */
+gsize brace_index_get_memory_size(GeanyDocument *doc)
+{
+	BraceIndex *index = doc->priv->brace_index;
+	gsize size;
+	guint i;
+
+	if (! index)
+		return 0;
+
+	size = sizeof(BraceIndex) + index->entries->len * sizeof(BraceEntry);
+	for (i = 0; i < BRACE_INDEX_KEYS; i++)
+	{
+		if (index->stacks[i])
+			size += index->stacks[i]->len * sizeof(guint);
+	}
+	return size;
+}
+
+
+void brace_index_free(GeanyDocument *doc)
+{
+	BraceIndex *index = doc->priv->brace_index;
+	guint i;
+
+	if (! index)
+		return;
+
+	if (index->source_id)
+		g_source_remove(index->source_id);
+	for (i = 0; i < BRACE_INDEX_KEYS; i++)
+	{
+		if (index->stacks[i])
+			g_array_free(index->stacks[i], TRUE);
+	}
+	g_array_free(index->entries, TRUE);
+	g_free(index);
+	doc->priv->brace_index = NULL;
+}
@@ -0,0 +1,47 @@
+/*
+ *      braceindex.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2023 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef GEANY_BRACEINDEX_H
+#define GEANY_BRACEINDEX_H 1
+
+#include "document.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#ifdef GEANY_PRIVATE
+
+typedef struct BraceIndex BraceIndex;
+
+gint brace_index_find_match(GeanyDocument *doc, gint pos);
+
+void brace_index_invalidate(GeanyDocument *doc, gint pos);
+
+gsize brace_index_get_memory_size(GeanyDocument *doc);
+
+void brace_index_free(GeanyDocument *doc);
+
+#endif /* GEANY_PRIVATE */
+
+G_END_DECLS
+
+#endif /* GEANY_BRACEINDEX_H */
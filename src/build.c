@@ -813,7 +813,7 @@ static void build_spawn_cmd(GeanyDocument *doc, const gchar *cmd, const gchar *d
 	build_info.file_type_id = (doc == NULL) ? GEANY_FILETYPES_NONE : doc->file_type->id;
 	build_info.message_count = 0;
 
-	if (!spawn_with_callbacks(working_dir, cmd, argv, NULL, 0, NULL, NULL, build_iofunc,
+	if (!spawn_with_callbacks(working_dir, cmd, argv, NULL, SPAWN_LINES, NULL, NULL, build_iofunc,
 		GINT_TO_POINTER(0), 0, build_iofunc, GINT_TO_POINTER(1), 0, build_exit_cb, NULL,
 		&build_info.pid, &error))
 	{
@@ -1013,15 +1013,19 @@ static void process_build_output_line(gchar *msg, gint color)
 
 	if (line != -1 && filename != NULL)
 	{
-		GeanyDocument *doc = document_find_by_filename(filename);
-
-		/* limit number of indicators */
-		if (doc && editor_prefs.use_indicators &&
+		/* limit number of indicators, and only look up the document for those as
+		 * resolving the real path of each error's file is slow with lots of errors */
+		if (editor_prefs.use_indicators &&
 			build_info.message_count < GEANY_BUILD_ERR_HIGHLIGHT_MAX)
 		{
-			if (line > 0) /* some compilers, like pdflatex report errors on line 0 */
-				line--;   /* so only adjust the line number if it is greater than 0 */
-			editor_indicator_set_on_line(doc->editor, GEANY_INDICATOR_ERROR, line);
+			GeanyDocument *doc = document_find_by_filename(filename);
+
+			if (doc)
+			{
+				if (line > 0) /* some compilers, like pdflatex report errors on line 0 */
+					line--;   /* so only adjust the line number if it is greater than 0 */
+				editor_indicator_set_on_line(doc->editor, GEANY_INDICATOR_ERROR, line);
+			}
 		}
 		build_info.message_count++;
 		color = COLOR_RED;	/* error message parsed on the line */
@@ -1042,8 +1046,17 @@ static void build_iofunc(GString *string, GIOCondition condition, gpointer data)
 {
 	if (condition & (G_IO_IN | G_IO_PRI))
 	{
-		process_build_output_line(string->str,
-			(GPOINTER_TO_INT(data)) ? COLOR_DARK_RED : COLOR_BLACK);
+		gchar *line = string->str;
+
+		/* several lines, see SPAWN_LINES */
+		while (line < string->str + string->len)
+		{
+			gsize len = strlen(line);
+
+			process_build_output_line(line,
+				(GPOINTER_TO_INT(data)) ? COLOR_DARK_RED : COLOR_BLACK);
+			line += len + 1;
+		}
 	}
 }
 
@@ -1261,7 +1274,7 @@ static void on_build_menu_item(GtkWidget *w, gpointer user_data)
 		if (!document_save_file(doc, FALSE))
 			return;
 	}
-	g_signal_emit_by_name(geany_object, "build-start");
+	geany_object_emit("build-start");
 
 	if (grp == GEANY_GBG_NON_FT && cmd == GBO_TO_CMD(GEANY_GBO_CUSTOM))
 	{
@@ -42,6 +42,7 @@
 #include "keyfile.h"
 #include "log.h"
 #include "main.h"
+#include "memusage.h"
 #include "msgwindow.h"
 #include "navqueue.h"
 #include "plugins.h"
@@ -49,6 +50,7 @@
 #include "prefs.h"
 #include "printing.h"
 #include "sciwrappers.h"
+#include "search.h"
 #include "sidebar.h"
 #include "spawn.h"
 #ifdef HAVE_SOCKET
@@ -78,6 +80,13 @@
 
 
 
+/* tab switches less than this apart (in milliseconds) only activate the last document */
+#define ACTIVATE_DELAY 150
+
+static guint activate_source_id = 0;
+static gint64 last_switch_time = 0;
+
+
 /* wrapper function to abort exit process if cancel button is pressed */
 static gboolean on_window_delete_event(GtkWidget *widget, GdkEvent *event, gpointer gdata)
 {
@@ -111,7 +120,7 @@ void on_save1_activate(GtkMenuItem *menuitem, gpointer user_data)
 
 	if (doc != NULL)
 	{
-		document_save_file(doc, ui_prefs.allow_always_save);
+		document_save_file_async(doc, ui_prefs.allow_always_save);
 	}
 }
 
@@ -136,7 +145,7 @@ void on_save_all1_activate(GtkMenuItem *menuitem, gpointer user_data)
 		if (! doc->changed)
 			continue;
 
-		if (document_save_file(doc, FALSE))
+		if (document_save_file_async(doc, FALSE))
 			count++;
 	}
 	if (!count)
@@ -446,6 +455,12 @@ void on_entry_tagfilter_changed(GtkAction *action, gpointer user_data)
 		return;
 
 	filter_entry = GTK_ENTRY(ui_lookup_widget(main_widgets.window, "entry_tagfilter"));
+	/* switching documents sets the filter of the new document, its tree is up to date */
+	if (utils_str_equal(gtk_entry_get_text(filter_entry), doc->priv->tag_filter))
+	{
+		sidebar_update_tag_list(doc, FALSE);
+		return;
+	}
 	g_free(doc->priv->tag_filter);
 	doc->priv->tag_filter = g_strdup(gtk_entry_get_text(filter_entry));
 
@@ -515,12 +530,57 @@ void on_normal_size1_activate(GtkMenuItem *menuitem, gpointer user_data)
 }
 
 
+/* Updates the parts of the UI showing doc, which just became the current document,
+ * and emits "document-activate" */
+static void activate_document(GeanyDocument *doc)
+{
+	GtkEntry *filter_entry = GTK_ENTRY(ui_lookup_widget(main_widgets.window, "entry_tagfilter"));
+	const gchar *entry_text = gtk_entry_get_text(filter_entry);
+
+	sidebar_select_openfiles_item(doc);
+	ui_update_statusbar(doc, -1);
+	build_menu_update(doc);
+	if (g_strcmp0(entry_text, doc->priv->tag_filter) != 0)
+	{
+		/* calls sidebar_update_tag_list() in on_entry_tagfilter_changed() */
+		gtk_entry_set_text(filter_entry, doc->priv->tag_filter);
+	}
+	else
+	{
+		/* the symbol tree of doc is kept while it isn't shown and marked dirty when
+		 * the tags change, so it only needs to be shown */
+		sidebar_update_tag_list(doc, FALSE);
+	}
+	document_highlight_tags(doc);
+
+	document_queue_disk_check(doc);
+
+#ifdef HAVE_VTE
+	vte_cwd((doc->real_path != NULL) ? doc->real_path : doc->file_name, FALSE);
+#endif
+
+	geany_object_emit("document-activate", doc);
+}
+
+
+static gboolean activate_document_timeout(gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+
+	activate_source_id = 0;
+	if (doc != NULL && ! main_status.quitting)
+		activate_document(doc);
+	return G_SOURCE_REMOVE;
+}
+
+
 /* Changes window-title after switching tabs and lots of other things.
  * note: using 'after' makes Scintilla redraw before the UI, appearing more responsive */
 static void on_notebook1_switch_page_after(GtkNotebook *notebook, gpointer page,
 		guint page_num, gpointer user_data)
 {
 	GeanyDocument *doc;
+	gint64 now;
 
 	if (G_UNLIKELY(main_status.opening_session_files || main_status.closing_all))
 		return;
@@ -529,32 +589,24 @@ static void on_notebook1_switch_page_after(GtkNotebook *notebook, gpointer page,
 
 	if (doc != NULL)
 	{
-		GtkEntry *filter_entry = GTK_ENTRY(ui_lookup_widget(main_widgets.window, "entry_tagfilter"));
-		const gchar *entry_text = gtk_entry_get_text(filter_entry);
-
-		sidebar_select_openfiles_item(doc);
+		document_finish_deferred_init(doc);
 		ui_save_buttons_toggle(doc->changed);
 		ui_set_window_title(doc);
-		ui_update_statusbar(doc, -1);
 		ui_update_popup_reundo_items(doc);
 		ui_document_show_hide(doc); /* update the document menu */
-		build_menu_update(doc);
-		if (g_strcmp0(entry_text, doc->priv->tag_filter) != 0)
+
+		/* When flipping through tabs, only activate the one the user stops at. A single
+		 * switch is still handled right away, e.g. for code switching tabs itself. */
+		now = g_get_monotonic_time();
+		if (activate_source_id != 0 || now - last_switch_time < ACTIVATE_DELAY * 1000)
 		{
-			/* calls sidebar_update_tag_list() in on_entry_tagfilter_changed() */
-			gtk_entry_set_text(filter_entry, doc->priv->tag_filter);
+			if (activate_source_id != 0)
+				g_source_remove(activate_source_id);
+			activate_source_id = g_timeout_add(ACTIVATE_DELAY, activate_document_timeout, NULL);
 		}
 		else
-			sidebar_update_tag_list(doc, TRUE);
-		document_highlight_tags(doc);
-
-		document_check_disk_status(doc, TRUE);
-
-#ifdef HAVE_VTE
-		vte_cwd((doc->real_path != NULL) ? doc->real_path : doc->file_name, FALSE);
-#endif
-
-		g_signal_emit_by_name(geany_object, "document-activate", doc);
+			activate_document(doc);
+		last_switch_time = now;
 	}
 }
 
@@ -1506,7 +1558,7 @@ void on_remove_markers1_activate(GtkMenuItem *menuitem, gpointer user_data)
 
 	sci_marker_delete_all(doc->editor->sci, 0);	/* delete the yellow tag marker */
 	sci_marker_delete_all(doc->editor->sci, 1);	/* delete user markers */
-	editor_indicator_clear(doc->editor, GEANY_INDICATOR_SEARCH);
+	search_mark_all(doc, NULL, 0);	/* delete search indicators */
 }
 
 
@@ -1788,6 +1840,12 @@ static void on_debug_messages1_activate(GtkMenuItem *menuitem, gpointer user_dat
 }
 
 
+static void on_memory_usage1_activate(GtkMenuItem *menuitem, gpointer user_data)
+{
+	memusage_show_report();
+}
+
+
 void on_send_selection_to_vte1_activate(GtkMenuItem *menuitem, gpointer user_data)
 {
 #ifdef HAVE_VTE
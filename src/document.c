@@ -30,6 +30,7 @@
 #include "document.h"
 
 #include "app.h"
+#include "braceindex.h"
 #include "callbacks.h" /* for ignore_callback */
 #include "dialogs.h"
 #include "documentprivate.h"
@@ -48,8 +49,11 @@
 #include "project.h"
 #include "sciwrappers.h"
 #include "sidebar.h"
+#include "stallwatch.h"
 #include "support.h"
 #include "symbols.h"
+#include "tm_ctags.h"
+#include "toolbar.h"
 #include "ui_utils.h"
 #include "utils.h"
 #include "vte.h"
@@ -83,9 +87,39 @@
 
 #define USE_GIO_FILE_OPERATIONS (!file_prefs.use_safe_file_saving && file_prefs.use_gio_unsafe_file_saving)
 
+/* The delay of tag list updates while typing is at least this many times the
+ * duration of the last update so slow parsers don't keep interrupting typing */
+#define TAG_LIST_UPDATE_DELAY_FACTOR 5
+/* Upper bound of the extended delay, in milliseconds */
+#define TAG_LIST_UPDATE_MAX_DELAY 5000
+
+/* Scintilla document options used for files opened in large file mode */
+#define LARGE_FILE_DOCUMENT_OPTIONS (SC_DOCUMENTOPTION_TEXT_LARGE | SC_DOCUMENTOPTION_STYLES_NONE)
+/* Size of the blocks read, converted and added to Scintilla when loading in the background */
+#define LOAD_CHUNK_SIZE (1024 * 1024)
+/* Type keywords differing by at most this many words are updated without setting all of them */
+#define KEYWORDS_DIFF_MAX 100
+/* Bigger documents only use this many evenly spread lines to detect the indentation */
+#define INDENT_DETECTION_SAMPLE_LINES 5000
+/* Incremental searches of the search bar in bigger documents search this much text from
+ * the caret, which covers the visible part, right away and continue in the background
+ * with chunks of this size */
+#define SEARCH_BAR_CHUNK (1024 * 1024)
+/* The maximum time spent in a single idle callback of the background search, in microseconds */
+#define SEARCH_BAR_TIME_SLICE 20000
+
 
 GeanyFilePrefs file_prefs;
-GPtrArray *documents_array = NULL;
+GEANY_EXPORT_SYMBOL GPtrArray *documents_array = NULL;
+
+/* Source files of the documents closed by force_close_all(), removed from the
+ * workspace at once when all are closed */
+static GPtrArray *closed_tm_files = NULL;
+
+/* Disk checks queued by document_queue_disk_check(), done by a worker thread */
+static GThreadPool *disk_check_pool = NULL;
+static GHashTable *queued_disk_checks = NULL;	/* IDs of the documents to check */
+static guint disk_check_source_id = 0;
 
 
 /* an undo action, also used for redo actions */
@@ -123,6 +157,8 @@ static void document_undo_clear(GeanyDocument *doc);
 static void document_undo_add_internal(GeanyDocument *doc, guint type, gpointer data);
 static void document_redo_add(GeanyDocument *doc, guint type, gpointer data);
 static gboolean remove_page(guint page_num);
+static void finish_background_save(struct BackgroundSave *save);
+static gboolean on_background_save_finished(gpointer data);
 static GtkWidget* document_show_message(GeanyDocument *doc, GtkMessageType msgtype,
 	void (*response_cb)(GtkWidget *info_bar, gint response_id, GeanyDocument *doc),
 	const gchar *btn_1, GtkResponseType response_1,
@@ -271,6 +307,69 @@ GeanyDocument *document_find_by_id(guint id)
 }
 
 
+/** Gets an immutable snapshot of the contents of a document.
+ *
+ * The snapshot keeps the text the document had when it was taken, even after the
+ * document is modified or closed, and it can be read from any thread. It is
+ * shared by all callers until the next modification of the document so taking
+ * it again for an unchanged document is cheap.
+ *
+ * The data are followed by a NUL byte not included in the size of the bytes.
+ *
+ * @param doc The document.
+ * @param version @out @optional Return location for the version of the text,
+ * which changes each time the document is modified.
+ *
+ * @return @transfer{full} The contents of the document, free it with
+ * @c g_bytes_unref().
+ *
+ * @since 2.1 (GEANY_API_VERSION 250)
+ */
+GEANY_API_SYMBOL
+GBytes *document_get_snapshot(GeanyDocument *doc, guint *version)
+{
+	GeanyDocumentPrivate *priv;
+
+	g_return_val_if_fail(DOC_VALID(doc), NULL);
+
+	priv = doc->priv;
+	if (! priv->snapshot)
+	{
+		ScintillaObject *sci = doc->editor->sci;
+		gint len = sci_get_length(sci);
+		gint gap = CLAMP((gint) SSM(sci, SCI_GETGAPPOSITION, 0, 0), 0, len);
+		gchar *data = g_malloc(len + 1);
+
+		/* copy both sides of Scintilla's gap, without moving it like
+		 * SCI_GETCHARACTERPOINTER would */
+		if (gap > 0)
+			memcpy(data, (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, 0, gap), gap);
+		if (len > gap)
+			memcpy(data + gap, (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, gap, len - gap),
+				len - gap);
+		data[len] = '\0';
+		priv->snapshot = g_bytes_new_take(data, len);
+	}
+
+	if (version)
+		*version = priv->text_version;
+	return g_bytes_ref(priv->snapshot);
+}
+
+
+/* Called on each insertion or deletion of text. The snapshot of the previous
+ * text stays valid for whoever holds a reference to it. */
+void document_text_modified(GeanyDocument *doc)
+{
+	doc->priv->text_version++;
+	if (doc->priv->snapshot)
+	{
+		g_bytes_unref(doc->priv->snapshot);
+		doc->priv->snapshot = NULL;
+	}
+}
+
+
 /* gets the widget the main_widgets.notebook consider is its child for this document */
 static GtkWidget *document_get_notebook_child(GeanyDocument *doc)
 {
@@ -390,6 +489,7 @@ GeanyDocument *document_get_current(void)
 }
 
 
+GEANY_EXPORT_SYMBOL
 void document_init_doclist(void)
 {
 	documents_array = g_ptr_array_new();
@@ -400,6 +500,22 @@ void document_finalize(void)
 {
 	guint i;
 
+	if (disk_check_source_id != 0)
+	{
+		g_source_remove(disk_check_source_id);
+		disk_check_source_id = 0;
+	}
+	if (disk_check_pool != NULL)
+	{
+		g_thread_pool_free(disk_check_pool, TRUE, TRUE);
+		disk_check_pool = NULL;
+	}
+	if (queued_disk_checks != NULL)
+	{
+		g_hash_table_destroy(queued_disk_checks);
+		queued_disk_checks = NULL;
+	}
+
 	for (i = 0; i < documents_array->len; i++)
 		g_free(documents[i]);
 	g_ptr_array_free(documents_array, TRUE);
@@ -712,8 +828,12 @@ static gboolean remove_page(guint page_num)
 	if (! main_status.closing_all && doc->changed && ! dialogs_show_unsaved_file(doc))
 		return FALSE;
 
+	/* let plugins see the end of a save before the document is closed */
+	if (doc->priv->background_save)
+		finish_background_save(doc->priv->background_save);
+
 	/* tell any plugins that the document is about to be closed */
-	g_signal_emit_by_name(geany_object, "document-close", doc);
+	geany_object_emit("document-close", doc);
 
 	/* Checking real_path makes it likely the file exists on disk */
 	if (! main_status.closing_all && doc->real_path != NULL)
@@ -736,14 +856,27 @@ static gboolean remove_page(guint page_num)
 		notebook_remove_page(page_num);
 		sidebar_remove_document(doc);
 		navqueue_remove_file(doc->file_name);
-		msgwin_status_add(_("File %s closed."), DOC_FILENAME(doc));
+		if (! main_status.closing_all)
+			msgwin_status_add(_("File %s closed."), DOC_FILENAME(doc));
+	}
+	if (doc->priv->load_cancellable)
+	{
+		/* stops the thread, which sees the document is gone once done */
+		g_cancellable_cancel(doc->priv->load_cancellable);
+		g_object_unref(doc->priv->load_cancellable);
 	}
 	g_free(doc->encoding);
 	g_free(doc->priv->saved_encoding.encoding);
 	g_free(doc->priv->tag_filter);
+	g_free(doc->priv->keywords);
+	if (doc->priv->snapshot)
+		g_bytes_unref(doc->priv->snapshot);
+	brace_index_free(doc);
 	g_free(doc->file_name);
 	g_free(doc->real_path);
-	if (doc->tm_file)
+	if (doc->tm_file && closed_tm_files)
+		g_ptr_array_add(closed_tm_files, doc->tm_file);
+	else if (doc->tm_file)
 	{
 		tm_workspace_remove_source_file(doc->tm_file);
 		tm_source_file_free(doc->tm_file);
@@ -887,7 +1020,7 @@ GeanyDocument *document_new_file(const gchar *utf8_filename, GeanyFiletype *ft,
 	/* "the" SCI signal (connect after initial setup(i.e. adding text)) */
 	g_signal_connect(doc->editor->sci, "sci-notify", G_CALLBACK(editor_sci_notify_cb), doc->editor);
 
-	g_signal_emit_by_name(geany_object, "document-new", doc);
+	geany_object_emit("document-new", doc);
 
 	msgwin_status_add(_("New file \"%s\" opened."),
 		DOC_FILENAME(doc));
@@ -923,13 +1056,32 @@ typedef struct
 	gboolean	 bom;
 	time_t		 mtime;	/* modification time, read by stat::st_mtime */
 	gboolean	 readonly;
+	gboolean	 preloaded;	/* read by document_preload_file() */
 } FileData;
 
 
-static gboolean get_mtime(const gchar *locale_filename, time_t *time)
+/* A file read and decoded by a thread before it gets opened */
+typedef struct
+{
+	gchar		*locale_filename;
+	gchar		*forced_enc;
+	FileData	 filedata;
+	gboolean	 loaded;	/* whether filedata is set */
+	gboolean	 done;		/* whether the thread is finished with it, see preload_mutex */
+} PreloadedFile;
+
+static GHashTable *preloaded_files = NULL;	/* locale filename -> PreloadedFile */
+static GThreadPool *preload_pool = NULL;
+static GMutex preload_mutex;
+static GCond preload_cond;
+
+
+/* Can be called from any thread.
+ * @return The error message if the file could not be queried, @c NULL on success. */
+static gchar *query_mtime(const gchar *locale_filename, time_t *time)
 {
 	GError *error = NULL;
-	const gchar *err_msg = NULL;
+	gchar *err_msg = NULL;
 
 	if (USE_GIO_FILE_OPERATIONS)
 	{
@@ -945,7 +1097,10 @@ static gboolean get_mtime(const gchar *locale_filename, time_t *time)
 			*time = timeval.tv_sec;
 		}
 		else if (error)
-			err_msg = error->message;
+		{
+			err_msg = g_strdup(error->message);
+			g_error_free(error);
+		}
 
 		g_object_unref(file);
 	}
@@ -956,22 +1111,183 @@ static gboolean get_mtime(const gchar *locale_filename, time_t *time)
 		if (g_stat(locale_filename, &st) == 0)
 			*time = st.st_mtime;
 		else
-			err_msg = g_strerror(errno);
+			err_msg = g_strdup(g_strerror(errno));
 	}
 
+	return err_msg;
+}
+
+
+static void show_mtime_error(const gchar *locale_filename, const gchar *err_msg)
+{
+	gchar *utf8_filename = utils_get_utf8_from_locale(locale_filename);
+
+	ui_set_statusbar(TRUE, _("Could not open file %s (%s)"),
+		utf8_filename, err_msg);
+	g_free(utf8_filename);
+}
+
+
+static gboolean get_mtime(const gchar *locale_filename, time_t *time)
+{
+	gchar *err_msg = query_mtime(locale_filename, time);
+
 	if (err_msg)
 	{
-		gchar *utf8_filename = utils_get_utf8_from_locale(locale_filename);
+		show_mtime_error(locale_filename, err_msg);
+		g_free(err_msg);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+static gboolean is_large_file(gsize len)
+{
+	return file_prefs.large_file_threshold > 0 &&
+		len >= (gsize) file_prefs.large_file_threshold * 1024 * 1024;
+}
+
+
+static void free_preloaded_file(gpointer data)
+{
+	PreloadedFile *pf = data;
+
+	g_free(pf->locale_filename);
+	g_free(pf->forced_enc);
+	if (pf->loaded)
+	{
+		g_free(pf->filedata.data);
+		g_free(pf->filedata.enc);
+	}
+	g_free(pf);
+}
 
-		ui_set_statusbar(TRUE, _("Could not open file %s (%s)"),
-			utf8_filename, err_msg);
-		g_free(utf8_filename);
+
+/* Does the reading and conversion of load_text_file() in a thread pool. Errors aren't
+ * reported, the file is then just loaded again by load_text_file() to report them. */
+static void preload_file_thread(gpointer data, gpointer user_data)
+{
+	PreloadedFile *pf = data;
+	FileData *filedata = &pf->filedata;
+	gboolean loaded = FALSE;
+	GStatBuf st;
+
+	if (g_stat(pf->locale_filename, &st) == 0 && S_ISREG(st.st_mode) &&
+		! is_large_file((gsize) st.st_size) &&
+		g_file_get_contents(pf->locale_filename, &filedata->data, &filedata->len, NULL))
+	{
+		filedata->mtime = st.st_mtime;
+		filedata->enc = NULL;
+		filedata->bom = FALSE;
+		filedata->readonly = FALSE;
+		filedata->preloaded = TRUE;
+
+		loaded = encodings_convert_to_utf8_auto(&filedata->data, &filedata->len,
+			pf->forced_enc, &filedata->enc, &filedata->bom, &filedata->readonly);
+		if (! loaded)
+			g_free(filedata->data);
 	}
 
-	if (error)
-		g_error_free(error);
+	g_mutex_lock(&preload_mutex);
+	pf->loaded = loaded;
+	pf->done = TRUE;
+	g_cond_broadcast(&preload_cond);
+	g_mutex_unlock(&preload_mutex);
+}
+
+
+static gint get_preload_thread_count(void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	return (gint) g_get_num_processors();
+#else
+	return 4;
+#endif
+}
+
+
+/* Starts reading and decoding a file in a thread, so that opening it later with
+ * document_open_file_full() only has to set up the document. This is used to open many
+ * files at once, e.g. the session files, and the documents opened with the preloaded
+ * data defer their symbols and indentation detection until they are first shown
+ * (see document_finish_deferred_init()).
+ * document_clear_preloaded_files() must be called once the files are opened. */
+void document_preload_file(const gchar *locale_filename, const gchar *forced_enc)
+{
+	PreloadedFile *pf;
+	gchar *filename;
+
+	if (USE_GIO_FILE_OPERATIONS || utils_is_remote_path(locale_filename))
+		return;
+
+	/* like document_open_file_full() does before loading the file */
+	filename = g_strdup(locale_filename);
+	utils_tidy_path(filename);
+
+	if (preloaded_files == NULL)
+	{
+		preloaded_files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_preloaded_file);
+		preload_pool = g_thread_pool_new(preload_file_thread, NULL, get_preload_thread_count(),
+			FALSE, NULL);
+	}
+	else if (g_hash_table_lookup(preloaded_files, filename) != NULL)
+	{
+		g_free(filename);
+		return;
+	}
+
+	pf = g_new0(PreloadedFile, 1);
+	pf->locale_filename = filename;
+	pf->forced_enc = g_strdup(forced_enc);
+	g_hash_table_insert(preloaded_files, pf->locale_filename, pf);
+	g_thread_pool_push(preload_pool, pf, NULL);
+}
+
 
-	return err_msg == NULL;
+/* Frees the files preloaded by document_preload_file() which weren't opened. */
+void document_clear_preloaded_files(void)
+{
+	if (preloaded_files == NULL)
+		return;
+
+	/* skip the files not read yet and wait for the ones being read */
+	g_thread_pool_free(preload_pool, TRUE, TRUE);
+	preload_pool = NULL;
+	g_hash_table_destroy(preloaded_files);
+	preloaded_files = NULL;
+}
+
+
+/* Takes the data of the file if it was preloaded with the same forced encoding,
+ * waiting for the thread to be done with it. */
+static gboolean take_preloaded_file(const gchar *locale_filename, const gchar *forced_enc,
+	FileData *filedata)
+{
+	PreloadedFile *pf;
+	gboolean loaded;
+
+	if (preloaded_files == NULL)
+		return FALSE;
+
+	pf = g_hash_table_lookup(preloaded_files, locale_filename);
+	if (pf == NULL || g_strcmp0(pf->forced_enc, forced_enc) != 0)
+		return FALSE;
+
+	g_mutex_lock(&preload_mutex);
+	while (! pf->done)
+		g_cond_wait(&preload_cond, &preload_mutex);
+	g_mutex_unlock(&preload_mutex);
+
+	loaded = pf->loaded;
+	if (loaded)
+	{
+		*filedata = pf->filedata;
+		pf->loaded = FALSE;
+	}
+	/* the file is read again when it's reopened */
+	g_hash_table_remove(preloaded_files, locale_filename);
+	return loaded;
 }
 
 
@@ -986,6 +1302,10 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 	filedata->enc = NULL;
 	filedata->bom = FALSE;
 	filedata->readonly = FALSE;
+	filedata->preloaded = FALSE;
+
+	if (take_preloaded_file(locale_filename, forced_enc, filedata))
+		goto loaded;
 
 	if (!get_mtime(locale_filename, &filedata->mtime))
 		return FALSE;
@@ -1025,6 +1345,7 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 		return FALSE;
 	}
 
+loaded:
 	if (filedata->readonly)
 	{
 		const gchar *warn_msg = _(
@@ -1074,34 +1395,86 @@ static gint set_cursor_position(GeanyEditor *editor, gint pos)
 }
 
 
+typedef struct
+{
+	gint width;			/* indentation width */
+	gint tabs;			/* leading tabs */
+	gint spaces;		/* spaces right after the leading tabs */
+	gint prefix_len;	/* length of the measured whitespace */
+	gchar first, second;	/* first characters of the line, or '\0' */
+	gchar next;			/* character after the measured whitespace, or '\0' */
+}
+LineIndent;
+
+
+/* Measures the leading whitespace of line, reading it from the buffer at once. The
+ * width is computed like sci_get_line_indentation() with tab_width and the measure
+ * stops once the width exceeds max_width. */
+static void get_line_indent(ScintillaObject *sci, gint line, gint tab_width, gint max_width,
+		LineIndent *indent)
+{
+	gint start = sci_get_position_from_line(sci, line);
+	gint len = sci_get_line_end_position(sci, line) - start;
+	const gchar *text = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start, len);
+	gint i;
+
+	memset(indent, 0, sizeof *indent);
+	for (i = 0; i < len && indent->width <= max_width; i++)
+	{
+		if (text[i] == '\t')
+		{
+			/* only count the tabs before the first space */
+			if (indent->spaces == 0)
+				indent->tabs++;
+			indent->width = (indent->width / tab_width + 1) * tab_width;
+		}
+		else if (text[i] == ' ')
+		{
+			/* only count the spaces after the leading tabs */
+			if (indent->tabs == i - indent->spaces)
+				indent->spaces++;
+			indent->width++;
+		}
+		else
+			break;
+	}
+	indent->first = (len > 0) ? text[0] : '\0';
+	indent->second = (len > 1) ? text[1] : '\0';
+	indent->next = (i < len) ? text[i] : '\0';
+	indent->prefix_len = i;
+}
+
+
+/* Returns the distance between the lines sampled to detect the indentation, so big
+ * documents only check an evenly spread subset of their lines. */
+static gint get_indent_sample_step(ScintillaObject *sci)
+{
+	return MAX(1, sci_get_line_count(sci) / INDENT_DETECTION_SAMPLE_LINES);
+}
+
+
 /* Count lines that start with some hard tabs then a soft tab. */
 static gboolean detect_tabs_and_spaces(GeanyEditor *editor)
 {
 	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(editor);
 	ScintillaObject *sci = editor->sci;
-	gsize count = 0;
-	struct Sci_TextToFind ttf;
-	gchar *soft_tab = g_strnfill((gsize)iprefs->width, ' ');
-	gchar *regex = g_strconcat("^\t+", soft_tab, "[^ ]", NULL);
-
-	g_free(soft_tab);
+	gint line, line_count = sci_get_line_count(sci);
+	gint step = get_indent_sample_step(sci);
+	gsize count = 0, sampled = 0;
 
-	ttf.chrg.cpMin = 0;
-	ttf.chrg.cpMax = sci_get_length(sci);
-	ttf.lpstrText = regex;
-	while (1)
+	for (line = 0; line < line_count; line += step)
 	{
-		gint pos;
-
-		pos = sci_find_text(sci, SCFIND_REGEXP, &ttf);
-		if (pos == -1)
-			break;	/* no more matches */
-		count++;
-		ttf.chrg.cpMin = ttf.chrgText.cpMax + 1;	/* search after this match */
+		LineIndent indent;
+
+		get_line_indent(sci, line, 8, G_MAXINT, &indent);
+		/* like the regex "^\t+ {width}[^ ]", whitespace after the spaces can only be tabs */
+		if (indent.tabs > 0 && indent.spaces == iprefs->width &&
+			(indent.prefix_len > indent.tabs + indent.spaces || indent.next != '\0'))
+			count++;
+		sampled++;
 	}
-	g_free(regex);
 	/* The 0.02 is a low weighting to ignore a few possibly accidental occurrences */
-	return count > sci_get_line_count(sci) * 0.02;
+	return count > sampled * 0.02;
 }
 
 
@@ -1111,7 +1484,7 @@ gboolean document_detect_indent_type(GeanyDocument *doc, GeanyIndentType *type_)
 {
 	GeanyEditor *editor = doc->editor;
 	ScintillaObject *sci = editor->sci;
-	gint line, line_count;
+	gint line, line_count, step, tab_width;
 	gsize tabs = 0, spaces = 0;
 
 	if (detect_tabs_and_spaces(editor))
@@ -1121,21 +1494,22 @@ gboolean document_detect_indent_type(GeanyDocument *doc, GeanyIndentType *type_)
 	}
 
 	line_count = sci_get_line_count(sci);
-	for (line = 0; line < line_count; line++)
+	step = get_indent_sample_step(sci);
+	tab_width = sci_get_tab_width(sci);
+	for (line = 0; line < line_count; line += step)
 	{
-		gint pos = sci_get_position_from_line(sci, line);
-		gchar c;
+		LineIndent indent;
 
+		get_line_indent(sci, line, tab_width, 24, &indent);
 		/* most code will have indent total <= 24, otherwise it's more likely to be
 		 * alignment than indentation */
-		if (sci_get_line_indentation(sci, line) > 24)
+		if (indent.width > 24)
 			continue;
 
-		c = sci_get_char_at(sci, pos);
-		if (c == '\t')
+		if (indent.first == '\t')
 			tabs++;
 		/* check for at least 2 spaces */
-		else if (c == ' ' && sci_get_char_at(sci, pos + 1) == ' ')
+		else if (indent.first == ' ' && indent.second == ' ')
 			spaces++;
 	}
 	if (spaces == 0 && tabs == 0)
@@ -1159,7 +1533,7 @@ static gboolean detect_indent_width(GeanyEditor *editor, GeanyIndentType type, g
 {
 	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(editor);
 	ScintillaObject *sci = editor->sci;
-	gint line, line_count;
+	gint line, line_count, step;
 	gint widths[7] = { 0 }; /* width can be from 2 to 8 */
 	gint count, width, i;
 
@@ -1171,19 +1545,22 @@ static gboolean detect_indent_width(GeanyEditor *editor, GeanyIndentType type, g
 	sci_set_tab_width(sci, 8);
 
 	line_count = sci_get_line_count(sci);
-	for (line = 0; line < line_count; line++)
+	step = get_indent_sample_step(sci);
+	for (line = 0; line < line_count; line += step)
 	{
-		gint pos = sci_get_line_indent_position(sci, line);
+		LineIndent indent;
+
+		get_line_indent(sci, line, 8, 24, &indent);
 
 		/* We probably don't have style info yet, because we're generally called just after
 		 * the document got created, so we can't use highlighting_is_code_style().
 		 * That's not good, but the assumption below that concerning lines start with an
 		 * asterisk (common continuation character for C/C++/Java/...) should do the trick
 		 * without removing too much legitimate lines. */
-		if (sci_get_char_at(sci, pos) == '*')
+		if (indent.next == '*')
 			continue;
 
-		width = sci_get_line_indentation(sci, line);
+		width = indent.width;
 		/* most code will have indent total <= 24, otherwise it's more likely to be
 		 * alignment than indentation */
 		if (width > 24)
@@ -1273,6 +1650,22 @@ void document_apply_indent_settings(GeanyDocument *doc)
 }
 
 
+/* Parses the symbols of a document opened from a preloaded file, see
+ * document_preload_file(). It's done when the document is first shown, like applying
+ * the filetype settings queued by document_queue_reload_config(). */
+void document_finish_deferred_init(GeanyDocument *doc)
+{
+	if (doc->priv->reload_config_pending)
+		document_reload_config(doc);
+
+	if (! doc->priv->init_pending)
+		return;
+
+	doc->priv->init_pending = FALSE;
+	document_update_tags(doc);
+}
+
+
 void document_show_tab(GeanyDocument *doc)
 {
 	if (show_tab_idle)
@@ -1281,6 +1674,8 @@ void document_show_tab(GeanyDocument *doc)
 		show_tab_idle = 0;
 	}
 
+	document_finish_deferred_init(doc);
+
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(main_widgets.notebook),
 		document_get_notebook_page(doc));
 
@@ -1317,110 +1712,541 @@ void document_show_tab_idle(GeanyDocument *doc)
  * pos is the cursor position, which can be overridden by --line and --column.
  * forced_enc can be NULL to detect the file encoding.
  * Returns: doc of the opened file or NULL if an error occurred. */
-GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
-		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc)
+/* Replaces the (still empty) Scintilla document of @a doc with @a pdoc, created with
+ * LARGE_FILE_DOCUMENT_OPTIONS: no style buffer and 64-bit positions. Expensive
+ * per-line features like folding and change history are disabled, and the caller
+ * uses the None filetype so there is no lexer, no tag parsing and no language server. */
+static void document_set_large_file_mode(GeanyDocument *doc, sptr_t pdoc)
 {
-	gint editor_mode;
-	gboolean reload = (doc == NULL) ? FALSE : TRUE;
-	gchar *utf8_filename = NULL;
-	gchar *display_filename = NULL;
-	gchar *locale_filename = NULL;
-	GeanyFiletype *use_ft;
-	FileData filedata;
-	UndoReloadData *undo_reload_data;
-	gboolean add_undo_reload_action;
+	ScintillaObject *sci = doc->editor->sci;
 
-	g_return_val_if_fail(doc == NULL || doc->is_valid, NULL);
+	SSM(sci, SCI_SETDOCPOINTER, 0, pdoc);
+	/* the view now holds the only reference */
+	SSM(sci, SCI_RELEASEDOCUMENT, 0, pdoc);
 
-	if (reload)
+	/* the code page is a property of the document */
+	sci_set_codepage(sci, SC_CP_UTF8);
+	SSM(sci, SCI_SETCHANGEHISTORY, SC_CHANGE_HISTORY_DISABLED, 0);
+	sci_set_folding_margin_visible(sci, FALSE);
+
+	doc->priv->large_file = TRUE;
+}
+
+
+typedef struct
+{
+	guint			 doc_id;
+	gchar			*locale_filename;
+	gchar			*display_filename;
+	gchar			*forced_enc;
+	gchar			*enc;			/* the encoding stored in the document */
+	gchar			*charset;		/* the encoding to convert from, NULL for UTF-8 or no conversion */
+	gboolean		 validate;		/* whether the data must be checked to be valid UTF-8 */
+	gboolean		 readonly;
+	gint			 pos;
+	goffset			 size;
+	time_t			 mtime;
+	gpointer		 loader;		/* the ILoader of the Scintilla document being filled */
+	GCancellable	*cancellable;
+	/* set by the loading thread */
+	gint			 loaded_kib;	/* accessed atomically */
+	gint			 eol_mode;
+	gboolean		 bom;
+	gboolean		 failed;
+} BackgroundLoad;
+
+
+/* Returns the number of bytes at the end of buf which start a UTF-8 sequence
+ * continued in the next block, or -1 if buf is not valid UTF-8.
+ * NUL bytes count as invalid as they need the handling of load_text_file(). */
+static gssize validate_utf8_block(const gchar *buf, gsize len)
+{
+	const gchar *end;
+	const gchar *p;
+	gsize tail;
+
+	if (g_utf8_validate(buf, len, &end))
+		return 0;
+
+	tail = len - (gsize) (end - buf);
+	if ((guchar) *end < 0xC2 || (guchar) *end > 0xF4 || tail >= (gsize) g_utf8_skip[(guchar) *end])
+		return -1;
+	for (p = end + 1; p < buf + len; p++)
 	{
-		utf8_filename = g_strdup(doc->file_name);
-		locale_filename = utils_get_locale_from_utf8(utf8_filename);
+		if (((guchar) *p & 0xC0) != 0x80)
+			return -1;
 	}
-	else
-	{
-		/* filename must not be NULL when opening a file */
-		g_return_val_if_fail(filename, NULL);
+	return (gssize) tail;
+}
 
-#ifdef G_OS_WIN32
-		/* if filename is a shortcut, try to resolve it */
-		locale_filename = win32_get_shortcut_target(filename);
-#else
-		locale_filename = g_strdup(filename);
-#endif
-		/* remove relative junk */
-		utils_tidy_path(locale_filename);
 
-		/* try to get the UTF-8 equivalent for the filename, fallback to filename if error */
-		utf8_filename = utils_get_utf8_from_locale(locale_filename);
+/* The running loads share the progress bar, which is shown while any is running */
+static GSList *background_loads = NULL;
+static guint background_load_progress_id = 0;
 
-		/* if file is already open, switch to it and go */
-		doc = document_find_by_filename(utf8_filename);
-		if (doc != NULL)
-		{
-			ui_add_recent_document(doc);	/* either add or reorder recent item */
-			document_check_disk_status(doc, TRUE);	/* force a file changed check */
-		}
-	}
-	if (reload || doc == NULL)
-	{	/* doc possibly changed */
-		display_filename = utils_str_middle_truncate(utf8_filename, 100);
 
-		if (! load_text_file(locale_filename, display_filename, &filedata, forced_enc))
-		{
-			g_free(display_filename);
-			g_free(utf8_filename);
-			g_free(locale_filename);
-			return NULL;
-		}
+static void free_background_load(BackgroundLoad *load)
+{
+	if (load->loader)
+		scintilla_loader_release(load->loader);
+	g_object_unref(load->cancellable);
+	g_free(load->locale_filename);
+	g_free(load->display_filename);
+	g_free(load->forced_enc);
+	g_free(load->enc);
+	g_free(load->charset);
+	g_free(load);
+}
 
-		if (! reload)
-		{
-			doc = document_create(utf8_filename);
-			g_return_val_if_fail(doc != NULL, NULL); /* really should not happen */
 
-			/* file exists on disk, set real_path */
-			SETPTR(doc->real_path, utils_get_real_path(locale_filename));
+/* Does what document_open_file_full() does after adding the text, for documents
+ * loaded in the background. */
+static void finish_background_load(GeanyDocument *doc, BackgroundLoad *load)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint pos;
 
-			doc->priv->is_remote = utils_is_remote_path(locale_filename);
-			monitor_file_setup(doc);
-		}
+	sci_set_eol_mode(sci, load->eol_mode);
+	sci_set_undo_collection(sci, TRUE);
+	sci_empty_undo_buffer(sci);
 
-		if (! reload || ! file_prefs.keep_edit_history_on_reload)
-		{
-			sci_set_undo_collection(doc->editor->sci, FALSE); /* avoid creation of an undo action */
-			sci_empty_undo_buffer(doc->editor->sci);
-			undo_reload_data = NULL;
-		}
-		else
-		{
-			undo_reload_data = (UndoReloadData*) g_malloc(sizeof(UndoReloadData));
+	doc->priv->mtime = load->mtime;
+	g_free(doc->encoding);
+	doc->encoding = load->enc;
+	load->enc = NULL;
+	doc->has_bom = load->bom;
+	store_saved_encoding(doc);
 
-			/* We will be adding a UNDO_RELOAD action to the undo stack that undoes
-			 * this reload. To do that, we keep collecting undo actions during
-			 * reloading, and at the end add an UNDO_RELOAD action that performs
-			 * all these actions in bulk. To keep track of how many undo actions
-			 * were added during this time, we compare the current undo-stack height
-			 * with its height at the end of the process. Note that g_trash_stack_height()
-			 * is O(N), which is a little ugly, but this seems like the most maintainable
-			 * option. */
-			undo_reload_data->actions_count = g_trash_stack_height(&doc->priv->undo_actions);
+	doc->readonly = load->readonly;
+	sci_set_readonly(sci, doc->readonly);
 
-			/* We use add_undo_reload_action to track any changes to the document that
-			 * require adding an undo action to revert the reload, but that do not
-			 * generate an undo action themselves. */
-			add_undo_reload_action = FALSE;
-		}
+	doc->priv->line_count = sci_get_line_count(sci);
+	sci_set_line_numbers(sci, editor_prefs.show_linenumber_margin);
 
-		/* add the text to the ScintillaObject */
-		sci_set_readonly(doc->editor->sci, FALSE);	/* to allow replacing text */
-		sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
-		queue_colourise(doc);	/* Ensure the document gets colourised. */
+	monitor_file_setup(doc);
+	g_signal_connect(sci, "sci-notify", G_CALLBACK(editor_sci_notify_cb), doc->editor);
 
-		/* detect & set line endings */
-		editor_mode = utils_get_line_endings(filedata.data, filedata.len);
-		if (undo_reload_data)
-		{
+	document_apply_indent_settings(doc);
+	document_set_text_changed(doc, FALSE);
+	ui_document_show_hide(doc);
+
+	if (! main_status.opening_session_files)
+		ui_add_recent_document(doc);
+
+	geany_object_emit("document-open", doc);
+	msgwin_status_add(_("File %s opened (%d%s)."),
+		load->display_filename, gtk_notebook_get_n_pages(GTK_NOTEBOOK(main_widgets.notebook)),
+		(load->readonly) ? _(", read-only") : "");
+	msgwin_status_add(_("File %s is larger than %d MiB, syntax highlighting, folding and symbols are disabled."),
+		load->display_filename, file_prefs.large_file_threshold);
+
+	pos = set_cursor_position(doc->editor, load->pos);
+	editor_goto_pos(doc->editor, pos, FALSE);
+}
+
+
+/* The file could not be streamed, e.g. because it isn't valid in the encoding guessed
+ * from its header, so load it with the full encoding detection instead. */
+static void load_file_synchronously(GeanyDocument *doc, BackgroundLoad *load)
+{
+	FileData filedata;
+
+	if (! load_text_file(load->locale_filename, load->display_filename, &filedata, load->forced_enc))
+	{
+		document_close(doc);
+		return;
+	}
+
+	document_set_large_file_mode(doc, SSM(doc->editor->sci, SCI_CREATEDOCUMENT,
+		filedata.len, LARGE_FILE_DOCUMENT_OPTIONS));
+	sci_set_undo_collection(doc->editor->sci, FALSE);
+	sci_set_text(doc->editor->sci, filedata.data);
+	load->eol_mode = utils_get_line_endings(filedata.data, filedata.len);
+	g_free(filedata.data);
+
+	SETPTR(load->enc, filedata.enc);
+	load->bom = filedata.bom;
+	load->mtime = filedata.mtime;
+	load->readonly = load->readonly || filedata.readonly;
+
+	finish_background_load(doc, load);
+}
+
+
+static gboolean on_background_load_finished(gpointer data)
+{
+	BackgroundLoad *load = data;
+	GeanyDocument *doc = document_find_by_id(load->doc_id);
+
+	background_loads = g_slist_remove(background_loads, load);
+	if (background_loads == NULL)
+	{
+		g_source_remove(background_load_progress_id);
+		background_load_progress_id = 0;
+		gtk_widget_hide(main_widgets.progressbar);
+	}
+
+	/* the document was closed while loading */
+	if (doc == NULL || g_cancellable_is_cancelled(load->cancellable))
+	{
+		free_background_load(load);
+		return FALSE;
+	}
+	g_object_unref(doc->priv->load_cancellable);
+	doc->priv->load_cancellable = NULL;
+
+	if (load->failed)
+		load_file_synchronously(doc, load);
+	else
+	{
+		document_set_large_file_mode(doc, (sptr_t) scintilla_loader_convert_to_document(load->loader));
+		load->loader = NULL;
+		finish_background_load(doc, load);
+	}
+
+	free_background_load(load);
+	return FALSE;
+}
+
+
+static gboolean on_background_load_progress(gpointer data)
+{
+	guint count = g_slist_length(background_loads);
+	gdouble loaded = 0.0, size = 0.0;
+	gchar *text;
+	GSList *node;
+
+	foreach_slist(node, background_loads)
+	{
+		BackgroundLoad *load = node->data;
+
+		loaded += g_atomic_int_get(&load->loaded_kib) * 1024.0;
+		size += load->size;
+	}
+	if (count == 1)
+		text = g_strdup_printf(_("Loading %s"), ((BackgroundLoad *) background_loads->data)->display_filename);
+	else
+		text = g_strdup_printf(ngettext("Loading %u file", "Loading %u files", count), count);
+
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(main_widgets.progressbar), MIN(loaded / MAX(size, 1.0), 1.0));
+	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(main_widgets.progressbar), text);
+	g_free(text);
+	return TRUE;
+}
+
+
+/* Reads the file in blocks, converts them to UTF-8 and adds them to the Scintilla
+ * document through its loader. Only GIO and the ILoader are used here as the rest
+ * of Geany must only be used from the main thread. */
+static gpointer background_load_thread(gpointer data)
+{
+	BackgroundLoad *load = data;
+	GFile *file = g_file_new_for_path(load->locale_filename);
+	GFileInputStream *file_stream;
+	GInputStream *stream;
+	gchar *buf = NULL;
+	gsize carry = 0;
+	gboolean first = TRUE;
+
+	file_stream = g_file_read(file, load->cancellable, NULL);
+	g_object_unref(file);
+	if (file_stream == NULL)
+	{
+		load->failed = TRUE;
+		goto done;
+	}
+
+	if (load->charset != NULL)
+	{
+		GCharsetConverter *converter = g_charset_converter_new("UTF-8", load->charset, NULL);
+
+		if (converter == NULL)
+		{
+			load->failed = TRUE;
+			goto done;
+		}
+		stream = g_converter_input_stream_new(G_INPUT_STREAM(file_stream), G_CONVERTER(converter));
+		g_object_unref(converter);
+	}
+	else
+		stream = g_object_ref(file_stream);
+
+	/* room for the end of a UTF-8 sequence cut by the previous block */
+	buf = g_malloc(LOAD_CHUNK_SIZE + 4);
+	while (TRUE)
+	{
+		gssize n = g_input_stream_read(stream, buf + carry, LOAD_CHUNK_SIZE, load->cancellable, NULL);
+		gchar *start = buf;
+		gsize len;
+
+		if (n < 0 || (n == 0 && carry > 0))
+		{
+			load->failed = TRUE;
+			break;
+		}
+		if (n == 0)
+			break;
+
+		len = carry + (gsize) n;
+		if (first)
+		{
+			/* like load_text_file(), keep a UTF-8 BOM out of the text */
+			if (load->charset != NULL || load->validate)
+			{
+				load->bom = len >= 3 && memcmp(start, "\xef\xbb\xbf", 3) == 0;
+				if (load->bom)
+				{
+					start += 3;
+					len -= 3;
+				}
+			}
+			load->eol_mode = utils_get_line_endings(start, len);
+			first = FALSE;
+		}
+
+		carry = 0;
+		if (load->validate)
+		{
+			gssize tail = validate_utf8_block(start, len);
+
+			if (tail < 0)
+			{
+				load->failed = TRUE;
+				break;
+			}
+			carry = (gsize) tail;
+			len -= carry;
+		}
+		else if (memchr(start, '\0', len) != NULL)
+		{
+			load->failed = TRUE;
+			break;
+		}
+
+		if (scintilla_loader_add_data(load->loader, start, (sptr_t) len) != SC_STATUS_OK)
+		{
+			load->failed = TRUE;
+			break;
+		}
+		memmove(buf, start + len, carry);
+
+		g_atomic_int_set(&load->loaded_kib,
+			(gint) (g_seekable_tell(G_SEEKABLE(file_stream)) / 1024));
+	}
+	g_free(buf);
+	g_object_unref(stream);
+
+done:
+	if (file_stream != NULL)
+		g_object_unref(file_stream);
+	g_idle_add(on_background_load_finished, load);
+	return NULL;
+}
+
+
+/* Opens large local files by reading, converting and adding them to the Scintilla
+ * document from a thread, so the UI stays responsive and shows the progress.
+ * The document is read-only and empty until the whole text is added.
+ * Returns NULL if the file should be loaded synchronously. */
+static GeanyDocument *document_open_file_background(const gchar *locale_filename,
+		const gchar *utf8_filename, gint pos, gboolean readonly, const gchar *forced_enc)
+{
+	BackgroundLoad *load;
+	GeanyDocument *doc;
+	GeanyEncodingIndex bom_idx;
+	GStatBuf st;
+	gchar header[512];
+	gsize header_len;
+	FILE *fp;
+
+	if (! main_status.main_window_realized || USE_GIO_FILE_OPERATIONS ||
+		utils_is_remote_path(locale_filename) || g_stat(locale_filename, &st) != 0 ||
+		! S_ISREG(st.st_mode) || ! is_large_file((gsize) st.st_size))
+		return NULL;
+
+	/* the encoding detection of load_text_file() needs the whole file, so only look
+	 * for a BOM or a declared encoding and fall back to it if the guess is wrong */
+	fp = g_fopen(locale_filename, "rb");
+	if (fp == NULL)
+		return NULL;
+	header_len = fread(header, 1, sizeof(header), fp);
+	fclose(fp);
+
+	load = g_new0(BackgroundLoad, 1);
+	bom_idx = encodings_scan_unicode_bom(header, header_len, NULL);
+	if (forced_enc != NULL)
+		load->enc = g_strdup(forced_enc);
+	else if (bom_idx != GEANY_ENCODING_NONE)
+		load->enc = g_strdup(encodings[bom_idx].charset);
+	else if ((load->enc = encodings_check_regexes(header, header_len)) == NULL)
+		load->enc = g_strdup("UTF-8");
+
+	if (encodings_get_idx_from_charset(load->enc) == GEANY_ENCODING_UTF_8)
+		load->validate = TRUE;
+	else if (! utils_str_equal(load->enc, encodings[GEANY_ENCODING_NONE].charset))
+		load->charset = g_strdup(load->enc);
+
+	load->locale_filename = g_strdup(locale_filename);
+	load->display_filename = utils_str_middle_truncate(utf8_filename, 100);
+	load->forced_enc = g_strdup(forced_enc);
+	load->readonly = readonly;
+	load->pos = pos;
+	load->size = st.st_size;
+	load->mtime = st.st_mtime;
+	load->eol_mode = utils_get_line_endings("", 0);
+	load->cancellable = g_cancellable_new();
+
+	doc = document_create(utf8_filename);
+	g_return_val_if_fail(doc != NULL, NULL); /* really should not happen */
+
+	SETPTR(doc->real_path, utils_get_real_path(locale_filename));
+	doc->priv->mtime = st.st_mtime;
+	doc->priv->load_cancellable = g_object_ref(load->cancellable);
+	doc->readonly = TRUE;
+	sci_set_readonly(doc->editor->sci, TRUE);
+	document_set_filetype(doc, filetypes[GEANY_FILETYPES_NONE]);
+
+	load->doc_id = doc->id;
+	load->loader = (gpointer) SSM(doc->editor->sci, SCI_CREATELOADER, (uptr_t) st.st_size,
+		LARGE_FILE_DOCUMENT_OPTIONS);
+
+	background_loads = g_slist_prepend(background_loads, load);
+	if (background_load_progress_id == 0)
+	{
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(main_widgets.progressbar), 0.0);
+		if (interface_prefs.statusbar_visible)
+			gtk_widget_show(main_widgets.progressbar);
+		background_load_progress_id = g_timeout_add(100, on_background_load_progress, NULL);
+	}
+
+	g_thread_unref(g_thread_new("geany-load", background_load_thread, load));
+	return doc;
+}
+
+
+GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
+		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc)
+{
+	gint editor_mode;
+	gboolean reload = (doc == NULL) ? FALSE : TRUE;
+	gchar *utf8_filename = NULL;
+	gchar *display_filename = NULL;
+	gchar *locale_filename = NULL;
+	GeanyFiletype *use_ft;
+	FileData filedata;
+	UndoReloadData *undo_reload_data;
+	gboolean add_undo_reload_action;
+
+	g_return_val_if_fail(doc == NULL || doc->is_valid, NULL);
+
+	if (reload)
+	{
+		/* the file is still being loaded in the background */
+		if (doc->priv->load_cancellable)
+			return NULL;
+
+		utf8_filename = g_strdup(doc->file_name);
+		locale_filename = utils_get_locale_from_utf8(utf8_filename);
+	}
+	else
+	{
+		/* filename must not be NULL when opening a file */
+		g_return_val_if_fail(filename, NULL);
+
+#ifdef G_OS_WIN32
+		/* if filename is a shortcut, try to resolve it */
+		locale_filename = win32_get_shortcut_target(filename);
+#else
+		locale_filename = g_strdup(filename);
+#endif
+		/* remove relative junk */
+		utils_tidy_path(locale_filename);
+
+		/* try to get the UTF-8 equivalent for the filename, fallback to filename if error */
+		utf8_filename = utils_get_utf8_from_locale(locale_filename);
+
+		/* if file is already open, switch to it and go */
+		doc = document_find_by_filename(utf8_filename);
+		if (doc != NULL)
+		{
+			ui_add_recent_document(doc);	/* either add or reorder recent item */
+			document_check_disk_status(doc, TRUE);	/* force a file changed check */
+		}
+		else
+		{
+			doc = document_open_file_background(locale_filename, utf8_filename, pos,
+				readonly, forced_enc);
+			if (doc != NULL)
+			{
+				g_free(utf8_filename);
+				g_free(locale_filename);
+				return doc;
+			}
+		}
+	}
+	if (reload || doc == NULL)
+	{	/* doc possibly changed */
+		display_filename = utils_str_middle_truncate(utf8_filename, 100);
+
+		if (! load_text_file(locale_filename, display_filename, &filedata, forced_enc))
+		{
+			g_free(display_filename);
+			g_free(utf8_filename);
+			g_free(locale_filename);
+			return NULL;
+		}
+
+		if (! reload)
+		{
+			doc = document_create(utf8_filename);
+			g_return_val_if_fail(doc != NULL, NULL); /* really should not happen */
+
+			/* file exists on disk, set real_path */
+			SETPTR(doc->real_path, utils_get_real_path(locale_filename));
+
+			doc->priv->is_remote = utils_is_remote_path(locale_filename);
+			monitor_file_setup(doc);
+
+			if (is_large_file(filedata.len))
+				document_set_large_file_mode(doc, SSM(doc->editor->sci, SCI_CREATEDOCUMENT,
+					filedata.len, LARGE_FILE_DOCUMENT_OPTIONS));
+		}
+
+		if (! reload || ! file_prefs.keep_edit_history_on_reload)
+		{
+			sci_set_undo_collection(doc->editor->sci, FALSE); /* avoid creation of an undo action */
+			sci_empty_undo_buffer(doc->editor->sci);
+			undo_reload_data = NULL;
+		}
+		else
+		{
+			undo_reload_data = (UndoReloadData*) g_malloc(sizeof(UndoReloadData));
+
+			/* We will be adding a UNDO_RELOAD action to the undo stack that undoes
+			 * this reload. To do that, we keep collecting undo actions during
+			 * reloading, and at the end add an UNDO_RELOAD action that performs
+			 * all these actions in bulk. To keep track of how many undo actions
+			 * were added during this time, we compare the current undo-stack height
+			 * with its height at the end of the process. Note that g_trash_stack_height()
+			 * is O(N), which is a little ugly, but this seems like the most maintainable
+			 * option. */
+			undo_reload_data->actions_count = g_trash_stack_height(&doc->priv->undo_actions);
+
+			/* We use add_undo_reload_action to track any changes to the document that
+			 * require adding an undo action to revert the reload, but that do not
+			 * generate an undo action themselves. */
+			add_undo_reload_action = FALSE;
+		}
+
+		/* add the text to the ScintillaObject */
+		sci_set_readonly(doc->editor->sci, FALSE);	/* to allow replacing text */
+		sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
+		queue_colourise(doc);	/* Ensure the document gets colourised. */
+
+		/* detect & set line endings */
+		editor_mode = utils_get_line_endings(filedata.data, filedata.len);
+		if (undo_reload_data)
+		{
 			undo_reload_data->eol_mode = editor_get_eol_char_mode(doc->editor);
 			/* Force adding an undo-reload action if the EOL mode changed. */
 			if (editor_mode != undo_reload_data->eol_mode)
@@ -1462,7 +2288,10 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 			g_signal_connect(doc->editor->sci, "sci-notify", G_CALLBACK(editor_sci_notify_cb),
 				doc->editor);
 
-			use_ft = (ft != NULL) ? ft : filetypes_detect_from_document(doc);
+			if (doc->priv->large_file)
+				use_ft = filetypes[GEANY_FILETYPES_NONE];
+			else
+				use_ft = (ft != NULL) ? ft : filetypes_detect_from_document(doc);
 		}
 		else
 		{	/* reloading */
@@ -1497,13 +2326,17 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 
 			use_ft = ft;
 		}
+		/* the symbols of preloaded files are parsed once they are shown */
+		if (! reload && filedata.preloaded)
+			doc->priv->init_pending = TRUE;
+
 		/* update taglist, typedef keywords and build menu if necessary */
 		document_set_filetype(doc, use_ft);
 
 		/* set indentation settings after setting the filetype */
 		if (reload)
 			editor_set_indent(doc->editor, doc->editor->indent_type, doc->editor->indent_width); /* resetup sci */
-		else
+		else if (! filedata.preloaded)	/* the caller sets the stored indentation */
 			document_apply_indent_settings(doc);
 
 		document_set_text_changed(doc, FALSE);	/* also updates tab state */
@@ -1515,18 +2348,21 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 
 		if (reload)
 		{
-			g_signal_emit_by_name(geany_object, "document-reload", doc);
+			geany_object_emit("document-reload", doc);
 			ui_set_statusbar(TRUE, _("File %s reloaded."), display_filename);
 		}
 		else
 		{
-			g_signal_emit_by_name(geany_object, "document-open", doc);
+			geany_object_emit("document-open", doc);
 			/* For translators: this is the status window message for opening a file. %d is the number
 			 * of the newly opened file, %s indicates whether the file is opened read-only
 			 * (it is replaced with the string ", read-only"). */
 			msgwin_status_add(_("File %s opened (%d%s)."),
 				display_filename, gtk_notebook_get_n_pages(GTK_NOTEBOOK(main_widgets.notebook)),
 				(readonly) ? _(", read-only") : "");
+			if (doc->priv->large_file)
+				msgwin_status_add(_("File %s is larger than %d MiB, syntax highlighting, folding and symbols are disabled."),
+					display_filename, file_prefs.large_file_threshold);
 		}
 	}
 
@@ -1846,7 +2682,7 @@ gboolean document_save_file_as(GeanyDocument *doc, const gchar *utf8_fname)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
-	g_signal_emit_by_name(geany_object, "document-before-save-as", doc);
+	geany_object_emit("document-before-save-as", doc);
 
 	new_file = document_need_save_as(doc) || (utf8_fname != NULL && strcmp(doc->file_name, utf8_fname) != 0);
 	if (utf8_fname != NULL)
@@ -2043,6 +2879,19 @@ static gchar *write_data_to_disk(const gchar *locale_filename,
 }
 
 
+/* now the file is on disk, set real_path */
+static void set_real_path_after_save(GeanyDocument *doc, const gchar *locale_filename)
+{
+	if (doc->real_path == NULL)
+	{
+		doc->real_path = utils_get_real_path(locale_filename);
+		doc->priv->is_remote = utils_is_remote_path(locale_filename);
+		monitor_file_setup(doc);
+		ui_add_recent_document(doc);
+	}
+}
+
+
 static gchar *save_doc(GeanyDocument *doc, const gchar *locale_filename,
 								 const gchar *data, gsize len)
 {
@@ -2055,14 +2904,7 @@ static gchar *save_doc(GeanyDocument *doc, const gchar *locale_filename,
 	if (err)
 		return err;
 
-	/* now the file is on disk, set real_path */
-	if (doc->real_path == NULL)
-	{
-		doc->real_path = utils_get_real_path(locale_filename);
-		doc->priv->is_remote = utils_is_remote_path(locale_filename);
-		monitor_file_setup(doc);
-		ui_add_recent_document(doc);
-	}
+	set_real_path_after_save(doc, locale_filename);
 	return NULL;
 }
 
@@ -2101,33 +2943,214 @@ static gboolean save_file_handle_infobars(GeanyDocument *doc, gboolean force)
 }
 
 
-/**
- *  Saves the document.
- *  Also shows the Save As dialog if necessary.
- *  If the file is not modified, this function may do nothing unless @a force is set to @c TRUE.
- *
- *  Saving may include replacing tabs with spaces,
- *  stripping trailing spaces and adding a final new line at the end of the file, depending
- *  on user preferences. Then the @c "document-before-save" signal is emitted,
- *  allowing plugins to modify the document before it is saved, and data is
- *  actually written to disk.
- *
- *  On successful saving:
- *  - GeanyDocument::real_path is set.
- *  - The filetype is set again or auto-detected if it wasn't set yet.
- *  - The @c "document-save" signal is emitted for plugins.
- *
- *  @warning You should ensure @c doc->file_name has an absolute path unless you want the
- *  Save As dialog to be shown. A @c NULL value also shows the dialog. This behaviour was
- *  added in Geany 1.22.
- *
- *  @param doc The document to save.
- *  @param force Whether to save the file even if it is not modified.
- *
- *  @return @c TRUE if the file was saved or @c FALSE if the file could not or should not be saved.
- **/
-GEANY_API_SYMBOL
-gboolean document_save_file(GeanyDocument *doc, gboolean force)
+static void show_save_error(GeanyDocument *doc, const gchar *errmsg, gboolean may_be_truncated)
+{
+	gchar *text;
+
+	ui_set_statusbar(TRUE, _("Error saving file (%s)."), errmsg);
+
+	if (may_be_truncated)
+		text = g_strdup_printf(_("%s\n\nThe file on disk may now be truncated!"), errmsg);
+	else
+		text = g_strdup(errmsg);
+	dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, _("Error saving file."), text);
+	g_free(text);
+	doc->priv->file_disk_status = FILE_OK;
+	utils_beep();
+}
+
+
+/* Updates the document once its text was written to the file, setting a save point
+ * if the text still is the one written. */
+static void document_saved(GeanyDocument *doc, const gchar *locale_filename, gboolean unchanged)
+{
+	/* store the opened encoding for undo/redo */
+	store_saved_encoding(doc);
+
+	/* ignore the following things if we are quitting */
+	if (! main_status.quitting)
+	{
+		if (unchanged)
+			sci_set_savepoint(doc->editor->sci);
+
+		if (file_prefs.disk_check_timeout > 0)
+			document_update_timestamp(doc, locale_filename);
+
+		/* update filetype-related things */
+		document_set_filetype(doc, doc->file_type);
+
+		document_update_tab_label(doc);
+
+		msgwin_status_add(_("File %s saved."), doc->file_name);
+		ui_update_statusbar(doc, -1);
+#ifdef HAVE_VTE
+		vte_cwd((doc->real_path != NULL) ? doc->real_path : doc->file_name, FALSE);
+#endif
+	}
+
+	geany_object_emit("document-save", doc);
+}
+
+
+typedef struct BackgroundSave
+{
+	guint		 doc_id;
+	gchar		*locale_filename;
+	gchar		*charset;		/* the encoding to convert to, NULL to write the text as-is */
+	gboolean	 bom;			/* whether to write a UTF-8 BOM before the (converted) text */
+	GBytes		*text;
+	guint		 text_version;
+	GThread		*thread;
+	gboolean	 finished;
+	/* set by the saving thread */
+	GError		*error;
+} BackgroundSave;
+
+
+/* Writes the text in blocks, converting it to the file's encoding on the way.
+ * g_file_replace() writes to a temporary file renamed over the file once closed,
+ * so a failed save leaves the file untouched. */
+static gpointer background_save_thread(gpointer data)
+{
+	BackgroundSave *save = data;
+	GFile *file = g_file_new_for_path(save->locale_filename);
+	GCancellable *cancellable = g_cancellable_new();
+	GFileOutputStream *file_stream;
+	GOutputStream *stream;
+	const gchar *text;
+	gsize len;
+	gsize written = 0;
+
+	text = g_bytes_get_data(save->text, &len);
+
+	file_stream = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &save->error);
+	g_object_unref(file);
+	if (file_stream == NULL)
+		goto done;
+
+	stream = g_object_ref(file_stream);
+	if (save->charset != NULL)
+	{
+		GCharsetConverter *converter = g_charset_converter_new(save->charset, "UTF-8", &save->error);
+
+		if (converter != NULL)
+		{
+			g_object_unref(stream);
+			stream = g_converter_output_stream_new(G_OUTPUT_STREAM(file_stream),
+				G_CONVERTER(converter));
+			g_object_unref(converter);
+		}
+	}
+	else
+	{
+		/* like document_save_file(), stop at the first NUL byte */
+		const gchar *nul = memchr(text, '\0', len);
+
+		if (nul != NULL)
+			len = (gsize) (nul - text);
+	}
+
+	if (save->error == NULL && save->bom)
+		g_output_stream_write_all(stream, "\xef\xbb\xbf", 3, NULL, NULL, &save->error);
+	while (save->error == NULL && written < len)
+	{
+		gsize n = MIN(len - written, LOAD_CHUNK_SIZE);
+
+		if (g_output_stream_write_all(stream, text + written, n, NULL, NULL, &save->error))
+			written += n;
+	}
+
+	/* closing with a cancelled cancellable keeps the file from being replaced */
+	if (save->error != NULL)
+		g_cancellable_cancel(cancellable);
+	g_output_stream_close(stream, cancellable, save->error ? NULL : &save->error);
+	/* the converter may fail to flush before closing the file */
+	if (save->error != NULL)
+		g_cancellable_cancel(cancellable);
+	g_output_stream_close(G_OUTPUT_STREAM(file_stream), cancellable, NULL);
+	g_object_unref(stream);
+	g_object_unref(file_stream);
+
+done:
+	g_object_unref(cancellable);
+	g_idle_add(on_background_save_finished, save);
+	return NULL;
+}
+
+
+/* Called in the main thread once the file is written, or to wait for it to be */
+static void finish_background_save(BackgroundSave *save)
+{
+	GeanyDocument *doc;
+
+	if (save->finished)
+		return;
+
+	g_thread_join(save->thread);
+	save->finished = TRUE;
+	ui_progress_bar_stop();
+
+	doc = document_find_by_id(save->doc_id);
+	g_return_if_fail(doc != NULL);
+	doc->priv->background_save = NULL;
+
+	if (save->error != NULL)
+		show_save_error(doc, save->error->message, FALSE);
+	else
+	{
+		set_real_path_after_save(doc, save->locale_filename);
+		document_saved(doc, save->locale_filename, doc->priv->text_version == save->text_version);
+	}
+}
+
+
+static gboolean on_background_save_finished(gpointer data)
+{
+	BackgroundSave *save = data;
+
+	finish_background_save(save);
+
+	if (save->error != NULL)
+		g_error_free(save->error);
+	g_bytes_unref(save->text);
+	g_free(save->locale_filename);
+	g_free(save->charset);
+	g_free(save);
+	return FALSE;
+}
+
+
+/* Saves documents in large file mode from a thread, so writing them to slow drives
+ * doesn't freeze the UI. The text is the snapshot taken after "document-before-save"
+ * and "document-save" is emitted once it is written. */
+static gboolean document_save_file_background(GeanyDocument *doc)
+{
+	BackgroundSave *save;
+
+	if (! doc->priv->large_file || main_status.quitting)
+		return FALSE;
+
+	save = g_new0(BackgroundSave, 1);
+	save->doc_id = doc->id;
+	save->locale_filename = utils_get_locale_from_utf8(doc->file_name);
+	save->text = document_get_snapshot(doc, &save->text_version);
+	save->bom = doc->has_bom && encodings_is_unicode_charset(doc->encoding);
+	/* save in original encoding, skip when it is already UTF-8 or has the encoding "None" */
+	if (doc->encoding != NULL && ! utils_str_equal(doc->encoding, "UTF-8") &&
+		! utils_str_equal(doc->encoding, encodings[GEANY_ENCODING_NONE].charset))
+		save->charset = g_strdup(doc->encoding);
+
+	/* ignore file changed notification when the file is written */
+	doc->priv->file_disk_status = FILE_IGNORE;
+	doc->priv->background_save = save;
+
+	ui_progress_bar_start(_("Saving file"));
+	save->thread = g_thread_new("geany-save", background_save_thread, save);
+	return TRUE;
+}
+
+
+static gboolean save_file(GeanyDocument *doc, gboolean force, gboolean background)
 {
 	gchar *errmsg;
 	gchar *data;
@@ -2144,6 +3167,10 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 		return dialogs_show_save_as();
 	}
 
+	/* callers saving synchronously expect the file to be written when they continue */
+	if (doc->priv->background_save && ! background)
+		finish_background_save(doc->priv->background_save);
+
 	if (!force && !doc->changed)
 		return FALSE;
 	if (doc->readonly)
@@ -2152,6 +3179,11 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 			_("Cannot save read-only document '%s'!"), DOC_FILENAME(doc));
 		return FALSE;
 	}
+	if (doc->priv->background_save)
+	{
+		ui_set_statusbar(TRUE, _("File %s is still being saved."), DOC_FILENAME(doc));
+		return FALSE;
+	}
 	document_check_disk_status(doc, TRUE);
 	if (doc->priv->protected)
 		return save_file_handle_infobars(doc, force);
@@ -2171,7 +3203,10 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 		sci_convert_eols(doc->editor->sci, sci_get_eol_mode(doc->editor->sci));
 
 	/* notify plugins which may wish to modify the document before it's saved */
-	g_signal_emit_by_name(geany_object, "document-before-save", doc);
+	geany_object_emit("document-before-save", doc);
+
+	if (background && document_save_file_background(doc))
+		return TRUE;
 
 	len = sci_get_length(doc->editor->sci) + 1;
 	if (doc->has_bom && encodings_is_unicode_charset(doc->encoding))
@@ -2217,54 +3252,211 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 
 	if (errmsg != NULL)
 	{
-		ui_set_statusbar(TRUE, _("Error saving file (%s)."), errmsg);
-
-		if (!file_prefs.use_safe_file_saving)
-		{
-			SETPTR(errmsg,
-				g_strdup_printf(_("%s\n\nThe file on disk may now be truncated!"), errmsg));
-		}
-		dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, _("Error saving file."), errmsg);
-		doc->priv->file_disk_status = FILE_OK;
-		utils_beep();
+		show_save_error(doc, errmsg, ! file_prefs.use_safe_file_saving);
 		g_free(locale_filename);
 		g_free(errmsg);
 		return FALSE;
 	}
 
-	/* store the opened encoding for undo/redo */
-	store_saved_encoding(doc);
+	document_saved(doc, locale_filename, TRUE);
+	g_free(locale_filename);
 
-	/* ignore the following things if we are quitting */
-	if (! main_status.quitting)
+	return TRUE;
+}
+
+
+/**
+ *  Saves the document.
+ *  Also shows the Save As dialog if necessary.
+ *  If the file is not modified, this function may do nothing unless @a force is set to @c TRUE.
+ *
+ *  Saving may include replacing tabs with spaces,
+ *  stripping trailing spaces and adding a final new line at the end of the file, depending
+ *  on user preferences. Then the @c "document-before-save" signal is emitted,
+ *  allowing plugins to modify the document before it is saved, and data is
+ *  actually written to disk.
+ *
+ *  On successful saving:
+ *  - GeanyDocument::real_path is set.
+ *  - The filetype is set again or auto-detected if it wasn't set yet.
+ *  - The @c "document-save" signal is emitted for plugins.
+ *
+ *  The file is written when this function returns, also for documents opened in
+ *  large file mode which Geany itself saves in the background.
+ *
+ *  @warning You should ensure @c doc->file_name has an absolute path unless you want the
+ *  Save As dialog to be shown. A @c NULL value also shows the dialog. This behaviour was
+ *  added in Geany 1.22.
+ *
+ *  @param doc The document to save.
+ *  @param force Whether to save the file even if it is not modified.
+ *
+ *  @return @c TRUE if the file was saved or @c FALSE if the file could not or should not be saved.
+ **/
+GEANY_API_SYMBOL
+gboolean document_save_file(GeanyDocument *doc, gboolean force)
+{
+	return save_file(doc, force, FALSE);
+}
+
+
+/* Like document_save_file(), but documents in large file mode are written in the
+ * background so the UI doesn't wait for them. For them, TRUE means the saving
+ * started, and "document-save" is emitted once the file is written. */
+gboolean document_save_file_async(GeanyDocument *doc, gboolean force)
+{
+	return save_file(doc, force, TRUE);
+}
+
+
+/* The state of the incremental search of the search bar */
+static struct
+{
+	/* the last text not found, texts starting with it can't be found either
+	 * while the document doesn't change */
+	gchar *failed_text;
+	guint failed_doc_id;
+	guint failed_text_version;
+
+	/* the search continuing in the background, see search_bar_find_idle() */
+	guint source_id;
+	guint doc_id;
+	guint text_version;
+	gchar *text;
+	gint start_pos;
+	gint pos;	/* where the next chunk starts */
+	gboolean wrapped;
+}
+search_bar;
+
+
+static void search_bar_show_match(GeanyDocument *doc, struct Sci_TextToFind *ttf)
+{
+	gint line = sci_get_line_from_position(doc->editor->sci, ttf->chrgText.cpMin);
+
+	/* unfold maybe folded results */
+	sci_ensure_line_is_visible(doc->editor->sci, line);
+
+	sci_set_selection_start(doc->editor->sci, ttf->chrgText.cpMin);
+	sci_set_selection_end(doc->editor->sci, ttf->chrgText.cpMax);
+
+	if (! editor_line_in_view(doc->editor, line))
+	{	/* we need to force scrolling in case the cursor is outside of the current visible area
+		 * GeanyDocument::scroll_percent doesn't work because sci isn't always updated
+		 * while searching */
+		editor_scroll_to_line(doc->editor, -1, 0.3F);
+	}
+	else
+		sci_scroll_caret(doc->editor->sci); /* may need horizontal scrolling */
+
+	SETPTR(search_bar.failed_text, NULL);
+}
+
+
+static void search_bar_not_found(GeanyDocument *doc, const gchar *text, gboolean inc,
+		gint start_pos)
+{
+	if (! inc)
 	{
-		sci_set_savepoint(doc->editor->sci);
+		ui_set_statusbar(FALSE, _("\"%s\" was not found."), text);
+	}
+	utils_beep();
+	sci_goto_pos(doc->editor->sci, start_pos, FALSE);	/* clear selection */
 
-		if (file_prefs.disk_check_timeout > 0)
-			document_update_timestamp(doc, locale_filename);
+	SETPTR(search_bar.failed_text, g_strdup(text));
+	search_bar.failed_doc_id = doc->id;
+	search_bar.failed_text_version = doc->priv->text_version;
+}
 
-		/* update filetype-related things */
-		document_set_filetype(doc, doc->file_type);
 
-		document_update_tab_label(doc);
+static void search_bar_cancel(void)
+{
+	if (search_bar.source_id)
+	{
+		g_source_remove(search_bar.source_id);
+		search_bar.source_id = 0;
+	}
+	SETPTR(search_bar.text, NULL);
+}
 
-		msgwin_status_add(_("File %s saved."), doc->file_name);
-		ui_update_statusbar(doc, -1);
-#ifdef HAVE_VTE
-		vte_cwd((doc->real_path != NULL) ? doc->real_path : doc->file_name, FALSE);
-#endif
+
+/* Searches the chunk of the forward search starting at search_bar.pos, which
+ * goes from start_pos to the end and then from the start to start_pos. Returns
+ * FALSE once the whole document was searched. */
+static gboolean search_bar_find_chunk(ScintillaObject *sci, struct Sci_TextToFind *ttf,
+		gint *search_pos)
+{
+	gint len = sci_get_length(sci);
+	gint text_len = strlen(search_bar.text);
+	gint end = search_bar.wrapped ? MIN(search_bar.start_pos + text_len, len) : len;
+
+	if (search_bar.pos >= end)
+	{
+		if (search_bar.wrapped)
+			return FALSE;
+		search_bar.wrapped = TRUE;
+		search_bar.pos = 0;
+		end = MIN(search_bar.start_pos + text_len, len);
 	}
-	g_free(locale_filename);
 
-	g_signal_emit_by_name(geany_object, "document-save", doc);
+	/* overlap the chunks by the length of the text to find matches crossing them */
+	ttf->chrg.cpMin = search_bar.pos;
+	ttf->chrg.cpMax = MIN(search_bar.pos + SEARCH_BAR_CHUNK + text_len, end);
+	ttf->lpstrText = search_bar.text;
+	*search_pos = sci_find_text(sci, 0, ttf);
 
+	search_bar.pos = MIN(search_bar.pos + SEARCH_BAR_CHUNK, end);
 	return TRUE;
 }
 
 
+static gboolean search_bar_find_idle(gpointer user_data)
+{
+	GeanyDocument *doc = document_find_by_id(search_bar.doc_id);
+	GtkWidget *entry = toolbar_get_widget_child_by_name("SearchEntry");
+	struct Sci_TextToFind ttf;
+	gint search_pos = -1;
+	gint64 start;
+
+	/* the positions are invalid once the text changes */
+	if (! doc || doc != document_get_current() ||
+		doc->priv->text_version != search_bar.text_version)
+	{
+		search_bar.source_id = 0;
+		search_bar_cancel();
+		return G_SOURCE_REMOVE;
+	}
+
+	start = g_get_monotonic_time();
+	while (search_bar_find_chunk(doc->editor->sci, &ttf, &search_pos))
+	{
+		if (search_pos != -1)
+		{
+			search_bar_show_match(doc, &ttf);
+			break;
+		}
+		if (g_get_monotonic_time() - start > SEARCH_BAR_TIME_SLICE)
+			return G_SOURCE_CONTINUE;
+	}
+
+	if (search_pos == -1)
+	{
+		search_bar_not_found(doc, search_bar.text, TRUE, search_bar.start_pos);
+		if (entry)
+			ui_set_search_entry_background(entry, FALSE);
+	}
+
+	search_bar.source_id = 0;
+	search_bar_cancel();
+	return G_SOURCE_REMOVE;
+}
+
+
 /* special search function, used from the find entry in the toolbar
  * return TRUE if text was found otherwise FALSE
- * return also TRUE if text is empty  */
+ * return also TRUE if text is empty
+ * Incremental searches in big documents only search the text after the caret
+ * right away and continue in the background, returning TRUE meanwhile. */
 gboolean document_search_bar_find(GeanyDocument *doc, const gchar *text, gboolean inc,
 		gboolean backwards)
 {
@@ -2273,12 +3465,43 @@ gboolean document_search_bar_find(GeanyDocument *doc, const gchar *text, gboolea
 
 	g_return_val_if_fail(text != NULL, FALSE);
 	g_return_val_if_fail(doc != NULL, FALSE);
+
+	search_bar_cancel();
 	if (! *text)
 		return TRUE;
 
 	start_pos = (inc || backwards) ? sci_get_selection_start(doc->editor->sci) :
 		sci_get_selection_end(doc->editor->sci);	/* equal if no selection */
 
+	/* typing more characters of a text not found doesn't need searching again */
+	if (inc && search_bar.failed_text && g_str_has_prefix(text, search_bar.failed_text) &&
+		search_bar.failed_doc_id == doc->id &&
+		search_bar.failed_text_version == doc->priv->text_version)
+	{
+		search_bar_not_found(doc, text, inc, start_pos);
+		return FALSE;
+	}
+
+	if (inc && ! backwards && sci_get_length(doc->editor->sci) > SEARCH_BAR_CHUNK)
+	{
+		search_bar.doc_id = doc->id;
+		search_bar.text_version = doc->priv->text_version;
+		search_bar.text = g_strdup(text);
+		search_bar.start_pos = start_pos;
+		search_bar.pos = start_pos;
+		search_bar.wrapped = FALSE;
+
+		if (search_bar_find_chunk(doc->editor->sci, &ttf, &search_pos) && search_pos != -1)
+		{
+			search_bar_cancel();
+			search_bar_show_match(doc, &ttf);
+			return TRUE;
+		}
+
+		search_bar.source_id = g_idle_add(search_bar_find_idle, NULL);
+		return TRUE;
+	}
+
 	/* search cursor to end or start */
 	ttf.chrg.cpMin = start_pos;
 	ttf.chrg.cpMax = backwards ? 0 : sci_get_length(doc->editor->sci);
@@ -2303,32 +3526,12 @@ gboolean document_search_bar_find(GeanyDocument *doc, const gchar *text, gboolea
 
 	if (search_pos != -1)
 	{
-		gint line = sci_get_line_from_position(doc->editor->sci, ttf.chrgText.cpMin);
-
-		/* unfold maybe folded results */
-		sci_ensure_line_is_visible(doc->editor->sci, line);
-
-		sci_set_selection_start(doc->editor->sci, ttf.chrgText.cpMin);
-		sci_set_selection_end(doc->editor->sci, ttf.chrgText.cpMax);
-
-		if (! editor_line_in_view(doc->editor, line))
-		{	/* we need to force scrolling in case the cursor is outside of the current visible area
-			 * GeanyDocument::scroll_percent doesn't work because sci isn't always updated
-			 * while searching */
-			editor_scroll_to_line(doc->editor, -1, 0.3F);
-		}
-		else
-			sci_scroll_caret(doc->editor->sci); /* may need horizontal scrolling */
+		search_bar_show_match(doc, &ttf);
 		return TRUE;
 	}
 	else
 	{
-		if (! inc)
-		{
-			ui_set_statusbar(FALSE, _("\"%s\" was not found."), text);
-		}
-		utils_beep();
-		sci_goto_pos(doc->editor->sci, start_pos, FALSE);	/* clear selection */
+		search_bar_not_found(doc, text, inc, start_pos);
 		return FALSE;
 	}
 }
@@ -2656,29 +3859,84 @@ gint document_replace_all(GeanyDocument *doc, const gchar *find_text, const gcha
 	if (! *find_text)
 		return FALSE;
 
-	len = sci_get_length(doc->editor->sci);
-	count = document_replace_range(
-			doc, find_text, replace_text, flags, 0, len, TRUE, NULL);
+	len = sci_get_length(doc->editor->sci);
+	count = document_replace_range(
+			doc, find_text, replace_text, flags, 0, len, TRUE, NULL);
+
+	show_replace_summary(doc, count, original_find_text, original_replace_text);
+	return count;
+}
+
+
+/* Tags of unmodified documents are cached in the configuration directory so
+ * files don't have to be parsed again when opened next time. The cache key
+ * consists of Geany's version (parsers change between versions), the parser
+ * and the size and checksum of the parsed buffer. */
+static gchar *get_tag_cache_filename(GeanyDocument *doc)
+{
+	gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, doc->tm_file->file_name, -1);
+	gchar *fname = g_build_filename(app->configdir, "tagcache", checksum, NULL);
+
+	g_free(checksum);
+	return fname;
+}
+
+
+static gchar *get_tag_cache_key(GeanyDocument *doc, const guchar *buffer, gsize len)
+{
+	gchar *checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA1, buffer, len);
+	gchar *key = g_strdup_printf("%s;%s;%u;%" G_GSIZE_FORMAT ";%s", PACKAGE_VERSION,
+		tm_source_file_get_lang_name(doc->tm_file->lang),
+		tm_ctags_get_ignore_symbols_hash(), len, checksum);
+
+	g_free(checksum);
+	return key;
+}
+
+
+static gboolean load_cached_tags(GeanyDocument *doc, const gchar *key)
+{
+	gchar *fname = get_tag_cache_filename(doc);
+	GPtrArray *tags = tm_source_file_read_tags_cache(doc->tm_file, fname, key);
+
+	g_free(fname);
+	if (!tags)
+		return FALSE;
+
+	tm_workspace_set_source_file_tags(doc->tm_file, tags);
+	g_ptr_array_free(tags, TRUE);
+	return TRUE;
+}
+
+
+static void save_cached_tags(GeanyDocument *doc, const gchar *key)
+{
+	gchar *dir = g_build_filename(app->configdir, "tagcache", NULL);
+	gchar *fname = get_tag_cache_filename(doc);
+
+	if (utils_mkdir(dir, TRUE) == 0)
+		tm_source_file_write_tags_cache(doc->tm_file, fname, key);
 
-	show_replace_summary(doc, count, original_find_text, original_replace_text);
-	return count;
+	g_free(fname);
+	g_free(dir);
 }
 
 
-/*
- * Parses or re-parses the document's buffer and updates the type
- * keywords and symbol list.
- *
- * @param doc The document.
- */
-void document_update_tags(GeanyDocument *doc)
+static void update_tags(GeanyDocument *doc)
 {
 	guchar *buffer_ptr;
+	gint64 start_time;
+	gboolean new_tm_file = FALSE;
+	gchar *cache_key = NULL;
 	gsize len;
 
 	g_return_if_fail(DOC_VALID(doc));
 	g_return_if_fail(app->tm_workspace != NULL);
 
+	/* parsed by document_finish_deferred_init() */
+	if (doc->priv->init_pending)
+		return;
+
 	/* early out if it's a new file or doesn't support tags */
 	if (! doc->file_name || ! doc->file_type || !filetype_has_tags(doc->file_type))
 	{
@@ -2701,7 +3959,10 @@ void document_update_tags(GeanyDocument *doc)
 		g_free(locale_filename);
 
 		if (doc->tm_file)
+		{
 			tm_workspace_add_source_file_noupdate(doc->tm_file);
+			new_tm_file = TRUE;
+		}
 	}
 
 	/* early out if there's no tm source file and we couldn't create one */
@@ -2718,22 +3979,233 @@ void document_update_tags(GeanyDocument *doc)
 	 * Note: this buffer *MUST NOT* be modified */
 	len = sci_get_length(doc->editor->sci);
 	buffer_ptr = (guchar *) SSM(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
-	tm_workspace_update_source_file_buffer(doc->tm_file, buffer_ptr, len);
+
+	/* the buffer matches the file on disk */
+	if (! doc->changed)
+		cache_key = get_tag_cache_key(doc, buffer_ptr, len);
+
+	if (! cache_key || ! new_tm_file || ! load_cached_tags(doc, cache_key))
+	{
+		const TMParserStats *stats = tm_workspace_get_parser_stats(doc->tm_file->lang);
+		TMParserStats old_stats = {0};
+
+		if (stats)
+			old_stats = *stats;
+
+		start_time = g_get_monotonic_time();
+		/* if we know which lines changed since the last parse, TM can try to only
+		 * reparse these */
+		if (! new_tm_file && doc->priv->tags_lines_changed)
+		{
+			GeanyDocumentPrivate *priv = doc->priv;
+
+			tm_workspace_update_source_file_buffer_lines(doc->tm_file, buffer_ptr, len,
+				priv->tags_first_changed_line + 1,
+				priv->tags_last_changed_line - priv->tags_changed_line_delta + 1,
+				priv->tags_changed_line_delta);
+		}
+		else
+			tm_workspace_update_source_file_buffer(doc->tm_file, buffer_ptr, len);
+		doc->priv->tag_list_update_duration = g_get_monotonic_time() - start_time;
+
+		if (app->debug_mode && stats)
+		{
+			geany_debug("Parsed %s with the %s parser: %" G_GUINT64_FORMAT " tags from %"
+				G_GSIZE_FORMAT " bytes, parse %.2f ms, merge %.2f ms",
+				DOC_FILENAME(doc), tm_source_file_get_lang_name(doc->tm_file->lang),
+				stats->tags - old_stats.tags, len,
+				(stats->parse_time - old_stats.parse_time) / 1000.0,
+				(stats->merge_time - old_stats.merge_time) / 1000.0);
+		}
+
+		if (cache_key)
+			save_cached_tags(doc, cache_key);
+	}
+	g_free(cache_key);
+	doc->priv->tags_lines_changed = FALSE;
 
 	sidebar_update_tag_list(doc, TRUE);
 	document_highlight_tags(doc);
 }
 
 
-static void document_highlight_keywords(GeanyDocument *doc, const gchar *keywords, gint keyword_idx)
+/*
+ * Parses or re-parses the document's buffer and updates the type
+ * keywords and symbol list.
+ *
+ * @param doc The document.
+ */
+void document_update_tags(GeanyDocument *doc)
+{
+	stallwatch_enter("document_update_tags");
+	update_tags(doc);
+	stallwatch_leave();
+}
+
+
+/* Compares the keywords starting at a and b, which end at a space or the end of the string. */
+static gint compare_keywords(const gchar *a, const gchar *b)
+{
+	while (*a == *b && *a != ' ' && *a != '\0')
+	{
+		a++;
+		b++;
+	}
+	if ((*a == ' ' || *a == '\0') && (*b == ' ' || *b == '\0'))
+		return 0;
+	/* a space ends the keyword, so it sorts before everything */
+	return (*a == ' ' ? 0 : (guchar) *a) - (*b == ' ' ? 0 : (guchar) *b);
+}
+
+
+static const gchar *next_keyword(const gchar *keyword)
+{
+	while (*keyword != ' ' && *keyword != '\0')
+		keyword++;
+	while (*keyword == ' ')
+		keyword++;
+	return keyword;
+}
+
+
+static void append_keyword(GString *str, const gchar *keyword)
+{
+	const gchar *end = keyword;
+
+	while (*end != ' ' && *end != '\0')
+		end++;
+	if (str->len > 0)
+		g_string_append_c(str, ' ');
+	g_string_append_len(str, keyword, end - keyword);
+}
+
+
+/* Finds the keywords only in one of the sorted keyword strings old_keywords and
+ * new_keywords. Returns FALSE if they aren't both sorted or differ by
+ * more than KEYWORDS_DIFF_MAX keywords. */
+static gboolean diff_keywords(const gchar *old_keywords, const gchar *new_keywords,
+		GString *added, GString *removed)
+{
+	const gchar *old_kw = old_keywords;
+	const gchar *new_kw = new_keywords;
+	const gchar *old_prev = NULL;
+	const gchar *new_prev = NULL;
+	guint n_changes = 0;
+
+	while (*old_kw == ' ')
+		old_kw++;
+	while (*new_kw == ' ')
+		new_kw++;
+	while (*old_kw != '\0' || *new_kw != '\0')
+	{
+		gint cmp;
+
+		if ((old_prev && *old_kw != '\0' && compare_keywords(old_prev, old_kw) >= 0) ||
+			(new_prev && *new_kw != '\0' && compare_keywords(new_prev, new_kw) >= 0))
+			return FALSE;
+
+		if (*old_kw == '\0')
+			cmp = 1;
+		else if (*new_kw == '\0')
+			cmp = -1;
+		else
+			cmp = compare_keywords(old_kw, new_kw);
+
+		if (cmp != 0 && ++n_changes > KEYWORDS_DIFF_MAX)
+			return FALSE;
+		if (cmp < 0)
+			append_keyword(removed, old_kw);
+		else if (cmp > 0)
+			append_keyword(added, new_kw);
+
+		if (cmp <= 0)
+		{
+			old_prev = old_kw;
+			old_kw = next_keyword(old_kw);
+		}
+		if (cmp >= 0)
+		{
+			new_prev = new_kw;
+			new_kw = next_keyword(new_kw);
+		}
+	}
+	return TRUE;
+}
+
+
+/* Returns the first position where one of the keywords is used before first, or
+ * before the end of the styled text if first is -1. Returns first if there is none. */
+static gint find_first_keyword_use(GeanyDocument *doc, const gchar *keywords, gint first)
+{
+	gchar **words = g_strsplit(keywords, " ", -1);
+	gint end_styled = sci_get_end_styled(doc->editor->sci);
+	gchar **word;
+
+	foreach_strv(word, words)
+	{
+		struct Sci_TextToFind ttf;
+
+		if (**word == '\0')
+			continue;
+		ttf.chrg.cpMin = 0;
+		ttf.chrg.cpMax = first >= 0 ? first : end_styled;
+		ttf.lpstrText = *word;
+		if (sci_find_text(doc->editor->sci, SCFIND_MATCHCASE | SCFIND_WHOLEWORD, &ttf) >= 0)
+			first = ttf.chrgText.cpMin;
+	}
+	g_strfreev(words);
+	return first;
+}
+
+
+/* Updates the type keywords incrementally if only a few of them changed, and
+ * restyles from the first place one of them is used instead of the whole
+ * document. Returns FALSE if the lexer can't do that. */
+static gboolean update_keywords(GeanyDocument *doc, const gchar *keywords, gint keyword_idx)
 {
-	guint hash = g_str_hash(keywords);
+	ScintillaObject *sci = doc->editor->sci;
+	GString *added;
+	GString *removed;
+	gboolean done = FALSE;
+
+	if (! doc->priv->keywords)
+		return FALSE;
+
+	added = g_string_new(NULL);
+	removed = g_string_new(NULL);
+	if (diff_keywords(doc->priv->keywords, keywords, added, removed) &&
+		(removed->len == 0 || sci_remove_keywords(sci, keyword_idx, removed->str)) &&
+		(added->len == 0 || sci_add_keywords(sci, keyword_idx, added->str)))
+	{
+		gint first_use = find_first_keyword_use(doc, added->str, -1);
+
+		first_use = find_first_keyword_use(doc, removed->str, first_use);
+
+		/* the rest is styled again when it is next drawn */
+		if (first_use >= 0)
+		{
+			sci_start_styling(sci, sci_get_position_from_line(sci,
+				sci_get_line_from_position(sci, first_use)));
+			gtk_widget_queue_draw(GTK_WIDGET(sci));
+		}
+		done = TRUE;
+	}
+	g_string_free(added, TRUE);
+	g_string_free(removed, TRUE);
+	return done;
+}
 
-	if (hash != doc->priv->keyword_hash)
+
+static void document_highlight_keywords(GeanyDocument *doc, const gchar *keywords, gint keyword_idx)
+{
+	if (g_strcmp0(keywords, doc->priv->keywords) != 0)
 	{
-		sci_set_keywords(doc->editor->sci, keyword_idx, keywords);
-		queue_colourise(doc); /* force re-highlighting the entire document */
-		doc->priv->keyword_hash = hash;
+		if (! update_keywords(doc, keywords, keyword_idx))
+		{
+			sci_set_keywords(doc->editor->sci, keyword_idx, keywords);
+			queue_colourise(doc); /* force re-highlighting the entire document */
+		}
+		SETPTR(doc->priv->keywords, g_strdup(keywords));
 	}
 }
 
@@ -2759,16 +4231,12 @@ static void lsp_highlight_cb(gpointer user_data)
 }
 
 
-/* Re-highlights type keywords without re-parsing the whole document. */
-void document_highlight_tags(GeanyDocument *doc)
+/* some filetypes support type keywords (such as struct names), but not
+ * necessarily all filetypes for a particular scintilla lexer.  this
+ * tells us whether the filetype supports keywords, and if so
+ * which index to use for the scintilla keywords set (-1 if unsupported). */
+static gint get_type_keyword_idx(GeanyDocument *doc)
 {
-	GString *keywords_str;
-	gint keyword_idx;
-
-	/* some filetypes support type keywords (such as struct names), but not
-	 * necessarily all filetypes for a particular scintilla lexer.  this
-	 * tells us whether the filetype supports keywords, and if so
-	 * which index to use for the scintilla keywords set. */
 	switch (doc->file_type->id)
 	{
 		case GEANY_FILETYPES_C:
@@ -2785,12 +4253,36 @@ void document_highlight_tags(GeanyDocument *doc)
 			/* index of the keyword set in the Scintilla lexer, for
 			 * example in LexCPP.cxx, see "cppWordLists" global array.
 			 * TODO: this magic number should be a member of the filetype */
-			keyword_idx = 3;
-			break;
+			return 3;
 		}
 		default:
-			return; /* early out if type keywords are not supported */
+			return -1;
 	}
+}
+
+
+/* Re-applies type keywords cached by the LSP plugin without requesting them again. */
+void document_highlight_lsp_tags(GeanyDocument *doc)
+{
+	gint keyword_idx = get_type_keyword_idx(doc);
+	const gchar *keywords;
+
+	if (keyword_idx < 0 || !lsp_symbol_highlight_available(doc))
+		return;
+
+	keywords = lsp_symbol_highlight_get_cached(doc);
+	document_highlight_keywords(doc, keywords ? keywords : "", keyword_idx);
+}
+
+
+/* Re-highlights type keywords without re-parsing the whole document. */
+void document_highlight_tags(GeanyDocument *doc)
+{
+	GString *keywords_str;
+	gint keyword_idx = get_type_keyword_idx(doc);
+
+	if (keyword_idx < 0)
+		return; /* early out if type keywords are not supported */
 	if (!app->tm_workspace->tags_array)
 		return;
 
@@ -2801,11 +4293,19 @@ void document_highlight_tags(GeanyDocument *doc)
 
 		data->doc = doc;
 		data->keyword_idx = keyword_idx;
+		doc->priv->typename_generation = 0;
 		document_highlight_keywords(doc, keywords ? keywords : "", keyword_idx);
 		lsp_symbol_highlight_request(doc, lsp_highlight_cb, data);
 	}
 	else
 	{
+		guint generation = tm_workspace_get_typename_generation();
+
+		/* no type names changed since the keywords were set, don't rebuild them */
+		if (doc->priv->typename_generation == generation)
+			return;
+		doc->priv->typename_generation = generation;
+
 		/* get any type keywords and tell scintilla about them
 		 * this will cause the type keywords to be colourized in scintilla */
 		keywords_str = symbols_find_typenames_as_string(doc->file_type->lang, FALSE);
@@ -2836,8 +4336,45 @@ static gboolean on_document_update_tag_list_idle(gpointer data)
 }
 
 
+/* moves line after lines_added lines were added (or removed) after changed_line */
+static gint move_changed_line(gint line, gint changed_line, gint lines_added)
+{
+	if (line <= changed_line)
+		return line;
+	/* lines removed after changed_line are merged into it */
+	return MAX(line + lines_added, changed_line);
+}
+
+
+/* Records that @a line was modified and @a lines_added lines were added after it (or
+ * removed when negative), so that the next tags update can reparse only the changed
+ * part of the document. */
+void document_tags_lines_changed(GeanyDocument *doc, gint line, gint lines_added)
+{
+	GeanyDocumentPrivate *priv = doc->priv;
+	gint last_line = line + MAX(lines_added, 0);
+
+	if (! priv->tags_lines_changed)
+	{
+		priv->tags_lines_changed = TRUE;
+		priv->tags_first_changed_line = line;
+		priv->tags_last_changed_line = last_line;
+		priv->tags_changed_line_delta = lines_added;
+		return;
+	}
+
+	priv->tags_first_changed_line = MIN(line,
+		move_changed_line(priv->tags_first_changed_line, line, lines_added));
+	priv->tags_last_changed_line = MAX(last_line,
+		move_changed_line(priv->tags_last_changed_line, line, lines_added));
+	priv->tags_changed_line_delta += lines_added;
+}
+
+
 void document_update_tag_list_in_idle(GeanyDocument *doc)
 {
+	gint64 delay;
+
 	if (editor_prefs.autocompletion_update_freq <= 0 || ! filetype_has_tags(doc->file_type))
 		return;
 
@@ -2845,8 +4382,13 @@ void document_update_tag_list_in_idle(GeanyDocument *doc)
 	if (doc->priv->tag_list_update_source != 0)
 		g_source_remove(doc->priv->tag_list_update_source);
 
+	/* parsing happens on the main thread, so for big files wait longer */
+	delay = doc->priv->tag_list_update_duration * TAG_LIST_UPDATE_DELAY_FACTOR / 1000;
+	delay = CLAMP(delay, editor_prefs.autocompletion_update_freq,
+		MAX(editor_prefs.autocompletion_update_freq, TAG_LIST_UPDATE_MAX_DELAY));
+
 	doc->priv->tag_list_update_source = g_timeout_add_full(G_PRIORITY_LOW,
-		editor_prefs.autocompletion_update_freq, on_document_update_tag_list_idle, doc, NULL);
+		(guint) delay, on_document_update_tag_list_idle, doc, NULL);
 }
 
 
@@ -2860,6 +4402,7 @@ static void document_load_config(GeanyDocument *doc, GeanyFiletype *type,
 	if (filetype_changed)
 	{
 		doc->file_type = type;
+		doc->priv->reload_config_pending = FALSE;
 
 		/* delete tm file object to force creation of a new one */
 		if (doc->tm_file != NULL)
@@ -2868,17 +4411,21 @@ static void document_load_config(GeanyDocument *doc, GeanyFiletype *type,
 			tm_source_file_free(doc->tm_file);
 			doc->tm_file = NULL;
 		}
-		/* load tags files before highlighting (some lexers highlight global typenames) */
+		/* start loading the tags files, the global typenames some lexers highlight are
+		 * added to the highlighting once they are loaded */
 		if (type->id != GEANY_FILETYPES_NONE)
 			symbols_global_tags_loaded(type->id);
 
 		highlighting_set_styles(doc->editor->sci, type);
+		/* the styles of all braces may change */
+		brace_index_invalidate(doc, 0);
 		editor_set_indentation_guides(doc->editor);
 		build_menu_update(doc);
 		queue_colourise(doc);
 		/* forces re-setting SCI_SETKEYWORDS which seems to be needed with
 		 * Scintilla 5 to colorize them properly */
-		doc->priv->keyword_hash = 0;
+		SETPTR(doc->priv->keywords, NULL);
+		doc->priv->typename_generation = 0;
 		if (type->priv->symbol_list_sort_mode == SYMBOLS_SORT_USE_PREVIOUS)
 			doc->priv->symbol_list_sort_mode = interface_prefs.symbols_sort_mode;
 		else
@@ -2926,7 +4473,7 @@ void document_set_filetype(GeanyDocument *doc, GeanyFiletype *type)
 		}
 
 		sidebar_openfiles_update(doc); /* to update the icon */
-		g_signal_emit_by_name(geany_object, "document-filetype-set", doc, old_ft);
+		geany_object_emit("document-filetype-set", doc, old_ft);
 	}
 }
 
@@ -2937,6 +4484,17 @@ void document_reload_config(GeanyDocument *doc)
 }
 
 
+/* Like document_reload_config(), but for a document in the background it's done once
+ * the document is shown, see document_finish_deferred_init(). */
+void document_queue_reload_config(GeanyDocument *doc)
+{
+	if (doc == document_get_current())
+		document_reload_config(doc);
+	else
+		doc->priv->reload_config_pending = TRUE;
+}
+
+
 /**
  *  Sets the encoding of a document.
  *  This function only set the encoding of the %document, it does not any conversions. The new
@@ -3450,14 +5008,33 @@ gboolean document_account_for_unsaved(void)
 
 static void force_close_all(void)
 {
-	guint i;
+	GeanyDocument *cur_doc = document_get_current();
+	guint i, closed = 0;
 
 	main_status.closing_all = TRUE;
+	closed_tm_files = g_ptr_array_new();
+	sidebar_openfiles_freeze(TRUE);
 
+	/* close the current document last, so the notebook doesn't switch to another
+	 * page for each closed document */
 	foreach_document(i)
 	{
-		document_close(documents[i]);
+		if (documents[i] != cur_doc && document_close(documents[i]))
+			closed++;
 	}
+	if (DOC_VALID(cur_doc) && document_close(cur_doc))
+		closed++;
+
+	/* remove the tags of all the documents in one pass over the workspace */
+	if (closed_tm_files->len > 0)
+		tm_workspace_remove_source_files(closed_tm_files);
+	g_ptr_array_foreach(closed_tm_files, (GFunc) tm_source_file_free, NULL);
+	g_ptr_array_free(closed_tm_files, TRUE);
+	closed_tm_files = NULL;
+
+	sidebar_openfiles_freeze(FALSE);
+	if (closed > 0 && ! main_status.quitting)
+		msgwin_status_add(ngettext("%d file closed.", "%d files closed.", closed), closed);
 
 	main_status.closing_all = FALSE;
 }
@@ -3738,18 +5315,10 @@ static void monitor_resave_missing_file(GeanyDocument *doc)
 }
 
 
-/* Set force to force a disk check, otherwise it is ignored if there was a check
- * in the last file_prefs.disk_check_timeout seconds.
- * @return @c TRUE if the file has changed. */
-gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
+/* Decides whether the file of doc has to be queried, see document_check_disk_status(). */
+static gboolean need_disk_check(GeanyDocument *doc, gboolean force)
 {
-	gboolean ret = FALSE;
 	gboolean use_gio_filemon;
-	time_t mtime = 0;
-	gchar *locale_filename;
-	FileDiskStatus old_status;
-
-	g_return_val_if_fail(doc != NULL, FALSE);
 
 	/* ignore remote files and documents that have never been saved to disk */
 	if (notebook_switch_in_progress() || file_prefs.disk_check_timeout == 0
@@ -3772,9 +5341,18 @@ gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
 
 		doc->priv->last_check = cur_time;
 	}
+	return TRUE;
+}
 
-	locale_filename = utils_get_locale_from_utf8(doc->file_name);
-	if (!get_mtime(locale_filename, &mtime))
+
+/* Acts on the result of querying the file of doc.
+ * @return @c TRUE if the file has changed. */
+static gboolean update_disk_status(GeanyDocument *doc, gboolean exists, time_t mtime)
+{
+	gboolean ret = FALSE;
+	FileDiskStatus old_status;
+
+	if (!exists)
 	{
 		monitor_resave_missing_file(doc);
 		/* doc may be closed now */
@@ -3788,7 +5366,6 @@ gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
 		/* doc may be closed now */
 		ret = TRUE;
 	}
-	g_free(locale_filename);
 
 	if (DOC_VALID(doc))
 	{	/* doc can get invalid when a document was closed */
@@ -3801,6 +5378,168 @@ gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
 }
 
 
+/* Set force to force a disk check, otherwise it is ignored if there was a check
+ * in the last file_prefs.disk_check_timeout seconds.
+ * @return @c TRUE if the file has changed. */
+gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
+{
+	time_t mtime = 0;
+	gchar *locale_filename;
+	gboolean exists;
+
+	g_return_val_if_fail(doc != NULL, FALSE);
+
+	if (! need_disk_check(doc, force))
+		return FALSE;
+
+	locale_filename = utils_get_locale_from_utf8(doc->file_name);
+	exists = get_mtime(locale_filename, &mtime);
+	g_free(locale_filename);
+
+	return update_disk_status(doc, exists, mtime);
+}
+
+
+typedef struct
+{
+	guint doc_id;
+	gchar *locale_filename;
+	time_t doc_mtime;	/* to notice the document was saved or reloaded meanwhile */
+	time_t mtime;
+	gchar *error;
+}
+DiskCheck;
+
+
+static void free_disk_checks(GPtrArray *checks)
+{
+	guint i;
+
+	for (i = 0; i < checks->len; i++)
+	{
+		DiskCheck *check = checks->pdata[i];
+
+		g_free(check->locale_filename);
+		g_free(check->error);
+		g_free(check);
+	}
+	g_ptr_array_free(checks, TRUE);
+}
+
+
+static gboolean finish_disk_checks_idle(gpointer data)
+{
+	GPtrArray *checks = data;
+	guint i;
+
+	/* documents_array is gone when quitting */
+	if (disk_check_pool == NULL)
+	{
+		free_disk_checks(checks);
+		return G_SOURCE_REMOVE;
+	}
+
+	for (i = 0; i < checks->len; i++)
+	{
+		DiskCheck *check = checks->pdata[i];
+		GeanyDocument *doc = document_find_by_id(check->doc_id);
+		gchar *locale_filename;
+		gboolean same_file;
+
+		/* the document may have been closed, renamed or saved meanwhile */
+		if (doc == NULL || doc->real_path == NULL || doc->priv->mtime != check->doc_mtime)
+			continue;
+		locale_filename = utils_get_locale_from_utf8(doc->file_name);
+		same_file = utils_str_equal(locale_filename, check->locale_filename);
+		g_free(locale_filename);
+		if (! same_file)
+			continue;
+
+		if (check->error)
+			show_mtime_error(check->locale_filename, check->error);
+		update_disk_status(doc, check->error == NULL, check->mtime);
+	}
+
+	free_disk_checks(checks);
+	return G_SOURCE_REMOVE;
+}
+
+
+static void disk_check_thread(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	GPtrArray *checks = data;
+	guint i;
+
+	for (i = 0; i < checks->len; i++)
+	{
+		DiskCheck *check = checks->pdata[i];
+
+		check->error = query_mtime(check->locale_filename, &check->mtime);
+	}
+
+	g_idle_add(finish_disk_checks_idle, checks);
+}
+
+
+static gboolean start_disk_checks_idle(G_GNUC_UNUSED gpointer data)
+{
+	GPtrArray *checks = g_ptr_array_new();
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init(&iter, queued_disk_checks);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		GeanyDocument *doc = document_find_by_id(GPOINTER_TO_UINT(key));
+		DiskCheck *check;
+
+		if (doc == NULL)
+			continue;
+
+		check = g_new0(DiskCheck, 1);
+		check->doc_id = doc->id;
+		check->locale_filename = utils_get_locale_from_utf8(doc->file_name);
+		check->doc_mtime = doc->priv->mtime;
+		g_ptr_array_add(checks, check);
+	}
+	g_hash_table_remove_all(queued_disk_checks);
+	disk_check_source_id = 0;
+
+	if (checks->len == 0)
+	{
+		g_ptr_array_free(checks, TRUE);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* a single thread, so the checks don't compete for a slow file system */
+	if (disk_check_pool == NULL)
+		disk_check_pool = g_thread_pool_new(disk_check_thread, NULL, 1, FALSE, NULL);
+	g_thread_pool_push(disk_check_pool, checks, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+/* Like document_check_disk_status(doc, TRUE) but the file is queried by a worker thread,
+ * so that focusing the window or switching tabs doesn't wait for slow (e.g. network)
+ * file systems. The checks queued until the next main loop iteration are done together
+ * and the documents only get updated when their file has changed. */
+void document_queue_disk_check(GeanyDocument *doc)
+{
+	g_return_if_fail(doc != NULL);
+
+	if (! need_disk_check(doc, TRUE))
+		return;
+
+	if (queued_disk_checks == NULL)
+		queued_disk_checks = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_add(queued_disk_checks, GUINT_TO_POINTER(doc->id));
+
+	if (disk_check_source_id == 0)
+		disk_check_source_id = g_idle_add(start_disk_checks_idle, NULL);
+}
+
+
 /** Compares documents by their display names.
  * This matches @c GCompareFunc for use with e.g. @c g_ptr_array_sort().
  * @note 'Display name' means the base name of the document's filename.
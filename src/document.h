@@ -67,6 +67,8 @@ typedef struct GeanyFilePrefs
 	gboolean		show_keep_edit_history_on_reload_msg; /* whether to show the message introducing the above feature */
  	gboolean		reload_clean_doc_on_file_change;
  	gboolean		save_config_on_file_change;
+	gint			large_file_threshold;	/* in MiB, 0 to disable the large file mode */
+	gint			tags_parse_timeout;	/* in ms, 0 to parse symbols in the Geany process */
 }
 GeanyFilePrefs;
 
@@ -215,6 +217,8 @@ gint document_compare_by_tab_order_reverse(gconstpointer a, gconstpointer b);
 
 GeanyDocument *document_find_by_id(guint id);
 
+GBytes *document_get_snapshot(GeanyDocument *doc, guint *version);
+
 
 #ifdef GEANY_PRIVATE
 
@@ -241,6 +245,14 @@ GeanyDocument *document_find_by_sci(ScintillaObject *sci);
 void document_show_tab(GeanyDocument *doc);
 void document_show_tab_idle(GeanyDocument *doc);
 
+void document_preload_file(const gchar *locale_filename, const gchar *forced_enc);
+
+void document_clear_preloaded_files(void);
+
+void document_finish_deferred_init(GeanyDocument *doc);
+
+void document_queue_reload_config(GeanyDocument *doc);
+
 void document_init_doclist(void);
 
 void document_finalize(void);
@@ -249,6 +261,8 @@ void document_try_focus(GeanyDocument *doc, GtkWidget *source_widget);
 
 gboolean document_account_for_unsaved(void);
 
+gboolean document_save_file_async(GeanyDocument *doc, gboolean force);
+
 gboolean document_close_all(void);
 
 GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
@@ -276,10 +290,18 @@ void document_update_tags(GeanyDocument *doc);
 
 void document_update_tag_list_in_idle(GeanyDocument *doc);
 
+void document_tags_lines_changed(GeanyDocument *doc, gint line, gint lines_added);
+
+void document_text_modified(GeanyDocument *doc);
+
 void document_highlight_tags(GeanyDocument *doc);
 
+void document_highlight_lsp_tags(GeanyDocument *doc);
+
 gboolean document_check_disk_status(GeanyDocument *doc, gboolean force);
 
+void document_queue_disk_check(GeanyDocument *doc);
+
 /* own Undo / Redo implementation to be able to undo / redo changes
  * to the encoding or the Unicode BOM (which are Scintilla independent).
  * All Scintilla events are stored in the undo / redo buffer and are passed through. */
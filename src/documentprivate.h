@@ -90,7 +90,12 @@ typedef struct GeanyDocumentPrivate
 	/* Used so Undo/Redo works for encoding changes. */
 	FileEncoding	 saved_encoding;
 	gboolean		 colourise_needed;	/* use document.c:queue_colourise() instead */
-	guint			 keyword_hash;	/* hash of keyword string used for typename colourisation */
+	/* Source colourising the document while idle, and the next line it lexes */
+	guint			 colourise_idle_id;
+	gint			 colourise_line;
+	gchar			*keywords;	/* keyword string used for typename colourisation, NULL if unset */
+	/* tm_workspace_get_typename_generation() when the typename keywords were set, 0 if unset */
+	guint			 typename_generation;
 	gint			 line_count;		/* Number of lines in the document. */
 	gint			 symbol_list_sort_mode;
 	/* indicates whether a file is on a remote filesystem, works only with GIO/GVfs */
@@ -105,6 +110,14 @@ typedef struct GeanyDocumentPrivate
 	time_t			 mtime;
 	/* ID of the idle callback updating the tag list */
 	guint			 tag_list_update_source;
+	/* How long the last tags update took, in microseconds */
+	gint64			 tag_list_update_duration;
+	/* Lines changed since the last tags update (in current line numbers) and the number
+	 * of lines added meanwhile, see document_tags_lines_changed() */
+	gboolean		 tags_lines_changed;
+	gint			 tags_first_changed_line;
+	gint			 tags_last_changed_line;
+	gint			 tags_changed_line_delta;
 	/* Whether it's temporarily protected (read-only and saving needs confirmation). Does
 	 * not imply doc->readonly as writable files can be protected */
 	gint			 protected;
@@ -116,6 +129,25 @@ typedef struct GeanyDocumentPrivate
 	gchar			*tag_filter;
 	/* Group symbols in symbol tree by their type. */
 	gboolean		symbols_group_by_type;
+	/* Incremented on each modification of the text, see document_get_snapshot() */
+	guint			 text_version;
+	/* Contents of the document at text_version, NULL until requested */
+	GBytes			*snapshot;
+	/* Whether the document was opened in large file mode, see document_set_large_file_mode() */
+	gboolean		 large_file;
+	/* Whether the autocompletion images are registered, done when the editor is first drawn */
+	gboolean		 icons_registered;
+	/* Cancels the loading of the file in the background, NULL once it is loaded */
+	GCancellable	*load_cancellable;
+	/* Whether the symbols are parsed once the document is shown, see document_preload_file() */
+	gboolean		 init_pending;
+	/* Whether the filetype settings are applied once the document is shown,
+	 * see document_queue_reload_config() */
+	gboolean		 reload_config_pending;
+	/* The save in progress in the background, see document_save_file_async() */
+	struct BackgroundSave *background_save;
+	/* Matching braces of big documents, NULL until a brace is matched, see braceindex.c */
+	struct BraceIndex *brace_index;
 }
 GeanyDocumentPrivate;
 
@@ -38,6 +38,7 @@
 #include "editor.h"
 
 #include "app.h"
+#include "braceindex.h"
 #include "callbacks.h"
 #include "dialogs.h"
 #include "documentprivate.h"
@@ -50,6 +51,7 @@
 #include "prefs.h"
 #include "projectprivate.h"
 #include "sciwrappers.h"
+#include "stallwatch.h"
 #include "support.h"
 #include "symbols.h"
 #include "templates.h"
@@ -65,9 +67,17 @@
 #include <gdk/gdkkeysyms.h>
 
 
+/* the maximum time spent lexing in a single idle callback, in microseconds */
+#define COLOURISE_TIME_SLICE 20000
+/* the number of lines lexed at once */
+#define COLOURISE_CHUNK_LINES 1000
+
+
 static GHashTable *snippet_hash = NULL;
 static GtkAccelGroup *snippet_accel_group = NULL;
 static gboolean autocomplete_scope_shown = FALSE;
+/* the list of words shown by show_autocomplete(), reused for each completion */
+static GString *autocomplete_words = NULL;
 
 static const gchar geany_cursor_marker[] = "__GEANY_CURSOR_MARKER__";
 
@@ -75,7 +85,7 @@ static const gchar geany_cursor_marker[] = "__GEANY_CURSOR_MARKER__";
 static gchar current_word[GEANY_MAX_WORD_LENGTH];
 
 /* Initialised in keyfile.c. */
-GeanyEditorPrefs editor_prefs;
+GEANY_EXPORT_SYMBOL GeanyEditorPrefs editor_prefs;
 
 EditorInfo editor_info = {current_word, -1};
 
@@ -89,6 +99,11 @@ static struct
 	ScintillaObject *sci;
 } calltip = {NULL, FALSE, NULL, 0, 0, NULL};
 
+/* the formatted calltips of recently looked up names by "lang:name", see get_calltips() */
+#define CALLTIP_CACHE_SIZE 64
+static GHashTable *calltip_cache = NULL;
+static guint calltip_cache_generation = 0;
+
 static gchar indent[100];
 
 
@@ -344,7 +359,7 @@ static gboolean on_editor_button_press_event(GtkWidget *widget, GdkEventButton *
 		ui_update_popup_copy_items(doc);
 		ui_update_insert_include_item(doc, 0);
 
-		g_signal_emit_by_name(geany_object, "update-editor-menu",
+		geany_object_emit("update-editor-menu",
 			current_word, editor_info.click_pos, doc);
 
 		gtk_menu_popup_at_pointer(GTK_MENU(main_widgets.editor_menu), (GdkEvent *) event);
@@ -605,6 +620,16 @@ static void show_autocomplete(ScintillaObject *sci, gsize rootlen, GString *word
 }
 
 
+/* Returns the empty autocompletion word list, reusing its memory. */
+static GString *get_autocomplete_words(void)
+{
+	if (! autocomplete_words)
+		autocomplete_words = g_string_sized_new(150);
+	g_string_truncate(autocomplete_words, 0);
+	return autocomplete_words;
+}
+
+
 static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize rootlen)
 {
 	ScintillaObject *sci = editor->sci;
@@ -613,7 +638,7 @@ static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize roo
 
 	if (tags->len > 0)
 	{
-		GString *words = g_string_sized_new(150);
+		GString *words = get_autocomplete_words();
 		guint j;
 
 		for (j = 0; j < tags->len; ++j)
@@ -634,14 +659,9 @@ static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize roo
 
 			group = tm_parser_get_sidebar_group(tag->lang, tag->type);
 			if (group >= 0 && tm_parser_get_sidebar_info(tag->lang, group, &icon_id))
-			{
-				gchar buf[10];
-				sprintf(buf, "?%u", icon_id + 1);
-				g_string_append(words, buf);
-			}
+				g_string_append_printf(words, "?%u", icon_id + 1);
 		}
 		show_autocomplete(sci, rootlen, words);
-		g_string_free(words, TRUE);
 	}
 }
 
@@ -877,61 +897,18 @@ static void on_char_added(GeanyEditor *editor, SCNotification *nt)
 }
 
 
-/* expand() and fold_changed() are copied from SciTE (thanks) to fix #1923350. */
-static void expand(ScintillaObject *sci, gint *line, gboolean doExpand,
-		gboolean force, gint visLevels, gint level)
+/* shows the children of the fold header at line, whose fold level was level, and expands
+ * their folds in a single pass */
+static void expand_children(ScintillaObject *sci, gint line, gint level)
 {
-	gint lineMaxSubord = SSM(sci, SCI_GETLASTCHILD, *line, level & SC_FOLDLEVELNUMBERMASK);
-	gint levelLine = level;
-	(*line)++;
-	while (*line <= lineMaxSubord)
-	{
-		if (force)
-		{
-			if (visLevels > 0)
-				SSM(sci, SCI_SHOWLINES, *line, *line);
-			else
-				SSM(sci, SCI_HIDELINES, *line, *line);
-		}
-		else
-		{
-			if (doExpand)
-				SSM(sci, SCI_SHOWLINES, *line, *line);
-		}
-		if (levelLine == -1)
-			levelLine = SSM(sci, SCI_GETFOLDLEVEL, *line, 0);
-		if (levelLine & SC_FOLDLEVELHEADERFLAG)
-		{
-			if (force)
-			{
-				if (visLevels > 1)
-					SSM(sci, SCI_SETFOLDEXPANDED, *line, 1);
-				else
-					SSM(sci, SCI_SETFOLDEXPANDED, *line, 0);
-				expand(sci, line, doExpand, force, visLevels - 1, -1);
-			}
-			else
-			{
-				if (doExpand)
-				{
-					if (!sci_get_fold_expanded(sci, *line))
-						SSM(sci, SCI_SETFOLDEXPANDED, *line, 1);
-					expand(sci, line, TRUE, force, visLevels - 1, -1);
-				}
-				else
-				{
-					expand(sci, line, FALSE, force, visLevels - 1, -1);
-				}
-			}
-		}
-		else
-		{
-			(*line)++;
-		}
-	}
+	gint lineMaxSubord = SSM(sci, SCI_GETLASTCHILD, line, level & SC_FOLDLEVELNUMBERMASK);
+
+	if (lineMaxSubord > line)
+		SSM(sci, SCI_EXPANDFOLDRANGE, line + 1, lineMaxSubord);
 }
 
 
+/* fold_changed() is copied from SciTE (thanks) to fix #1923350. */
 static void fold_changed(ScintillaObject *sci, gint line, gint levelNow, gint levelPrev)
 {
 	if (levelNow & SC_FOLDLEVELHEADERFLAG)
@@ -941,7 +918,7 @@ static void fold_changed(ScintillaObject *sci, gint line, gint levelNow, gint le
 			/* Adding a fold point */
 			SSM(sci, SCI_SETFOLDEXPANDED, line, 1);
 			if (!SSM(sci, SCI_GETALLLINESVISIBLE, 0, 0))
-				expand(sci, &line, TRUE, FALSE, 0, levelPrev);
+				expand_children(sci, line, levelPrev);
 		}
 	}
 	else if (levelPrev & SC_FOLDLEVELHEADERFLAG)
@@ -951,7 +928,7 @@ static void fold_changed(ScintillaObject *sci, gint line, gint levelNow, gint le
 			 * otherwise lines are left invisible with no way to make them visible */
 			SSM(sci, SCI_SETFOLDEXPANDED, line, 1);
 			if (!SSM(sci, SCI_GETALLLINESVISIBLE, 0, 0))
-				expand(sci, &line, TRUE, FALSE, 0, levelPrev);
+				expand_children(sci, line, levelPrev);
 		}
 	}
 	if (! (levelNow & SC_FOLDLEVELWHITEFLAG) &&
@@ -1063,7 +1040,7 @@ void editor_sci_notify_cb(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED gint sc
 
 	g_return_if_fail(editor != NULL);
 
-	g_signal_emit_by_name(geany_object, "editor-notify", editor, scnt, &retval);
+	geany_object_emit("editor-notify", editor, scnt, &retval);
 }
 
 
@@ -1082,6 +1059,7 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 	ScintillaObject *sci = editor->sci;
 	GeanyDocument *doc = editor->document;
 
+	stallwatch_enter("editor notify");
 	switch (nt->nmhdr.code)
 	{
 		case SCN_SAVEPOINTLEFT:
@@ -1139,6 +1117,10 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 			}
 			if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
 			{
+				document_text_modified(doc);
+				brace_index_invalidate(doc, nt->position);
+				document_tags_lines_changed(doc, sci_get_line_from_position(sci, nt->position),
+					nt->linesAdded);
 				document_update_tag_list_in_idle(doc);
 			}
 			break;
@@ -1199,6 +1181,7 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 			update_margins(sci);
 			break;
 	}
+	stallwatch_leave();
 	/* we always return FALSE here to let plugins handle the event too */
 	return FALSE;
 }
@@ -1895,22 +1878,43 @@ static void update_tag_name_and_scope_for_calltip(const gchar *word, TMTag *tag,
 }
 
 
-static gchar *find_calltip(const gchar *word, GeanyFiletype *ft)
+/* Returns the formatted calltips of the functions named word, e.g. the overloads. They
+ * are cached until the tags change. */
+static GPtrArray *get_calltips(const gchar *word, GeanyFiletype *ft)
 {
 	const gchar *constructor_method;
 	GPtrArray *tags;
+	GPtrArray *calltips;
 	TMTag *tag;
-	GString *str = NULL;
+	gchar *key;
 	guint i;
 
-	g_return_val_if_fail(ft && word && *word, NULL);
+	if (! calltip_cache)
+		calltip_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify) g_ptr_array_unref);
+	if (calltip_cache_generation != tm_workspace_get_tags_generation() ||
+		g_hash_table_size(calltip_cache) >= CALLTIP_CACHE_SIZE)
+	{
+		g_hash_table_remove_all(calltip_cache);
+		calltip_cache_generation = tm_workspace_get_tags_generation();
+	}
+
+	key = g_strdup_printf("%d:%s", ft->lang, word);
+	calltips = g_hash_table_lookup(calltip_cache, key);
+	if (calltips)
+	{
+		g_free(key);
+		return calltips;
+	}
+	calltips = g_ptr_array_new_with_free_func(g_free);
+	g_hash_table_insert(calltip_cache, key, calltips);
 
 	/* use all types in case language uses wrong tag type e.g. python "members" instead of "methods" */
 	tags = tm_workspace_find(word, NULL, tm_tag_max_t, NULL, ft->lang);
 	if (tags->len == 0)
 	{
 		g_ptr_array_free(tags, TRUE);
-		return NULL;
+		return calltips;
 	}
 
 	tag = TM_TAG(tags->pdata[0]);
@@ -1936,12 +1940,7 @@ static gchar *find_calltip(const gchar *word, GeanyFiletype *ft)
 			tags->pdata[i] = NULL;
 	}
 	tm_tags_prune((GPtrArray *) tags);
-	if (tags->len == 0)
-	{
-		g_ptr_array_free(tags, TRUE);
-		return NULL;
-	}
-	else
+	if (tags->len > 0)
 	{	/* remove duplicate calltips */
 		TMTagAttrType sort_attr[] = {tm_tag_attr_name_t, tm_tag_attr_scope_t,
 			tm_tag_attr_arglist_t, 0};
@@ -1949,52 +1948,55 @@ static gchar *find_calltip(const gchar *word, GeanyFiletype *ft)
 		tm_tags_sort((GPtrArray *) tags, sort_attr, TRUE, FALSE);
 	}
 
+	for (i = 0; i < tags->len; i++)
+	{
+		const gchar *tag_name, *scope;
+
+		tag = TM_TAG(tags->pdata[i]);
+		tag_name = tag->name;
+		scope = tag->scope;
+		update_tag_name_and_scope_for_calltip(word, tag, constructor_method, &tag_name, &scope);
+		g_ptr_array_add(calltips,
+			tm_parser_format_function(tag->lang, tag_name, tag->arglist, tag->var_type, scope));
+	}
+	g_ptr_array_free(tags, TRUE);
+
+	return calltips;
+}
+
+
+static gchar *find_calltip(const gchar *word, GeanyFiletype *ft)
+{
+	GPtrArray *calltips;
+	GString *str;
+
+	g_return_val_if_fail(ft && word && *word, NULL);
+
+	calltips = get_calltips(word, ft);
+	if (calltips->len == 0)
+		return NULL;
+
 	/* if the current word has changed since last time, start with the first tag match */
 	if (! utils_str_equal(word, calltip.last_word))
 		calltip.tag_index = 0;
 	/* cache the current word for next time */
 	g_free(calltip.last_word);
 	calltip.last_word = g_strdup(word);
-	calltip.tag_index = MIN(calltip.tag_index, tags->len - 1);	/* ensure tag_index is in range */
+	calltip.tag_index = MIN(calltip.tag_index, calltips->len - 1);	/* ensure tag_index is in range */
 
-	for (i = calltip.tag_index; i < tags->len; i++)
+	str = g_string_new(NULL);
+	if (calltip.tag_index > 0)
+		g_string_append(str, "\001 ");	/* up arrow */
+	g_string_append(str, calltips->pdata[calltip.tag_index]);
+	if (calltip.tag_index + 1 < calltips->len) /* add a down arrow */
 	{
-		tag = TM_TAG(tags->pdata[i]);
-
-		if (str == NULL)
-		{
-			const gchar *tag_name = tag->name;
-			const gchar *scope = tag->scope;
-			gchar *f;
-
-			update_tag_name_and_scope_for_calltip(word, tag, constructor_method, &tag_name, &scope);
-			f = tm_parser_format_function(tag->lang, tag_name, tag->arglist, tag->var_type, scope);
- 			str = g_string_new(NULL);
-			if (calltip.tag_index > 0)
-				g_string_prepend(str, "\001 ");	/* up arrow */
-			g_string_append(str, f);
-			g_free(f);
-		}
-		else /* add a down arrow */
-		{
-			if (calltip.tag_index > 0)	/* already have an up arrow */
-				g_string_insert_c(str, 1, '\002');
-			else
-				g_string_prepend(str, "\002 ");
-			break;
-		}
+		if (calltip.tag_index > 0)	/* already have an up arrow */
+			g_string_insert_c(str, 1, '\002');
+		else
+			g_string_prepend(str, "\002 ");
 	}
 
-	g_ptr_array_free(tags, TRUE);
-
-	if (str)
-	{
-		gchar *result = str->str;
-
-		g_string_free(str, FALSE);
-		return result;
-	}
-	return NULL;
+	return g_string_free(str, FALSE);
 }
 
 
@@ -2129,16 +2131,23 @@ static gboolean autocomplete_check_html(GeanyEditor *editor, gint style, gint po
 }
 
 
+static gint compare_doc_words(gconstpointer a, gconstpointer b)
+{
+	return utils_str_casecmp(*(const gchar **) a, *(const gchar **) b);
+}
+
+
 /* Algorithm based on based on Scite's StartAutoCompleteWord()
- * @returns a sorted list of words matching @p root */
-static GSList *get_doc_words(ScintillaObject *sci, gchar *root, gsize rootlen)
+ * @returns a sorted array of words matching @p root, owned by @p chunk */
+static GPtrArray *get_doc_words(ScintillaObject *sci, gchar *root, gsize rootlen,
+		GStringChunk *chunk)
 {
-	gchar *word;
 	gint len, current, word_end;
 	gint pos_find, flags;
 	guint word_length;
-	gsize nmatches = 0;
-	GSList *words = NULL;
+	GPtrArray *words = g_ptr_array_new();
+	GString *word = g_string_sized_new(64);
+	GHashTable *found;
 	struct Sci_TextToFind ttf;
 
 	len = sci_get_length(sci);
@@ -2151,6 +2160,9 @@ static GSList *get_doc_words(ScintillaObject *sci, gchar *root, gsize rootlen)
 	ttf.chrgText.cpMax = 0;
 	flags = SCFIND_WORDSTART | SCFIND_MATCHCASE;
 
+	/* the words already in the array */
+	found = g_hash_table_new(g_str_hash, g_str_equal);
+
 	/* search the whole document for the word root and collect results */
 	pos_find = SSM(sci, SCI_FINDTEXT, flags, (uptr_t) &ttf);
 	while (pos_find >= 0 && pos_find < len)
@@ -2163,58 +2175,64 @@ static GSList *get_doc_words(ScintillaObject *sci, gchar *root, gsize rootlen)
 			word_length = word_end - pos_find;
 			if (word_length > rootlen)
 			{
-				word = sci_get_contents_range(sci, pos_find, word_end);
-				/* search whether we already have the word in, otherwise add it */
-				if (g_slist_find_custom(words, word, (GCompareFunc)strcmp) != NULL)
-					g_free(word);
-				else
+				/* read the word in place, only copy it if it's not in the array yet */
+				g_string_truncate(word, 0);
+				g_string_append_len(word,
+					(const gchar *) SSM(sci, SCI_GETRANGEPOINTER, pos_find, word_length), word_length);
+				if (! g_hash_table_contains(found, word->str))
 				{
-					words = g_slist_prepend(words, word);
-					nmatches++;
+					gchar *copy = g_string_chunk_insert(chunk, word->str);
+
+					g_hash_table_add(found, copy);
+					g_ptr_array_add(words, copy);
 				}
 
-				if (nmatches == editor_prefs.autocompletion_max_entries)
+				if (words->len == editor_prefs.autocompletion_max_entries)
 					break;
 			}
 		}
 		ttf.chrg.cpMin = word_end;
 		pos_find = SSM(sci, SCI_FINDTEXT, flags, (uptr_t) &ttf);
 	}
+	g_hash_table_destroy(found);
+	g_string_free(word, TRUE);
 
-	return g_slist_sort(words, (GCompareFunc)utils_str_casecmp);
+	g_ptr_array_sort(words, compare_doc_words);
+	return words;
 }
 
 
 static gboolean autocomplete_doc_word(GeanyEditor *editor, gchar *root, gsize rootlen)
 {
 	ScintillaObject *sci = editor->sci;
-	GSList *words, *node;
+	GStringChunk *chunk = g_string_chunk_new(1024);
+	GPtrArray *words;
 	GString *str;
-	guint n_words = 0;
+	guint i;
 
-	words = get_doc_words(sci, root, rootlen);
-	if (!words)
+	words = get_doc_words(sci, root, rootlen, chunk);
+	if (words->len == 0)
 	{
 		SSM(sci, SCI_AUTOCCANCEL, 0, 0);
+		g_ptr_array_free(words, TRUE);
+		g_string_chunk_free(chunk);
 		return FALSE;
 	}
 
-	str = g_string_sized_new(rootlen * 2 * 10);
-	foreach_slist(node, words)
+	str = get_autocomplete_words();
+	for (i = 0; i < words->len; i++)
 	{
-		g_string_append(str, node->data);
-		g_free(node->data);
-		if (node->next)
+		if (i > 0)
 			g_string_append_c(str, '\n');
-		n_words++;
+		g_string_append(str, words->pdata[i]);
 	}
-	if (n_words >= editor_prefs.autocompletion_max_entries)
+	if (words->len >= editor_prefs.autocompletion_max_entries)
 		g_string_append(str, "\n...");
 
-	g_slist_free(words);
+	g_ptr_array_free(words, TRUE);
+	g_string_chunk_free(chunk);
 
 	show_autocomplete(sci, rootlen, str);
-	g_string_free(str, TRUE);
 	return TRUE;
 }
 
@@ -2987,6 +3005,142 @@ static gint get_multiline_comment_style(GeanyEditor *editor, gint line_start)
 }
 
 
+/* Selections of at least this many lines are (un)commented and indented with a
+ * single replacement instead of one modification per line, as each modification is
+ * notified and recorded separately. */
+#define BULK_EDIT_MIN_LINES 100
+
+/* Appends the new text of the line text of length len, without the line end. */
+typedef void (*LineTransformFunc)(const gchar *text, gint len, gint line, GString *out,
+		gpointer user_data);
+
+
+/* Replaces the lines first_line to last_line with the result of func for each line
+ * in a single modification. func must not add line breaks, so the markers of the lines
+ * can be restored. */
+static void transform_lines(GeanyEditor *editor, gint first_line, gint last_line,
+		LineTransformFunc func, gpointer user_data)
+{
+	ScintillaObject *sci = editor->sci;
+	gint start = sci_get_position_from_line(sci, first_line);
+	gint end = sci_get_line_end_position(sci, last_line);
+	const gchar *text = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start, end - start);
+	GArray *markers = g_array_new(FALSE, FALSE, sizeof(gint));
+	GString *out = g_string_sized_new(end - start + 1);
+	gint line;
+	guint i;
+
+	/* the replacement would merge the markers of the replaced lines into the first one */
+	for (line = SSM(sci, SCI_MARKERNEXT, first_line, ~0); line >= 0 && line <= last_line;
+		line = SSM(sci, SCI_MARKERNEXT, line + 1, ~0))
+	{
+		gint mask = SSM(sci, SCI_MARKERGET, line, 0);
+
+		g_array_append_val(markers, line);
+		g_array_append_val(markers, mask);
+	}
+
+	for (line = first_line; line <= last_line; line++)
+	{
+		gint line_start = sci_get_position_from_line(sci, line) - start;
+		gint line_end = sci_get_line_end_position(sci, line) - start;
+		gint next_start = (line < last_line) ?
+			sci_get_position_from_line(sci, line + 1) - start : line_end;
+
+		func(text + line_start, line_end - line_start, line, out, user_data);
+		g_string_append_len(out, text + line_end, next_start - line_end);
+	}
+
+	sci_set_target_start(sci, start);
+	sci_set_target_end(sci, end);
+	SSM(sci, SCI_REPLACETARGETMINIMAL, out->len, (sptr_t) out->str);
+
+	for (line = SSM(sci, SCI_MARKERNEXT, first_line, ~0); line >= 0 && line <= last_line;
+		line = SSM(sci, SCI_MARKERNEXT, line + 1, ~0))
+	{
+		SSM(sci, SCI_MARKERDELETE, line, -1);
+	}
+	for (i = 0; i < markers->len; i += 2)
+	{
+		SSM(sci, SCI_MARKERADDSET, g_array_index(markers, gint, i),
+			g_array_index(markers, gint, i + 1));
+	}
+
+	g_string_free(out, TRUE);
+	g_array_free(markers, TRUE);
+}
+
+
+typedef struct
+{
+	const gchar *co;
+	const gchar *mark;	/* editor_prefs.comment_toggle_mark or "" */
+	gboolean comment;
+	gboolean uncomment;
+	gboolean use_indent;
+	gboolean allow_empty_lines;
+	gint first_line;
+	gint last_line;
+	/* results */
+	gint count_commented;
+	gint count_uncommented;
+	gboolean first_line_was_comment;
+	gboolean last_line_was_comment;
+}
+CommentLinesData;
+
+
+/* the single line comment counterpart of editor_do_comment() and editor_do_uncomment() */
+static void comment_line(const gchar *text, gint len, gint line, GString *out, gpointer user_data)
+{
+	CommentLinesData *data = user_data;
+	gsize co_len = strlen(data->co);
+	gsize mark_len = strlen(data->mark);
+	gboolean is_comment;
+	gint x = 0;
+
+	while (x < len && isspace(text[x])) x++;
+
+	is_comment = x < len && (gsize) (len - x) >= co_len + mark_len &&
+		strncmp(text + x, data->co, co_len) == 0 &&
+		strncmp(text + x + co_len, data->mark, mark_len) == 0;
+
+	if (line == data->first_line)
+		data->first_line_was_comment = is_comment;
+	if (line == data->last_line)
+		data->last_line_was_comment = is_comment;
+
+	if (is_comment && data->uncomment)
+	{
+		g_string_append_len(out, text, x);
+		g_string_append_len(out, text + x + co_len + mark_len, len - x - co_len - mark_len);
+		data->count_uncommented++;
+	}
+	else if (data->comment && (x < len || data->allow_empty_lines))
+	{
+		gint start = data->use_indent ? x : 0;
+
+		g_string_append_len(out, text, start);
+		g_string_append(out, data->co);
+		g_string_append(out, data->mark);
+		g_string_append_len(out, text + start, len - start);
+		data->count_commented++;
+	}
+	else
+		g_string_append_len(out, text, len);
+}
+
+
+/* (un)comments the lines first_line to last_line with single line comments at once */
+static void comment_lines(GeanyEditor *editor, gint first_line, gint last_line,
+		CommentLinesData *data)
+{
+	data->first_line = first_line;
+	data->last_line = last_line;
+	transform_lines(editor, first_line, last_line, comment_line, data);
+}
+
+
 /* set toggle to TRUE if the caller is the toggle function, FALSE otherwise
  * returns the amount of uncommented single comment lines, in case of multi line uncomment
  * it returns just 1 */
@@ -3056,6 +3210,18 @@ gint editor_do_uncomment(GeanyEditor *editor, gint line, gboolean toggle)
 			{
 				single_line = TRUE;
 
+				if (last_line - i >= BULK_EDIT_MIN_LINES)
+				{
+					CommentLinesData data = { 0 };
+
+					data.co = co;
+					data.mark = toggle ? editor_prefs.comment_toggle_mark : "";
+					data.uncomment = TRUE;
+					comment_lines(editor, i, last_line, &data);
+					count += data.count_uncommented;
+					break;
+				}
+
 				if (toggle)
 				{
 					gsize tm_len = strlen(editor_prefs.comment_toggle_mark);
@@ -3116,6 +3282,7 @@ gint editor_do_uncomment(GeanyEditor *editor, gint line, gboolean toggle)
 }
 
 
+GEANY_EXPORT_SYMBOL
 void editor_do_comment_toggle(GeanyEditor *editor)
 {
 	gint first_line, last_line;
@@ -3178,6 +3345,23 @@ void editor_do_comment_toggle(GeanyEditor *editor)
 			gboolean do_continue = FALSE;
 			single_line = TRUE;
 
+			if (last_line - i >= BULK_EDIT_MIN_LINES)
+			{
+				CommentLinesData data = { 0 };
+
+				data.co = co;
+				data.mark = editor_prefs.comment_toggle_mark;
+				data.comment = TRUE;
+				data.uncomment = TRUE;
+				data.use_indent = ft->comment_use_indent;
+				comment_lines(editor, i, last_line, &data);
+				count_commented += data.count_commented;
+				count_uncommented += data.count_uncommented;
+				first_line_was_comment = data.first_line_was_comment;
+				last_line_was_comment = data.last_line_was_comment;
+				break;
+			}
+
 			if (strncmp(sel + x, co, co_len) == 0 &&
 				strncmp(sel + x + co_len, editor_prefs.comment_toggle_mark, tm_len) == 0)
 			{
@@ -3352,6 +3536,20 @@ gint editor_do_comment(GeanyEditor *editor, gint line, gboolean allow_empty_line
 				gint start = line_start;
 				single_line = TRUE;
 
+				if (last_line - i >= BULK_EDIT_MIN_LINES)
+				{
+					CommentLinesData data = { 0 };
+
+					data.co = co;
+					data.mark = toggle ? editor_prefs.comment_toggle_mark : "";
+					data.comment = TRUE;
+					data.use_indent = ft->comment_use_indent;
+					data.allow_empty_lines = allow_empty_lines;
+					comment_lines(editor, i, last_line, &data);
+					count += data.count_commented;
+					break;
+				}
+
 				if (ft->comment_use_indent)
 					start = line_start + x;
 
@@ -3437,7 +3635,7 @@ static gboolean delay_match_brace(G_GNUC_UNUSED gpointer user_data)
 		editor_highlight_braces(editor, cur_pos);
 		return FALSE;
 	}
-	end_pos = sci_find_matching_brace(editor->sci, brace_pos);
+	end_pos = brace_index_find_match(doc, brace_pos);
 
 	if (end_pos >= 0)
 	{
@@ -4052,6 +4250,10 @@ void editor_indentation_by_one_space(GeanyEditor *editor, gint pos, gboolean dec
 
 void editor_finalize(void)
 {
+	if (autocomplete_words)
+		g_string_free(autocomplete_words, TRUE);
+	if (calltip_cache)
+		g_hash_table_destroy(calltip_cache);
 	scintilla_release_resources();
 }
 
@@ -4240,6 +4442,52 @@ void editor_indicator_set_on_range(GeanyEditor *editor, gint indic, gint start,
 }
 
 
+/**
+ *  Sets an indicator on many ranges at once. This is much faster than calling
+ *  editor_indicator_set_on_range() for each range as the view is only updated once.
+ *  Ranges with a length of 0 or less are ignored.
+ *
+ *  @param editor The editor to operate on.
+ *  @param indic The indicator number to use, this is a value of @ref GeanyIndicator.
+ *  @param positions @array{length=n} The starting positions of the ranges.
+ *  @param lengths @array{length=n} The lengths of the ranges.
+ *  @param n The number of ranges.
+ *
+ *  @since 2.1 (GEANY_API_VERSION 253)
+ */
+GEANY_API_SYMBOL
+void editor_indicator_set_ranges(GeanyEditor *editor, gint indic, const gint *positions,
+		const gint *lengths, guint n)
+{
+	Sci_Position *ranges;
+	guint i, count = 0;
+
+	g_return_if_fail(editor != NULL);
+	g_return_if_fail(n == 0 || (positions != NULL && lengths != NULL));
+
+	if (n == 0)
+		return;
+
+	/* Scintilla takes pairs of start and length */
+	ranges = g_new(Sci_Position, n * 2);
+	for (i = 0; i < n; i++)
+	{
+		if (lengths[i] <= 0)
+			continue;
+		ranges[count * 2] = positions[i];
+		ranges[count * 2 + 1] = lengths[i];
+		count++;
+	}
+
+	if (count > 0)
+	{
+		sci_indicator_set(editor->sci, indic);
+		SSM(editor->sci, SCI_INDICATORFILLRANGES, count, (sptr_t) ranges);
+	}
+	g_free(ranges);
+}
+
+
 /* Inserts the given colour (format should be #...), if there is a selection starting with 0x...
  * the replacement will also start with 0x... */
 void editor_insert_color(GeanyEditor *editor, const gchar *colour)
@@ -4366,7 +4614,7 @@ const gchar *editor_get_eol_char(GeanyEditor *editor)
 
 static void fold_all(GeanyEditor *editor, gboolean want_fold)
 {
-	gint lines, first, i;
+	gint lines, first;
 
 	if (editor == NULL || ! editor_prefs.folding)
 		return;
@@ -4374,16 +4622,9 @@ static void fold_all(GeanyEditor *editor, gboolean want_fold)
 	lines = sci_get_line_count(editor->sci);
 	first = sci_get_first_visible_line(editor->sci);
 
-	for (i = 0; i < lines; i++)
-	{
-		gint level = sci_get_fold_level(editor->sci, i);
+	/* (un)fold every fold header in a single pass */
+	SSM(editor->sci, want_fold ? SCI_CONTRACTFOLDRANGE : SCI_EXPANDFOLDRANGE, 0, lines - 1);
 
-		if (level & SC_FOLDLEVELHEADERFLAG)
-		{
-			if (sci_get_fold_expanded(editor->sci, i) == want_fold)
-					sci_toggle_fold(editor->sci, i);
-		}
-	}
 	editor_scroll_to_line(editor, first, 0.0F);
 }
 
@@ -4792,6 +5033,55 @@ on_editor_scroll_event(GtkWidget *widget, GdkEventScroll *event, gpointer user_d
 }
 
 
+/* Lexes the document a chunk of lines at a time until the time slice is used up.
+ * Drawing and anything needing styles further down still styles as far as needed,
+ * so only what is visible is waited for. */
+static gboolean on_colourise_idle(gpointer data)
+{
+	GeanyDocument *doc = document_find_by_id(GPOINTER_TO_UINT(data));
+	gint64 start = g_get_monotonic_time();
+	ScintillaObject *sci;
+	gint line_count;
+
+	if (doc == NULL)
+		return FALSE;
+
+	sci = doc->editor->sci;
+	line_count = sci_get_line_count(sci);
+	do
+	{
+		/* go back to where editing invalidated the styles */
+		gint line = MIN(doc->priv->colourise_line,
+			sci_get_line_from_position(sci, sci_get_end_styled(sci)));
+		gint end_line = line + COLOURISE_CHUNK_LINES;
+		gint pos = sci_get_position_from_line(sci, line);
+
+		if (line >= line_count)
+			break;
+
+		sci_colourise(sci, pos,
+			end_line < line_count ? sci_get_position_from_line(sci, end_line) : -1);
+		doc->priv->colourise_line = end_line;
+
+		/* without a lexer nothing gets styled */
+		if (sci_get_end_styled(sci) <= pos)
+			break;
+
+		if (g_get_monotonic_time() - start >= COLOURISE_TIME_SLICE)
+			return TRUE;
+	}
+	while (TRUE);
+
+	doc->priv->colourise_idle_id = 0;
+
+	/* now that the document is colourised, fold points are now accurate,
+	 * so force an update of the current function/tag. */
+	symbols_get_current_function(NULL, NULL);
+	ui_update_statusbar(NULL, -1);
+	return FALSE;
+}
+
+
 static gboolean editor_check_colourise(GeanyEditor *editor)
 {
 	GeanyDocument *doc = editor->document;
@@ -4800,12 +5090,15 @@ static gboolean editor_check_colourise(GeanyEditor *editor)
 		return FALSE;
 
 	doc->priv->colourise_needed = FALSE;
-	sci_colourise(editor->sci, 0, -1);
 
-	/* now that the current document is colourised, fold points are now accurate,
-	 * so force an update of the current function/tag. */
-	symbols_get_current_function(NULL, NULL);
-	ui_update_statusbar(NULL, -1);
+	/* lexing a large document at once can take seconds, so do it while idle,
+	 * starting with a first chunk so the top of the document is right at once */
+	doc->priv->colourise_line = 0;
+	if (doc->priv->colourise_idle_id == 0 && on_colourise_idle(GUINT_TO_POINTER(doc->id)))
+	{
+		doc->priv->colourise_idle_id = g_idle_add_full(G_PRIORITY_LOW, on_colourise_idle,
+			GUINT_TO_POINTER(doc->id), NULL);
+	}
 
 	return TRUE;
 }
@@ -4824,10 +5117,20 @@ static gboolean on_editor_focus_in(GtkWidget *widget, GdkEventFocus *event, gpoi
 }
 
 
+static void register_icons(ScintillaObject *sci);
+
 static gboolean on_editor_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
 {
 	GeanyEditor *editor = user_data;
 
+	/* the autocompletion images are only needed once the editor is shown, which many
+	 * documents of a large session never are */
+	if (! editor->document->priv->icons_registered)
+	{
+		editor->document->priv->icons_registered = TRUE;
+		register_icons(editor->sci);
+	}
+
 	/* This is just to catch any uncolourised documents being drawn that didn't receive focus
 	 * for some reason, maybe it's not necessary but just in case. */
 	editor_check_colourise(editor);
@@ -4913,13 +5216,25 @@ static gboolean register_named_icon(ScintillaObject *sci, guint id, const gchar
 }
 
 
+/* registers the tag autocompletion images */
+static void register_icons(ScintillaObject *sci)
+{
+	guint i;
+
+	for (i = 0; i < TM_N_ICONS; i++)
+	{
+		const gchar *icon_name = symbols_get_icon_name(i);
+		register_named_icon(sci, i + 1, icon_name);
+	}
+}
+
+
 /* Create new editor widget (scintilla).
  * @note The @c "sci-notify" signal is connected separately. */
 static ScintillaObject *create_new_sci(GeanyEditor *editor)
 {
 	ScintillaObject *sci;
 	int rectangular_selection_modifier;
-	guint i;
 
 	sci = SCINTILLA(scintilla_new());
 
@@ -4942,13 +5257,9 @@ static ScintillaObject *create_new_sci(GeanyEditor *editor)
 	/* Y policy is set in editor_apply_update_prefs() */
 	SSM(sci, SCI_AUTOCSETSEPARATOR, '\n', 0);
 	SSM(sci, SCI_SETSCROLLWIDTHTRACKING, 1, 0);
-
-	/* tag autocompletion images */
-	for (i = 0; i < TM_N_ICONS; i++)
-	{
-		const gchar *icon_name = symbols_get_icon_name(i);
-		register_named_icon(sci, i + 1, icon_name);
-	}
+	/* keep the layout of the lines around the visible ones, Scintilla only keeps
+	 * the caret line by default and lays out all others again on each scroll */
+	SSM(sci, SCI_SETLAYOUTCACHE, SC_CACHE_PAGE, 0);
 
 	/* necessary for column mode editing, implemented in Scintilla since 2.0 */
 	SSM(sci, SCI_SETADDITIONALSELECTIONTYPING, 1, 0);
@@ -4977,6 +5288,8 @@ static ScintillaObject *create_new_sci(GeanyEditor *editor)
 		g_signal_connect(sci, "focus-in-event", G_CALLBACK(on_editor_focus_in), editor);
 		g_signal_connect(sci, "draw", G_CALLBACK(on_editor_draw), editor);
 	}
+	else
+		register_icons(sci);	/* on_editor_draw() does it for the document notebook */
 	return sci;
 }
 
@@ -5015,6 +5328,30 @@ ScintillaObject *editor_create_widget(GeanyEditor *editor)
 }
 
 
+/** Creates a new Scintilla @c GtkWidget showing the document of @a editor.
+ * Unlike editor_create_widget() the widget views the same Scintilla document as
+ * @a editor's widget, so the text, lexer, styling, folding and indicators are shared
+ * and only updated once for all views. Only the view settings like the colours and
+ * margins are set up for the new widget.
+ * @param editor The editor whose document to show.
+ * @return @transfer{floating} The new widget.
+ *
+ * @since 2.1 (GEANY_API_VERSION 252)
+ **/
+GEANY_API_SYMBOL
+ScintillaObject *editor_create_view(GeanyEditor *editor)
+{
+	ScintillaObject *sci;
+
+	g_return_val_if_fail(editor != NULL && editor->sci != NULL, NULL);
+
+	sci = editor_create_widget(editor);
+	SSM(sci, SCI_SETDOCPOINTER, 0, SSM(editor->sci, SCI_GETDOCPOINTER, 0, 0));
+	highlighting_set_view_styles(sci, editor->document->file_type);
+	return sci;
+}
+
+
 GeanyEditor *editor_create(GeanyDocument *doc)
 {
 	const GeanyIndentPrefs *iprefs = get_default_indent_prefs();
@@ -5165,6 +5502,30 @@ void editor_set_indentation_guides(GeanyEditor *editor)
 
 
 /* Apply non-document prefs that can change in the Preferences dialog */
+/* Style the text before and after the visible lines while idle, so jumping into
+ * huge files doesn't wait for the lexer to reach the new position. */
+static gint get_idle_styling(void)
+{
+	if (editor_prefs.idle_styling >= SC_IDLESTYLING_NONE &&
+		editor_prefs.idle_styling <= SC_IDLESTYLING_ALL)
+		return editor_prefs.idle_styling;
+	return SC_IDLESTYLING_ALL;
+}
+
+
+/* Very long lines are laid out with up to this many threads */
+static gint get_layout_threads(void)
+{
+	if (editor_prefs.layout_threads > 0)
+		return editor_prefs.layout_threads;
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	return (gint) g_get_num_processors();
+#else
+	return 1;
+#endif
+}
+
+
 void editor_apply_update_prefs(GeanyEditor *editor)
 {
 	ScintillaObject *sci;
@@ -5200,7 +5561,8 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	sci_set_line_numbers(sci, editor_prefs.show_linenumber_margin);
 	sci_set_eol_representation_characters(sci, sci_get_eol_mode(sci));
 
-	sci_set_folding_margin_visible(sci, editor_prefs.folding);
+	/* documents opened in large file mode keep folding and change history disabled */
+	sci_set_folding_margin_visible(sci, editor_prefs.folding && ! editor->document->priv->large_file);
 
 	/* virtual space */
 	SSM(sci, SCI_SETVIRTUALSPACEOPTIONS, editor_prefs.show_virtual_space, 0);
@@ -5208,10 +5570,13 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	/* Change history */
 	guint change_history_mask;
 	change_history_mask = SC_CHANGE_HISTORY_DISABLED;
-	if (editor_prefs.change_history_markers)
+	if (editor_prefs.change_history_markers && ! editor->document->priv->large_file)
 		change_history_mask |= SC_CHANGE_HISTORY_ENABLED|SC_CHANGE_HISTORY_MARKERS;
-	if (editor_prefs.change_history_indicators)
+	if (editor_prefs.change_history_indicators && ! editor->document->priv->large_file)
 		change_history_mask |= SC_CHANGE_HISTORY_ENABLED|SC_CHANGE_HISTORY_INDICATORS;
+	if (editor_prefs.change_history_coalesce && change_history_mask != SC_CHANGE_HISTORY_DISABLED)
+		change_history_mask |= SC_CHANGE_HISTORY_COALESCE;
+	SSM(sci, SCI_SETCHANGEHISTORYDEPTH, MAX(editor_prefs.change_history_depth, 0), 0);
 	SSM(sci, SCI_SETCHANGEHISTORY, change_history_mask, 0);
 
 	/* caret Y policy */
@@ -5223,6 +5588,10 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	/* (dis)allow scrolling past end of document */
 	sci_set_scroll_stop_at_last_line(sci, editor_prefs.scroll_stop_at_last_line);
 
+	/* rendering performance */
+	sci_set_idle_styling(sci, get_idle_styling());
+	sci_set_layout_threads(sci, get_layout_threads());
+
 	sci_set_scrollbar_mode(sci, editor_prefs.show_scrollbars);
 }
 
@@ -5272,6 +5641,51 @@ static void editor_change_line_indent(GeanyEditor *editor, gint line, gboolean i
 }
 
 
+typedef struct
+{
+	const GeanyIndentPrefs *iprefs;
+	gboolean increase;
+}
+IndentLinesData;
+
+
+/* the text counterpart of editor_change_line_indent() */
+static void indent_line(const gchar *text, gint len, G_GNUC_UNUSED gint line, GString *out,
+		gpointer user_data)
+{
+	IndentLinesData *data = user_data;
+	const gint tab_width = get_tab_width(data->iprefs);
+	gint width = 0;
+	gint x;
+	gchar *whitespace;
+
+	if (data->iprefs->type == GEANY_INDENT_TYPE_TABS)
+	{
+		if (data->increase)
+		{
+			g_string_append_c(out, '\t');
+			g_string_append_len(out, text, len);
+			return;
+		}
+		if (len > 0 && text[0] == '\t')
+		{
+			g_string_append_len(out, text + 1, len - 1);
+			return;
+		}
+	}
+
+	/* like sci_get_line_indentation() and sci_set_line_indentation() */
+	for (x = 0; x < len && (text[x] == ' ' || text[x] == '\t'); x++)
+		width = (text[x] == '\t') ? (width / tab_width + 1) * tab_width : width + 1;
+	width += data->increase ? data->iprefs->width : -data->iprefs->width;
+
+	whitespace = get_whitespace(data->iprefs, MAX(width, 0));
+	g_string_append(out, whitespace);
+	g_string_append_len(out, text + x, len - x);
+	g_free(whitespace);
+}
+
+
 void editor_indent(GeanyEditor *editor, gboolean increase)
 {
 	ScintillaObject *sci = editor->sci;
@@ -5308,9 +5722,20 @@ void editor_indent(GeanyEditor *editor, gboolean increase)
 			lend++;	/* for last line with text on it */
 
 		sci_start_undo_action(sci);
-		for (line = lstart; line < lend; line++)
+		if (lend - lstart > BULK_EDIT_MIN_LINES)
+		{
+			IndentLinesData data;
+
+			data.iprefs = editor_get_indent_prefs(editor);
+			data.increase = increase;
+			transform_lines(editor, lstart, lend - 1, indent_line, &data);
+		}
+		else
 		{
-			editor_change_line_indent(editor, line, increase);
+			for (line = lstart; line < lend; line++)
+			{
+				editor_change_line_indent(editor, line, increase);
+			}
 		}
 		sci_end_undo_action(sci);
 	}
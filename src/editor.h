@@ -142,6 +142,10 @@ typedef struct GeanyEditorPrefs
 	gboolean	show_line_endings_only_when_differ;
 	gboolean	change_history_markers;
 	gboolean	change_history_indicators;
+	gint		idle_styling;	/* SC_IDLESTYLING_* or -1 for automatic (hidden pref) */
+	gint		layout_threads;	/* 0 for one per processor (hidden pref) */
+	gboolean	change_history_coalesce;	/* mark whole lines instead of the changed text */
+	gint		change_history_depth;	/* edits whose change markers undo restores, 0 for all */
 }
 GeanyEditorPrefs;
 
@@ -169,8 +173,13 @@ const GeanyIndentPrefs *editor_get_indent_prefs(GeanyEditor *editor);
 
 ScintillaObject *editor_create_widget(GeanyEditor *editor);
 
+ScintillaObject *editor_create_view(GeanyEditor *editor);
+
 void editor_indicator_set_on_range(GeanyEditor *editor, gint indic, gint start, gint end);
 
+void editor_indicator_set_ranges(GeanyEditor *editor, gint indic, const gint *positions,
+		const gint *lengths, guint n);
+
 void editor_indicator_set_on_line(GeanyEditor *editor, gint indic, gint line);
 
 void editor_indicator_clear(GeanyEditor *editor, gint indic);
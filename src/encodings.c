@@ -665,7 +665,8 @@ gchar *encodings_convert_to_utf8_from_charset(const gchar *buffer, gssize size,
 }
 
 
-static gchar *encodings_check_regexes(const gchar *buffer, gsize size)
+/* Returns the charset declared in the file contents, or NULL. */
+gchar *encodings_check_regexes(const gchar *buffer, gsize size)
 {
 	guint i;
 
@@ -868,6 +869,7 @@ typedef struct
 	gchar		*data;	/* null-terminated data */
 	gsize		 size;	/* actual data size */
 	gsize		 len;	/* string length of data */
+	gsize		 ascii_len;	/* length of the leading ASCII data, which is valid UTF-8 */
 	gchar		*enc;
 	gboolean	 bom;
 	gboolean	 partial;
@@ -882,7 +884,7 @@ handle_forced_encoding(BufferData *buffer, const gchar *forced_enc)
 
 	if (utils_str_equal(forced_enc, "UTF-8"))
 	{
-		if (! g_utf8_validate(buffer->data, buffer->len, NULL))
+		if (! g_utf8_validate(buffer->data + buffer->ascii_len, buffer->len - buffer->ascii_len, NULL))
 		{
 			return FALSE;
 		}
@@ -954,7 +956,8 @@ handle_encoding(BufferData *buffer, GeanyEncodingIndex enc_idx)
 
 			/* try UTF-8 first */
 			if (encodings_get_idx_from_charset(regex_charset) == GEANY_ENCODING_UTF_8 &&
-				(buffer->size == buffer->len) && g_utf8_validate(buffer->data, buffer->len, NULL))
+				(buffer->size == buffer->len) &&
+				g_utf8_validate(buffer->data + buffer->ascii_len, buffer->len - buffer->ascii_len, NULL))
 			{
 				buffer->enc = g_strdup("UTF-8");
 			}
@@ -1039,6 +1042,30 @@ static gboolean handle_buffer(BufferData *buffer, const gchar *forced_enc)
 }
 
 
+/* Returns the length of the leading data without null bytes nor non-ASCII characters.
+ * Most files are mostly ASCII, so this checks 8 bytes at a time to leave little data
+ * for the much slower strlen() and g_utf8_validate(). */
+static gsize get_ascii_length(const gchar *data, gsize size)
+{
+	const guint64 ones = G_GUINT64_CONSTANT(0x0101010101010101);
+	const guint64 highs = G_GUINT64_CONSTANT(0x8080808080808080);
+	gsize i;
+
+	for (i = 0; i + sizeof(guint64) <= size; i += sizeof(guint64))
+	{
+		guint64 block;
+
+		memcpy(&block, data + i, sizeof(block));
+		/* any high bit set in a byte or from subtracting 1 from a null byte */
+		if ((block | ((block - ones) & ~block)) & highs)
+			break;
+	}
+	while (i < size && data[i] != '\0' && (guchar) data[i] < 0x80)
+		i++;
+	return i;
+}
+
+
 /*
  * Tries to convert @a buffer into UTF-8 encoding. Unlike encodings_convert_to_utf8()
  * and encodings_convert_to_utf8_from_charset() it handles the possible BOM in the data.
@@ -1061,8 +1088,9 @@ gboolean encodings_convert_to_utf8_auto(gchar **buf, gsize *size, const gchar *f
 
 	buffer.data = *buf;
 	buffer.size = *size;
+	buffer.ascii_len = get_ascii_length(buffer.data, buffer.size);
 	/* use strlen to check for null chars */
-	buffer.len = strlen(buffer.data);
+	buffer.len = buffer.ascii_len + strlen(buffer.data + buffer.ascii_len);
 	buffer.enc = NULL;
 	buffer.bom = FALSE;
 	buffer.partial = FALSE;
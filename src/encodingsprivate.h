@@ -78,6 +78,8 @@ GeanyEncodingIndex encodings_scan_unicode_bom(const gchar *string, gsize len, gu
 
 GeanyEncodingIndex encodings_get_idx_from_charset(const gchar *charset);
 
+gchar *encodings_check_regexes(const gchar *buffer, gsize size);
+
 extern GeanyEncoding encodings[GEANY_ENCODINGS_MAX];
 
 #endif /* ENCODINGSPRIVATE_H */
@@ -54,10 +54,29 @@
 
 #define GEANY_FILETYPE_SEARCH_LINES 2 /* lines of file to search for filetype */
 
-GPtrArray *filetypes_array = NULL;
+GEANY_EXPORT_SYMBOL GPtrArray *filetypes_array = NULL;
 static GHashTable *filetypes_hash = NULL;	/* Hash of filetype pointers based on name keys */
 GSList *filetypes_by_title = NULL;
 
+/* file_prefs.extract_filetype_regex compiled, compiled again when it changes */
+static struct
+{
+	gchar *pattern;
+	GRegex *regex;
+}
+filetype_regex;
+
+typedef struct
+{
+	gint64 mtime;
+	gint64 size;
+	GeanyFiletype *ft;
+}
+DetectedFiletype;
+
+/* filetypes detected by filetypes_detect_from_file(), keyed by the locale filename */
+static GHashTable *detected_filetypes = NULL;
+
 
 static void create_radio_menu_item(GtkWidget *menu, GeanyFiletype *ftype);
 
@@ -312,6 +331,7 @@ static void init_custom_filetypes(const gchar *path)
 
 /* Create the filetypes array and fill it with the known filetypes.
  * Warning: GTK isn't necessarily initialized yet. */
+GEANY_EXPORT_SYMBOL
 void filetypes_init_types(void)
 {
 	GeanyFiletypeID ft_id;
@@ -380,7 +400,7 @@ static void on_document_save(G_GNUC_UNUSED GObject *object, GeanyDocument *doc)
 				filetypes_load_config(i, TRUE);
 
 				foreach_document(j)
-					document_reload_config(documents[j]);
+					document_queue_reload_config(documents[j]);
 
 				g_free(f);
 				break;
@@ -516,6 +536,7 @@ static GeanyFiletype *detect_filetype_conf_file(const gchar *utf8_filename)
 /* Detect filetype only based on the filename extension.
  * utf8_filename can include the full path.
  * Returns: non-NULL */
+GEANY_EXPORT_SYMBOL
 GeanyFiletype *filetypes_detect_from_extension(const gchar *utf8_filename)
 {
 	gchar *base_filename;
@@ -669,6 +690,32 @@ static GeanyFiletype *find_shebang(const gchar *utf8_filename, const gchar *line
 }
 
 
+static GRegex *get_filetype_regex(void)
+{
+	GError *regex_error = NULL;
+
+	if (filetype_regex.pattern &&
+		g_strcmp0(filetype_regex.pattern, file_prefs.extract_filetype_regex) == 0)
+		return filetype_regex.regex;
+
+	/* the detected filetypes may depend on the old regex */
+	if (detected_filetypes)
+		g_hash_table_remove_all(detected_filetypes);
+
+	SETPTR(filetype_regex.pattern, g_strdup(file_prefs.extract_filetype_regex));
+	if (filetype_regex.regex)
+		g_regex_unref(filetype_regex.regex);
+	filetype_regex.regex = g_regex_new(file_prefs.extract_filetype_regex,
+			G_REGEX_RAW | G_REGEX_MULTILINE, 0, &regex_error);
+	if (regex_error != NULL)
+	{
+		geany_debug("Filetype extract regex ignored: %s", regex_error->message);
+		g_error_free(regex_error);
+	}
+	return filetype_regex.regex;
+}
+
+
 /* Detect the filetype checking for a shebang, then filename extension.
  * @lines: an strv of the lines to scan (must containing at least one line) */
 static GeanyFiletype *filetypes_detect_from_file_internal(const gchar *utf8_filename,
@@ -678,7 +725,6 @@ static GeanyFiletype *filetypes_detect_from_file_internal(const gchar *utf8_file
 	gint			 i;
 	GRegex			*ft_regex;
 	GMatchInfo		*match;
-	GError			*regex_error = NULL;
 
 	/* try to find a shebang and if found use it prior to the filename extension
 	 * also checks for <?xml */
@@ -687,8 +733,7 @@ static GeanyFiletype *filetypes_detect_from_file_internal(const gchar *utf8_file
 		return ft;
 
 	/* try to extract the filetype using a regex capture */
-	ft_regex = g_regex_new(file_prefs.extract_filetype_regex,
-			G_REGEX_RAW | G_REGEX_MULTILINE, 0, &regex_error);
+	ft_regex = get_filetype_regex();
 	if (ft_regex != NULL)
 	{
 		for (i = 0; ft == NULL && lines[i] != NULL; i++)
@@ -704,12 +749,6 @@ static GeanyFiletype *filetypes_detect_from_file_internal(const gchar *utf8_file
 			}
 			g_match_info_free(match);
 		}
-		g_regex_unref(ft_regex);
-	}
-	else if (regex_error != NULL)
-	{
-		geany_debug("Filetype extract regex ignored: %s", regex_error->message);
-		g_error_free(regex_error);
 	}
 	if (ft != NULL)
 		return ft;
@@ -764,21 +803,47 @@ GeanyFiletype *filetypes_detect_from_file(const gchar *utf8_filename)
 	gchar *lines[2];
 	FILE  *f;
 	gchar *locale_name = utils_get_locale_from_utf8(utf8_filename);
+	GeanyFiletype *ft = NULL;
+	DetectedFiletype *detected;
+	GStatBuf st;
+
+	/* plugins detect the filetypes of many files, e.g. of a project, often
+	 * several times, so don't read unchanged files again */
+	get_filetype_regex();
+	if (! detected_filetypes)
+		detected_filetypes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	if (g_stat(locale_name, &st) != 0)
+	{
+		g_free(locale_name);
+		return filetypes_detect_from_extension(utf8_filename);
+	}
+	detected = g_hash_table_lookup(detected_filetypes, locale_name);
+	if (detected && detected->mtime == (gint64) st.st_mtime && detected->size == (gint64) st.st_size)
+	{
+		g_free(locale_name);
+		return detected->ft;
+	}
 
 	f = g_fopen(locale_name, "r");
-	g_free(locale_name);
 	if (f != NULL)
 	{
 		if (fgets(line, sizeof(line), f) != NULL)
 		{
-			fclose(f);
 			lines[0] = line;
 			lines[1] = NULL;
-			return filetypes_detect_from_file_internal(utf8_filename, lines);
+			ft = filetypes_detect_from_file_internal(utf8_filename, lines);
 		}
 		fclose(f);
 	}
-	return filetypes_detect_from_extension(utf8_filename);
+	if (ft == NULL)
+		ft = filetypes_detect_from_extension(utf8_filename);
+
+	detected = g_new(DetectedFiletype, 1);
+	detected->mtime = st.st_mtime;
+	detected->size = st.st_size;
+	detected->ft = ft;
+	g_hash_table_insert(detected_filetypes, locale_name, detected);
+	return ft;
 }
 #endif
 
@@ -853,6 +918,7 @@ static void filetype_free(gpointer data, G_GNUC_UNUSED gpointer user_data)
 
 
 /* frees the array and all related pointers */
+GEANY_EXPORT_SYMBOL
 void filetypes_free_types(void)
 {
 	g_return_if_fail(filetypes_array != NULL);
@@ -861,6 +927,14 @@ void filetypes_free_types(void)
 	g_ptr_array_foreach(filetypes_array, filetype_free, NULL);
 	g_ptr_array_free(filetypes_array, TRUE);
 	g_hash_table_destroy(filetypes_hash);
+
+	if (detected_filetypes)
+		g_hash_table_destroy(detected_filetypes);
+	detected_filetypes = NULL;
+	if (filetype_regex.regex)
+		g_regex_unref(filetype_regex.regex);
+	filetype_regex.regex = NULL;
+	SETPTR(filetype_regex.pattern, NULL);
 }
 
 
@@ -1004,36 +1078,70 @@ static gchar *filetypes_get_filename(GeanyFiletype *ft, gboolean user)
 }
 
 
-static void add_group_keys(GKeyFile *kf, const gchar *group, GeanyFiletype *ft)
+/* The system and user keyfiles of a filetype other filetypes copy groups from */
+typedef struct
 {
-	gchar *files[2];
-	gboolean loaded = FALSE;
+	GKeyFile *files[2];
+	gboolean loaded;
+}
+ParentKeyFiles;
+
+
+static void parent_key_files_free(gpointer data)
+{
+	ParentKeyFiles *parent = data;
 	guint i;
 
-	files[0] = filetypes_get_filename(ft, FALSE);
-	files[1] = filetypes_get_filename(ft, TRUE);
+	for (i = 0; i < G_N_ELEMENTS(parent->files); i++)
+		g_key_file_free(parent->files[i]);
+	g_free(parent);
+}
+
+
+/* Reads the keyfiles of ft once per load, as a filetype usually copies several
+ * groups from the same parent, e.g. [styling=C] and [lexer_properties=C]. */
+static ParentKeyFiles *get_parent_key_files(GHashTable *parents, GeanyFiletype *ft)
+{
+	ParentKeyFiles *parent = g_hash_table_lookup(parents, ft);
+	guint i;
 
-	for (i = 0; i < G_N_ELEMENTS(files); i++)
+	if (parent)
+		return parent;
+
+	parent = g_new0(ParentKeyFiles, 1);
+	for (i = 0; i < G_N_ELEMENTS(parent->files); i++)
 	{
-		GKeyFile *src = g_key_file_new();
+		gchar *f = filetypes_get_filename(ft, i == 1);
 
-		if (g_key_file_load_from_file(src, files[i], G_KEY_FILE_NONE, NULL))
-		{
-			copy_keys(kf, group, src, group);
-			loaded = TRUE;
-		}
-		g_key_file_free(src);
+		parent->files[i] = g_key_file_new();
+		if (g_key_file_load_from_file(parent->files[i], f, G_KEY_FILE_NONE, NULL))
+			parent->loaded = TRUE;
+		g_free(f);
+	}
+	if (!parent->loaded)
+	{
+		gchar *f = filetypes_get_filename(ft, FALSE);
+
+		geany_debug("Could not read config file %s for filetype %s!", f, ft->name);
+		g_free(f);
 	}
+	g_hash_table_insert(parents, ft, parent);
+	return parent;
+}
 
-	if (!loaded)
-		geany_debug("Could not read config file %s for [%s=%s]!", files[0], group, ft->name);
 
-	g_free(files[0]);
-	g_free(files[1]);
+static void add_group_keys(GKeyFile *kf, const gchar *group, GeanyFiletype *ft,
+		GHashTable *parents)
+{
+	ParentKeyFiles *parent = get_parent_key_files(parents, ft);
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(parent->files); i++)
+		copy_keys(kf, group, parent->files[i], group);
 }
 
 
-static void copy_ft_groups(GKeyFile *kf)
+static void copy_ft_groups(GKeyFile *kf, GHashTable *parents)
 {
 	gchar **groups = g_key_file_get_groups(kf, NULL);
 	gchar **ptr;
@@ -1057,7 +1165,7 @@ static void copy_ft_groups(GKeyFile *kf)
 		ft = filetypes_lookup_by_name(name);
 		if (ft)
 		{
-			add_group_keys(kf, group, ft);
+			add_group_keys(kf, group, ft, parents);
 			/* move old group keys (foo=bar) to proper group name (foo) */
 			copy_keys(kf, group, kf, old_group);
 		}
@@ -1091,6 +1199,7 @@ static void load_system_keyfile(GKeyFile *key_file, const gchar *file, GKeyFileF
 void filetypes_load_config(guint ft_id, gboolean reload)
 {
 	GKeyFile *config, *config_home;
+	GHashTable *parents;
 	GeanyFiletypePrivate *pft;
 	GeanyFiletype *ft;
 
@@ -1122,8 +1231,10 @@ void filetypes_load_config(guint ft_id, gboolean reload)
 		g_free(f);
 	}
 	/* Copy keys for any groups with [group=C] from system keyfile */
-	copy_ft_groups(config);
-	copy_ft_groups(config_home);
+	parents = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, parent_key_files_free);
+	copy_ft_groups(config, parents);
+	copy_ft_groups(config_home, parents);
+	g_hash_table_destroy(parents);
 
 	load_settings(ft_id, config, config_home);
 	highlighting_init_styles(ft_id, config, config_home);
@@ -1468,6 +1579,8 @@ void filetypes_reload_extensions(void)
 	guint i;
 
 	read_filetype_config();
+	if (detected_filetypes)
+		g_hash_table_remove_all(detected_filetypes);
 
 	/* Redetect filetype of any documents with none set */
 	foreach_document(i)
@@ -1510,14 +1623,9 @@ void filetypes_reload(void)
 	if (!current_doc)
 		return;
 
-	/* update document styling */
+	/* update document styling, the documents in the background once they are shown */
 	foreach_document(i)
-	{
-		if (current_doc != documents[i])
-			document_reload_config(documents[i]);
-	}
-	/* process the current document at last */
-	document_reload_config(current_doc);
+		document_queue_reload_config(documents[i]);
 }
 
 
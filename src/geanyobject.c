@@ -37,6 +37,8 @@
 
 #include "geanyobject.h"
 
+#include "stallwatch.h"
+
 /* extern in geany.h */
 GObject	*geany_object;
 
@@ -275,3 +277,26 @@ GObject *geany_object_new(void)
 {
 	return g_object_new(GEANY_OBJECT_TYPE, NULL);
 }
+
+
+/* Emits a signal of geany_object like g_signal_emit_by_name(), marked so stalls
+ * caused by its handlers, mostly of plugins, are attributed to the signal.
+ * signal_name has to be a static string. */
+void geany_object_emit(const gchar *signal_name, ...)
+{
+	guint signal_id;
+	GQuark detail;
+	va_list args;
+
+	if (! g_signal_parse_name(signal_name, GEANY_OBJECT_TYPE, &signal_id, &detail, FALSE))
+	{
+		g_warning("%s: signal \"%s\" is invalid", G_STRFUNC, signal_name);
+		return;
+	}
+
+	stallwatch_enter(signal_name);
+	va_start(args, signal_name);
+	g_signal_emit_valist(geany_object, signal_id, detail, args);
+	va_end(args);
+	stallwatch_leave();
+}
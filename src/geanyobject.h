@@ -97,6 +97,8 @@ struct _GeanyObjectClass
 GType		geany_object_get_type	(void);
 GObject*	geany_object_new		(void);
 
+void		geany_object_emit		(const gchar *signal_name, ...);
+
 G_END_DECLS
 
 #endif /* GEANY_OBJECT_H */
@@ -67,6 +67,7 @@ typedef struct
 	gchar			*wordchars;	/* NULL used for style sets with no styles */
 	gchar			**property_keys;
 	gchar			**property_values;
+	gint			*sci_styles;	/* for SCI_STYLESETTABLE, NULL until first used */
 } StyleSet;
 
 /* each filetype has a styleset but GEANY_FILETYPES_NONE uses common_style_set for styling */
@@ -155,6 +156,8 @@ static void free_styleset(guint file_type_id)
 	style_ptr->property_keys = NULL;
 	g_strfreev(style_ptr->property_values);
 	style_ptr->property_values = NULL;
+	g_free(style_ptr->sci_styles);
+	style_ptr->sci_styles = NULL;
 }
 
 
@@ -418,6 +421,25 @@ static void set_sci_style(ScintillaObject *sci, guint style, guint ft_id, guint
 }
 
 
+/* number of values for each style in the array of SCI_STYLESETTABLE */
+#define STYLE_TABLE_COLUMNS 6
+
+/* Sets the values like set_sci_style() and SCI_STYLESETEOLFILLED do, to set all styles
+ * with a single SCI_STYLESETTABLE message. */
+static void set_style_table_entry(gint *entry, guint style, guint ft_id, guint styling_index,
+		gboolean fill_eol)
+{
+	GeanyLexerStyle *style_ptr = get_style(ft_id, styling_index);
+
+	entry[0] = (gint) style;
+	entry[1] = (gint) invert(style_ptr->foreground);
+	entry[2] = (gint) invert(style_ptr->background);
+	entry[3] = style_ptr->bold;
+	entry[4] = style_ptr->italic;
+	entry[5] = fill_eol;
+}
+
+
 void highlighting_free_styles(void)
 {
 	guint i;
@@ -609,7 +631,9 @@ static void set_character_classes(ScintillaObject *sci, guint ft_id)
 }
 
 
-static void styleset_common(ScintillaObject *sci, guint ft_id)
+/* set_document is whether to also set up the document shared by the views of sci,
+ * i.e. the lexer with its properties and keywords */
+static void styleset_common(ScintillaObject *sci, guint ft_id, gboolean set_document)
 {
 	GeanyLexerStyle *style;
 
@@ -767,11 +791,14 @@ static void styleset_common(ScintillaObject *sci, guint ft_id)
 	}
 
 	/* set some common defaults */
-	sci_set_property(sci, "fold", "1");
-	sci_set_property(sci, "fold.compact", "0");
-	sci_set_property(sci, "fold.comment", "1");
-	sci_set_property(sci, "fold.preprocessor", "1");
-	sci_set_property(sci, "fold.at.else", "1");
+	if (set_document)
+	{
+		sci_set_property(sci, "fold", "1");
+		sci_set_property(sci, "fold.compact", "0");
+		sci_set_property(sci, "fold.comment", "1");
+		sci_set_property(sci, "fold.preprocessor", "1");
+		sci_set_property(sci, "fold.at.else", "1");
+	}
 
 	style = &common_style_set.styling[GCS_SELECTION];
 	if (!style->bold && !style->italic)
@@ -787,10 +814,18 @@ static void styleset_common(ScintillaObject *sci, guint ft_id)
 
 	SSM(sci, SCI_SETFOLDMARGINCOLOUR, 1, invert(common_style_set.styling[GCS_MARGIN_FOLDING].background));
 	SSM(sci, SCI_SETFOLDMARGINHICOLOUR, 1, invert(common_style_set.styling[GCS_MARGIN_FOLDING].background));
-	set_sci_style(sci, STYLE_LINENUMBER, GEANY_FILETYPES_NONE, GCS_MARGIN_LINENUMBER);
-	set_sci_style(sci, STYLE_BRACELIGHT, GEANY_FILETYPES_NONE, GCS_BRACE_GOOD);
-	set_sci_style(sci, STYLE_BRACEBAD, GEANY_FILETYPES_NONE, GCS_BRACE_BAD);
-	set_sci_style(sci, STYLE_INDENTGUIDE, GEANY_FILETYPES_NONE, GCS_INDENT_GUIDE);
+	{
+		gint table[4 * STYLE_TABLE_COLUMNS];
+
+		set_style_table_entry(table, STYLE_LINENUMBER, GEANY_FILETYPES_NONE, GCS_MARGIN_LINENUMBER, FALSE);
+		set_style_table_entry(table + STYLE_TABLE_COLUMNS, STYLE_BRACELIGHT,
+			GEANY_FILETYPES_NONE, GCS_BRACE_GOOD, FALSE);
+		set_style_table_entry(table + 2 * STYLE_TABLE_COLUMNS, STYLE_BRACEBAD,
+			GEANY_FILETYPES_NONE, GCS_BRACE_BAD, FALSE);
+		set_style_table_entry(table + 3 * STYLE_TABLE_COLUMNS, STYLE_INDENTGUIDE,
+			GEANY_FILETYPES_NONE, GCS_INDENT_GUIDE, FALSE);
+		SSM(sci, SCI_STYLESETTABLE, 4, (sptr_t) table);
+	}
 
 	/* bold = common whitespace settings enabled */
 	SSM(sci, SCI_SETWHITESPACEFORE, common_style_set.styling[GCS_WHITE_SPACE].bold,
@@ -853,33 +888,52 @@ static void styleset_init_from_mapping(guint ft_id, GKeyFile *config, GKeyFile *
 }
 
 
+/* Returns the styles of a filetype for SCI_STYLESETTABLE, STYLE_DEFAULT first. */
+static gint *get_style_table(guint ft_id, const HLStyle *styles, gsize n_styles)
+{
+	StyleSet *set = &style_sets[ft_id];
+	gsize i;
+
+	if (set->sci_styles != NULL)
+		return set->sci_styles;
+
+	set->sci_styles = g_new(gint, (n_styles + 1) * STYLE_TABLE_COLUMNS);
+	/* first style is also default one */
+	set_style_table_entry(set->sci_styles, STYLE_DEFAULT, ft_id, 0, FALSE);
+	foreach_range(i, n_styles)
+	{
+		set_style_table_entry(set->sci_styles + (i + 1) * STYLE_TABLE_COLUMNS,
+			styles[i].style, ft_id, i, styles[i].fill_eol);
+	}
+	return set->sci_styles;
+}
+
+
 /* STYLE_DEFAULT will be set to match the first style. */
 static void styleset_from_mapping(ScintillaObject *sci, guint ft_id, guint lexer,
 		const HLStyle *styles, gsize n_styles,
 		const HLKeyword *keywords, gsize n_keywords,
-		const HLProperty *properties, gsize n_properties)
+		const HLProperty *properties, gsize n_properties, gboolean set_document)
 {
 	gsize i;
 
 	g_assert(ft_id != GEANY_FILETYPES_NONE);
 
 	/* lexer */
-	sci_set_lexer(sci, lexer);
+	if (set_document)
+		sci_set_lexer(sci, lexer);
 
 	/* styles */
-	styleset_common(sci, ft_id);
+	styleset_common(sci, ft_id, set_document);
 	if (n_styles > 0)
 	{
-		/* first style is also default one */
-		set_sci_style(sci, STYLE_DEFAULT, ft_id, 0);
-		foreach_range(i, n_styles)
-		{
-			if (styles[i].fill_eol)
-				SSM(sci, SCI_STYLESETEOLFILLED, styles[i].style, TRUE);
-			set_sci_style(sci, styles[i].style, ft_id, i);
-		}
+		SSM(sci, SCI_STYLESETTABLE, n_styles + 1,
+			(sptr_t) get_style_table(ft_id, styles, n_styles));
 	}
 
+	if (! set_document)
+		return;
+
 	/* keywords */
 	foreach_range(i, n_keywords)
 	{
@@ -896,14 +950,15 @@ static void styleset_from_mapping(ScintillaObject *sci, guint ft_id, guint lexer
 
 
 
-static void styleset_default(ScintillaObject *sci, guint ft_id)
+static void styleset_default(ScintillaObject *sci, guint ft_id, gboolean set_document)
 {
-	sci_set_lexer(sci, SCLEX_NULL);
+	if (set_document)
+		sci_set_lexer(sci, SCLEX_NULL);
 
 	/* we need to set STYLE_DEFAULT before we call SCI_STYLECLEARALL in styleset_common() */
 	set_sci_style(sci, STYLE_DEFAULT, GEANY_FILETYPES_NONE, GCS_DEFAULT);
 
-	styleset_common(sci, ft_id);
+	styleset_common(sci, ft_id, set_document);
 }
 
 
@@ -1075,14 +1130,10 @@ void highlighting_init_styles(guint filetype_idx, GKeyFile *config, GKeyFile *co
 				highlighting_keywords_##LANG_NAME, \
 				HL_N_ENTRIES(highlighting_keywords_##LANG_NAME), \
 				highlighting_properties_##LANG_NAME, \
-				HL_N_ENTRIES(highlighting_properties_##LANG_NAME)); \
+				HL_N_ENTRIES(highlighting_properties_##LANG_NAME), set_document); \
 		break
 
-/** Sets up highlighting and other visual settings.
- * @param sci Scintilla widget.
- * @param ft Filetype settings to use. */
-GEANY_API_SYMBOL
-void highlighting_set_styles(ScintillaObject *sci, GeanyFiletype *ft)
+static void set_styles(ScintillaObject *sci, GeanyFiletype *ft, gboolean set_document)
 {
 	guint lexer_id = get_lexer_filetype(ft);
 
@@ -1149,10 +1200,10 @@ void highlighting_set_styles(ScintillaObject *sci, GeanyFiletype *ft)
 		styleset_case(ZEPHIR);
 		case GEANY_FILETYPES_NONE:
 		default:
-			styleset_default(sci, ft->id);
+			styleset_default(sci, ft->id, set_document);
 	}
 	/* [lexer_properties] settings */
-	if (style_sets[ft->id].property_keys)
+	if (set_document && style_sets[ft->id].property_keys)
 	{
 		gchar **prop = style_sets[ft->id].property_keys;
 		gchar **val = style_sets[ft->id].property_values;
@@ -1167,6 +1218,25 @@ void highlighting_set_styles(ScintillaObject *sci, GeanyFiletype *ft)
 }
 
 
+/** Sets up highlighting and other visual settings.
+ * @param sci Scintilla widget.
+ * @param ft Filetype settings to use. */
+GEANY_API_SYMBOL
+void highlighting_set_styles(ScintillaObject *sci, GeanyFiletype *ft)
+{
+	set_styles(sci, ft, TRUE);
+}
+
+
+/* Like highlighting_set_styles() but only sets up the view, for a widget showing the
+ * Scintilla document of another one. Its lexer, keywords and styling are kept, so the
+ * document isn't lexed again for the new view. */
+void highlighting_set_view_styles(ScintillaObject *sci, GeanyFiletype *ft)
+{
+	set_styles(sci, ft, FALSE);
+}
+
+
 /** Retrieves a style @a style_id for the filetype @a ft_id.
  * If the style was not already initialised
  * (e.g. by by opening a file of this type), it will be initialised. The returned pointer is
@@ -62,6 +62,8 @@ void highlighting_free_styles(void);
 
 void highlighting_show_color_scheme_dialog(void);
 
+void highlighting_set_view_styles(ScintillaObject *sci, GeanyFiletype *ft);
+
 #endif /* GEANY_PRIVATE */
 
 G_END_DECLS
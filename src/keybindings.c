@@ -33,6 +33,7 @@
 #include "keybindings.h"
 
 #include "app.h"
+#include "braceindex.h"
 #include "build.h"
 #include "callbacks.h"
 #include "documentprivate.h"
@@ -71,6 +72,18 @@ static GeanyKeyBinding binding_ids[GEANY_KEYS_COUNT];
 static GtkAccelGroup *kb_accel_group = NULL;
 static const gboolean swap_alt_tab_order = FALSE;
 
+typedef struct
+{
+	GeanyKeyGroup *group;
+	GeanyKeyBinding *kb;
+}
+KBIndexEntry;
+
+/* keyval -> GArray of KBIndexEntry in the order of keybinding_groups, so a key
+ * press doesn't need to check all bindings. NULL when it needs rebuilding. */
+static GHashTable *kb_index = NULL;
+static guint kb_index_generation = 0;
+
 
 /* central keypress event handler, almost all keypress events go to this function */
 static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *event, gpointer user_data);
@@ -107,6 +120,7 @@ static void cb_func_switch_tablastused(guint key_id);
 static void cb_func_move_tab(guint key_id);
 
 static void add_popup_menu_accels(void);
+static void invalidate_kb_index(void);
 
 
 /** Gets significant modifiers from a GdkModifierType mask. The set of
@@ -197,6 +211,7 @@ GeanyKeyBinding *keybindings_set_item(GeanyKeyGroup *group, gsize key_id,
 	kb->default_key = key;
 	kb->default_mods = mod;
 	kb->callback = callback;
+	invalidate_kb_index();
 	kb->cb_func = NULL;
 	kb->cb_data = NULL;
 	kb->menu_item = menu_item;
@@ -263,6 +278,7 @@ static void add_kb_group(GeanyKeyGroup *group,
 		const gchar *name, const gchar *label, GeanyKeyGroupCallback callback, gboolean plugin)
 {
 	g_ptr_array_add(keybinding_groups, group);
+	invalidate_kb_index();
 
 	/* as for items, we only require duplicated name and label for plugins */
 	group->name = plugin ? g_strdup(name) : name;
@@ -785,6 +801,7 @@ static void load_kb(GeanyKeyGroup *group, GeanyKeyBinding *kb, gpointer user_dat
 		gtk_accelerator_parse(val, &key, &mods);
 		kb->key = key;
 		kb->mods = mods;
+		invalidate_kb_index();
 		g_free(val);
 	}
 }
@@ -943,6 +960,7 @@ void keybindings_free(void)
 		keybindings_free_group(group);
 
 	g_ptr_array_free(keybinding_groups, TRUE);
+	invalidate_kb_index();
 }
 
 
@@ -1323,6 +1341,56 @@ gboolean keybindings_check_event(GdkEventKey *ev, GeanyKeyBinding *kb)
 }
 
 
+static void invalidate_kb_index(void)
+{
+	if (kb_index)
+	{
+		g_hash_table_destroy(kb_index);
+		kb_index = NULL;
+	}
+	kb_index_generation++;
+}
+
+
+static void free_kb_index_entries(gpointer data)
+{
+	g_array_free(data, TRUE);
+}
+
+
+static GHashTable *get_kb_index(void)
+{
+	GeanyKeyGroup *group;
+	GeanyKeyBinding *kb;
+	gsize g, i;
+
+	if (kb_index)
+		return kb_index;
+
+	kb_index = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_kb_index_entries);
+	foreach_ptr_array(group, g, keybinding_groups)
+	{
+		foreach_ptr_array(kb, i, group->key_items)
+		{
+			KBIndexEntry entry = {group, kb};
+			GArray *entries;
+
+			if (kb->key == 0)
+				continue;
+
+			entries = g_hash_table_lookup(kb_index, GUINT_TO_POINTER(kb->key));
+			if (! entries)
+			{
+				entries = g_array_new(FALSE, FALSE, sizeof(KBIndexEntry));
+				g_hash_table_insert(kb_index, GUINT_TO_POINTER(kb->key), entries);
+			}
+			g_array_append_val(entries, entry);
+		}
+	}
+	return kb_index;
+}
+
+
 static gboolean run_kb(GeanyKeyBinding *kb, GeanyKeyGroup *group)
 {
 	gboolean handled = TRUE;
@@ -1350,17 +1418,16 @@ static gboolean run_kb(GeanyKeyBinding *kb, GeanyKeyGroup *group)
 /* central keypress event handler, almost all keypress events go to this function */
 static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *ev, gpointer user_data)
 {
-	guint state, keyval;
-	gsize g, i;
+	guint state, keyval, generation;
 	GeanyDocument *doc;
-	GeanyKeyGroup *group;
-	GeanyKeyBinding *kb;
+	GArray *entries;
 	gboolean key_press_ret;
+	guint i;
 
 	if (ev->keyval == 0)
 		return FALSE;
 
-	g_signal_emit_by_name(geany_object, "key-press", ev, &key_press_ret);
+	geany_object_emit("key-press", ev, &key_press_ret);
 	if (key_press_ret)
 		return TRUE;
 
@@ -1388,16 +1455,19 @@ static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *ev, gpointer
 	if (check_menu_key(doc, keyval, state, ev->time))
 		return TRUE;
 
-	foreach_ptr_array(group, g, keybinding_groups)
+	entries = g_hash_table_lookup(get_kb_index(), GUINT_TO_POINTER(keyval));
+	generation = kb_index_generation;
+	for (i = 0; entries && i < entries->len; i++)
 	{
-		foreach_ptr_array(kb, i, group->key_items)
-		{
-			if (keyval == kb->key && state == kb->mods)
-			{
-				if (run_kb(kb, group))
-					return TRUE;
-			}
-		}
+		KBIndexEntry *entry = &g_array_index(entries, KBIndexEntry, i);
+
+		/* plugins may set the key of the public struct directly */
+		if (entry->kb->key == keyval && entry->kb->mods == state &&
+			run_kb(entry->kb, entry->group))
+			return TRUE;
+		/* the callback changed the bindings, freeing entries */
+		if (kb_index_generation != generation)
+			break;
 	}
 	/* fixed keybindings can be overridden by user bindings, so check them last */
 	if (check_fixed_kb(keyval, state))
@@ -1933,7 +2003,7 @@ static void goto_matching_brace(GeanyDocument *doc)
 	after_brace = pos > 0 && utils_isbrace(sci_get_char_at(doc->editor->sci, pos - 1), TRUE);
 	pos -= after_brace;	/* set pos to the brace */
 
-	new_pos = sci_find_matching_brace(doc->editor->sci, pos);
+	new_pos = brace_index_find_match(doc, pos);
 	if (new_pos != -1)
 	{	/* set the cursor at/after the brace */
 		sci_set_current_position(doc->editor->sci, new_pos + (!after_brace), FALSE);
@@ -2655,6 +2725,7 @@ void keybindings_update_combo(GeanyKeyBinding *kb, guint key, GdkModifierType mo
 
 	kb->key = key;
 	kb->mods = mods;
+	invalidate_kb_index();
 
 	if (widget && kb->key)
 		gtk_widget_add_accelerator(widget, "activate", kb_accel_group,
@@ -2680,6 +2751,7 @@ GeanyKeyGroup *keybindings_set_group(GeanyKeyGroup *group, const gchar *section_
 	/* Calls free_key_binding() for individual entries for plugins - has to be
 	 * called before g_free(group->plugin_keys) */
 	g_ptr_array_set_size(group->key_items, 0);
+	invalidate_kb_index();
 	g_free(group->plugin_keys);
 	group->plugin_keys = g_new0(GeanyKeyBinding, count);
 	group->plugin_key_count = count;
@@ -2690,4 +2762,5 @@ GeanyKeyGroup *keybindings_set_group(GeanyKeyGroup *group, const gchar *section_
 void keybindings_free_group(GeanyKeyGroup *group)
 {
 	g_ptr_array_remove_fast(keybinding_groups, group);
+	invalidate_kb_index();
 }
@@ -278,6 +278,10 @@ static void init_pref_groups(void)
 		"change_history_markers", FALSE, "check_change_history_markers");
 	stash_group_add_toggle_button(group, &editor_prefs.change_history_indicators,
 		"change_history_indicators", FALSE, "check_change_history_indicators");
+	stash_group_add_toggle_button(group, &editor_prefs.change_history_coalesce,
+		"change_history_coalesce", FALSE, "check_change_history_coalesce");
+	stash_group_add_spin_button_integer(group, &editor_prefs.change_history_depth,
+		"change_history_depth", 0, "spin_change_history_depth");
 	stash_group_add_toggle_button(group, &editor_prefs.autocomplete_doc_words,
 		"autocomplete_doc_words", FALSE, "check_autocomplete_doc_words");
 	stash_group_add_toggle_button(group, &editor_prefs.completion_drops_rest_of_word,
@@ -315,6 +319,10 @@ static void init_pref_groups(void)
 		"indent_hard_tab_width", 8);
 	stash_group_add_integer(group, &editor_prefs.ime_interaction,
 		"editor_ime_interaction", SC_IME_WINDOWED);
+	stash_group_add_integer(group, &editor_prefs.idle_styling,
+		"editor_idle_styling", -1);
+	stash_group_add_integer(group, &editor_prefs.layout_threads,
+		"editor_layout_threads", 0);
 
 	group = stash_group_new(PACKAGE);
 	configuration_add_various_pref_group(group, "files");
@@ -333,6 +341,10 @@ static void init_pref_groups(void)
 		"reload_clean_doc_on_file_change", FALSE);
 	stash_group_add_boolean(group, &file_prefs.save_config_on_file_change,
 		"save_config_on_file_change", TRUE);
+	stash_group_add_integer(group, &file_prefs.large_file_threshold,
+		"large_file_threshold", 64);
+	stash_group_add_integer(group, &file_prefs.tags_parse_timeout,
+		"tags_parse_timeout", 0);
 	stash_group_add_string(group, &file_prefs.extract_filetype_regex,
 		"extract_filetype_regex", GEANY_DEFAULT_FILETYPE_REGEX);
 	stash_group_add_boolean(group, &ui_prefs.allow_always_save,
@@ -345,6 +357,8 @@ static void init_pref_groups(void)
 		"find_selection_type", GEANY_FIND_SEL_CURRENT_WORD);
 	stash_group_add_boolean(group, &search_prefs.replace_and_find_by_default,
 		"replace_and_find_by_default", TRUE);
+	stash_group_add_boolean(group, &search_prefs.builtin_find_in_files,
+		"builtin_find_in_files", FALSE);
 
 	group = stash_group_new(PACKAGE);
 	configuration_add_various_pref_group(group, "socket");
@@ -712,6 +726,142 @@ static void save_ui_session(GKeyFile *config)
 	}
 }
 
+/* Config files are written by a worker thread, so saving doesn't block the UI on slow
+ * (e.g. network) file systems. Only the latest data queued for a file is written, and
+ * configuration_load_file() reads that data while the write is pending. */
+static GThreadPool *write_pool = NULL;
+static GMutex write_mutex;
+static GHashTable *pending_writes = NULL;	/* file name -> data to write */
+static gchar *writing_filename = NULL;		/* the file being written and its data */
+static gchar *writing_data = NULL;
+
+
+static gboolean report_write_error_idle(gpointer data)
+{
+	gchar *message = data;
+
+	ui_set_statusbar(TRUE, "%s", message);
+	g_free(message);
+	return G_SOURCE_REMOVE;
+}
+
+
+/* Replaces the file atomically, writing to the target of symlinks to keep them */
+static gboolean write_file_atomically(const gchar *filename, const gchar *data, GError **error)
+{
+	gchar *real_path = utils_get_real_path(filename);
+	gboolean ret;
+
+	ret = g_file_set_contents(real_path ? real_path : filename, data, -1, error);
+	g_free(real_path);
+	return ret;
+}
+
+
+static void write_file_thread(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	gchar *filename = data;
+	gpointer key;
+	GError *error = NULL;
+
+	g_mutex_lock(&write_mutex);
+	/* the data may have been replaced by newer data since the write was queued */
+	g_hash_table_lookup_extended(pending_writes, filename, &key, (gpointer *) &writing_data);
+	g_hash_table_steal(pending_writes, filename);
+	g_free(key);
+	writing_filename = filename;
+	g_mutex_unlock(&write_mutex);
+
+	if (! write_file_atomically(filename, writing_data, &error))
+	{
+		gchar *utf8_filename = utils_get_utf8_from_locale(filename);
+
+		g_idle_add(report_write_error_idle, g_strdup_printf(_("Could not write %s (%s)."),
+			utf8_filename, error->message));
+		g_free(utf8_filename);
+		g_error_free(error);
+	}
+
+	g_mutex_lock(&write_mutex);
+	g_free(writing_data);
+	writing_data = NULL;
+	writing_filename = NULL;
+	g_mutex_unlock(&write_mutex);
+	g_free(filename);
+}
+
+
+/* Queues data to be written to filename (in locale encoding), taking ownership of it.
+ * Writes queued for the same file before the worker gets to it are coalesced. */
+void configuration_write_file(const gchar *filename, gchar *data)
+{
+	gboolean queued;
+
+	g_mutex_lock(&write_mutex);
+	if (! pending_writes)
+		pending_writes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	queued = g_hash_table_contains(pending_writes, filename);
+	g_hash_table_insert(pending_writes, g_strdup(filename), data);
+	g_mutex_unlock(&write_mutex);
+
+	/* a single thread, so the writes of a file are done in order */
+	if (! write_pool)
+		write_pool = g_thread_pool_new(write_file_thread, NULL, 1, FALSE, NULL);
+	if (! queued)
+		g_thread_pool_push(write_pool, g_strdup(filename), NULL);
+}
+
+
+/* Waits until all queued writes are done */
+void configuration_flush_writes(void)
+{
+	if (write_pool)
+	{
+		g_thread_pool_free(write_pool, FALSE, TRUE);
+		write_pool = NULL;
+	}
+}
+
+
+/* Like configuration_write_file() but writes data before returning.
+ * Returns: TRUE if the file was written successfully. */
+gboolean configuration_write_file_now(const gchar *filename, const gchar *data)
+{
+	GError *error = NULL;
+
+	/* a queued write must not replace data afterwards */
+	configuration_flush_writes();
+	if (! write_file_atomically(filename, data, &error))
+	{
+		geany_debug("%s: could not write to file %s (%s)", G_STRFUNC, filename, error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+/* Like g_key_file_load_from_file() but also sees data queued to be written to filename */
+gboolean configuration_load_file(GKeyFile *config, const gchar *filename)
+{
+	const gchar *data = NULL;
+	gboolean ret = FALSE;
+
+	g_mutex_lock(&write_mutex);
+	if (pending_writes)
+		data = g_hash_table_lookup(pending_writes, filename);
+	if (! data && utils_str_equal(writing_filename, filename))
+		data = writing_data;
+	if (data)
+		ret = g_key_file_load_from_data(config, data, -1, G_KEY_FILE_NONE, NULL);
+	g_mutex_unlock(&write_mutex);
+
+	if (! data)
+		ret = g_key_file_load_from_file(config, filename, G_KEY_FILE_NONE, NULL);
+	return ret;
+}
+
+
 static void write_config_file(ConfigPayload payload)
 {
 	GKeyFile *config = g_key_file_new();
@@ -721,13 +871,13 @@ static void write_config_file(ConfigPayload payload)
 
 	filename = payload == SESSION ? SESSION_FILE : PREFS_FILE;
 	configfile = g_build_filename(app->configdir, filename, NULL);
-	g_key_file_load_from_file(config, configfile, G_KEY_FILE_NONE, NULL);
+	configuration_load_file(config, configfile);
 
 	switch (payload)
 	{
 		case PREFS:
 			/* this signal can be used e.g. to prepare any settings before Stash code reads them below */
-			g_signal_emit_by_name(geany_object, "save-settings", config);
+			geany_object_emit("save-settings", config);
 			save_dialog_prefs(config);
 			save_ui_prefs(config);
 			break;
@@ -755,8 +905,7 @@ static void write_config_file(ConfigPayload payload)
 
 	/* write the file */
 	data = g_key_file_to_data(config, NULL, NULL);
-	utils_write_file(configfile, data);
-	g_free(data);
+	configuration_write_file(configfile, data);
 
 	g_key_file_free(config);
 	g_free(configfile);
@@ -1183,15 +1332,14 @@ void configuration_save_default_session(void)
 	gchar *data;
 	GKeyFile *config = g_key_file_new();
 
-	g_key_file_load_from_file(config, configfile, G_KEY_FILE_NONE, NULL);
+	configuration_load_file(config, configfile);
 
 	if (cl_options.load_session)
 		configuration_save_session_files(config);
 
 	/* write the file */
 	data = g_key_file_to_data(config, NULL, NULL);
-	utils_write_file(configfile, data);
-	g_free(data);
+	configuration_write_file(configfile, data);
 
 	g_key_file_free(config);
 	g_free(configfile);
@@ -1204,15 +1352,14 @@ void configuration_clear_default_session(void)
 	gchar *data;
 	GKeyFile *config = g_key_file_new();
 
-	g_key_file_load_from_file(config, configfile, G_KEY_FILE_NONE, NULL);
+	configuration_load_file(config, configfile);
 
 	if (cl_options.load_session)
 		remove_session_files(config);
 
 	/* write the file */
 	data = g_key_file_to_data(config, NULL, NULL);
-	utils_write_file(configfile, data);
-	g_free(data);
+	configuration_write_file(configfile, data);
 
 	g_key_file_free(config);
 	g_free(configfile);
@@ -1229,7 +1376,7 @@ void configuration_load_default_session(void)
 
 	g_return_if_fail(default_session_files == NULL);
 
-	g_key_file_load_from_file(config, configfile, G_KEY_FILE_NONE, NULL);
+	configuration_load_file(config, configfile);
 	g_free(configfile);
 
 	default_session_files = configuration_load_session_files(config);
@@ -1243,7 +1390,7 @@ static gboolean read_config_file(ConfigPayload payload)
 	gchar *configfile;
 
 	configfile = get_keyfile_for_payload(payload);
-	g_key_file_load_from_file(config, configfile, G_KEY_FILE_NONE, NULL);
+	configuration_load_file(config, configfile);
 	g_free(configfile);
 
 	/* read stash prefs */
@@ -1261,7 +1408,7 @@ static gboolean read_config_file(ConfigPayload payload)
 			build_set_group_count(GEANY_GBG_EXEC, build_menu_prefs.number_exec_menu_items);
 			build_load_menu(config, GEANY_BCS_PREF, NULL);
 			/* this signal can be used e.g. to delay building UI elements until settings have been read */
-			g_signal_emit_by_name(geany_object, "load-settings", config);
+			geany_object_emit("load-settings", config);
 			break;
 		case SESSION:
 			project_load_prefs(config);
@@ -1287,6 +1434,15 @@ gboolean configuration_load(void)
 }
 
 
+static const gchar *get_session_file_encoding(gchar **tmp)
+{
+	if (isdigit(tmp[3][0]))
+		return encodings_get_charset_from_index(atoi(tmp[3]));
+	else
+		return &(tmp[3][1]);
+}
+
+
 static gboolean open_session_file(gchar **tmp, guint len)
 {
 	guint pos;
@@ -1303,14 +1459,7 @@ static gboolean open_session_file(gchar **tmp, guint len)
 	pos = atoi(tmp[0]);
 	ft_name = tmp[1];
 	ro = atoi(tmp[2]);
-	if (isdigit(tmp[3][0]))
-	{
-		encoding = encodings_get_charset_from_index(atoi(tmp[3]));
-	}
-	else
-	{
-		encoding = &(tmp[3][1]);
-	}
+	encoding = get_session_file_encoding(tmp);
 	indent_type = atoi(tmp[4]);
 	auto_indent = atoi(tmp[5]);
 	line_wrapping = atoi(tmp[6]);
@@ -1344,6 +1493,7 @@ static gboolean open_session_file(gchar **tmp, guint len)
 	{
 		geany_debug("Could not find file '%s'.", unescaped_filename);
 	}
+	main_profile_startup("session file %s", unescaped_filename);
 
 	g_free(locale_filename);
 	g_free(unescaped_filename);
@@ -1361,6 +1511,22 @@ void configuration_open_files(GPtrArray *session_files)
 	/* necessary to set it to TRUE for project session support */
 	main_opening_session_files(TRUE);
 
+	/* read and decode the files in parallel while the documents are created */
+	for (guint i = 0; i < session_files->len; i++)
+	{
+		gchar **tmp = g_ptr_array_index(session_files, i);
+
+		if (tmp != NULL && g_strv_length(tmp) >= 8)
+		{
+			gchar *unescaped_filename = g_uri_unescape_string(tmp[7], NULL);
+			gchar *locale_filename = utils_get_locale_from_utf8(unescaped_filename);
+
+			document_preload_file(locale_filename, get_session_file_encoding(tmp));
+			g_free(locale_filename);
+			g_free(unescaped_filename);
+		}
+	}
+
 	for (guint i = 0; i < session_files->len; i++)
 	{
 		gchar **tmp = g_ptr_array_index(session_files, i);
@@ -1375,9 +1541,17 @@ void configuration_open_files(GPtrArray *session_files)
 	}
 
 	g_ptr_array_free(session_files, TRUE);
+	document_clear_preloaded_files();
 
 	if (failure)
+	{
+		GeanyDocument *doc = document_get_current();
+
 		ui_set_statusbar(TRUE, _("Failed to load one or more session files."));
+		/* the current tab is shown without switching to it */
+		if (doc != NULL)
+			document_finish_deferred_init(doc);
+	}
 	else
 		document_show_tab_idle(session_notebook_page >= 0 ? document_get_from_page(session_notebook_page) : document_get_current());
 
@@ -1437,7 +1611,7 @@ void configuration_apply_settings(void)
 static gboolean save_configuration_cb(gpointer data)
 {
 	if (app->project != NULL)
-		project_write_config();
+		project_queue_write_config();
 	else
 		configuration_save_default_session();
 	return G_SOURCE_REMOVE;
@@ -1478,6 +1652,10 @@ void configuration_finalize(void)
 {
 	g_signal_handlers_disconnect_by_func(geany_object, G_CALLBACK(document_list_changed_cb), NULL);
 
+	configuration_flush_writes();
+	if (pending_writes)
+		g_hash_table_destroy(pending_writes);
+
 	g_ptr_array_free(pref_groups, TRUE);
 	g_ptr_array_free(keyfile_groups[SESSION], TRUE);
 	g_ptr_array_free(keyfile_groups[PREFS], TRUE);
@@ -44,6 +44,14 @@ void configuration_add_session_group(struct StashGroup *group, gboolean for_pref
 
 void configuration_save(void);
 
+void configuration_write_file(const gchar *filename, gchar *data);
+
+gboolean configuration_write_file_now(const gchar *filename, const gchar *data);
+
+void configuration_flush_writes(void);
+
+gboolean configuration_load_file(GKeyFile *config, const gchar *filename);
+
 gboolean configuration_load(void);
 
 void configuration_open_files(GPtrArray *session_files);
@@ -35,6 +35,7 @@
 #include "callbacks.h"
 #include "dialogs.h"
 #include "document.h"
+#include "documentprivate.h"
 #include "encodingsprivate.h"
 #include "filetypes.h"
 #include "geanyobject.h"
@@ -46,10 +47,12 @@
 #include "navqueue.h"
 #include "notebook.h"
 #include "plugins.h"
+#include "projectindex.h"
 #include "projectprivate.h"
 #include "prefs.h"
 #include "printing.h"
 #include "sidebar.h"
+#include "stallwatch.h"
 #ifdef HAVE_SOCKET
 # include "socket.h"
 #endif
@@ -84,7 +87,7 @@
 #endif
 
 
-GeanyApp	*app;
+GEANY_EXPORT_SYMBOL GeanyApp	*app;
 gboolean	ignore_callback;	/* hack workaround for GTK+ toggle button callback problem */
 
 GeanyStatus	 main_status;
@@ -108,8 +111,11 @@ static gchar *lib_vte = NULL;
 #endif
 static gboolean generate_tags = FALSE;
 static gboolean no_preprocessing = FALSE;
+static gboolean binary_tags = FALSE;
+static gint tags_jobs = 1;
 static gboolean ft_names = FALSE;
 static gboolean print_prefix = FALSE;
+static gboolean profile_startup = FALSE;
 #ifdef HAVE_PLUGINS
 static gboolean no_plugins = FALSE;
 #endif
@@ -118,11 +124,13 @@ static gboolean dummy = FALSE;
 /* in alphabetical order of short options */
 static GOptionEntry entries[] =
 {
+	{ "binary-tags", 0, 0, G_OPTION_ARG_NONE, &binary_tags, N_("Generate the global tags file in the binary format (faster to load)"), NULL },
 	{ "column", 0, 0, G_OPTION_ARG_INT, &cl_options.goto_column, N_("Set initial column number to COLUMN for the first opened file (useful in conjunction with --line)"), N_("COLUMN") },
 	{ "config", 'c', 0, G_OPTION_ARG_FILENAME, &alternate_config, N_("Use alternate configuration directory DIR"), N_("DIR") },
 	{ "ft-names", 0, 0, G_OPTION_ARG_NONE, &ft_names, N_("Print internal filetype names"), NULL },
 	{ "generate-tags", 'g', 0, G_OPTION_ARG_NONE, &generate_tags, N_("Generate global tags file (see documentation)"), NULL },
 	{ "no-preprocessing", 'P', 0, G_OPTION_ARG_NONE, &no_preprocessing, N_("Don't preprocess C/C++ files when generating tags file"), NULL },
+	{ "tags-jobs", 0, 0, G_OPTION_ARG_INT, &tags_jobs, N_("Preprocess C/C++ files in N parallel jobs when generating tags file"), N_("N") },
 #ifdef HAVE_SOCKET
 	{ "new-instance", 'i', 0, G_OPTION_ARG_NONE, &cl_options.new_instance, N_("Don't open files in a running instance, force opening a new instance"), NULL },
 	{ "socket-file", 0, 0, G_OPTION_ARG_FILENAME, &cl_options.socket_filename, N_("Use socket filename FILE for communication with a running Geany instance"), N_("FILE") },
@@ -135,6 +143,7 @@ static GOptionEntry entries[] =
 	{ "no-plugins", 'p', 0, G_OPTION_ARG_NONE, &no_plugins, N_("Don't load plugins"), NULL },
 #endif
 	{ "print-prefix", 0, 0, G_OPTION_ARG_NONE, &print_prefix, N_("Print Geany's installation prefix"), NULL },
+	{ "profile-startup", 0, 0, G_OPTION_ARG_NONE, &profile_startup, N_("Print how long each phase of the startup takes"), NULL },
 	{ "read-only", 'r', 0, G_OPTION_ARG_NONE, &cl_options.readonly, N_("Open all FILES in read-only mode (see documentation)"), NULL },
 	{ "no-session", 's', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &cl_options.load_session, N_("Don't load the previous session's files"), NULL },
 #ifdef HAVE_VTE
@@ -238,7 +247,7 @@ static void on_window_active_changed(GtkWindow *window, GParamSpec *pspec, gpoin
 	GeanyDocument *doc = document_get_current();
 
 	if (doc && gtk_window_is_active(window))
-		document_check_disk_status(doc, TRUE);
+		document_queue_disk_check(doc);
 }
 
 
@@ -623,7 +632,8 @@ static void parse_command_line_options(gint *argc, gchar ***argv)
 		gboolean ret;
 
 		filetypes_init_types();
-		ret = symbols_generate_global_tags(*argc, *argv, ! no_preprocessing);
+		ret = symbols_generate_global_tags(*argc, *argv, ! no_preprocessing, binary_tags,
+			MAX(tags_jobs, 1));
 		filetypes_free_types();
 		wait_for_input_on_windows();
 		exit(ret);
@@ -861,6 +871,58 @@ gboolean main_handle_filename(const gchar *locale_filename)
 }
 
 
+/* Opens many files at once like main_handle_filename(), e.g. the files sent by another
+ * instance. As for the session files, the files are read in parallel, the symbols of the
+ * documents are parsed when they are first shown, and only the last document is shown. */
+void main_handle_filenames(GPtrArray *locale_filenames)
+{
+	GPtrArray *new_files = g_ptr_array_new_with_free_func(g_free);
+	guint i;
+
+	main_opening_session_files(TRUE);
+
+	for (i = 0; i < locale_filenames->len; i++)
+	{
+		gchar *filename = utils_get_path_from_uri(g_ptr_array_index(locale_filenames, i));
+		gint line = -1, column = -1;
+
+		if (filename == NULL)
+			continue;
+
+		get_line_and_column_from_filename(filename, &line, &column);
+		if (g_file_test(filename, G_FILE_TEST_IS_REGULAR))
+		{
+			gchar *utf8_filename = utils_get_utf8_from_locale(filename);
+
+			if (document_find_by_filename(utf8_filename) == NULL)
+			{
+				document_preload_file(filename, NULL);
+				g_ptr_array_add(new_files, utf8_filename);
+			}
+			else
+				g_free(utf8_filename);
+		}
+		g_free(filename);
+	}
+
+	for (i = 0; i < locale_filenames->len; i++)
+		main_handle_filename(g_ptr_array_index(locale_filenames, i));
+	document_clear_preloaded_files();
+
+	/* unlike the session files, there is no stored indentation to use instead */
+	for (i = 0; i < new_files->len; i++)
+	{
+		GeanyDocument *doc = document_find_by_filename(g_ptr_array_index(new_files, i));
+
+		if (doc != NULL && doc->priv->init_pending)
+			document_apply_indent_settings(doc);
+	}
+	g_ptr_array_free(new_files, TRUE);
+
+	main_opening_session_files(FALSE);
+}
+
+
 /* open files from command line */
 static void open_cl_files(gint argc, gchar **argv)
 {
@@ -998,11 +1060,69 @@ static void load_startup_files(gint argc, gchar **argv)
 }
 
 
+/* startup times, in microseconds, for --profile-startup */
+static gint64 startup_begin_time;
+static gint64 startup_phase_time;
+
+
+/* Prints the time since the start and since the last call when --profile-startup is
+ * passed, at the end of the startup phase described by format. */
+void main_profile_startup(const gchar *format, ...)
+{
+	va_list args;
+	gchar *phase;
+	gint64 now;
+
+	if (G_LIKELY(! profile_startup))
+		return;
+
+	now = g_get_monotonic_time();
+	va_start(args, format);
+	phase = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	printf("%10.2f ms %10.2f ms  %s\n", (now - startup_begin_time) / 1000.0,
+		(now - startup_phase_time) / 1000.0, phase);
+	fflush(stdout);
+
+	startup_phase_time = now;
+	g_free(phase);
+}
+
+
 static gboolean send_startup_complete(gpointer data)
 {
-	g_signal_emit_by_name(geany_object, "geany-startup-complete");
+	geany_object_emit("geany-startup-complete");
+	main_profile_startup("startup complete");
+	/* don't report the files and plugins opened later */
+	profile_startup = FALSE;
+	stallwatch_start();
+	return FALSE;
+}
+
+
+#ifdef HAVE_PLUGINS
+static gboolean load_deferred_plugins(gpointer data)
+{
+	plugins_load_deferred();
+	/* load shortcuts of the plugins' keybinding groups */
+	keybindings_load_keyfile();
+	main_profile_startup("deferred plugins loaded");
+
+	g_idle_add_full(G_PRIORITY_LOW, send_startup_complete, NULL, NULL);
+	return FALSE;
+}
+
+
+static gboolean on_window_first_draw(GtkWidget *widget, cairo_t *cr, gpointer data)
+{
+	g_signal_handlers_disconnect_by_func(widget, on_window_first_draw, data);
+	main_profile_startup("first frame drawn");
+
+	g_idle_add(load_deferred_plugins, NULL);
 	return FALSE;
 }
+#endif
 
 
 static const gchar *get_locale(void)
@@ -1045,6 +1165,8 @@ gint main_lib(gint argc, gchar **argv)
 	gchar *utf8_configdir;
 	gchar *os_info;
 
+	startup_begin_time = startup_phase_time = g_get_monotonic_time();
+
 	main_init_headless();
 
 	log_handlers_init();
@@ -1136,6 +1258,8 @@ gint main_lib(gint argc, gchar **argv)
 	/* create the object so Geany signals can be connected in init() functions */
 	geany_object = geany_object_new();
 
+	main_profile_startup("command line, paths and socket");
+
 	/* inits */
 	main_init();
 
@@ -1151,23 +1275,31 @@ gint main_lib(gint argc, gchar **argv)
 	plugins_init();
 #endif
 	sidebar_init();
+	stallwatch_init();
 	load_settings();	/* load keyfile */
+	main_profile_startup("settings loaded");
 
 	msgwin_init();
 	build_init();
 	ui_create_insert_menu_items();
 	ui_create_insert_date_menu_items();
 	keybindings_init();
+	main_profile_startup("keybindings initialized");
 	notebook_init();
 	filetypes_init();
+	main_profile_startup("filetypes initialized");
 	templates_init();
+	main_profile_startup("templates initialized");
 	navqueue_init();
+	project_index_init();
 	document_init_doclist();
 	symbols_init();
 	editor_snippets_init();
+	main_profile_startup("symbols and snippets initialized");
 
 #ifdef HAVE_VTE
 	vte_init();
+	main_profile_startup("terminal initialized");
 #endif
 	ui_create_recent_menus();
 
@@ -1190,11 +1322,15 @@ gint main_lib(gint argc, gchar **argv)
 
 	/* apply all configuration options */
 	apply_settings();
+	main_profile_startup("settings applied");
 
 #ifdef HAVE_PLUGINS
 	/* load any enabled plugins before we open any documents */
 	if (want_plugins)
+	{
 		plugins_load_active();
+		main_profile_startup("plugins loaded");
+	}
 #endif
 
 	ui_sidebar_show_hide();
@@ -1208,11 +1344,13 @@ gint main_lib(gint argc, gchar **argv)
 	/* create the custom command menu after the keybindings have been loaded to have the proper
 	 * accelerator shown for the menu items */
 	tools_create_insert_custom_command_menu_items();
+	main_profile_startup("keybinding settings loaded");
 
 	/* load any command line files or session files */
 	main_opening_session_files(TRUE);
 	load_startup_files(argc, argv);
 	main_opening_session_files(FALSE);
+	main_profile_startup("files opened");
 
 	/* open a new file if no other file was opened */
 	document_new_file_if_non_open();
@@ -1231,6 +1369,7 @@ gint main_lib(gint argc, gchar **argv)
 	document_grab_focus(doc);
 	gtk_widget_show(main_widgets.window);
 	main_status.main_window_realized = TRUE;
+	main_profile_startup("window shown");
 
 	configuration_apply_settings();
 
@@ -1246,6 +1385,13 @@ gint main_lib(gint argc, gchar **argv)
 
 	/* when we are really done with setting everything up and the main event loop is running,
 	 * tell other components, mainly plugins, that startup is complete */
+#ifdef HAVE_PLUGINS
+	/* the plugins which aren't needed to show the window are loaded after its first frame,
+	 * the startup is then complete once they are loaded */
+	if (want_plugins && plugins_have_deferred())
+		g_signal_connect_after(main_widgets.window, "draw", G_CALLBACK(on_window_first_draw), NULL);
+	else
+#endif
 	g_idle_add_full(G_PRIORITY_LOW, send_startup_complete, NULL, NULL);
 
 #ifdef MAC_INTEGRATION
@@ -1284,6 +1430,7 @@ static gboolean do_main_quit(void)
 	geany_debug("Quitting...");
 
 	main_status.quitting = TRUE;
+	stallwatch_finalize();
 
 #ifdef HAVE_SOCKET
 	socket_finalize();
@@ -1294,6 +1441,7 @@ static gboolean do_main_quit(void)
 #endif
 
 	navqueue_free();
+	project_index_finalize();
 	keybindings_free();
 	notebook_free();
 	highlighting_free_styles();
@@ -1453,10 +1601,10 @@ void main_reload_configuration(void)
 void main_opening_session_files(gboolean opening)
 {
 	if (opening && !main_status.opening_session_files)
-		g_signal_emit_by_name(geany_object, "session-opening", TRUE);
+		geany_object_emit("session-opening", TRUE);
 
 	main_status.opening_session_files += opening ? 1 : -1;
 
 	if (!opening && !main_status.opening_session_files)
-		g_signal_emit_by_name(geany_object, "session-opening", FALSE);
+		geany_object_emit("session-opening", FALSE);
 }
@@ -153,6 +153,17 @@ void lsp_unregister(Lsp *lsp)
 }
 
 
+/* Tells Geany that the keywords returned by symbol_highlight_get_cached() changed
+ * outside of the symbol_highlight_request() callback (e.g. a partial result
+ * was delivered first and the complete result arrived later). */
+GEANY_API_SYMBOL
+void lsp_symbol_highlight_update(GeanyDocument *doc)
+{
+	if (DOC_VALID(doc))
+		document_highlight_lsp_tags(doc);
+}
+
+
 guint lsp_get_symbols_icon_id(guint kind)
 {
 	if (kind >= LspKindFile && kind <= LSP_KIND_NUM)
@@ -52,6 +52,8 @@ typedef struct {
 void lsp_register(Lsp *lsp);
 void lsp_unregister(Lsp *lsp);
 
+void lsp_symbol_highlight_update(GeanyDocument *doc);
+
 
 #ifdef GEANY_PRIVATE
 
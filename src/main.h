@@ -72,6 +72,8 @@ gboolean main_quit(void);
 
 gboolean main_handle_filename(const gchar *locale_filename);
 
+void main_handle_filenames(GPtrArray *locale_filenames);
+
 void main_load_project_from_command_line(const gchar *locale_filename, gboolean use_session);
 
 gint main_lib(gint argc, gchar **argv);
@@ -80,6 +82,8 @@ void main_init_headless(void);
 
 void main_opening_session_files(gboolean opening);
 
+void main_profile_startup(const gchar *format, ...) G_GNUC_PRINTF(1, 2);
+
 #endif /* GEANY_PRIVATE */
 
 G_END_DECLS
@@ -0,0 +1,166 @@
+/*
+ *      memusage.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2023 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Report of the memory used by the open documents, to see which documents and
+ * which parts of them use most of it.
+ *
+ * The sizes are estimates: Scintilla reports the allocated size of its buffers
+ * including unused capacity, and the strings of tags are counted for each tag
+ * even when they are shared.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "memusage.h"
+
+#include "braceindex.h"
+#include "document.h"
+#include "sciwrappers.h"
+#include "tm_source_file.h"
+#include "tm_workspace.h"
+
+#include <glib.h>
+
+
+enum
+{
+	MEM_TEXT,
+	MEM_STYLES,
+	MEM_UNDO,
+	MEM_LINES,
+	MEM_LAYOUT,
+	MEM_TAGS,
+	MEM_BRACES,
+	MEM_COUNT
+};
+
+static const gchar *part_names[MEM_COUNT] =
+{
+	"text", "styles", "undo", "lines", "layout", "tags", "braces"
+};
+
+typedef struct
+{
+	GeanyDocument *doc;
+	gsize sizes[MEM_COUNT];
+	gsize total;
+}
+DocumentMemory;
+
+
+static void get_document_memory(GeanyDocument *doc, DocumentMemory *mem)
+{
+	static const gint sci_parts[] =
+	{
+		SC_MEMORY_TEXT, SC_MEMORY_STYLES, SC_MEMORY_UNDO, SC_MEMORY_LINES, SC_MEMORY_LAYOUT
+	};
+	guint i;
+
+	mem->doc = doc;
+	for (i = 0; i < G_N_ELEMENTS(sci_parts); i++)
+		mem->sizes[i] = SSM(doc->editor->sci, SCI_GETMEMORYUSAGE, sci_parts[i], 0);
+	mem->sizes[MEM_TAGS] = doc->tm_file ? tm_source_file_get_memory_size(doc->tm_file) : 0;
+	mem->sizes[MEM_BRACES] = brace_index_get_memory_size(doc);
+
+	mem->total = 0;
+	for (i = 0; i < MEM_COUNT; i++)
+		mem->total += mem->sizes[i];
+}
+
+
+/* biggest first */
+static gint compare_document_memory(gconstpointer a, gconstpointer b)
+{
+	const DocumentMemory *m1 = a;
+	const DocumentMemory *m2 = b;
+
+	return m1->total < m2->total ? 1 : m1->total > m2->total ? -1 : 0;
+}
+
+
+static void append_row(GString *str, const gsize *sizes, gsize total, const gchar *name)
+{
+	guint i;
+
+	for (i = 0; i < MEM_COUNT; i++)
+		g_string_append_printf(str, "%10.1f ", sizes[i] / 1024.0);
+	g_string_append_printf(str, "%10.1f  %s\n", total / 1024.0, name);
+}
+
+
+/* Returns the memory usage of the open documents in kB, one row per document
+ * and one per part of the documents, biggest first. */
+gchar *memusage_get_report(void)
+{
+	GString *str = g_string_new(NULL);
+	GArray *docs = g_array_new(FALSE, FALSE, sizeof(DocumentMemory));
+	DocumentMemory sum = {0};
+	gsize arrays_size, global_size;
+	guint i;
+
+	foreach_document(i)
+	{
+		DocumentMemory mem;
+
+		get_document_memory(documents[i], &mem);
+		g_array_append_val(docs, mem);
+	}
+	g_array_sort(docs, compare_document_memory);
+
+	for (i = 0; i < MEM_COUNT; i++)
+		g_string_append_printf(str, "%10s ", part_names[i]);
+	g_string_append_printf(str, "%10s  %s\n", "total", "document");
+
+	for (i = 0; i < docs->len; i++)
+	{
+		DocumentMemory *mem = &g_array_index(docs, DocumentMemory, i);
+		guint j;
+
+		append_row(str, mem->sizes, mem->total, DOC_FILENAME(mem->doc));
+		for (j = 0; j < MEM_COUNT; j++)
+			sum.sizes[j] += mem->sizes[j];
+		sum.total += mem->total;
+	}
+	append_row(str, sum.sizes, sum.total, "all documents");
+
+	g_string_append_c(str, '\n');
+	g_string_append_printf(str, "%-16s %10s\n", "subsystem", "kB");
+	for (i = 0; i < MEM_COUNT; i++)
+		g_string_append_printf(str, "%-16s %10.1f\n", part_names[i], sum.sizes[i] / 1024.0);
+
+	tm_workspace_get_memory_size(&arrays_size, &global_size);
+	g_string_append_printf(str, "%-16s %10.1f\n", "workspace tags", arrays_size / 1024.0);
+	g_string_append_printf(str, "%-16s %10.1f\n", "global tags", global_size / 1024.0);
+
+	g_array_free(docs, TRUE);
+	return g_string_free(str, FALSE);
+}
+
+
+void memusage_show_report(void)
+{
+	gchar *report = memusage_get_report();
+
+	document_new_file(NULL, NULL, report);
+	g_free(report);
+}
@@ -86,6 +86,9 @@ static GdkColor color_error = {0, 0xFFFF, 0, 0};
 static GdkColor color_context = {0, 0x7FFF, 0, 0};
 static GdkColor color_message = {0, 0, 0, 0xD000};
 
+/* idle source scrolling the compiler tab to its last line */
+static guint compiler_scroll_source = 0;
+
 
 static void prepare_msg_tree_view(void);
 static void prepare_status_tree_view(void);
@@ -166,6 +169,8 @@ void msgwin_init(void)
 
 void msgwin_finalize(void)
 {
+	if (compiler_scroll_source)
+		g_source_remove(compiler_scroll_source);
 	g_free(msgwindow.messages_dir);
 }
 
@@ -305,6 +310,23 @@ static const GdkColor *get_color(gint msg_color)
 }
 
 
+static gboolean compiler_scroll_idle(G_GNUC_UNUSED gpointer data)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(msgwindow.store_compiler);
+	gint count = gtk_tree_model_iter_n_children(model, NULL);
+
+	compiler_scroll_source = 0;
+	if (count > 0 && ui_prefs.msgwindow_visible && interface_prefs.compiler_tab_autoscroll)
+	{
+		GtkTreePath *path = gtk_tree_path_new_from_indices(count - 1, -1);
+
+		gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(msgwindow.tree_compiler), path, NULL, TRUE, 0.5, 0.5);
+		gtk_tree_path_free(path);
+	}
+	return FALSE;
+}
+
+
 /**
  * Adds a formatted message in the compiler tab treeview in the messages window.
  *
@@ -342,7 +364,6 @@ void msgwin_compiler_add(gint msg_color, const gchar *format, ...)
 GEANY_API_SYMBOL
 void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
 {
-	GtkTreeIter iter;
 	const GdkColor *color = get_color(msg_color);
 	gchar *utf8_msg;
 
@@ -351,17 +372,16 @@ void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
 	else
 		utf8_msg = (gchar *) msg;
 
-	gtk_list_store_append(msgwindow.store_compiler, &iter);
-	gtk_list_store_set(msgwindow.store_compiler, &iter,
+	/* a single row-inserted signal instead of row-inserted and row-changed */
+	gtk_list_store_insert_with_values(msgwindow.store_compiler, NULL, -1,
 		COMPILER_COL_COLOR, color, COMPILER_COL_STRING, utf8_msg, -1);
 
-	if (ui_prefs.msgwindow_visible && interface_prefs.compiler_tab_autoscroll)
+	/* scrolling makes the tree view lay out the rows at once, so with lots of output
+	 * only scroll once all the lines which came in together are added */
+	if (ui_prefs.msgwindow_visible && interface_prefs.compiler_tab_autoscroll &&
+		compiler_scroll_source == 0)
 	{
-		GtkTreePath *path = gtk_tree_model_get_path(
-			gtk_tree_view_get_model(GTK_TREE_VIEW(msgwindow.tree_compiler)), &iter);
-
-		gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(msgwindow.tree_compiler), path, NULL, TRUE, 0.5, 0.5);
-		gtk_tree_path_free(path);
+		compiler_scroll_source = g_idle_add_full(G_PRIORITY_LOW, compiler_scroll_idle, NULL, NULL);
 	}
 
 	if (utf8_msg != msg)
@@ -432,7 +452,6 @@ void msgwin_msg_add(gint msg_color, gint line, GeanyDocument *doc, const gchar *
 GEANY_API_SYMBOL
 void msgwin_msg_add_string(gint msg_color, gint line, GeanyDocument *doc, const gchar *string)
 {
-	GtkTreeIter iter;
 	const GdkColor *color = get_color(msg_color);
 	gchar *tmp;
 	gsize len;
@@ -455,8 +474,7 @@ void msgwin_msg_add_string(gint msg_color, gint line, GeanyDocument *doc, const
 	else
 		utf8_msg = tmp;
 
-	gtk_list_store_append(msgwindow.store_msg, &iter);
-	gtk_list_store_set(msgwindow.store_msg, &iter,
+	gtk_list_store_insert_with_values(msgwindow.store_msg, NULL, -1,
 		MSG_COL_LINE, line, MSG_COL_DOC_ID, doc ? doc->id : 0, MSG_COL_COLOR,
 		color, MSG_COL_STRING, utf8_msg, -1);
 
@@ -1071,7 +1089,7 @@ void msgwin_parse_compiler_error_line(const gchar *string, const gchar *dir,
 		gchar **filename, gint *line)
 {
 	GeanyFiletype *ft;
-	gchar *trimmed_string, *utf8_dir;
+	gchar *utf8_dir;
 
 	*filename = NULL;
 	*line = -1;
@@ -1085,19 +1103,20 @@ void msgwin_parse_compiler_error_line(const gchar *string, const gchar *dir,
 		utf8_dir = g_strdup(dir);
 	g_return_if_fail(utf8_dir != NULL);
 
-	trimmed_string = g_strdup(string);
-	g_strchug(trimmed_string); /* remove possible leading whitespace */
+	/* remove possible leading whitespace */
+	while (g_ascii_isspace(*string))
+		string++;
 
 	ft = filetypes[build_info.file_type_id];
 
 	/* try parsing with a custom regex */
-	if (!filetypes_parse_error_message(ft, trimmed_string, filename, line))
+	if (!filetypes_parse_error_message(ft, string, filename, line))
 	{
-		/* fallback to default old-style parsing */
-		parse_compiler_error_line(trimmed_string, filename, line);
+		/* fallback to default old-style parsing, all of its formats need a line number */
+		if (strpbrk(string, "0123456789") != NULL)
+			parse_compiler_error_line(string, filename, line);
 	}
 	make_absolute(filename, utf8_dir);
-	g_free(trimmed_string);
 	g_free(utf8_dir);
 }
 
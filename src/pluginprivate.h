@@ -40,6 +40,7 @@ typedef enum _LoadedFlags {
 	LOADED_OK = 0x01,
 	IS_LEGACY = 0x02,
 	LOAD_DATA = 0x04,
+	IS_CACHED = 0x08,	/* info read from the plugin cache, the plugin isn't loaded */
 }
 LoadedFlags;
 
@@ -71,12 +72,14 @@ typedef struct GeanyPluginPrivate
 											 * this gives the proxy a pointer to each plugin */
 	gint			proxied_count;			/* count of active plugins this provides a proxy for
 											 * (a count because of possibly nested proxies) */
+	gchar			**cached_info;			/* strings of info if IS_CACHED */
 }
 GeanyPluginPrivate;
 
 #define PLUGIN_LOADED_OK(p) (((p)->flags & LOADED_OK) != 0)
 #define PLUGIN_IS_LEGACY(p) (((p)->flags & IS_LEGACY) != 0)
 #define PLUGIN_HAS_LOAD_DATA(p) (((p)->flags & LOAD_DATA) != 0)
+#define PLUGIN_IS_CACHED(p) (((p)->flags & IS_CACHED) != 0)
 
 void plugin_watch_object(Plugin *plugin, gpointer object);
 void plugin_make_resident(Plugin *plugin);
@@ -55,6 +55,7 @@
 #include "win32.h"
 
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 
@@ -76,9 +77,17 @@ static gboolean want_plugins = FALSE;
 static GList *plugin_list = NULL;
 static gchar **active_plugins_pref = NULL; 	/* list of plugin filenames to load at startup */
 static GList *failed_plugins_list = NULL;	/* plugins the user wants active but can't be used */
+static gchar *deferred_plugins_pref = NULL;	/* plugins loaded after the window is shown */
 
 static GtkWidget *menu_separator = NULL;
 
+/* info of plugins keyed by file name, to list them in the plugin manager without
+ * loading them. An entry is only used while the file's mtime and size match. */
+static GKeyFile *plugin_cache = NULL;
+static gboolean plugin_cache_changed = FALSE;
+
+#define PLUGIN_CACHE_GROUP "Plugin Cache"
+
 static gchar *get_plugin_path(void);
 static void pm_show_dialog(GtkMenuItem *menuitem, gpointer user_data);
 
@@ -605,10 +614,180 @@ static void plugin_unload_gmodule(GeanyPlugin *proxy, GeanyPlugin *subplugin, gp
 }
 
 
+static gchar *get_plugin_cache_filename(void)
+{
+	return g_build_filename(app->configdir, "plugin_cache.conf", NULL);
+}
+
+
+static GKeyFile *get_plugin_cache(void)
+{
+	gchar *fname;
+
+	if (plugin_cache)
+		return plugin_cache;
+
+	plugin_cache = g_key_file_new();
+	fname = get_plugin_cache_filename();
+	if (configuration_load_file(plugin_cache, fname))
+	{
+		gchar *language = g_key_file_get_string(plugin_cache, PLUGIN_CACHE_GROUP, "language", NULL);
+
+		/* plugins translate their info and may not work with another Geany version */
+		if (g_key_file_get_integer(plugin_cache, PLUGIN_CACHE_GROUP, "abi", NULL) != GEANY_ABI_VERSION ||
+			g_key_file_get_integer(plugin_cache, PLUGIN_CACHE_GROUP, "api", NULL) != GEANY_API_VERSION ||
+			! utils_str_equal(language, g_get_language_names()[0]))
+		{
+			g_key_file_free(plugin_cache);
+			plugin_cache = g_key_file_new();
+		}
+		g_free(language);
+	}
+	g_free(fname);
+	return plugin_cache;
+}
+
+
+/* Returns the key file group of fname, or NULL if it can't be used as group name */
+static gchar *get_plugin_cache_group(const gchar *fname, gint64 *mtime, gint64 *size)
+{
+	GStatBuf st;
+	gchar *group;
+
+	if (g_stat(fname, &st) != 0)
+		return NULL;
+
+	*mtime = st.st_mtime;
+	*size = st.st_size;
+	group = utils_get_utf8_from_locale(fname);
+	if (strpbrk(group, "[]\n") != NULL || utils_str_equal(group, PLUGIN_CACHE_GROUP))
+	{
+		g_free(group);
+		return NULL;
+	}
+	return group;
+}
+
+
+static const gchar *get_proxy_name(Plugin *plugin)
+{
+	return plugin->proxy == &builtin_so_proxy_plugin ? "" : plugin->proxy->filename;
+}
+
+
+/* Remembers the info of a successfully loaded plugin */
+static void plugin_cache_store(Plugin *plugin)
+{
+	const gchar *values[] = {
+		plugin->info.name, plugin->info.description, plugin->info.version, plugin->info.author
+	};
+	const gchar *keys[] = {"name", "description", "version", "author"};
+	GKeyFile *cache = get_plugin_cache();
+	gint64 mtime, size;
+	gchar *group;
+	guint i;
+
+	group = get_plugin_cache_group(plugin->filename, &mtime, &size);
+	if (! group)
+		return;
+
+	for (i = 0; i < G_N_ELEMENTS(values); i++)
+	{
+		if (values[i] && ! g_utf8_validate(values[i], -1, NULL))
+		{
+			g_free(group);
+			return;
+		}
+	}
+
+	g_key_file_remove_group(cache, group, NULL);
+	g_key_file_set_int64(cache, group, "mtime", mtime);
+	g_key_file_set_int64(cache, group, "size", size);
+	g_key_file_set_string(cache, group, "proxy", get_proxy_name(plugin));
+	for (i = 0; i < G_N_ELEMENTS(values); i++)
+		g_key_file_set_string(cache, group, keys[i], values[i] ? values[i] : "");
+	plugin_cache_changed = TRUE;
+	g_free(group);
+}
+
+
+/* Fills in the info of plugin from the cache, if it has an up to date entry */
+static gboolean plugin_cache_lookup(Plugin *plugin)
+{
+	const gchar *keys[] = {"name", "description", "version", "author"};
+	GKeyFile *cache = get_plugin_cache();
+	gint64 mtime, size;
+	gchar *group, *proxy;
+	gboolean valid;
+	guint i;
+
+	group = get_plugin_cache_group(plugin->filename, &mtime, &size);
+	if (! group)
+		return FALSE;
+
+	proxy = g_key_file_get_string(cache, group, "proxy", NULL);
+	valid = proxy && utils_str_equal(proxy, get_proxy_name(plugin)) &&
+		g_key_file_get_int64(cache, group, "mtime", NULL) == mtime &&
+		g_key_file_get_int64(cache, group, "size", NULL) == size;
+	g_free(proxy);
+
+	if (valid)
+	{
+		plugin->cached_info = g_new0(gchar *, G_N_ELEMENTS(keys) + 1);
+		for (i = 0; i < G_N_ELEMENTS(keys); i++)
+		{
+			gchar *value = g_key_file_get_string(cache, group, keys[i], NULL);
+
+			plugin->cached_info[i] = value ? value : g_strdup("");
+		}
+		plugin->info.name = plugin->cached_info[0];
+		plugin->info.description = plugin->cached_info[1];
+		plugin->info.version = plugin->cached_info[2];
+		plugin->info.author = plugin->cached_info[3];
+		plugin->flags = IS_CACHED;
+	}
+	g_free(group);
+	return valid;
+}
+
+
+/* Writes the cache if it changed, dropping the entries of removed plugins */
+static void plugin_cache_save(void)
+{
+	gchar **groups, **group;
+	gchar *fname, *data;
+
+	if (! plugin_cache || ! plugin_cache_changed)
+		return;
+
+	groups = g_key_file_get_groups(plugin_cache, NULL);
+	foreach_strv(group, groups)
+	{
+		gchar *locale_name = utils_get_locale_from_utf8(*group);
+
+		if (! utils_str_equal(*group, PLUGIN_CACHE_GROUP) &&
+			! g_file_test(locale_name, G_FILE_TEST_EXISTS))
+			g_key_file_remove_group(plugin_cache, *group, NULL);
+		g_free(locale_name);
+	}
+	g_strfreev(groups);
+
+	g_key_file_set_integer(plugin_cache, PLUGIN_CACHE_GROUP, "abi", GEANY_ABI_VERSION);
+	g_key_file_set_integer(plugin_cache, PLUGIN_CACHE_GROUP, "api", GEANY_API_VERSION);
+	g_key_file_set_string(plugin_cache, PLUGIN_CACHE_GROUP, "language", g_get_language_names()[0]);
+
+	fname = get_plugin_cache_filename();
+	data = g_key_file_to_data(plugin_cache, NULL, NULL);
+	configuration_write_file(fname, data);
+	g_free(fname);
+	plugin_cache_changed = FALSE;
+}
+
+
 /* Load and optionally init a plugin.
  * load_plugin decides whether the plugin's plugin_init() function should be called or not. If it is
  * called, the plugin will be started, if not the plugin will be read only (for the list of
- * available plugins in the plugin manager).
+ * available plugins in the plugin manager, which may then only read its info from the cache).
  * When add_to_list is set, the plugin will be added to the plugin manager's plugin_list. */
 static Plugin*
 plugin_new(Plugin *proxy, const gchar *fname, gboolean load_plugin, gboolean add_to_list)
@@ -651,6 +830,14 @@ plugin_new(Plugin *proxy, const gchar *fname, gboolean load_plugin, gboolean add
 		goto err;
 	}
 
+	/* a plugin which isn't started only needs its info */
+	if (! load_plugin && plugin_cache_lookup(plugin))
+	{
+		if (add_to_list)
+			plugin_list = g_list_prepend(plugin_list, plugin);
+		return plugin;
+	}
+
 	/* Load plugin, this should read its name etc. It must also call
 	 * geany_plugin_register() for the following PLUGIN_LOADED_OK condition */
 	plugin->proxy_data = proxy->proxy_cbs.load(&proxy->public, &plugin->public, fname, proxy->cb_data);
@@ -687,6 +874,7 @@ plugin_new(Plugin *proxy, const gchar *fname, gboolean load_plugin, gboolean add
 		goto err_unload;
 	}
 
+	plugin_cache_store(plugin);
 	if (add_to_list)
 		plugin_list = g_list_prepend(plugin_list, plugin);
 
@@ -938,10 +1126,15 @@ plugin_free(Plugin *plugin)
 	active_plugin_list = g_list_remove(active_plugin_list, plugin);
 	plugin_list = g_list_remove(plugin_list, plugin);
 
-	/* cb_data_destroy might be plugin code and must be called before unloading the module. */
-	if (plugin->cb_data_destroy)
-		plugin->cb_data_destroy(plugin->cb_data);
-	proxy->proxy_cbs.unload(&proxy->public, &plugin->public, plugin->proxy_data, proxy->cb_data);
+	if (PLUGIN_IS_CACHED(plugin))
+		g_strfreev(plugin->cached_info);
+	else
+	{
+		/* cb_data_destroy might be plugin code and must be called before unloading the module. */
+		if (plugin->cb_data_destroy)
+			plugin->cb_data_destroy(plugin->cb_data);
+		proxy->proxy_cbs.unload(&proxy->public, &plugin->public, plugin->proxy_data, proxy->cb_data);
+	}
 
 	g_free(plugin->filename);
 	g_free(plugin);
@@ -1050,11 +1243,43 @@ static PluginProxy* is_plugin(const gchar *file)
 }
 
 
-/* load active plugins at startup */
+/* Whether the plugin file name is listed in the deferred_plugins pref, with or without
+ * its extension */
+static gboolean is_deferred_plugin(const gchar *fname)
+{
+	gchar **names, **name;
+	gchar *base;
+	gsize base_len;
+	gboolean found = FALSE;
+
+	if (EMPTY(deferred_plugins_pref))
+		return FALSE;
+
+	base = g_path_get_basename(fname);
+	base_len = strcspn(base, ".");
+	names = g_strsplit(deferred_plugins_pref, ";", -1);
+	foreach_strv(name, names)
+	{
+		g_strstrip(*name);
+		if (utils_str_equal(*name, base) ||
+			(strlen(*name) == base_len && strncmp(*name, base, base_len) == 0))
+		{
+			found = TRUE;
+			break;
+		}
+	}
+	g_strfreev(names);
+	g_free(base);
+	return found;
+}
+
+
+/* load the active plugins at startup, either the deferred ones or the others */
 static void
-load_active_plugins(void)
+load_active_plugins(gboolean deferred)
 {
 	guint i, len, proxies;
+	GList *failed = NULL;
 
 	if (active_plugins_pref == NULL || (len = g_strv_length(active_plugins_pref)) == 0)
 		return;
@@ -1063,12 +1288,15 @@ load_active_plugins(void)
 	do
 	{
 		proxies = active_proxies.length;
-		g_list_free_full(failed_plugins_list, (GDestroyNotify) g_free);
-		failed_plugins_list = NULL;
+		g_list_free_full(failed, (GDestroyNotify) g_free);
+		failed = NULL;
 		for (i = 0; i < len; i++)
 		{
 			gchar *fname = active_plugins_pref[i];
 
+			if (EMPTY(fname) || is_deferred_plugin(fname) != deferred)
+				continue;
+
 #ifdef G_OS_WIN32
 			/* ensure we have canonical paths */
 			gchar *p = fname;
@@ -1082,10 +1310,13 @@ load_active_plugins(void)
 				if (check_plugin_path(fname))
 					proxy = is_plugin(fname);
 				if (proxy == NULL || plugin_new(proxy->plugin, fname, TRUE, FALSE) == NULL)
-					failed_plugins_list = g_list_prepend(failed_plugins_list, g_strdup(fname));
+					failed = g_list_prepend(failed, g_strdup(fname));
+				main_profile_startup("plugin %s", fname);
 			}
 		}
 	} while (proxies != active_proxies.length);
+
+	failed_plugins_list = g_list_concat(failed, failed_plugins_list);
 }
 
 
@@ -1226,7 +1457,28 @@ void plugins_load_active(void)
 	gtk_container_add(GTK_CONTAINER(main_widgets.tools_menu), menu_separator);
 	g_signal_connect(main_widgets.tools_menu, "show", G_CALLBACK(on_tools_menu_show), NULL);
 
-	load_active_plugins();
+	load_active_plugins(FALSE);
+}
+
+
+/* Whether some active plugins are to be loaded by plugins_load_deferred() */
+gboolean plugins_have_deferred(void)
+{
+	gchar **fname;
+
+	foreach_strv(fname, active_plugins_pref)
+	{
+		if (! EMPTY(*fname) && is_deferred_plugin(*fname))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+/* Loads the active plugins listed in the deferred_plugins pref, after plugins_load_active() */
+void plugins_load_deferred(void)
+{
+	load_active_plugins(TRUE);
 }
 
 
@@ -1293,6 +1545,10 @@ void plugins_init(void)
 	g_signal_connect(geany_object, "save-settings", G_CALLBACK(update_active_plugins_pref), NULL);
 	stash_group_add_string_vector(group, &active_plugins_pref, "active_plugins", NULL);
 
+	group = stash_group_new(PACKAGE);
+	configuration_add_various_pref_group(group, "plugins");
+	stash_group_add_string(group, &deferred_plugins_pref, "deferred_plugins", "");
+
 	g_queue_push_head(&active_proxies, &builtin_so_proxy);
 }
 
@@ -1319,7 +1575,12 @@ void plugins_finalize(void)
 	while (active_plugin_list != NULL)
 		g_list_foreach(active_plugin_list, (GFunc) plugin_free_leaf, NULL);
 
+	plugin_cache_save();
+	if (plugin_cache)
+		g_key_file_free(plugin_cache);
+
 	g_strfreev(active_plugins_pref);
+	g_free(deferred_plugins_pref);
 }
 
 
@@ -1855,6 +2116,7 @@ static void pm_dialog_response(GtkDialog *dialog, gint response, gpointer user_d
 			gtk_widget_destroy(GTK_WIDGET(dialog));
 			pm_widgets.dialog = NULL;
 
+			plugin_cache_save();
 			configuration_save();
 			break;
 		case PM_BUTTON_CONFIGURE:
@@ -37,6 +37,10 @@ void plugins_finalize(void);
 
 void plugins_load_active(void);
 
+gboolean plugins_have_deferred(void);
+
+void plugins_load_deferred(void);
+
 gboolean plugins_have_preferences(void);
 
 G_END_DECLS
@@ -82,6 +82,9 @@ typedef struct
 static GtkPrintSettings *settings = NULL;
 static GtkPageSetup *page_setup = NULL;
 
+/* how long paginate() may work before returning to the main loop, in microseconds */
+#define PAGINATE_TIME_SLICE 50000
+
 
 
 /* creates a commonly used layout object from the given context for use in get_page_count and
@@ -406,20 +409,30 @@ static gint format_range(DocInfo *dinfo, gboolean draw)
 }
 
 
+/* Finds the page breaks once, they are used by draw_page() for printing as well as for the
+ * preview. As many pages as fit into PAGINATE_TIME_SLICE are done per call so large documents
+ * don't need a main loop iteration per page. */
 static gboolean paginate(GtkPrintOperation *operation, GtkPrintContext *context, gpointer user_data)
 {
 	DocInfo *dinfo = user_data;
+	gint64 start = g_get_monotonic_time();
 
 	/* for whatever reason we get called one more time after we returned TRUE, so avoid adding
 	 * an empty page at the end */
 	if (dinfo->fr.chrg.cpMin >= dinfo->fr.chrg.cpMax)
 		return TRUE;
 
-	gtk_progress_bar_pulse(GTK_PROGRESS_BAR(main_widgets.progressbar));
-	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(main_widgets.progressbar), _("Paginating"));
+	do
+	{
+		g_array_append_val(dinfo->pages, dinfo->fr.chrg.cpMin);
+		dinfo->fr.chrg.cpMin = format_range(dinfo, FALSE);
+	}
+	while (dinfo->fr.chrg.cpMin < dinfo->fr.chrg.cpMax &&
+		g_get_monotonic_time() - start < PAGINATE_TIME_SLICE);
 
-	g_array_append_val(dinfo->pages, dinfo->fr.chrg.cpMin);
-	dinfo->fr.chrg.cpMin = format_range(dinfo, FALSE);
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(main_widgets.progressbar),
+		dinfo->fr.chrg.cpMin / (gdouble) MAX(dinfo->fr.chrg.cpMax, 1));
+	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(main_widgets.progressbar), _("Paginating"));
 
 	gtk_print_operation_set_n_pages(operation, dinfo->pages->len);
 
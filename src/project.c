@@ -81,7 +81,7 @@ typedef struct _PropertyDialogElements
 static gboolean update_config(const PropertyDialogElements *e, gboolean new_project);
 static void on_file_save_button_clicked(GtkButton *button, PropertyDialogElements *e);
 static gboolean load_config(const gchar *filename);
-static gboolean write_config(void);
+static gboolean write_config(gboolean queue);
 static void update_new_project_dlg(GtkEditable *editable, PropertyDialogElements *e,
 	const gchar *base_p);
 static void on_name_entry_changed(GtkEditable *editable, PropertyDialogElements *e);
@@ -272,7 +272,7 @@ static void run_new_dialog(PropertyDialogElements *e)
 		if (update_config(e, TRUE))
 		{
 			// app->project is now set
-			if (!write_config())
+			if (!write_config(FALSE))
 			{
 				SHOW_ERR(_("Project file could not be written"));
 				destroy_project(FALSE);
@@ -416,7 +416,7 @@ gboolean project_close(gboolean open_default)
 	g_return_val_if_fail(app->project != NULL, FALSE);
 
 	/* save project session files, etc */
-	if (!write_config())
+	if (!write_config(TRUE))
 		g_warning("Project file \"%s\" could not be written", app->project->file_name);
 
 	/* close all existing tabs first */
@@ -435,7 +435,7 @@ static void destroy_project(gboolean open_default)
 
 	g_return_if_fail(app->project != NULL);
 
-	g_signal_emit_by_name(geany_object, "project-before-close");
+	geany_object_emit("project-before-close");
 
 	/* remove project filetypes build entries */
 	if (app->project->priv->build_filetypes_list != NULL)
@@ -473,7 +473,7 @@ static void destroy_project(gboolean open_default)
 		document_new_file_if_non_open();
 		ui_focus_current_document();
 	}
-	g_signal_emit_by_name(geany_object, "project-close");
+	geany_object_emit("project-close");
 
 	update_ui();
 }
@@ -612,7 +612,7 @@ static void show_project_properties(gboolean show_build)
 	gtk_entry_set_text(GTK_ENTRY(e.patterns), entry_text);
 	g_free(entry_text);
 
-	g_signal_emit_by_name(geany_object, "project-dialog-open", e.notebook);
+	geany_object_emit("project-dialog-open", e.notebook);
 	gtk_widget_show_all(e.dialog);
 
 	/* note: notebook page must be shown before setting current page */
@@ -625,8 +625,8 @@ static void show_project_properties(gboolean show_build)
 	{
 		if (update_config(&e, FALSE))
 		{
-			g_signal_emit_by_name(geany_object, "project-dialog-confirmed", e.notebook);
-			if (!write_config())
+			geany_object_emit("project-dialog-confirmed", e.notebook);
+			if (!write_config(FALSE))
 				SHOW_ERR(_("Project file could not be written"));
 			else
 			{
@@ -637,7 +637,7 @@ static void show_project_properties(gboolean show_build)
 	}
 
 	build_free_fields(e.build_properties);
-	g_signal_emit_by_name(geany_object, "project-dialog-close", e.notebook);
+	geany_object_emit("project-dialog-close", e.notebook);
 	gtk_notebook_remove_page(GTK_NOTEBOOK(e.notebook), e.build_page_num);
 	gtk_widget_hide(e.dialog);
 }
@@ -1073,7 +1073,7 @@ static gboolean load_config(const gchar *filename)
 	g_return_val_if_fail(app->project == NULL && filename != NULL, FALSE);
 
 	config = g_key_file_new();
-	if (! g_key_file_load_from_file(config, filename, G_KEY_FILE_NONE, NULL))
+	if (! configuration_load_file(config, filename))
 	{
 		g_key_file_free(config);
 		return FALSE;
@@ -1106,7 +1106,7 @@ static gboolean load_config(const gchar *filename)
 	}
 	/* read session files so they can be opened with configuration_open_files() */
 	p->priv->session_files = configuration_load_session_files(config);
-	g_signal_emit_by_name(geany_object, "project-open", config);
+	geany_object_emit("project-open", config);
 	g_key_file_free(config);
 
 	update_ui();
@@ -1124,8 +1124,9 @@ static void apply_editor_prefs(void)
 
 
 /* Write the project settings as well as the project session files into its configuration files.
- * Returns: TRUE if project file was written successfully. */
-static gboolean write_config(void)
+ * With queue set the file is written in the background and errors are shown in the status bar.
+ * Returns: TRUE if project file was written successfully (or queued). */
+static gboolean write_config(gboolean queue)
 {
 	GeanyProject *p;
 	GKeyFile *config;
@@ -1141,7 +1142,7 @@ static gboolean write_config(void)
 	config = g_key_file_new();
 	/* try to load an existing config to keep manually added comments */
 	filename = utils_get_locale_from_utf8(p->file_name);
-	g_key_file_load_from_file(config, filename, G_KEY_FILE_NONE, NULL);
+	configuration_load_file(config, filename);
 
 	foreach_slist(node, stash_groups)
 		stash_group_save_to_key_file(node->data, config);
@@ -1162,12 +1163,20 @@ static gboolean write_config(void)
 	/* store the session files into the project too */
 	configuration_save_session_files(config);
 	build_save_menu(config, (gpointer)p, GEANY_BCS_PROJ);
-	g_signal_emit_by_name(geany_object, "project-save", config);
+	geany_object_emit("project-save", config);
 	/* write the file */
 	data = g_key_file_to_data(config, NULL, NULL);
-	ret = (utils_write_file(filename, data) == 0);
+	if (queue)
+	{
+		configuration_write_file(filename, data);
+		ret = TRUE;
+	}
+	else
+	{
+		ret = configuration_write_file_now(filename, data);
+		g_free(data);
+	}
 
-	g_free(data);
 	g_free(filename);
 	g_key_file_free(config);
 
@@ -1183,11 +1192,19 @@ static gboolean write_config(void)
 GEANY_API_SYMBOL
 void project_write_config(void)
 {
-	if (!write_config())
+	if (!write_config(FALSE))
 		SHOW_ERR(_("Project file could not be written"));
 }
 
 
+/* Like project_write_config() but writes the file in the background, for the
+ * automatic session saving. */
+void project_queue_write_config(void)
+{
+	write_config(TRUE);
+}
+
+
 /* Constructs the project's base path which is used for "Make all" and "Execute".
  * The result is an absolute string in UTF-8 encoding which is either the same as
  * base path if it is absolute or it is built out of project file name's dir and base_path.
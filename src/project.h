@@ -72,6 +72,8 @@ void project_open(void);
 
 gboolean project_close(gboolean open_default);
 
+void project_queue_write_config(void);
+
 void project_properties(void);
 
 void project_build_properties(void);
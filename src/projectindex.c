@@ -0,0 +1,482 @@
+/*
+ *      projectindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2023 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Indexing of all project files so symbols from files which aren't open can be
+ * used for goto and autocompletion.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "projectindex.h"
+
+#include "app.h"
+#include "document.h"
+#include "filetypes.h"
+#include "geanyobject.h"
+#include "main.h"
+#include "project.h"
+#include "support.h"
+#include "ui_utils.h"
+#include "utils.h"
+
+#include "tm_source_file.h"
+#include "tm_workspace.h"
+
+#include <gtk/gtk.h>
+
+
+/* the maximum time spent in a single idle callback, in microseconds */
+#define INDEX_TIME_SLICE 20000
+
+
+typedef struct
+{
+	GQueue dirs;			/* locale paths of directories not scanned yet */
+	GQueue files;			/* locale paths of files not parsed yet */
+	GPtrArray *parsed;		/* parsed TMSourceFiles not added to the workspace yet */
+	GPatternSpec **patterns;
+	guint total;
+	guint done;
+	guint source_id;
+} IndexState;
+
+
+static IndexState *index_state = NULL;
+/* TMSourceFile::file_name -> TMSourceFile of indexed files; NULL for files open
+ * as documents which maintain the file's tags themselves */
+static GHashTable *indexed_files = NULL;
+static GtkWidget *index_menu_item = NULL;
+
+
+static void update_menu_item(void)
+{
+	gtk_menu_item_set_label(GTK_MENU_ITEM(index_menu_item),
+		index_state ? _("Cancel _Indexing") : _("_Index Project Files"));
+	gtk_widget_set_sensitive(index_menu_item, app->project != NULL);
+}
+
+
+static void update_progress(void)
+{
+	gchar *text;
+
+	if (index_state->total == 0)
+		text = g_strdup(_("Scanning project files"));
+	else
+	{
+		text = g_strdup_printf(_("Indexing project files (%u/%u)"),
+			index_state->done, index_state->total);
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(main_widgets.progressbar),
+			(gdouble) index_state->done / index_state->total);
+	}
+	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(main_widgets.progressbar), text);
+	g_free(text);
+}
+
+
+static GeanyFiletype *get_indexed_filetype(const gchar *locale_path)
+{
+	gchar *utf8_path = utils_get_utf8_from_locale(locale_path);
+	GeanyFiletype *ft = NULL;
+	gboolean matches = TRUE;
+
+	if (index_state->patterns)
+	{
+		gchar *base_name = g_path_get_basename(utf8_path);
+		GPatternSpec **pattern;
+
+		matches = FALSE;
+		for (pattern = index_state->patterns; *pattern && !matches; pattern++)
+			matches = g_pattern_match_string(*pattern, base_name);
+		g_free(base_name);
+	}
+
+	if (matches)
+	{
+		ft = filetypes_detect_from_extension(utf8_path);
+		if (!filetype_has_tags(ft))
+			ft = NULL;
+	}
+
+	g_free(utf8_path);
+	return ft;
+}
+
+
+static void scan_dir(const gchar *locale_dir)
+{
+	GDir *dir = g_dir_open(locale_dir, 0, NULL);
+	const gchar *name;
+
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name(dir)))
+	{
+		gchar *path;
+
+		/* skip .git and similar */
+		if (name[0] == '.')
+			continue;
+
+		path = g_build_filename(locale_dir, name, NULL);
+
+		/* don't follow symlinked directories which might create loops */
+		if (g_file_test(path, G_FILE_TEST_IS_DIR))
+		{
+			if (!g_file_test(path, G_FILE_TEST_IS_SYMLINK))
+			{
+				g_queue_push_tail(&index_state->dirs, path);
+				path = NULL;
+			}
+		}
+		else if (get_indexed_filetype(path))
+		{
+			g_queue_push_tail(&index_state->files, path);
+			path = NULL;
+			index_state->total++;
+		}
+
+		g_free(path);
+	}
+
+	g_dir_close(dir);
+}
+
+
+/* Adds the source file for locale_path to batch to be parsed. */
+static void add_file(GPtrArray *batch, const gchar *locale_path)
+{
+	GeanyFiletype *ft = get_indexed_filetype(locale_path);
+	TMSourceFile *source_file;
+
+	if (!ft)
+		return;
+
+	source_file = tm_source_file_new(locale_path, tm_source_file_get_lang_name(ft->lang));
+	if (!source_file)
+		return;
+
+	if (document_find_by_real_path(source_file->file_name))
+	{
+		g_hash_table_insert(indexed_files, g_strdup(source_file->file_name), NULL);
+		tm_source_file_free(source_file);
+		return;
+	}
+
+	g_ptr_array_add(batch, source_file);
+}
+
+
+/* Parses up to as many files at once as the tag manager parses at the same time. */
+static void parse_files(void)
+{
+	GPtrArray *batch = g_ptr_array_new();
+	guint jobs = tm_workspace_get_parse_jobs();
+	guint i;
+	gchar *path;
+
+	while (batch->len < jobs && (path = g_queue_pop_head(&index_state->files)))
+	{
+		add_file(batch, path);
+		index_state->done++;
+		g_free(path);
+	}
+
+	tm_workspace_parse_source_files_noupdate(batch);
+	for (i = 0; i < batch->len; i++)
+		g_ptr_array_add(index_state->parsed, batch->pdata[i]);
+	g_ptr_array_free(batch, TRUE);
+}
+
+
+static void free_index_state(void)
+{
+	guint i;
+
+	if (index_state->source_id)
+		g_source_remove(index_state->source_id);
+
+	g_queue_foreach(&index_state->dirs, (GFunc) g_free, NULL);
+	g_queue_clear(&index_state->dirs);
+	g_queue_foreach(&index_state->files, (GFunc) g_free, NULL);
+	g_queue_clear(&index_state->files);
+
+	/* the files left here were never added to the workspace */
+	for (i = 0; i < index_state->parsed->len; i++)
+		tm_source_file_free(index_state->parsed->pdata[i]);
+	g_ptr_array_free(index_state->parsed, TRUE);
+
+	if (index_state->patterns)
+	{
+		GPatternSpec **pattern;
+
+		for (pattern = index_state->patterns; *pattern; pattern++)
+			g_pattern_spec_free(*pattern);
+		g_free(index_state->patterns);
+	}
+
+	g_free(index_state);
+	index_state = NULL;
+
+	gtk_widget_hide(main_widgets.progressbar);
+	update_menu_item();
+}
+
+
+static void finish_indexing(void)
+{
+	GPtrArray *added = g_ptr_array_new();
+	guint i;
+
+	for (i = 0; i < index_state->parsed->len; i++)
+	{
+		TMSourceFile *source_file = index_state->parsed->pdata[i];
+
+		/* opened while indexing */
+		if (document_find_by_real_path(source_file->file_name))
+		{
+			g_hash_table_insert(indexed_files, g_strdup(source_file->file_name), NULL);
+			tm_source_file_free(source_file);
+		}
+		else
+		{
+			g_hash_table_insert(indexed_files, g_strdup(source_file->file_name), source_file);
+			g_ptr_array_add(added, source_file);
+		}
+	}
+	g_ptr_array_set_size(index_state->parsed, 0);
+
+	/* a single rebuild of the workspace tag arrays for all the files */
+	tm_workspace_add_parsed_source_files(added);
+
+	ui_set_statusbar(TRUE, _("Indexed %u project files."), added->len);
+	g_ptr_array_free(added, TRUE);
+}
+
+
+static gboolean index_cb(gpointer data)
+{
+	gint64 end_time = g_get_monotonic_time() + INDEX_TIME_SLICE;
+
+	do
+	{
+		gchar *path;
+
+		/* all the directories are scanned first so the total is known */
+		if ((path = g_queue_pop_head(&index_state->dirs)))
+		{
+			scan_dir(path);
+			g_free(path);
+		}
+		else if (!g_queue_is_empty(&index_state->files))
+			parse_files();
+		else
+		{
+			finish_indexing();
+			index_state->source_id = 0;
+			free_index_state();
+			return G_SOURCE_REMOVE;
+		}
+	}
+	while (g_get_monotonic_time() < end_time);
+
+	update_progress();
+	return G_SOURCE_CONTINUE;
+}
+
+
+static void remove_indexed_files(void)
+{
+	GHashTableIter iter;
+	GPtrArray *files;
+	gpointer value;
+	guint i;
+
+	if (!indexed_files)
+		return;
+
+	files = g_ptr_array_new();
+	g_hash_table_iter_init(&iter, indexed_files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		if (value)
+			g_ptr_array_add(files, value);
+	}
+
+	tm_workspace_remove_source_files(files);
+	for (i = 0; i < files->len; i++)
+		tm_source_file_free(files->pdata[i]);
+	g_ptr_array_free(files, TRUE);
+
+	g_hash_table_remove_all(indexed_files);
+}
+
+
+void project_index_cancel(void)
+{
+	if (index_state)
+	{
+		free_index_state();
+		ui_set_statusbar(TRUE, _("Indexing of project files cancelled."));
+	}
+}
+
+
+void project_index_start(void)
+{
+	gchar *base_path;
+
+	if (!app->project)
+		return;
+
+	project_index_cancel();
+	remove_indexed_files();
+
+	base_path = project_get_base_path();
+	if (!base_path)
+		return;
+
+	index_state = g_new0(IndexState, 1);
+	index_state->parsed = g_ptr_array_new();
+	g_queue_push_tail(&index_state->dirs, utils_get_locale_from_utf8(base_path));
+	g_free(base_path);
+
+	if (app->project->file_patterns && app->project->file_patterns[0])
+	{
+		guint len = g_strv_length(app->project->file_patterns);
+		guint i;
+
+		index_state->patterns = g_new0(GPatternSpec *, len + 1);
+		for (i = 0; i < len; i++)
+			index_state->patterns[i] = g_pattern_spec_new(app->project->file_patterns[i]);
+	}
+
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(main_widgets.progressbar), 0.0);
+	gtk_widget_show(main_widgets.progressbar);
+	update_progress();
+	update_menu_item();
+
+	index_state->source_id = g_idle_add_full(G_PRIORITY_LOW, index_cb, NULL, NULL);
+}
+
+
+static void on_index_activate(GtkMenuItem *menuitem, gpointer user_data)
+{
+	if (index_state)
+		project_index_cancel();
+	else
+		project_index_start();
+}
+
+
+/* the document takes over the tags of the file */
+static void on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	TMSourceFile *source_file;
+
+	if (!indexed_files || !doc->real_path)
+		return;
+
+	source_file = g_hash_table_lookup(indexed_files, doc->real_path);
+	if (source_file)
+	{
+		tm_workspace_remove_source_file(source_file);
+		tm_source_file_free(source_file);
+		g_hash_table_insert(indexed_files, g_strdup(doc->real_path), NULL);
+	}
+}
+
+
+/* reindex the file from disk once it's closed */
+static void on_document_close(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	GeanyFiletype *ft = doc->file_type;
+	gpointer key, value;
+	TMSourceFile *source_file;
+
+	if (!indexed_files || !doc->real_path || main_status.closing_all || main_status.quitting)
+		return;
+
+	if (!g_hash_table_lookup_extended(indexed_files, doc->real_path, &key, &value) || value)
+		return;
+
+	if (!filetype_has_tags(ft))
+		return;
+
+	source_file = tm_source_file_new(doc->real_path, tm_source_file_get_lang_name(ft->lang));
+	if (source_file)
+	{
+		tm_workspace_add_source_file(source_file);
+		g_hash_table_insert(indexed_files, g_strdup(doc->real_path), source_file);
+	}
+}
+
+
+static void on_project_close(GObject *obj, gpointer user_data)
+{
+	project_index_cancel();
+	remove_indexed_files();
+	update_menu_item();
+}
+
+
+static void on_project_open(GObject *obj, GKeyFile *config, gpointer user_data)
+{
+	on_project_close(obj, user_data);
+}
+
+
+void project_index_init(void)
+{
+	GtkWidget *menu = ui_lookup_widget(main_widgets.window, "menu_project1_menu");
+	GtkWidget *item = ui_lookup_widget(main_widgets.window, "reset_indentation1");
+	GList *children = gtk_container_get_children(GTK_CONTAINER(menu));
+
+	indexed_files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	index_menu_item = gtk_menu_item_new_with_mnemonic(_("_Index Project Files"));
+	gtk_widget_set_tooltip_text(index_menu_item,
+		_("Parse all project files so their symbols can be used for goto and autocompletion"));
+	gtk_menu_shell_insert(GTK_MENU_SHELL(menu), index_menu_item,
+		g_list_index(children, item) + 1);
+	gtk_widget_show(index_menu_item);
+	g_signal_connect(index_menu_item, "activate", G_CALLBACK(on_index_activate), NULL);
+	g_list_free(children);
+	update_menu_item();
+
+	g_signal_connect(geany_object, "document-open", G_CALLBACK(on_document_open), NULL);
+	g_signal_connect(geany_object, "document-close", G_CALLBACK(on_document_close), NULL);
+	g_signal_connect(geany_object, "project-open", G_CALLBACK(on_project_open), NULL);
+	g_signal_connect(geany_object, "project-close", G_CALLBACK(on_project_close), NULL);
+}
+
+
+void project_index_finalize(void)
+{
+	if (index_state)
+		free_index_state();
+	remove_indexed_files();
+	g_hash_table_destroy(indexed_files);
+	indexed_files = NULL;
+}
@@ -696,6 +696,7 @@ gint sci_get_lexer(ScintillaObject *sci)
 }
 
 
+GEANY_EXPORT_SYMBOL
 void sci_set_lexer(ScintillaObject *sci, guint lexer_id)
 {
 	gint old = sci_get_lexer(sci);
@@ -898,6 +899,7 @@ gboolean sci_get_fold_expanded(ScintillaObject *sci, gint line)
 }
 
 
+GEANY_EXPORT_SYMBOL
 void sci_colourise(ScintillaObject *sci, gint start, gint end)
 {
 	SSM(sci, SCI_COLOURISE, (uptr_t) start, end);
@@ -916,6 +918,13 @@ gint sci_get_end_styled(ScintillaObject *sci)
 }
 
 
+/* Makes the text from pos on styled again when it's needed */
+void sci_start_styling(ScintillaObject *sci, gint pos)
+{
+	SSM(sci, SCI_STARTSTYLING, (uptr_t) pos, 0);
+}
+
+
 void sci_set_tab_width(ScintillaObject *sci, gint width)
 {
 	SSM(sci, SCI_SETTABWIDTH, (uptr_t) width, 0);
@@ -1108,6 +1117,7 @@ gint sci_get_style_at(ScintillaObject *sci, gint position)
 }
 
 
+GEANY_EXPORT_SYMBOL
 void sci_set_codepage(ScintillaObject *sci, gint cp)
 {
 	g_return_if_fail(cp == 0 || cp == SC_CP_UTF8);
@@ -1217,6 +1227,24 @@ void sci_set_keywords(ScintillaObject *sci, guint k, const gchar *text)
 }
 
 
+/* Private lexer calls adding or removing the words of keyword set k without
+ * setting it again, see privateCallAddKeywords in LexCPP.cxx.
+ * Return FALSE if the lexer doesn't support them. */
+#define LEXER_ADD_KEYWORDS 0x1000
+#define LEXER_REMOVE_KEYWORDS 0x2000
+
+gboolean sci_add_keywords(ScintillaObject *sci, guint k, const gchar *words)
+{
+	return SSM(sci, SCI_PRIVATELEXERCALL, LEXER_ADD_KEYWORDS | k, (sptr_t) words) != 0;
+}
+
+
+gboolean sci_remove_keywords(ScintillaObject *sci, guint k, const gchar *words)
+{
+	return SSM(sci, SCI_PRIVATELEXERCALL, LEXER_REMOVE_KEYWORDS | k, (sptr_t) words) != 0;
+}
+
+
 void sci_set_readonly(ScintillaObject *sci, gboolean readonly)
 {
 	SSM(sci, SCI_SETREADONLY, readonly != FALSE, 0);
@@ -1316,6 +1344,7 @@ void sci_indicator_clear(ScintillaObject *sci, gint pos, gint len)
 }
 
 
+GEANY_EXPORT_SYMBOL
 void sci_select_all(ScintillaObject *sci)
 {
 	SSM(sci, SCI_SELECTALL, 0, 0);
@@ -1451,6 +1480,18 @@ void sci_set_scroll_stop_at_last_line(ScintillaObject *sci, gboolean set)
 }
 
 
+void sci_set_idle_styling(ScintillaObject *sci, gint mode)
+{
+	SSM(sci, SCI_SETIDLESTYLING, (uptr_t) mode, 0);
+}
+
+
+void sci_set_layout_threads(ScintillaObject *sci, gint threads)
+{
+	SSM(sci, SCI_SETLAYOUTTHREADS, (uptr_t) threads, 0);
+}
+
+
 void sci_cancel(ScintillaObject *sci)
 {
 	SSM(sci, SCI_CANCEL, 0, 0);
@@ -165,6 +165,7 @@ gboolean			sci_get_fold_expanded		(ScintillaObject *sci, gint line);
 void				sci_colourise				(ScintillaObject *sci, gint start, gint end);
 void				sci_clear_all				(ScintillaObject *sci);
 gint				sci_get_end_styled			(ScintillaObject *sci);
+void				sci_start_styling			(ScintillaObject *sci, gint pos);
 void				sci_set_tab_width			(ScintillaObject *sci, gint width);
 void				sci_set_savepoint			(ScintillaObject *sci);
 void				sci_set_indentation_guides	(ScintillaObject *sci, gint mode);
@@ -184,6 +185,8 @@ void				sci_selection_duplicate		(ScintillaObject *sci);
 void				sci_line_duplicate			(ScintillaObject *sci);
 
 void				sci_set_keywords			(ScintillaObject *sci, guint k, const gchar *text);
+gboolean			sci_add_keywords			(ScintillaObject *sci, guint k, const gchar *words);
+gboolean			sci_remove_keywords			(ScintillaObject *sci, guint k, const gchar *words);
 void				sci_set_lexer				(ScintillaObject *sci, guint lexer_id);
 void				sci_set_readonly			(ScintillaObject *sci, gboolean readonly);
 
@@ -206,6 +209,9 @@ void				sci_set_caret_policy_y		(ScintillaObject *sci, gint policy, gint slop);
 
 void				sci_set_scroll_stop_at_last_line	(ScintillaObject *sci, gboolean set);
 
+void				sci_set_idle_styling		(ScintillaObject *sci, gint mode);
+void				sci_set_layout_threads		(ScintillaObject *sci, gint threads);
+
 void				sci_cancel					(ScintillaObject *sci);
 
 gint				sci_get_position_after		(ScintillaObject *sci, gint start);
@@ -51,6 +51,8 @@
 
 #include <gtk/gtk.h>
 #include <gdk/gdkkeysyms.h>
+/* gstdio.h also includes sys/stat.h */
+#include <glib/gstdio.h>
 
 enum
 {
@@ -79,6 +81,21 @@ GeanySearchData search_data;
 GeanySearchPrefs search_prefs;
 
 
+/* a document searched by search_documents() */
+typedef struct SessionSearch
+{
+	GeanyDocument *doc;
+	/* SCI_GETCHARACTERPOINTER of the document, it stays valid as the documents
+	 * aren't touched before all searches are done */
+	const gchar *text;
+	gint len;
+	GRegex *regex;
+	gboolean whole_text;	/* match against the whole text rather than line by line */
+	GArray *lines;			/* the lines with matches */
+	gint count;				/* number of matches */
+} SessionSearch;
+
+
 static struct
 {
 	gboolean fif_regexp;
@@ -151,10 +168,22 @@ static void search_read_io(GString *string, GIOCondition condition, gpointer dat
 static void search_read_io_stderr(GString *string, GIOCondition condition, gpointer data);
 
 static void search_finished(GPid child_pid, gint status, gpointer user_data);
+static void show_fif_result(gint exit_status);
+
+static gboolean builtin_find_in_files(const gchar *search_text, const gchar *utf8_search_text,
+	const gchar *dir, const gchar *utf8_dir, const gchar *enc);
+static void cancel_builtin_find_in_files(void);
 
 static gchar **search_get_argv(const gchar **argv_prefix, const gchar *dir);
 
 static GRegex *compile_regex(const gchar *str, GeanyFindFlags sflags);
+static gchar *get_regex_required_literal(const gchar *pattern);
+static GPtrArray *search_documents(GPtrArray *docs, const gchar *search_text, GeanyFindFlags flags);
+static void session_searches_free(GPtrArray *searches);
+static gint find_regex(ScintillaObject *sci, guint pos, gint end, GRegex *regex, gboolean multiline,
+		GeanyMatchInfo *match);
+static gint geany_find_flags_to_sci_flags(GeanyFindFlags flags);
+static void cancel_mark_all(void);
 
 
 static void
@@ -291,6 +320,8 @@ void search_finalize(void)
 	FREE_WIDGET(find_dlg.dialog);
 	FREE_WIDGET(replace_dlg.dialog);
 	FREE_WIDGET(fif_dlg.dialog);
+	cancel_builtin_find_in_files();
+	cancel_mark_all();
 	g_free(search_data.text);
 	g_free(search_data.original_text);
 }
@@ -1230,38 +1261,222 @@ static GSList *find_range(ScintillaObject *sci, GeanyFindFlags flags, struct Sci
 }
 
 
+/* Like find_range() but only returns the positions of the matches, as an array of
+ * struct Sci_CharacterRange. */
+static GArray *find_range_positions(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_TextToFind *ttf)
+{
+	GArray *ranges = g_array_new(FALSE, FALSE, sizeof(struct Sci_CharacterRange));
+	GeanyMatchInfo *match = NULL;
+	GRegex *regex = NULL;
+
+	if (flags & GEANY_FIND_REGEXP)
+	{
+		/* compile the regex only once rather than for each match */
+		regex = compile_regex(ttf->lpstrText, flags);
+		if (!regex)
+			return ranges;
+		match = match_info_new(flags, 0, 0);
+	}
+
+	while (ttf->chrg.cpMin <= ttf->chrg.cpMax)
+	{
+		gint ret;
+
+		if (regex)
+		{
+			ret = find_regex(sci, ttf->chrg.cpMin, ttf->chrg.cpMax, regex,
+				flags & GEANY_FIND_MULTILINE, match);
+			if (ret >= ttf->chrg.cpMax)
+				ret = -1;
+			else if (ret >= 0)
+			{
+				ttf->chrgText.cpMin = match->start;
+				ttf->chrgText.cpMax = match->end;
+			}
+		}
+		else
+			ret = sci_find_text(sci, geany_find_flags_to_sci_flags(flags), ttf);
+
+		/* not found or found text is partially out of range */
+		if (ret == -1 || ttf->chrgText.cpMax > ttf->chrg.cpMax)
+			break;
+
+		g_array_append_val(ranges, ttf->chrgText);
+		ttf->chrg.cpMin = ttf->chrgText.cpMax;
+
+		/* avoid rematching with empty matches, see find_range() */
+		if (ttf->chrgText.cpMax == ttf->chrgText.cpMin)
+			ttf->chrg.cpMin ++;
+	}
+
+	if (regex)
+	{
+		geany_match_info_free(match);
+		g_regex_unref(regex);
+	}
+	return ranges;
+}
+
+
+/* number of matches from which search_mark_all() marks the ones outside the view later */
+#define MARK_ALL_SYNC_MATCHES 1000
+/* number of matches marked per idle callback */
+#define MARK_ALL_BATCH_SIZE 5000
+
+static struct
+{
+	guint source_id;
+	guint doc_id;
+	gint doc_len;		/* to notice changes of the document meanwhile */
+	GArray *ranges;
+	guint next;			/* index of the next range to mark */
+	guint skip_start;	/* indices of the ranges already marked */
+	guint skip_end;
+}
+pending_marks = {0, 0, 0, NULL, 0, 0, 0};
+
+
+static void cancel_mark_all(void)
+{
+	if (pending_marks.source_id)
+		g_source_remove(pending_marks.source_id);
+	pending_marks.source_id = 0;
+	if (pending_marks.ranges)
+		g_array_free(pending_marks.ranges, TRUE);
+	pending_marks.ranges = NULL;
+}
+
+
+static void mark_ranges(GeanyEditor *editor, GArray *ranges, guint start, guint end)
+{
+	gint *positions;
+	gint *lengths;
+	guint i;
+
+	if (end <= start)
+		return;
+
+	positions = g_new(gint, end - start);
+	lengths = g_new(gint, end - start);
+	for (i = start; i < end; i++)
+	{
+		struct Sci_CharacterRange *range = &g_array_index(ranges, struct Sci_CharacterRange, i);
+
+		positions[i - start] = range->cpMin;
+		lengths[i - start] = range->cpMax - range->cpMin;
+	}
+	editor_indicator_set_ranges(editor, GEANY_INDICATOR_SEARCH, positions, lengths, end - start);
+	g_free(positions);
+	g_free(lengths);
+}
+
+
+static gboolean mark_all_idle(gpointer user_data)
+{
+	GeanyDocument *doc = document_find_by_id(pending_marks.doc_id);
+	guint end;
+
+	/* the document has been closed or changed, so the positions are wrong */
+	if (! doc || sci_get_length(doc->editor->sci) != pending_marks.doc_len)
+	{
+		pending_marks.source_id = 0;
+		cancel_mark_all();
+		return G_SOURCE_REMOVE;
+	}
+
+	if (pending_marks.next == pending_marks.skip_start)
+		pending_marks.next = pending_marks.skip_end;
+
+	end = pending_marks.next + MARK_ALL_BATCH_SIZE;
+	if (pending_marks.next < pending_marks.skip_start)
+		end = MIN(end, pending_marks.skip_start);
+	end = MIN(end, pending_marks.ranges->len);
+
+	mark_ranges(doc->editor, pending_marks.ranges, pending_marks.next, end);
+	pending_marks.next = end;
+
+	if (pending_marks.next >= pending_marks.ranges->len)
+	{
+		pending_marks.source_id = 0;
+		cancel_mark_all();
+		return G_SOURCE_REMOVE;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+
+/* Returns: the index of the first range ending after pos */
+static guint find_first_range_after(GArray *ranges, gint pos)
+{
+	guint lo = 0, hi = ranges->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index(ranges, struct Sci_CharacterRange, mid).cpMax <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
 /* Clears markers if text is null/empty.
+ * Many matches are only marked in the visible part of the document at once, the others
+ * are marked when idle.
  * @return Number of matches marked. */
+GEANY_EXPORT_SYMBOL
 gint search_mark_all(GeanyDocument *doc, const gchar *search_text, GeanyFindFlags flags)
 {
-	gint count = 0;
+	ScintillaObject *sci;
 	struct Sci_TextToFind ttf;
-	GSList *match, *matches;
+	GArray *ranges;
+	gint count;
 
 	g_return_val_if_fail(DOC_VALID(doc), 0);
 
+	sci = doc->editor->sci;
+
 	/* clear previous search indicators */
+	cancel_mark_all();
 	editor_indicator_clear(doc->editor, GEANY_INDICATOR_SEARCH);
 
 	if (G_UNLIKELY(EMPTY(search_text)))
 		return 0;
 
 	ttf.chrg.cpMin = 0;
-	ttf.chrg.cpMax = sci_get_length(doc->editor->sci);
+	ttf.chrg.cpMax = sci_get_length(sci);
 	ttf.lpstrText = (gchar *)search_text;
 
-	matches = find_range(doc->editor->sci, flags, &ttf);
-	foreach_slist (match, matches)
+	ranges = find_range_positions(sci, flags, &ttf);
+	count = ranges->len;
+
+	if (ranges->len < MARK_ALL_SYNC_MATCHES)
 	{
-		GeanyMatchInfo *info = match->data;
+		mark_ranges(doc->editor, ranges, 0, ranges->len);
+		g_array_free(ranges, TRUE);
+	}
+	else
+	{
+		gint first_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0), 0);
+		gint last_line = SSM(sci, SCI_DOCLINEFROMVISIBLE,
+			SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0) + SSM(sci, SCI_LINESONSCREEN, 0, 0), 0);
 
-		if (info->end != info->start)
-			editor_indicator_set_on_range(doc->editor, GEANY_INDICATOR_SEARCH, info->start, info->end);
-		count++;
+		pending_marks.skip_start = find_first_range_after(ranges,
+			sci_get_position_from_line(sci, first_line));
+		pending_marks.skip_end = find_first_range_after(ranges,
+			sci_get_line_end_position(sci, last_line));
+		/* the matches in view */
+		mark_ranges(doc->editor, ranges, pending_marks.skip_start, pending_marks.skip_end);
 
-		geany_match_info_free(info);
+		pending_marks.doc_id = doc->id;
+		pending_marks.doc_len = sci_get_length(sci);
+		pending_marks.ranges = ranges;
+		pending_marks.next = 0;
+		pending_marks.source_id = g_idle_add(mark_all_idle, NULL);
 	}
-	g_slist_free(matches);
 
 	return count;
 }
@@ -1408,19 +1623,33 @@ static void replace_in_session(GeanyDocument *doc,
 		const gchar *original_find, const gchar *original_replace)
 {
 	guint n, page_count, rep_count = 0, file_count = 0;
+	GPtrArray *docs = g_ptr_array_new();
+	GPtrArray *searches;
 
 	/* replace in all documents following notebook tab order */
 	page_count = gtk_notebook_get_n_pages(GTK_NOTEBOOK(main_widgets.notebook));
 	for (n = 0; n < page_count; n++)
+		g_ptr_array_add(docs, document_get_from_page(n));
+
+	/* find the documents with matches in parallel so only those are searched again
+	 * for replacing */
+	searches = search_documents(docs, find, search_flags_re);
+	for (n = 0; n < docs->len; n++)
 	{
-		GeanyDocument *tmp_doc = document_get_from_page(n);
 		gint reps = 0;
 
-		reps = document_replace_all(tmp_doc, find, replace, original_find, original_replace, search_flags_re);
+		if (searches && ((SessionSearch *) searches->pdata[n])->count == 0)
+			continue;
+
+		reps = document_replace_all(docs->pdata[n], find, replace, original_find, original_replace, search_flags_re);
 		rep_count += reps;
 		if (reps)
 			file_count++;
 	}
+	if (searches)
+		session_searches_free(searches);
+	g_ptr_array_free(docs, TRUE);
+
 	if (file_count == 0)
 	{
 		utils_beep();
@@ -1665,14 +1894,7 @@ search_find_in_files(const gchar *utf8_search_text, const gchar *utf8_dir, const
 
 	if (EMPTY(utf8_search_text) || ! utf8_dir) return TRUE;
 
-	command_grep = g_find_program_in_path(tool_prefs.grep_cmd);
-	if (command_grep == NULL)
-		command_line = g_strdup_printf("%s %s --", tool_prefs.grep_cmd, opts);
-	else
-	{
-		command_line = g_strdup_printf("\"%s\" %s --", command_grep, opts);
-		g_free(command_grep);
-	}
+	cancel_builtin_find_in_files();
 
 	/* convert the search text in the preferred encoding (if the text is not valid UTF-8. assume
 	 * it is already in the preferred encoding) */
@@ -1684,9 +1906,21 @@ search_find_in_files(const gchar *utf8_search_text, const gchar *utf8_dir, const
 	if (search_text == NULL)
 		search_text = g_strdup(utf8_search_text);
 
+	dir = utils_get_locale_from_utf8(utf8_dir);
+
+	command_grep = g_find_program_in_path(tool_prefs.grep_cmd);
+	if (search_prefs.builtin_find_in_files || command_grep == NULL)
+	{
+		/* also used when there is no grep, e.g. on Windows */
+		ret = builtin_find_in_files(search_text, utf8_search_text, dir, utf8_dir, enc);
+		utils_free_pointers(3, command_grep, search_text, dir, NULL);
+		return ret;
+	}
+	command_line = g_strdup_printf("\"%s\" %s --", command_grep, opts);
+	g_free(command_grep);
+
 	argv_prefix = g_new(gchar*, 3);
 	argv_prefix[0] = search_text;
-	dir = utils_get_locale_from_utf8(utf8_dir);
 
 	/* finally add the arguments(files to be searched) */
 	if (settings.fif_recursive)	/* recursive option set */
@@ -1705,6 +1939,7 @@ search_find_in_files(const gchar *utf8_search_text, const gchar *utf8_dir, const
 		if (argv == NULL)	/* no files */
 		{
 			g_free(command_line);
+			g_free(dir);
 			return FALSE;
 		}
 	}
@@ -1714,7 +1949,7 @@ search_find_in_files(const gchar *utf8_search_text, const gchar *utf8_dir, const
 
 	/* we can pass 'enc' without strdup'ing it here because it's a global const string and
 	 * always exits longer than the lifetime of this function */
-	if (spawn_with_callbacks(dir, command_line, argv, NULL, 0, NULL, NULL, search_read_io,
+	if (spawn_with_callbacks(dir, command_line, argv, NULL, SPAWN_LINES, NULL, NULL, search_read_io,
 		(gpointer) enc, 0, search_read_io_stderr, (gpointer) enc, 0, search_finished, NULL,
 		NULL, &error))
  	{
@@ -1846,21 +2081,36 @@ static void read_fif_io(gchar *msg, GIOCondition condition, gchar *enc, gint msg
 }
 
 
+/* reads the lines of grep's output, see SPAWN_LINES */
+static void read_fif_lines(GString *string, GIOCondition condition, gchar *enc, gint msg_color)
+{
+	gchar *line = string->str;
+
+	do
+	{
+		gsize len = strlen(line);
+
+		read_fif_io(line, condition, enc, msg_color);
+		line += len + 1;
+	}
+	while (line < string->str + string->len);
+}
+
+
 static void search_read_io(GString *string, GIOCondition condition, gpointer data)
 {
-	read_fif_io(string->str, condition, data, COLOR_BLACK);
+	read_fif_lines(string, condition, data, COLOR_BLACK);
 }
 
 
 static void search_read_io_stderr(GString *string, GIOCondition condition, gpointer data)
 {
-	read_fif_io(string->str, condition, data, COLOR_DARK_RED);
+	read_fif_lines(string, condition, data, COLOR_DARK_RED);
 }
 
 
 static void search_finished(GPid child_pid, gint status, gpointer user_data)
 {
-	const gchar *msg = _("Search failed.");
 	gint exit_status;
 
 	if (SPAWN_WIFEXITED(status))
@@ -1876,6 +2126,14 @@ static void search_finished(GPid child_pid, gint status, gpointer user_data)
 	{
 		exit_status = 1;
 	}
+	show_fif_result(exit_status);
+}
+
+
+/* exit_status is the one of grep: 0 if something was found, 1 if not and 2 on errors */
+static void show_fif_result(gint exit_status)
+{
+	const gchar *msg = _("Search failed.");
 
 	switch (exit_status)
 	{
@@ -1904,163 +2162,813 @@ static void search_finished(GPid child_pid, gint status, gpointer user_data)
 }
 
 
-static GRegex *compile_regex(const gchar *str, GeanyFindFlags sflags)
+/* Built-in Find in Files
+ *
+ * One thread walks the directory tree and hands the files to a pool of threads searching them,
+ * which collect the result lines in the same format as grep. The lines are added to the
+ * messages window in batches from the main loop. */
+
+typedef struct FifSearch
 {
-	GRegex *regex;
-	GError *error = NULL;
-	gint rflags = 0;
+	gint		cancelled;	/* atomic */
+	GRegex		*regex;		/* for files in the search encoding */
+	GRegex		*regex_raw;	/* for files with invalid UTF-8 if the encoding is UTF-8 */
+	gchar		*literal;	/* text every matching line contains, if known */
+	gboolean	plain;		/* whether regex matches a fixed text */
+	gboolean	invert;
+	gboolean	recursive;
+	gchar		*dir;
+	GSList		*patterns;	/* GPatternSpecs for the file names to search */
+	const gchar	*enc;
+	GThreadPool	*pool;
+
+	GMutex		lock;
+	GString		*results;	/* lines not yet added to the messages window */
+	guint		results_source;
+	gboolean	found;
+}
+FifSearch;
 
-	if (sflags & GEANY_FIND_MULTILINE)
-		rflags |= G_REGEX_MULTILINE;
-	if (~sflags & GEANY_FIND_MATCHCASE)
-		rflags |= G_REGEX_CASELESS;
-	if (sflags & (GEANY_FIND_WHOLEWORD | GEANY_FIND_WORDSTART))
-	{
-		geany_debug("%s: Unsupported regex flags found!", G_STRFUNC);
-	}
+/* the running search, if any */
+static FifSearch *fif_search = NULL;
 
-	regex = g_regex_new(str, rflags, 0, &error);
-	if (!regex)
-	{
-		ui_set_statusbar(FALSE, _("Bad regex: %s"), error->message);
-		g_error_free(error);
-	}
-	return regex;
-}
+/* files beginning with a null byte in this many bytes are skipped as binary */
+#define FIF_BINARY_CHECK_SIZE 32768
 
 
-/* groups that don't exist are handled OK as len = end - start = (-1) - (-1) = 0 */
-static gchar *get_regex_match_string(const gchar *text, const GeanyMatchInfo *match, guint nth)
+static void fif_search_free(FifSearch *fif)
 {
-	const gint start = match->matches[nth].start;
-	const gint end = match->matches[nth].end;
-	return g_strndup(&text[start], end - start);
+	GSList *node;
+
+	g_regex_unref(fif->regex);
+	if (fif->regex_raw)
+		g_regex_unref(fif->regex_raw);
+	foreach_slist(node, fif->patterns)
+		g_pattern_spec_free(node->data);
+	g_slist_free(fif->patterns);
+	g_mutex_clear(&fif->lock);
+	g_string_free(fif->results, TRUE);
+	g_free(fif->literal);
+	g_free(fif->dir);
+	g_free(fif);
 }
 
 
-static gint find_regex(ScintillaObject *sci, guint pos, GRegex *regex, gboolean multiline, GeanyMatchInfo *match)
+static void fif_flush_results(FifSearch *fif)
 {
-	const gchar *text;
-	GMatchInfo *minfo;
-	guint document_length;
-	gint ret = -1;
-	gint offset = 0;
-
-	document_length = (guint)sci_get_length(sci);
-	if (document_length <= 0)
-		return -1; /* skip empty documents */
+	gchar *lines, *line, *next;
 
-	g_return_val_if_fail(pos <= document_length, -1);
+	g_mutex_lock(&fif->lock);
+	lines = g_string_free(fif->results, FALSE);
+	fif->results = g_string_new(NULL);
+	fif->results_source = 0;
+	g_mutex_unlock(&fif->lock);
 
-	if (multiline)
-	{
-		/* Warning: any SCI calls will invalidate 'text' after calling SCI_GETCHARACTERPOINTER */
-		text = (void*)SSM(sci, SCI_GETCHARACTERPOINTER, 0, 0);
-		g_regex_match_full(regex, text, -1, pos, 0, &minfo, NULL);
-	}
-	else /* single-line mode, manually match against each line */
+	if (! g_atomic_int_get(&fif->cancelled))
 	{
-		gint line = sci_get_line_from_position(sci, pos);
-
-		for (;;)
+		for (line = lines; *line; line = next)
 		{
-			gint start = sci_get_position_from_line(sci, line);
-			gint end = sci_get_line_end_position(sci, line);
-
-			text = (void*)SSM(sci, SCI_GETRANGEPOINTER, start, end - start);
-			if (g_regex_match_full(regex, text, end - start, pos - start, 0, &minfo, NULL))
-			{
-				offset = start;
-				break;
-			}
-			else /* not found, try next line */
-			{
-				line ++;
-				if (line >= sci_get_line_count(sci))
-					break;
-				pos = sci_get_position_from_line(sci, line);
-				/* don't free last info, it's freed below */
-				g_match_info_free(minfo);
-			}
+			next = strchr(line, '\n');
+			*next++ = '\0';
+			read_fif_io(line, G_IO_IN, (gchar *) fif->enc, COLOR_BLACK);
 		}
 	}
+	g_free(lines);
+}
 
-	/* Warning: minfo will become invalid when 'text' does! */
-	if (g_match_info_matches(minfo))
-	{
-		guint i;
 
-		/* copy whole match text and offsets before they become invalid */
-		SETPTR(match->match_text, g_match_info_fetch(minfo, 0));
+static gboolean fif_results_idle(gpointer data)
+{
+	fif_flush_results(data);
+	return FALSE;
+}
 
-		foreach_range(i, G_N_ELEMENTS(match->matches))
-		{
-			gint start = -1, end = -1;
 
-			g_match_info_fetch_pos(minfo, (gint)i, &start, &end);
-			match->matches[i].start = offset + start;
-			match->matches[i].end = offset + end;
-		}
-		match->start = match->matches[0].start;
-		match->end = match->matches[0].end;
-		ret = match->start;
+static gboolean fif_finished_idle(gpointer data)
+{
+	FifSearch *fif = data;
+
+	/* the files are all searched, so no new results can come in */
+	if (fif->results_source)
+		g_source_remove(fif->results_source);
+	fif_flush_results(fif);
+	if (fif == fif_search)
+	{
+		fif_search = NULL;
+		show_fif_result(fif->found ? 0 : 1);
 	}
-	g_match_info_free(minfo);
-	return ret;
+	fif_search_free(fif);
+	return FALSE;
 }
 
 
-static gint geany_find_flags_to_sci_flags(GeanyFindFlags flags)
+static void fif_add_line(GString *out, const gchar *name, guint line, const gchar *text, gsize len)
 {
-	g_warn_if_fail(! (flags & GEANY_FIND_REGEXP) || ! (flags & GEANY_FIND_MULTILINE));
+	g_string_append_printf(out, "%s:%u:", name, line);
+	g_string_append_len(out, text, len);
+	g_string_append_c(out, '\n');
+}
 
-	return ((flags & GEANY_FIND_MATCHCASE) ? SCFIND_MATCHCASE : 0) |
-		((flags & GEANY_FIND_WHOLEWORD) ? SCFIND_WHOLEWORD : 0) |
-		((flags & GEANY_FIND_REGEXP) ? SCFIND_REGEXP | SCFIND_POSIX : 0) |
-		((flags & GEANY_FIND_WORDSTART) ? SCFIND_WORDSTART : 0);
+
+static const gchar *fif_find_literal(const gchar *text, gsize len, const gchar *literal, gsize literal_len)
+{
+	const gchar *end = text + len;
+
+	while ((gsize) (end - text) >= literal_len &&
+		(text = memchr(text, literal[0], (end - text) - literal_len + 1)) != NULL)
+	{
+		if (memcmp(text, literal, literal_len) == 0)
+			return text;
+		text++;
+	}
+	return NULL;
 }
 
 
-gint search_find_prev(ScintillaObject *sci, const gchar *str, GeanyFindFlags flags, GeanyMatchInfo **match_)
+/* Returns the offset of the first line from pos on which regex matches, or len */
+static gsize fif_find_line(FifSearch *fif, GRegex *regex, const gchar *buf, gsize len, gsize pos)
 {
-	gint ret;
+	while (pos < len)
+	{
+		const gchar *line_end;
+		gsize match_pos;
 
-	g_return_val_if_fail(! (flags & GEANY_FIND_REGEXP), -1);
+		if (fif->plain)
+		{
+			GMatchInfo *minfo;
+			gint start = -1;
+
+			/* fixed texts can't span lines so the file can be searched as a whole */
+			if (g_regex_match_full(regex, buf, len, pos, 0, &minfo, NULL))
+				g_match_info_fetch_pos(minfo, 0, &start, NULL);
+			g_match_info_free(minfo);
+			if (start < 0)
+				return len;
+			match_pos = start;
+		}
+		else if (fif->literal)
+		{
+			const gchar *found = fif_find_literal(buf + pos, len - pos,
+				fif->literal, strlen(fif->literal));
 
-	ret = sci_search_prev(sci, geany_find_flags_to_sci_flags(flags), str);
-	if (ret != -1 && match_)
-		*match_ = match_info_new(flags, ret, ret + strlen(str));
-	return ret;
+			if (! found)
+				return len;
+			match_pos = found - buf;
+		}
+		else
+			match_pos = pos;
+
+		while (match_pos > pos && buf[match_pos - 1] != '\n')
+			match_pos--;
+		if (fif->plain)
+			return match_pos;
+
+		pos = match_pos;
+		line_end = memchr(buf + pos, '\n', len - pos);
+		if (! line_end)
+			line_end = buf + len;
+		if (g_regex_match_full(regex, buf + pos, line_end - (buf + pos), 0, 0, NULL, NULL))
+			return pos;
+		pos = line_end - buf + 1;
+	}
+	return len;
 }
 
 
-gint search_find_next(ScintillaObject *sci, const gchar *str, GeanyFindFlags flags, GeanyMatchInfo **match_)
+static guint fif_count_lines(const gchar *buf, gsize start, gsize end)
 {
-	GeanyMatchInfo *match;
-	GRegex *regex;
-	gint ret = -1;
-	gint pos;
+	const gchar *p = buf + start;
+	guint count = 0;
 
-	if (~flags & GEANY_FIND_REGEXP)
+	while ((p = memchr(p, '\n', buf + end - p)) != NULL)
 	{
-		ret = sci_search_next(sci, geany_find_flags_to_sci_flags(flags), str);
-		if (ret != -1 && match_)
-			*match_ = match_info_new(flags, ret, ret + strlen(str));
-		return ret;
+		count++;
+		p++;
 	}
+	return count;
+}
 
-	regex = compile_regex(str, flags);
-	if (!regex)
-		return -1;
 
-	match = match_info_new(flags, 0, 0);
+static void fif_search_file(gpointer data, gpointer user_data)
+{
+	gchar *name = data;
+	FifSearch *fif = user_data;
+	GMappedFile *file;
+	GRegex *regex = fif->regex;
+	GString *out;
+	const gchar *buf;
+	gchar *path;
+	gsize len, pos = 0;
+	guint line = 1;
+
+	if (g_atomic_int_get(&fif->cancelled))
+	{
+		g_free(name);
+		return;
+	}
 
-	pos = sci_get_current_position(sci);
-	ret = find_regex(sci, pos, regex, flags & GEANY_FIND_MULTILINE, match);
-	/* avoid re-matching the same position in case of empty matches */
-	if (ret == pos && match->matches[0].start == match->matches[0].end)
-		ret = find_regex(sci, pos + 1, regex, flags & GEANY_FIND_MULTILINE, match);
-	if (ret >= 0)
+	path = g_build_filename(fif->dir, name, NULL);
+	file = g_mapped_file_new(path, FALSE, NULL);
+	g_free(path);
+	if (! file)
+	{
+		g_free(name);
+		return;
+	}
+
+	buf = g_mapped_file_get_contents(file);
+	len = g_mapped_file_get_length(file);
+	/* GRegex offsets are gints */
+	if (len == 0 || len > G_MAXINT || memchr(buf, '\0', MIN(len, FIF_BINARY_CHECK_SIZE)))
+	{
+		g_mapped_file_unref(file);
+		g_free(name);
+		return;
+	}
+	if (fif->regex_raw && ! g_utf8_validate(buf, len, NULL))
+		regex = fif->regex_raw;
+
+	out = g_string_new(NULL);
+	while (pos < len && ! g_atomic_int_get(&fif->cancelled))
+	{
+		gsize match = fif_find_line(fif, regex, buf, len, pos);
+		const gchar *line_end;
+
+		if (fif->invert)
+		{
+			/* add the lines before the matching one */
+			while (pos < match)
+			{
+				line_end = memchr(buf + pos, '\n', match - pos);
+				if (! line_end)
+					line_end = buf + match;
+				fif_add_line(out, name, line++, buf + pos, line_end - (buf + pos));
+				pos = line_end - buf + 1;
+			}
+			if (match >= len)
+				break;
+		}
+		else
+		{
+			if (match >= len)
+				break;
+			line += fif_count_lines(buf, pos, match);
+		}
+
+		line_end = memchr(buf + match, '\n', len - match);
+		if (! line_end)
+			line_end = buf + len;
+		if (! fif->invert)
+			fif_add_line(out, name, line, buf + match, line_end - (buf + match));
+		line++;
+		pos = line_end - buf + 1;
+	}
+	g_mapped_file_unref(file);
+	g_free(name);
+
+	if (out->len > 0)
+	{
+		g_mutex_lock(&fif->lock);
+		g_string_append_len(fif->results, out->str, out->len);
+		fif->found = TRUE;
+		if (! fif->results_source)
+			fif->results_source = g_idle_add(fif_results_idle, fif);
+		g_mutex_unlock(&fif->lock);
+	}
+	g_string_free(out, TRUE);
+}
+
+
+static gboolean fif_file_matches(FifSearch *fif, const gchar *base_name)
+{
+	return ! fif->patterns || pattern_list_match(fif->patterns, base_name);
+}
+
+
+/* name is relative to fif->dir */
+static void fif_walk_dir(FifSearch *fif, const gchar *name)
+{
+	gchar *path = g_build_filename(fif->dir, name, NULL);
+	GDir *dir = g_dir_open(path, 0, NULL);
+	const gchar *base_name;
+
+	g_free(path);
+	if (! dir)
+		return;
+
+	foreach_dir(base_name, dir)
+	{
+		gchar *child = g_build_filename(name, base_name, NULL);
+		GStatBuf st;
+
+		if (g_atomic_int_get(&fif->cancelled))
+		{
+			g_free(child);
+			break;
+		}
+
+		path = g_build_filename(fif->dir, child, NULL);
+		/* like grep, don't follow symbolic links found while recursing */
+		if (g_lstat(path, &st) != 0)
+			g_free(child);
+		else if (S_ISDIR(st.st_mode))
+		{
+			fif_walk_dir(fif, child);
+			g_free(child);
+		}
+		else if (S_ISREG(st.st_mode) && fif_file_matches(fif, base_name))
+			g_thread_pool_push(fif->pool, child, NULL);
+		else
+			g_free(child);
+		g_free(path);
+	}
+	g_dir_close(dir);
+}
+
+
+static gpointer fif_walk_thread(gpointer data)
+{
+	FifSearch *fif = data;
+
+	if (fif->recursive)
+	{
+		/* use '.' to get the same paths as grep */
+		fif_walk_dir(fif, ".");
+	}
+	else
+	{
+		GSList *list, *node;
+
+		list = utils_get_file_list(fif->dir, NULL, NULL);
+		foreach_slist(node, list)
+		{
+			gchar *path = g_build_filename(fif->dir, node->data, NULL);
+
+			if (g_file_test(path, G_FILE_TEST_IS_REGULAR) && fif_file_matches(fif, node->data))
+				g_thread_pool_push(fif->pool, node->data, NULL);
+			else
+				g_free(node->data);
+			g_free(path);
+		}
+		g_slist_free(list);
+	}
+
+	/* wait for the queued files to be searched */
+	g_thread_pool_free(fif->pool, FALSE, TRUE);
+	g_idle_add(fif_finished_idle, fif);
+	return NULL;
+}
+
+
+static GRegex *fif_compile_regex(const gchar *pattern, gboolean raw)
+{
+	GRegex *regex;
+	GError *error = NULL;
+	gint rflags = G_REGEX_OPTIMIZE;
+
+	if (! settings.fif_case_sensitive)
+		rflags |= G_REGEX_CASELESS;
+	if (raw)
+		rflags |= G_REGEX_RAW;
+
+	regex = g_regex_new(pattern, rflags, 0, &error);
+	if (! regex)
+	{
+		ui_set_statusbar(FALSE, _("Bad regex: %s"), error->message);
+		g_error_free(error);
+	}
+	return regex;
+}
+
+
+/* drops the results of a built-in search still running */
+static void cancel_builtin_find_in_files(void)
+{
+	if (fif_search)
+	{
+		g_atomic_int_set(&fif_search->cancelled, TRUE);
+		fif_search = NULL;
+	}
+}
+
+
+static gint get_fif_thread_count(void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	return (gint) g_get_num_processors();
+#else
+	return 4;
+#endif
+}
+
+
+static gboolean builtin_find_in_files(const gchar *search_text, const gchar *utf8_search_text,
+	const gchar *dir, const gchar *utf8_dir, const gchar *enc)
+{
+	FifSearch *fif;
+	gchar *pattern;
+	gchar *utf8_str;
+
+	if (! g_file_test(dir, G_FILE_TEST_IS_DIR))
+	{
+		ui_set_statusbar(TRUE, _("Could not open directory (%s)"), utf8_dir);
+		return FALSE;
+	}
+
+	if (settings.fif_regexp)
+		pattern = g_strdup(search_text);
+	else
+		pattern = g_regex_escape_string(search_text, -1);
+	/* grep -w: the match must not be preceded nor followed by word characters */
+	if (settings.fif_match_whole_word)
+		SETPTR(pattern, g_strconcat("(?<!\\w)(?:", pattern, ")(?!\\w)", NULL));
+
+	fif = g_new0(FifSearch, 1);
+	fif->regex = fif_compile_regex(pattern, enc != NULL);
+	if (! fif->regex)
+	{
+		g_free(pattern);
+		g_free(fif);
+		return FALSE;
+	}
+	if (enc == NULL)
+		fif->regex_raw = fif_compile_regex(pattern, TRUE);
+	g_free(pattern);
+
+	fif->plain = ! settings.fif_regexp;
+	if (settings.fif_regexp && settings.fif_case_sensitive)
+		fif->literal = get_regex_required_literal(search_text);
+	fif->invert = settings.fif_invert_results;
+	fif->recursive = settings.fif_recursive;
+	fif->dir = g_strdup(dir);
+	fif->enc = enc;
+	g_mutex_init(&fif->lock);
+	fif->results = g_string_new(NULL);
+
+	g_strstrip(settings.fif_files);
+	if (settings.fif_files_mode != FILES_MODE_ALL && *settings.fif_files)
+	{
+		gchar **names = g_strsplit(settings.fif_files, " ", -1);
+		gchar **name;
+
+		foreach_strv(name, names)
+		{
+			if (**name)
+				fif->patterns = g_slist_prepend(fif->patterns, g_pattern_spec_new(*name));
+		}
+		g_strfreev(names);
+	}
+
+	fif->pool = g_thread_pool_new(fif_search_file, fif, get_fif_thread_count(), FALSE, NULL);
+
+	fif_search = fif;
+
+	gtk_list_store_clear(msgwindow.store_msg);
+	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_MESSAGE);
+	ui_progress_bar_start(_("Searching..."));
+	msgwin_set_messages_dir(dir);
+	utf8_str = g_strdup_printf(_("Searching for %s (in directory: %s)"), utf8_search_text, utf8_dir);
+	msgwin_msg_add_string(COLOR_BLUE, -1, NULL, utf8_str);
+	g_free(utf8_str);
+
+	g_thread_unref(g_thread_new("geany-fif", fif_walk_thread, fif));
+	return TRUE;
+}
+
+
+static GRegex *compile_regex(const gchar *str, GeanyFindFlags sflags)
+{
+	GRegex *regex;
+	GError *error = NULL;
+	gint rflags = 0;
+
+	if (sflags & GEANY_FIND_MULTILINE)
+		rflags |= G_REGEX_MULTILINE;
+	if (~sflags & GEANY_FIND_MATCHCASE)
+		rflags |= G_REGEX_CASELESS;
+	/* lets GLib use the PCRE2 JIT compiler if available */
+	rflags |= G_REGEX_OPTIMIZE;
+	if (sflags & (GEANY_FIND_WHOLEWORD | GEANY_FIND_WORDSTART))
+	{
+		geany_debug("%s: Unsupported regex flags found!", G_STRFUNC);
+	}
+
+	regex = g_regex_new(str, rflags, 0, &error);
+	if (!regex)
+	{
+		ui_set_statusbar(FALSE, _("Bad regex: %s"), error->message);
+		g_error_free(error);
+	}
+	return regex;
+}
+
+
+/* groups that don't exist are handled OK as len = end - start = (-1) - (-1) = 0 */
+static gchar *get_regex_match_string(const gchar *text, const GeanyMatchInfo *match, guint nth)
+{
+	const gint start = match->matches[nth].start;
+	const gint end = match->matches[nth].end;
+	return g_strndup(&text[start], end - start);
+}
+
+
+static void commit_literal_run(GString *run, GString *best)
+{
+	if (run->len > best->len)
+		g_string_assign(best, run->str);
+	g_string_truncate(run, 0);
+}
+
+
+/* Extracts the longest run of literal bytes any match of the given PCRE pattern
+ * has to contain, or returns NULL if it can't tell.  Only the top level of the
+ * pattern is looked at and anything not understood gives up, to never return a
+ * literal a match could lack. */
+static gchar *get_regex_required_literal(const gchar *pattern)
+{
+	GString *run = g_string_new(NULL);
+	GString *best = g_string_new(NULL);
+	gboolean last_is_literal = FALSE;
+	gint depth = 0;
+	const gchar *p = pattern;
+
+	while (*p)
+	{
+		gchar c = *p++;
+		gboolean literal = FALSE;
+
+		if (c == '\\')
+		{
+			if (! *p)
+				goto fail;
+			c = *p++;
+			if (! g_ascii_isalnum(c))
+				literal = TRUE;
+			else if (! strchr("dDwWsShHvVRNXbBAzZG", c))
+				goto fail;	/* \x, \Q, \p and the like take arguments */
+		}
+		else if (c == '[')
+		{
+			if (*p == '^')
+				p++;
+			if (*p == ']')
+				p++;
+			while (*p && *p != ']')
+			{
+				if (*p == '\\' && p[1])
+					p += 2;
+				else if (*p == '[' && p[1] == ':')
+				{
+					const gchar *end = strstr(p + 2, ":]");
+
+					if (! end)
+						goto fail;
+					p = end + 2;
+				}
+				else
+					p++;
+			}
+			if (! *p)
+				goto fail;
+			p++;
+		}
+		else if (c == '(')
+		{
+			/* inline options and verbs change how the rest of the pattern matches */
+			if (depth == 0 && (*p == '*' || (*p == '?' && ! strchr(":=!<>|", p[1]))))
+				goto fail;
+			if (depth == 0)
+				commit_literal_run(run, best);
+			depth++;
+		}
+		else if (c == ')')
+		{
+			if (depth == 0)
+				goto fail;
+			depth--;
+		}
+		else if (c == '|')
+		{
+			if (depth == 0)
+				goto fail;
+		}
+		else if (c == '*' || c == '?' || c == '{' || c == '+')
+		{
+			if (c == '{')
+			{
+				while (*p && *p != '}')
+					p++;
+				if (! *p)
+					goto fail;
+				p++;
+			}
+			/* all but '+' make the quantified character optional, remove it wholly
+			 * to not leave the first bytes of a multi-byte character */
+			if (c != '+' && last_is_literal && depth == 0)
+			{
+				while (run->len > 0 && (run->str[run->len - 1] & 0xc0) == 0x80)
+					g_string_truncate(run, run->len - 1);
+				if (run->len > 0)
+					g_string_truncate(run, run->len - 1);
+			}
+		}
+		else if (c != '.' && c != '^' && c != '$')
+			literal = TRUE;
+
+		if (depth > 0 || (c == ')' && ! literal))
+		{
+			last_is_literal = FALSE;
+			continue;
+		}
+
+		if (literal)
+			g_string_append_c(run, c);
+		else
+			commit_literal_run(run, best);
+		last_is_literal = literal;
+	}
+	if (depth != 0)
+		goto fail;
+
+	commit_literal_run(run, best);
+	g_string_free(run, TRUE);
+	if (best->len == 0)
+	{
+		g_string_free(best, TRUE);
+		return NULL;
+	}
+	return g_string_free(best, FALSE);
+
+fail:
+	g_string_free(run, TRUE);
+	g_string_free(best, TRUE);
+	return NULL;
+}
+
+
+/* Searches for a match starting before end (or the end of the document if end is negative).
+ * In single-line mode, lines too far away are not looked at. */
+static gint find_regex(ScintillaObject *sci, guint pos, gint end, GRegex *regex, gboolean multiline,
+		GeanyMatchInfo *match)
+{
+	const gchar *text;
+	GMatchInfo *minfo;
+	guint document_length;
+	gint ret = -1;
+	gint offset = 0;
+
+	document_length = (guint)sci_get_length(sci);
+	if (document_length <= 0)
+		return -1; /* skip empty documents */
+
+	g_return_val_if_fail(pos <= document_length, -1);
+
+	if (end < 0 || (guint)end > document_length)
+		end = document_length;
+
+	if (multiline)
+	{
+		/* Warning: any SCI calls will invalidate 'text' after calling SCI_GETCHARACTERPOINTER */
+		text = (void*)SSM(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+		g_regex_match_full(regex, text, -1, pos, 0, &minfo, NULL);
+	}
+	else /* single-line mode, manually match against each line */
+	{
+		gint line = sci_get_line_from_position(sci, pos);
+		gint last_line = sci_get_line_from_position(sci, end);
+		gchar *literal = NULL;
+		struct Sci_TextToFind ttf;
+
+		/* skip the lines the regex can't match on with the much faster plain search,
+		 * case insensitive plain search folds differently so isn't used then */
+		if (! (g_regex_get_compile_flags(regex) & G_REGEX_CASELESS))
+			literal = get_regex_required_literal(g_regex_get_pattern(regex));
+		ttf.lpstrText = literal;
+		ttf.chrg.cpMax = document_length;
+
+		for (;;)
+		{
+			gint start, line_end;
+
+			if (literal)
+			{
+				ttf.chrg.cpMin = pos;
+				if (sci_find_text(sci, SCFIND_MATCHCASE, &ttf) < 0)
+				{
+					minfo = NULL;
+					break;
+				}
+				if (sci_get_line_from_position(sci, ttf.chrgText.cpMin) > line)
+				{
+					line = sci_get_line_from_position(sci, ttf.chrgText.cpMin);
+					pos = sci_get_position_from_line(sci, line);
+				}
+			}
+			if (line > last_line)
+			{
+				minfo = NULL;
+				break;
+			}
+
+			start = sci_get_position_from_line(sci, line);
+			line_end = sci_get_line_end_position(sci, line);
+
+			text = (void*)SSM(sci, SCI_GETRANGEPOINTER, start, line_end - start);
+			if (g_regex_match_full(regex, text, line_end - start, pos - start, 0, &minfo, NULL))
+			{
+				offset = start;
+				break;
+			}
+			else /* not found, try next line */
+			{
+				line ++;
+				if (line >= sci_get_line_count(sci) || line > last_line)
+					break;
+				pos = sci_get_position_from_line(sci, line);
+				/* don't free last info, it's freed below */
+				g_match_info_free(minfo);
+			}
+		}
+		g_free(literal);
+	}
+
+	/* Warning: minfo will become invalid when 'text' does! */
+	if (minfo && g_match_info_matches(minfo))
+	{
+		guint i;
+
+		/* copy whole match text and offsets before they become invalid */
+		SETPTR(match->match_text, g_match_info_fetch(minfo, 0));
+
+		foreach_range(i, G_N_ELEMENTS(match->matches))
+		{
+			gint start = -1, end = -1;
+
+			g_match_info_fetch_pos(minfo, (gint)i, &start, &end);
+			match->matches[i].start = offset + start;
+			match->matches[i].end = offset + end;
+		}
+		match->start = match->matches[0].start;
+		match->end = match->matches[0].end;
+		ret = match->start;
+	}
+	if (minfo)
+		g_match_info_free(minfo);
+	return ret;
+}
+
+
+static gint geany_find_flags_to_sci_flags(GeanyFindFlags flags)
+{
+	g_warn_if_fail(! (flags & GEANY_FIND_REGEXP) || ! (flags & GEANY_FIND_MULTILINE));
+
+	return ((flags & GEANY_FIND_MATCHCASE) ? SCFIND_MATCHCASE : 0) |
+		((flags & GEANY_FIND_WHOLEWORD) ? SCFIND_WHOLEWORD : 0) |
+		((flags & GEANY_FIND_REGEXP) ? SCFIND_REGEXP | SCFIND_POSIX : 0) |
+		((flags & GEANY_FIND_WORDSTART) ? SCFIND_WORDSTART : 0);
+}
+
+
+gint search_find_prev(ScintillaObject *sci, const gchar *str, GeanyFindFlags flags, GeanyMatchInfo **match_)
+{
+	gint ret;
+
+	g_return_val_if_fail(! (flags & GEANY_FIND_REGEXP), -1);
+
+	ret = sci_search_prev(sci, geany_find_flags_to_sci_flags(flags), str);
+	if (ret != -1 && match_)
+		*match_ = match_info_new(flags, ret, ret + strlen(str));
+	return ret;
+}
+
+
+gint search_find_next(ScintillaObject *sci, const gchar *str, GeanyFindFlags flags, GeanyMatchInfo **match_)
+{
+	GeanyMatchInfo *match;
+	GRegex *regex;
+	gint ret = -1;
+	gint pos;
+
+	if (~flags & GEANY_FIND_REGEXP)
+	{
+		ret = sci_search_next(sci, geany_find_flags_to_sci_flags(flags), str);
+		if (ret != -1 && match_)
+			*match_ = match_info_new(flags, ret, ret + strlen(str));
+		return ret;
+	}
+
+	regex = compile_regex(str, flags);
+	if (!regex)
+		return -1;
+
+	match = match_info_new(flags, 0, 0);
+
+	pos = sci_get_current_position(sci);
+	ret = find_regex(sci, pos, -1, regex, flags & GEANY_FIND_MULTILINE, match);
+	/* avoid re-matching the same position in case of empty matches */
+	if (ret == pos && match->matches[0].start == match->matches[0].end)
+		ret = find_regex(sci, pos + 1, -1, regex, flags & GEANY_FIND_MULTILINE, match);
+	if (ret >= 0)
 		sci_set_selection(sci, match->start, match->end);
 
 	if (ret != -1 && match_)
@@ -2073,17 +2981,14 @@ gint search_find_next(ScintillaObject *sci, const gchar *str, GeanyFindFlags fla
 }
 
 
-gint search_replace_match(ScintillaObject *sci, const GeanyMatchInfo *match, const gchar *replace_text)
+/* Returns: replace_text with the back references to match expanded for regular expressions */
+static gchar *get_replace_text(const GeanyMatchInfo *match, const gchar *replace_text)
 {
 	GString *str;
-	gint ret = 0;
 	gint i = 0;
 
-	sci_set_target_start(sci, match->start);
-	sci_set_target_end(sci, match->end);
-
 	if (! (match->flags & GEANY_FIND_REGEXP))
-		return sci_replace_target(sci, replace_text, FALSE);
+		return g_strdup(replace_text);
 
 	str = g_string_new(replace_text);
 	while (str->str[i])
@@ -2113,8 +3018,24 @@ gint search_replace_match(ScintillaObject *sci, const GeanyMatchInfo *match, con
 		i += strlen(grp);
 		g_free(grp);
 	}
-	ret = sci_replace_target(sci, str->str, FALSE);
-	g_string_free(str, TRUE);
+	return g_string_free(str, FALSE);
+}
+
+
+gint search_replace_match(ScintillaObject *sci, const GeanyMatchInfo *match, const gchar *replace_text)
+{
+	gchar *text;
+	gint ret;
+
+	sci_set_target_start(sci, match->start);
+	sci_set_target_end(sci, match->end);
+
+	if (! (match->flags & GEANY_FIND_REGEXP))
+		return sci_replace_target(sci, replace_text, FALSE);
+
+	text = get_replace_text(match, replace_text);
+	ret = sci_replace_target(sci, text, FALSE);
+	g_free(text);
 	return ret;
 }
 
@@ -2139,7 +3060,7 @@ gint search_find_text(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_Tex
 
 	match = match_info_new(flags, 0, 0);
 
-	ret = find_regex(sci, ttf->chrg.cpMin, regex, flags & GEANY_FIND_MULTILINE, match);
+	ret = find_regex(sci, ttf->chrg.cpMin, ttf->chrg.cpMax, regex, flags & GEANY_FIND_MULTILINE, match);
 	if (ret >= ttf->chrg.cpMax)
 		ret = -1;
 	else if (ret >= 0)
@@ -2158,9 +3079,194 @@ gint search_find_text(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_Tex
 }
 
 
+static void add_match_line(SessionSearch *search, gint line)
+{
+	if (search->lines->len == 0 || g_array_index(search->lines, gint, search->lines->len - 1) != line)
+		g_array_append_val(search->lines, line);
+	search->count++;
+}
+
+
+/* Returns: the position after the end of the line starting at pos, and its length in line_len */
+static gint next_line(const gchar *text, gint len, gint pos, gint *line_len)
+{
+	gint start = pos;
+
+	while (pos < len && text[pos] != '\n' && text[pos] != '\r')
+		pos++;
+	*line_len = pos - start;
+
+	/* \r, \n or \r\n */
+	if (pos < len && text[pos] == '\r')
+		pos++;
+	if (pos < len && text[pos] == '\n')
+		pos++;
+	return pos;
+}
+
+
+/* finds the matches in a snapshot of the document, like find_range() does with Scintilla */
+static void session_search_thread(gpointer data, gpointer user_data)
+{
+	SessionSearch *search = data;
+	GMatchInfo *minfo = NULL;
+	gint line = 0;
+
+	if (search->whole_text)
+	{
+		gint pos = 0;
+		gint line_pos = 0;
+		gint line_len;
+
+		while (pos <= search->len &&
+			g_regex_match_full(search->regex, search->text, search->len, pos, 0, &minfo, NULL))
+		{
+			gint start, end;
+
+			g_match_info_fetch_pos(minfo, 0, &start, &end);
+			g_match_info_free(minfo);
+			minfo = NULL;
+
+			/* count the lines before the match */
+			while (line_pos < search->len)
+			{
+				gint next = next_line(search->text, search->len, line_pos, &line_len);
+
+				if (next > start)
+					break;
+				line_pos = next;
+				line++;
+			}
+			add_match_line(search, line);
+
+			/* avoid rematching with empty matches */
+			pos = (end == start) ? end + 1 : end;
+		}
+		/* a failed match fills minfo as well */
+		if (minfo)
+			g_match_info_free(minfo);
+	}
+	else
+	{
+		gint line_pos = 0;
+
+		while (line_pos <= search->len)
+		{
+			const gchar *line_text = search->text + line_pos;
+			gint line_len;
+			gint next = next_line(search->text, search->len, line_pos, &line_len);
+			gint pos = 0;
+
+			while (pos <= line_len &&
+				g_regex_match_full(search->regex, line_text, line_len, pos, 0, &minfo, NULL))
+			{
+				gint start, end;
+
+				g_match_info_fetch_pos(minfo, 0, &start, &end);
+				g_match_info_free(minfo);
+				minfo = NULL;
+				add_match_line(search, line);
+				pos = (end == start) ? end + 1 : end;
+			}
+			if (minfo)
+				g_match_info_free(minfo);
+			minfo = NULL;
+
+			/* the last line has no line ending */
+			if (line_pos + line_len == search->len)
+				break;
+			line_pos = next;
+			line++;
+		}
+	}
+}
+
+
+/* Searches the documents in parallel on a thread pool.
+ * Returns: the searches in the order of docs, or NULL if the search can't be done this way,
+ * e.g. for whole word searches which depend on the word characters of each document. */
+static GPtrArray *search_documents(GPtrArray *docs, const gchar *search_text, GeanyFindFlags flags)
+{
+	GPtrArray *searches;
+	GThreadPool *pool;
+	GRegex *regex;
+	GeanyDocument *doc;
+	gboolean whole_text;
+	guint i;
+
+	if (flags & (GEANY_FIND_WHOLEWORD | GEANY_FIND_WORDSTART))
+		return NULL;
+
+	if (flags & GEANY_FIND_REGEXP)
+	{
+		regex = compile_regex(search_text, flags);
+		whole_text = (flags & GEANY_FIND_MULTILINE) != 0;
+	}
+	else
+	{
+		gchar *pattern = g_regex_escape_string(search_text, -1);
+
+		regex = compile_regex(pattern, flags & ~GEANY_FIND_MULTILINE);
+		whole_text = TRUE;
+		g_free(pattern);
+	}
+	if (!regex)
+		return NULL;
+
+	searches = g_ptr_array_new();
+	pool = g_thread_pool_new(session_search_thread, NULL, get_fif_thread_count(), FALSE, NULL);
+	foreach_ptr_array(doc, i, docs)
+	{
+		ScintillaObject *sci = doc->editor->sci;
+		SessionSearch *search = g_new0(SessionSearch, 1);
+
+		search->doc = doc;
+		search->len = sci_get_length(sci);
+		search->text = (const gchar *) SSM(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+		search->regex = regex;
+		search->whole_text = whole_text;
+		search->lines = g_array_new(FALSE, FALSE, sizeof(gint));
+		g_ptr_array_add(searches, search);
+
+		if (search->len > 0)
+			g_thread_pool_push(pool, search, NULL);
+	}
+	/* wait for all documents to be searched */
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	g_regex_unref(regex);
+	return searches;
+}
+
+
+static void session_searches_free(GPtrArray *searches)
+{
+	guint i;
+
+	for (i = 0; i < searches->len; i++)
+	{
+		SessionSearch *search = searches->pdata[i];
+
+		g_array_free(search->lines, TRUE);
+		g_free(search);
+	}
+	g_ptr_array_free(searches, TRUE);
+}
+
+
+static void add_usage_line(GeanyDocument *doc, const gchar *short_file_name, gint line)
+{
+	gchar *buffer = sci_get_line(doc->editor->sci, line);
+
+	msgwin_msg_add(COLOR_BLACK, line + 1, doc,
+		"%s:%d: %s", short_file_name, line + 1, g_strstrip(buffer));
+	g_free(buffer);
+}
+
+
 static gint find_document_usage(GeanyDocument *doc, const gchar *search_text, GeanyFindFlags flags)
 {
-	gchar *buffer, *short_file_name;
+	gchar *short_file_name;
 	struct Sci_TextToFind ttf;
 	gint count = 0;
 	gint prev_line = -1;
@@ -2182,10 +3288,7 @@ static gint find_document_usage(GeanyDocument *doc, const gchar *search_text, Ge
 
 		if (line != prev_line)
 		{
-			buffer = sci_get_line(doc->editor->sci, line);
-			msgwin_msg_add(COLOR_BLACK, line + 1, doc,
-				"%s:%d: %s", short_file_name, line + 1, g_strstrip(buffer));
-			g_free(buffer);
+			add_usage_line(doc, short_file_name, line);
 			prev_line = line;
 		}
 		count++;
@@ -2198,6 +3301,51 @@ static gint find_document_usage(GeanyDocument *doc, const gchar *search_text, Ge
 }
 
 
+/* like find_document_usage() for all documents, searching them in parallel */
+static gint find_session_usage(const gchar *search_text, GeanyFindFlags flags)
+{
+	GPtrArray *docs = g_ptr_array_new();
+	GPtrArray *searches;
+	gint count = 0;
+	guint i;
+
+	for (i = 0; i < documents_array->len; i++)
+	{
+		if (documents[i]->is_valid)
+			g_ptr_array_add(docs, documents[i]);
+	}
+
+	searches = search_documents(docs, search_text, flags);
+	if (searches)
+	{
+		for (i = 0; i < searches->len; i++)
+		{
+			SessionSearch *search = searches->pdata[i];
+			gchar *short_file_name;
+			guint j;
+
+			if (search->count == 0)
+				continue;
+
+			short_file_name = g_path_get_basename(DOC_FILENAME(search->doc));
+			for (j = 0; j < search->lines->len; j++)
+				add_usage_line(search->doc, short_file_name, g_array_index(search->lines, gint, j));
+			count += search->count;
+			g_free(short_file_name);
+		}
+		session_searches_free(searches);
+	}
+	else
+	{
+		for (i = 0; i < docs->len; i++)
+			count += find_document_usage(docs->pdata[i], search_text, flags);
+	}
+
+	g_ptr_array_free(docs, TRUE);
+	return count;
+}
+
+
 void search_find_usage(const gchar *search_text, const gchar *original_search_text,
 		GeanyFindFlags flags, gboolean in_session)
 {
@@ -2221,16 +3369,7 @@ void search_find_usage(const gchar *search_text, const gchar *original_search_te
 		count = find_document_usage(doc, search_text, flags);
 	}
 	else
-	{
-		guint i;
-		for (i = 0; i < documents_array->len; i++)
-		{
-			if (documents[i]->is_valid)
-			{
-				count += find_document_usage(documents[i], search_text, flags);
-			}
-		}
-	}
+		count = find_session_usage(search_text, flags);
 
 	if (count == 0) /* no matches were found */
 	{
@@ -2249,9 +3388,55 @@ void search_find_usage(const gchar *search_text, const gchar *original_search_te
 }
 
 
+/* number of matches from which search_replace_range() replaces them all at once */
+#define BULK_REPLACE_MIN_MATCHES 100
+
+/* Replaces all matches by a single replacement of the text from the first to the last match,
+ * as many separate replacements are slow because each one moves the text after it,
+ * is recorded for undo and notified to the listeners for text changes. */
+static gint replace_matches_at_once(ScintillaObject *sci, struct Sci_TextToFind *ttf,
+		GSList *matches, const gchar *replace_text)
+{
+	GeanyMatchInfo *first = matches->data;
+	GeanyMatchInfo *last = g_slist_last(matches)->data;
+	gchar *text = sci_get_contents_range(sci, first->start, last->end);
+	GString *str = g_string_sized_new(last->end - first->start);
+	gint pos = first->start;
+	gint count = 0;
+	GSList *match;
+
+	foreach_slist (match, matches)
+	{
+		GeanyMatchInfo *info = match->data;
+		gchar *replacement = get_replace_text(info, replace_text);
+
+		g_string_append_len(str, text + pos - first->start, info->start - pos);
+		/* on last match, update the last match position */
+		if (! match->next)
+			ttf->chrg.cpMin = first->start + str->len;
+		g_string_append(str, replacement);
+		pos = info->end;
+		count++;
+
+		g_free(replacement);
+	}
+
+	sci_set_target_start(sci, first->start);
+	sci_set_target_end(sci, last->end);
+	SSM(sci, SCI_REPLACETARGET, str->len, (sptr_t) str->str);
+	/* update the new range end */
+	ttf->chrg.cpMax += str->len - (last->end - first->start);
+
+	g_string_free(str, TRUE);
+	g_free(text);
+	return count;
+}
+
+
 /* ttf is updated to include the last match position (ttf->chrg.cpMin) and
  * the new search range end (ttf->chrg.cpMax).
  * Note: Normally you would call sci_start/end_undo_action() around this call. */
+GEANY_EXPORT_SYMBOL
 guint search_replace_range(ScintillaObject *sci, struct Sci_TextToFind *ttf,
 		GeanyFindFlags flags, const gchar *replace_text)
 {
@@ -2264,28 +3449,33 @@ guint search_replace_range(ScintillaObject *sci, struct Sci_TextToFind *ttf,
 		return 0;
 
 	matches = find_range(sci, flags, ttf);
-	foreach_slist (match, matches)
+	/* few replacements are done one by one to keep the markers, folds and indicators between
+	 * them, which are lost for the text replaced at once */
+	if (g_slist_length(matches) >= BULK_REPLACE_MIN_MATCHES)
+		count = replace_matches_at_once(sci, ttf, matches, replace_text);
+	else
 	{
-		GeanyMatchInfo *info = match->data;
-		gint replace_len;
+		foreach_slist (match, matches)
+		{
+			GeanyMatchInfo *info = match->data;
+			gint replace_len;
 
-		info->start += offset;
-		info->end += offset;
+			info->start += offset;
+			info->end += offset;
 
-		replace_len = search_replace_match(sci, info, replace_text);
-		offset += replace_len - (info->end - info->start);
-		count ++;
+			replace_len = search_replace_match(sci, info, replace_text);
+			offset += replace_len - (info->end - info->start);
+			count ++;
 
-		/* on last match, update the last match/new range end */
-		if (! match->next)
-		{
-			ttf->chrg.cpMin = info->start;
-			ttf->chrg.cpMax += offset;
+			/* on last match, update the last match/new range end */
+			if (! match->next)
+			{
+				ttf->chrg.cpMin = info->start;
+				ttf->chrg.cpMax += offset;
+			}
 		}
-
-		geany_match_info_free(info);
 	}
-	g_slist_free(matches);
+	g_slist_free_full(matches, (GDestroyNotify) geany_match_info_free);
 
 	return count;
 }
@@ -61,6 +61,7 @@ typedef struct GeanySearchPrefs
 	gboolean	hide_find_dialog;		/* hide the find dialog on next or previous */
 	gboolean	replace_and_find_by_default;	/* enter in replace window performs Replace & Find instead of Replace */
 	GeanyFindSelOptions find_selection_type;
+	gboolean	builtin_find_in_files;	/* search files without grep (hidden pref) */
 }
 GeanySearchPrefs;
 
@@ -78,7 +78,11 @@ enum
 };
 
 static GtkTreeStore *store_openfiles;
+/* get_doc_folder() of the directory rows of store_openfiles -> GtkTreeRowReference */
+static GHashTable *openfiles_dirs = NULL;
 static GtkWidget *openfiles_popup_menu;
+/* whether the tree view of store_openfiles is detached from it, see sidebar_openfiles_freeze() */
+static gboolean openfiles_frozen = FALSE;
 static GtkWidget *tag_window;	/* scrolled window that holds the symbol list GtkTreeView */
 
 /* callback prototypes */
@@ -94,6 +98,42 @@ static void sidebar_tabs_show_hide(GtkNotebook *notebook, GtkWidget *child,
 								   guint page_num, gpointer data);
 
 
+static gboolean taglist_query_tooltip_cb(GtkWidget *widget, gint x, gint y,
+		gboolean keyboard_tip, GtkTooltip *tooltip, gpointer data)
+{
+	GtkTreeView *tree_view = GTK_TREE_VIEW(widget);
+	GeanyDocument *doc = document_get_current();
+	GtkTreeModel *model;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	TMTag *tag;
+	gchar *text = NULL;
+
+	if (doc == NULL || doc->priv->tag_tree != widget)
+		return FALSE;
+
+	if (! gtk_tree_view_get_tooltip_context(tree_view, &x, &y, keyboard_tip, &model, &path, &iter))
+		return FALSE;
+
+	/* tooltips are formatted only when shown, not for every row on each update */
+	gtk_tree_model_get(model, &iter, SYMBOLS_COLUMN_TAG, &tag, -1);
+	if (tag)
+	{
+		text = symbols_get_tag_tooltip(doc, tag);
+		tm_tag_unref(tag);
+	}
+	if (text)
+	{
+		gtk_tooltip_set_text(tooltip, text);
+		gtk_tree_view_set_tooltip_row(tree_view, tooltip, path);
+		g_free(text);
+	}
+	gtk_tree_path_free(path);
+
+	return text != NULL;
+}
+
+
 /* the prepare_* functions are document-related, but I think they fit better here than in document.c */
 static void prepare_taglist(GtkWidget *tree, GtkTreeStore *store)
 {
@@ -131,7 +171,9 @@ static void prepare_taglist(GtkWidget *tree, GtkTreeStore *store)
 	if (! interface_prefs.show_symbol_list_expanders)
 		gtk_tree_view_set_level_indentation(GTK_TREE_VIEW(tree), 10);
 	/* Tooltips */
-	ui_tree_view_set_tooltip_text_column(GTK_TREE_VIEW(tree), SYMBOLS_COLUMN_TOOLTIP);
+	g_signal_connect(tree, "query-tooltip",
+		G_CALLBACK(taglist_query_tooltip_cb), NULL);
+	gtk_widget_set_has_tooltip(tree, TRUE);
 
 	/* selection handling */
 	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(tree));
@@ -196,6 +238,11 @@ static void lsp_symbol_request_cb(gpointer user_data)
 
 	if (doc == document_get_current())
 		doc->has_tags = symbols_recreate_tag_list(doc, SYMBOLS_SORT_USE_PREVIOUS);
+	else
+	{
+		/* rebuilt when doc is shown again */
+		doc->priv->tag_tree_dirty = TRUE;
+	}
 
 	change_tree(doc, doc->has_tags ? doc->priv->tag_tree : tv.default_tag_tree);
 }
@@ -209,8 +256,10 @@ void sidebar_update_tag_list(GeanyDocument *doc, gboolean update)
 	if (update && doc != NULL)
 		doc->priv->tag_tree_dirty = TRUE;
 
-	if (gtk_notebook_get_current_page(GTK_NOTEBOOK(main_widgets.sidebar_notebook)) != TREEVIEW_SYMBOL)
-		return; /* don't bother updating symbol tree if we don't see it */
+	/* don't bother updating symbol tree if we don't see it, it is updated when shown */
+	if (! ui_prefs.sidebar_visible ||
+		gtk_notebook_get_current_page(GTK_NOTEBOOK(main_widgets.sidebar_notebook)) != TREEVIEW_SYMBOL)
+		return;
 
 	if (tv.default_tag_tree == NULL)
 		create_default_tag_tree();
@@ -225,7 +274,7 @@ void sidebar_update_tag_list(GeanyDocument *doc, gboolean update)
 	if (doc->priv->tag_tree == NULL)
 	{
 		doc->priv->tag_store = gtk_tree_store_new(
-			SYMBOLS_N_COLUMNS, GDK_TYPE_PIXBUF, G_TYPE_STRING, TM_TYPE_TAG, G_TYPE_STRING);
+			SYMBOLS_N_COLUMNS, GDK_TYPE_PIXBUF, G_TYPE_STRING, TM_TYPE_TAG);
 		doc->priv->tag_tree = gtk_tree_view_new();
 		prepare_taglist(doc->priv->tag_tree, doc->priv->tag_store);
 		gtk_widget_show(doc->priv->tag_tree);
@@ -300,6 +349,11 @@ GtkTreeStore *sidebar_create_store_openfiles(void)
 	gtk_tree_sortable_set_sort_func(sortable, DOCUMENTS_SHORTNAME, documents_sort_func, NULL, NULL);
 	gtk_tree_sortable_set_sort_column_id(sortable, DOCUMENTS_SHORTNAME, GTK_SORT_ASCENDING);
 
+	if (openfiles_dirs)
+		g_hash_table_destroy(openfiles_dirs);
+	openfiles_dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify) gtk_tree_row_reference_free);
+
 	store_openfiles = store;
 	return store;
 }
@@ -573,6 +627,17 @@ static gchar *parent_dir_name(GtkTreeStore *tree, GtkTreeIter *parent, const gch
 }
 
 
+/* Remembers a directory row so get_parent_for_file() doesn't have to walk the whole tree */
+static void add_dir_row(GtkTreeStore *tree, GtkTreeIter *iter, const gchar *path)
+{
+	GtkTreePath *tree_path = gtk_tree_model_get_path(GTK_TREE_MODEL(tree), iter);
+
+	g_hash_table_insert(openfiles_dirs, get_doc_folder(path),
+		gtk_tree_row_reference_new(GTK_TREE_MODEL(tree), tree_path));
+	gtk_tree_path_free(tree_path);
+}
+
+
 static void tree_copy_node(GtkTreeStore *tree, GtkTreeIter *new_node, GtkTreeIter *node, GtkTreeIter *parent_new)
 {
 	GIcon *icon;
@@ -606,6 +671,8 @@ static void tree_copy_node(GtkTreeStore *tree, GtkTreeIter *new_node, GtkTreeIte
 	                   DOCUMENTS_FILENAME,  filename,
 	                   DOCUMENTS_FOLD,      fold,
 	                   -1);
+	if (!doc)
+		add_dir_row(tree, new_node, filename);
 	g_free(filename);
 	g_free(shortname);
 	if (color)
@@ -665,6 +732,7 @@ static void tree_add_new_dir(GtkTreeStore *tree, GtkTreeIter *child, GtkTreeIter
 	                   DOCUMENTS_SHORTNAME, dirname,
 	                   DOCUMENTS_FOLD,      TRUE, /* GTK inserts folded by default, caller may expand */
 	                   -1);
+	add_dir_row(tree, child, file);
 
 	g_free(dirname);
 }
@@ -720,6 +788,7 @@ typedef struct TreeForeachData {
 	gchar *needle;
 	gsize best_len;
 	gsize needle_len;
+	gint best_depth;
 	GtkTreeIter best_iter;
 	enum {
 		TREE_CASE_NONE,
@@ -731,34 +800,21 @@ typedef struct TreeForeachData {
 } TreeForeachData;
 
 
-static gboolean tree_foreach_callback(GtkTreeModel *model,
-                                      GtkTreePath *path,
-                                      GtkTreeIter *iter,
-                                      gpointer user_data)
+/* Checks the directory row at iter, name being its get_doc_folder() */
+static void tree_check_dir_row(TreeForeachData *data, const gchar *name, GtkTreeIter *iter,
+                               gint depth)
 {
-	gchar *name;
-	gchar *dirname;
 	guint diff;
 	gsize name_len;
-	GeanyDocument *doc;
-	TreeForeachData *data = (TreeForeachData*) user_data;
-
-	gtk_tree_model_get(model, iter, DOCUMENTS_FILENAME, &name, DOCUMENTS_DOCUMENT, &doc, -1);
-
-	if (doc) /* skip documents */
-		goto finally;
-
-	dirname = get_doc_folder(name);
-	if (dirname)
-		SETPTR(name, dirname);
 
 	diff = pathcmp(name, data->needle);
 	name_len = strlen(name);
 
 	if (diff == 0)
-		goto finally;
+		return;
 
-	if (data->best_len < diff)
+	/* the topmost row wins a tie, as it would when walking the tree */
+	if (data->best_len < diff || (data->best_len == diff && depth < data->best_depth))
 	{
 		gint best_case;
 		gboolean tree = interface_prefs.openfiles_path_mode == OPENFILES_PATHS_TREE;
@@ -777,14 +833,52 @@ static gboolean tree_foreach_callback(GtkTreeModel *model,
 		else if (tree)
 			best_case = TREE_CASE_HAVE_SAME_PARENT;
 		else
-			goto finally;
+			return;
 		data->best_len = diff;
+		data->best_depth = depth;
 		data->best_case = best_case;
 		data->best_iter = *iter;
 	}
-finally:
-	g_free(name);
-	return FALSE;
+}
+
+
+static void tree_find_best_dir(GtkTreeModel *model, TreeForeachData *data)
+{
+	GtkTreeRowReference *ref;
+	GHashTableIter hash_iter;
+	gpointer key, value;
+
+	/* the usual case: the directory row already exists */
+	ref = g_hash_table_lookup(openfiles_dirs, data->needle);
+	if (ref && gtk_tree_row_reference_valid(ref))
+	{
+		GtkTreePath *path = gtk_tree_row_reference_get_path(ref);
+
+		gtk_tree_model_get_iter(model, &data->best_iter, path);
+		data->best_len = data->needle_len;
+		data->best_case = TREE_CASE_EQUALS;
+		gtk_tree_path_free(path);
+		return;
+	}
+
+	g_hash_table_iter_init(&hash_iter, openfiles_dirs);
+	while (g_hash_table_iter_next(&hash_iter, &key, &value))
+	{
+		GtkTreePath *path;
+		GtkTreeIter iter;
+
+		/* the row was removed */
+		if (!gtk_tree_row_reference_valid(value))
+		{
+			g_hash_table_iter_remove(&hash_iter);
+			continue;
+		}
+
+		path = gtk_tree_row_reference_get_path(value);
+		gtk_tree_model_get_iter(model, &iter, path);
+		tree_check_dir_row(data, key, &iter, gtk_tree_path_get_depth(path));
+		gtk_tree_path_free(path);
+	}
 }
 
 
@@ -797,7 +891,7 @@ static gboolean get_parent_for_file(GtkTreeStore *tree, const gchar *file, GtkTr
 	gint name_diff = 0;
 	gboolean has_parent;
 	GtkTreeModel *model = GTK_TREE_MODEL(tree);
-	TreeForeachData data = {NULL, 0, 0, {0}, TREE_CASE_NONE};
+	TreeForeachData data = {NULL, 0, 0, 0, {0}, TREE_CASE_NONE};
 	gboolean new_row;
 
 	path = g_path_get_dirname(file);
@@ -806,7 +900,7 @@ static gboolean get_parent_for_file(GtkTreeStore *tree, const gchar *file, GtkTr
 	data.needle = get_doc_folder(path);
 	data.needle_len = strlen(data.needle);
 	name_diff = strlen(path) - data.needle_len;
-	gtk_tree_model_foreach(model, tree_foreach_callback, (gpointer)&data);
+	tree_find_best_dir(model, &data);
 
 	switch (data.best_case)
 	{
@@ -885,6 +979,9 @@ static void expand_iter(GtkTreeIter *iter)
 {
 	GtkTreePath *path;
 
+	if (openfiles_frozen)
+		return;
+
 	path = gtk_tree_model_get_path(GTK_TREE_MODEL(store_openfiles), iter);
 	gtk_tree_view_expand_to_path(GTK_TREE_VIEW(tv.tree_openfiles), path);
 	gtk_tree_path_free(path);
@@ -1019,13 +1116,20 @@ void sidebar_openfiles_update(GeanyDocument *doc)
 
 void sidebar_openfiles_update_all(void)
 {
+	GtkTreeSortable *sortable = GTK_TREE_SORTABLE(store_openfiles);
 	guint i;
 
 	gtk_tree_store_clear(store_openfiles);
+	g_hash_table_remove_all(openfiles_dirs);
+
+	/* sort once after adding all the documents rather than on every insertion */
+	gtk_tree_sortable_set_sort_column_id(sortable,
+		GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID, GTK_SORT_ASCENDING);
 	foreach_document (i)
 	{
 		sidebar_openfiles_add(documents[i]);
 	}
+	gtk_tree_sortable_set_sort_column_id(sortable, DOCUMENTS_SHORTNAME, GTK_SORT_ASCENDING);
 }
 
 
@@ -1043,6 +1147,19 @@ void sidebar_remove_document(GeanyDocument *doc)
 }
 
 
+/* Detaches the open files from their tree view so removing many of them doesn't
+ * update the view for each one. Rows added meanwhile aren't expanded. */
+void sidebar_openfiles_freeze(gboolean freeze)
+{
+	if (G_UNLIKELY(! tv.tree_openfiles) || freeze == openfiles_frozen)
+		return;
+
+	openfiles_frozen = freeze;
+	gtk_tree_view_set_model(GTK_TREE_VIEW(tv.tree_openfiles),
+		freeze ? NULL : GTK_TREE_MODEL(store_openfiles));
+}
+
+
 static void on_hide_sidebar(void)
 {
 	ui_prefs.sidebar_visible = FALSE;
@@ -1308,7 +1425,7 @@ static void document_action(GeanyDocument *doc, gint action)
 		}
 		case OPENFILES_ACTION_SAVE:
 		{
-			document_save_file(doc, FALSE);
+			document_save_file_async(doc, FALSE);
 			break;
 		}
 		case OPENFILES_ACTION_RELOAD:
@@ -46,7 +46,6 @@ enum
 	SYMBOLS_COLUMN_ICON,
 	SYMBOLS_COLUMN_NAME,
 	SYMBOLS_COLUMN_TAG,
-	SYMBOLS_COLUMN_TOOLTIP,
 	SYMBOLS_N_COLUMNS
 };
 
@@ -85,6 +84,8 @@ void sidebar_select_openfiles_item(GeanyDocument *doc);
 
 void sidebar_remove_document(GeanyDocument *doc);
 
+void sidebar_openfiles_freeze(gboolean freeze);
+
 void sidebar_add_common_menu_items(GtkMenu *menu);
 
 void sidebar_focus_openfiles_tab(void);
@@ -39,7 +39,10 @@
  * The command window is only available on Windows and takes no additional data, instead it
  * writes back a Windows handle (HWND) for the main window to set it to the foreground (focus).
  *
- * At the moment the commands window, doclist, open, openro, line and column are available.
+ * At the moment the commands window, doclist, open, openro, openfiles, openfilesro, line and
+ * column are available. openfiles and openfilesro take the same data as open and openro, but the
+ * files are opened together like the session files (see main_handle_filenames()). Older
+ * instances treat them like open.
  *
  * About the socket files on Unix-like systems:
  * Geany creates a socket in /tmp (or any other directory returned by g_get_tmp_dir()) and
@@ -150,9 +153,9 @@ static void send_open_command(gint sock, gint argc, gchar **argv)
 	}
 
 	if (cl_options.readonly) /* append "ro" to denote readonly status for new docs */
-		socket_fd_write_all(sock, "openro\n", 7);
+		socket_fd_write_all(sock, "openfilesro\n", 12);
 	else
-		socket_fd_write_all(sock, "open\n", 5);
+		socket_fd_write_all(sock, "openfiles\n", 10);
 
 	for (i = 1; i < argc && argv[i] != NULL; i++)
 	{
@@ -616,7 +619,7 @@ static void socket_init_win32(void)
 #endif
 
 
-static void handle_input_filename(const gchar *buf)
+static gchar *get_input_filename(const gchar *buf)
 {
 	gchar *utf8_filename, *locale_filename;
 
@@ -627,18 +630,56 @@ static void handle_input_filename(const gchar *buf)
 		utf8_filename = g_strdup(buf);
 
 	locale_filename = utils_get_locale_from_utf8(utf8_filename);
-	if (locale_filename)
+	g_free(utf8_filename);
+	return locale_filename;
+}
+
+
+static gboolean handle_input_project(const gchar *locale_filename)
+{
+	if (! g_str_has_suffix(locale_filename, ".geany"))
+		return FALSE;
+
+	if (project_ask_close())
+		main_load_project_from_command_line(locale_filename, TRUE);
+	return TRUE;
+}
+
+
+static void handle_input_filename(const gchar *buf)
+{
+	gchar *locale_filename = get_input_filename(buf);
+
+	if (locale_filename && ! handle_input_project(locale_filename))
+		main_handle_filename(locale_filename);
+	g_free(locale_filename);
+}
+
+
+/* Reads the files of an openfiles command and opens them at once. Projects are opened
+ * while reading. */
+static void handle_input_filenames(gint sock)
+{
+	GPtrArray *filenames = g_ptr_array_new_with_free_func(g_free);
+	gchar buf[BUFFER_LENGTH];
+
+	while (socket_fd_gets(sock, buf, sizeof(buf)) != -1 && *buf != '.')
 	{
-		if (g_str_has_suffix(locale_filename, ".geany"))
-		{
-			if (project_ask_close())
-				main_load_project_from_command_line(locale_filename, TRUE);
-		}
+		gsize buf_len = strlen(buf);
+		gchar *locale_filename;
+
+		/* remove trailing newline */
+		if (buf_len > 0 && buf[buf_len - 1] == '\n')
+			buf[buf_len - 1] = '\0';
+
+		locale_filename = get_input_filename(buf);
+		if (locale_filename && ! handle_input_project(locale_filename))
+			g_ptr_array_add(filenames, locale_filename);
 		else
-			main_handle_filename(locale_filename);
+			g_free(locale_filename);
 	}
-	g_free(utf8_filename);
-	g_free(locale_filename);
+	main_handle_filenames(filenames);
+	g_ptr_array_free(filenames, TRUE);
 }
 
 
@@ -677,7 +718,13 @@ gboolean socket_lock_input_cb(GIOChannel *source, GIOCondition condition, gpoint
 		command = g_strdup(buf);
 		geany_debug("Received IPC command from remote instance: %s", g_strstrip(command));
 		g_free(command);
-		if (strncmp(buf, "open", 4) == 0)
+		if (strncmp(buf, "openfiles", 9) == 0)
+		{
+			cl_options.readonly = strncmp(buf+9, "ro", 2) == 0; /* open in readonly? */
+			handle_input_filenames(sock);
+			popup = TRUE;
+		}
+		else if (strncmp(buf, "open", 4) == 0)
 		{
 			cl_options.readonly = strncmp(buf+4, "ro", 2) == 0; /* open in readonly? */
 			while (socket_fd_gets(sock, buf, sizeof(buf)) != -1 && *buf != '.')
@@ -78,8 +78,13 @@
 /* Each 4KB under Windows seem to come in 2 portions, so 2K + 2K is more
    balanced than 4095 + 1. May be different on the latest Windows/glib? */
 # define DEFAULT_IO_LENGTH 2048
+/* looping blocks under Windows */
+# define MAX_READS_PER_WATCH 1
 #else
 # define DEFAULT_IO_LENGTH 4096
+/* the pipes are non-blocking, and a child writing a lot is less often held up by a full pipe
+   if several portions are read per call */
+# define MAX_READS_PER_WATCH 16
 
 /* helper function that cuts glib citing of the original text on bad quoting: it may be long,
    and only the caller knows whether it's UTF-8. Thought we lose the ' or " failed info. */
@@ -843,6 +848,7 @@ typedef struct _SpawnChannelData
 	/* stdout/stderr only */
 	GString *buffer;       /* NULL if recursive */
 	GString *line_buffer;  /* NULL if char buffered */
+	gboolean lines;        /* pass all the complete lines read at once */
 	gsize max_length;
 	/* stdout/stderr: fix continuous empty G_IO_IN-s for recursive channels */
 	guint empty_gio_ins;
@@ -915,9 +921,9 @@ static gboolean spawn_read_cb(GIOChannel *channel, GIOCondition condition, gpoin
 	GIOCondition failure_cond = condition & SPAWN_IO_FAILURE;
 	GIOStatus status = G_IO_STATUS_NORMAL;
 	/*
-	 * - Normally, read only once. With IO watches, our data processing must be immediate,
-	 *   which may give the child time to emit more data, and a read loop may combine it into
-	 *   large stdout and stderr portions. Under Windows, looping blocks.
+	 * - Normally, read only a few times. With IO watches, our data processing must be
+	 *   immediate, which may give the child time to emit more data, and a read loop may
+	 *   combine it into large stdout and stderr portions. Under Windows, looping blocks.
 	 * - On failure, read in a loop. It won't block now, there will be no more data, and the
 	 *   IO watch is not guaranteed to be called again (under Windows this is the last call).
 	 * - When using timeout callbacks, read in a loop. Otherwise, the input processing will
@@ -926,6 +932,7 @@ static gboolean spawn_read_cb(GIOChannel *channel, GIOCondition condition, gpoin
 	if (input_cond)
 	{
 		gsize chars_read;
+		guint reads = 0;
 
 		if (line_buffer)
 		{
@@ -934,33 +941,57 @@ static gboolean spawn_read_cb(GIOChannel *channel, GIOCondition condition, gpoin
 			while ((status = g_io_channel_read_chars(channel, line_buffer->str + n,
 				DEFAULT_IO_LENGTH, &chars_read, NULL)) == G_IO_STATUS_NORMAL)
 			{
+				gsize start = 0;  /* of the current line */
+
 				g_string_set_size(line_buffer, n + chars_read);
 
 				while (n < line_buffer->len)
 				{
 					gsize line_len = 0;
 
-					if (n == sc->max_length)
-						line_len = n;
+					if (n - start == sc->max_length)
+						line_len = n - start;
 					else if (strchr("\n", line_buffer->str[n]))  /* '\n' or '\0' */
-						line_len = n + 1;
+						line_len = n - start + 1;
 					else if (n < line_buffer->len - 1 && line_buffer->str[n] == '\r')
-						line_len = n + 1 + (line_buffer->str[n + 1] == '\n');
+						line_len = n - start + 1 + (line_buffer->str[n + 1] == '\n');
 
 					if (!line_len)
 						n++;
 					else
 					{
-						g_string_append_len(buffer, line_buffer->str, line_len);
-						g_string_erase(line_buffer, 0, line_len);
-						/* input only, failures are reported separately below */
-						sc->cb.read(buffer, input_cond, sc->cb_data);
-						g_string_truncate(buffer, 0);
-						n = 0;
+						g_string_append_len(buffer, line_buffer->str + start, line_len);
+						/* a recursive call may read into the line buffer, so it must not
+						   see the line any more */
+						if (sc->buffer)
+							start += line_len;
+						else
+							g_string_erase(line_buffer, 0, line_len);
+
+						if (sc->lines)
+						{
+							if (buffer->str[buffer->len - 1] != '\0')
+								g_string_append_c(buffer, '\0');
+						}
+						else
+						{
+							/* input only, failures are reported separately below */
+							sc->cb.read(buffer, input_cond, sc->cb_data);
+							g_string_truncate(buffer, 0);
+						}
+						n = start;
 					}
 				}
+				if (buffer->len)  /* the lines for lines mode */
+				{
+					sc->cb.read(buffer, input_cond, sc->cb_data);
+					g_string_truncate(buffer, 0);
+				}
+				/* keep only the incomplete line, once for all the complete ones */
+				g_string_erase(line_buffer, 0, start);
+				n -= start;
 
-				if (SPAWN_CHANNEL_GIO_WATCH(sc) && !failure_cond)
+				if (SPAWN_CHANNEL_GIO_WATCH(sc) && !failure_cond && ++reads >= MAX_READS_PER_WATCH)
 					break;
 			}
 		}
@@ -973,7 +1004,7 @@ static gboolean spawn_read_cb(GIOChannel *channel, GIOCondition condition, gpoin
 				/* input only, failures are reported separately below */
 				sc->cb.read(buffer, input_cond, sc->cb_data);
 
-				if (SPAWN_CHANNEL_GIO_WATCH(sc) && !failure_cond)
+				if (SPAWN_CHANNEL_GIO_WATCH(sc) && !failure_cond && ++reads >= MAX_READS_PER_WATCH)
 					break;
 			}
 		}
@@ -1232,6 +1263,7 @@ gboolean spawn_with_callbacks(const gchar *working_directory, const gchar *comma
 				{
 					sc->line_buffer = g_string_sized_new(sc->max_length +
 						DEFAULT_IO_LENGTH);
+					sc->lines = (spawn_flags & ((SPAWN_STDOUT_LINES >> 1) << i)) != 0;
 				}
 
 				sc->empty_gio_ins = 0;
@@ -59,7 +59,11 @@ typedef enum
 	SPAWN_STDIN_RECURSIVE      = 0x08,  /**< The stdin callback is recursive. */
 	SPAWN_STDOUT_RECURSIVE     = 0x10,  /**< The stdout callback is recursive. */
 	SPAWN_STDERR_RECURSIVE     = 0x20,  /**< The stderr callback is recursive. */
-	SPAWN_RECURSIVE            = 0x38   /**< All callbacks are recursive. */
+	SPAWN_RECURSIVE            = 0x38,  /**< All callbacks are recursive. */
+	/* line buffered modes passing several lines at once */
+	SPAWN_STDOUT_LINES         = 0x40,  /**< stdout is passed in lines. @since 2.1 (GEANY_API_VERSION 251) */
+	SPAWN_STDERR_LINES         = 0x80,  /**< stderr is passed in lines. @since 2.1 (GEANY_API_VERSION 251) */
+	SPAWN_LINES                = 0xC0   /**< stdout/stderr are passed in lines. @since 2.1 (GEANY_API_VERSION 251) */
 } SpawnFlags;
 
 /**
@@ -71,6 +75,10 @@ typedef enum
  *  cases, the @a string will be terminated with a nul character that is not part of the data
  *  at @a string->len.
  *
+ *  In lines mode, the @a string contains all the complete lines read at once, each followed by
+ *  a nul (the line termination character if it is a nul), so that the lines can be walked with
+ *  @c strlen(). This saves a call per line with plenty of output.
+ *
  *  If @c G_IO_IN or @c G_IO_PRI are set, the @a string will contain at least one character.
  *
  *  @param string contains the child data if @c G_IO_IN or @c G_IO_PRI are set.
@@ -0,0 +1,252 @@
+/*
+ *      stallwatch.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2023 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Detection of stalls of the main loop, to find out what freezes the UI.
+ *
+ * A high priority timeout measures how late the main loop runs it. Code which
+ * may take long, such as signal handlers and tag parsing, is marked with
+ * stallwatch_enter() and stallwatch_leave(), and the marked scope which took
+ * most of a stall, not counting the scopes nested in it, is logged as its
+ * culprit. As a hang may never end, a monitor thread also logs the scope the
+ * main thread is in while it doesn't respond for long.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "stallwatch.h"
+
+#include "keyfile.h"
+#include "stash.h"
+
+#include <glib.h>
+
+
+/* deeper nested scopes are counted but not tracked */
+#define STALL_MAX_DEPTH 32
+/* the monitor thread logs a stall still going on after this many thresholds */
+#define STALL_HANG_FACTOR 5
+
+
+typedef struct
+{
+	const gchar *name;	/* read by the monitor thread */
+	gint64 start;
+	gint64 nested_time;	/* spent in the scopes nested in this one */
+	guint beat;	/* heartbeat count at the start */
+}
+StallScope;
+
+static struct
+{
+	gint threshold;	/* in ms, 0 to disable - the stall_threshold pref */
+	gint64 interval;	/* of the heartbeat, in microseconds */
+	guint source_id;
+	guint beats;
+
+	StallScope scopes[STALL_MAX_DEPTH];
+	gint depth;	/* read by the monitor thread */
+	/* the scope with the longest own time since the last heartbeat */
+	const gchar *culprit;
+	gint64 culprit_time;
+
+	GThread *thread;
+	GMutex lock;
+	GCond cond;
+	/* protected by lock */
+	gint64 last_beat;
+	gboolean hang_reported;
+	gboolean quit;
+}
+watch;
+
+
+/** Marks the start of a scope which may block the main loop for long, so stalls
+ * of the main loop detected while Geany runs with the @c stall_threshold
+ * preference are attributed to it. Scopes can be nested and each one has to be
+ * ended with stallwatch_leave(). It is cheap, it does nothing when the detection
+ * is disabled. Only use it in the main thread.
+ *
+ * @param name The name of the scope, logged for the stalls caused by it. It has
+ * to stay valid while Geany runs, use g_intern_string() for dynamic names.
+ *
+ * @since 2.1 (GEANY_API_VERSION 254)
+ */
+GEANY_API_SYMBOL
+void stallwatch_enter(const gchar *name)
+{
+	gint depth;
+
+	if (! watch.source_id)
+		return;
+
+	depth = g_atomic_int_get(&watch.depth);
+	if (depth < STALL_MAX_DEPTH)
+	{
+		StallScope *scope = &watch.scopes[depth];
+
+		g_atomic_pointer_set(&scope->name, name);
+		scope->start = g_get_monotonic_time();
+		scope->nested_time = 0;
+		scope->beat = watch.beats;
+	}
+	g_atomic_int_set(&watch.depth, depth + 1);
+}
+
+
+/** Marks the end of the scope started by the last call of stallwatch_enter().
+ *
+ * @since 2.1 (GEANY_API_VERSION 254)
+ */
+GEANY_API_SYMBOL
+void stallwatch_leave(void)
+{
+	gint depth;
+
+	if (! watch.source_id)
+		return;
+
+	depth = g_atomic_int_get(&watch.depth) - 1;
+	/* the scope started before the detection */
+	if (depth < 0)
+		return;
+
+	/* a scope running a nested main loop, e.g. of a dialog, didn't stall it */
+	if (depth < STALL_MAX_DEPTH && watch.scopes[depth].beat == watch.beats)
+	{
+		StallScope *scope = &watch.scopes[depth];
+		gint64 duration = g_get_monotonic_time() - scope->start;
+
+		if (duration - scope->nested_time > watch.culprit_time)
+		{
+			watch.culprit = scope->name;
+			watch.culprit_time = duration - scope->nested_time;
+		}
+		if (depth > 0)
+			watch.scopes[depth - 1].nested_time += duration;
+	}
+	g_atomic_int_set(&watch.depth, depth);
+}
+
+
+static const gchar *get_current_scope(void)
+{
+	gint depth = g_atomic_int_get(&watch.depth);
+
+	if (depth <= 0)
+		return "unmarked code";
+	return g_atomic_pointer_get(&watch.scopes[MIN(depth, STALL_MAX_DEPTH) - 1].name);
+}
+
+
+static gboolean on_heartbeat(gpointer data)
+{
+	gint64 now = g_get_monotonic_time();
+	gint64 late;
+
+	g_mutex_lock(&watch.lock);
+	late = now - watch.last_beat - watch.interval;
+	watch.last_beat = now;
+	watch.hang_reported = FALSE;
+	g_mutex_unlock(&watch.lock);
+
+	if (late >= watch.threshold * G_TIME_SPAN_MILLISECOND)
+	{
+		if (watch.culprit)
+			g_warning("Main loop stalled for %d ms, %d ms of them in %s",
+				(gint) (late / G_TIME_SPAN_MILLISECOND),
+				(gint) (watch.culprit_time / G_TIME_SPAN_MILLISECOND), watch.culprit);
+		else
+			g_warning("Main loop stalled for %d ms in unmarked code",
+				(gint) (late / G_TIME_SPAN_MILLISECOND));
+	}
+
+	watch.beats++;
+	watch.culprit = NULL;
+	watch.culprit_time = 0;
+	return G_SOURCE_CONTINUE;
+}
+
+
+static gpointer monitor_thread(gpointer data)
+{
+	gint64 threshold = watch.threshold * G_TIME_SPAN_MILLISECOND;
+
+	g_mutex_lock(&watch.lock);
+	while (! watch.quit)
+	{
+		gint64 now = g_get_monotonic_time();
+		gint64 late = now - watch.last_beat - watch.interval;
+
+		if (late >= threshold * STALL_HANG_FACTOR && ! watch.hang_reported)
+		{
+			watch.hang_reported = TRUE;
+			g_warning("Main loop not responding for %d ms, currently in %s",
+				(gint) (late / G_TIME_SPAN_MILLISECOND), get_current_scope());
+		}
+		g_cond_wait_until(&watch.cond, &watch.lock, now + threshold);
+	}
+	g_mutex_unlock(&watch.lock);
+	return NULL;
+}
+
+
+void stallwatch_init(void)
+{
+	StashGroup *group = stash_group_new(PACKAGE);
+
+	configuration_add_various_pref_group(group, "debugging");
+	stash_group_add_integer(group, &watch.threshold, "stall_threshold", 0);
+}
+
+
+/* Starts the detection if enabled, once the startup is complete. */
+void stallwatch_start(void)
+{
+	if (watch.threshold <= 0 || watch.source_id)
+		return;
+
+	/* stalls are measured with the precision of the interval */
+	watch.interval = MAX(watch.threshold / 2, 10) * G_TIME_SPAN_MILLISECOND;
+	watch.last_beat = g_get_monotonic_time();
+	watch.source_id = g_timeout_add_full(G_PRIORITY_HIGH,
+		watch.interval / G_TIME_SPAN_MILLISECOND, on_heartbeat, NULL, NULL);
+	watch.thread = g_thread_new("stallwatch", monitor_thread, NULL);
+}
+
+
+void stallwatch_finalize(void)
+{
+	if (! watch.source_id)
+		return;
+
+	g_source_remove(watch.source_id);
+	watch.source_id = 0;
+
+	g_mutex_lock(&watch.lock);
+	watch.quit = TRUE;
+	g_cond_signal(&watch.cond);
+	g_mutex_unlock(&watch.lock);
+	g_thread_join(watch.thread);
+	watch.thread = NULL;
+}
@@ -105,6 +105,17 @@ static struct
 }
 symbol_menu;
 
+typedef struct
+{
+	GeanyFiletypeID ft_id;
+	TMParserType lang;
+	GSList *files;	/* locale file names */
+	GSList *tags;	/* the tags read from each file, NULL if it couldn't be read */
+}
+GlobalTagsLoad;
+
+static GThreadPool *global_tags_pool = NULL;
+
 static void load_user_tags(GeanyFiletypeID ft_id);
 
 /* get the tags_ignore list, exported by geany_lcpp.c */
@@ -175,7 +186,8 @@ static gboolean symbols_load_global_tags(const gchar *tags_file, GeanyFiletype *
 
 
 /* Ensure that the global tags file(s) for the file_type_idx filetype is loaded.
- * This provides autocompletion, calltips, etc. */
+ * This provides autocompletion, calltips, etc. The files are loaded in the
+ * background, so the tags may not be available yet on return. */
 void symbols_global_tags_loaded(guint file_type_idx)
 {
 	/* load ignore list for C/C++ parser */
@@ -306,58 +318,135 @@ static gint compare_symbol_lines(gconstpointer a, gconstpointer b)
 }
 
 
+/* Splits the symbol filter into its words, normalized and case folded once for
+ * all the tags. Empty words would match every tag so they are left out. */
+static GPtrArray *get_filter_words(const gchar *tag_filter)
+{
+	GPtrArray *words = g_ptr_array_new_with_free_func(g_free);
+	gchar **tf_strv = g_strsplit_set(tag_filter, " ", -1);
+	gchar **val;
+
+	foreach_strv(val, tf_strv)
+	{
+		gchar *normalized_val = g_utf8_normalize(*val, -1, G_NORMALIZE_ALL);
+
+		if (normalized_val != NULL && *normalized_val != '\0')
+			g_ptr_array_add(words, g_utf8_casefold(normalized_val, -1));
+		g_free(normalized_val);
+	}
+	g_strfreev(tf_strv);
+
+	return words;
+}
+
+
+/* strstr() ignoring the case of the ASCII haystack, word is in lower case already */
+static gboolean ascii_contains_folded(const gchar *haystack, const gchar *word)
+{
+	for (; *haystack != '\0'; haystack++)
+	{
+		const gchar *h = haystack;
+		const gchar *w = word;
+
+		while (*w != '\0' && g_ascii_tolower(*h) == *w)
+		{
+			h++;
+			w++;
+		}
+		if (*w == '\0')
+			return TRUE;
+	}
+	return *word == '\0';
+}
+
+
+/* Copies the qualified name of tag into buf if it fits, allocating it otherwise.
+ * Sets is_ascii if it only contains ASCII characters, which are folded by
+ * lowering their case, so no normalized copy is needed for most tags. */
+static gchar *get_full_tagname(const TMTag *tag, gchar *buf, gsize buf_len, gboolean *is_ascii)
+{
+	const gchar *sep = tag->scope ? tm_parser_scope_separator_printable(tag->lang) : "";
+	const gchar *scope = tag->scope ? tag->scope : "";
+	gsize scope_len = strlen(scope), sep_len = strlen(sep), name_len = strlen(tag->name);
+	gchar *full_tagname = buf;
+	const gchar *c;
+
+	if (scope_len + sep_len + name_len >= buf_len)
+		full_tagname = g_malloc(scope_len + sep_len + name_len + 1);
+
+	memcpy(full_tagname, scope, scope_len);
+	memcpy(full_tagname + scope_len, sep, sep_len);
+	memcpy(full_tagname + scope_len + sep_len, tag->name, name_len + 1);
+
+	*is_ascii = TRUE;
+	for (c = full_tagname; *c != '\0' && *is_ascii; c++)
+		*is_ascii = (guchar) *c < 0x80;
+
+	return full_tagname;
+}
+
+
+static gboolean tag_matches_filter(const TMTag *tag, GPtrArray *words)
+{
+	gchar buf[256];
+	gchar *case_normalized_tagname = NULL;
+	gchar *full_tagname;
+	gboolean is_ascii;
+	gboolean matches = TRUE;
+	guint i;
+
+	full_tagname = get_full_tagname(tag, buf, sizeof(buf), &is_ascii);
+	if (! is_ascii)
+	{
+		gchar *normalized_tagname = g_utf8_normalize(full_tagname, -1, G_NORMALIZE_ALL);
+
+		/* invalid UTF-8 names were never filtered out */
+		if (normalized_tagname == NULL)
+			words = NULL;
+		else
+			case_normalized_tagname = g_utf8_casefold(normalized_tagname, -1);
+		g_free(normalized_tagname);
+	}
+
+	for (i = 0; words && i < words->len && matches; i++)
+	{
+		const gchar *word = words->pdata[i];
+
+		if (is_ascii)
+			matches = ascii_contains_folded(full_tagname, word);
+		else
+			matches = strstr(case_normalized_tagname, word) != NULL;
+	}
+
+	g_free(case_normalized_tagname);
+	if (full_tagname != buf)
+		g_free(full_tagname);
+
+	return matches;
+}
+
+
 static GList *get_tag_list(GPtrArray *tags_array, gchar *tag_filter, TMTagType tag_types)
 {
 	GList *tag_names = NULL;
+	GPtrArray *words;
 	guint i;
-	gchar **tf_strv;
 
 	if (!tags_array)
 		return NULL;
 
-	tf_strv = g_strsplit_set(tag_filter, " ", -1);
+	words = get_filter_words(tag_filter);
 
 	for (i = 0; i < tags_array->len; ++i)
 	{
 		TMTag *tag = TM_TAG(tags_array->pdata[i]);
 
-		if (tag->type & tag_types)
-		{
-			gboolean filtered = FALSE;
-			gchar **val;
-			gchar *full_tagname = g_strconcat(tag->scope ? tag->scope : "",
-				tag->scope ? tm_parser_scope_separator_printable(tag->lang) : "",
-				tag->name, NULL);
-			gchar *normalized_tagname = g_utf8_normalize(full_tagname, -1, G_NORMALIZE_ALL);
-
-			foreach_strv(val, tf_strv)
-			{
-				gchar *normalized_val = g_utf8_normalize(*val, -1, G_NORMALIZE_ALL);
-
-				if (normalized_tagname != NULL && normalized_val != NULL)
-				{
-					gchar *case_normalized_tagname = g_utf8_casefold(normalized_tagname, -1);
-					gchar *case_normalized_val = g_utf8_casefold(normalized_val, -1);
-
-					filtered = strstr(case_normalized_tagname, case_normalized_val) == NULL;
-					g_free(case_normalized_tagname);
-					g_free(case_normalized_val);
-				}
-				g_free(normalized_val);
-
-				if (filtered)
-					break;
-			}
-			if (!filtered)
-				tag_names = g_list_prepend(tag_names, tag);
-
-			g_free(normalized_tagname);
-			g_free(full_tagname);
-		}
+		if ((tag->type & tag_types) && (words->len == 0 || tag_matches_filter(tag, words)))
+			tag_names = g_list_prepend(tag_names, tag);
 	}
 	tag_names = g_list_sort(tag_names, compare_symbol_lines);
 
-	g_strfreev(tf_strv);
+	g_ptr_array_free(words, TRUE);
 
 	return tag_names;
 }
@@ -440,12 +529,13 @@ static void tag_list_add_groups(GtkTreeStore *tree_store, TMParserType lang)
 		g_assert(title != NULL);
 		g_ptr_array_add(top_level_iter_names, (gchar *)title);
 
+		/* set the name together with the insertion so that a sorted tree can place
+		 * the new row right away */
 		if (!find_toplevel_iter(tree_store, iter, title))
-			gtk_tree_store_append(tree_store, iter, NULL);
-
-		if (icon)
+			gtk_tree_store_insert_with_values(tree_store, iter, NULL, -1,
+				SYMBOLS_COLUMN_ICON, icon, SYMBOLS_COLUMN_NAME, title, -1);
+		else if (icon)
 			gtk_tree_store_set(tree_store, iter, SYMBOLS_COLUMN_ICON, icon, -1);
-		gtk_tree_store_set(tree_store, iter, SYMBOLS_COLUMN_NAME, title, -1);
 	}
 }
 
@@ -572,6 +662,16 @@ static gchar *get_symbol_tooltip(GeanyDocument *doc, const TMTag *tag, gboolean
 }
 
 
+/* Returns the tooltip for a symbol tree row, formatted on demand rather than stored
+ * in the tree. */
+gchar *symbols_get_tag_tooltip(GeanyDocument *doc, const TMTag *tag)
+{
+	g_return_val_if_fail(DOC_VALID(doc), NULL);
+
+	return get_symbol_tooltip(doc, tag, FALSE, lsp_doc_symbols_available(doc));
+}
+
+
 static const gchar *get_parent_name(const TMTag *tag)
 {
 	return !EMPTY(tag->scope) ? tag->scope : NULL;
@@ -875,17 +975,33 @@ static void tags_table_value_free(gpointer data)
 }
 
 
+/* a row whose tag changed, see update_tree_tags() */
+typedef struct
+{
+	GtkTreeIter iter;
+	TMTag *tag;
+	gboolean top_level;
+} TreeRowUpdate;
+
+
 /*
  * Updates the tag tree for a document with the tags in *list.
  * @param doc a document
  * @param tags a pointer to a GList* holding the tags to add/update.  This
  *             list may be updated, removing updated elements.
+ * @param sorted whether the tree is already sorted in the wanted order.
+ * @return whether the tree has to be sorted after the update.
  *
  * The update is done in two passes:
  * 1) walking the current tree, update tags that still exist and remove the
  *    obsolescent ones;
  * 2) walking the remaining (non updated) tags, adds them in the list.
  *
+ * Rows are only changed when their tag changed, so the tree can stay sorted
+ * if only a few rows are touched: re-inserting them is cheaper than sorting
+ * the whole tree again. Tooltips are not stored in the tree, they are
+ * formatted when queried (see symbols_get_tag_tooltip()).
+ *
  * For better performances, we use 2 hash tables:
  * - one containing all the tags for lookup in the first pass (actually stores a
  *   reference in the tags list for removing it efficiently), avoiding list search
@@ -893,16 +1009,19 @@ static void tags_table_value_free(gpointer data)
  * - the other holding "tag-name":row references for tags having children, used to
  *   lookup for a parent in both passes, avoiding tree traversal.
  */
-static void update_tree_tags(GeanyDocument *doc, GList **tags)
+static gboolean update_tree_tags(GeanyDocument *doc, GList **tags, gboolean sorted)
 {
 	gboolean use_lsp = lsp_doc_symbols_available(doc);
 	GtkTreeStore *store = doc->priv->tag_store;
 	GtkTreeModel *model = GTK_TREE_MODEL(store);
 	GHashTable *parents_table;
 	GHashTable *tags_table;
+	GArray *updates;
 	GtkTreeIter iter;
 	gboolean cont;
 	GList *item;
+	guint n_tags = 0;
+	guint i;
 
 	/* Build hash tables holding tags and parents */
 	/* parent table is GHashTable<tag_name, GTree<line_num, GtkTreeIter>>
@@ -918,16 +1037,19 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 		const gchar *parent_name;
 
 		tags_table_insert(tags_table, tag, item);
+		n_tags++;
 
 		parent_name = get_parent_name(tag);
 		if (parent_name)
 			g_hash_table_insert(parents_table, g_strdup(parent_name), NULL);
 	}
 
-	/* First pass, update existing rows or delete them.
+	/* First pass, collect the rows to update and delete the obsolete ones.
 	 * It is OK to delete them since we walk top down so we would remove
 	 * parents before checking for their children, thus never implicitly
-	 * deleting an updated child */
+	 * deleting an updated child. Updates are only applied after the walk
+	 * because in a sorted tree they can move the rows around. */
+	updates = g_array_new(FALSE, FALSE, sizeof(TreeRowUpdate));
 	cont = gtk_tree_model_get_iter_first(model, &iter);
 	while (cont)
 	{
@@ -955,19 +1077,12 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 
 				if (!tm_tags_equal(tag, found))
 				{
-					gchar *name, *tooltip;
-
-					/* only update fields that (can) have changed (name that holds line
-					 * number, tooltip, and the tag itself) */
-					name = get_symbol_name(doc, found, parent_name == NULL, TRUE, use_lsp);
-					tooltip = get_symbol_tooltip(doc, found, FALSE, use_lsp);
-					gtk_tree_store_set(store, &iter,
-							SYMBOLS_COLUMN_NAME, name,
-							SYMBOLS_COLUMN_TOOLTIP, tooltip,
-							SYMBOLS_COLUMN_TAG, found,
-							-1);
-					g_free(name);
-					g_free(tooltip);
+					TreeRowUpdate update;
+
+					update.iter = iter;
+					update.tag = found;
+					update.top_level = parent_name == NULL;
+					g_array_append_val(updates, update);
 				}
 
 				update_parents_table(parents_table, found, &iter);
@@ -983,6 +1098,31 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 		}
 	}
 
+	/* re-inserting each changed row into a sorted tree walks its siblings,
+	 * so when there are many of them rather sort the whole tree again */
+	if (sorted && updates->len + g_list_length(*tags) > g_bit_storage(n_tags))
+	{
+		gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(store),
+			GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID, 0);
+		sorted = FALSE;
+	}
+
+	for (i = 0; i < updates->len; i++)
+	{
+		TreeRowUpdate *update = &g_array_index(updates, TreeRowUpdate, i);
+		gchar *name;
+
+		/* only update fields that (can) have changed (name that holds line
+		 * number, and the tag itself) */
+		name = get_symbol_name(doc, update->tag, update->top_level, TRUE, use_lsp);
+		gtk_tree_store_set(store, &update->iter,
+				SYMBOLS_COLUMN_NAME, name,
+				SYMBOLS_COLUMN_TAG, update->tag,
+				-1);
+		g_free(name);
+	}
+	g_array_free(updates, TRUE);
+
 	/* Second pass, now we have a tree cleaned up from invalid rows,
 	 * we simply add new ones */
 	foreach_list (item, *tags)
@@ -996,7 +1136,7 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 		if (use_lsp || parent_group)
 		{
 			gboolean expand;
-			gchar *name, *tooltip;
+			gchar *name;
 			const gchar *parent_name;
 			GdkPixbuf *icon;
 
@@ -1022,15 +1162,12 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 
 			/* insert the new element */
 			name = get_symbol_name(doc, tag, parent_name == NULL, TRUE, use_lsp);
-			tooltip = get_symbol_tooltip(doc, tag, FALSE, use_lsp);
 			gtk_tree_store_insert_with_values(store, &iter, parent, 0,
 					SYMBOLS_COLUMN_NAME, name,
-					SYMBOLS_COLUMN_TOOLTIP, tooltip,
 					SYMBOLS_COLUMN_ICON, icon,
 					SYMBOLS_COLUMN_TAG, tag,
 					-1);
 			g_free(name);
-			g_free(tooltip);
 			if (G_LIKELY(icon))
 				g_object_unref(icon);
 
@@ -1043,6 +1180,8 @@ static void update_tree_tags(GeanyDocument *doc, GList **tags)
 
 	g_hash_table_destroy(parents_table);
 	g_hash_table_destroy(tags_table);
+
+	return !sorted;
 }
 
 
@@ -1147,9 +1286,11 @@ static void sort_tree(GtkTreeStore *store, gboolean sort_by_name)
 }
 
 
+GEANY_EXPORT_SYMBOL
 gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode)
 {
 	gboolean use_lsp;
+	gboolean sorted;
 	GList *tags = NULL;
 
 	g_return_val_if_fail(DOC_VALID(doc), FALSE);
@@ -1174,22 +1315,26 @@ gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode)
 
 	/* FIXME: Not sure why we detached the model here? */
 
-	/* disable sorting during update because the code doesn't support correctly
-	 * models that are currently being built */
-	gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(doc->priv->tag_store), GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID, 0);
+	if (sort_mode == SYMBOLS_SORT_USE_PREVIOUS)
+		sort_mode = doc->priv->symbol_list_sort_mode;
+
+	/* keep the tree sorted during the update only if it already is in the wanted order,
+	 * otherwise disable sorting because the code doesn't support correctly models that
+	 * are currently being built */
+	sorted = sort_mode == doc->priv->symbol_list_sort_mode &&
+		gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(doc->priv->tag_store), NULL, NULL);
+	if (! sorted)
+		gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(doc->priv->tag_store), GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID, 0);
 
 	/* add grandparent type iters */
 	add_top_level_items(doc);
 
-	update_tree_tags(doc, &tags);
+	if (update_tree_tags(doc, &tags, sorted))
+		sort_tree(doc->priv->tag_store, sort_mode == SYMBOLS_SORT_BY_NAME);
 	g_list_free(tags);
 
 	hide_empty_rows(doc->priv->tag_store);
 
-	if (sort_mode == SYMBOLS_SORT_USE_PREVIOUS)
-		sort_mode = doc->priv->symbol_list_sort_mode;
-
-	sort_tree(doc->priv->tag_store, sort_mode == SYMBOLS_SORT_BY_NAME);
 	doc->priv->symbol_list_sort_mode = sort_mode;
 
 	return TRUE;
@@ -1221,7 +1366,8 @@ static GeanyFiletype *detect_global_tags_filetype(const gchar *utf8_filename)
  * the relevant path.
  * Example:
  * CFLAGS=-I/home/user/libname-1.x geany -g libname.d.tags libname.h */
-int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess)
+int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess,
+	gboolean want_binary, guint jobs)
 {
 	/* -E pre-process, -dD output user macros, -p prof info (?) */
 	const char pre_process[] = "gcc -E -dD -p -I.";
@@ -1262,7 +1408,7 @@ int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess
 		geany_debug("Generating %s tags file.", ft->name);
 		tm_get_workspace();
 		status = tm_workspace_create_global_tags(command, (const char **) (argv + 2),
-												 argc - 2, tags_file, ft->lang);
+												 argc - 2, tags_file, ft->lang, want_binary, jobs);
 		g_free(command);
 		symbols_finalize(); /* free c_tags_ignore data */
 		if (! status)
@@ -1372,12 +1518,92 @@ static void init_user_tags(void)
 }
 
 
+static void free_global_tags_load(GlobalTagsLoad *load)
+{
+	GSList *node;
+
+	for (node = load->tags; node != NULL; node = node->next)
+	{
+		if (node->data)
+			tm_tags_array_free(node->data, TRUE);
+	}
+	g_slist_free(load->tags);
+	g_slist_free_full(load->files, g_free);
+	g_free(load);
+}
+
+
+static gboolean finish_global_tags_load_idle(gpointer data)
+{
+	GlobalTagsLoad *load = data;
+	GeanyFiletype *ft = filetypes[load->ft_id];
+	GSList *file, *tags;
+	gboolean added = FALSE;
+	guint i;
+
+	/* the workspace is gone when quitting */
+	if (global_tags_pool == NULL)
+	{
+		free_global_tags_load(load);
+		return G_SOURCE_REMOVE;
+	}
+
+	for (file = load->files, tags = load->tags; file != NULL; file = file->next, tags = tags->next)
+	{
+		gsize old_tag_count = get_tag_count();
+
+		if (! tags->data)
+			continue;
+
+		tm_workspace_add_global_tags(tags->data);
+		tags->data = NULL;
+		added = TRUE;
+		geany_debug("Loaded %s (%s), %u symbol(s).", (gchar *) file->data, ft->name,
+			(guint) (get_tag_count() - old_tag_count));
+	}
+
+	/* the lexers highlight the global type names of the documents using them,
+	 * including C++ documents for the C tags */
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+
+		if (! added || ! tm_parser_langs_compatible(doc->file_type->lang, load->lang))
+			continue;
+
+		highlighting_set_styles(doc->editor->sci, doc->file_type);
+		SETPTR(doc->priv->keywords, NULL);
+		doc->priv->typename_generation = 0;
+		document_highlight_tags(doc);
+	}
+
+	free_global_tags_load(load);
+	return G_SOURCE_REMOVE;
+}
+
+
+static void load_global_tags_thread(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	GlobalTagsLoad *load = data;
+	GSList *node;
+
+	for (node = load->files; node != NULL; node = node->next)
+		load->tags = g_slist_prepend(load->tags, tm_workspace_read_global_tags(node->data, load->lang));
+	load->tags = g_slist_reverse(load->tags);
+
+	g_idle_add(finish_global_tags_load_idle, load);
+}
+
+
+/* Reads the tags files of ft_id in a worker thread, big tags files take seconds
+ * to read. The tags are added to the workspace once all files are read. */
 static void load_user_tags(GeanyFiletypeID ft_id)
 {
 	static guchar *tags_loaded = NULL;
 	static gboolean init_tags = FALSE;
 	const GSList *node;
 	GeanyFiletype *ft = filetypes[ft_id];
+	GlobalTagsLoad *load;
 
 	g_return_if_fail(ft_id > 0);
 
@@ -1393,12 +1619,20 @@ static void load_user_tags(GeanyFiletypeID ft_id)
 		init_tags = TRUE;
 	}
 
+	if (ft->priv->tag_files == NULL)
+		return;
+
+	load = g_new0(GlobalTagsLoad, 1);
+	load->ft_id = ft_id;
+	load->lang = ft->lang;
 	for (node = ft->priv->tag_files; node != NULL; node = g_slist_next(node))
-	{
-		const gchar *fname = node->data;
+		load->files = g_slist_prepend(load->files, g_strdup(node->data));
+	load->files = g_slist_reverse(load->files);
 
-		symbols_load_global_tags(fname, ft);
-	}
+	/* a single thread, so the tags are added in the order the filetypes were set */
+	if (global_tags_pool == NULL)
+		global_tags_pool = g_thread_pool_new(load_global_tags_thread, NULL, 1, FALSE, NULL);
+	g_thread_pool_push(global_tags_pool, load, NULL);
 }
 
 
@@ -1546,43 +1780,60 @@ static gint compare_tags_by_name_line(gconstpointer ptr1, gconstpointer ptr2)
 }
 
 
+/* Returns the first tag of the current file, else the first one of an open document,
+ * else the first one inside the current document's directory, or NULL.
+ * The tags are checked in a single pass, and as tags of the same file are usually
+ * adjacent, each file is only checked once for a run of its tags. */
 static TMTag *find_best_goto_tag(GeanyDocument *doc, GPtrArray *tags)
 {
+	enum { BEST_CURRENT_FILE, BEST_OPEN_FILE, BEST_SAME_DIR, BEST_NONE };
+	TMTag *best[BEST_NONE] = { NULL };
+	TMSourceFile *last_file = NULL;
+	GHashTable *open_files = g_hash_table_new(g_str_hash, g_str_equal);
+	gchar *dir = g_path_get_dirname(doc->real_path);
+	gint level = BEST_NONE;
 	TMTag *tag;
 	guint i;
 
-	/* first check if we have a tag in the current file */
-	foreach_ptr_array(tag, i, tags)
+	foreach_document(i)
 	{
-		if (g_strcmp0(doc->real_path, tag->file->file_name) == 0)
-			return tag;
+		if (documents[i]->real_path)
+			g_hash_table_add(open_files, documents[i]->real_path);
 	}
 
-	/* next check if we have a tag for some of the open documents */
 	foreach_ptr_array(tag, i, tags)
 	{
-		guint j;
-
-		foreach_document(j)
+		if (tag->file != last_file)
 		{
-			if (g_strcmp0(documents[j]->real_path, tag->file->file_name) == 0)
-				return tag;
+			const gchar *file_name = tag->file->file_name;
+
+			last_file = tag->file;
+			if (g_strcmp0(doc->real_path, file_name) == 0)
+				level = BEST_CURRENT_FILE;
+			else if (file_name && g_hash_table_contains(open_files, file_name))
+				level = BEST_OPEN_FILE;
+			else if (g_str_has_prefix(file_name, dir))
+				level = BEST_SAME_DIR;
+			else
+				level = BEST_NONE;
 		}
-	}
-
-	/* next check if we have a tag for a file inside the current document's directory */
-	foreach_ptr_array(tag, i, tags)
-	{
-		gchar *dir = g_path_get_dirname(doc->real_path);
-
-		if (g_str_has_prefix(tag->file->file_name, dir))
+		if (level == BEST_CURRENT_FILE)
 		{
-			g_free(dir);
-			return tag;
+			best[level] = tag;
+			break;
 		}
-		g_free(dir);
+		if (level != BEST_NONE && ! best[level])
+			best[level] = tag;
 	}
 
+	g_hash_table_destroy(open_files);
+	g_free(dir);
+
+	for (level = BEST_CURRENT_FILE; level < BEST_NONE; level++)
+	{
+		if (best[level])
+			return best[level];
+	}
 	return NULL;
 }
 
@@ -1905,12 +2156,40 @@ static gint get_current_tag_name(GeanyDocument *doc, gchar **tagname, TMTagType
 {
 	gint line;
 	gint parent;
+	gboolean tags_up_to_date;
 
 	line = sci_get_current_line(doc->editor->sci);
+	tags_up_to_date = doc->tm_file != NULL && doc->tm_file->tags_array != NULL &&
+		(! doc->changed || editor_prefs.autocompletion_update_freq > 0);
+
+	/* if the parser reports where tags end, the line ranges of the tags tell us directly
+	 * in which tag we are */
+	if (tags_up_to_date)
+	{
+		gboolean has_ranges;
+		const TMTag *tag = tm_source_file_get_scope_tag(doc->tm_file, line + 1, tag_types,
+			&has_ranges);
+
+		if (tag)
+		{
+			if (tag->scope)
+				*tagname = g_strconcat(tag->scope,
+						tm_parser_scope_separator(tag->lang), tag->name, NULL);
+			else
+				*tagname = g_strdup(tag->name);
+
+			return tag->line - 1;
+		}
+		else if (has_ranges)
+		{
+			*tagname = g_strdup(_("unknown"));
+			return -1;
+		}
+	}
+
 	parent = sci_get_fold_parent(doc->editor->sci, line);
 	/* if we're inside a fold level and we have up-to-date tags, get the function from TM */
-	if (parent >= 0 && doc->tm_file != NULL && doc->tm_file->tags_array != NULL &&
-		(! doc->changed || editor_prefs.autocompletion_update_freq > 0))
+	if (parent >= 0 && tags_up_to_date)
 	{
 		const TMTag *tag = tm_get_current_tag(doc->tm_file->tags_array, parent + 1, tag_types);
 
@@ -2237,17 +2516,56 @@ void symbols_init(void)
 
 	g_signal_connect(geany_object, "document-save", G_CALLBACK(on_document_save), NULL);
 
+	if (file_prefs.tags_parse_timeout > 0)
+	{
+		f = g_build_filename(utils_resource_dir(RESOURCE_DIR_LIBEXEC), "geany-parse-helper", NULL);
+		if (g_file_test(f, G_FILE_TEST_IS_EXECUTABLE))
+			tm_workspace_set_parse_isolation(f, g_get_num_processors(), file_prefs.tags_parse_timeout);
+		else
+			geany_debug("%s not found, parsing symbols without a timeout", f);
+		g_free(f);
+	}
+
 	for (i = 0; i < G_N_ELEMENTS(symbols_icons); i++)
 		symbols_icons[i].pixbuf = get_tag_icon(symbols_icons[i].icon_name);
 }
 
 
+static void log_parser_stats(void)
+{
+	guint lang;
+
+	for (lang = 0; lang < tm_ctags_get_lang_count(); lang++)
+	{
+		const TMParserStats *stats = tm_workspace_get_parser_stats(lang);
+
+		if (stats && stats->parses > 0)
+		{
+			geany_debug("%s parser: %u updates, %" G_GUINT64_FORMAT " tags from %.1f KiB, "
+				"parse %.1f ms (%.2f ms average), merge %.1f ms",
+				tm_source_file_get_lang_name(lang), stats->parses, stats->tags,
+				stats->bytes / 1024.0, stats->parse_time / 1000.0,
+				stats->parse_time / 1000.0 / stats->parses, stats->merge_time / 1000.0);
+		}
+	}
+}
+
+
 void symbols_finalize(void)
 {
 	guint i;
 
+	if (app->debug_mode)
+		log_parser_stats();
+
 	g_strfreev(c_tags_ignore);
 
+	if (global_tags_pool != NULL)
+	{
+		g_thread_pool_free(global_tags_pool, TRUE, TRUE);
+		global_tags_pool = NULL;
+	}
+
 	for (i = 0; i < G_N_ELEMENTS(symbols_icons); i++)
 	{
 		if (symbols_icons[i].pixbuf)
@@ -53,7 +53,8 @@ GString *symbols_find_typenames_as_string(TMParserType lang, gboolean global);
 
 gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode);
 
-gint symbols_generate_global_tags(gint argc, gchar **argv, gboolean want_preprocess);
+gint symbols_generate_global_tags(gint argc, gchar **argv, gboolean want_preprocess,
+	gboolean want_binary, guint jobs);
 
 void symbols_show_load_tags_dialog(void);
 
@@ -65,6 +66,8 @@ gint symbols_get_current_scope(GeanyDocument *doc, const gchar **tagname);
 
 const gchar *symbols_get_icon_name(guint icon_id);
 
+gchar *symbols_get_tag_tooltip(GeanyDocument *doc, const TMTag *tag);
+
 #endif /* GEANY_PRIVATE */
 
 G_END_DECLS
@@ -17,6 +17,7 @@
 #include "options_p.h"
 #include "parse_p.h"
 #include "trashbox_p.h"
+#include "vstring.h"
 #include "writer_p.h"
 #include "xtag_p.h"
 #include "param_p.h"
@@ -117,7 +118,7 @@ static gboolean init_tag(TMTag *tag, TMSourceFile *file, const tagEntryInfo *tag
 	if (!tag_entry->name || type == tm_tag_undef_t)
 		return FALSE;
 
-	tag->name = g_strdup(tag_entry->name);
+	tag->name = tm_tag_intern_string(tag_entry->name);
 	tag->type = type;
 	tag->local = tag_entry->isFileScope && file->trust_file_scope;
 	tag->flags = tm_tag_flag_none_t;
@@ -125,15 +126,16 @@ static gboolean init_tag(TMTag *tag, TMSourceFile *file, const tagEntryInfo *tag
 		tag->flags |= tm_tag_flag_anon_t;
 	tag->kind_letter = kind_letter;
 	tag->line = tag_entry->lineNumber;
+	tag->end_line = tag_entry->extensionFields.endLine;
 	if (NULL != tag_entry->extensionFields.signature)
-		tag->arglist = g_strdup(tag_entry->extensionFields.signature);
+		tag->arglist = tm_tag_intern_string(tag_entry->extensionFields.signature);
 	if ((NULL != tag_entry->extensionFields.scopeName) &&
 		(0 != tag_entry->extensionFields.scopeName[0]))
-		tag->scope = g_strdup(tag_entry->extensionFields.scopeName);
+		tag->scope = tm_tag_intern_string(tag_entry->extensionFields.scopeName);
 	if (tag_entry->extensionFields.inheritance != NULL)
-		tag->inheritance = g_strdup(tag_entry->extensionFields.inheritance);
+		tag->inheritance = tm_tag_intern_string(tag_entry->extensionFields.inheritance);
 	if (tag_entry->extensionFields.typeRef[1] != NULL)
-		tag->var_type = g_strdup(tag_entry->extensionFields.typeRef[1]);
+		tag->var_type = tm_tag_intern_string(tag_entry->extensionFields.typeRef[1]);
 	if (tag_entry->extensionFields.access != NULL)
 		tag->access = tm_source_file_get_tag_access(tag_entry->extensionFields.access);
 	if (tag_entry->extensionFields.implementation != NULL)
@@ -149,18 +151,32 @@ static gboolean init_tag(TMTag *tag, TMSourceFile *file, const tagEntryInfo *tag
 		gchar *new_scope = tm_parser_update_scope(tag->lang, tag->scope);
 		if (new_scope != tag->scope)
 		{
-			g_free(tag->scope);
-			tag->scope = new_scope;
+			tm_tag_release_string(tag->scope);
+			tag->scope = tm_tag_intern_string(new_scope);
+			g_free(new_scope);
 		}
 	}
 	return TRUE;
 }
 
 
+/* chunk the tags of the file being parsed are allocated from */
+static TMTagChunk *tag_chunk = NULL;
+
+/* ctags keeps the state of the file being parsed (input file, cork queue, parser
+ * state...) in globals, so only one parse can run at a time. The lock makes
+ * parsing from different threads safe by serializing it: parses never run in
+ * parallel within a process, a thread parsing only waits for the others.
+ * Callers gain from threads only for their other work, e.g. running the
+ * preprocessor or reading files. Parallel parses need separate processes,
+ * see tm_source_files_parse_isolated(). */
+G_LOCK_DEFINE_STATIC(ctags);
+
+
 static gint write_entry(tagWriter *writer, MIO * mio, const tagEntryInfo *const tag, void *user_data)
 {
 	TMSourceFile *source_file = user_data;
-	TMTag *tm_tag = tm_tag_new();
+	TMTag *tm_tag = tm_tag_new_in_chunk(&tag_chunk);
 
 	getTagScopeInformation((tagEntryInfo *)tag, NULL, NULL);
 
@@ -217,9 +233,19 @@ void tm_ctags_init(void)
 
 	/* some kinds we are interested in are disabled by default */
 	enable_kinds_and_roles();
+
+	/* documents are parsed again and again, reuse the strings of the
+	 * previous parses (token pools of the parsers are kept as well) */
+	vStringRecycle(true);
 }
 
 
+/* identifies the current set of ignored symbols */
+static guint ignore_symbols_hash = 0;
+/* the values added, for the parse helper which has to add them again */
+static GPtrArray *ignore_symbols = NULL;
+
+
 void tm_ctags_add_ignore_symbol(const char *value)
 {
 	langType lang = getNamedLanguage ("CPreProcessor", 0);
@@ -229,7 +255,16 @@ void tm_ctags_add_ignore_symbol(const char *value)
 	 * the ignore list in ctags */
 	val = g_strstrip(val);
 	if (*val)
+	{
+		G_LOCK(ctags);
 		applyParameter (lang, "ignore", val);
+		ignore_symbols_hash = ignore_symbols_hash * 31 + g_str_hash(val);
+		if (!ignore_symbols)
+			ignore_symbols = g_ptr_array_new_with_free_func(g_free);
+		g_ptr_array_add(ignore_symbols, val);
+		val = NULL;
+		G_UNLOCK(ctags);
+	}
 	g_free(val);
 }
 
@@ -237,7 +272,43 @@ void tm_ctags_add_ignore_symbol(const char *value)
 void tm_ctags_clear_ignore_symbols(void)
 {
 	langType lang = getNamedLanguage ("CPreProcessor", 0);
+
+	G_LOCK(ctags);
 	applyParameter (lang, "ignore", NULL);
+	ignore_symbols_hash = 0;
+	if (ignore_symbols)
+		g_ptr_array_set_size(ignore_symbols, 0);
+	G_UNLOCK(ctags);
+}
+
+
+/* Returns a NULL-terminated copy of the values added by tm_ctags_add_ignore_symbol(). */
+gchar **tm_ctags_get_ignore_symbols(void)
+{
+	gchar **symbols;
+	guint i, len;
+
+	G_LOCK(ctags);
+	len = ignore_symbols ? ignore_symbols->len : 0;
+	symbols = g_new(gchar *, len + 1);
+	for (i = 0; i < len; i++)
+		symbols[i] = g_strdup(ignore_symbols->pdata[i]);
+	symbols[len] = NULL;
+	G_UNLOCK(ctags);
+	return symbols;
+}
+
+
+/* Returns a hash of the symbols added by tm_ctags_add_ignore_symbol(), as
+ * the tags of C-like languages depend on them. */
+guint tm_ctags_get_ignore_symbols_hash(void)
+{
+	guint hash;
+
+	G_LOCK(ctags);
+	hash = ignore_symbols_hash;
+	G_UNLOCK(ctags);
+	return hash;
 }
 
 
@@ -248,6 +319,10 @@ static void rename_anon_tags(TMSourceFile *source_file)
 	gboolean is_c = source_file->lang == TM_PARSER_C || source_file->lang == TM_PARSER_CPP;
 	gint *anon_counter_table = NULL;
 	GPtrArray *removed_typedefs = NULL;
+	/* the scope lengths of the tags - the nested tags of each anonymous tag
+	 * are compared by scope length, so nested anonymous tags would measure
+	 * the same scopes many times */
+	guint *scope_lens = NULL;
 	guint i;
 
 	for (i = 0; i < source_file->tags_array->len; i++)
@@ -259,9 +334,20 @@ static void rename_anon_tags(TMSourceFile *source_file)
 			guint j;
 			guint new_name_len, orig_name_len;
 			gboolean inside_nesting = FALSE;
-			guint scope_len = tag->scope ? strlen(tag->scope) : 0;
+			guint scope_len;
 			gchar kind = tag->kind_letter;
 
+			if (!scope_lens)
+			{
+				scope_lens = g_new(guint, source_file->tags_array->len);
+				for (j = i; j < source_file->tags_array->len; j++)
+				{
+					TMTag *t = TM_TAG(source_file->tags_array->pdata[j]);
+					scope_lens[j] = t->scope ? strlen(t->scope) : 0;
+				}
+			}
+			scope_len = scope_lens[i];
+
 			orig_name = tag->name;
 			orig_name_len = strlen(orig_name);
 
@@ -273,7 +359,7 @@ static void rename_anon_tags(TMSourceFile *source_file)
 				for (j = i + 1; j < source_file->tags_array->len; j++)
 				{
 					TMTag *nested_tag = TM_TAG(source_file->tags_array->pdata[j]);
-					guint nested_scope_len = nested_tag->scope ? strlen(nested_tag->scope) : 0;
+					guint nested_scope_len = scope_lens[j];
 
 					/* Tags can be interleaved with scopeless macros - skip those */
 					if (nested_tag->type & (tm_tag_macro_t | tm_tag_macro_with_arg_t))
@@ -290,7 +376,7 @@ static void rename_anon_tags(TMSourceFile *source_file)
 				if (j < source_file->tags_array->len)
 				{
 					TMTag *typedef_tag = TM_TAG(source_file->tags_array->pdata[j]);
-					guint typedef_scope_len = typedef_tag->scope ? strlen(typedef_tag->scope) : 0;
+					guint typedef_scope_len = scope_lens[j];
 
 					/* Should be at the same scope level as the anon tag */
 					if (typedef_tag->type == tm_tag_typedef_t &&
@@ -335,7 +421,7 @@ static void rename_anon_tags(TMSourceFile *source_file)
 			for (j = i + 1; j < source_file->tags_array->len; j++)
 			{
 				TMTag *nested_tag = TM_TAG(source_file->tags_array->pdata[j]);
-				guint nested_scope_len = nested_tag->scope ? strlen(nested_tag->scope) : 0;
+				guint nested_scope_len = scope_lens[j];
 				gchar *pos;
 
 				/* Tags can be interleaved with scopeless macros - skip those */
@@ -368,14 +454,17 @@ static void rename_anon_tags(TMSourceFile *source_file)
 				 * scope separators here. */
 				if (pos)
 				{
-					gchar *str = g_malloc(nested_scope_len + 50);
+					/* typedef names can be longer than the anon names */
+					guint str_len = nested_scope_len - orig_name_len + new_name_len;
+					gchar *str = g_malloc(str_len + 1);
 					guint prefix_len = pos - nested_tag->scope;
 
 					strncpy(str, nested_tag->scope, prefix_len);
 					strcpy(str + prefix_len, new_name);
 					strcpy(str + prefix_len + new_name_len, pos + orig_name_len);
-					g_free(nested_tag->scope);
+					tm_tag_release_string(nested_tag->scope);
 					nested_tag->scope = str;
+					scope_lens[j] = str_len;
 				}
 			}
 
@@ -384,7 +473,7 @@ static void rename_anon_tags(TMSourceFile *source_file)
 			while (j < source_file->tags_array->len)
 			{
 				TMTag *var_tag = TM_TAG(source_file->tags_array->pdata[j]);
-				guint var_scope_len = var_tag->scope ? strlen(var_tag->scope) : 0;
+				guint var_scope_len = scope_lens[j];
 				gchar *pos;
 
 				/* Should be at the same scope level as the anon tag */
@@ -395,7 +484,7 @@ static void rename_anon_tags(TMSourceFile *source_file)
 					gssize p = pos - var_tag->var_type;
 					g_string_erase(str, p, strlen(orig_name));
 					g_string_insert(str, p, new_name);
-					g_free(var_tag->var_type);
+					tm_tag_release_string(var_tag->var_type);
 					var_tag->var_type = str->str;
 					g_string_free(str, FALSE);
 				}
@@ -405,7 +494,7 @@ static void rename_anon_tags(TMSourceFile *source_file)
 				j++;
 			}
 
-			g_free(orig_name);
+			tm_tag_release_string(orig_name);
 		}
 	}
 
@@ -427,6 +516,7 @@ static void rename_anon_tags(TMSourceFile *source_file)
 
 	if (anon_counter_table)
 		g_free(anon_counter_table);
+	g_free(scope_lens);
 }
 
 
@@ -435,7 +525,10 @@ void tm_ctags_parse(guchar *buffer, gsize buffer_size,
 {
 	g_return_if_fail(buffer != NULL || file_name != NULL);
 
+	G_LOCK(ctags);
 	parseRawBuffer(file_name, buffer, buffer_size, language, source_file);
+	tm_tag_chunk_release(&tag_chunk);
+	G_UNLOCK(ctags);
 
 	rename_anon_tags(source_file);
 }
@@ -0,0 +1,85 @@
+/*
+*   Copyright 2023 The Geany contributors
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   The parse helper program, which parses a single file for
+*   tm_source_file_parse_isolated() so a parser stuck on it can be killed:
+*
+*   geany-parse-helper [--buffer] LANG TRUST_FILE_SCOPE FILE TAGS_FILE [IGNORE_SYMBOL...]
+*
+*   LANG is the TMParserType and TRUST_FILE_SCOPE 1 or 0 of the source file.
+*   With --buffer the text is read from the standard input instead of FILE.
+*   The tags are written to TAGS_FILE in the tag cache format with FILE as key.
+*/
+
+#include "tm_ctags.h"
+#include "tm_source_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static GString *read_input(void)
+{
+	GString *text = g_string_sized_new(64 * 1024);
+	gchar buf[16 * 1024];
+	gsize n;
+
+	while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+		g_string_append_len(text, buf, n);
+	return text;
+}
+
+
+int main(int argc, char **argv)
+{
+	TMSourceFile *source_file;
+	GString *text = NULL;
+	gboolean use_buffer = FALSE;
+	gboolean ok;
+	gint i = 1;
+
+	if (argc > i && strcmp(argv[i], "--buffer") == 0)
+	{
+		use_buffer = TRUE;
+		i++;
+	}
+	if (argc - i < 4)
+	{
+		fprintf(stderr, "usage: %s [--buffer] LANG TRUST_FILE_SCOPE FILE TAGS_FILE [IGNORE_SYMBOL...]\n",
+			argv[0]);
+		return 2;
+	}
+
+	tm_ctags_init();
+	for (i += 4; i < argc; i++)
+		tm_ctags_add_ignore_symbol(argv[i]);
+	i = use_buffer ? 2 : 1;
+
+	/* set up like the source file of the program, whose file may not exist */
+	source_file = tm_source_file_new(NULL, NULL);
+	source_file->lang = atoi(argv[i]);
+	source_file->trust_file_scope = strcmp(argv[i + 1], "0") != 0;
+	source_file->file_name = g_strdup(argv[i + 2]);
+	source_file->short_name = strrchr(source_file->file_name, G_DIR_SEPARATOR);
+	if (source_file->short_name)
+		++ source_file->short_name;
+	else
+		source_file->short_name = source_file->file_name;
+
+	if (use_buffer)
+	{
+		text = read_input();
+		tm_source_file_parse(source_file, (guchar *) text->str, text->len, TRUE);
+		g_string_free(text, TRUE);
+	}
+	else
+		tm_source_file_parse(source_file, NULL, 0, FALSE);
+
+	ok = tm_source_file_write_tags_cache(source_file, argv[i + 3], source_file->file_name);
+	tm_source_file_free(source_file);
+	return ok ? 0 : 1;
+}
@@ -23,6 +23,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <glib/gstdio.h>
+#ifdef G_OS_UNIX
+# include <errno.h>
+# include <signal.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+#endif
 #ifdef G_OS_WIN32
 # define VC_EXTRALEAN
 # define WIN32_LEAN_AND_MEAN
@@ -40,8 +46,26 @@ typedef struct
 {
 	TMSourceFile public;
 	guint refcount;
+	GArray *scope_ranges; /* sorted TMScopeRange array, NULL if not built yet */
+	TMTagType scope_range_types; /* types of the tags in scope_ranges */
+	/* what tags_array was parsed from, so parsing the same buffer again can be skipped */
+	gboolean parsed_valid;
+	TMParserType parsed_lang;
+	gsize parsed_size;
+	guint64 parsed_hash;
+	guint parsed_ignore_hash;
+	/* indexes in the source file arrays of the workspace, -1 when not added to it */
+	gint workspace_index;
+	gint workspace_name_index;
 } TMSourceFilePriv;
 
+/* A tag spanning several lines, e.g. a function or a class */
+typedef struct
+{
+	TMTag *tag;
+	gint parent; /* index of the closest range before this one enclosing it or -1 */
+} TMScopeRange;
+
 
 typedef enum {
 	TM_FILE_FORMAT_TAGMANAGER,
@@ -352,18 +376,18 @@ static void read_ctags_file(const gchar *tags_file, TMParserType lang, GPtrArray
 				const gchar *val = strchr(value, ':');
 				if (val && *(++val))
 				{
-					g_free(tag->scope);
+					tm_tag_release_string(tag->scope);
 					tag->scope = g_strdup(val);
 				}
 			}
 			else if (strcmp(key, "signature") == 0)  /* 'S' field */
 			{
-				g_free(tag->arglist);
+				tm_tag_release_string(tag->arglist);
 				tag->arglist = g_strdup(value);
 			}
 			else if (strcmp(key, "inherits") == 0)  /* 'i' field */
 			{
-				g_free(tag->inheritance);
+				tm_tag_release_string(tag->inheritance);
 				tag->inheritance = g_strdup(value);
 			}
 			else if (strcmp(key, "typeref") == 0)  /* 't' field */
@@ -374,7 +398,7 @@ static void read_ctags_file(const gchar *tags_file, TMParserType lang, GPtrArray
 					(g_str_has_prefix(value, "typename:") || g_str_has_prefix(value, "unknown:")))
 				{
 					/* "unknown:" above is used by the php parser, all other parsers use "typename:" */
-					g_free(tag->var_type);
+					tm_tag_release_string(tag->var_type);
 					tag->var_type = g_strdup(val);
 				}
 			}
@@ -591,6 +615,406 @@ gboolean tm_source_file_write_tags_file(const gchar *tags_file, GPtrArray *tags_
 }
 
 
+/* Binary tag cache of a single source file. The header contains a key supplied
+ * by the caller (e.g. describing the parsed file contents); tags are only read
+ * when the key matches. All numbers are little-endian. */
+#define TAGS_CACHE_MAGIC "GTMC"
+#define TAGS_CACHE_VERSION 2
+#define TAGS_CACHE_NULL_STRING G_MAXUINT32
+
+static void cache_put_uint32(GString *out, guint32 val)
+{
+	val = GUINT32_TO_LE(val);
+	g_string_append_len(out, (const gchar *) &val, sizeof(val));
+}
+
+static void cache_put_string(GString *out, const gchar *str)
+{
+	if (!str)
+		cache_put_uint32(out, TAGS_CACHE_NULL_STRING);
+	else
+	{
+		gsize len = strlen(str);
+
+		cache_put_uint32(out, len);
+		g_string_append_len(out, str, len);
+	}
+}
+
+typedef struct
+{
+	const gchar *pos;
+	const gchar *end;
+	gboolean error;
+} CacheReader;
+
+static guint32 cache_get_uint32(CacheReader *r)
+{
+	guint32 val;
+
+	if (r->error || r->end - r->pos < (gssize) sizeof(val))
+	{
+		r->error = TRUE;
+		return 0;
+	}
+	memcpy(&val, r->pos, sizeof(val));
+	r->pos += sizeof(val);
+	return GUINT32_FROM_LE(val);
+}
+
+static gchar cache_get_char(CacheReader *r)
+{
+	if (r->error || r->pos >= r->end)
+	{
+		r->error = TRUE;
+		return 0;
+	}
+	return *r->pos++;
+}
+
+static gchar *cache_get_string(CacheReader *r)
+{
+	guint32 len = cache_get_uint32(r);
+	gchar *str;
+
+	if (r->error || len == TAGS_CACHE_NULL_STRING)
+		return NULL;
+	if ((gsize) (r->end - r->pos) < len)
+	{
+		r->error = TRUE;
+		return NULL;
+	}
+	str = g_strndup(r->pos, len);
+	r->pos += len;
+	return str;
+}
+
+static void cache_put_tags(GString *out, GPtrArray *tags)
+{
+	guint i;
+
+	cache_put_uint32(out, tags->len);
+
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+
+		cache_put_string(out, tag->name);
+		cache_put_string(out, tag->arglist);
+		cache_put_string(out, tag->scope);
+		cache_put_string(out, tag->inheritance);
+		cache_put_string(out, tag->var_type);
+		cache_put_uint32(out, tag->type);
+		cache_put_uint32(out, tag->line);
+		cache_put_uint32(out, tag->end_line);
+		cache_put_uint32(out, tag->flags);
+		g_string_append_c(out, tag->local ? 1 : 0);
+		g_string_append_c(out, tag->access);
+		g_string_append_c(out, tag->impl);
+		g_string_append_c(out, tag->kind_letter);
+	}
+}
+
+/* Writes the tags of source_file into cache_file (atomically replacing it) together
+ with key which has to match when the tags are read back by tm_source_file_read_tags_cache(). */
+gboolean tm_source_file_write_tags_cache(TMSourceFile *source_file, const gchar *cache_file,
+	const gchar *key)
+{
+	GString *out;
+	gboolean ret;
+
+	g_return_val_if_fail(source_file && cache_file && key, FALSE);
+
+	out = g_string_sized_new(64 * (source_file->tags_array->len + 1));
+	g_string_append(out, TAGS_CACHE_MAGIC);
+	cache_put_uint32(out, TAGS_CACHE_VERSION);
+	cache_put_string(out, key);
+	cache_put_tags(out, source_file->tags_array);
+
+	ret = g_file_set_contents(cache_file, out->str, out->len, NULL);
+	g_string_free(out, TRUE);
+	return ret;
+}
+
+static GPtrArray *cache_get_tags(CacheReader *r, TMSourceFile *source_file)
+{
+	TMTagChunk *chunk = NULL;
+	GPtrArray *tags;
+	guint32 count, i;
+
+	count = cache_get_uint32(r);
+	/* every tag takes at least 40 bytes, don't trust the count blindly */
+	if (r->error || count > (gsize) (r->end - r->pos) / 40)
+		return NULL;
+
+	tags = g_ptr_array_sized_new(count);
+	for (i = 0; i < count && !r->error; i++)
+	{
+		TMTag *tag = tm_tag_new_in_chunk(&chunk);
+
+		tag->name = cache_get_string(r);
+		tag->arglist = cache_get_string(r);
+		tag->scope = cache_get_string(r);
+		tag->inheritance = cache_get_string(r);
+		tag->var_type = cache_get_string(r);
+		tag->type = cache_get_uint32(r);
+		tag->line = cache_get_uint32(r);
+		tag->end_line = cache_get_uint32(r);
+		tag->flags = cache_get_uint32(r);
+		tag->local = cache_get_char(r) != 0;
+		tag->access = cache_get_char(r);
+		tag->impl = cache_get_char(r);
+		tag->kind_letter = cache_get_char(r);
+		tag->file = source_file;
+		tag->lang = source_file->lang;
+
+		g_ptr_array_add(tags, tag);
+
+		if (!tag->name)
+			r->error = TRUE;
+	}
+	tm_tag_chunk_release(&chunk);
+
+	if (r->error)
+	{
+		tm_tags_array_free(tags, TRUE);
+		return NULL;
+	}
+
+	return tags;
+}
+
+static GPtrArray *read_tags_cache(CacheReader *r, TMSourceFile *source_file, const gchar *key)
+{
+	gchar *stored_key;
+	gboolean key_matches;
+
+	if (r->end - r->pos < 4 || memcmp(r->pos, TAGS_CACHE_MAGIC, 4) != 0)
+		return NULL;
+	r->pos += 4;
+	if (cache_get_uint32(r) != TAGS_CACHE_VERSION)
+		return NULL;
+
+	stored_key = cache_get_string(r);
+	key_matches = g_strcmp0(stored_key, key) == 0;
+	g_free(stored_key);
+	if (!key_matches)
+		return NULL;
+
+	return cache_get_tags(r, source_file);
+}
+
+/* Reads tags written by tm_source_file_write_tags_cache(). Returns NULL when
+ the file doesn't exist, is invalid or was written with a different key. */
+GPtrArray *tm_source_file_read_tags_cache(TMSourceFile *source_file, const gchar *cache_file,
+	const gchar *key)
+{
+	GMappedFile *file;
+	GPtrArray *tags;
+	CacheReader r;
+
+	g_return_val_if_fail(source_file && cache_file && key, NULL);
+
+	file = g_mapped_file_new(cache_file, FALSE, NULL);
+	if (!file)
+		return NULL;
+
+	r.pos = g_mapped_file_get_contents(file);
+	r.end = r.pos + g_mapped_file_get_length(file);
+	r.error = FALSE;
+
+	tags = read_tags_cache(&r, source_file, key);
+
+	g_mapped_file_unref(file);
+	return tags;
+}
+
+
+/* Binary global tags file format. The header is followed by fixed-size tag
+ * records and a string table the records point into; strings shared by multiple
+ * tags are stored only once. Tags are written sorted and deduplicated so they
+ * don't have to be sorted again when loaded. */
+#define BINARY_TAGS_MAGIC "GTMB"
+#define BINARY_TAGS_VERSION 1
+#define BINARY_TAGS_HEADER_SIZE 12
+#define BINARY_TAGS_RECORD_SIZE 36
+
+static guint32 binary_tags_add_string(GString *strings, GHashTable *offsets, const gchar *str)
+{
+	gpointer offset;
+
+	if (!str)
+		return TAGS_CACHE_NULL_STRING;
+	if (g_hash_table_lookup_extended(offsets, str, NULL, &offset))
+		return GPOINTER_TO_UINT(offset);
+
+	offset = GUINT_TO_POINTER(strings->len);
+	g_hash_table_insert(offsets, (gpointer) str, offset);
+	g_string_append_len(strings, str, strlen(str) + 1);
+	return GPOINTER_TO_UINT(offset);
+}
+
+/* Writes tags_array, which has to be sorted by the attributes used for global
+ tags, into tags_file using the binary format. */
+gboolean tm_source_file_write_binary_tags_file(const gchar *tags_file, GPtrArray *tags_array)
+{
+	GHashTable *offsets;
+	GString *out, *strings;
+	gboolean ret;
+	guint i;
+
+	g_return_val_if_fail(tags_array && tags_file, FALSE);
+
+	offsets = g_hash_table_new(g_str_hash, g_str_equal);
+	strings = g_string_new(NULL);
+	out = g_string_sized_new(BINARY_TAGS_HEADER_SIZE + BINARY_TAGS_RECORD_SIZE * tags_array->len);
+
+	g_string_append(out, BINARY_TAGS_MAGIC);
+	cache_put_uint32(out, BINARY_TAGS_VERSION);
+	cache_put_uint32(out, tags_array->len);
+
+	for (i = 0; i < tags_array->len; i++)
+	{
+		TMTag *tag = TM_TAG(tags_array->pdata[i]);
+
+		cache_put_uint32(out, binary_tags_add_string(strings, offsets, tag->name));
+		cache_put_uint32(out, binary_tags_add_string(strings, offsets, tag->arglist));
+		cache_put_uint32(out, binary_tags_add_string(strings, offsets, tag->scope));
+		cache_put_uint32(out, binary_tags_add_string(strings, offsets, tag->inheritance));
+		cache_put_uint32(out, binary_tags_add_string(strings, offsets, tag->var_type));
+		cache_put_uint32(out, tag->type);
+		cache_put_uint32(out, tag->line);
+		cache_put_uint32(out, tag->flags);
+		g_string_append_c(out, tag->local ? 1 : 0);
+		g_string_append_c(out, tag->access);
+		g_string_append_c(out, tag->impl);
+		g_string_append_c(out, tag->kind_letter);
+	}
+	g_string_append_len(out, strings->str, strings->len);
+
+	ret = g_file_set_contents(tags_file, out->str, out->len, NULL);
+
+	g_string_free(out, TRUE);
+	g_string_free(strings, TRUE);
+	g_hash_table_destroy(offsets);
+	return ret;
+}
+
+/* Returns whether tags_file uses the binary format and should be read using
+ tm_source_file_read_binary_tags_file() instead of tm_source_file_read_tags_file(). */
+gboolean tm_source_file_is_binary_tags_file(const gchar *tags_file)
+{
+	gchar magic[sizeof(BINARY_TAGS_MAGIC) - 1];
+	gboolean ret;
+	FILE *fp;
+
+	if (NULL == (fp = g_fopen(tags_file, "rb")))
+		return FALSE;
+	ret = fread(magic, sizeof(magic), 1, fp) == 1 &&
+		memcmp(magic, BINARY_TAGS_MAGIC, sizeof(magic)) == 0;
+	fclose(fp);
+
+	return ret;
+}
+
+static gchar *binary_tags_get_string(CacheReader *r, const gchar *strings, gsize strings_len)
+{
+	guint32 offset = cache_get_uint32(r);
+
+	if (r->error || offset == TAGS_CACHE_NULL_STRING)
+		return NULL;
+	if (offset >= strings_len)
+	{
+		r->error = TRUE;
+		return NULL;
+	}
+	return tm_tag_intern_string(strings + offset);
+}
+
+/* Reads a tags file written by tm_source_file_write_binary_tags_file(). The tags
+ are returned in the order they were written. */
+GPtrArray *tm_source_file_read_binary_tags_file(const gchar *tags_file, TMParserType mode)
+{
+	GMappedFile *file;
+	GPtrArray *tags = NULL;
+	TMTagChunk *chunk = NULL;
+	const gchar *contents, *strings;
+	gsize length, strings_len;
+	guint32 count, i;
+	CacheReader r;
+
+	file = g_mapped_file_new(tags_file, FALSE, NULL);
+	if (!file)
+		return NULL;
+
+	contents = g_mapped_file_get_contents(file);
+	length = g_mapped_file_get_length(file);
+	r.pos = contents + 4;
+	r.end = contents + length;
+	r.error = FALSE;
+
+	if (length < BINARY_TAGS_HEADER_SIZE || memcmp(contents, BINARY_TAGS_MAGIC, 4) != 0 ||
+		cache_get_uint32(&r) != BINARY_TAGS_VERSION)
+	{
+		g_mapped_file_unref(file);
+		return NULL;
+	}
+
+	count = cache_get_uint32(&r);
+	if (count > (length - BINARY_TAGS_HEADER_SIZE) / BINARY_TAGS_RECORD_SIZE)
+	{
+		g_mapped_file_unref(file);
+		return NULL;
+	}
+
+	/* the string table follows the records up to the end of the file; as long
+	 * as its last byte is NUL, every offset into it points to a valid string */
+	strings = contents + BINARY_TAGS_HEADER_SIZE + (gsize) count * BINARY_TAGS_RECORD_SIZE;
+	strings_len = contents + length - strings;
+	if (strings_len > 0 && strings[strings_len - 1] != '\0')
+	{
+		g_mapped_file_unref(file);
+		return NULL;
+	}
+
+	r.end = strings;
+	tags = g_ptr_array_sized_new(count);
+	for (i = 0; i < count && !r.error; i++)
+	{
+		TMTag *tag = tm_tag_new_in_chunk(&chunk);
+
+		tag->name = binary_tags_get_string(&r, strings, strings_len);
+		tag->arglist = binary_tags_get_string(&r, strings, strings_len);
+		tag->scope = binary_tags_get_string(&r, strings, strings_len);
+		tag->inheritance = binary_tags_get_string(&r, strings, strings_len);
+		tag->var_type = binary_tags_get_string(&r, strings, strings_len);
+		tag->type = cache_get_uint32(&r);
+		tag->line = cache_get_uint32(&r);
+		tag->flags = cache_get_uint32(&r);
+		tag->local = cache_get_char(&r) != 0;
+		tag->access = cache_get_char(&r);
+		tag->impl = cache_get_char(&r);
+		tag->kind_letter = cache_get_char(&r);
+		tag->lang = mode;
+
+		g_ptr_array_add(tags, tag);
+
+		if (!tag->name)
+			r.error = TRUE;
+	}
+	tm_tag_chunk_release(&chunk);
+
+	if (r.error)
+	{
+		tm_tags_array_free(tags, TRUE);
+		tags = NULL;
+	}
+
+	g_mapped_file_unref(file);
+	return tags;
+}
+
+
 /* Initializes a TMSourceFile structure from a file name. */
 static gboolean tm_source_file_init(TMSourceFile *source_file, const char *file_name,
 	const char* name)
@@ -670,6 +1094,10 @@ TMSourceFile *tm_source_file_new(const char *file_name, const char *name)
 		return NULL;
 	}
 	priv->refcount = 1;
+	priv->scope_ranges = NULL;
+	priv->parsed_valid = FALSE;
+	priv->workspace_index = -1;
+	priv->workspace_name_index = -1;
 	return &priv->public;
 }
 
@@ -695,6 +1123,7 @@ static void tm_source_file_destroy(TMSourceFile *source_file)
 #endif
 
 	g_free(source_file->file_name);
+	tm_source_file_invalidate_indexes(source_file);
 	tm_tags_array_free(source_file->tags_array, TRUE);
 	source_file->tags_array = NULL;
 }
@@ -719,6 +1148,20 @@ void tm_source_file_free(TMSourceFile *source_file)
 	}
 }
 
+/* Estimates the memory used by the source file including its tags. */
+gsize tm_source_file_get_memory_size(const TMSourceFile *source_file)
+{
+	const TMSourceFilePriv *priv = (const TMSourceFilePriv *) source_file;
+	gsize size = sizeof(TMSourceFilePriv);
+
+	if (source_file->file_name)
+		size += strlen(source_file->file_name) + 1;
+	size += tm_tags_get_memory_size(source_file->tags_array, TRUE);
+	if (priv->scope_ranges)
+		size += priv->scope_ranges->len * sizeof(TMScopeRange);
+	return size;
+}
+
 /** Gets the GBoxed-derived GType for TMSourceFile
  *
  * @return TMSourceFile type . */
@@ -727,6 +1170,17 @@ GType tm_source_file_get_type(void);
 
 G_DEFINE_BOXED_TYPE(TMSourceFile, tm_source_file, tm_source_file_dup, tm_source_file_free);
 
+/* FNV-1a */
+static guint64 hash_buffer(const guchar *buf, gsize size)
+{
+	guint64 hash = G_GUINT64_CONSTANT(14695981039346656037);
+	gsize i;
+
+	for (i = 0; i < size; i++)
+		hash = (hash ^ buf[i]) * G_GUINT64_CONSTANT(1099511628211);
+	return hash;
+}
+
 /* Parses the text-buffer or source file and regenarates the tags.
  @param source_file The source file to parse
  @param text_buf The text buffer to parse
@@ -735,11 +1189,43 @@ G_DEFINE_BOXED_TYPE(TMSourceFile, tm_source_file, tm_source_file_dup, tm_source_
  TRUE to parse the buffer and ignore the file content.
  @return TRUE on success, FALSE on failure
 */
+/* Returns whether the tags of source_file were parsed from the same buffer
+ contents and with the same ignored symbols, the only things they depend on.
+ hash is set to the hash of the buffer to pass to set_parsed(). */
+static gboolean is_parsed(TMSourceFile *source_file, guchar *text_buf, gsize buf_size,
+	gboolean use_buffer, guint64 *hash)
+{
+	TMSourceFilePriv *priv = (TMSourceFilePriv *) source_file;
+
+	*hash = 0;
+	if (!use_buffer || !text_buf || buf_size == 0)
+		return FALSE;
+
+	*hash = hash_buffer(text_buf, buf_size);
+	return priv->parsed_valid && priv->parsed_lang == source_file->lang &&
+		priv->parsed_size == buf_size && priv->parsed_hash == *hash &&
+		priv->parsed_ignore_hash == tm_ctags_get_ignore_symbols_hash() &&
+		source_file->tags_array;
+}
+
+static void set_parsed(TMSourceFile *source_file, gsize buf_size, guint64 hash)
+{
+	TMSourceFilePriv *priv = (TMSourceFilePriv *) source_file;
+
+	priv->parsed_valid = TRUE;
+	priv->parsed_lang = source_file->lang;
+	priv->parsed_size = buf_size;
+	priv->parsed_hash = hash;
+	priv->parsed_ignore_hash = tm_ctags_get_ignore_symbols_hash();
+}
+
+GEANY_EXPORT_SYMBOL
 gboolean tm_source_file_parse(TMSourceFile *source_file, guchar* text_buf, gsize buf_size,
 	gboolean use_buffer)
 {
 	const char *file_name;
 	gboolean retry = TRUE;
+	guint64 hash;
 
 	if ((NULL == source_file) || (NULL == source_file->file_name))
 	{
@@ -747,6 +1233,12 @@ gboolean tm_source_file_parse(TMSourceFile *source_file, guchar* text_buf, gsize
 		return FALSE;
 	}
 
+	/* don't parse the same input again */
+	if (is_parsed(source_file, text_buf, buf_size, use_buffer, &hash))
+		return !retry;
+
+	tm_source_file_invalidate_indexes(source_file);
+
 	if (source_file->lang == TM_PARSER_NONE)
 	{
 		tm_tags_array_free(source_file->tags_array, FALSE);
@@ -767,13 +1259,638 @@ gboolean tm_source_file_parse(TMSourceFile *source_file, guchar* text_buf, gsize
 	tm_ctags_parse(use_buffer ? text_buf : NULL, buf_size, file_name,
 		source_file->lang, source_file);
 
+	if (use_buffer)
+		set_parsed(source_file, buf_size, hash);
+
 	return !retry;
 }
 
+
+/* Parsing in child processes. The parse helper program runs the same parsers
+ * as this process on a single file and writes its tags to a temporary file in
+ * the tag cache format, see tm_parse_helper.c. It is spawned and doesn't share
+ * anything with this process, which can have other threads holding locks at
+ * that time. Helpers stuck in a parser are killed after a timeout and several
+ * of them can parse different files at the same time, which the global state
+ * of ctags doesn't allow within a process. */
+struct IsolatedRun;
+
+typedef struct
+{
+	TMSourceFile *source_file;
+	guchar *text_buf;
+	gsize buf_size;
+	gboolean use_buffer;
+	guint64 hash;
+	gboolean ok;
+#ifdef G_OS_UNIX
+	struct IsolatedRun *run;
+	GPid pid;
+	gchar *tags_file;
+	GIOChannel *input;		/* passes text_buf to the helper, NULL once written */
+	GSource *input_source;
+	gsize written;
+	GSource *timeout_source;
+	gboolean timed_out;
+#endif
+} IsolatedParse;
+
+#ifdef G_OS_UNIX
+typedef struct IsolatedRun
+{
+	IsolatedParse *jobs;
+	guint count;
+	guint next;
+	guint max_running;
+	guint n_running;
+	const gchar *helper;	/* NULL once it couldn't be started */
+	guint timeout;
+	GMainContext *context;	/* runs the sources watching the helpers */
+} IsolatedRun;
+
+static void stop_isolated_parse_input(IsolatedParse *job)
+{
+	if (!job->input)
+		return;
+
+	g_source_destroy(job->input_source);
+	g_source_unref(job->input_source);
+	job->input_source = NULL;
+	g_io_channel_shutdown(job->input, FALSE, NULL);
+	g_io_channel_unref(job->input);
+	job->input = NULL;
+}
+
+static gboolean on_isolated_parse_input(GIOChannel *channel, GIOCondition cond, gpointer data)
+{
+	IsolatedParse *job = data;
+
+	if (cond & G_IO_OUT)
+	{
+		gssize n = write(g_io_channel_unix_get_fd(channel), job->text_buf + job->written,
+			job->buf_size - job->written);
+
+		if (n > 0)
+			job->written += n;
+		if (job->written < job->buf_size && (n >= 0 || errno == EINTR || errno == EAGAIN))
+			return TRUE;
+	}
+
+	/* closing the pipe ends the input of the helper, also when it stopped reading */
+	stop_isolated_parse_input(job);
+	return FALSE;
+}
+
+static gboolean on_isolated_parse_timeout(gpointer data)
+{
+	IsolatedParse *job = data;
+
+	/* the helper is reaped by the child watch */
+	job->timed_out = TRUE;
+	kill(job->pid, SIGKILL);
+	return FALSE;
+}
+
+static void finish_isolated_parse(IsolatedParse *job, gint status)
+{
+	TMSourceFile *source_file = job->source_file;
+	GPtrArray *tags = NULL;
+
+	stop_isolated_parse_input(job);
+	g_source_destroy(job->timeout_source);
+	g_source_unref(job->timeout_source);
+	job->timeout_source = NULL;
+
+	if (!job->timed_out && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		tags = tm_source_file_read_tags_cache(source_file, job->tags_file, source_file->file_name);
+	g_unlink(job->tags_file);
+	g_free(job->tags_file);
+	job->tags_file = NULL;
+
+	tm_source_file_invalidate_indexes(source_file);
+	tm_tags_array_free(source_file->tags_array, FALSE);
+	if (tags)
+	{
+		guint i;
+
+		for (i = 0; i < tags->len; i++)
+			g_ptr_array_add(source_file->tags_array, tags->pdata[i]);
+		g_ptr_array_free(tags, TRUE);
+		if (job->use_buffer)
+			set_parsed(source_file, job->buf_size, job->hash);
+	}
+	else
+		g_warning("Parsing %s %s, ignoring its tags", source_file->file_name,
+			job->timed_out ? "timed out" : "failed");
+	job->ok = tags != NULL;
+}
+
+static void start_isolated_parses(IsolatedRun *run);
+
+static void on_isolated_parse_exit(GPid pid, gint status, gpointer data)
+{
+	IsolatedParse *job = data;
+	IsolatedRun *run = job->run;
+
+	g_spawn_close_pid(pid);
+	finish_isolated_parse(job, status);
+	run->n_running--;
+	start_isolated_parses(run);
+}
+
+static gboolean start_isolated_parse(IsolatedRun *run, IsolatedParse *job)
+{
+	TMSourceFile *source_file = job->source_file;
+	GPtrArray *argv = g_ptr_array_new_with_free_func(g_free);
+	gchar **ignore_symbols = tm_ctags_get_ignore_symbols();
+	GError *error = NULL;
+	GSource *source;
+	gint input_fd = -1;
+	gboolean ok;
+	gchar **symbol;
+	gint fd;
+
+	fd = g_file_open_tmp("geany-tags-XXXXXX", &job->tags_file, NULL);
+	if (fd < 0)
+		return FALSE;
+	close(fd);
+
+	g_ptr_array_add(argv, g_strdup(run->helper));
+	if (job->use_buffer)
+		g_ptr_array_add(argv, g_strdup("--buffer"));
+	g_ptr_array_add(argv, g_strdup_printf("%d", source_file->lang));
+	g_ptr_array_add(argv, g_strdup(source_file->trust_file_scope ? "1" : "0"));
+	g_ptr_array_add(argv, g_strdup(source_file->file_name));
+	g_ptr_array_add(argv, g_strdup(job->tags_file));
+	for (symbol = ignore_symbols; *symbol; symbol++)
+		g_ptr_array_add(argv, g_strdup(*symbol));
+	g_ptr_array_add(argv, NULL);
+	g_strfreev(ignore_symbols);
+
+	ok = g_spawn_async_with_pipes(NULL, (gchar **) argv->pdata, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+		NULL, NULL, &job->pid, job->use_buffer ? &input_fd : NULL, NULL, NULL, &error);
+	g_ptr_array_free(argv, TRUE);
+	if (!ok)
+	{
+		g_warning("Cannot start %s: %s", run->helper, error->message);
+		g_error_free(error);
+		g_unlink(job->tags_file);
+		g_free(job->tags_file);
+		job->tags_file = NULL;
+		return FALSE;
+	}
+
+	job->run = run;
+	job->timed_out = FALSE;
+	if (job->use_buffer)
+	{
+		job->input = g_io_channel_unix_new(input_fd);
+		g_io_channel_set_flags(job->input, G_IO_FLAG_NONBLOCK, NULL);
+		job->written = 0;
+		job->input_source = g_io_create_watch(job->input, G_IO_OUT | G_IO_ERR | G_IO_HUP);
+		g_source_set_callback(job->input_source, (GSourceFunc) on_isolated_parse_input, job, NULL);
+		g_source_attach(job->input_source, run->context);
+	}
+
+	job->timeout_source = g_timeout_source_new(run->timeout);
+	g_source_set_callback(job->timeout_source, on_isolated_parse_timeout, job, NULL);
+	g_source_attach(job->timeout_source, run->context);
+
+	source = g_child_watch_source_new(job->pid);
+	g_source_set_callback(source, (GSourceFunc) on_isolated_parse_exit, job, NULL);
+	g_source_attach(source, run->context);
+	g_source_unref(source);
+	return TRUE;
+}
+
+/* Starts the next jobs while less than max_running helpers run. */
+static void start_isolated_parses(IsolatedRun *run)
+{
+	while (run->n_running < run->max_running && run->next < run->count)
+	{
+		IsolatedParse *job = &run->jobs[run->next++];
+
+		if (run->helper && start_isolated_parse(run, job))
+			run->n_running++;
+		else
+		{
+			/* parse in this process when no helper can be started */
+			run->helper = NULL;
+			tm_source_file_parse(job->source_file, job->text_buf, job->buf_size, job->use_buffer);
+			job->ok = TRUE;
+		}
+	}
+}
+
+/* Runs up to max_running helpers at the same time until all jobs are done. The
+ * helpers are watched from a context of their own, as this can run in any thread. */
+static void run_isolated_parses(IsolatedParse *jobs, guint count, guint max_running,
+	const gchar *helper, guint timeout)
+{
+	IsolatedRun run = {jobs, count, 0, max_running, 0, helper, timeout, g_main_context_new()};
+
+	start_isolated_parses(&run);
+	while (run.n_running > 0)
+		g_main_context_iteration(run.context, TRUE);
+	g_main_context_unref(run.context);
+}
+#endif
+
+static gboolean parse_isolated(IsolatedParse *parses, guint count, guint jobs,
+	const gchar *helper, guint timeout)
+{
+	gboolean ok = TRUE;
+	guint i;
+
+#ifdef G_OS_UNIX
+	if (helper)
+		run_isolated_parses(parses, count, MAX(jobs, 1), helper, timeout);
+	else
+#endif
+	{
+		for (i = 0; i < count; i++)
+		{
+			tm_source_file_parse(parses[i].source_file, parses[i].text_buf, parses[i].buf_size,
+				parses[i].use_buffer);
+			parses[i].ok = TRUE;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		ok = ok && parses[i].ok;
+	return ok;
+}
+
+/* Like tm_source_file_parse() but parses with the parse helper program, which is
+ killed after timeout milliseconds, so a parser stuck on some input can't freeze
+ the program. The tags are dropped when the parse doesn't finish in time. Parses
+ in this process without a helper or on systems other than Unix.
+ @return FALSE if the parse timed out or failed. */
+gboolean tm_source_file_parse_isolated(TMSourceFile *source_file, guchar *text_buf,
+	gsize buf_size, gboolean use_buffer, const gchar *helper, guint timeout)
+{
+	IsolatedParse parse = {source_file, text_buf, buf_size, use_buffer, 0, FALSE};
+
+	if (!source_file || !source_file->file_name || source_file->lang == TM_PARSER_NONE ||
+		(use_buffer && (!text_buf || buf_size == 0)) ||
+		is_parsed(source_file, text_buf, buf_size, use_buffer, &parse.hash))
+	{
+		/* nothing to run the parser on */
+		tm_source_file_parse(source_file, text_buf, buf_size, use_buffer);
+		return TRUE;
+	}
+
+	return parse_isolated(&parse, 1, 1, helper, timeout);
+}
+
+/* Parses the files of source_files from disk with up to jobs helpers at the
+ same time, see tm_source_file_parse_isolated().
+ @return FALSE if parsing some of the files timed out or failed. */
+gboolean tm_source_files_parse_isolated(GPtrArray *source_files, guint jobs,
+	const gchar *helper, guint timeout)
+{
+	IsolatedParse *parses = g_new0(IsolatedParse, source_files->len);
+	gboolean ok;
+	guint i;
+
+	for (i = 0; i < source_files->len; i++)
+		parses[i].source_file = source_files->pdata[i];
+
+	ok = parse_isolated(parses, source_files->len, jobs, helper, timeout);
+	g_free(parses);
+	return ok;
+}
+
+/* Stores the index of source_file in theWorkspace->source_files and in its
+ array of theWorkspace->source_file_map, so it can be removed without searching
+ them. -1 if it isn't in the workspace. */
+void tm_source_file_set_workspace_index(TMSourceFile *source_file, gint index, gint name_index)
+{
+	TMSourceFilePriv *priv = (TMSourceFilePriv *) source_file;
+
+	priv->workspace_index = index;
+	priv->workspace_name_index = name_index;
+}
+
+gint tm_source_file_get_workspace_index(const TMSourceFile *source_file, gint *name_index)
+{
+	const TMSourceFilePriv *priv = (const TMSourceFilePriv *) source_file;
+
+	if (name_index)
+		*name_index = priv->workspace_name_index;
+	return priv->workspace_index;
+}
+
+/* Drops the lookup structures built from the tags of source_file and forgets
+ which buffer they were parsed from. Has to be called whenever
+ source_file->tags_array changes. */
+GEANY_EXPORT_SYMBOL
+void tm_source_file_invalidate_indexes(TMSourceFile *source_file)
+{
+	TMSourceFilePriv *priv = (TMSourceFilePriv *) source_file;
+
+	priv->parsed_valid = FALSE;
+
+	if (priv->scope_ranges)
+		g_array_free(priv->scope_ranges, TRUE);
+	priv->scope_ranges = NULL;
+}
+
+static gint scope_range_cmp(gconstpointer a, gconstpointer b)
+{
+	const TMTag *t1 = ((const TMScopeRange *) a)->tag;
+	const TMTag *t2 = ((const TMScopeRange *) b)->tag;
+
+	if (t1->line != t2->line)
+		return t1->line < t2->line ? -1 : 1;
+	/* enclosing ranges before the enclosed ones */
+	if (t1->end_line != t2->end_line)
+		return t1->end_line > t2->end_line ? -1 : 1;
+	return 0;
+}
+
+/* Collects the tags with a known end line sorted by their first line. As the
+ ranges are nested, the ranges containing a line are the one starting last
+ before the line and its parents. */
+static GArray *build_scope_ranges(GPtrArray *tags, TMTagType *types)
+{
+	GArray *ranges = g_array_new(FALSE, FALSE, sizeof(TMScopeRange));
+	guint i;
+
+	*types = tm_tag_undef_t;
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+
+		if (tag->end_line >= tag->line && tag->end_line > 0)
+		{
+			TMScopeRange range;
+
+			range.tag = tag;
+			range.parent = -1;
+			g_array_append_val(ranges, range);
+			*types |= tag->type;
+		}
+	}
+	g_array_sort(ranges, scope_range_cmp);
+
+	for (i = 1; i < ranges->len; i++)
+	{
+		TMScopeRange *range = &g_array_index(ranges, TMScopeRange, i);
+		gint parent = i - 1;
+
+		/* skip the ranges which ended before this one starts */
+		while (parent >= 0 &&
+			g_array_index(ranges, TMScopeRange, parent).tag->end_line < range->tag->line)
+		{
+			parent = g_array_index(ranges, TMScopeRange, parent).parent;
+		}
+		range->parent = parent;
+	}
+
+	return ranges;
+}
+
+/* Gets the innermost tag of tag_types whose range contains line. The ranges
+ are built on first use after the tags of source_file changed.
+ @param source_file The source file
+ @param line The line number
+ @param tag_types The tag types to include in the match
+ @param has_ranges Set to whether the parser reported ranges for any tags of
+ tag_types; if not, NULL returned doesn't mean line isn't inside such a tag
+ @return The matching tag or NULL */
+const TMTag *tm_source_file_get_scope_tag(TMSourceFile *source_file, gulong line,
+	TMTagType tag_types, gboolean *has_ranges)
+{
+	TMSourceFilePriv *priv = (TMSourceFilePriv *) source_file;
+	GArray *ranges;
+	guint lo = 0, hi;
+	gint i;
+
+	if (!priv->scope_ranges)
+		priv->scope_ranges = build_scope_ranges(source_file->tags_array, &priv->scope_range_types);
+	ranges = priv->scope_ranges;
+
+	*has_ranges = (priv->scope_range_types & tag_types) != 0;
+
+	/* find the last range starting on or before line */
+	hi = ranges->len;
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index(ranges, TMScopeRange, mid).tag->line <= line)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = (gint) lo - 1; i >= 0; i = g_array_index(ranges, TMScopeRange, i).parent)
+	{
+		const TMTag *tag = g_array_index(ranges, TMScopeRange, i).tag;
+
+		if (tag->end_line >= line && (tag->type & tag_types))
+			return tag;
+	}
+
+	return NULL;
+}
+
+/* Finds the offsets of the start of first_line and of the end of last_line
+ (1-based) in text_buf. Fails when the lines don't exist or a bare CR is found
+ as we only count LFs. */
+static gboolean find_lines_range(const guchar *text_buf, gsize buf_size, gulong first_line,
+	gulong last_line, gsize *start, gsize *end)
+{
+	gulong line;
+	gsize pos = 0;
+
+	for (line = 1; line <= last_line; line++)
+	{
+		const guchar *nl, *cr;
+		gsize next;
+
+		if (line == first_line)
+			*start = pos;
+		if (pos >= buf_size)
+			return FALSE;
+
+		nl = memchr(text_buf + pos, '\n', buf_size - pos);
+		next = nl ? (gsize) (nl - text_buf) + 1 : buf_size;
+		cr = memchr(text_buf + pos, '\r', next - pos);
+		if (cr && cr + 1 != nl)
+			return FALSE;
+		pos = next;
+	}
+
+	*end = pos;
+	return TRUE;
+}
+
+/* Copy of tag moved by line_delta lines, used instead of modifying the tag in
+ place as it may be referenced elsewhere, e.g. in the symbol tree. */
+static TMTag *copy_moved_tag(const TMTag *tag, glong line_delta, TMTagChunk **chunk)
+{
+	TMTag *copy = tm_tag_new_in_chunk(chunk);
+
+	copy->name = tm_tag_intern_string(tag->name);
+	copy->type = tag->type;
+	copy->file = tag->file;
+	copy->line = tag->line + line_delta;
+	copy->end_line = tag->end_line ? tag->end_line + line_delta : 0;
+	copy->local = tag->local;
+	copy->flags = tag->flags;
+	copy->arglist = tm_tag_intern_string(tag->arglist);
+	copy->scope = tm_tag_intern_string(tag->scope);
+	copy->inheritance = tm_tag_intern_string(tag->inheritance);
+	copy->var_type = tm_tag_intern_string(tag->var_type);
+	copy->access = tag->access;
+	copy->impl = tag->impl;
+	copy->lang = tag->lang;
+	copy->kind_letter = tag->kind_letter;
+
+	return copy;
+}
+
+/* Reparses only the top-level function or class containing the changed lines
+ instead of the whole buffer.
+ The changed part is reparsed on its own, so only parsers whose top-level
+ functions and classes can be parsed without their surroundings are supported,
+ and anything suspicious (anonymous tags whose numbering depends on the rest of
+ the file, a different extent or scope of the reparsed tag...) makes it fail.
+ @param source_file The source file, which has to be parsed already
+ @param text_buf The new contents of the file
+ @param buf_size The size of text_buf
+ @param first_line The first changed line (1-based) in the previously parsed contents
+ @param last_line The last changed line in the previously parsed contents
+ @param line_delta The number of lines added (or removed when negative) by the change
+ @return TRUE if the tags were updated, FALSE if the whole buffer has to be parsed
+ (in which case nothing was changed) */
+gboolean tm_source_file_parse_lines(TMSourceFile *source_file, guchar *text_buf, gsize buf_size,
+	gulong first_line, gulong last_line, glong line_delta)
+{
+	TMSourceFilePriv *priv = (TMSourceFilePriv *) source_file;
+	const TMTagType region_types = tm_tag_function_t | tm_tag_method_t | tm_tag_class_t;
+	TMSourceFile region_file;
+	TMTagChunk *chunk = NULL;
+	GPtrArray *old_tags, *new_tags;
+	const TMTag *region_tag = NULL, *new_region_tag = NULL;
+	gulong region_end, region_lines;
+	gsize start_offset, end_offset;
+	guint lo = 0, hi, i;
+	gint r;
+
+	if (source_file->lang != TM_PARSER_C && source_file->lang != TM_PARSER_CPP &&
+		source_file->lang != TM_PARSER_PYTHON && source_file->lang != TM_PARSER_GO)
+		return FALSE;
+	if (!text_buf || buf_size == 0 || first_line == 0 || last_line < first_line)
+		return FALSE;
+
+	if (!priv->scope_ranges)
+		priv->scope_ranges = build_scope_ranges(source_file->tags_array, &priv->scope_range_types);
+
+	/* find the outermost range containing first_line, it must contain last_line too */
+	hi = priv->scope_ranges->len;
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index(priv->scope_ranges, TMScopeRange, mid).tag->line <= first_line)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (r = (gint) lo - 1; r >= 0; r = g_array_index(priv->scope_ranges, TMScopeRange, r).parent)
+	{
+		if (g_array_index(priv->scope_ranges, TMScopeRange, r).parent < 0)
+			region_tag = g_array_index(priv->scope_ranges, TMScopeRange, r).tag;
+	}
+	if (!region_tag || !(region_tag->type & region_types) || region_tag->end_line < last_line ||
+		(glong) region_tag->end_line + line_delta < (glong) region_tag->line)
+		return FALSE;
+
+	for (i = 0; i < source_file->tags_array->len; i++)
+	{
+		const TMTag *tag = source_file->tags_array->pdata[i];
+
+		if (tag->line >= region_tag->line && tag->line <= region_tag->end_line &&
+			tm_tag_is_anon(tag))
+			return FALSE;
+	}
+
+	region_end = region_tag->end_line + line_delta;
+	region_lines = region_end - region_tag->line + 1;
+	if (!find_lines_range(text_buf, buf_size, region_tag->line, region_end,
+			&start_offset, &end_offset))
+		return FALSE;
+
+	region_file = *source_file;
+	region_file.tags_array = g_ptr_array_new();
+	tm_ctags_parse(text_buf + start_offset, end_offset - start_offset, source_file->file_name,
+		source_file->lang, &region_file);
+	new_tags = region_file.tags_array;
+
+	for (i = 0; i < new_tags->len; i++)
+	{
+		TMTag *tag = new_tags->pdata[i];
+
+		if (tm_tag_is_anon(tag) || tag->line < 1 || tag->line > region_lines ||
+			tag->end_line > region_lines)
+		{
+			new_region_tag = NULL;
+			break;
+		}
+		if (tag->line == 1 && tag->end_line == region_lines && tag->type == region_tag->type)
+			new_region_tag = tag;
+	}
+	/* the reparsed tag has to be the same kind of top-level tag spanning the whole region */
+	if (!new_region_tag ||
+		g_strcmp0(new_region_tag->scope, region_tag->scope) != 0 ||
+		g_strcmp0(new_region_tag->var_type, region_tag->var_type) != 0)
+	{
+		tm_tags_array_free(new_tags, TRUE);
+		return FALSE;
+	}
+
+	/* splice the reparsed tags into the tags of the file, keeping the array itself */
+	old_tags = g_ptr_array_sized_new(source_file->tags_array->len);
+	for (i = 0; i < source_file->tags_array->len; i++)
+		g_ptr_array_add(old_tags, source_file->tags_array->pdata[i]);
+	g_ptr_array_set_size(source_file->tags_array, 0);
+	for (i = 0; i < old_tags->len; i++)
+	{
+		TMTag *tag = old_tags->pdata[i];
+
+		if (tag->line < region_tag->line)
+			g_ptr_array_add(source_file->tags_array, tm_tag_ref(tag));
+		else if (tag->line > region_tag->end_line)
+			g_ptr_array_add(source_file->tags_array, copy_moved_tag(tag, line_delta, &chunk));
+	}
+	tm_tag_chunk_release(&chunk);
+	for (i = 0; i < new_tags->len; i++)
+	{
+		TMTag *tag = new_tags->pdata[i];
+
+		tag->file = source_file;
+		tag->line += region_tag->line - 1;
+		if (tag->end_line)
+			tag->end_line += region_tag->line - 1;
+		g_ptr_array_add(source_file->tags_array, tag);
+	}
+	g_ptr_array_free(new_tags, TRUE);
+
+	/* region_tag belongs to old_tags */
+	tm_source_file_invalidate_indexes(source_file);
+	tm_tags_array_free(old_tags, TRUE);
+
+	return TRUE;
+}
+
 /* Gets the name associated with the language index.
  @param lang The language index.
  @return The language name, or NULL.
 */
+GEANY_EXPORT_SYMBOL
 const gchar *tm_source_file_get_lang_name(TMParserType lang)
 {
 	return tm_ctags_get_lang_name(lang);
@@ -59,10 +59,42 @@ TMParserType tm_source_file_get_named_lang(const gchar *name);
 gboolean tm_source_file_parse(TMSourceFile *source_file, guchar* text_buf, gsize buf_size,
 	gboolean use_buffer);
 
+gboolean tm_source_file_parse_isolated(TMSourceFile *source_file, guchar *text_buf,
+	gsize buf_size, gboolean use_buffer, const gchar *helper, guint timeout);
+
+gboolean tm_source_files_parse_isolated(GPtrArray *source_files, guint jobs,
+	const gchar *helper, guint timeout);
+
+gsize tm_source_file_get_memory_size(const TMSourceFile *source_file);
+
 GPtrArray *tm_source_file_read_tags_file(const gchar *tags_file, TMParserType mode);
 
 gboolean tm_source_file_write_tags_file(const gchar *tags_file, GPtrArray *tags_array);
 
+gboolean tm_source_file_is_binary_tags_file(const gchar *tags_file);
+
+GPtrArray *tm_source_file_read_binary_tags_file(const gchar *tags_file, TMParserType mode);
+
+gboolean tm_source_file_write_binary_tags_file(const gchar *tags_file, GPtrArray *tags_array);
+
+gboolean tm_source_file_write_tags_cache(TMSourceFile *source_file, const gchar *cache_file,
+	const gchar *key);
+
+GPtrArray *tm_source_file_read_tags_cache(TMSourceFile *source_file, const gchar *cache_file,
+	const gchar *key);
+
+const struct TMTag *tm_source_file_get_scope_tag(TMSourceFile *source_file, gulong line,
+	TMTagType tag_types, gboolean *has_ranges);
+
+void tm_source_file_invalidate_indexes(TMSourceFile *source_file);
+
+void tm_source_file_set_workspace_index(TMSourceFile *source_file, gint index, gint name_index);
+
+gint tm_source_file_get_workspace_index(const TMSourceFile *source_file, gint *name_index);
+
+gboolean tm_source_file_parse_lines(TMSourceFile *source_file, guchar *text_buf, gsize buf_size,
+	gulong first_line, gulong last_line, glong line_delta);
+
 gchar tm_source_file_get_tag_impl(const gchar *impl);
 
 gchar tm_source_file_get_tag_access(const gchar *access);
@@ -81,6 +81,7 @@ typedef struct
 	gboolean partial;
 	const GPtrArray *tags_array;
 	gboolean first;
+	GCompareDataFunc compare;
 } TMSortOptions;
 
 /** Gets the GType for a TMTag.
@@ -99,10 +100,82 @@ GType tm_tag_get_type(void)
 	return gtype;
 }
 
+/* Strings shared by tags, mapping each string to its reference count. Scopes,
+ * types etc. repeat across many tags so they are stored only once. Tags may be
+ * created by parsing in a different thread than the one destroying them, hence
+ * the lock. */
+static GHashTable *string_pool = NULL;
+G_LOCK_DEFINE_STATIC(string_pool);
+
+/*
+ Returns a shared copy of str which has to be released using tm_tag_release_string()
+ (which happens automatically for strings of destroyed tags).
+ @param str The string to intern, may be NULL
+ @return the interned string
+*/
+GEANY_EXPORT_SYMBOL
+gchar *tm_tag_intern_string(const gchar *str)
+{
+	gpointer key, count;
+
+	if (!str)
+		return NULL;
+
+	G_LOCK(string_pool);
+
+	if (G_UNLIKELY(!string_pool))
+		string_pool = g_hash_table_new(g_str_hash, g_str_equal);
+
+	if (g_hash_table_lookup_extended(string_pool, str, &key, &count))
+		g_hash_table_insert(string_pool, key, GUINT_TO_POINTER(GPOINTER_TO_UINT(count) + 1));
+	else
+	{
+		key = g_strdup(str);
+		g_hash_table_insert(string_pool, key, GUINT_TO_POINTER(1));
+	}
+
+	G_UNLOCK(string_pool);
+
+	return key;
+}
+
+/*
+ Releases a tag string. Strings which weren't obtained from tm_tag_intern_string()
+ are simply freed so tags can mix interned and separately allocated strings.
+ @param str The string to release, may be NULL
+*/
+void tm_tag_release_string(gchar *str)
+{
+	gpointer key, count;
+
+	if (!str)
+		return;
+
+	G_LOCK(string_pool);
+
+	if (string_pool && g_hash_table_lookup_extended(string_pool, str, &key, &count) && key == str)
+	{
+		guint n = GPOINTER_TO_UINT(count) - 1;
+
+		if (n > 0)
+		{
+			g_hash_table_insert(string_pool, key, GUINT_TO_POINTER(n));
+			G_UNLOCK(string_pool);
+			return;
+		}
+		g_hash_table_remove(string_pool, str);
+	}
+
+	G_UNLOCK(string_pool);
+
+	g_free(str);
+}
+
 /*
  Creates a new tag structure and returns a pointer to it.
  @return the new TMTag structure. This should be free()-ed using tm_tag_free()
 */
+GEANY_EXPORT_SYMBOL
 TMTag *tm_tag_new(void)
 {
 	TMTag *tag;
@@ -113,6 +186,76 @@ TMTag *tm_tag_new(void)
 	return tag;
 }
 
+/* Tags created in bulk (e.g. when parsing a file) are allocated from chunks
+ * instead of one by one. A chunk holds a reference for every tag allocated from
+ * it which is alive and one more while it is used for allocation; it is freed
+ * at once when the last of these references is dropped (usually after the file
+ * is reparsed and no tag escaped elsewhere). */
+#define TAG_CHUNK_MIN_SIZE 16
+#define TAG_CHUNK_MAX_SIZE 1024
+
+struct TMTagChunk
+{
+	gint refcount;
+	guint size;
+	guint used;
+	TMTag tags[1];
+};
+
+static void tag_chunk_unref(TMTagChunk *chunk)
+{
+	if (g_atomic_int_dec_and_test(&chunk->refcount))
+		g_free(chunk);
+}
+
+/*
+ Creates a new tag allocated from *chunk, replacing *chunk with a new chunk when
+ it is NULL or full. The chunk has to be released using tm_tag_chunk_release()
+ once no more tags are going to be allocated from it.
+ @param chunk Location of the chunk to allocate from
+ @return the new TMTag structure. This should be freed using tm_tag_unref()
+*/
+TMTag *tm_tag_new_in_chunk(TMTagChunk **chunk)
+{
+#ifdef DEBUG_TAG_REFS
+	return tm_tag_new();
+#else
+	TMTagChunk *c = *chunk;
+	TMTag *tag;
+
+	if (!c || c->used == c->size)
+	{
+		/* start small for files with few tags and grow for bigger ones */
+		guint size = c ? MIN(c->size * 2, TAG_CHUNK_MAX_SIZE) : TAG_CHUNK_MIN_SIZE;
+
+		if (c)
+			tag_chunk_unref(c);
+		c = g_malloc0(G_STRUCT_OFFSET(TMTagChunk, tags) + size * sizeof(TMTag));
+		c->refcount = 1;
+		c->size = size;
+		*chunk = c;
+	}
+
+	tag = &c->tags[c->used++];
+	tag->refcount = 1;
+	tag->chunk = c;
+	g_atomic_int_inc(&c->refcount);
+
+	return tag;
+#endif
+}
+
+/*
+ Stops allocating tags from *chunk; the chunk is freed when all its tags are gone.
+ @param chunk Location of the chunk, set to NULL
+*/
+void tm_tag_chunk_release(TMTagChunk **chunk)
+{
+	if (*chunk)
+		tag_chunk_unref(*chunk);
+	*chunk = NULL;
+}
+
 /*
  Destroys a TMTag structure, i.e. frees all elements except the tag itself.
  @param tag The TMTag structure to destroy
@@ -120,11 +263,11 @@ TMTag *tm_tag_new(void)
 */
 static void tm_tag_destroy(TMTag *tag)
 {
-	g_free(tag->name);
-	g_free(tag->arglist);
-	g_free(tag->scope);
-	g_free(tag->inheritance);
-	g_free(tag->var_type);
+	tm_tag_release_string(tag->name);
+	tm_tag_release_string(tag->arglist);
+	tm_tag_release_string(tag->scope);
+	tm_tag_release_string(tag->inheritance);
+	tm_tag_release_string(tag->var_type);
 }
 
 
@@ -133,6 +276,7 @@ static void tm_tag_destroy(TMTag *tag)
  destroys all data in the tag and frees the tag structure as well.
  @param tag Pointer to a TMTag structure
 */
+GEANY_EXPORT_SYMBOL
 void tm_tag_unref(TMTag *tag)
 {
 	/* be NULL-proof because tm_tag_free() was NULL-proof and we indent to be a
@@ -140,7 +284,10 @@ void tm_tag_unref(TMTag *tag)
 	if (NULL != tag && g_atomic_int_dec_and_test(&tag->refcount))
 	{
 		tm_tag_destroy(tag);
-		TAG_FREE(tag);
+		if (tag->chunk)
+			tag_chunk_unref(tag->chunk);
+		else
+			TAG_FREE(tag);
 	}
 }
 
@@ -155,6 +302,14 @@ TMTag *tm_tag_ref(TMTag *tag)
 	return tag;
 }
 
+/* interned strings can be compared by pointer */
+static inline gint compare_strings(const gchar *s1, const gchar *s2)
+{
+	if (s1 == s2)
+		return 0;
+	return strcmp(FALLBACK(s1, ""), FALLBACK(s2, ""));
+}
+
 /*
  Inbuilt tag comparison function.
 */
@@ -176,7 +331,7 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 		if (sort_options->partial)
 			return strncmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""), strlen(FALLBACK(t1->name, "")));
 		else
-			return strcmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""));
+			return compare_strings(t1->name, t2->name);
 	}
 
 	for (sort_attr = sort_options->sort_attrs; returnval == 0 && *sort_attr != tm_tag_attr_none_t; ++ sort_attr)
@@ -187,7 +342,7 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 				if (sort_options->partial)
 					returnval = strncmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""), strlen(FALLBACK(t1->name, "")));
 				else
-					returnval = strcmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""));
+					returnval = compare_strings(t1->name, t2->name);
 				break;
 			case tm_tag_attr_file_t:
 				returnval = t1->file - t2->file;
@@ -199,10 +354,10 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 				returnval = t1->type - t2->type;
 				break;
 			case tm_tag_attr_scope_t:
-				returnval = strcmp(FALLBACK(t1->scope, ""), FALLBACK(t2->scope, ""));
+				returnval = compare_strings(t1->scope, t2->scope);
 				break;
 			case tm_tag_attr_arglist_t:
-				returnval = strcmp(FALLBACK(t1->arglist, ""), FALLBACK(t2->arglist, ""));
+				returnval = compare_strings(t1->arglist, t2->arglist);
 				if (returnval != 0)
 				{
 					int line_diff = (t1->line - t2->line);
@@ -211,13 +366,85 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 				}
 				break;
 			case tm_tag_attr_vartype_t:
-				returnval = strcmp(FALLBACK(t1->var_type, ""), FALLBACK(t2->var_type, ""));
+				returnval = compare_strings(t1->var_type, t2->var_type);
 				break;
 		}
 	}
 	return returnval;
 }
 
+/* Specialized versions of tm_tag_compare() for the attributes tag arrays are
+ * sorted by most of the time - name, [file,] [line,] type, scope, arglist -
+ * which avoid walking the attribute array for every comparison of a sort or
+ * merge. */
+static inline gint compare_tags_by_name(const TMTag *t1, const TMTag *t2,
+	gboolean by_file, gboolean by_line)
+{
+	gint ret;
+
+	if ((ret = compare_strings(t1->name, t2->name)) != 0)
+		return ret;
+	if (by_file && t1->file != t2->file)
+		return t1->file < t2->file ? -1 : 1;
+	if (by_line && t1->line != t2->line)
+		return t1->line < t2->line ? -1 : 1;
+	if (t1->type != t2->type)
+		return t1->type < t2->type ? -1 : 1;
+	if ((ret = compare_strings(t1->scope, t2->scope)) != 0)
+		return ret;
+	if ((ret = compare_strings(t1->arglist, t2->arglist)) != 0 && t1->line != t2->line)
+		return t1->line < t2->line ? -1 : 1;
+	return ret;
+}
+
+static gint compare_workspace_tags(gconstpointer ptr1, gconstpointer ptr2, gpointer user_data)
+{
+	return compare_tags_by_name(*((TMTag **) ptr1), *((TMTag **) ptr2), TRUE, TRUE);
+}
+
+static gint compare_file_tags(gconstpointer ptr1, gconstpointer ptr2, gpointer user_data)
+{
+	return compare_tags_by_name(*((TMTag **) ptr1), *((TMTag **) ptr2), FALSE, TRUE);
+}
+
+static gint compare_global_tags(gconstpointer ptr1, gconstpointer ptr2, gpointer user_data)
+{
+	return compare_tags_by_name(*((TMTag **) ptr1), *((TMTag **) ptr2), FALSE, FALSE);
+}
+
+static gboolean sort_attrs_equal(const guint *attrs1, const guint *attrs2)
+{
+	while (*attrs1 != tm_tag_attr_none_t && *attrs1 == *attrs2)
+	{
+		attrs1++;
+		attrs2++;
+	}
+	return *attrs1 == *attrs2;
+}
+
+static void init_sort_options(TMSortOptions *sort_options, TMTagAttrType *sort_attributes)
+{
+	static const guint workspace_attrs[] = {tm_tag_attr_name_t, tm_tag_attr_file_t,
+		tm_tag_attr_line_t, tm_tag_attr_type_t, tm_tag_attr_scope_t, tm_tag_attr_arglist_t, 0};
+	static const guint file_attrs[] = {tm_tag_attr_name_t, tm_tag_attr_line_t,
+		tm_tag_attr_type_t, tm_tag_attr_scope_t, tm_tag_attr_arglist_t, 0};
+	static const guint global_attrs[] = {tm_tag_attr_name_t,
+		tm_tag_attr_type_t, tm_tag_attr_scope_t, tm_tag_attr_arglist_t, 0};
+
+	sort_options->sort_attrs = sort_attributes;
+	sort_options->partial = FALSE;
+	sort_options->compare = tm_tag_compare;
+
+	if (!sort_attributes)
+		return;
+	if (sort_attrs_equal(sort_options->sort_attrs, workspace_attrs))
+		sort_options->compare = compare_workspace_tags;
+	else if (sort_attrs_equal(sort_options->sort_attrs, file_attrs))
+		sort_options->compare = compare_file_tags;
+	else if (sort_attrs_equal(sort_options->sort_attrs, global_attrs))
+		sort_options->compare = compare_global_tags;
+}
+
 gboolean tm_tags_equal(const TMTag *a, const TMTag *b)
 {
 	if (a == b)
@@ -225,17 +452,17 @@ gboolean tm_tags_equal(const TMTag *a, const TMTag *b)
 
 	return (a->line == b->line &&
 			a->file == b->file /* ptr comparison */ &&
-			strcmp(FALLBACK(a->name, ""), FALLBACK(b->name, "")) == 0 &&
+			compare_strings(a->name, b->name) == 0 &&
 			a->type == b->type &&
 			a->local == b->local &&
 			a->flags == b->flags &&
 			a->access == b->access &&
 			a->impl == b->impl &&
 			a->lang == b->lang &&
-			strcmp(FALLBACK(a->scope, ""), FALLBACK(b->scope, "")) == 0 &&
-			strcmp(FALLBACK(a->arglist, ""), FALLBACK(b->arglist, "")) == 0 &&
-			strcmp(FALLBACK(a->inheritance, ""), FALLBACK(b->inheritance, "")) == 0 &&
-			strcmp(FALLBACK(a->var_type, ""), FALLBACK(b->var_type, "")) == 0);
+			compare_strings(a->scope, b->scope) == 0 &&
+			compare_strings(a->arglist, b->arglist) == 0 &&
+			compare_strings(a->inheritance, b->inheritance) == 0 &&
+			compare_strings(a->var_type, b->var_type) == 0);
 }
 
 /*
@@ -273,11 +500,10 @@ void tm_tags_dedup(GPtrArray *tags_array, TMTagAttrType *sort_attributes, gboole
 	if (tags_array->len < 2)
 		return;
 
-	sort_options.sort_attrs = sort_attributes;
-	sort_options.partial = FALSE;
+	init_sort_options(&sort_options, sort_attributes);
 	for (i = 1; i < tags_array->len; ++i)
 	{
-		if (0 == tm_tag_compare(&(tags_array->pdata[i - 1]), &(tags_array->pdata[i]), &sort_options))
+		if (0 == sort_options.compare(&(tags_array->pdata[i - 1]), &(tags_array->pdata[i]), &sort_options))
 		{
 			if (unref_duplicates)
 				tm_tag_unref(tags_array->pdata[i-1]);
@@ -294,6 +520,7 @@ void tm_tags_dedup(GPtrArray *tags_array, TMTagAttrType *sort_attributes, gboole
  @param sort_attributes Attributes to be sorted on (int array terminated by 0)
  @param dedup Whether to deduplicate the sorted array
 */
+GEANY_EXPORT_SYMBOL
 void tm_tags_sort(GPtrArray *tags_array, TMTagAttrType *sort_attributes,
 	gboolean dedup, gboolean unref_duplicates)
 {
@@ -301,15 +528,60 @@ void tm_tags_sort(GPtrArray *tags_array, TMTagAttrType *sort_attributes,
 
 	g_return_if_fail(tags_array);
 
-	sort_options.sort_attrs = sort_attributes;
-	sort_options.partial = FALSE;
-	g_ptr_array_sort_with_data(tags_array, tm_tag_compare, &sort_options);
+	init_sort_options(&sort_options, sort_attributes);
+	g_ptr_array_sort_with_data(tags_array, sort_options.compare, &sort_options);
 	if (dedup)
 		tm_tags_dedup(tags_array, sort_attributes, unref_duplicates);
 }
 
+/* Removes the NULL entries from first onwards, moving the tags between them
+ * in blocks. */
+static void prune_from(GPtrArray *tags_array, guint first)
+{
+	guint dest = first;
+	guint src = first;
+
+	while (src < tags_array->len)
+	{
+		guint end;
+
+		while (src < tags_array->len && tags_array->pdata[src] == NULL)
+			src++;
+		for (end = src; end < tags_array->len && tags_array->pdata[end] != NULL; end++);
+
+		if (dest != src)
+			memmove(tags_array->pdata + dest, tags_array->pdata + src, (end - src) * sizeof(gpointer));
+		dest += end - src;
+		src = end;
+	}
+	tags_array->len = dest;
+}
+
+
+/* Returns the index of the first tag of tags_array not sorted before tag in
+ * the workspace sort order. */
+static guint find_workspace_tag(GPtrArray *tags_array, TMTag *tag)
+{
+	guint lo = 0, hi = tags_array->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (compare_workspace_tags(&tags_array->pdata[mid], &tag, NULL) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+/* tags_array has to be sorted by workspace_tags_sort_attrs, like the workspace
+ * tags_array and typename_array. */
 void tm_tags_remove_file_tags(TMSourceFile *source_file, GPtrArray *tags_array)
 {
+	guint first = tags_array->len;
 	guint i;
 
 	/* Now we choose between an algorithm with complexity O(tags_array->len) and
@@ -331,7 +603,10 @@ void tm_tags_remove_file_tags(TMSourceFile *source_file, GPtrArray *tags_array)
 			TMTag *tag = tags_array->pdata[i];
 
 			if (tag->file == source_file)
+			{
 				tags_array->pdata[i] = NULL;
+				first = MIN(first, i);
+			}
 		}
 	}
 	else
@@ -340,24 +615,27 @@ void tm_tags_remove_file_tags(TMSourceFile *source_file, GPtrArray *tags_array)
 
 		for (i = 0; i < source_file->tags_array->len; i++)
 		{
-			guint j;
-			guint tag_count;
-			TMTag **found;
 			TMTag *tag = source_file->tags_array->pdata[i];
+			guint j;
 
-			found = tm_tags_find(tags_array, tag->name, FALSE, &tag_count);
-
-			for (j = 0; j < tag_count; j++)
+			/* The workspace arrays are sorted by name, file and line first
+			 * so search for the tag itself instead of going through all the
+			 * tags of the same name, e.g. of common local variables. Only
+			 * tags equal in all the sort attributes follow. */
+			for (j = find_workspace_tag(tags_array, tag); j < tags_array->len; j++)
 			{
-				if (*found != NULL && (*found)->file == source_file)
+				TMTag **found = (TMTag **) &tags_array->pdata[j];
+
+				if (compare_workspace_tags(found, &tag, NULL) != 0)
+					break;
+				if ((*found)->file == source_file)
 				{
 					/* we cannot set the pointer to NULL now because the search wouldn't work */
 					g_ptr_array_add(to_delete, found);
-					/* no break - if there are multiple tags of the same name, we would
-					 * always find the first instance and wouldn't remove others; duplicates
-					 * in the to_delete list aren't a problem */
+					first = MIN(first, j);
+					/* no break - there can be several tags equal in the sort
+					 * attributes; duplicates in the to_delete list aren't a problem */
 				}
-				found++;
 			}
 		}
 
@@ -369,7 +647,8 @@ void tm_tags_remove_file_tags(TMSourceFile *source_file, GPtrArray *tags_array)
 		g_ptr_array_free(to_delete, TRUE);
 	}
 
-	tm_tags_prune(tags_array);
+	/* the tags before the first removed one stay in place */
+	prune_from(tags_array, first);
 }
 
 /* Optimized merge sort for merging sorted values from one array to another
@@ -419,7 +698,7 @@ static GPtrArray *merge(GPtrArray *big_array, GPtrArray *small_array,
 			/* if the value in big_array after making the big step is still smaller
 			 * than the value in small_array, we can copy all the values inbetween
 			 * into the result without making expensive string comparisons */
-			if (tm_tag_compare(&val1, &val2, sort_options) < 0)
+			if (sort_options->compare(&val1, &val2, sort_options) < 0)
 			{
 				while (i1 <= j1)
 				{
@@ -442,7 +721,7 @@ static GPtrArray *merge(GPtrArray *big_array, GPtrArray *small_array,
 			cmpnum++;
 #endif
 			val1 = big_array->pdata[i1];
-			cmpval = tm_tag_compare(&val1, &val2, sort_options);
+			cmpval = sort_options->compare(&val1, &val2, sort_options);
 			if (cmpval < 0)
 			{
 				g_ptr_array_add(res_array, val1);
@@ -479,18 +758,86 @@ static GPtrArray *merge(GPtrArray *big_array, GPtrArray *small_array,
 	return res_array;
 }
 
+GEANY_EXPORT_SYMBOL
 GPtrArray *tm_tags_merge(GPtrArray *big_array, GPtrArray *small_array,
 	TMTagAttrType *sort_attributes, gboolean unref_duplicates)
 {
 	GPtrArray *res_array;
 	TMSortOptions sort_options;
 
-	sort_options.sort_attrs = sort_attributes;
-	sort_options.partial = FALSE;
+	init_sort_options(&sort_options, sort_attributes);
 	res_array = merge(big_array, small_array, &sort_options, unref_duplicates);
 	return res_array;
 }
 
+/* Returns the index of the first tag in tags[0..len) not smaller than tag. */
+static guint lower_bound(gpointer *tags, guint len, gpointer tag, TMSortOptions *sort_options)
+{
+	guint l = 0, u = len;
+
+	while (l < u)
+	{
+		guint idx = (l + u) / 2;
+
+		if (sort_options->compare(&tags[idx], &tag, sort_options) < 0)
+			l = idx + 1;
+		else
+			u = idx;
+	}
+
+	return l;
+}
+
+/* Like tm_tags_merge() but merges small_array into big_array in place. The
+ * insertion position of every tag is found using binary search and the tags
+ * of big_array between them are moved as blocks from the back towards the
+ * end of the enlarged array. This makes O(small_array->len * log(big_array->len))
+ * comparisons and no per-tag copying into a newly allocated array which
+ * matters when merging tags of a single file into the big workspace arrays. */
+GEANY_EXPORT_SYMBOL
+void tm_tags_merge_in_place(GPtrArray *big_array, GPtrArray *small_array,
+	TMTagAttrType *sort_attributes, gboolean unref_duplicates)
+{
+	TMSortOptions sort_options;
+	guint end = big_array->len;  /* big_array tags not moved yet are at [0, end) */
+	guint dst;  /* the first position of already merged tags at the end */
+	guint i;
+
+	if (small_array->len == 0)
+		return;
+
+	init_sort_options(&sort_options, sort_attributes);
+
+	g_ptr_array_set_size(big_array, big_array->len + small_array->len);
+	dst = big_array->len;
+
+	for (i = small_array->len; i > 0; i--)
+	{
+		gpointer tag = small_array->pdata[i - 1];
+		guint pos = lower_bound(big_array->pdata, end, tag, &sort_options);
+		gboolean duplicate = pos < end &&
+			sort_options.compare(&big_array->pdata[pos], &tag, &sort_options) == 0;
+		guint count = end - pos - (duplicate ? 1 : 0);
+
+		dst -= count;
+		memmove(big_array->pdata + dst, big_array->pdata + end - count, count * sizeof(gpointer));
+
+		/* remove the duplicate, keep just the newly merged value */
+		if (duplicate && unref_duplicates)
+			tm_tag_unref(big_array->pdata[pos]);
+		big_array->pdata[--dst] = tag;
+		end = pos;
+	}
+
+	/* close the gap left by removed duplicates */
+	if (dst > end)
+	{
+		memmove(big_array->pdata + end, big_array->pdata + dst,
+			(big_array->len - dst) * sizeof(gpointer));
+		g_ptr_array_set_size(big_array, big_array->len - (dst - end));
+	}
+}
+
 /*
  This function will extract the tags of the specified types from an array of tags.
  The returned value is a GPtrArray which should be free-d with a call to
@@ -540,6 +887,41 @@ void tm_tags_array_free(GPtrArray *tags_array, gboolean free_all)
 	}
 }
 
+static gsize get_string_size(const gchar *str)
+{
+	return str ? strlen(str) + 1 : 0;
+}
+
+/*
+ Estimates the memory used by an array of tags.
+ @param tags_array Array of tags.
+ @param with_tags Whether to include the tags themselves, not just the array of pointers.
+  Strings shared between tags are counted for each of them.
+ @return The size in bytes.
+*/
+gsize tm_tags_get_memory_size(const GPtrArray *tags_array, gboolean with_tags)
+{
+	gsize size;
+	guint i;
+
+	if (!tags_array)
+		return 0;
+
+	size = sizeof(GPtrArray) + tags_array->len * sizeof(gpointer);
+	if (!with_tags)
+		return size;
+
+	for (i = 0; i < tags_array->len; i++)
+	{
+		const TMTag *tag = tags_array->pdata[i];
+
+		size += sizeof(TMTag) + get_string_size(tag->name) + get_string_size(tag->arglist) +
+			get_string_size(tag->scope) + get_string_size(tag->inheritance) +
+			get_string_size(tag->var_type);
+	}
+	return size;
+}
+
 /* copy/pasted bsearch() from libc extended with user_data for comparison function
  * and using glib types */
 static gpointer binary_search(gpointer key, gpointer base, size_t nmemb,
@@ -600,6 +982,7 @@ static gint tag_search_cmp(gconstpointer ptr1, gconstpointer ptr2, gpointer user
  @param partial If TRUE, matches the first part of the name instead of doing exact match.
  @param tagCount Return location of the matched tags.
 */
+GEANY_EXPORT_SYMBOL
 TMTag **tm_tags_find(const GPtrArray *tags_array, const char *name,
 		gboolean partial, guint *tagCount)
 {
@@ -615,6 +998,7 @@ TMTag **tm_tags_find(const GPtrArray *tags_array, const char *name,
 
 	sort_options.sort_attrs = NULL;
 	sort_options.partial = partial;
+	sort_options.compare = tm_tag_compare;
 	sort_options.tags_array = tags_array;
 	sort_options.first = TRUE;
 	first = (TMTag **)binary_search(&tag, tags_array->pdata, tags_array->len,
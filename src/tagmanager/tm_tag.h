@@ -110,6 +110,8 @@ typedef struct TMTag
 	char impl; /**< Implementation (e.g. virtual) */
 	TMParserType lang; /* Programming language of the file */
 	gchar kind_letter; /* Kind letter from ctags */
+	gulong end_line; /* Line number where the tag ends or 0 if unknown */
+	struct TMTagChunk *chunk; /* the chunk the tag was allocated from or NULL */
 } TMTag;
 
 /* The GType for a TMTag */
@@ -119,13 +121,26 @@ GType tm_tag_get_type(void) G_GNUC_CONST;
 
 #ifdef GEANY_PRIVATE
 
+typedef struct TMTagChunk TMTagChunk;
+
 TMTag *tm_tag_new(void);
 
+TMTag *tm_tag_new_in_chunk(TMTagChunk **chunk);
+
+void tm_tag_chunk_release(TMTagChunk **chunk);
+
+gchar *tm_tag_intern_string(const gchar *str);
+
+void tm_tag_release_string(gchar *str);
+
 void tm_tags_remove_file_tags(TMSourceFile *source_file, GPtrArray *tags_array);
 
 GPtrArray *tm_tags_merge(GPtrArray *big_array, GPtrArray *small_array,
 	TMTagAttrType *sort_attributes, gboolean unref_duplicates);
 
+void tm_tags_merge_in_place(GPtrArray *big_array, GPtrArray *small_array,
+	TMTagAttrType *sort_attributes, gboolean unref_duplicates);
+
 void tm_tags_sort(GPtrArray *tags_array, TMTagAttrType *sort_attributes,
 	gboolean dedup, gboolean unref_duplicates);
 
@@ -140,6 +155,8 @@ TMTag **tm_tags_find(const GPtrArray *tags_array, const char *name,
 
 void tm_tags_array_free(GPtrArray *tags_array, gboolean free_all);
 
+gsize tm_tags_get_memory_size(const GPtrArray *tags_array, gboolean with_tags);
+
 const TMTag *tm_get_current_tag(GPtrArray *file_tags, const gulong line, const TMTagType tag_types);
 
 void tm_tag_unref(TMTag *tag);
@@ -63,6 +63,52 @@ static TMTagType TM_GLOBAL_TYPE_MASK =
 
 static TMWorkspace *theWorkspace = NULL;
 
+/* Name signatures of theWorkspace->tags_array elements at the same index,
+ * see get_name_signature(). Built on first use after tags_array changed. */
+static GArray *name_signatures = NULL;
+
+/* Indexes of the first tags of runs of tags with the same name in
+ * theWorkspace->tags_array and theWorkspace->global_tags, see get_name_runs().
+ * Built on first use after the arrays changed. */
+static GArray *name_runs = NULL;
+static GArray *global_name_runs = NULL;
+
+/* Results of find_scope_members_tags() for recently completed types. Cleared
+ * whenever the workspace or global tags change (which also makes the cached
+ * tag pointers stale). */
+typedef struct
+{
+	const GPtrArray *all;
+	const TMTag *type_tag;
+	gboolean namespace;
+	GPtrArray *members;  /* NULL if the type has no members */
+} ScopeMembersCacheEntry;
+
+#define SCOPE_MEMBERS_CACHE_SIZE 16
+static ScopeMembersCacheEntry scope_members_cache[SCOPE_MEMBERS_CACHE_SIZE];
+static guint scope_members_cache_len = 0;
+static guint scope_members_cache_next = 0;
+
+/* Incremented whenever the names in theWorkspace->typename_array may have
+ * changed, see tm_workspace_get_typename_generation(). */
+static guint typename_generation = 1;
+
+/* Incremented whenever the workspace or global tags may have changed, see
+ * tm_workspace_get_tags_generation(). */
+static guint tags_generation = 1;
+
+/* indexed by TMParserType, allocated on first use */
+static TMParserStats *parser_stats = NULL;
+
+/* parsing in child processes, see tm_workspace_set_parse_isolation() */
+static struct
+{
+	gchar *helper;
+	guint jobs;
+	guint timeout;
+}
+parse_isolation;
+
 
 static void free_ptr_array(gpointer arr)
 {
@@ -70,6 +116,43 @@ static void free_ptr_array(gpointer arr)
 }
 
 
+static void clear_scope_members_cache(void)
+{
+	guint i;
+
+	for (i = 0; i < scope_members_cache_len; i++)
+	{
+		if (scope_members_cache[i].members)
+			g_ptr_array_free(scope_members_cache[i].members, TRUE);
+	}
+	scope_members_cache_len = 0;
+	scope_members_cache_next = 0;
+}
+
+
+static void invalidate_tags_array_indexes(void)
+{
+	tags_generation++;
+	clear_scope_members_cache();
+	if (name_signatures)
+		g_array_free(name_signatures, TRUE);
+	name_signatures = NULL;
+	if (name_runs)
+		g_array_free(name_runs, TRUE);
+	name_runs = NULL;
+}
+
+
+static void invalidate_global_tags_indexes(void)
+{
+	tags_generation++;
+	clear_scope_members_cache();
+	if (global_name_runs)
+		g_array_free(global_name_runs, TRUE);
+	global_name_runs = NULL;
+}
+
+
 static gboolean tm_create_workspace(void)
 {
 	theWorkspace = g_new(TMWorkspace, 1);
@@ -92,6 +175,7 @@ static gboolean tm_create_workspace(void)
 /* Frees the workspace structure and all child source files. Use only when
  exiting from the main program.
 */
+GEANY_EXPORT_SYMBOL
 void tm_workspace_free(void)
 {
 	guint i;
@@ -110,6 +194,12 @@ void tm_workspace_free(void)
 	g_ptr_array_free(theWorkspace->global_typename_array, TRUE);
 	g_free(theWorkspace);
 	theWorkspace = NULL;
+	invalidate_tags_array_indexes();
+	invalidate_global_tags_indexes();
+	g_free(parser_stats);
+	parser_stats = NULL;
+	g_free(parse_isolation.helper);
+	parse_isolation.helper = NULL;
 }
 
 
@@ -119,6 +209,7 @@ void tm_workspace_free(void)
  a workspace is created. Subsequent calls to the function will return the
  created workspace.
 */
+GEANY_EXPORT_SYMBOL
 const TMWorkspace *tm_get_workspace(void)
 {
 	if (NULL == theWorkspace)
@@ -127,49 +218,132 @@ const TMWorkspace *tm_get_workspace(void)
 }
 
 
-static void tm_workspace_merge_tags(GPtrArray **big_array, GPtrArray *small_array)
+/* Merges tags of a single file in place - the workspace arrays are usually
+ * much bigger than the file's tags so no new arrays are created for them. */
+static void merge_file_tags(TMSourceFile *source_file)
+{
+	GPtrArray *arr;
+
+	tm_tags_merge_in_place(theWorkspace->tags_array, source_file->tags_array,
+		workspace_tags_sort_attrs, FALSE);
+
+	arr = tm_tags_extract(source_file->tags_array, TM_GLOBAL_TYPE_MASK);
+	tm_tags_merge_in_place(theWorkspace->typename_array, arr, workspace_tags_sort_attrs, FALSE);
+	g_ptr_array_free(arr, TRUE);
+}
+
+
+/* Returns a hash of the distinct names and languages of type tags in tags sorted
+ * by name; used to detect whether type names of a file changed. */
+static guint get_typenames_hash(GPtrArray *tags)
 {
-	GPtrArray *new_tags = tm_tags_merge(*big_array, small_array, workspace_tags_sort_attrs, FALSE);
-	/* tags owned by TMSourceFile - free just the pointer array */
-	g_ptr_array_free(*big_array, TRUE);
-	*big_array = new_tags;
+	const gchar *last_name = NULL;
+	guint hash = 5381;
+	guint i;
+
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+
+		if (!(tag->type & TM_GLOBAL_TYPE_MASK) ||
+			(last_name && strcmp(last_name, tag->name) == 0))
+			continue;
+
+		hash = (hash << 5) + hash + g_str_hash(tag->name);
+		hash = (hash << 5) + hash + tag->lang;
+		last_name = tag->name;
+	}
+
+	return hash;
 }
 
 
-static void merge_extracted_tags(GPtrArray **dest, GPtrArray *src, TMTagType tag_types)
+/* first_line, last_line and line_delta describe the lines changed since the last
+ * parse (see tm_source_file_parse_lines()), first_line 0 meaning unknown */
+static TMParserStats *get_parser_stats(TMParserType lang)
 {
-	GPtrArray *arr;
+	if (lang < 0 || (guint) lang >= tm_ctags_get_lang_count())
+		return NULL;
+	if (!parser_stats)
+		parser_stats = g_new0(TMParserStats, tm_ctags_get_lang_count());
+	return &parser_stats[lang];
+}
 
-	arr = tm_tags_extract(src, tag_types);
-	tm_workspace_merge_tags(dest, arr);
-	g_ptr_array_free(arr, TRUE);
+
+/* Returns the statistics of the updates done with the parser for lang so far,
+ or NULL for an invalid parser. */
+const TMParserStats *tm_workspace_get_parser_stats(TMParserType lang)
+{
+	return get_parser_stats(lang);
 }
 
 
-static void update_source_file(TMSourceFile *source_file, guchar* text_buf,
-	gsize buf_size, gboolean use_buffer, gboolean update_workspace)
+/* Estimates the memory used by the workspace tag arrays in arrays_size and by the
+ global tags in global_size. The tags of the source files are only referenced by
+ the workspace and are counted by tm_source_file_get_memory_size(). */
+void tm_workspace_get_memory_size(gsize *arrays_size, gsize *global_size)
+{
+	*arrays_size = tm_tags_get_memory_size(theWorkspace->tags_array, FALSE) +
+		tm_tags_get_memory_size(theWorkspace->typename_array, FALSE) +
+		tm_tags_get_memory_size(theWorkspace->source_files, FALSE);
+	*global_size = tm_tags_get_memory_size(theWorkspace->global_tags, TRUE) +
+		tm_tags_get_memory_size(theWorkspace->global_typename_array, FALSE);
+}
+
+
+static void update_source_file_lines(TMSourceFile *source_file, guchar* text_buf,
+	gsize buf_size, gboolean use_buffer, gboolean update_workspace,
+	gulong first_line, gulong last_line, glong line_delta)
 {
+	TMParserStats *stats = get_parser_stats(source_file->lang);
+	gint64 start_time = g_get_monotonic_time();
+	gint64 parse_start_time, parse_end_time;
+	guint typenames_hash = 0;
+
 #ifdef TM_DEBUG
 	g_message("Source file updating based on source file %s", source_file->file_name);
 #endif
 
 	if (update_workspace)
 	{
+		invalidate_tags_array_indexes();
+		typenames_hash = get_typenames_hash(source_file->tags_array);
 		/* tm_source_file_parse() deletes the tag objects - remove the tags from
 		 * workspace while they exist and can be scanned */
 		tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
 		tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
 	}
-	tm_source_file_parse(source_file, text_buf, buf_size, use_buffer);
+	parse_start_time = g_get_monotonic_time();
+	if (first_line == 0 || !use_buffer ||
+		!tm_source_file_parse_lines(source_file, text_buf, buf_size, first_line, last_line, line_delta))
+	{
+		if (parse_isolation.timeout > 0)
+			tm_source_file_parse_isolated(source_file, text_buf, buf_size, use_buffer,
+				parse_isolation.helper, parse_isolation.timeout);
+		else
+			tm_source_file_parse(source_file, text_buf, buf_size, use_buffer);
+	}
 	tm_tags_sort(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+	parse_end_time = g_get_monotonic_time();
 	if (update_workspace)
 	{
 #ifdef TM_DEBUG
 		g_message("Updating workspace from source file");
 #endif
-		tm_workspace_merge_tags(&theWorkspace->tags_array, source_file->tags_array);
-
-		merge_extracted_tags(&(theWorkspace->typename_array), source_file->tags_array, TM_GLOBAL_TYPE_MASK);
+		merge_file_tags(source_file);
+		if (get_typenames_hash(source_file->tags_array) != typenames_hash)
+			typename_generation++;
+	}
+	if (stats)
+	{
+		stats->parses++;
+		if (use_buffer)
+			stats->bytes += buf_size;
+		if (source_file->tags_array)
+			stats->tags += source_file->tags_array->len;
+		stats->parse_time += parse_end_time - parse_start_time;
+		stats->merge_time += (parse_start_time - start_time) +
+			(g_get_monotonic_time() - parse_end_time);
 	}
 #ifdef TM_DEBUG
 	else
@@ -180,20 +354,28 @@ static void update_source_file(TMSourceFile *source_file, guchar* text_buf,
 }
 
 
+static void update_source_file(TMSourceFile *source_file, guchar* text_buf,
+	gsize buf_size, gboolean use_buffer, gboolean update_workspace)
+{
+	update_source_file_lines(source_file, text_buf, buf_size, use_buffer, update_workspace, 0, 0, 0);
+}
+
+
 void tm_workspace_add_source_file_noupdate(TMSourceFile *source_file)
 {
 	GPtrArray *file_arr;
 
 	g_return_if_fail(source_file != NULL);
 
-	g_ptr_array_add(theWorkspace->source_files, source_file);
-
 	file_arr = g_hash_table_lookup(theWorkspace->source_file_map, source_file->short_name);
 	if (!file_arr)
 	{
 		file_arr = g_ptr_array_new();
 		g_hash_table_insert(theWorkspace->source_file_map, g_strdup(source_file->short_name), file_arr);
 	}
+
+	tm_source_file_set_workspace_index(source_file, theWorkspace->source_files->len, file_arr->len);
+	g_ptr_array_add(theWorkspace->source_files, source_file);
 	g_ptr_array_add(file_arr, source_file);
 }
 
@@ -230,12 +412,61 @@ void tm_workspace_update_source_file_buffer(TMSourceFile *source_file, guchar* t
 }
 
 
-static void remove_source_file_map(TMSourceFile *source_file)
+/* Same as tm_workspace_update_source_file_buffer() but only the lines from first_line
+ to last_line (1-based, in the previously parsed buffer) were changed and line_delta
+ lines were added (or removed when negative), which allows reparsing only the part
+ of the buffer containing them when the parser of the file supports it. */
+void tm_workspace_update_source_file_buffer_lines(TMSourceFile *source_file, guchar *text_buf,
+	gsize buf_size, gulong first_line, gulong last_line, glong line_delta)
+{
+	update_source_file_lines(source_file, text_buf, buf_size, TRUE, TRUE,
+		first_line, last_line, line_delta);
+}
+
+
+/* Removes the element at index like g_ptr_array_remove_index_fast(), which moves the
+ last source file to index, and returns the moved one or NULL. */
+static TMSourceFile *remove_source_file_index(GPtrArray *arr, guint index)
+{
+	g_ptr_array_remove_index_fast(arr, index);
+	return index < arr->len ? arr->pdata[index] : NULL;
+}
+
+
+/* Removes source_file from theWorkspace->source_files and theWorkspace->source_file_map
+ using the indexes stored in it. Returns FALSE if it isn't in the workspace. */
+static gboolean remove_source_file_from_arrays(TMSourceFile *source_file)
 {
-	GPtrArray *file_arr = g_hash_table_lookup(theWorkspace->source_file_map, source_file->short_name);
+	GPtrArray *file_arr;
+	TMSourceFile *moved;
+	gint index, name_index;
+
+	index = tm_source_file_get_workspace_index(source_file, &name_index);
+	if (index < 0 || (guint) index >= theWorkspace->source_files->len ||
+		theWorkspace->source_files->pdata[index] != source_file)
+		return FALSE;
 
-	if (file_arr)
-		g_ptr_array_remove_fast(file_arr, source_file);
+	moved = remove_source_file_index(theWorkspace->source_files, index);
+	if (moved)
+	{
+		gint moved_name_index;
+
+		tm_source_file_get_workspace_index(moved, &moved_name_index);
+		tm_source_file_set_workspace_index(moved, index, moved_name_index);
+	}
+
+	file_arr = g_hash_table_lookup(theWorkspace->source_file_map, source_file->short_name);
+	if (file_arr && name_index >= 0 && (guint) name_index < file_arr->len &&
+		file_arr->pdata[name_index] == source_file)
+	{
+		moved = remove_source_file_index(file_arr, name_index);
+		if (moved)
+			tm_source_file_set_workspace_index(moved,
+				tm_source_file_get_workspace_index(moved, NULL), name_index);
+	}
+
+	tm_source_file_set_workspace_index(source_file, -1, -1);
+	return TRUE;
 }
 
 
@@ -247,20 +478,14 @@ static void remove_source_file_map(TMSourceFile *source_file)
 GEANY_API_SYMBOL
 void tm_workspace_remove_source_file(TMSourceFile *source_file)
 {
-	guint i;
-
 	g_return_if_fail(source_file != NULL);
 
-	for (i=0; i < theWorkspace->source_files->len; ++i)
+	if (remove_source_file_from_arrays(source_file))
 	{
-		if (theWorkspace->source_files->pdata[i] == source_file)
-		{
-			tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
-			tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
-			remove_source_file_map(source_file);
-			g_ptr_array_remove_index_fast(theWorkspace->source_files, i);
-			return;
-		}
+		invalidate_tags_array_indexes();
+		typename_generation++;
+		tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
+		tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
 	}
 }
 
@@ -279,6 +504,8 @@ static void tm_workspace_update(void)
 	g_message("Recreating workspace tags array");
 #endif
 
+	invalidate_tags_array_indexes();
+	typename_generation++;
 	g_ptr_array_set_size(theWorkspace->tags_array, 0);
 
 #ifdef TM_DEBUG
@@ -333,6 +560,125 @@ void tm_workspace_add_source_files(GPtrArray *source_files)
 }
 
 
+/* Replaces the tags of a workspace source file with tags obtained without parsing
+ * (e.g. from a cache). The tags have to belong to the source file and are owned
+ * by it afterwards. */
+void tm_workspace_set_source_file_tags(TMSourceFile *source_file, GPtrArray *tags)
+{
+	guint i;
+
+	g_return_if_fail(source_file != NULL && tags != NULL);
+
+	invalidate_tags_array_indexes();
+	typename_generation++;
+	tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
+	tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
+
+	tm_source_file_invalidate_indexes(source_file);
+	tm_tags_array_free(source_file->tags_array, FALSE);
+	for (i = 0; i < tags->len; i++)
+		g_ptr_array_add(source_file->tags_array, tags->pdata[i]);
+	tm_tags_sort(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+
+	merge_file_tags(source_file);
+}
+
+
+/* Returns a number which changes whenever the type names in the workspace
+ * typename_array could have changed so users of the names (e.g. for
+ * highlighting) don't have to rebuild anything when it stays the same. */
+guint tm_workspace_get_typename_generation(void)
+{
+	return typename_generation;
+}
+
+
+/* Returns a number which changes whenever any workspace or global tags could have
+ * changed (which also makes pointers to them stale), so users can cache results
+ * derived from the tags until it changes. */
+guint tm_workspace_get_tags_generation(void)
+{
+	return tags_generation;
+}
+
+
+/* Parses the source file from disk without adding it to the workspace. */
+void tm_workspace_parse_source_file_noupdate(TMSourceFile *source_file)
+{
+	g_return_if_fail(source_file != NULL);
+
+	update_source_file(source_file, NULL, 0, FALSE, FALSE);
+}
+
+
+/* Like tm_workspace_parse_source_file_noupdate() for several files, which are
+ * parsed at the same time when parsing in child processes. */
+void tm_workspace_parse_source_files_noupdate(GPtrArray *source_files)
+{
+	guint i;
+
+	g_return_if_fail(source_files != NULL);
+
+	if (parse_isolation.timeout == 0)
+	{
+		for (i = 0; i < source_files->len; i++)
+			update_source_file(source_files->pdata[i], NULL, 0, FALSE, FALSE);
+		return;
+	}
+
+	tm_source_files_parse_isolated(source_files, parse_isolation.jobs, parse_isolation.helper,
+		parse_isolation.timeout);
+	for (i = 0; i < source_files->len; i++)
+	{
+		TMSourceFile *source_file = source_files->pdata[i];
+		TMParserStats *stats = get_parser_stats(source_file->lang);
+
+		tm_tags_sort(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+		if (stats)
+		{
+			stats->parses++;
+			stats->tags += source_file->tags_array->len;
+		}
+	}
+}
+
+
+/* Makes full parses run in child processes of the parse helper program, killed
+ * after timeout milliseconds so a parser stuck on some input can't freeze the
+ * program, and lets tm_workspace_parse_source_files_noupdate() run up to jobs of
+ * them at the same time. A timeout of 0 parses in this process. */
+void tm_workspace_set_parse_isolation(const gchar *helper, guint jobs, guint timeout)
+{
+	g_free(parse_isolation.helper);
+	parse_isolation.helper = g_strdup(helper);
+	parse_isolation.jobs = MAX(jobs, 1);
+	parse_isolation.timeout = timeout;
+}
+
+
+/* Returns the number of files tm_workspace_parse_source_files_noupdate() parses at
+ * the same time. */
+guint tm_workspace_get_parse_jobs(void)
+{
+	return parse_isolation.timeout > 0 && parse_isolation.helper ? parse_isolation.jobs : 1;
+}
+
+
+/* Adds source files parsed with tm_workspace_parse_source_file_noupdate() to the
+ * workspace and rebuilds the workspace tag arrays just once for all of them. */
+void tm_workspace_add_parsed_source_files(GPtrArray *source_files)
+{
+	guint i;
+
+	g_return_if_fail(source_files != NULL);
+
+	for (i = 0; i < source_files->len; i++)
+		tm_workspace_add_source_file_noupdate(source_files->pdata[i]);
+
+	tm_workspace_update();
+}
+
+
 /** Removes multiple source files from the workspace and updates the workspace tag
  arrays. This is more efficient than calling tm_workspace_remove_source_file()
  separately for each of the files. To completely free the TMSourceFile pointers
@@ -342,25 +688,12 @@ void tm_workspace_add_source_files(GPtrArray *source_files)
 GEANY_API_SYMBOL
 void tm_workspace_remove_source_files(GPtrArray *source_files)
 {
-	guint i, j;
+	guint i;
 
 	g_return_if_fail(source_files != NULL);
 
-	//TODO: sort both arrays by pointer value and remove in single pass
 	for (i = 0; i < source_files->len; i++)
-	{
-		TMSourceFile *source_file = source_files->pdata[i];
-
-		for (j = 0; j < theWorkspace->source_files->len; j++)
-		{
-			if (theWorkspace->source_files->pdata[j] == source_file)
-			{
-				remove_source_file_map(source_file);
-				g_ptr_array_remove_index_fast(theWorkspace->source_files, j);
-				break;
-			}
-		}
-	}
+		remove_source_file_from_arrays(source_files->pdata[i]);
 
 	tm_workspace_update();
 }
@@ -374,13 +707,46 @@ void tm_workspace_remove_source_files(GPtrArray *source_files)
 */
 gboolean tm_workspace_load_global_tags(const char *tags_file, TMParserType mode)
 {
-	GPtrArray *file_tags, *new_tags;
+	GPtrArray *file_tags = tm_workspace_read_global_tags(tags_file, mode);
 
-	file_tags = tm_source_file_read_tags_file(tags_file, mode);
 	if (!file_tags)
 		return FALSE;
 
-	tm_tags_sort(file_tags, global_tags_sort_attrs, TRUE, TRUE);
+	tm_workspace_add_global_tags(file_tags);
+	return TRUE;
+}
+
+
+/* Reads the tags of a global tags file sorted like the global tag list, to be
+ added with tm_workspace_add_global_tags(). Doesn't access the workspace, so it
+ can be called from other threads.
+ @param tags_file The file containing global tags.
+ @return The tags, or NULL on failure.
+*/
+GPtrArray *tm_workspace_read_global_tags(const char *tags_file, TMParserType mode)
+{
+	GPtrArray *file_tags;
+	gboolean binary = tm_source_file_is_binary_tags_file(tags_file);
+
+	if (binary)
+		file_tags = tm_source_file_read_binary_tags_file(tags_file, mode);
+	else
+		file_tags = tm_source_file_read_tags_file(tags_file, mode);
+
+	/* binary tags files are already sorted and deduplicated */
+	if (file_tags && !binary)
+		tm_tags_sort(file_tags, global_tags_sort_attrs, TRUE, TRUE);
+
+	return file_tags;
+}
+
+
+/* Adds tags read by tm_workspace_read_global_tags() to the global tag list.
+ @param file_tags The tags, the array is freed.
+*/
+void tm_workspace_add_global_tags(GPtrArray *file_tags)
+{
+	GPtrArray *new_tags;
 
 	/* reorder the whole array, because tm_tags_find expects a sorted array */
 	new_tags = tm_tags_merge(theWorkspace->global_tags,
@@ -388,11 +754,10 @@ gboolean tm_workspace_load_global_tags(const char *tags_file, TMParserType mode)
 	g_ptr_array_free(theWorkspace->global_tags, TRUE);
 	g_ptr_array_free(file_tags, TRUE);
 	theWorkspace->global_tags = new_tags;
+	invalidate_global_tags_indexes();
 
 	g_ptr_array_free(theWorkspace->global_typename_array, TRUE);
 	theWorkspace->global_typename_array = tm_tags_extract(new_tags, TM_GLOBAL_TYPE_MASK);
-
-	return TRUE;
 }
 
 
@@ -499,8 +864,15 @@ static gchar *pre_process_file(const gchar *cmd, const gchar *inf)
 	return outf;
 }
 
+static gboolean write_global_tags_file(const char *tags_file, GPtrArray *tags, gboolean binary)
+{
+	if (binary)
+		return tm_source_file_write_binary_tags_file(tags_file, tags);
+	return tm_source_file_write_tags_file(tags_file, tags);
+}
+
 static gboolean create_global_tags_preprocessed(const char *pre_process_cmd,
-	GList *source_files, const char *tags_file, TMParserType lang)
+	GList *source_files, const char *tags_file, TMParserType lang, gboolean binary)
 {
 	TMSourceFile *source_file;
 	gboolean ret = FALSE;
@@ -541,7 +913,7 @@ static gboolean create_global_tags_preprocessed(const char *pre_process_cmd,
 
 	tm_tags_sort(source_file->tags_array, global_tags_sort_attrs, TRUE, FALSE);
 	filtered_tags = tm_tags_extract(source_file->tags_array, ~(tm_tag_local_var_t | tm_tag_include_t));
-	ret = tm_source_file_write_tags_file(tags_file, filtered_tags);
+	ret = write_global_tags_file(tags_file, filtered_tags, binary);
 	g_ptr_array_free(filtered_tags, TRUE);
 	tm_source_file_free(source_file);
 
@@ -551,8 +923,132 @@ cleanup:
 	return ret;
 }
 
+typedef struct
+{
+	const gchar *pre_process_cmd;
+	GList *source_files;
+	TMParserType lang;
+	TMSourceFile *source_file;
+	gboolean failed;
+} GlobalTagsShard;
+
+/* Preprocesses and parses a part of the sources, run from a thread pool.
+ * Parsing itself is serialized by tm_ctags_parse() but the external
+ * preprocessor runs of the shards overlap. */
+static void create_global_tags_shard(gpointer data, gpointer user_data)
+{
+	GlobalTagsShard *shard = data;
+	gchar *temp_file2 = NULL;
+	gchar *temp_file = create_temp_file("tmp_XXXXXX.cpp");
+
+	if (!temp_file)
+	{
+		shard->failed = TRUE;
+		return;
+	}
+
+	if (write_includes_file(temp_file, shard->source_files))
+		temp_file2 = pre_process_file(shard->pre_process_cmd, temp_file);
+
+	if (temp_file2)
+	{
+		shard->source_file = tm_source_file_new(temp_file2, tm_source_file_get_lang_name(shard->lang));
+		if (shard->source_file)
+			tm_source_file_parse(shard->source_file, NULL, 0, FALSE);
+		else
+			shard->failed = TRUE;
+		g_unlink(temp_file2);
+		g_free(temp_file2);
+	}
+	else
+		shard->failed = TRUE;
+
+	g_unlink(temp_file);
+	g_free(temp_file);
+}
+
+/* Like create_global_tags_preprocessed() but splits the sources into jobs
+ * shards preprocessed in parallel. The preprocessed shards are still parsed one
+ * at a time, see the lock in tm_ctags.c, so this only helps when preprocessing
+ * takes most of the time. Headers included from several shards are parsed more
+ * than once, so the merged tags are deduplicated. */
+static gboolean create_global_tags_preprocessed_parallel(const char *pre_process_cmd,
+	GList *source_files, const char *tags_file, TMParserType lang, gboolean binary, guint jobs)
+{
+	guint n_files = g_list_length(source_files);
+	GlobalTagsShard *shards;
+	GThreadPool *pool;
+	GPtrArray *tags;
+	GPtrArray *filtered_tags;
+	GList *node;
+	gboolean ret = FALSE;
+	guint i;
+
+	jobs = MIN(jobs, n_files);
+	shards = g_new0(GlobalTagsShard, jobs);
+
+	/* keep neighbouring sources together, they are likely to share headers */
+	for (node = g_list_last(source_files), i = n_files - 1; node; node = node->prev, i--)
+	{
+		GlobalTagsShard *shard = &shards[(guint64) i * jobs / n_files];
+
+		shard->source_files = g_list_prepend(shard->source_files, node->data);
+	}
+
+	pool = g_thread_pool_new(create_global_tags_shard, NULL, jobs, TRUE, NULL);
+	for (i = 0; i < jobs; i++)
+	{
+		shards[i].pre_process_cmd = pre_process_cmd;
+		shards[i].lang = lang;
+		g_thread_pool_push(pool, &shards[i], NULL);
+	}
+	/* waits for all the shards to finish */
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	/* a tags file missing the tags of a failed shard would look complete */
+	for (i = 0; i < jobs; i++)
+	{
+		if (shards[i].failed)
+			goto cleanup;
+	}
+
+	tags = g_ptr_array_new();
+	for (i = 0; i < jobs; i++)
+	{
+		TMSourceFile *source_file = shards[i].source_file;
+
+		if (source_file && source_file->tags_array)
+		{
+			guint j;
+
+			for (j = 0; j < source_file->tags_array->len; j++)
+				g_ptr_array_add(tags, source_file->tags_array->pdata[j]);
+		}
+	}
+
+	filtered_tags = tm_tags_extract(tags, ~(tm_tag_local_var_t | tm_tag_include_t));
+	tm_tags_sort(filtered_tags, global_tags_sort_attrs, TRUE, FALSE);
+
+	if (filtered_tags->len > 0)
+		ret = write_global_tags_file(tags_file, filtered_tags, binary);
+
+	g_ptr_array_free(tags, TRUE);
+	g_ptr_array_free(filtered_tags, TRUE);
+
+cleanup:
+	for (i = 0; i < jobs; i++)
+	{
+		if (shards[i].source_file)
+			tm_source_file_free(shards[i].source_file);
+		g_list_free(shards[i].source_files);
+	}
+	g_free(shards);
+
+	return ret;
+}
+
 static gboolean create_global_tags_direct(GList *source_files, const char *tags_file,
-	TMParserType lang)
+	TMParserType lang, gboolean binary)
 {
 	GList *node;
 	GPtrArray *filtered_tags;
@@ -577,7 +1073,7 @@ static gboolean create_global_tags_direct(GList *source_files, const char *tags_
 	tm_tags_sort(filtered_tags, global_tags_sort_attrs, TRUE, FALSE);
 
 	if (filtered_tags->len > 0)
-		ret = tm_source_file_write_tags_file(tags_file, filtered_tags);
+		ret = write_global_tags_file(tags_file, filtered_tags, binary);
 
 	g_ptr_array_free(tags, TRUE);
 	g_ptr_array_free(filtered_tags, TRUE);
@@ -595,18 +1091,26 @@ static gboolean create_global_tags_direct(GList *source_files, const char *tags_
  are allowed.
  @param tags_file The file where the tags will be stored.
  @param lang The language to use for the tags file.
+ @param binary Whether to write the tags file in the binary format which is
+ faster to load.
+ @param jobs The number of preprocessor commands to run in parallel, each on
+ a part of the sources. Their output is parsed one part at a time. Only used
+ together with pre_process_cmd.
  @return TRUE on success, FALSE on failure.
 */
 gboolean tm_workspace_create_global_tags(const char *pre_process_cmd, const char **sources,
-	int sources_count, const char *tags_file, TMParserType lang)
+	int sources_count, const char *tags_file, TMParserType lang, gboolean binary, guint jobs)
 {
 	gboolean ret = FALSE;
 	GList *source_files = lookup_sources(sources, sources_count);
 
-	if (pre_process_cmd)
-		ret = create_global_tags_preprocessed(pre_process_cmd, source_files, tags_file, lang);
+	if (pre_process_cmd && jobs > 1 && source_files && source_files->next)
+		ret = create_global_tags_preprocessed_parallel(pre_process_cmd, source_files, tags_file,
+			lang, binary, jobs);
+	else if (pre_process_cmd)
+		ret = create_global_tags_preprocessed(pre_process_cmd, source_files, tags_file, lang, binary);
 	else
-		ret = create_global_tags_direct(source_files, tags_file, lang);
+		ret = create_global_tags_direct(source_files, tags_file, lang, binary);
 
 	g_list_free_full(source_files, g_free);
 	return ret;
@@ -757,12 +1261,96 @@ static void copy_tags(GPtrArray *dst, TMTag **src, guint src_len, GHashTable *na
 			g_ptr_array_add(dst, tag);
 			g_hash_table_add(name_table, tag->name);
 			num--;
+			/* the remaining tags with the same name would be skipped anyway */
+			while (i + 1 < src_len &&
+				(src[1]->name == tag->name || strcmp(src[1]->name, tag->name) == 0))
+			{
+				i++;
+				src++;
+			}
 		}
 		src++;
 	}
 }
 
 
+/* Returns the indexes of the first tags of all runs of tags with the same name
+ * in tags which have to be sorted by name. */
+static GArray *get_name_runs(GPtrArray *tags, GArray **runs)
+{
+	guint i;
+
+	if (*runs)
+		return *runs;
+
+	*runs = g_array_new(FALSE, FALSE, sizeof(guint));
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+
+		const gchar *prev_name = i > 0 ? TM_TAG(tags->pdata[i - 1])->name : NULL;
+
+		/* names are mostly interned, compare pointers first */
+		if (!prev_name || (prev_name != tag->name && strcmp(prev_name, tag->name) != 0))
+			g_array_append_val(*runs, i);
+	}
+
+	return *runs;
+}
+
+
+/* Like tm_tags_find() followed by copy_tags() but iterates over the distinct
+ * names starting with prefix using the name runs of tags so tags with the same
+ * name are skipped at once, which makes a difference for short prefixes in big
+ * arrays with many tags of the same name (e.g. local variables). */
+static void copy_prefix_tags(GPtrArray *dst, GPtrArray *tags, GArray *runs, const char *prefix,
+	GHashTable *name_table, gint num, gboolean (*predicate) (TMTag *, CopyInfo *), CopyInfo *info)
+{
+	gsize prefix_len = strlen(prefix);
+	guint l = 0, u = runs->len;
+	guint r;
+
+	/* the first run with name not smaller than prefix */
+	while (l < u)
+	{
+		guint mid = (l + u) / 2;
+		TMTag *tag = tags->pdata[g_array_index(runs, guint, mid)];
+
+		if (strcmp(tag->name, prefix) < 0)
+			l = mid + 1;
+		else
+			u = mid;
+	}
+
+	for (r = l; r < runs->len && num > 0; r++)
+	{
+		guint start = g_array_index(runs, guint, r);
+		guint end = r + 1 < runs->len ? g_array_index(runs, guint, r + 1) : tags->len;
+		TMTag *first = tags->pdata[start];
+		guint i;
+
+		if (strncmp(first->name, prefix, prefix_len) != 0)
+			break;
+		if (g_hash_table_contains(name_table, first->name))
+			continue;
+
+		for (i = start; i < end; i++)
+		{
+			TMTag *tag = tags->pdata[i];
+
+			if (predicate(tag, info) &&
+				tm_workspace_is_autocomplete_tag(tag, info->file, info->line, info->scope))
+			{
+				g_ptr_array_add(dst, tag);
+				g_hash_table_add(name_table, tag->name);
+				num--;
+				break;
+			}
+		}
+	}
+}
+
+
 static void fill_find_tags_array_prefix(GPtrArray *dst, const char *name,
 	CopyInfo *info, guint max_num)
 {
@@ -813,15 +1401,15 @@ static void fill_find_tags_array_prefix(GPtrArray *dst, const char *name,
 	}
 	if (dst->len < max_num)
 	{
-		found = tm_tags_find(theWorkspace->tags_array, name, TRUE, &count);
-		if (found)
-			copy_tags(dst, found, count, name_table, max_num - dst->len, is_workspace_tag, info);
+		copy_prefix_tags(dst, theWorkspace->tags_array,
+			get_name_runs(theWorkspace->tags_array, &name_runs),
+			name, name_table, max_num - dst->len, is_workspace_tag, info);
 	}
 	if (dst->len < max_num)
 	{
-		found = tm_tags_find(theWorkspace->global_tags, name, TRUE, &count);
-		if (found)
-			copy_tags(dst, found, count, name_table, max_num - dst->len, is_any_tag, info);
+		copy_prefix_tags(dst, theWorkspace->global_tags,
+			get_name_runs(theWorkspace->global_tags, &global_name_runs),
+			name, name_table, max_num - dst->len, is_any_tag, info);
 	}
 
 	g_hash_table_unref(name_table);
@@ -977,6 +1565,118 @@ GPtrArray *tm_workspace_find_prefix(const char *prefix,
 }
 
 
+/* Bits 0-31 are set for the (case-insensitive) characters of str, bits 32-63
+ * for its character pairs. A string can only contain another string as a
+ * substring if its signature contains all the bits of the other one. */
+static guint64 get_name_signature(const gchar *str, gsize len)
+{
+	guint64 signature = 0;
+	guchar prev = 0;
+	gsize i;
+
+	for (i = 0; i < len; i++)
+	{
+		guchar c = g_ascii_tolower(str[i]);
+
+		signature |= G_GUINT64_CONSTANT(1) << (c & 31);
+		if (i > 0)
+			signature |= G_GUINT64_CONSTANT(1) << (32 + ((prev * 31 + c) & 31));
+		prev = c;
+	}
+
+	return signature;
+}
+
+
+static void update_name_signatures(void)
+{
+	GPtrArray *tags = theWorkspace->tags_array;
+	guint i;
+
+	if (name_signatures)
+		return;
+
+	name_signatures = g_array_sized_new(FALSE, FALSE, sizeof(guint64), tags->len);
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+		guint64 signature = get_name_signature(tag->name, strlen(tag->name));
+
+		g_array_append_val(name_signatures, signature);
+	}
+}
+
+
+static const gchar *ascii_strcasestr(const gchar *haystack, const gchar *needle, gsize needle_len)
+{
+	for (; *haystack; haystack++)
+	{
+		if (g_ascii_strncasecmp(haystack, needle, needle_len) == 0)
+			return haystack;
+	}
+	return NULL;
+}
+
+
+/** Returns workspace tags whose names contain all space-separated words of the
+ query, ignoring ASCII case.
+ @param query The words to search for.
+ @param type Tag types to include, e.g. @c tm_tag_max_t for all.
+ @param lang Specifies the language of the tags to be found, -1 for all.
+ @param max_num The maximum number of tags to return.
+ @return @transfer{container} @elementtype{TMTag} Array of matching tags sorted by name.
+ @since 2.1 (GEANY_API_VERSION 249)
+*/
+GEANY_API_SYMBOL
+GPtrArray *tm_workspace_find_matching(const char *query, TMTagType type, TMParserType lang,
+	guint max_num)
+{
+	GPtrArray *tags = g_ptr_array_new();
+	GPtrArray *ws_tags;
+	gchar **words;
+	guint64 signature = 0;
+	guint i, j;
+
+	g_return_val_if_fail(query != NULL, tags);
+
+	ws_tags = tm_get_workspace()->tags_array;
+	update_name_signatures();
+
+	words = g_strsplit_set(query, " ", -1);
+	for (j = 0; words[j]; j++)
+		signature |= get_name_signature(words[j], strlen(words[j]));
+
+	for (i = 0; i < ws_tags->len && tags->len < max_num; i++)
+	{
+		TMTag *tag = ws_tags->pdata[i];
+		gboolean matches = TRUE;
+
+		/* cheap check first, typically rejects almost all tags */
+		if ((g_array_index(name_signatures, guint64, i) & signature) != signature)
+			continue;
+
+		if (!(tag->type & type) || (lang != -1 && tag->lang != lang))
+			continue;
+
+		for (j = 0; words[j]; j++)
+		{
+			if (words[j][0] && !ascii_strcasestr(tag->name, words[j], strlen(words[j])))
+			{
+				matches = FALSE;
+				break;
+			}
+		}
+
+		if (matches)
+			g_ptr_array_add(tags, tag);
+	}
+
+	g_strfreev(words);
+
+	return tags;
+}
+
+
 static gboolean replace_with_char(gchar *haystack, const gchar *needle, char replacement)
 {
 	gchar *pos = strstr(haystack, needle);
@@ -1151,6 +1851,58 @@ find_scope_members_tags (const GPtrArray *all, TMTag *type_tag, gboolean namespa
 }
 
 
+static GPtrArray *copy_tags_array(const GPtrArray *src)
+{
+	GPtrArray *dst;
+	guint i;
+
+	if (!src)
+		return NULL;
+
+	dst = g_ptr_array_sized_new(src->len);
+	for (i = 0; i < src->len; i++)
+		g_ptr_array_add(dst, src->pdata[i]);
+	return dst;
+}
+
+
+/* Like find_scope_members_tags() but remembers the results so repeated scope
+ * completion of the same type doesn't rescan the tag arrays and inheritance. */
+static GPtrArray *
+find_scope_members_tags_cached (const GPtrArray *all, TMTag *type_tag, gboolean namespace)
+{
+	ScopeMembersCacheEntry *entry;
+	GPtrArray *members;
+	guint i;
+
+	for (i = 0; i < scope_members_cache_len; i++)
+	{
+		entry = &scope_members_cache[i];
+		if (entry->all == all && entry->type_tag == type_tag && entry->namespace == namespace)
+			return copy_tags_array(entry->members);
+	}
+
+	members = find_scope_members_tags(all, type_tag, namespace, 0);
+
+	if (scope_members_cache_len < SCOPE_MEMBERS_CACHE_SIZE)
+		entry = &scope_members_cache[scope_members_cache_len++];
+	else
+	{
+		/* replace the oldest entry */
+		entry = &scope_members_cache[scope_members_cache_next];
+		scope_members_cache_next = (scope_members_cache_next + 1) % SCOPE_MEMBERS_CACHE_SIZE;
+		if (entry->members)
+			g_ptr_array_free(entry->members, TRUE);
+	}
+	entry->all = all;
+	entry->type_tag = type_tag;
+	entry->namespace = namespace;
+	entry->members = copy_tags_array(members);
+
+	return members;
+}
+
+
 /* Gets all members of the type with the given name; search them inside tags_array */
 static GPtrArray *
 find_scope_members (const GPtrArray *tags_array, const gchar *name, TMSourceFile *file,
@@ -1218,7 +1970,7 @@ find_scope_members (const GPtrArray *tags_array, const gchar *name, TMSourceFile
 		else /* real type with members */
 		{
 			/* use the same file as the composite type if file information available */
-			res = find_scope_members_tags(tag->file ? tag->file->tags_array : tags_array, tag, namespace, 0);
+			res = find_scope_members_tags_cached(tag->file ? tag->file->tags_array : tags_array, tag, namespace);
 			break;
 		}
 	}
@@ -1296,8 +2048,8 @@ find_scope_members_all(const GPtrArray *tags, const GPtrArray *searched_array, T
 			if (tag->type & tm_tag_typedef_t)
 				member_tags = find_scope_members(searched_array, tag->name, tag->file, lang, TRUE);
 			else
-				member_tags = find_scope_members_tags(tag->file ? tag->file->tags_array : searched_array,
-					tag, TRUE, 0);
+				member_tags = find_scope_members_tags_cached(tag->file ? tag->file->tags_array : searched_array,
+					tag, TRUE);
 		}
 		else if (tag->var_type)  /* variable: scope search */
 		{
@@ -1330,7 +2082,7 @@ static GPtrArray *find_namespace_members_all(const GPtrArray *tags, const GPtrAr
 	{
 		TMTag *tag = TM_TAG(tags->pdata[i]);
 
-		member_tags = find_scope_members_tags(searched_array, tag, TRUE, 0);
+		member_tags = find_scope_members_tags_cached(searched_array, tag, TRUE);
 	}
 
 	return member_tags;
@@ -44,15 +44,32 @@ void tm_workspace_add_source_files(GPtrArray *source_files);
 
 void tm_workspace_remove_source_files(GPtrArray *source_files);
 
+GPtrArray *tm_workspace_find_matching(const char *query, TMTagType type, TMParserType lang,
+	guint max_num);
+
 
 #ifdef GEANY_PRIVATE
 
+/* Cumulative costs of the source file updates done with one parser */
+typedef struct TMParserStats
+{
+	guint parses;
+	guint64 bytes; /* parsed buffer bytes, files parsed from disk are not counted */
+	guint64 tags;
+	gint64 parse_time; /* microseconds spent parsing and sorting */
+	gint64 merge_time; /* microseconds spent updating the workspace tag arrays */
+} TMParserStats;
+
 const TMWorkspace *tm_get_workspace(void);
 
 gboolean tm_workspace_load_global_tags(const char *tags_file, TMParserType mode);
 
+GPtrArray *tm_workspace_read_global_tags(const char *tags_file, TMParserType mode);
+
+void tm_workspace_add_global_tags(GPtrArray *file_tags);
+
 gboolean tm_workspace_create_global_tags(const char *pre_process, const char **includes,
-	int includes_count, const char *tags_file, TMParserType lang);
+	int includes_count, const char *tags_file, TMParserType lang, gboolean binary, guint jobs);
 
 GPtrArray *tm_workspace_find(const char *name, const char *scope, TMTagType type,
 	TMTagAttrType *attrs, TMParserType lang);
@@ -67,9 +84,32 @@ GPtrArray *tm_workspace_find_scope_members (TMSourceFile *source_file, const cha
 
 void tm_workspace_add_source_file_noupdate(TMSourceFile *source_file);
 
+void tm_workspace_parse_source_file_noupdate(TMSourceFile *source_file);
+
+void tm_workspace_add_parsed_source_files(GPtrArray *source_files);
+
+void tm_workspace_parse_source_files_noupdate(GPtrArray *source_files);
+
+void tm_workspace_set_parse_isolation(const gchar *helper, guint jobs, guint timeout);
+
+guint tm_workspace_get_parse_jobs(void);
+
 void tm_workspace_update_source_file_buffer(TMSourceFile *source_file, guchar* text_buf,
 	gsize buf_size);
 
+void tm_workspace_update_source_file_buffer_lines(TMSourceFile *source_file, guchar *text_buf,
+	gsize buf_size, gulong first_line, gulong last_line, glong line_delta);
+
+void tm_workspace_set_source_file_tags(TMSourceFile *source_file, GPtrArray *tags);
+
+guint tm_workspace_get_typename_generation(void);
+
+guint tm_workspace_get_tags_generation(void);
+
+const TMParserStats *tm_workspace_get_parser_stats(TMParserType lang);
+
+void tm_workspace_get_memory_size(gsize *arrays_size, gsize *global_size);
+
 void tm_workspace_free(void);
 
 gboolean tm_workspace_is_autocomplete_tag(TMTag *tag, TMSourceFile *current_file,
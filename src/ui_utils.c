@@ -81,6 +81,28 @@ static GtkWidget* edit_menu1 = NULL;
 static GtkWidget* prefs_dialog = NULL;
 static GtkWidget* project_dialog = NULL;
 
+/* the status bar update waiting for the next main loop iteration */
+static struct
+{
+	guint source_id;
+	guint doc_id;	/* 0 for the current document */
+	gint pos;
+}
+statusbar_update;
+
+/* the selection length of the last status bar update, as getting it for
+ * rectangular and multiple selections copies the selected text */
+static struct
+{
+	guint doc_id;
+	gint mode;
+	gint count;
+	gint start;
+	gint end;
+	gint len;
+}
+selection_stats;
+
 static struct
 {
 	/* pointers to widgets only sensitive when there is at least one document, the pointers can
@@ -183,6 +205,29 @@ void ui_set_statusbar(gboolean log, const gchar *format, ...)
 }
 
 
+static gint get_selected_text_length(GeanyDocument *doc)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint mode = sci_get_selection_mode(sci);
+	gint count = SSM(sci, SCI_GETSELECTIONS, 0, 0);
+	gint start = sci_get_selection_start(sci);
+	gint end = sci_get_selection_end(sci);
+
+	if (selection_stats.doc_id != doc->id || selection_stats.mode != mode ||
+		selection_stats.count != count || selection_stats.start != start ||
+		selection_stats.end != end)
+	{
+		selection_stats.doc_id = doc->id;
+		selection_stats.mode = mode;
+		selection_stats.count = count;
+		selection_stats.start = start;
+		selection_stats.end = end;
+		selection_stats.len = sci_get_selected_text_length2(sci);
+	}
+	return selection_stats.len;
+}
+
+
 /* note: some comments below are for translators */
 static gchar *create_statusbar_statistics(GeanyDocument *doc,
 	guint line, guint vcol, guint pos)
@@ -226,7 +271,7 @@ static gchar *create_statusbar_statistics(GeanyDocument *doc,
 				break;
 			case 's':
 			{
-				gint len = sci_get_selected_text_length2(sci);
+				gint len = get_selected_text_length(doc);
 				/* check if whole lines are selected */
 				if (!len || sci_get_col_from_position(sci,
 						sci_get_selection_start(sci)) != 0 ||
@@ -239,8 +284,7 @@ static gchar *create_statusbar_statistics(GeanyDocument *doc,
 				break;
 			}
 			case 'n' :
-				g_string_append_printf(stats_str, "%d",
-					sci_get_selected_text_length2(doc->editor->sci));
+				g_string_append_printf(stats_str, "%d", get_selected_text_length(doc));
 				break;
 			case 'w':
 				/* RO = read-only */
@@ -319,14 +363,8 @@ static gchar *create_statusbar_statistics(GeanyDocument *doc,
 }
 
 
-/* updates the status bar document statistics */
-void ui_update_statusbar(GeanyDocument *doc, gint pos)
+static void update_statusbar(GeanyDocument *doc, gint pos)
 {
-	g_return_if_fail(doc == NULL || doc->is_valid);
-
-	if (! interface_prefs.statusbar_visible)
-		return; /* just do nothing if statusbar is not visible */
-
 	if (doc == NULL)
 		doc = document_get_current();
 
@@ -361,6 +399,43 @@ void ui_update_statusbar(GeanyDocument *doc, gint pos)
 }
 
 
+static gboolean update_statusbar_idle(gpointer data)
+{
+	GeanyDocument *doc = NULL;
+
+	statusbar_update.source_id = 0;
+	if (statusbar_update.doc_id != 0)
+	{
+		doc = document_find_by_id(statusbar_update.doc_id);
+		/* the position is stale if the document was closed meanwhile */
+		if (doc == NULL)
+			statusbar_update.pos = -1;
+	}
+	if (interface_prefs.statusbar_visible)
+		update_statusbar(doc, statusbar_update.pos);
+	return G_SOURCE_REMOVE;
+}
+
+
+/* updates the status bar document statistics
+ * The update is done once per main loop iteration before the window gets redrawn,
+ * so moving the caret repeatedly (e.g. by holding a key) formats the statistics
+ * only once for all moves. */
+void ui_update_statusbar(GeanyDocument *doc, gint pos)
+{
+	g_return_if_fail(doc == NULL || doc->is_valid);
+
+	if (! interface_prefs.statusbar_visible)
+		return; /* just do nothing if statusbar is not visible */
+
+	statusbar_update.doc_id = doc ? doc->id : 0;
+	statusbar_update.pos = pos;
+	if (statusbar_update.source_id == 0)
+		statusbar_update.source_id = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+			update_statusbar_idle, NULL, NULL);
+}
+
+
 /* This sets the window title according to the current filename. */
 void ui_set_window_title(GeanyDocument *doc)
 {
@@ -1022,6 +1097,10 @@ void ui_sidebar_show_hide(void)
 		GTK_NOTEBOOK(main_widgets.sidebar_notebook), 0), interface_prefs.sidebar_symbol_visible);
 	ui_widget_show_hide(gtk_notebook_get_nth_page(
 		GTK_NOTEBOOK(main_widgets.sidebar_notebook), 1), interface_prefs.sidebar_openfiles_visible);
+
+	/* the symbol list isn't updated while the sidebar is hidden */
+	if (ui_prefs.sidebar_visible && main_status.main_window_realized)
+		sidebar_update_tag_list(document_get_current(), FALSE);
 }
 
 
@@ -2107,6 +2107,166 @@ gchar *utils_strv_find_common_prefix(gchar **strv, gssize strv_len)
 }
 
 
+/* A state of the suffix automaton of the tokens of the first string, for
+ * utils_strv_find_lcs(). All substrings reaching a state end at the same token
+ * positions and have between link->len + 1 and len tokens. */
+typedef struct
+{
+	gsize len;
+	gint link;
+	gsize end;		/* index of the last token of the first occurrence */
+	GArray *next;	/* LcsTransition, few per state for file paths */
+	gsize common;	/* longest match of all other strings ending here */
+	gsize cur;		/* longest match of the current string ending here */
+}
+LcsState;
+
+typedef struct
+{
+	guint token;
+	guint target;
+}
+LcsTransition;
+
+
+/* The root is never a target, so 0 means there is no transition. */
+static guint lcs_state_get_next(LcsState *state, guint token)
+{
+	guint i;
+
+	if (! state->next)
+		return 0;
+	for (i = 0; i < state->next->len; i++)
+	{
+		LcsTransition *trans = &g_array_index(state->next, LcsTransition, i);
+
+		if (trans->token == token)
+			return trans->target;
+	}
+	return 0;
+}
+
+
+static void lcs_state_set_next(LcsState *state, guint token, guint target)
+{
+	LcsTransition trans = {token, target};
+	guint i;
+
+	if (! state->next)
+		state->next = g_array_new(FALSE, FALSE, sizeof(LcsTransition));
+	for (i = 0; i < state->next->len; i++)
+	{
+		if (g_array_index(state->next, LcsTransition, i).token == token)
+		{
+			g_array_index(state->next, LcsTransition, i).target = target;
+			return;
+		}
+	}
+	g_array_append_val(state->next, trans);
+}
+
+
+/* Splits str into tokens: single characters without delim, otherwise the parts
+ * from one delimiter to the next one, both included. Tokens of the first string
+ * are added to token_ids and their character offsets to starts and ends, other
+ * strings only look them up (starts is NULL), unknown tokens can't match. */
+static void lcs_tokenize(const gchar *str, const gchar *delim, GHashTable *token_ids,
+		GString *buf, GArray *ids, GArray *starts, GArray *ends)
+{
+	const gchar *prev = NULL;
+	const gchar *p;
+
+	for (p = str; *p; p++)
+	{
+		gsize start = p - str, end = start + 1;
+		guint id;
+
+		if (! NZV(delim))
+			id = (guchar) *p;
+		else
+		{
+			gpointer value;
+
+			if (strchr(delim, *p) == NULL)
+				continue;
+			if (! prev)
+			{
+				prev = p;
+				continue;
+			}
+			start = prev - str;
+			prev = p;
+			g_string_truncate(buf, 0);
+			g_string_append_len(buf, str + start, end - start);
+			if (g_hash_table_lookup_extended(token_ids, buf->str, NULL, &value))
+				id = GPOINTER_TO_UINT(value);
+			else if (starts)
+			{
+				id = g_hash_table_size(token_ids);
+				g_hash_table_insert(token_ids, g_strdup(buf->str), GUINT_TO_POINTER(id));
+			}
+			else
+				id = G_MAXUINT;
+		}
+		g_array_append_val(ids, id);
+		if (starts)
+		{
+			g_array_append_val(starts, start);
+			g_array_append_val(ends, end);
+		}
+	}
+}
+
+
+/* Adds token to the automaton, last is the state of the whole string so far.
+ * Returns the state of the string with token appended. */
+static guint lcs_extend(LcsState *states, guint *n_states, guint last, guint token, gsize pos)
+{
+	guint cur = (*n_states)++;
+	gint p = last;
+
+	states[cur].len = states[last].len + 1;
+	states[cur].end = pos;
+	while (p >= 0 && lcs_state_get_next(&states[p], token) == 0)
+	{
+		lcs_state_set_next(&states[p], token, cur);
+		p = states[p].link;
+	}
+	if (p < 0)
+		states[cur].link = 0;
+	else
+	{
+		guint q = lcs_state_get_next(&states[p], token);
+
+		if (states[p].len + 1 == states[q].len)
+			states[cur].link = q;
+		else
+		{
+			guint clone = (*n_states)++;
+
+			states[clone].len = states[p].len + 1;
+			states[clone].link = states[q].link;
+			states[clone].end = states[q].end;
+			if (states[q].next)
+			{
+				GArray *next = states[q].next;
+
+				states[clone].next = g_array_sized_new(FALSE, FALSE, sizeof(LcsTransition), next->len);
+				g_array_append_vals(states[clone].next, next->data, next->len);
+			}
+			while (p >= 0 && lcs_state_get_next(&states[p], token) == q)
+			{
+				lcs_state_set_next(&states[p], token, clone);
+				p = states[p].link;
+			}
+			states[q].link = clone;
+			states[cur].link = clone;
+		}
+	}
+	return cur;
+}
+
+
 /* * Returns the longest common substring in a list of strings.
  *
  * The size of the list may be given explicitely, but defaults to @c g_strv_length(strv).
@@ -2119,61 +2279,124 @@ gchar *utils_strv_find_common_prefix(gchar **strv, gssize strv_len)
 GEANY_EXPORT_SYMBOL
 gchar *utils_strv_find_lcs(gchar **strv, gssize strv_len, const gchar *delim)
 {
-	gchar *first, *_sub, *sub;
-	gsize num;
-	gsize n_chars;
-	gsize len;
-	gsize max = 0;
-	char *lcs;
-	gsize found;
+	GHashTable *token_ids;
+	GString *buf;
+	GArray *ids, *starts, *ends;
+	LcsState *states;
+	guint *order, *counts;
+	guint n_states = 1, last = 0;
+	gsize num, n_tokens, i, j;
+	gsize best_start = 0, best_len = 0;
 
 	if (strv_len == 0)
 		return NULL;
 
 	num = (strv_len == -1) ? g_strv_length(strv) : (gsize) strv_len;
 
-	first = strv[0];
-	len = strlen(first);
-
-	/* sub is the working area where substrings from first are copied to */
-	sub = g_malloc(len+1);
-	lcs = g_strdup("");
-	foreach_str(_sub, first)
+	/* Common substrings start and end with a delimiter, if given, so compare
+	 * whole path components instead of characters. The suffix automaton of the
+	 * first string then finds the longest substring all others contain in time
+	 * linear in the total length, instead of a strstr() for each substring. */
+	token_ids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	buf = g_string_new(NULL);
+	ids = g_array_new(FALSE, FALSE, sizeof(guint));
+	starts = g_array_new(FALSE, FALSE, sizeof(gsize));
+	ends = g_array_new(FALSE, FALSE, sizeof(gsize));
+	lcs_tokenize(strv[0], delim, token_ids, buf, ids, starts, ends);
+	n_tokens = ids->len;
+
+	states = g_new0(LcsState, 2 * n_tokens + 1);
+	states[0].link = -1;
+	for (i = 0; i < n_tokens; i++)
+		last = lcs_extend(states, &n_states, last, g_array_index(ids, guint, i), i);
+	for (i = 0; i < n_states; i++)
+		states[i].common = states[i].len;
+
+	/* states by decreasing length, so matches propagate to the shorter suffixes */
+	counts = g_new0(guint, n_tokens + 2);
+	order = g_new(guint, n_states);
+	for (i = 0; i < n_states; i++)
+		counts[states[i].len + 1]++;
+	for (i = 1; i <= n_tokens + 1; i++)
+		counts[i] += counts[i - 1];
+	for (i = 0; i < n_states; i++)
+		order[n_states - 1 - counts[states[i].len]++] = i;
+
+	for (j = 1; j < num; j++)
 	{
-		gsize chars_left = len - (_sub - first);
-		/* No point in continuing if the remainder is too short */
-		if (max > chars_left)
-			break;
-		/* If delimiters are given, we only need to compare substrings which start and
-		 * end with one of them, so skip any non-delim chars at front ... */
-		if (NZV(delim) && (strchr(delim, _sub[0]) == NULL))
-			continue;
-		for (n_chars = 1; n_chars <= chars_left; n_chars++)
+		guint state = 0;
+		gsize len = 0;
+
+		g_array_set_size(ids, 0);
+		lcs_tokenize(strv[j], delim, token_ids, buf, ids, NULL, NULL);
+		for (i = 0; i < n_states; i++)
+			states[i].cur = 0;
+		for (i = 0; i < ids->len; i++)
 		{
-			if (NZV(delim))
-			{	/* ... and advance to the next delim char at the end, if any */
-				if (!_sub[n_chars] || strchr(delim, _sub[n_chars]) == NULL)
-					continue;
-				n_chars += 1;
+			guint token = g_array_index(ids, guint, i);
+			guint next;
+
+			while (state != 0 && lcs_state_get_next(&states[state], token) == 0)
+			{
+				state = states[state].link;
+				len = states[state].len;
 			}
-			g_strlcpy(sub, _sub, n_chars+1);
-			found = 1;
-			for (gsize i = 1; i < num; i++)
+			next = lcs_state_get_next(&states[state], token);
+			if (next != 0)
 			{
-				if (strstr(strv[i], sub) == NULL)
-					break;
-				found++;
+				state = next;
+				len++;
 			}
-			if (found == num && n_chars > max)
+			else
+				len = 0;
+			states[state].cur = MAX(states[state].cur, len);
+		}
+		for (i = 0; i < n_states; i++)
+		{
+			LcsState *s = &states[order[i]];
+
+			if (s->link >= 0)
 			{
-				max = n_chars;
-				SETPTR(lcs, g_strdup(sub));
+				LcsState *link = &states[s->link];
+
+				link->cur = MAX(link->cur, MIN(s->cur, link->len));
 			}
+			s->common = MIN(s->common, s->cur);
 		}
 	}
-	g_free(sub);
 
-	return lcs;
+	/* the longest match in characters, the first one on ties */
+	for (i = 1; i < n_states; i++)
+	{
+		LcsState *s = &states[i];
+		gsize start, len;
+
+		if (s->common <= states[s->link].len)
+			continue;
+		start = g_array_index(starts, gsize, s->end - s->common + 1);
+		len = g_array_index(ends, gsize, s->end) - start;
+		if (len > best_len || (len == best_len && start < best_start))
+		{
+			best_start = start;
+			best_len = len;
+		}
+	}
+
+	for (i = 0; i < n_states; i++)
+	{
+		if (states[i].next)
+			g_array_free(states[i].next, TRUE);
+	}
+	g_free(states);
+	g_free(order);
+	g_free(counts);
+	g_array_free(ids, TRUE);
+	g_array_free(starts, TRUE);
+	g_array_free(ends, TRUE);
+	g_string_free(buf, TRUE);
+	g_hash_table_destroy(token_ids);
+
+	return g_strndup(strv[0] + best_start, best_len);
 }
 
 
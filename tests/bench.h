@@ -0,0 +1,81 @@
+/*
+ * Benchmark result files.
+ *
+ * The benchmarks print their results for people to read and, with --json FILE,
+ * also write them to FILE in this format which scripts/bench-compare.py reads
+ * to compare the results of two releases:
+ *
+ *   {
+ *     "benchmark": "editor",
+ *     "version": "2.1",
+ *     "results": [
+ *       { "name": "load", "iterations": 5, "size": 4861238, "total_ms": 41.502, "avg_ms": 8.300 },
+ *       ...
+ *     ]
+ *   }
+ *
+ * The size is the amount of input of each iteration, bytes of text or number
+ * of tags. The names of the results don't change between releases, so new
+ * results can be added but existing ones mustn't be renamed. */
+
+#ifndef GEANY_BENCH_H
+#define GEANY_BENCH_H 1
+
+#include <glib.h>
+
+
+typedef struct
+{
+	GString *str;
+	guint	 count;
+} BenchJson;
+
+
+static void bench_json_init(BenchJson *json, const gchar *benchmark)
+{
+	json->str = g_string_new(NULL);
+	json->count = 0;
+	g_string_append_printf(json->str, "{\n  \"benchmark\": \"%s\",\n  \"version\": \"%s\",\n"
+		"  \"results\": [", benchmark, PACKAGE_VERSION);
+}
+
+
+/* time is the total time of all iterations in microseconds */
+static void bench_json_add(BenchJson *json, const gchar *name, gint iterations, guint64 size,
+	gint64 time)
+{
+	gchar *escaped = g_strescape(name, NULL);
+
+	/* use the C locale for the decimal point whatever the environment is */
+	gchar total_ms[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar avg_ms[G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_ascii_formatd(total_ms, sizeof total_ms, "%.3f", time / 1000.0);
+	g_ascii_formatd(avg_ms, sizeof avg_ms, "%.3f", time / 1000.0 / MAX(iterations, 1));
+	g_string_append_printf(json->str, "%s\n    { \"name\": \"%s\", \"iterations\": %d, "
+		"\"size\": %" G_GUINT64_FORMAT ", \"total_ms\": %s, \"avg_ms\": %s }",
+		json->count > 0 ? "," : "", escaped, iterations, size, total_ms, avg_ms);
+	json->count++;
+	g_free(escaped);
+}
+
+
+/* Writes the results to file_name (if not NULL) and frees them */
+static gboolean bench_json_write(BenchJson *json, const gchar *file_name)
+{
+	GError *error = NULL;
+	gboolean ok = TRUE;
+
+	g_string_append(json->str, "\n  ]\n}\n");
+	if (file_name && ! g_file_set_contents(file_name, json->str->str, json->str->len, &error))
+	{
+		g_printerr("Cannot write %s: %s\n", file_name, error->message);
+		g_error_free(error);
+		ok = FALSE;
+	}
+	g_string_free(json->str, TRUE);
+	json->str = NULL;
+	return ok;
+}
+
+#endif /* GEANY_BENCH_H */
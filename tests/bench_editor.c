@@ -0,0 +1,285 @@
+/*
+ * Editor benchmark.
+ *
+ * Creates a large synthetic C document in a Scintilla widget without the main
+ * window and times the editor operations whose cost grows with the size of the
+ * document. Prints one tab separated line per operation, so the results of
+ * different releases can be compared by scripts.
+ *
+ * Usage: bench_editor [--data-dir DIR] [--iterations N] [--functions N] [--json FILE]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "app.h"
+#include "bench.h"
+#include "document.h"
+#include "documentprivate.h"
+#include "editor.h"
+#include "filetypes.h"
+#include "main.h"
+#include "sciwrappers.h"
+#include "search.h"
+#include "sidebar.h"
+#include "symbols.h"
+#include "tm_source_file.h"
+#include "tm_workspace.h"
+
+#include "SciLexer.h"
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <string.h>
+
+
+enum
+{
+	BENCH_LOAD,
+	BENCH_LEX,
+	BENCH_TAGS,
+	BENCH_SYMBOL_TREE,
+	BENCH_MARK_ALL,
+	BENCH_FIND,
+	BENCH_FIND_NOCASE,
+	BENCH_COMMENT_TOGGLE,
+	BENCH_REPLACE_ALL,
+	BENCH_COUNT
+};
+
+static const gchar *bench_names[BENCH_COUNT] =
+{
+	"load", "lex", "tags", "symbol_tree", "mark_all", "find", "find_nocase", "comment_toggle",
+	"replace_all"
+};
+
+
+static gchar *data_dir = NULL;
+static gint iterations = 5;
+static gint functions = 20000;
+static gchar *json_file = NULL;
+
+static GOptionEntry entries[] =
+{
+	{ "data-dir", 'd', 0, G_OPTION_ARG_FILENAME, &data_dir, "Read the filetype definitions from DIR", "DIR" },
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Run each operation N times (default: 5)", "N" },
+	{ "functions", 'f', 0, G_OPTION_ARG_INT, &functions, "Generate a document with N functions (default: 20000)", "N" },
+	{ "json", 'j', 0, G_OPTION_ARG_FILENAME, &json_file, "Also write the results to FILE in JSON", "FILE" },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+
+static gchar *create_text(void)
+{
+	GString *str = g_string_new("#include <string.h>\n\n");
+	gint i;
+
+	for (i = 0; i < functions; i++)
+	{
+		g_string_append_printf(str,
+			"/* Returns the value %d for a and the length of b. */\n"
+			"static int function_%d(int a, const char *b)\n"
+			"{\n"
+			"\tint value = a * %d;\n"
+			"\n"
+			"\tif (b && value > 0)\n"
+			"\t\treturn (int) strlen(b) + value;\n"
+			"\treturn value;\n"
+			"}\n\n", i, i, i);
+	}
+	return g_string_free(str, FALSE);
+}
+
+
+/* A document with just the parts the benchmarked functions use, since the
+ * documents of the main window need the notebook and the sidebar. */
+static GeanyDocument *create_document(void)
+{
+	GeanyDocument *doc = g_new0(GeanyDocument, 1);
+	GeanyEditor *editor = g_new0(GeanyEditor, 1);
+
+	doc->priv = g_new0(GeanyDocumentPrivate, 1);
+	doc->priv->tag_filter = g_strdup("");
+	doc->priv->tag_store = gtk_tree_store_new(SYMBOLS_N_COLUMNS, GDK_TYPE_PIXBUF,
+		G_TYPE_STRING, TM_TYPE_TAG);
+	doc->id = 1;
+	doc->is_valid = TRUE;
+	doc->file_name = g_strdup("bench.c");
+	doc->file_type = filetypes[GEANY_FILETYPES_C];
+	doc->tm_file = tm_source_file_new(doc->file_name, tm_source_file_get_lang_name(doc->file_type->lang));
+	doc->editor = editor;
+
+	editor->document = doc;
+	editor->sci = SCINTILLA(scintilla_new());
+	g_object_ref_sink(editor->sci);
+	sci_set_codepage(editor->sci, SC_CP_UTF8);
+	sci_set_lexer(editor->sci, SCLEX_CPP);
+
+	g_ptr_array_add(documents_array, doc);
+	return doc;
+}
+
+
+static void free_document(GeanyDocument *doc)
+{
+	g_ptr_array_remove(documents_array, doc);
+	gtk_widget_destroy(GTK_WIDGET(doc->editor->sci));
+	g_object_unref(doc->editor->sci);
+	tm_source_file_free(doc->tm_file);
+	g_object_unref(doc->priv->tag_store);
+	g_free(doc->priv->tag_filter);
+	g_free(doc->priv);
+	g_free(doc->file_name);
+	g_free(doc->editor);
+	g_free(doc);
+}
+
+
+static void load_text(GeanyDocument *doc, const gchar *text)
+{
+	sci_set_text(doc->editor->sci, text);
+	SSM(doc->editor->sci, SCI_EMPTYUNDOBUFFER, 0, 0);
+}
+
+
+static void run_pending(void)
+{
+	while (g_main_context_iteration(NULL, FALSE));
+}
+
+
+/* Finds all matches from the start to the end of the document one by one, as
+ * the Find dialog does */
+static void find_all(ScintillaObject *sci, const gchar *text, gint flags)
+{
+	struct Sci_TextToFind ttf;
+
+	ttf.chrg.cpMin = 0;
+	ttf.chrg.cpMax = sci_get_length(sci);
+	ttf.lpstrText = (gchar *) text;
+	while (sci_find_text(sci, flags, &ttf) >= 0)
+		ttf.chrg.cpMin = MAX(ttf.chrgText.cpMax, ttf.chrgText.cpMin + 1);
+}
+
+
+static void run_iteration(GeanyDocument *doc, const gchar *text, gint64 *times)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	struct Sci_TextToFind ttf;
+	gint64 start;
+
+	start = g_get_monotonic_time();
+	load_text(doc, text);
+	times[BENCH_LOAD] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	sci_colourise(sci, 0, -1);
+	times[BENCH_LEX] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	/* forget the previous parse, an unchanged buffer isn't parsed again */
+	tm_source_file_invalidate_indexes(doc->tm_file);
+	tm_source_file_parse(doc->tm_file, (guchar *) SSM(sci, SCI_GETCHARACTERPOINTER, 0, 0),
+		sci_get_length(sci), TRUE);
+	times[BENCH_TAGS] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	gtk_tree_store_clear(doc->priv->tag_store);
+	symbols_recreate_tag_list(doc, SYMBOLS_SORT_BY_NAME);
+	times[BENCH_SYMBOL_TREE] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	search_mark_all(doc, "value", GEANY_FIND_MATCHCASE | GEANY_FIND_WHOLEWORD);
+	/* the matches outside the view are marked in idle callbacks */
+	run_pending();
+	times[BENCH_MARK_ALL] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	find_all(sci, "strlen", SCFIND_MATCHCASE);
+	times[BENCH_FIND] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	find_all(sci, "STRLEN", 0);
+	times[BENCH_FIND_NOCASE] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	sci_select_all(sci);
+	editor_do_comment_toggle(doc->editor);
+	times[BENCH_COMMENT_TOGGLE] += g_get_monotonic_time() - start;
+
+	load_text(doc, text);
+	start = g_get_monotonic_time();
+	ttf.chrg.cpMin = 0;
+	ttf.chrg.cpMax = sci_get_length(sci);
+	ttf.lpstrText = (gchar *) "value";
+	sci_start_undo_action(sci);
+	search_replace_range(sci, &ttf, GEANY_FIND_MATCHCASE | GEANY_FIND_WHOLEWORD, "amount");
+	sci_end_undo_action(sci);
+	times[BENCH_REPLACE_ALL] += g_get_monotonic_time() - start;
+}
+
+
+int main(int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GeanyDocument *doc;
+	gint64 times[BENCH_COUNT] = { 0 };
+	BenchJson json;
+	gboolean ok;
+	gchar *text;
+	gsize length;
+	gint i;
+
+	context = g_option_context_new("- benchmark editor operations on a large document");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (! g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return 1;
+	}
+	g_option_context_free(context);
+
+	if (! gtk_init_check(&argc, &argv))
+	{
+		g_printerr("Cannot open a display\n");
+		return 1;
+	}
+	iterations = MAX(iterations, 1);
+	functions = MAX(functions, 1);
+
+	main_init_headless();
+	/* only use the given filetype definitions, as the ctags test runner does */
+	app->datadir = data_dir ? data_dir : g_build_filename("..", "data", NULL);
+	app->configdir = app->datadir;
+	app->tm_workspace = tm_get_workspace();
+	filetypes_init_types();
+	document_init_doclist();
+	/* the default of the preference */
+	editor_prefs.comment_toggle_mark = (gchar *) "~ ";
+
+	text = create_text();
+	length = strlen(text);
+	doc = create_document();
+
+	for (i = 0; i < iterations; i++)
+		run_iteration(doc, text, times);
+
+	bench_json_init(&json, "editor");
+	printf("operation\titerations\tbytes\ttotal_ms\tavg_ms\n");
+	for (i = 0; i < BENCH_COUNT; i++)
+	{
+		printf("%s\t%d\t%" G_GSIZE_FORMAT "\t%.3f\t%.3f\n", bench_names[i], iterations, length,
+			times[i] / 1000.0, times[i] / 1000.0 / iterations);
+		bench_json_add(&json, bench_names[i], iterations, length, times[i]);
+	}
+	ok = bench_json_write(&json, json_file);
+
+	free_document(doc);
+	g_free(text);
+	filetypes_free_types();
+	tm_workspace_free();
+	return ok ? 0 : 1;
+}
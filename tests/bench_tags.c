@@ -0,0 +1,246 @@
+/*
+ * Tag parsing benchmark.
+ *
+ * Parses the given source files (directories are searched recursively) a
+ * number of times with the tag manager and prints the throughput of each
+ * parser, so the numbers can be compared before and after a parser change.
+ *
+ * Usage: bench_tags [--data-dir DIR] [--iterations N] [--scale N] [--json FILE] FILE|DIR...
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "app.h"
+#include "bench.h"
+#include "filetypes.h"
+#include "main.h"
+#include "tm_source_file.h"
+#include "tm_workspace.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+
+
+typedef struct
+{
+	gchar		*file_name;
+	TMParserType lang;
+	guchar		*buf;
+	gsize		 size;
+} BenchInput;
+
+typedef struct
+{
+	guint	files;
+	guint64	bytes;
+	guint64	tags;
+	gint64	time;
+} BenchResult;
+
+
+static gchar *data_dir = NULL;
+static gint iterations = 10;
+static gint scale = 1;
+static gchar *json_file = NULL;
+
+static GOptionEntry entries[] =
+{
+	{ "data-dir", 'd', 0, G_OPTION_ARG_FILENAME, &data_dir, "Read the filetype definitions from DIR", "DIR" },
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Parse each input N times (default: 10)", "N" },
+	{ "scale", 's', 0, G_OPTION_ARG_INT, &scale, "Concatenate each input N times to get large inputs (default: 1)", "N" },
+	{ "json", 'j', 0, G_OPTION_ARG_FILENAME, &json_file, "Also write the results to FILE in JSON", "FILE" },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+
+static void add_input(GPtrArray *inputs, const gchar *file_name)
+{
+	GeanyFiletype *ft = filetypes_detect_from_extension(file_name);
+	BenchInput *input;
+	gchar *contents;
+	gsize length;
+	gint i;
+
+	if (ft->lang < 0 || ! g_file_get_contents(file_name, &contents, &length, NULL))
+		return;
+	if (length == 0)
+	{
+		g_free(contents);
+		return;
+	}
+
+	input = g_new0(BenchInput, 1);
+	input->file_name = g_strdup(file_name);
+	input->lang = ft->lang;
+	input->size = length * scale;
+	input->buf = g_malloc(input->size + 1);
+	for (i = 0; i < scale; i++)
+		memcpy(input->buf + length * i, contents, length);
+	input->buf[input->size] = '\0';
+	g_free(contents);
+
+	g_ptr_array_add(inputs, input);
+}
+
+
+static void add_inputs(GPtrArray *inputs, const gchar *path)
+{
+	GDir *dir;
+	const gchar *name;
+
+	if (! g_file_test(path, G_FILE_TEST_IS_DIR))
+	{
+		add_input(inputs, path);
+		return;
+	}
+
+	dir = g_dir_open(path, 0, NULL);
+	if (! dir)
+		return;
+	while ((name = g_dir_read_name(dir)))
+	{
+		gchar *child;
+
+		/* skip the expected results and the build files of the test suite */
+		if (g_str_has_suffix(name, ".tags") || g_str_has_prefix(name, "Makefile") ||
+			g_str_has_suffix(name, ".sh"))
+			continue;
+
+		child = g_build_filename(path, name, NULL);
+		add_inputs(inputs, child);
+		g_free(child);
+	}
+	g_dir_close(dir);
+}
+
+
+static void free_input(gpointer data)
+{
+	BenchInput *input = data;
+
+	g_free(input->file_name);
+	g_free(input->buf);
+	g_free(input);
+}
+
+
+static void run_input(BenchInput *input, BenchResult *result)
+{
+	TMSourceFile *source_file;
+	gint64 start;
+	gint i;
+
+	source_file = tm_source_file_new(input->file_name, tm_source_file_get_lang_name(input->lang));
+	if (! source_file)
+		return;
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < iterations; i++)
+	{
+		/* forget the previous parse, an unchanged buffer isn't parsed again */
+		tm_source_file_invalidate_indexes(source_file);
+		tm_source_file_parse(source_file, input->buf, input->size, TRUE);
+		result->tags += source_file->tags_array->len;
+	}
+	result->time += g_get_monotonic_time() - start;
+	result->bytes += (guint64) input->size * iterations;
+	result->files++;
+
+	tm_source_file_free(source_file);
+}
+
+
+static gdouble get_mb_per_sec(guint64 bytes, gint64 time)
+{
+	if (time <= 0)
+		return 0.0;
+	return (bytes / (1024.0 * 1024.0)) / (time / (gdouble) G_USEC_PER_SEC);
+}
+
+
+static void print_result(const gchar *name, const BenchResult *result)
+{
+	printf("%-16s %6u %12" G_GUINT64_FORMAT " %10.3f %10.2f %12" G_GUINT64_FORMAT " %12.0f\n",
+		name, result->files, result->bytes, result->time / 1000.0,
+		get_mb_per_sec(result->bytes, result->time), result->tags,
+		result->time > 0 ? result->tags * (gdouble) G_USEC_PER_SEC / result->time : 0.0);
+}
+
+
+int main(int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GPtrArray *inputs;
+	BenchResult *results;
+	BenchResult total = { 0 };
+	BenchJson json;
+	gboolean ok;
+	guint i;
+
+	context = g_option_context_new("FILE|DIR... - benchmark the tag parsers");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (! g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return 1;
+	}
+	g_option_context_free(context);
+
+	if (argc < 2)
+	{
+		g_printerr("No input files given\n");
+		return 1;
+	}
+	iterations = MAX(iterations, 1);
+	scale = MAX(scale, 1);
+
+	main_init_headless();
+	/* only use the given filetype definitions, as the ctags test runner does */
+	app->datadir = data_dir ? data_dir : g_build_filename("..", "data", NULL);
+	app->configdir = app->datadir;
+	app->tm_workspace = tm_get_workspace();
+	filetypes_init_types();
+
+	inputs = g_ptr_array_new_with_free_func(free_input);
+	for (i = 1; i < (guint) argc; i++)
+		add_inputs(inputs, argv[i]);
+
+	results = g_new0(BenchResult, TM_PARSER_COUNT);
+	for (i = 0; i < inputs->len; i++)
+	{
+		BenchInput *input = inputs->pdata[i];
+
+		run_input(input, &results[input->lang]);
+	}
+
+	bench_json_init(&json, "tags");
+	printf("%-16s %6s %12s %10s %10s %12s %12s\n",
+		"parser", "files", "bytes", "ms", "MB/s", "tags", "tags/s");
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		if (results[i].files == 0)
+			continue;
+
+		print_result(tm_source_file_get_lang_name(i), &results[i]);
+		bench_json_add(&json, tm_source_file_get_lang_name(i), iterations,
+			results[i].bytes / iterations, results[i].time);
+		total.files += results[i].files;
+		total.bytes += results[i].bytes;
+		total.tags += results[i].tags;
+		total.time += results[i].time;
+	}
+	print_result("total", &total);
+	bench_json_add(&json, "total", iterations, total.bytes / iterations, total.time);
+	ok = bench_json_write(&json, json_file);
+
+	g_free(results);
+	g_ptr_array_free(inputs, TRUE);
+	filetypes_free_types();
+	tm_workspace_free();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+/*
+ * Tag manager benchmark.
+ *
+ * Creates a large number of synthetic tags, as in the workspace of a big
+ * project, and times the tag array operations whose cost grows with the number
+ * of tags: sorting the workspace array, merging the tags of a reparsed file into
+ * it and finding tags by name. Prints one tab separated line per operation like
+ * bench_editor.
+ *
+ * Usage: bench_tm [--iterations N] [--tags N] [--json FILE]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "bench.h"
+#include "tm_source_file.h"
+#include "tm_tag.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+enum
+{
+	BENCH_SORT,
+	BENCH_MERGE,
+	BENCH_MERGE_IN_PLACE,
+	BENCH_FIND,
+	BENCH_FIND_PARTIAL,
+	BENCH_COUNT
+};
+
+static const gchar *bench_names[BENCH_COUNT] =
+{
+	"sort", "merge", "merge_in_place", "find", "find_partial"
+};
+
+/* the tags of one file, merged into the workspace array */
+#define FILE_TAGS 2000
+#define FILES 1000
+#define LOOKUPS 10000
+
+
+static gint iterations = 5;
+static gint tag_count = 1000000;
+static gchar *json_file = NULL;
+
+static GOptionEntry entries[] =
+{
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Run each operation N times (default: 5)", "N" },
+	{ "tags", 't', 0, G_OPTION_ARG_INT, &tag_count, "Create N tags (default: 1000000)", "N" },
+	{ "json", 'j', 0, G_OPTION_ARG_FILENAME, &json_file, "Also write the results to FILE in JSON", "FILE" },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+static TMTagAttrType sort_attrs[] =
+{
+	tm_tag_attr_name_t, tm_tag_attr_file_t, tm_tag_attr_line_t,
+	tm_tag_attr_type_t, tm_tag_attr_scope_t, tm_tag_attr_arglist_t, 0
+};
+
+/* the tags only need distinct file pointers, which the sort compares */
+static TMSourceFile files[FILES + 1];
+
+
+/* Names repeat across files and many share their prefixes like the symbols
+ * of real projects do. */
+static TMTag *create_tag(guint32 n, TMSourceFile *file, gulong line)
+{
+	static const gchar *prefixes[] = { "get_", "set_", "on_", "is_", "create_", "free_", "" };
+	static const gchar *scopes[] = { NULL, "Document", "Editor", "Project", "Widget" };
+	TMTag *tag = tm_tag_new();
+	gchar *name;
+
+	name = g_strdup_printf("%sitem_%u", prefixes[n % G_N_ELEMENTS(prefixes)], n / 4);
+	tag->name = tm_tag_intern_string(name);
+	tag->type = (n & 1) ? tm_tag_function_t : tm_tag_variable_t;
+	tag->file = file;
+	tag->line = line;
+	tag->scope = tm_tag_intern_string(scopes[n % G_N_ELEMENTS(scopes)]);
+	if (tag->type == tm_tag_function_t)
+		tag->arglist = tm_tag_intern_string("(int a, const char *b)");
+	g_free(name);
+	return tag;
+}
+
+
+static GPtrArray *create_tags(GRand *rand)
+{
+	GPtrArray *tags = g_ptr_array_sized_new(tag_count);
+	gint i;
+
+	for (i = 0; i < tag_count; i++)
+	{
+		guint32 n = g_rand_int_range(rand, 0, MAX(tag_count, 4));
+
+		g_ptr_array_add(tags, create_tag(n, &files[i % FILES], i / FILES + 1));
+	}
+	return tags;
+}
+
+
+static GPtrArray *copy_tags(GPtrArray *tags)
+{
+	GPtrArray *copy = g_ptr_array_sized_new(tags->len + FILE_TAGS);
+
+	g_ptr_array_set_size(copy, tags->len);
+	memcpy(copy->pdata, tags->pdata, tags->len * sizeof(gpointer));
+	return copy;
+}
+
+
+static void free_tags(GPtrArray *tags)
+{
+	guint i;
+
+	for (i = 0; i < tags->len; i++)
+		tm_tag_unref(tags->pdata[i]);
+	g_ptr_array_free(tags, TRUE);
+}
+
+
+static void run_iteration(GPtrArray *tags, GPtrArray *file_tags, gchar **names, gchar **prefixes,
+	gint64 *times)
+{
+	GPtrArray *sorted, *merged;
+	gint64 start;
+	guint count;
+	gint i;
+
+	sorted = copy_tags(tags);
+	start = g_get_monotonic_time();
+	tm_tags_sort(sorted, sort_attrs, FALSE, FALSE);
+	times[BENCH_SORT] += g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	merged = tm_tags_merge(sorted, file_tags, sort_attrs, FALSE);
+	times[BENCH_MERGE] += g_get_monotonic_time() - start;
+	g_ptr_array_free(merged, TRUE);
+
+	merged = copy_tags(sorted);
+	start = g_get_monotonic_time();
+	tm_tags_merge_in_place(merged, file_tags, sort_attrs, FALSE);
+	times[BENCH_MERGE_IN_PLACE] += g_get_monotonic_time() - start;
+	g_ptr_array_free(merged, TRUE);
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < LOOKUPS; i++)
+		tm_tags_find(sorted, names[i], FALSE, &count);
+	times[BENCH_FIND] += g_get_monotonic_time() - start;
+
+	/* what autocompletion looks up while typing the start of a name */
+	start = g_get_monotonic_time();
+	for (i = 0; i < LOOKUPS; i++)
+		tm_tags_find(sorted, prefixes[i], TRUE, &count);
+	times[BENCH_FIND_PARTIAL] += g_get_monotonic_time() - start;
+
+	g_ptr_array_free(sorted, TRUE);
+}
+
+
+int main(int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GPtrArray *tags, *file_tags;
+	gint64 times[BENCH_COUNT] = { 0 };
+	gchar *names[LOOKUPS];
+	gchar *prefixes[LOOKUPS];
+	BenchJson json;
+	GRand *rand;
+	gboolean ok;
+	gint i;
+
+	context = g_option_context_new("- benchmark the tag manager on many tags");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (! g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return 1;
+	}
+	g_option_context_free(context);
+
+	iterations = MAX(iterations, 1);
+	tag_count = MAX(tag_count, 1);
+
+	/* the same tags in every run so the results can be compared */
+	rand = g_rand_new_with_seed(42);
+	tags = create_tags(rand);
+
+	/* a reparsed file, whose tags are sorted before they are merged */
+	file_tags = g_ptr_array_sized_new(FILE_TAGS);
+	for (i = 0; i < FILE_TAGS; i++)
+	{
+		guint32 n = g_rand_int_range(rand, 0, MAX(tag_count, 4));
+
+		g_ptr_array_add(file_tags, create_tag(n, &files[FILES], i + 1));
+	}
+	tm_tags_sort(file_tags, sort_attrs, FALSE, FALSE);
+
+	for (i = 0; i < LOOKUPS; i++)
+	{
+		TMTag *tag = tags->pdata[g_rand_int_range(rand, 0, tags->len)];
+
+		names[i] = tag->name;
+		prefixes[i] = g_strndup(tag->name, MAX(strlen(tag->name) / 2, 1));
+	}
+
+	for (i = 0; i < iterations; i++)
+		run_iteration(tags, file_tags, names, prefixes, times);
+
+	bench_json_init(&json, "tm");
+	printf("operation\titerations\ttags\ttotal_ms\tavg_ms\n");
+	for (i = 0; i < BENCH_COUNT; i++)
+	{
+		printf("%s\t%d\t%d\t%.3f\t%.3f\n", bench_names[i], iterations, tag_count,
+			times[i] / 1000.0, times[i] / 1000.0 / iterations);
+		bench_json_add(&json, bench_names[i], iterations, tag_count, times[i]);
+	}
+	ok = bench_json_write(&json, json_file);
+
+	for (i = 0; i < LOOKUPS; i++)
+		g_free(prefixes[i]);
+	free_tags(file_tags);
+	free_tags(tags);
+	g_rand_free(rand);
+	return ok ? 0 : 1;
+}
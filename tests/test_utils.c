@@ -270,6 +270,68 @@ void test_utils_strv_find_lcs(void)
 	g_assert_cmpstr(s, ==, "");
 	g_free(s);
 	g_strfreev(data);
+
+	/* the delimiter is given explicitly so the results don't depend on DIR_SEP */
+	data = utils_strv_new("/usr/lib/x/y.c", "/opt/lib/x/z.c", NULL);
+	s = utils_strv_find_lcs(data, -1, "");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "/lib/x/");
+	g_free(s);
+	s = utils_strv_find_lcs(data, -1, "/");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "/lib/x/");
+	g_free(s);
+	g_strfreev(data);
+
+	/* empty components */
+	data = utils_strv_new("a//b", "x//b", NULL);
+	s = utils_strv_find_lcs(data, -1, "");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "//b");
+	g_free(s);
+	s = utils_strv_find_lcs(data, -1, "/");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "//");
+	g_free(s);
+	g_strfreev(data);
+
+	data = utils_strv_new("/a//b/c", "/x//b/d", NULL);
+	s = utils_strv_find_lcs(data, -1, "/");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "//b/");
+	g_free(s);
+	g_strfreev(data);
+
+	/* a single string */
+	data = utils_strv_new("/a/b/c", NULL);
+	s = utils_strv_find_lcs(data, -1, "");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "/a/b/c");
+	g_free(s);
+	s = utils_strv_find_lcs(data, -1, "/");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "/a/b/");
+	g_free(s);
+	g_strfreev(data);
+
+	/* no common part */
+	data = utils_strv_new("abc", "xyz", NULL);
+	s = utils_strv_find_lcs(data, -1, "");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "");
+	g_free(s);
+	s = utils_strv_find_lcs(data, -1, "/");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "");
+	g_free(s);
+	g_strfreev(data);
+
+	data = utils_strv_new("usr/x", "opt/y", NULL);
+	s = utils_strv_find_lcs(data, -1, "/");
+	g_assert_nonnull(s);
+	g_assert_cmpstr(s, ==, "");
+	g_free(s);
+	g_strfreev(data);
 }
 
 